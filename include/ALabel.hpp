@@ -4,33 +4,89 @@
 #include <gtkmm/label.h>
 #include <json/json.h>
 
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "AModule.hpp"
+#include "util/format_fields.hpp"
+#include "util/state_socket.hpp"
 
 namespace waybar {
 
+/* A Gtk::Label whose markup setters skip what it already shows: GTK would still re-parse the
+ * markup and queue a resize of the whole bar for it. The counts are logged at debug level.
+ */
+class DiffLabel : public Gtk::Label {
+ public:
+  ~DiffLabel() override;
+  void set_markup(const Glib::ustring &markup);
+  void set_tooltip_markup(const Glib::ustring &markup);
+
+ private:
+  size_t applied_ = 0;
+  size_t skipped_ = 0;
+};
+
 class ALabel : public AModule {
  public:
   ALabel(const Json::Value &, const std::string &, const std::string &, const std::string &format,
          uint16_t interval = 0, bool ellipsize = false, bool enable_click = false,
          bool enable_scroll = false);
-  virtual ~ALabel() = default;
+  virtual ~ALabel();
   auto update() -> void override;
+  // The output of the bar, which tells the module apart from its copies on the state socket
+  void setStateOutput(const std::string &output);
   virtual std::string getIcon(uint16_t, const std::string &alt = "", uint16_t max = 0);
   virtual std::string getIcon(uint16_t, const std::vector<std::string> &alts, uint16_t max = 0);
 
  protected:
-  Gtk::Label label_;
+  DiffLabel label_;
   std::string format_;
   const std::chrono::milliseconds interval_;
+  // "interval-on-battery", 0 without one: the interval then follows the battery factor
+  const std::chrono::milliseconds interval_on_battery_;
   bool alt_ = false;
   std::string default_format_;
 
   bool handleToggle(GdkEventButton *const &e) override;
   virtual std::string getState(uint8_t value, bool lesser = false);
+  /* Whether format, format_ by default, shows the placeholder name, for arguments that cost to
+   * compute. The placeholders of the last format asked about are kept.
+   */
+  bool formatUses(const std::string &format, std::string_view name);
+  bool formatUses(std::string_view name) { return formatUses(format_, name); }
+
+  // Whether the state socket runs: the modules then fill state_fields_ before update()
+  static bool publishesState() { return util::StateSocket::inst() != nullptr; }
+  // The raw values of the module for the state socket, taken by each update()
+  Json::Value state_fields_;
 
   std::map<std::string, GtkMenuItem *> submenus_;
   std::map<std::string, std::string> menuActionsMap_;
   static void handleGtkMenuEvent(GtkMenuItem *menuitem, gpointer data);
+
+ private:
+  // format-icons, read once: a list per alt, and the list for anything else
+  struct FormatIcons {
+    std::unordered_map<std::string, std::vector<std::string>> alts;
+    std::vector<std::string> fallback;
+  };
+  static std::vector<std::string> iconList(const Json::Value &icons);
+  const std::string &pickIcon(const std::vector<std::string> &icons, uint16_t percentage,
+                              uint16_t max) const;
+  void publishState();
+
+  FormatIcons format_icons_;
+  const std::string state_module_;  // name#id
+  std::string state_output_;
+  std::string state_key_;  // output/name#id, once the bar set the output
+  // states, read once and sorted by their value, and the one whose class the label has
+  std::vector<std::pair<std::string, uint8_t>> states_;
+  std::string current_state_;
+  std::string format_fields_of_;  // the format format_fields_ was read from
+  util::FormatFields format_fields_;
 };
 
 }  // namespace waybar
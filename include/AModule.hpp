@@ -6,7 +6,13 @@
 #include <gtkmm/eventbox.h>
 #include <json/json.h>
 
+#include <array>
+#include <chrono>
+#include <functional>
+
 #include "IModule.hpp"
+#include "util/action_runner.hpp"
+#include "util/string_map.hpp"
 
 namespace waybar {
 
@@ -17,12 +23,34 @@ class AModule : public IModule {
   ~AModule() override;
   auto update() -> void override;
   virtual auto refresh(int shouldRefresh) -> void {};
+  static constexpr int ANY_SIGNAL = -1;
+  /* The SIGRTMIN+N signal refresh() is called for, 0 for none, ANY_SIGNAL for all of them.
+   * Asked once, when the bar adds the module. SIGRTMIN + "signal" by default.
+   */
+  virtual auto refreshSignal() const -> int { return refreshSignal_; }
   operator Gtk::Widget &() override;
   auto doAction(const std::string &name) -> void override;
+  /* Updates are held back while paused, and one is run on resume if data came in meanwhile.
+   * Modules that poll override it to pause their timers too.
+   */
+  auto setPaused(bool paused) -> void override;
+  /* Updates are held back as well while the module is hidden in a closed drawer, the data keeps
+   * coming in and the last of it is shown as the drawer opens.
+   */
+  virtual auto setHidden(bool hidden) -> void;
+  /* Whether the module holds wayland objects of the bar's output. When the output comes back, a
+   * bar is moved to it if none of its modules does, and built again otherwise.
+   */
+  virtual auto boundToOutput() const -> bool { return false; }
 
   /// Emitting on this dispatcher triggers a update() call
   Glib::Dispatcher dp;
 
+  /* Connects dp to fn. Emissions are coalesced: fn runs at most once per main loop iteration,
+   * ahead of the bar relayout and redraw, and not more often than the "min-update-interval".
+   */
+  auto connectUpdate(std::function<void()> fn) -> void;
+
   bool expandEnabled() const;
 
  protected:
@@ -36,10 +64,14 @@ class AModule : public IModule {
   SCROLL_DIR getScrollDir(GdkEventScroll *e);
   bool tooltipEnabled() const;
 
-  std::vector<int> pid_children_;
   const std::string name_;
   const Json::Value &config_;
   Gtk::EventBox event_box_;
+  // "exec-direct": run plain commands without a shell, see util::command::spawn()
+  const bool execDirect_;
+  const int refreshSignal_;
+  // The commands of the clicks, scrolls and updates, run as their "exec-policy" allows
+  util::ActionRunner action_runner_;
 
   virtual void setCursor(Gdk::CursorType const &c);
 
@@ -52,33 +84,51 @@ class AModule : public IModule {
 
  private:
   bool handleUserEvent(GdkEventButton *const &ev);
+  void scheduleUpdate();
+  void runHeldUpdate();
+  bool runUpdate();
   const bool isTooltip;
   const bool isExpand;
   bool hasUserEvents_;
   gdouble distance_scrolled_y_;
   gdouble distance_scrolled_x_;
-  std::map<std::string, std::string> eventActionMap_;
-  static const inline std::map<std::pair<uint, GdkEventType>, std::string> eventMap_{
-      {std::make_pair(1, GdkEventType::GDK_BUTTON_PRESS), "on-click"},
-      {std::make_pair(1, GdkEventType::GDK_BUTTON_RELEASE), "on-click-release"},
-      {std::make_pair(1, GdkEventType::GDK_2BUTTON_PRESS), "on-double-click"},
-      {std::make_pair(1, GdkEventType::GDK_3BUTTON_PRESS), "on-triple-click"},
-      {std::make_pair(2, GdkEventType::GDK_BUTTON_PRESS), "on-click-middle"},
-      {std::make_pair(2, GdkEventType::GDK_BUTTON_RELEASE), "on-click-middle-release"},
-      {std::make_pair(2, GdkEventType::GDK_2BUTTON_PRESS), "on-double-click-middle"},
-      {std::make_pair(2, GdkEventType::GDK_3BUTTON_PRESS), "on-triple-click-middle"},
-      {std::make_pair(3, GdkEventType::GDK_BUTTON_PRESS), "on-click-right"},
-      {std::make_pair(3, GdkEventType::GDK_BUTTON_RELEASE), "on-click-right-release"},
-      {std::make_pair(3, GdkEventType::GDK_2BUTTON_PRESS), "on-double-click-right"},
-      {std::make_pair(3, GdkEventType::GDK_3BUTTON_PRESS), "on-triple-click-right"},
-      {std::make_pair(8, GdkEventType::GDK_BUTTON_PRESS), "on-click-backward"},
-      {std::make_pair(8, GdkEventType::GDK_BUTTON_RELEASE), "on-click-backward-release"},
-      {std::make_pair(8, GdkEventType::GDK_2BUTTON_PRESS), "on-double-click-backward"},
-      {std::make_pair(8, GdkEventType::GDK_3BUTTON_PRESS), "on-triple-click-backward"},
-      {std::make_pair(9, GdkEventType::GDK_BUTTON_PRESS), "on-click-forward"},
-      {std::make_pair(9, GdkEventType::GDK_BUTTON_RELEASE), "on-click-forward-release"},
-      {std::make_pair(9, GdkEventType::GDK_2BUTTON_PRESS), "on-double-click-forward"},
-      {std::make_pair(9, GdkEventType::GDK_3BUTTON_PRESS), "on-triple-click-forward"}};
+  util::StringMap<std::string> eventActionMap_;
+  std::function<void()> updateFn_;
+  const std::chrono::milliseconds minUpdateInterval_;
+  std::chrono::steady_clock::time_point lastUpdate_;
+  bool updatePending_ = false;
+  bool paused_ = false;
+  bool hidden_ = false;
+  bool updateHeld_ = false;  // emitted while paused or hidden
+  sigc::connection updateSource_;
+  struct Event {
+    uint button;
+    GdkEventType type;
+    const char *name;  // of the config key
+  };
+  // Scanned in place: a few cache lines, where a map lookup chases a pointer per level
+  static constexpr std::array<Event, 20> eventMap_{{
+      {1, GdkEventType::GDK_BUTTON_PRESS, "on-click"},
+      {1, GdkEventType::GDK_BUTTON_RELEASE, "on-click-release"},
+      {1, GdkEventType::GDK_2BUTTON_PRESS, "on-double-click"},
+      {1, GdkEventType::GDK_3BUTTON_PRESS, "on-triple-click"},
+      {2, GdkEventType::GDK_BUTTON_PRESS, "on-click-middle"},
+      {2, GdkEventType::GDK_BUTTON_RELEASE, "on-click-middle-release"},
+      {2, GdkEventType::GDK_2BUTTON_PRESS, "on-double-click-middle"},
+      {2, GdkEventType::GDK_3BUTTON_PRESS, "on-triple-click-middle"},
+      {3, GdkEventType::GDK_BUTTON_PRESS, "on-click-right"},
+      {3, GdkEventType::GDK_BUTTON_RELEASE, "on-click-right-release"},
+      {3, GdkEventType::GDK_2BUTTON_PRESS, "on-double-click-right"},
+      {3, GdkEventType::GDK_3BUTTON_PRESS, "on-triple-click-right"},
+      {8, GdkEventType::GDK_BUTTON_PRESS, "on-click-backward"},
+      {8, GdkEventType::GDK_BUTTON_RELEASE, "on-click-backward-release"},
+      {8, GdkEventType::GDK_2BUTTON_PRESS, "on-double-click-backward"},
+      {8, GdkEventType::GDK_3BUTTON_PRESS, "on-triple-click-backward"},
+      {9, GdkEventType::GDK_BUTTON_PRESS, "on-click-forward"},
+      {9, GdkEventType::GDK_BUTTON_RELEASE, "on-click-forward-release"},
+      {9, GdkEventType::GDK_2BUTTON_PRESS, "on-double-click-forward"},
+      {9, GdkEventType::GDK_3BUTTON_PRESS, "on-triple-click-forward"}}};
+  static const Event *findEvent(uint button, GdkEventType type);
 };
 
 }  // namespace waybar
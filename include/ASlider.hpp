@@ -8,12 +8,27 @@ namespace waybar {
 class ASlider : public AModule {
  public:
   ASlider(const Json::Value& config, const std::string& name, const std::string& id);
+  ASlider(const ASlider&) = delete;
+  ASlider& operator=(const ASlider&) = delete;
+  ~ASlider() override;
+  // Called once per frame at most, with the last value the scale was moved to
   virtual void onValueChanged();
 
  protected:
+  /* Shows the value of the backend. Not while the scale is dragged, where the backend lags
+   * behind, and without calling onValueChanged(): that would write the value back.
+   */
+  void setValue(double value);
+
   bool vertical_ = false;
   int min_ = 0, max_ = 100, curr_ = 50;
   Gtk::Scale scale_;
+
+ private:
+  void queueValueChanged();
+  guint value_tick_ = 0;  // the pending tick callback, 0 if there is none
+  sigc::connection value_changed_;
+  bool dragging_ = false;
 };
 
 }  // namespace waybar
\ No newline at end of file
@@ -10,6 +10,8 @@ class IModule {
   virtual auto update() -> void = 0;
   virtual operator Gtk::Widget&() = 0;
   virtual auto doAction(const std::string& name) -> void = 0;
+  // Called by the bar while it is hidden: a paused module stops polling and updating
+  virtual auto setPaused(bool paused) -> void = 0;
 };
 
 }  // namespace waybar
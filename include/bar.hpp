@@ -8,13 +8,18 @@
 #include <gtkmm/window.h>
 #include <json/json.h>
 
+#include <limits>
 #include <memory>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "AModule.hpp"
 #include "group.hpp"
 #include "util/kill_signal.hpp"
+#include "util/update_stats.hpp"
 #include "xdg-output-unstable-v1-client-protocol.h"
 
 namespace waybar {
@@ -72,8 +77,18 @@ class Bar : public sigc::trackable {
   void show();
   void hide();
   void handleSignal(int);
+  // Logs the update counts and durations of the modules
+  void logUpdateStats();
   util::KillSignalAction getOnSigusr1Action();
   util::KillSignalAction getOnSigusr2Action();
+  // The config the bar was built from, before the bar resolved parts of it
+  const Json::Value &loadedConfig() const { return loaded_config_; }
+  // Whether one of the modules holds objects of the output, see AModule::boundToOutput()
+  bool boundToOutput() const;
+  // Unmaps the bar and pauses its modules while the output is gone
+  void detachOutput();
+  // Maps it again once the output is back, output->monitor being the new one
+  void attachOutput();
 
   struct waybar_output *output;
   Json::Value config;
@@ -93,11 +108,18 @@ class Bar : public sigc::trackable {
  private:
   void onMap(GdkEventAny *);
   auto setupWidgets() -> void;
-  void getModules(const Factory &, const std::string &, waybar::Group *);
+  // The modules of pos with an index in [first, last), all of them by default
+  void getModules(const Factory &, const std::string &, waybar::Group * = nullptr,
+                  Json::ArrayIndex first = 0,
+                  Json::ArrayIndex last = std::numeric_limits<Json::ArrayIndex>::max());
   void setupAltFormatKeyForModule(const std::string &module_name);
   void setupAltFormatKeyForModuleList(const char *module_list_name);
   void setMode(const bar_mode &);
+  // Hidden bars don't poll: modules are paused while the mode isn't visible
+  void setModulesPaused(bool paused);
   void setPassThrough(bool passthrough);
+  // After GTK's own update, which only knows of the background-color of the window
+  void setOpaqueRegion();
   void setPosition(Gtk::PositionType position);
   void onConfigure(GdkEventConfigure *ev);
   void configureGlobalOffset(int width, int height);
@@ -110,6 +132,11 @@ class Bar : public sigc::trackable {
   struct bar_margins margins_;
   uint32_t width_, height_;
   bool passthrough_;
+  // The "opaque" option, GTK decides when it isn't set
+  std::optional<bool> opaque_;
+  bool modules_paused_ = false;
+  sigc::connection geometry_connection_;
+  const Json::Value loaded_config_;
 
   Gtk::Box left_;
   Gtk::Box center_;
@@ -123,6 +150,9 @@ class Bar : public sigc::trackable {
   std::unique_ptr<BarIpcClient> _ipc_client;
 #endif
   std::vector<std::shared_ptr<waybar::AModule>> modules_all_;
+  std::vector<std::pair<std::string, std::shared_ptr<util::UpdateStats>>> update_stats_;
+  // The modules refreshed by each SIGRTMIN+N, ANY_SIGNAL for the ones that want them all
+  std::unordered_map<int, std::vector<AModule*>> signal_modules_;
 
   waybar::util::KillSignalAction onSigusr1 = util::SIGNALACTION_DEFAULT_SIGUSR1;
   waybar::util::KillSignalAction onSigusr2 = util::SIGNALACTION_DEFAULT_SIGUSR2;
@@ -5,6 +5,8 @@
 #include <gdk/gdkwayland.h>
 #include <wayland-client.h>
 
+#include <chrono>
+
 #include "bar.hpp"
 #include "config.hpp"
 #include "util/css_reload_helper.hpp"
@@ -12,6 +14,7 @@
 
 struct zwp_idle_inhibitor_v1;
 struct zwp_idle_inhibit_manager_v1;
+struct zwlr_screencopy_manager_v1;
 
 namespace waybar {
 
@@ -20,6 +23,16 @@ class Client {
   static Client *inst();
   int main(int argc, char *argv[]);
   void reset();
+  /* Loads the config and style again without leaving the main loop: the bars whose config
+   * didn't change are kept as they are, the others are built before the old ones go, so that
+   * the backends they share stay up. False if the config can't be loaded, the running one stays.
+   */
+  bool reload();
+  /* Gives the memory freed since startup back to the kernel, a moment after a bar is first
+   * mapped: once for all of the bars mapped meanwhile.
+   */
+  void trimMemorySoon();
+  void logMemory(const char *when);
 
   Glib::RefPtr<Gtk::Application> gtk_app;
   Glib::RefPtr<Gdk::Display> gdk_display;
@@ -27,18 +40,22 @@ class Client {
   struct wl_registry *registry = nullptr;
   struct zxdg_output_manager_v1 *xdg_output_manager = nullptr;
   struct zwp_idle_inhibit_manager_v1 *idle_inhibit_manager = nullptr;
+  struct zwlr_screencopy_manager_v1 *screencopy_manager = nullptr;
+  struct wl_shm *shm = nullptr;
   std::vector<std::unique_ptr<Bar>> bars;
   Config config;
   std::string bar_id;
+  // When main() started, for the startup timings
+  std::chrono::steady_clock::time_point started;
 
  private:
   Client() = default;
   const std::string getStyle(const std::string &style, std::optional<Appearance> appearance);
   void bindInterfaces();
   void handleOutput(struct waybar_output &output);
-  auto setupCss(const std::string &css_file) -> void;
+  auto setupCss(Glib::RefPtr<Gtk::CssProvider> &provider, const std::string &css_file) -> void;
   struct waybar_output &getOutput(void *);
-  std::vector<Json::Value> getOutputConfigs(struct waybar_output &output);
+  std::vector<const Json::Value *> getOutputConfigs(struct waybar_output &output);
 
   static void handleGlobal(void *data, struct wl_registry *registry, uint32_t name,
                            const char *interface, uint32_t version);
@@ -49,15 +66,37 @@ class Client {
   void handleMonitorAdded(Glib::RefPtr<Gdk::Monitor> monitor);
   void handleMonitorRemoved(Glib::RefPtr<Gdk::Monitor> monitor);
   void handleDeferredMonitorRemoval(Glib::RefPtr<Gdk::Monitor> monitor);
+  // Moves the parked bars of the output back to it, false if it has none
+  bool restoreParkedOutput(struct waybar_output &output);
 
   Glib::RefPtr<Gtk::StyleContext> style_context_;
-  Glib::RefPtr<Gtk::CssProvider> css_provider_;
   std::unique_ptr<Portal> portal;
   std::list<struct waybar_output> outputs_;
-  std::unique_ptr<CssReloadHelper> m_cssReloadHelper;
-  std::string m_cssFile;
+  /* The bars of an output that went away, kept with it in case it comes back with the same name
+   * and identifier: undocking or a DPMS cycle then maps them again, with their modules, instead of
+   * building them anew.
+   */
+  struct ParkedOutput {
+    std::list<struct waybar_output> output;  // the one node, spliced out of outputs_ and back
+    std::vector<std::unique_ptr<Bar>> bars;
+  };
+  std::list<ParkedOutput> parked_outputs_;
+  /* One per -s, each a provider of the whole screen: GTK3 has no way to scope one to a window,
+   * so every style applies to all bars.
+   */
+  struct Style {
+    std::string opt;   // from the command line, empty for the default
+    std::string file;  // what it resolved to
+    Glib::RefPtr<Gtk::CssProvider> provider;
+    std::unique_ptr<CssReloadHelper> reload_helper;
+  };
+  std::vector<Style> styles_;
+  bool reload_style_on_change_ = false;  // of the running config
+  // From the command line, for reload()
+  std::vector<std::string> config_opts_;
   sigc::connection monitor_added_connection_;
   sigc::connection monitor_removed_connection_;
+  sigc::connection trim_connection_;
 };
 
 }  // namespace waybar
@@ -4,6 +4,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #ifndef SYSCONFDIR
 #define SYSCONFDIR "/etc"
@@ -25,11 +26,22 @@ class Config {
 
   Config() = default;
 
-  void load(const std::string &config);
+  /* With cached, the resolved config is kept in $XDG_CACHE_HOME/waybar and read back from there
+   * while none of the files, directories and variables it was looked up in has changed.
+   */
+  void load(const std::string &config, bool cached = false);
+  /* Several configs in one: the bars of each, in order, as one multi-bar config. A single one
+   * is loaded as it is, none is the default config.
+   */
+  void load(const std::vector<std::string> &configs, bool cached = false);
 
   Json::Value &getConfig() { return config_; }
+  // The config files loaded, one per config in load order
+  const std::vector<std::string> &files() const { return config_files_; }
 
-  std::vector<Json::Value> getOutputConfigs(const std::string &name, const std::string &identifier);
+  // The bar configs for the output, valid until the next load()
+  std::vector<const Json::Value *> getOutputConfigs(const std::string &name,
+                                                    const std::string &identifier);
 
  private:
   void setupConfig(Json::Value &dst, const std::string &config_file, int depth);
@@ -38,7 +50,7 @@ class Config {
   static std::vector<std::string> findIncludePath(
       const std::string &name, const std::vector<std::string> &dirs = CONFIG_DIRS);
 
-  std::string config_file_;
+  std::vector<std::string> config_files_;
 
   Json::Value config_;
 };
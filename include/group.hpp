@@ -4,6 +4,9 @@
 #include <gtkmm/widget.h>
 #include <json/json.h>
 
+#include <functional>
+#include <vector>
+
 #include "AModule.hpp"
 #include "gtkmm/revealer.h"
 
@@ -12,12 +15,18 @@ namespace waybar {
 class Group : public AModule {
  public:
   Group(const std::string &, const std::string &, const Json::Value &, bool);
-  ~Group() override = default;
+  ~Group() override;
   auto update() -> void override;
+  auto setHidden(bool hidden) -> void override;
   operator Gtk::Widget &() override;
 
   virtual Gtk::Box &getBox();
   void addWidget(Gtk::Widget &widget);
+  // Adds the widget of the module, whose updates wait while it is hidden in the closed drawer
+  void addModule(AModule &module);
+  // A lazy drawer creates its hidden widgets with build once it opens, only the first is added
+  bool isLazy() const { return lazy_; }
+  void setBuilder(std::function<void()> build) { build_ = std::move(build); }
 
  protected:
   Gtk::Box box;
@@ -32,6 +41,24 @@ class Group : public AModule {
   bool handleToggle(GdkEventButton *const &ev) override;
   void show_group();
   void hide_group();
+
+ private:
+  void updateHidden();
+
+  bool lazy_ = false;
+  std::function<void()> build_;
+  bool revealed_ = false;
+  bool hidden_ = false;  // inside a closed drawer itself
+  /* The pointer crossing the bar, or the gaps between the widgets of the group, shouldn't open
+   * and close it on the way: the drawer opens after resting on it for reveal_delay_ and closes
+   * hide_delay_ after leaving it.
+   */
+  unsigned reveal_delay_ = 0;
+  unsigned hide_delay_ = 0;
+  sigc::connection reveal_timer_;
+  sigc::connection hide_timer_;
+  std::vector<AModule *> modules_;
+  std::vector<AModule *> drawer_modules_;
 };
 
 }  // namespace waybar
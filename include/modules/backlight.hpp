@@ -9,6 +9,7 @@
 #include "ALabel.hpp"
 #include "util/backlight_backend.hpp"
 #include "util/json.hpp"
+#include "util/scroll_accumulator.hpp"
 
 struct udev;
 struct udev_device;
@@ -18,15 +19,20 @@ namespace waybar::modules {
 class Backlight : public ALabel {
  public:
   Backlight(const std::string &, const Json::Value &);
-  virtual ~Backlight() = default;
+  virtual ~Backlight();
   auto update() -> void override;
 
   bool handleScroll(GdkEventScroll *e) override;
+  void applyScroll(int steps);
 
   const std::string preferred_device_;
 
   std::string previous_format_;
+  // What was shown, to skip updates that change nothing
+  std::optional<util::BacklightDevice> previous_best_;
 
-  util::BacklightBackend backend;
+  std::shared_ptr<util::BacklightBackend> backend;
+  int subscription_;
+  util::ScrollAccumulator scroll_;
 };
 }  // namespace waybar::modules
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
 
 #include "ASlider.hpp"
 #include "util/backlight_backend.hpp"
@@ -10,7 +11,7 @@ namespace waybar::modules {
 class BacklightSlider : public ASlider {
  public:
   BacklightSlider(const std::string&, const Json::Value&);
-  virtual ~BacklightSlider() = default;
+  virtual ~BacklightSlider();
 
   void update() override;
   void onValueChanged() override;
@@ -18,7 +19,8 @@ class BacklightSlider : public ASlider {
  private:
   std::chrono::milliseconds interval_;
   std::string preferred_device_;
-  util::BacklightBackend backend;
+  std::shared_ptr<util::BacklightBackend> backend;
+  int subscription_;
 };
 
 }  // namespace waybar::modules
\ No newline at end of file
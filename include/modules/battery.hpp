@@ -3,9 +3,6 @@
 #include <fmt/format.h>
 
 #include <filesystem>
-#if defined(__linux__)
-#include <sys/inotify.h>
-#endif
 #include <sys/poll.h>
 
 #include <algorithm>
@@ -15,7 +12,11 @@
 
 #include "ALabel.hpp"
 #include "bar.hpp"
+#include "util/proc_file.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 #include "util/sleeper_thread.hpp"
+#include "util/style_classes.hpp"
 #include "util/udev_deleter.hpp"
 
 namespace waybar::modules {
@@ -27,34 +28,49 @@ class Battery : public ALabel {
   Battery(const std::string&, const waybar::Bar&, const Json::Value&);
   virtual ~Battery();
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
   static inline const fs::path data_dir_ = "/sys/class/power_supply/";
 
   void refreshBatteries();
   void worker();
+#if defined(__linux__)
+  void startPolling(std::chrono::milliseconds period);  // 0 stops
+  // Keeps the properties of a change event; false if the event needs a refresh of the batteries
+  bool handleEvent();
+  void adjustPolling(const std::string& status, float time_remaining, uint8_t capacity);
+#endif
   const std::string getAdapterStatus(uint8_t capacity) const;
-  std::tuple<uint8_t, float, std::string, float, uint16_t, float> getInfos();
+  // capacity, time remaining, status, power, cycles, health
+  using Infos = std::tuple<uint8_t, float, std::string, float, uint16_t, float>;
+  Infos getInfos();
   const std::string formatTimeRemaining(float hoursRemaining);
   void setBarClass(std::string&);
   void processEvents(std::string& state, std::string& status, uint8_t capacity);
 
-  std::map<fs::path, int> batteries_;
+  // battery directory to its uevent file
+  std::map<fs::path, std::unique_ptr<util::ProcFile>> batteries_;
   std::unique_ptr<udev, util::UdevDeleter> udev_;
-  std::array<pollfd, 1> poll_fds_;
+  std::array<pollfd, 2> poll_fds_;  // udev, and the stop fd of the thread
   std::unique_ptr<udev_monitor, util::UdevMonitorDeleter> mon_;
   fs::path adapter_;
-  int battery_watch_fd_;
+  std::unique_ptr<util::ProcFile> adapter_uevent_;
+  // supply directory to the uevent text of its last change event, guarded by battery_list_mutex_
+  std::map<fs::path, std::string> eventProps_;
   std::mutex battery_list_mutex_;
-  std::string old_status_;
+  util::StyleClasses status_class_{label_};
   std::string last_event_;
   bool warnFirstTime_{true};
   bool weightedAverage_{true};
+  bool eventDriven_{false};
+  bool showsTime_{false};
+  std::chrono::milliseconds pollPeriod_{0};
+  std::shared_ptr<util::SharedSample<Infos>> infos_;
   const Bar& bar_;
 
-  util::SleeperThread thread_;
   util::SleeperThread thread_battery_update_;
-  util::SleeperThread thread_timer_;
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -45,10 +45,11 @@ class Bluetooth : public ALabel {
 
  public:
   Bluetooth(const std::string&, const Json::Value&);
-  virtual ~Bluetooth() = default;
+  virtual ~Bluetooth();
   auto update() -> void override;
 
  private:
+  static auto onManagerReady(GObject*, GAsyncResult*, gpointer) -> void;
   static auto onObjectAdded(GDBusObjectManager*, GDBusObject*, gpointer) -> void;
   static auto onObjectRemoved(GDBusObjectManager*, GDBusObject*, gpointer) -> void;
 
@@ -58,6 +59,14 @@ class Bluetooth : public ALabel {
                                                 GDBusProxy*, GVariant*, const gchar* const*,
                                                 gpointer) -> void;
 
+  /* Apply one changed property to the cached info, whether it is one the module shows and its
+   * value changed. Properties nothing shows (RSSI, UUIDs, ManufacturerData...) are dropped.
+   */
+  static auto applyDeviceProperty(DeviceInfo&, const gchar*, GVariant*) -> bool;
+  static auto applyControllerProperty(ControllerInfo&, const gchar*, GVariant*) -> bool;
+
+  auto connectedDevice(const std::string& path) -> std::vector<DeviceInfo>::iterator;
+
   auto getDeviceBatteryPercentage(GDBusObject*) -> std::optional<unsigned char>;
   auto getDeviceProperties(GDBusObject*, DeviceInfo&) -> bool;
   auto getControllerProperties(GDBusObject*, ControllerInfo&) -> bool;
@@ -69,7 +78,10 @@ class Bluetooth : public ALabel {
 #ifdef WANT_RFKILL
   util::Rfkill rfkill_;
 #endif
-  const std::unique_ptr<GDBusObjectManager, void (*)(GDBusObjectManager*)> manager_;
+  std::unique_ptr<GDBusObjectManager, void (*)(gpointer)> manager_;
+  const std::unique_ptr<GCancellable, void (*)(gpointer)> cancellable_;
+  // The object manager is being created
+  bool loading_ = true;
 
   std::string state_;
   std::optional<ControllerInfo> cur_controller_;
@@ -14,15 +14,20 @@ class CavaGLSL final : public AModule, public Gtk::GLArea {
 
  private:
   std::shared_ptr<CavaBackend> backend_;
+  std::shared_ptr<CavaBackend::Frames> frames_;
   struct ::cava::config_params prm_;
   int frame_counter{0};
   bool silence_{false};
   bool hide_on_silence_{false};
+  // While silent: looks for frames from a timeout instead of the frame clock
+  sigc::connection idle_check_;
   // Cava method
-  auto onUpdate(const ::cava::audio_raw& input) -> void;
+  auto onTick(const Glib::RefPtr<Gdk::FrameClock>& clock) -> bool;
+  auto onIdleCheck() -> bool;
+  // Shows the frame picked up, true if it is a silent one
+  auto onFrame() -> bool;
+  auto onUpdate() -> void;
   auto onSilence() -> void;
-  // Member variable to store the shared pointer
-  std::shared_ptr<::cava::audio_raw> m_data_;
   GLuint shaderProgram_;
   // OpenGL variables
   GLuint fbo_;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "ALabel.hpp"
 #include "cava_backend.hpp"
 
@@ -13,14 +15,24 @@ class Cava final : public ALabel, public sigc::trackable {
 
  private:
   std::shared_ptr<CavaBackend> backend_;
-  // Text to display
-  Glib::ustring label_text_{""};
+  std::shared_ptr<CavaBackend::Frames> frames_;
+  // Text to display, built in place of the text shown, which is kept to spot unchanged frames
+  std::string label_text_;
+  std::string shown_text_;
+  // The icon of every char value a frame can hold
+  std::array<std::string, 256> glyphs_;
   bool silence_{false};
   bool hide_on_silence_{false};
   std::string format_silent_{""};
   int ascii_range_{0};
+  // While silent: looks for frames from a timeout instead of the frame clock
+  sigc::connection idle_check_;
   // Cava method
   void pause_resume();
+  auto onTick(const Glib::RefPtr<Gdk::FrameClock>& clock) -> bool;
+  auto onIdleCheck() -> bool;
+  // Shows the frame picked up, true if it is a silent one
+  auto onFrame() -> bool;
   auto onUpdate(const std::string& input) -> void;
   auto onSilence() -> void;
   // ModuleActionMap
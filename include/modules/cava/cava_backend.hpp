@@ -1,9 +1,15 @@
 #pragma once
 
 #include <json/json.h>
-#include <sigc++/sigc++.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "util/sleeper_thread.hpp"
+#include "util/triple_buffer.hpp"
 
 namespace cava {
 extern "C" {
@@ -23,6 +29,17 @@ extern "C" {
 namespace waybar::modules::cava {
 using namespace std::literals::chrono_literals;
 
+// One rendered frame, as published to the frontends
+struct CavaFrame {
+  bool silence{false};
+  std::string text;         // bar heights as characters, for the raw frontend
+  std::vector<float> bars;  // for the GLSL frontend
+  std::vector<float> previous_bars;
+};
+
+/* The audio capture and FFT, shared by every cava module configured alike, typically one module
+ * config shown on several outputs. A backend lives as long as one of its modules.
+ */
 class CavaBackend final {
  public:
   static std::shared_ptr<CavaBackend> inst(const Json::Value& config);
@@ -35,13 +52,13 @@ class CavaBackend final {
   const struct ::cava::config_params* getPrm();
   std::chrono::milliseconds getFrameTimeMilsec();
 
-  // Signal accessor
-  using type_signal_update = sigc::signal<void(const std::string&)>;
-  type_signal_update signal_update();
-  using type_signal_audio_raw_update = sigc::signal<void(const ::cava::audio_raw&)>;
-  type_signal_audio_raw_update signal_audio_raw_update();
-  using type_signal_silence = sigc::signal<void()>;
-  type_signal_silence signal_silence();
+  /* Frames are published into one triple buffer per frontend, which picks up the latest one on
+   * its own schedule: frames it is too slow for are dropped instead of queued.
+   */
+  using Frames = util::TripleBuffer<CavaFrame>;
+  std::shared_ptr<Frames> subscribe();
+  // How often the input is looked at while idle, and a frontend looks for frames while silent
+  static constexpr std::chrono::milliseconds IDLE_CHECK_INTERVAL{50};
 
  private:
   CavaBackend(const Json::Value& config);
@@ -61,24 +78,30 @@ class CavaBackend final {
   // Delay to handle audio source
   std::chrono::milliseconds frame_time_milsec_{1s};
 
-  const Json::Value& config_;
+  const Json::Value config_;  // a copy, the module that created the backend may go first
   int re_paint_{0};
   bool silence_{false};
   bool silence_prev_{false};
   std::chrono::seconds suspend_silence_delay_{0};
   int sleep_counter_{0};
+  /* Silent for sleep_timer: no FFT and no frames, the out thread only looks at the input that
+   * came in, often enough for it to fit in the input buffer, until it is no longer silent.
+   */
+  std::atomic<bool> idle_{false};
   std::string output_{};
   // Methods
   void invoke();
   void execute();
   bool isSilence();
+  // Whether the input since the last look has any sound, dropping it if not
+  bool heardInput();
   void doUpdate(bool force = false);
   void loadConfig();
   void freeBackend();
+  void publish(bool silence);
 
-  // Signal
-  type_signal_update m_signal_update_;
-  type_signal_audio_raw_update m_signal_audio_raw_;
-  type_signal_silence m_signal_silence_;
+  // Frontends, the out thread and Update() both publish
+  std::mutex frames_mutex_;
+  std::vector<std::weak_ptr<Frames>> frames_;
 };
 }  // namespace waybar::modules::cava
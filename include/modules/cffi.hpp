@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "AModule.hpp"
 #include "util/command.hpp"
 #include "util/json.hpp"
+#include "util/scheduler.hpp"
 #include "util/sleeper_thread.hpp"
+#include "util/triple_buffer.hpp"
 
 namespace waybar::modules {
 
@@ -18,6 +24,12 @@ typedef struct {
   const char* waybar_version;
   GtkContainer* (*get_root_widget)(wbcffi_module*);
   void (*queue_update)(wbcffi_module*);
+  // ABI version 3 onwards
+  void (*publish)(wbcffi_module*, const void* data, size_t len);
+  uint64_t (*add_timer)(wbcffi_module*, uint32_t period_ms, void (*fn)(void* user_data),
+                        void* user_data);
+  void (*remove_timer)(wbcffi_module*, uint64_t timer);
+  void (*count)(wbcffi_module*, const char* name, int64_t value);
 } wbcffi_init_info;
 
 struct wbcffi_config_entry {
@@ -33,12 +45,31 @@ class CFFI : public AModule {
   virtual ~CFFI();
 
   virtual auto refresh(int signal) -> void override;
+  // Every signal, when the module has a wbcffi_refresh
+  auto refreshSignal() const -> int override;
   virtual auto doAction(const std::string& name) -> void override;
   virtual auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
+  // The ABI version 3 calls, from any thread of the plugin
+  void publish(const void* data, size_t len);
+  uint64_t addTimer(uint32_t period_ms, void (*fn)(void*), void* user_data);
+  void removeTimer(uint64_t timer);
+
   ///
   void* cffi_instance_ = nullptr;
+  bool has_refresh_ = false;
+
+  // The latest publish(), handed to wbcffi_update_data on the next update
+  std::mutex publish_mutex_;  // the producer side of published_, for plugins with many threads
+  util::TripleBuffer<std::vector<uint8_t>> published_;
+  std::atomic<bool> publish_pending_{false};  // an update for it is already on its way
+
+  // Scheduler tasks of the plugin, removed with the module
+  std::mutex timers_mutex_;
+  std::vector<util::Scheduler::Id> timers_;
+  bool timers_paused_ = false;
 
   typedef void*(InitFn)(const ffi::wbcffi_init_info* init_info,
                         const ffi::wbcffi_config_entry* config_entries, size_t config_entries_len);
@@ -46,6 +77,7 @@ class CFFI : public AModule {
   typedef void(RefreshFn)(void* instance, int signal);
   typedef void(DoActionFn)(void* instance, const char* name);
   typedef void(UpdateFn)(void* instance);
+  typedef void(UpdateDataFn)(void* instance, const void* data, size_t len);
 
   // FFI hooks
   struct {
@@ -54,6 +86,7 @@ class CFFI : public AModule {
     std::function<RefreshFn> refresh = [](void*, int) {};
     std::function<DoActionFn> doAction = [](void*, const char*) {};
     std::function<UpdateFn> update = [](void*) {};
+    std::function<UpdateDataFn> updateData = [](void*, const void*, size_t) {};
   } hooks_;
 };
 
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <optional>
+#include <utility>
+
 #include "ALabel.hpp"
 #include "util/date.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -24,9 +27,14 @@ class Clock final : public ALabel {
   const std::locale m_locale_;
   // tooltip
   const std::string m_tlpFmt_;
+  enum class TlpPart { LITERAL, TZ, CALENDAR, ORDINAL };
+  // m_tlpFmt_ split on the placeholders, literal parts carry their text
+  std::vector<std::pair<TlpPart, std::string>> m_tlpParts_;
   std::string m_tlpText_{""};                 // tooltip text to print
   const Glib::RefPtr<Gtk::Label> m_tooltip_;  // tooltip as a separate Gtk::Label
+  bool m_tlpDirty_{true};                     // tooltip text is stale, rebuild on next query
   bool query_tlp_cb(int, int, bool, const Glib::RefPtr<Gtk::Tooltip>& tooltip);
+  auto update_tooltip() -> void;
   // Calendar
   const bool cldInTooltip_;  // calendar in tooltip
   /*
@@ -44,12 +52,17 @@ class Clock final : public ALabel {
   WS cldWPos_{WS::HIDDEN};             // calendar week side to print
   date::months cldCurrShift_{0};       // calendar months shift
   int cldShift_{1};                    // calendar months shift factor
-  date::year_month_day cldYearShift_;  // calendar Year mode. Cached ymd
-  std::string cldYearCached_;          // calendar Year mode. Cached calendar
-  date::year_month cldMonShift_;       // calendar Month mode. Cached ym
-  std::string cldMonCached_;           // calendar Month mode. Cached calendar
-  date::day cldBaseDay_{0};      // calendar Cached day. Is used when today is changing(midnight)
-  std::string cldText_{""};      // calendar text to print
+  // Everything the rendered calendar depends on. The shift is folded into ym, and ym is
+  // truncated to January in Year mode
+  struct CldKey {
+    date::year_month ym;
+    CldMode mode;
+    date::year_month_day today;
+    const date::time_zone* tz;
+    bool operator==(const CldKey&) const = default;
+  };
+  std::optional<CldKey> cldCachedKey_;  // key of cldText_, empty until first render
+  std::string cldText_{""};             // calendar text to print
   bool iso8601Calendar_{false};  // whether the calendar is in ISO8601
   CldMode cldMode_{CldMode::MONTH};
   auto get_calendar(const date::year_month_day& today, const date::year_month_day& ymd,
@@ -57,6 +70,10 @@ class Clock final : public ALabel {
 
   // get local time zone
   auto local_zone() -> const date::time_zone*;
+  // the zone of tzCurrIdx_, with the local one resolved at most once a minute
+  auto active_zone(date::sys_seconds now) -> const date::time_zone*;
+  const date::time_zone* localZone_{nullptr};
+  date::sys_time<std::chrono::minutes> localZoneCheckedAt_{};
 
   // time zoned time in tooltip
   const bool tzInTooltip_;                      // if need to print time zones text
@@ -64,14 +81,18 @@ class Clock final : public ALabel {
   int tzCurrIdx_;                               // current time zone index for tzList_
   std::string tzText_{""};                      // time zones text to print
   std::string tzTooltipFormat_{""};             // optional timezone tooltip format
-  util::SleeperThread thread_;
+  bool tzTextSeconds_{false};                   // the time zones format shows seconds
+  // the time, to the minute unless tzTextSeconds_, and the index tzText_ was built for
+  using TzTextKey = std::pair<date::sys_seconds, int>;
+  std::optional<TzTextKey> tzTextKey_;
+  util::PeriodicTask timer_;
 
   // ordinal date in tooltip
   const bool ordInTooltip_;
   std::string ordText_{""};
   auto get_ordinal_date(const date::year_month_day& today) -> std::string;
 
-  auto getTZtext(date::sys_seconds now) -> std::string;
+  auto update_tz_text(date::sys_seconds now) -> void;
   auto first_day_of_week() -> date::weekday;
   // Module actions
   void cldModeSwitch();
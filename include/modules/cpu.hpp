@@ -10,7 +10,9 @@
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "modules/cpu_frequency.hpp"
+#include "modules/cpu_usage.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
@@ -19,11 +21,13 @@ class Cpu : public ALabel {
   Cpu(const std::string&, const Json::Value&);
   virtual ~Cpu() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
-  std::vector<std::tuple<size_t, size_t>> prev_times_;
+  std::shared_ptr<util::SharedSample<CpuUsage::Sample>> usage_;
+  std::shared_ptr<util::SharedSample<CpuFrequency::Sample>> frequency_;
 
-  util::SleeperThread thread_;
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -10,7 +10,8 @@
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 
 namespace waybar::modules {
 
@@ -19,14 +20,20 @@ class CpuFrequency : public ALabel {
   CpuFrequency(const std::string&, const Json::Value&);
   virtual ~CpuFrequency() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
   // This is a static member because it is also used by the cpu module.
   static std::tuple<float, float, float> getCpuFrequency();
 
+  using Sample = std::tuple<float, float, float>;
+  static std::shared_ptr<util::SharedSample<Sample>> sharedSample(std::chrono::milliseconds);
+  static Sample readSample(const Sample*) { return getCpuFrequency(); }
+
  private:
   static std::vector<float> parseCpuFrequencies();
 
-  util::SleeperThread thread_;
+  std::shared_ptr<util::SharedSample<Sample>> sample_;
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
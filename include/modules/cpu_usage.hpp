@@ -4,13 +4,15 @@
 
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 
 namespace waybar::modules {
 
@@ -19,17 +21,36 @@ class CpuUsage : public ALabel {
   CpuUsage(const std::string&, const Json::Value&);
   virtual ~CpuUsage() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
+
+  // Cumulated idle and total time of all cores (index 0), then of each core; 0 when offline
+  struct Times {
+    std::vector<size_t> idle;
+    std::vector<size_t> total;
+  };
 
   // This is a static member because it is also used by the cpu module.
-  static std::tuple<std::vector<uint16_t>, std::string> getCpuUsage(
-      std::vector<std::tuple<size_t, size_t>>&);
+  static std::tuple<std::vector<uint16_t>, std::string> getCpuUsage(Times&);
+  // Whether format uses {usageN} or {iconN}; the per-core arguments are only built if so
+  static bool hasPerCoreArgs(const std::string& format);
+
+  // Usage computed since the previous sample, shared by the cpu and cpu_usage modules.
+  struct Sample {
+    // Baseline of the next sample, handed on and updated in place rather than copied
+    std::shared_ptr<Times> times;
+    std::vector<uint16_t> usage;
+    std::string tooltip;
+  };
+  static std::shared_ptr<util::SharedSample<Sample>> sharedSample(std::chrono::milliseconds);
+  static Sample readSample(const Sample* previous);
 
  private:
-  static std::vector<std::tuple<size_t, size_t>> parseCpuinfo();
+  // Fills times, reusing its storage
+  static void parseCpuinfo(Times& times);
 
-  std::vector<std::tuple<size_t, size_t>> prev_times_;
+  std::shared_ptr<util::SharedSample<Sample>> sample_;
 
-  util::SleeperThread thread_;
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
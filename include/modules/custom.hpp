@@ -3,12 +3,19 @@
 #include <fmt/format.h>
 
 #include <csignal>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "ALabel.hpp"
 #include "util/command.hpp"
-#include "util/json.hpp"
+#include "util/file_watch.hpp"
+#include "util/json_scanner.hpp"
+#include "util/shared_sample.hpp"
 #include "util/sleeper_thread.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules {
 
@@ -17,14 +24,34 @@ class Custom : public ALabel {
   Custom(const std::string&, const std::string&, const Json::Value&, const std::string&);
   virtual ~Custom();
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
   void refresh(int /*signal*/) override;
 
  private:
   void delayWorker();
   void continuousWorker();
   void waitingWorker();
+  // "watch": runs exec, or reads the file, whenever the file changes
+  void watchWorker();
+  util::command::res readWatched();
+  util::command::res runExec();  // exec-if, then exec if it passed
+  // exec-persistent: one reply of the co-process per tick, restarted when it goes away
+  util::command::res tickCoprocess();
+  int stopCoprocess();  // the exit code to report, never 0
+  // A line of return-type json output, ready to be shown
+  struct JsonOutput {
+    std::string text;
+    std::string alt;
+    std::string tooltip;
+    std::vector<std::string> classes;
+    int percentage = 0;
+  };
+
   void parseOutputRaw();
   void parseOutputJson();
+  JsonOutput parseJsonLine(std::string_view line);
+  void applyJson(JsonOutput&& json);
+  bool takeStreamed();  // applies the latest streamed output, false if there is none to show
   void handleEvent();
   bool handleScroll(GdkEventScroll* e) override;
   bool handleToggle(GdkEventButton* const& e) override;
@@ -35,15 +62,38 @@ class Custom : public ALabel {
   std::string id_;
   std::string alt_;
   std::string tooltip_;
+  // the part of a watched file that is read
+  static constexpr size_t MAX_WATCHED_SIZE = 64 * 1024;
+
   const bool tooltip_format_enabled_;
+  // bounds the run time of exec and exec-if, zero for no bound
+  const std::chrono::milliseconds exec_timeout_;
+  const bool persistent_;
   std::vector<std::string> class_;
+  util::StyleClasses output_classes_{label_};
   int percentage_;
   FILE* fp_;
   int pid_;
+  int coproc_in_;               // stdin of the co-process
+  std::string pending_;         // the output of exec past the last line read
   util::command::res output_;
-  util::JsonParser parser_;
+  // the exec of identical modules on other outputs
+  std::shared_ptr<util::SharedSample<util::command::res>> shared_exec_;
+  util::JsonScanner scanner_{"custom module output"};
+  /* A continuous exec with return-type json is parsed on the worker thread. Only the latest line
+   * is kept for the next update(), the ones that come before it runs are dropped.
+   */
+  bool streaming_ = false;
+  struct {
+    std::mutex mutex;
+    int exit_code = 0;
+    bool shown = false;  // a line came since the last (re)start
+    bool fresh = false;  // not taken by update() yet
+    JsonOutput json;
+  } streamed_;
 
   util::SleeperThread thread_;
+  std::unique_ptr<util::FileWatch> watch_;  // after thread_, which it wakes up
 };
 
 }  // namespace waybar::modules
@@ -3,24 +3,29 @@
 #include <fmt/format.h>
 #include <sys/statvfs.h>
 
-#include <fstream>
+#include <memory>
+#include <optional>
 
 #include "ALabel.hpp"
 #include "util/format.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules {
 
+struct DiskMount;
+
 class Disk : public ALabel {
  public:
   Disk(const std::string&, const Json::Value&);
-  virtual ~Disk() = default;
+  virtual ~Disk();
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
-  util::SleeperThread thread_;
+  util::PeriodicTask timer_;
   std::string path_;
   std::string unit_;
+  std::shared_ptr<DiskMount> mount_;  // sampled in the background, shared by path
 
   float calc_specific_divisor(const std::string divisor);
 };
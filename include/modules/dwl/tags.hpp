@@ -14,9 +14,11 @@ class Tags : public waybar::AModule {
  public:
   Tags(const std::string &, const waybar::Bar &, const Json::Value &);
   virtual ~Tags();
+  auto boundToOutput() const -> bool override { return true; }
 
   // Handlers for wayland events
   void handle_view_tags(uint32_t tag, uint32_t state, uint32_t clients, uint32_t focused);
+  void handle_frame();
 
   void handle_primary_clicked(uint32_t tag);
   bool handle_button_press(GdkEventButton *event_button, uint32_t tag);
@@ -29,6 +31,15 @@ class Tags : public waybar::AModule {
   Gtk::Box box_;
   std::vector<Gtk::Button> buttons_;
   struct zdwl_ipc_output_v2 *output_status_;
+
+  // Tag state collected until the frame event, and the state the buttons show
+  uint32_t occupied_tags_ = 0;
+  uint32_t focused_tags_ = 0;
+  uint32_t urgent_tags_ = 0;
+  uint32_t shown_occupied_tags_ = 0;
+  uint32_t shown_focused_tags_ = 0;
+  uint32_t shown_urgent_tags_ = 0;
+  bool shown_ = false;
 };
 
 } /* namespace waybar::modules::dwl */
@@ -8,6 +8,7 @@
 #include "bar.hpp"
 #include "dwl-ipc-unstable-v2-client-protocol.h"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::dwl {
 
@@ -15,6 +16,7 @@ class Window : public AAppIconLabel, public sigc::trackable {
  public:
   Window(const std::string &, const waybar::Bar &, const Json::Value &);
   ~Window();
+  auto boundToOutput() const -> bool override { return true; }
 
   void handle_layout(const uint32_t layout);
   void handle_title(const char *title);
@@ -26,11 +28,15 @@ class Window : public AAppIconLabel, public sigc::trackable {
 
  private:
   const Bar &bar_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
 
   std::string title_;
   std::string appid_;
   std::string layout_symbol_;
   uint32_t layout_;
+  // Set when a value changed since the last frame
+  bool label_dirty_ = true;
+  bool icon_dirty_ = true;
 
   struct zdwl_ipc_output_v2 *output_status_;
 };
@@ -12,6 +12,7 @@
 #include "AModule.hpp"
 #include "bar.hpp"
 #include "ext-workspace-v1-client-protocol.h"
+#include "util/string_map.hpp"
 
 namespace waybar::modules::ext {
 
@@ -36,11 +37,12 @@ class WorkspaceManager final : public AModule {
   // wl requests
   void commit() const;
 
+  // format-icons, read once per configuration
+  const util::StringMap<std::string> &icon_map() const { return icon_map_; }
+
  private:
   void update() override;
-  bool has_button(const Gtk::Button *button);
   void sort_workspaces();
-  void clear_buttons();
   void update_buttons();
 
   static uint32_t group_global_id;
@@ -58,6 +60,9 @@ class WorkspaceManager final : public AModule {
   ext_workspace_manager_v1 *ext_manager_ = nullptr;
   std::vector<std::unique_ptr<WorkspaceGroup>> groups_;
   std::vector<std::unique_ptr<Workspace>> workspaces_;
+  // The buttons in box_, in their order there
+  std::vector<Gtk::Button *> shown_buttons_;
+  util::StringMap<std::string> icon_map_;
 
   bool needs_sorting_ = false;
 };
@@ -99,7 +104,9 @@ class Workspace {
   std::string &name() { return name_; }
   std::vector<u_int32_t> &coordinates() { return coordinates_; }
   Gtk::Button &button() { return button_; }
+  // Only restyles and relabels the button after a change
   void update();
+  void set_needs_update() { needs_update_ = true; }
 
   // wl events
   void handle_id(const std::string &id);
@@ -128,7 +135,7 @@ class Workspace {
   bool ignore_hidden_ = true;
   std::string format_;
   bool with_icon_ = false;
-  static std::map<std::string, std::string> icon_map_;
+  bool needs_update_ = true;
   std::string on_click_action_;
   std::string on_click_middle_action_;
   std::string on_click_right_action_;
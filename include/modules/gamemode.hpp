@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "ALabel.hpp"
 #include "giomm/dbusconnection.h"
@@ -35,8 +36,10 @@ class Gamemode : public AModule {
                           const Glib::ustring &sender_name, const Glib::ustring &object_path,
                           const Glib::ustring &interface_name, const Glib::ustring &signal_name,
                           const Glib::VariantContainerBase &parameters);
-  void notify_cb(const Glib::ustring &sender_name, const Glib::ustring &signal_name,
-                 const Glib::VariantContainerBase &arguments);
+  void propertiesChanged_cb(const Gio::DBus::Proxy::MapChangedProperties &changed,
+                            const std::vector<Glib::ustring> &invalidated);
+  void proxyCreated_cb(Glib::RefPtr<Gio::AsyncResult> &result);
+  void getConn_cb(Glib::RefPtr<Gio::AsyncResult> &result);
 
   void getData();
   bool handleToggle(GdkEventButton *const &) override;
@@ -59,7 +62,6 @@ class Gamemode : public AModule {
 
   const std::string dbus_name = "com.feralinteractive.GameMode";
   const std::string dbus_obj_path = "/com/feralinteractive/GameMode";
-  const std::string dbus_interface = "org.freedesktop.DBus.Properties";
   const std::string dbus_get_interface = "com.feralinteractive.GameMode";
 
   uint gameCount = 0;
@@ -67,11 +69,11 @@ class Gamemode : public AModule {
   std::string lastStatus;
   bool showAltText = false;
 
-  guint login1_id;
+  guint login1_id = 0;
   Glib::RefPtr<Gio::DBus::Proxy> gamemode_proxy;
   Glib::RefPtr<Gio::DBus::Connection> system_connection;
-  bool gamemodeRunning;
-  guint gamemodeWatcher_id;
+  bool gamemodeRunning = false;
+  guint gamemodeWatcher_id = 0;
 };
 
 }  // namespace waybar::modules
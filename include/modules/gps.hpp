@@ -1,6 +1,11 @@
 #pragma once
 
 #include <fmt/format.h>
+#if (FMT_VERSION >= 80000)
+#include <fmt/args.h>
+#else
+#include <fmt/core.h>
+#endif
 #include <sys/statvfs.h>
 
 #ifdef WANT_RFKILL
@@ -9,6 +14,10 @@
 
 #include <gps.h>
 
+#include <chrono>
+#include <mutex>
+#include <string>
+
 #include "ALabel.hpp"
 #include "util/sleeper_thread.hpp"
 
@@ -24,15 +33,35 @@ class Gps : public ALabel {
 #ifdef WANT_RFKILL
   util::Rfkill rfkill_;
 #endif
+  // What the formats use out of a report
+  struct Fix {
+    gps_fix_t fix{};
+    int satellites_used = 0;
+    int satellites_visible = 0;
+  };
+
   const std::string getFixModeName() const;
-  const std::string getFixModeString() const;
+  const std::string getFixModeString(const Fix& fix) const;
 
-  const std::string getFixStatusString() const;
+  const std::string getFixStatusString(const Fix& fix) const;
 
-  util::SleeperThread thread_, gps_thread_;
-  gps_data_t gps_data_;
+  auto formatArgs(const Fix& fix) const -> fmt::dynamic_format_arg_store<fmt::format_context>;
+  // From the reader thread: whether the report changes what the module shows
+  auto changesText(const Fix& fix) -> bool;
+
+  util::SleeperThread gps_thread_;
+  gps_data_t gps_data_;  // only touched by the reader thread
+  Fix shown_;            // the fix of the last update
   std::string state_;
 
+  std::mutex mutex_;  // guards the members below, shared with the reader thread
+  Fix fix_;           // the last report
+  // The formats of the last update and the text they gave, to compare a new report against
+  std::string format_shown_;
+  std::string tooltip_format_shown_;
+  std::string text_shown_;
+  std::chrono::steady_clock::time_point emitted_at_;
+
   bool hideDisconnected = true;
   bool hideNoFix = false;
 };
@@ -1,18 +1,32 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
-#include <list>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
+#include "modules/hyprland/window_state.hpp"
 #include "util/json.hpp"
+#include "util/mpsc_ring.hpp"
 
 namespace waybar::modules::hyprland {
 
 class EventHandler {
  public:
+  // Called on a worker thread of the IPC, with the handler's events in the order Hyprland sent
+  // them, one call at a time
   virtual void onEvent(const std::string& ev) = 0;
   virtual ~EventHandler() = default;
 };
@@ -28,25 +42,122 @@ class IPC {
   static IPC& inst();
 
   void registerForIPC(const std::string& ev, EventHandler* ev_handler);
+  /// No onEvent call of the handler runs anymore once it returns, but the one calling it, the
+  /// events still queued for it are dropped.
   void unregisterForIPC(EventHandler* handler);
 
   static std::string getSocket1Reply(const std::string& rq);
+  /// Replies for state queries ("clients", "workspaces", ...) are served from a shared snapshot
+  /// that stays valid until the next socket2 event, so every module on every bar reacting to the
+  /// same event shares a single fetch.
   Json::Value getSocket1JsonReply(const std::string& rq);
+  /// Answers several queries with a single `[[BATCH]]` round-trip, replies come back in order.
+  /// Queries that have a valid snapshot are served from it and left out of the batch.
+  std::vector<Json::Value> getSocket1JsonReplies(const std::vector<std::string>& rqs);
+  void invalidateSnapshots() { ++stateGeneration_; }
+  /// Calls read(const WindowState&) with the window state, loaded again first if the events left
+  /// it stale. The events are still applied while it is loaded, the next one waits for read to
+  /// return.
+  template <typename Read>
+  auto readWindowState(Read&& read) {
+    std::lock_guard reload(windowReloadMutex_);
+    std::unique_lock lock(windowStateMutex_);
+    if (windowState_.stale()) {
+      lock.unlock();
+      loadWindowState();
+      lock.lock();
+    }
+    return read(std::as_const(windowState_));
+  }
   static std::filesystem::path getSocketFolder(const char* instanceSig);
 
  protected:
   static std::filesystem::path socketFolder_;
 
+  void parseIPC(const std::string&);
+
  private:
+  /* The events of one handler: the socket2 thread queues them without waiting for anything, and
+   * a worker of the pool passes them to onEvent. One worker at a time drains a handler, so that
+   * it gets its events in order. A handler blocking on its queries only holds up its own events,
+   * and one worker.
+   */
+  struct Subscriber {
+    static constexpr size_t QUEUE_CAPACITY = 64;
+
+    explicit Subscriber(EventHandler* handler) : handler(handler) {}
+
+    EventHandler* const handler;
+    util::MpscRing<std::string> queue{QUEUE_CAPACITY};
+    std::atomic<uint64_t> pushed = 0;
+    std::atomic<uint64_t> handled = 0;
+    std::atomic<bool> scheduled = false;  // waiting for a worker, or being drained
+    std::atomic<bool> stopped = false;
+    std::mutex mutex;  // guards runner
+    std::condition_variable idle;
+    std::thread::id runner;  // the worker draining it, none when idle
+  };
+
+  // The workers shared by the handlers of all the modules
+  class HandlerPool {
+   public:
+    HandlerPool();
+    ~HandlerPool();  // once the onEvent calls in progress return
+
+    void push(const std::shared_ptr<Subscriber>& subscriber, const std::string& ev);
+    // No onEvent call of the subscriber runs anymore once it returns, but the one calling it
+    static void stop(Subscriber& subscriber);
+
+   private:
+    static constexpr unsigned MAX_WORKERS = 4;
+    static constexpr size_t BATCH = 16;  // events of a subscriber per turn, then the next one's
+
+    void schedule(std::shared_ptr<Subscriber> subscriber);
+    void run();
+    void drain(const std::shared_ptr<Subscriber>& subscriber);
+
+    std::mutex mutex_;  // guards the two below
+    std::condition_variable ready_;
+    std::deque<std::shared_ptr<Subscriber>> runnable_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+  };
+
+  struct Snapshot {
+    std::mutex mutex;  // held while refreshing, so concurrent callers wait for one fetch
+    bool valid = false;
+    uint64_t generation = 0;
+    std::chrono::steady_clock::time_point fetchedAt;
+    Json::Value value;
+  };
+
   void socketListener();
-  void parseIPC(const std::string&);
+  Json::Value fetchJson(const std::string& rq);
+  Snapshot& snapshotFor(const std::string& rq);
+  bool isSnapshotFresh(const Snapshot& snapshot) const;
+  static bool isSnapshotQuery(const std::string& rq);
+  static const std::string& getSocket1Path();
+  void loadWindowState();
 
   std::thread ipcThread_;
-  std::mutex callbackMutex_;
+  // queuing only takes a shared lock, so registering a handler does not stall event delivery
+  std::shared_mutex callbackMutex_;
   util::JsonParser parser_;
-  std::list<std::pair<std::string, EventHandler*>> callbacks_;
-  int socketfd_;  // the hyprland socket file descriptor
+  std::unordered_set<std::string> eventNames_;  // interned event names backing the map keys
+  std::unordered_map<EventHandler*, std::shared_ptr<Subscriber>> subscribers_;
+  std::unordered_map<std::string_view, std::vector<std::shared_ptr<Subscriber>>> callbacks_;
+  std::atomic<uint64_t> stateGeneration_ = 0;  // bumped on every socket2 event
+  std::mutex snapshotsMutex_;
+  std::unordered_map<std::string, Snapshot> snapshots_;
+  std::mutex windowReloadMutex_;  // held while loading, so concurrent readers wait for one load
+  std::mutex windowStateMutex_;  // guards the three below
+  WindowState windowState_;
+  bool windowReloading_ = false;
+  std::vector<std::string> reloadEvents_;  // applied while loading, replayed on the loaded state
+  int socketfd_ = -1;  // the hyprland socket file descriptor
   pid_t socketOwnerPid_;
   bool running_ = true;  // the ipcThread will stop running when this is false
+  // last, so that its workers are through before the state they query goes
+  HandlerPool pool_;
 };
 };  // namespace waybar::modules::hyprland
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <gtkmm/button.h>
+#include <gtkmm/eventbox.h>
+#include <gtkmm/image.h>
 #include <gtkmm/label.h>
 #include <json/value.h>
 
@@ -11,6 +13,7 @@
 #include <optional>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -18,8 +21,10 @@
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
 #include "modules/hyprland/fancy-windowcreationpayload.hpp"
+#include "modules/hyprland/thumbnail_tooltip.hpp"
 #include "util/enum.hpp"
 #include "util/regex_collection.hpp"
+#include "util/string_map.hpp"
 
 using WindowAddress = std::string;
 
@@ -30,11 +35,12 @@ class FancyWorkspace {
  public:
   explicit FancyWorkspace(const Json::Value& workspace_data, FancyWorkspaces& workspace_manager,
                           const Json::Value& clients_data = Json::Value::nullRef);
-  std::string& selectIcon(std::map<std::string, std::string>& icons_map);
+  ~FancyWorkspace();
+  std::string& selectIcon(util::StringMap<std::string>& icons_map);
   Gtk::Button& button() { return m_button; };
 
   int id() const { return m_id; };
-  std::string name() const { return m_name; };
+  const std::string& name() const { return m_name; };
   std::string output() const { return m_output; };
   bool isActive() const { return m_isActive; };
   bool isSpecial() const { return m_isSpecial; };
@@ -54,10 +60,7 @@ class FancyWorkspace {
   void setWindows(uint value) { m_windows = value; };
   void setName(std::string const& value) { m_name = value; };
   void setOutput(std::string const& value) { m_output = value; };
-  bool containsWindow(WindowAddress const& addr) const {
-    return std::ranges::any_of(m_windowMap,
-                               [&addr](const auto& window) { return window.address == addr; });
-  };
+  bool containsWindow(WindowAddress const& addr) const;
   void insertWindow(FancyWindowCreationPayload create_window_payload);
   void initializeWindowMap(const Json::Value& clients_data);
   void setActiveWindow(WindowAddress const& addr);
@@ -97,10 +100,25 @@ class FancyWorkspace {
   Gtk::Label m_labelBefore;
   Gtk::Label m_labelAfter;
   Gtk::Box m_iconBox;
-  std::vector<Gtk::Image*> m_iconImages;
+  // The icon of the windows of one app, kept across updates by icon name
+  struct WindowIcon {
+    Gtk::EventBox eventBox;
+    Gtk::Image image;
+    ThumbnailTooltip tooltip;
+    std::string firstAddress;  // the window a click focuses
+  };
+  std::map<std::string, WindowIcon> m_windowIcons;
+  std::vector<std::string> m_windowIconOrder;  // as packed in m_iconBox
+  // The icon name of each window, resolved again only when its class changes
+  struct ResolvedIcon {
+    std::string windowClass;
+    std::string iconName;
+  };
+  std::unordered_map<WindowAddress, ResolvedIcon> m_resolvedIcons;
 
   void updateTaskbar(const std::string& workspace_icon);
   void updateWindowIcons();
+  bool initWindowIcon(WindowIcon& icon, const std::string& icon_name, int icon_size);
   bool handleClick(const GdkEventButton* event_button, WindowAddress const& addr) const;
   bool shouldSkipWindow(const FancyWindowRepr& window_repr) const;
   IPC& m_ipc;
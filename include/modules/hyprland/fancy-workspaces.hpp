@@ -5,6 +5,7 @@
 #include <gtkmm/label.h>
 #include <json/value.h>
 
+#include <chrono>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -12,16 +13,23 @@
 #include <regex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "AModule.hpp"
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
+#include "modules/hyprland/hook_template.hpp"
 #include "modules/hyprland/windowcreationpayload.hpp"
 #include "modules/hyprland/fancy-workspace.hpp"
+#include "modules/hyprland/title_throttle.hpp"
+#include "modules/hyprland/window_ignore_list.hpp"
+#include "modules/hyprland/workspace_sort.hpp"
 #include "util/enum.hpp"
 #include "util/icon_loader.hpp"
+#include "util/mpsc_ring.hpp"
 #include "util/regex_collection.hpp"
+#include "util/string_map.hpp"
 #include "util/thumbnail_cache.hpp"
 
 using WindowAddress = std::string;
@@ -47,16 +55,16 @@ class FancyWorkspaces : public AModule, public EventHandler {
   auto enableTaskbar() const -> bool { return m_enableTaskbar; }
   auto taskbarWithIcon() const -> bool { return m_taskbarWithIcon; }
 
-  auto getBarOutput() const -> std::string { return m_bar.output->name; }
-  auto formatBefore() const -> std::string { return m_formatBefore; }
-  auto formatAfter() const -> std::string { return m_formatAfter; }
+  auto getBarOutput() const -> const std::string& { return m_bar.output->name; }
+  auto formatBefore() const -> const std::string& { return m_formatBefore; }
+  auto formatAfter() const -> const std::string& { return m_formatAfter; }
   auto taskbarFormatBefore() const -> std::string { return m_taskbarFormatBefore; }
   auto taskbarFormatAfter() const -> std::string { return m_taskbarFormatAfter; }
   auto taskbarIconSize() const -> int { return m_taskbarIconSize; }
   auto taskbarOrientation() const -> Gtk::Orientation { return m_taskbarOrientation; }
   auto taskbarReverseDirection() const -> bool { return m_taskbarReverseDirection; }
   auto onClickWindow() const -> std::string { return m_onClickWindow; }
-  auto getIgnoredWindows() const -> std::vector<std::regex> { return m_ignoreWindows; }
+  auto getIgnoredWindows() const -> const WindowIgnoreList& { return m_ignoreWindows; }
 
   enum class ActiveWindowPosition { NONE, FIRST, LAST };
   auto activeWindowPosition() const -> ActiveWindowPosition { return m_activeWindowPosition; }
@@ -67,11 +75,23 @@ class FancyWorkspaces : public AModule, public EventHandler {
 
   std::string getRewrite(std::string window_class, std::string window_title);
   std::string& getWindowSeparator() { return m_formatWindowSeparator; }
+  // Memoized by name, the patterns are the same for the life of the module
   bool isWorkspaceIgnored(std::string const& workspace_name);
 
+  // The workspace a window is in, kept up to date by the workspaces as they insert and close
+  // windows. Null for orphan and queued windows.
+  FancyWorkspace* windowWorkspace(WindowAddress const& addr) const;
+  void indexWindow(WindowAddress const& addr, FancyWorkspace* workspace);
+  void unindexWindow(WindowAddress const& addr, const FancyWorkspace* workspace);
+
   bool windowRewriteConfigUsesTitle() const { return m_anyWindowRewriteRuleUsesTitle; }
   const IconLoader& iconLoader() const { return m_iconLoader; }
   IPC& getIpc() { return m_ipc; }
+  /* Sends a workspace switch. With "leave" in "thumbnail-capture" the windows of the active
+   * workspace are captured first, while they still show settled, and the switch waits for that
+   * up to LEAVE_CAPTURE_TIMEOUT.
+   */
+  void switchWorkspace(const std::string& dispatch);
   
   // Helper methods for icon handling
   struct WindowInfo {
@@ -86,7 +106,21 @@ class FancyWorkspaces : public AModule, public EventHandler {
   bool isWorkspaceInActiveGroup(const std::string& workspaceName);
 
  private:
+  // An event as the IPC thread hands it to the UI thread, with the replies its handler reads
+  struct PendingEvent {
+    std::string name;
+    std::string payload;
+    std::unordered_map<std::string, Json::Value> replies;
+  };
+  static constexpr size_t EVENT_QUEUE_CAPACITY = 256;
+
+  // IPC thread: fetches the replies and queues the event, touching nothing the UI thread uses
   void onEvent(const std::string& e) override;
+  std::vector<std::string> eventQueries(const std::string& eventName) const;
+  // UI thread, from doUpdate
+  void handleEvent(const PendingEvent& event);
+  // The reply fetched along with the event being handled, queried now otherwise
+  Json::Value eventReply(const std::string& rq);
   void updateWindowCount();
   void sortSpecialCentered();
   void sortWorkspaces();
@@ -94,11 +128,44 @@ class FancyWorkspaces : public AModule, public EventHandler {
                        Json::Value const& clients_data = Json::Value::nullRef);
   
   // Project collapsing
-  std::optional<std::string> extractProjectPrefix(const std::string& workspaceName);
+  enum class ProjectLayout { PLAIN, COLLAPSED, EXPANDED };
+  // A project's workspaces on this bar's monitor and the widgets standing for them
+  struct ProjectGroup {
+    std::vector<FancyWorkspace*> workspaces;
+    bool hasActive = false;
+    bool hasWindows = false;  // Track if any workspace in group has windows
+    bool hasUrgent = false;   // Track if any workspace in group is urgent
+    bool placed = false;
+    ProjectLayout layout = ProjectLayout::PLAIN;
+    // Collapsed: [label icons...]
+    Gtk::Box* collapsedBox = nullptr;
+    Gtk::Button* collapsedLabel = nullptr;
+    Gtk::Label* collapsedClose = nullptr;
+    std::vector<Gtk::Button*> icons;
+    std::string iconsKey;  // What the icons show
+    // Expanded: [label, the workspaces' numbers and ]
+    Gtk::Box* startBox = nullptr;
+    Gtk::Label* startBracket = nullptr;
+    Gtk::Button* projectLabel = nullptr;
+    Gtk::Box* endBox = nullptr;
+    Gtk::Label* endBracket = nullptr;
+  };
+
+  // Memoized by name
+  const std::optional<std::string>& extractProjectPrefix(const std::string& workspaceName);
   std::string extractNumber(const std::string& workspaceName);
-  int countWorkspacesInProject(const std::string& prefix);
-  std::unique_ptr<Gtk::Button> createLabelButton(const std::string& text);
   void applyProjectCollapsing();
+  void layoutProjectGroup(const std::string& prefix, ProjectGroup& group);
+  void updateCollapsedGroup(const std::string& prefix, ProjectGroup& group,
+                            const std::string& displayPrefix);
+  void updateCollapsedIcons(const std::string& prefix, ProjectGroup& group);
+  void updateExpandedGroup(const std::string& prefix, ProjectGroup& group,
+                           const std::string& cleanPrefix);
+  void dropCollapsedWidgets(ProjectGroup& group);
+  void dropExpandedWidgets(ProjectGroup& group);
+  void removeEmptyProjectWorkspaces(const std::string& prefix);
+  // Reorders the box's children only if they are not in this order already
+  void reorderBox(const std::vector<Gtk::Widget*>& order);
 
   static Json::Value createMonitorWorkspaceData(std::string const& name,
                                                 std::string const& monitor);
@@ -137,6 +204,8 @@ class FancyWorkspaces : public AModule, public EventHandler {
   void onWindowMoved(std::string const& payload);
 
   void onWindowTitleEvent(std::string const& payload);
+  void updateWindowTitle(WindowAddress const& windowAddress, std::string const& windowTitle);
+  void flushWindowTitles();
   void onActiveWindowChanged(WindowAddress const& payload);
 
   void onConfigReloaded();
@@ -158,6 +227,17 @@ class FancyWorkspaces : public AModule, public EventHandler {
   void updateWorkspaceStates();
   bool updateWindowsToCreate();
 
+  // Window state kept up to date from socket2 deltas, so event handlers don't have to re-query
+  // and re-parse the full client list. Keyed by address without the "0x" prefix.
+  struct ClientState {
+    std::string workspaceName;
+    int workspaceId = -1;  // unknown until a resync or a movewindowv2 event reports it
+    std::string windowClass;
+    std::string windowTitle;
+  };
+  void resyncClients(Json::Value const& clientsJson);
+  ClientState* findClient(WindowAddress const& address);
+
   void extendOrphans(int workspaceId, Json::Value const& clientsJson);
   void registerOrphanWindow(FancyWindowCreationPayload create_window_payload);
 
@@ -166,7 +246,7 @@ class FancyWorkspaces : public AModule, public EventHandler {
   void loadPersistentWorkspacesFromConfig(Json::Value const& clientsJson);
   void loadPersistentWorkspacesFromWorkspaceRules(const Json::Value& clientsJson);
 
-  void executeHook(const std::string& command, const std::string& workspaceName,
+  void executeHook(const HookTemplate& hook, const std::string& workspaceName,
                    const std::string& workspaceMonitor, int workspaceId);
 
   bool m_allOutputs = false;
@@ -184,9 +264,14 @@ class FancyWorkspaces : public AModule, public EventHandler {
   // and doesn't share windows across bars (a.k.a `all-outputs` = false)
   std::map<WindowAddress, FancyWindowRepr, std::less<>> m_orphanWindowMap;
 
+  // "window-title-interval": the titles held back, and the update applying them
+  TitleThrottle m_titleThrottle;
+  sigc::connection m_titleFlush;
+
   enum class SortMethod { ID, NAME, NUMBER, SPECIAL_CENTERED, DEFAULT };
   util::EnumParser<SortMethod> m_enumParser;
   SortMethod m_sortBy = SortMethod::DEFAULT;
+  WorkspaceSortInputs m_sortInputs;
   std::map<std::string, SortMethod> m_sortMap = {{"ID", SortMethod::ID},
                                                  {"NAME", SortMethod::NAME},
                                                  {"NUMBER", SortMethod::NUMBER},
@@ -196,7 +281,7 @@ class FancyWorkspaces : public AModule, public EventHandler {
   std::string m_formatBefore;
   std::string m_formatAfter;
 
-  std::map<std::string, std::string> m_iconsMap;
+  util::StringMap<std::string> m_iconsMap;
   util::RegexCollection m_windowRewriteRules;
   bool m_anyWindowRewriteRuleUsesTitle = false;
   std::string m_formatWindowSeparator;
@@ -205,10 +290,13 @@ class FancyWorkspaces : public AModule, public EventHandler {
   uint64_t m_monitorId;
   int m_activeWorkspaceId;
   std::string m_activeSpecialWorkspaceName;
+  // declared before m_workspaces, which unindex their windows when destroyed
+  std::unordered_map<WindowAddress, FancyWorkspace*> m_windowIndex;
   std::vector<std::unique_ptr<FancyWorkspace>> m_workspaces;
   std::vector<std::pair<Json::Value, Json::Value>> m_workspacesToCreate;
   std::vector<std::string> m_workspacesToRemove;
   std::vector<FancyWindowCreationPayload> m_windowsToCreate;
+  std::unordered_map<WindowAddress, ClientState> m_clients;
 
   IconLoader m_iconLoader;
   bool m_enableTaskbar = false;
@@ -234,21 +322,25 @@ class FancyWorkspaces : public AModule, public EventHandler {
   int m_windowIconSize = 16;
 
   std::vector<std::regex> m_ignoreWorkspaces;
-  std::vector<std::regex> m_ignoreWindows;
+  std::unordered_map<std::string, bool> m_ignoredWorkspaceNames;  // verdicts by name
+  WindowIgnoreList m_ignoreWindows;
   
-  std::string m_onWorkspaceCreated;
-  std::string m_onWorkspaceDestroyed;
+  HookTemplate m_onWorkspaceCreated;
+  HookTemplate m_onWorkspaceDestroyed;
   
   // Project collapsing state
-  std::vector<Gtk::Box*> m_collapsedGroups;  // Container boxes for collapsed groups
-  std::vector<Gtk::Box*> m_expandedGroupBoxes;  // Container boxes for expanded group brackets
-  std::vector<std::unique_ptr<Gtk::Button>> m_labelButtons;
+  std::map<std::string, ProjectGroup> m_projectGroups;  // By prefix
+  std::unordered_map<std::string, std::optional<std::string>> m_projectPrefixes;  // By name
   
   // Track last active workspace per group+monitor for collapsed button clicks
   std::map<std::string, std::string> m_lastActivePerGroup;
   
   // Track urgent window addresses for precise urgent styling
   std::set<std::string> m_urgentWindows;
+
+  // Icon names by window class, misses included, for the desktop file index generation below
+  std::unordered_map<std::string, std::optional<std::string>> m_iconNameCache;
+  uint64_t m_iconNameCacheGeneration = 0;
   
   // Helper method for smart window selection in collapsed icons
   std::string selectBestWindowForIcon(
@@ -258,16 +350,27 @@ class FancyWorkspaces : public AModule, public EventHandler {
     const std::string& monitor
   );
 
-  std::mutex m_mutex;
+  util::MpscRing<PendingEvent> m_events{EVENT_QUEUE_CAPACITY};
+  const PendingEvent* m_handledEvent = nullptr;
   const Bar& m_bar;
   Gtk::Box m_box;
   IPC& m_ipc;
   
   util::ThumbnailCache m_thumbnailCache;
+  // "thumbnail-capture": when the windows of a workspace are captured
+  bool m_captureOnLeave = true;
+  bool m_captureOnIdle = true;
+  bool m_captureOnActivation = false;
+  // "thumbnail-idle-delay": how long the workspaces and windows stay still before an idle capture
+  std::chrono::milliseconds m_captureIdleDelay{5000};
+  sigc::connection m_idleCapture;
+  static constexpr std::chrono::milliseconds LEAVE_CAPTURE_TIMEOUT{200};
+  FancyWorkspace* activeWorkspace() const;
+  // Queues the captures of the windows of workspace, none while one of them is fullscreen
+  void captureWorkspace(FancyWorkspace* workspace, const Json::Value& clients, bool now,
+                        std::shared_ptr<void> done = nullptr);
   void captureThumbnailsForWorkspace(const std::string& workspaceName);
-  
-  // Track background capture process to kill it if workspace changes
-  pid_t m_captureProcessPid = 0;
+  void scheduleIdleCapture();
 };
 
 }  // namespace waybar::modules::hyprland
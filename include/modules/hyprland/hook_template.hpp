@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace waybar::modules::hyprland {
+
+/* A workspace hook command, split once at config load into its text and the {name}, {monitor}
+ * and {id} placeholders, so that running it only concatenates.
+ */
+class HookTemplate {
+ public:
+  HookTemplate() = default;
+  explicit HookTemplate(std::string command) : m_command(std::move(command)) {
+    static constexpr std::pair<std::string_view, Field> PLACEHOLDERS[] = {
+        {"{name}", Field::NAME}, {"{monitor}", Field::MONITOR}, {"{id}", Field::ID}};
+    std::string_view rest = m_command;
+    std::string text;
+    while (!rest.empty()) {
+      bool matched = false;
+      for (const auto& [placeholder, field] : PLACEHOLDERS) {
+        if (rest.starts_with(placeholder)) {
+          if (!text.empty()) {
+            m_parts.push_back({Field::TEXT, std::move(text)});
+            text.clear();
+          }
+          m_parts.push_back({field, {}});
+          rest.remove_prefix(placeholder.size());
+          matched = true;
+          break;
+        }
+      }
+      if (!matched) {
+        text += rest.front();
+        rest.remove_prefix(1);
+      }
+    }
+    if (!text.empty()) {
+      m_parts.push_back({Field::TEXT, std::move(text)});
+    }
+  }
+
+  bool empty() const { return m_command.empty(); }
+  const std::string& command() const { return m_command; }
+
+  std::string expand(const std::string& name, const std::string& monitor, int id) const {
+    const std::string idStr = std::to_string(id);
+    std::string cmd;
+    for (const auto& part : m_parts) {
+      switch (part.field) {
+        case Field::TEXT:
+          cmd += part.text;
+          break;
+        case Field::NAME:
+          cmd += name;
+          break;
+        case Field::MONITOR:
+          cmd += monitor;
+          break;
+        case Field::ID:
+          cmd += idStr;
+          break;
+      }
+    }
+    return cmd;
+  }
+
+ private:
+  enum class Field { TEXT, NAME, MONITOR, ID };
+  struct Part {
+    Field field;
+    std::string text;
+  };
+
+  std::string m_command;
+  std::vector<Part> m_parts;
+};
+
+}  // namespace waybar::modules::hyprland
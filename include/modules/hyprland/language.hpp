@@ -3,6 +3,7 @@
 #include <fmt/format.h>
 
 #include <string>
+#include <vector>
 
 #include "ALabel.hpp"
 #include "bar.hpp"
@@ -37,6 +38,8 @@ class Language : public waybar::ALabel, public EventHandler {
   util::JsonParser parser_;
 
   Layout layout_;
+  // The names of the keyboards, from j/devices, the longest first
+  std::vector<std::string> keyboards_;
 
   IPC& m_ipc;
 };
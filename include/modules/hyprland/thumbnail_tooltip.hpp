@@ -0,0 +1,41 @@
+#pragma once
+
+#include <gdkmm/pixbuf.h>
+#include <gtkmm/box.h>
+#include <gtkmm/tooltip.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace waybar::modules::hyprland {
+
+/* The tooltip of a window icon: the thumbnails of its windows, each above its title. Built on
+ * the first query, then shown again as it is until the windows it lists or their thumbnails
+ * change, so that neither the updates nor the queries on every pointer motion build widgets.
+ * GTK main thread only.
+ */
+class ThumbnailTooltip {
+ public:
+  struct Entry {
+    std::string address;  // of the window, without "0x"
+    std::string title;
+  };
+
+  // Keeps the built tooltip if it already lists these
+  void setContent(std::string header, std::vector<Entry> entries, bool wrap);
+  // For signal_query_tooltip
+  bool query(const Glib::RefPtr<Gtk::Tooltip>& tooltip);
+
+ private:
+  void build(const std::vector<Glib::RefPtr<Gdk::Pixbuf>>& thumbnails);
+
+  std::string header_;
+  std::vector<Entry> entries_;
+  bool wrap_ = false;
+  // What box_ was built from, a new capture of a window gives another pixbuf
+  std::vector<Glib::RefPtr<Gdk::Pixbuf>> thumbnails_;
+  std::unique_ptr<Gtk::Box> box_;
+};
+
+}  // namespace waybar::modules::hyprland
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace waybar::modules::hyprland {
+
+/* Holds back the titles of the windows that change it faster than the interval, e.g. progress
+ * counters and spinners. The first title of a window is applied on the next flush, the ones
+ * following within the interval collapse into the last one, applied once the interval passed.
+ * Not thread safe, the workspaces modules guard it with their mutex.
+ */
+class TitleThrottle {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void setInterval(std::chrono::milliseconds interval) { interval_ = interval; }
+  bool enabled() const { return interval_.count() > 0; }
+
+  // Queues the title of the window for the next flush, replacing the one queued before
+  void push(const std::string& address, std::string title) {
+    pending_[address] = std::move(title);
+  }
+
+  // The window is gone, its queued title with it
+  void forget(const std::string& address) {
+    pending_.erase(address);
+    applied_.erase(address);
+  }
+
+  /* Calls apply(address, title) for the queued titles that are due. Returns how long until the
+   * next of the others is due, nothing if none is left.
+   */
+  template <typename Apply>
+  std::optional<std::chrono::milliseconds> flush(Apply&& apply) {
+    const auto now = Clock::now();
+    std::optional<Clock::duration> next;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      auto [applied, inserted] = applied_.try_emplace(it->first, now);
+      if (!inserted) {
+        if (auto wait = applied->second + interval_ - now; wait > Clock::duration::zero()) {
+          next = next ? std::min(*next, wait) : wait;
+          ++it;
+          continue;
+        }
+        applied->second = now;
+      }
+      apply(it->first, it->second);
+      it = pending_.erase(it);
+    }
+    if (!next) {
+      return std::nullopt;
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(*next);
+  }
+
+ private:
+  std::chrono::milliseconds interval_{0};
+  std::unordered_map<std::string, std::string> pending_;
+  std::unordered_map<std::string, Clock::time_point> applied_;
+};
+
+}  // namespace waybar::modules::hyprland
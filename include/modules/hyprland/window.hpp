@@ -7,7 +7,9 @@
 #include "AAppIconLabel.hpp"
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
+#include "modules/hyprland/window_state.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::hyprland {
 
@@ -24,8 +26,6 @@ class Window : public waybar::AAppIconLabel, public EventHandler {
     int windows;
     std::string last_window;
     std::string last_window_title;
-
-    static auto parse(const Json::Value& value) -> Workspace;
   };
 
   struct WindowData {
@@ -38,11 +38,9 @@ class Window : public waybar::AAppIconLabel, public EventHandler {
     bool fullscreen;
     bool grouped;
 
-    static auto parse(const Json::Value&) -> WindowData;
+    static auto from(const WindowState::Client&) -> WindowData;
   };
 
-  static auto getActiveWorkspace(const std::string&) -> Workspace;
-  static auto getActiveWorkspace() -> Workspace;
   void onEvent(const std::string& ev) override;
   void queryActiveWorkspace();
   void setClass(const std::string&, bool enable);
@@ -50,6 +48,7 @@ class Window : public waybar::AAppIconLabel, public EventHandler {
   bool separateOutputs_;
   std::mutex mutex_;
   const Bar& bar_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
   util::JsonParser parser_;
   WindowData windowData_;
   Workspace workspace_;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <json/value.h>
+
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace waybar::modules::hyprland {
+
+/* The "ignore-list" of the workspace taskbar: windows whose class or title fully matches one of
+ * the patterns, case insensitively, are left out. The patterns run as one alternation when none
+ * of them has a backreference, whose group numbers the alternation would shift. The result for
+ * each class and title is kept, so a window seen before is a lookup.
+ */
+class WindowIgnoreList {
+ public:
+  // Replaces the patterns with the strings of the array, logging the invalid ones
+  void load(const Json::Value& patterns);
+
+  bool empty() const { return patterns_.empty(); }
+  bool ignores(const std::string& window_class, const std::string& window_title) const;
+
+ private:
+  // Past this, the results are dropped rather than kept for every title ever seen
+  static constexpr size_t CACHE_CAPACITY = 512;
+
+  bool matches(const std::string& value) const;
+
+  std::vector<std::regex> patterns_;
+  mutable std::mutex mutex_;
+  mutable std::unordered_map<std::string, bool> results_;
+};
+
+}  // namespace waybar::modules::hyprland
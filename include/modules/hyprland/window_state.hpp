@@ -0,0 +1,82 @@
+#pragma once
+
+#include <json/value.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "util/string_map.hpp"
+
+namespace waybar::modules::hyprland {
+
+/* The monitors, workspaces and windows of Hyprland, as the window and windowcount modules show
+ * them. Loaded from one batch of socket1 queries, then kept up to date from the socket2 events
+ * that carry the whole change: focus, titles, floating and fullscreen. The others (a window
+ * opening, closing or moving, workspaces coming and going) mark it stale, and it is loaded again
+ * on the next read. Not thread safe, IPC guards it.
+ */
+class WindowState {
+ public:
+  struct Client {
+    std::string address;  // as in the replies, "0x" and hex digits
+    int workspace = -1;
+    int monitor = -1;
+    std::string class_name;
+    std::string initial_class_name;
+    std::string title;
+    std::string initial_title;
+    bool floating = false;
+    bool fullscreen = false;
+    bool mapped = false;
+    bool hidden = false;
+    bool swallowing = false;
+    bool grouped = false;
+  };
+
+  struct Workspace {
+    int id = -1;
+    std::string name;
+    std::string monitor;
+    int windows = 0;
+    bool has_fullscreen = false;
+    std::string last_window;
+    std::string last_window_title;
+  };
+
+  // Replaces the state with the replies to "monitors", "workspaces" and "clients"
+  void load(const Json::Value& monitors, const Json::Value& workspaces,
+            const Json::Value& clients);
+  // Applies the socket2 event, or marks the state stale if the event doesn't tell enough
+  void apply(std::string_view event);
+  bool stale() const { return stale_; }
+
+  // The active workspace of the monitor, of the focused one if monitor is empty
+  const Workspace* activeWorkspace(std::string_view monitor) const;
+  const Client* client(std::string_view address) const;
+  // The mapped windows of the workspace
+  std::vector<const Client*> clientsOn(int workspace) const;
+
+ private:
+  struct Monitor {
+    std::string name;
+    int active_workspace = -1;
+  };
+
+  Workspace* findWorkspace(int id);
+  Workspace* findWorkspace(std::string_view name);
+  Monitor* findMonitor(std::string_view name);
+  Client* findClient(std::string_view address);
+  // The monitor shows the workspace now, false if it isn't known
+  bool focusWorkspace(std::string_view monitor, Workspace* workspace);
+
+  bool stale_ = true;
+  bool title_events_ = false;  // Hyprland sends windowtitlev2, with the title
+  std::vector<Monitor> monitors_;
+  std::vector<Workspace> workspaces_;
+  util::StringMap<Client> clients_;
+  std::string focused_monitor_;
+  std::string active_window_;
+};
+
+}  // namespace waybar::modules::hyprland
@@ -7,6 +7,7 @@
 #include "AAppIconLabel.hpp"
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
+#include "modules/hyprland/window_state.hpp"
 
 namespace waybar::modules::hyprland {
 
@@ -22,11 +23,8 @@ class WindowCount : public waybar::AAppIconLabel, public EventHandler {
     int id;
     int windows;
     bool hasfullscreen;
-    static auto parse(const Json::Value& value) -> Workspace;
   };
 
-  auto getActiveWorkspace(const std::string&) -> Workspace;
-  auto getActiveWorkspace() -> Workspace;
   void onEvent(const std::string& ev) override;
   void queryActiveWorkspace();
   void setClass(const std::string&, bool enable);
@@ -20,6 +20,7 @@
 #include "modules/hyprland/windowcreationpayload.hpp"
 #include "util/enum.hpp"
 #include "util/regex_collection.hpp"
+#include "util/string_map.hpp"
 
 using WindowAddress = std::string;
 
@@ -30,11 +31,17 @@ class Workspace {
  public:
   explicit Workspace(const Json::Value& workspace_data, Workspaces& workspace_manager,
                      const Json::Value& clients_data = Json::Value::nullRef);
-  std::string& selectIcon(std::map<std::string, std::string>& icons_map);
+  ~Workspace();
+  /* Shows another workspace with the widgets of this one, the button kept by the pool after its
+   * workspace was destroyed. Without workspace_data, it only lets go of its windows
+   */
+  void bind(const Json::Value& workspace_data,
+            const Json::Value& clients_data = Json::Value::nullRef);
+  std::string& selectIcon(util::StringMap<std::string>& icons_map);
   Gtk::Button& button() { return m_button; };
 
   int id() const { return m_id; };
-  std::string name() const { return m_name; };
+  const std::string& name() const { return m_name; };
   std::string output() const { return m_output; };
   bool isActive() const { return m_isActive; };
   bool isSpecial() const { return m_isSpecial; };
@@ -53,10 +60,9 @@ class Workspace {
   void setWindows(uint value) { m_windows = value; };
   void setName(std::string const& value) { m_name = value; };
   void setOutput(std::string const& value) { m_output = value; };
-  bool containsWindow(WindowAddress const& addr) const {
-    return std::ranges::any_of(m_windowMap,
-                               [&addr](const auto& window) { return window.address == addr; });
-  };
+  bool containsWindow(WindowAddress const& addr) const;
+  // null if the window isn't on this workspace
+  const WindowRepr* findWindow(WindowAddress const& addr) const;
   void insertWindow(WindowCreationPayload create_window_payload);
   void initializeWindowMap(const Json::Value& clients_data);
   void setActiveWindow(WindowAddress const& addr);
@@ -69,10 +75,10 @@ class Workspace {
  private:
   Workspaces& m_workspaceManager;
 
-  int m_id;
+  int m_id = 0;
   std::string m_name;
   std::string m_output;
-  uint m_windows;
+  uint m_windows = 0;
   bool m_isActive = false;
   bool m_isSpecial = false;
   bool m_isPersistentRule = false;    // represents the persistent state in hyprland
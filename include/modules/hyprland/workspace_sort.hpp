@@ -0,0 +1,60 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace waybar::modules::hyprland {
+
+/* What the order of a workspace depends on, computed once per sort instead of in every
+ * comparison. name views the workspace's own name, the key lives as long as the sort.
+ */
+struct WorkspaceSortKey {
+  int id;
+  // The integer the name starts with, as std::stoi reads it, if it does
+  std::optional<int> number;
+  bool special;
+  std::string_view name;
+};
+
+WorkspaceSortKey workspaceSortKey(int id, std::string_view name, bool special);
+
+// "sort-by" ID, NAME and NUMBER; NUMBER orders by name when one of them isn't a number
+bool idLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b);
+bool nameLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b);
+bool numberLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b);
+// normal -> named persistent -> named -> special -> named special, "special -99" last
+bool defaultLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b);
+
+/* The attributes the last sort was computed from, in the order it left the workspaces. A sort
+ * with the same ones would leave everything in place.
+ */
+class WorkspaceSortInputs {
+ public:
+  struct Entry {
+    const void* workspace;
+    int id;
+    bool special;
+    bool visible;
+    std::string name;
+
+    bool operator==(const Entry&) const = default;
+  };
+
+  // Whether entries, in the current order, differ from the ones the last sort left
+  bool changed(const std::vector<Entry>& entries) const { return !valid_ || entries != entries_; }
+  void record(std::vector<Entry> entries) {
+    entries_ = std::move(entries);
+    valid_ = true;
+  }
+  // A workspace came or went: the next sort runs whatever the attributes
+  void invalidate() { valid_ = false; }
+
+ private:
+  std::vector<Entry> entries_;
+  bool valid_ = false;
+};
+
+}  // namespace waybar::modules::hyprland
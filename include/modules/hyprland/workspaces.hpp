@@ -11,16 +11,23 @@
 #include <optional>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "AModule.hpp"
 #include "bar.hpp"
 #include "modules/hyprland/backend.hpp"
+#include "modules/hyprland/hook_template.hpp"
+#include "modules/hyprland/title_throttle.hpp"
+#include "modules/hyprland/window_ignore_list.hpp"
 #include "modules/hyprland/windowcreationpayload.hpp"
 #include "modules/hyprland/workspace.hpp"
+#include "modules/hyprland/workspace_sort.hpp"
 #include "util/enum.hpp"
 #include "util/icon_loader.hpp"
 #include "util/regex_collection.hpp"
+#include "util/string_map.hpp"
+#include "util/widget_pool.hpp"
 
 using WindowAddress = std::string;
 
@@ -44,16 +51,16 @@ class Workspaces : public AModule, public EventHandler {
   auto enableTaskbar() const -> bool { return m_enableTaskbar; }
   auto taskbarWithIcon() const -> bool { return m_taskbarWithIcon; }
 
-  auto getBarOutput() const -> std::string { return m_bar.output->name; }
-  auto formatBefore() const -> std::string { return m_formatBefore; }
-  auto formatAfter() const -> std::string { return m_formatAfter; }
+  auto getBarOutput() const -> const std::string& { return m_bar.output->name; }
+  auto formatBefore() const -> const std::string& { return m_formatBefore; }
+  auto formatAfter() const -> const std::string& { return m_formatAfter; }
   auto taskbarFormatBefore() const -> std::string { return m_taskbarFormatBefore; }
   auto taskbarFormatAfter() const -> std::string { return m_taskbarFormatAfter; }
   auto taskbarIconSize() const -> int { return m_taskbarIconSize; }
   auto taskbarOrientation() const -> Gtk::Orientation { return m_taskbarOrientation; }
   auto taskbarReverseDirection() const -> bool { return m_taskbarReverseDirection; }
   auto onClickWindow() const -> std::string { return m_onClickWindow; }
-  auto getIgnoredWindows() const -> std::vector<std::regex> { return m_ignoreWindows; }
+  auto getIgnoredWindows() const -> const WindowIgnoreList& { return m_ignoreWindows; }
 
   enum class ActiveWindowPosition { NONE, FIRST, LAST };
   auto activeWindowPosition() const -> ActiveWindowPosition { return m_activeWindowPosition; }
@@ -62,6 +69,12 @@ class Workspaces : public AModule, public EventHandler {
   std::string& getWindowSeparator() { return m_formatWindowSeparator; }
   bool isWorkspaceIgnored(std::string const& workspace_name);
 
+  // The workspace a window is in, kept up to date by the workspaces as they insert and close
+  // windows. Null for orphan and queued windows.
+  Workspace* windowWorkspace(WindowAddress const& addr) const;
+  void indexWindow(WindowAddress const& addr, Workspace* workspace);
+  void unindexWindow(WindowAddress const& addr, const Workspace* workspace);
+
   bool windowRewriteConfigUsesTitle() const { return m_anyWindowRewriteRuleUsesTitle; }
   const IconLoader& iconLoader() const { return m_iconLoader; }
 
@@ -110,6 +123,8 @@ class Workspaces : public AModule, public EventHandler {
   void onWindowMoved(std::string const& payload);
 
   void onWindowTitleEvent(std::string const& payload);
+  void updateWindowTitle(WindowAddress const& windowAddress, std::string const& windowTitle);
+  void flushWindowTitles();
   void onActiveWindowChanged(WindowAddress const& payload);
 
   void onConfigReloaded();
@@ -139,7 +154,7 @@ class Workspaces : public AModule, public EventHandler {
   void loadPersistentWorkspacesFromConfig(Json::Value const& clientsJson);
   void loadPersistentWorkspacesFromWorkspaceRules(const Json::Value& clientsJson);
 
-  void executeHook(const std::string& command, const std::string& workspaceName,
+  void executeHook(const HookTemplate& hook, const std::string& workspaceName,
                    const std::string& workspaceMonitor, int workspaceId);
 
   bool m_allOutputs = false;
@@ -155,9 +170,14 @@ class Workspaces : public AModule, public EventHandler {
   // and doesn't share windows across bars (a.k.a `all-outputs` = false)
   std::map<WindowAddress, WindowRepr, std::less<>> m_orphanWindowMap;
 
+  // "window-title-interval": the titles held back, and the update applying them
+  TitleThrottle m_titleThrottle;
+  sigc::connection m_titleFlush;
+
   enum class SortMethod { ID, NAME, NUMBER, SPECIAL_CENTERED, DEFAULT };
   util::EnumParser<SortMethod> m_enumParser;
   SortMethod m_sortBy = SortMethod::DEFAULT;
+  WorkspaceSortInputs m_sortInputs;
   std::map<std::string, SortMethod> m_sortMap = {{"ID", SortMethod::ID},
                                                  {"NAME", SortMethod::NAME},
                                                  {"NUMBER", SortMethod::NUMBER},
@@ -167,7 +187,7 @@ class Workspaces : public AModule, public EventHandler {
   std::string m_formatBefore;
   std::string m_formatAfter;
 
-  std::map<std::string, std::string> m_iconsMap;
+  util::StringMap<std::string> m_iconsMap;
   util::RegexCollection m_windowRewriteRules;
   bool m_anyWindowRewriteRuleUsesTitle = false;
   std::string m_formatWindowSeparator;
@@ -176,7 +196,10 @@ class Workspaces : public AModule, public EventHandler {
   uint64_t m_monitorId;
   int m_activeWorkspaceId;
   std::string m_activeSpecialWorkspaceName;
+  // declared before m_workspaces, which unindex their windows when destroyed
+  std::unordered_map<WindowAddress, Workspace*> m_windowIndex;
   std::vector<std::unique_ptr<Workspace>> m_workspaces;
+  util::WidgetPool<Workspace> m_spareWorkspaces;  // destroyed ones, to show the next created
   std::vector<std::pair<Json::Value, Json::Value>> m_workspacesToCreate;
   std::vector<std::string> m_workspacesToRemove;
   std::vector<WindowCreationPayload> m_windowsToCreate;
@@ -202,10 +225,10 @@ class Workspaces : public AModule, public EventHandler {
   std::string m_currentActiveWindowAddress;
 
   std::vector<std::regex> m_ignoreWorkspaces;
-  std::vector<std::regex> m_ignoreWindows;
+  WindowIgnoreList m_ignoreWindows;
 
-  std::string m_onWorkspaceCreated;
-  std::string m_onWorkspaceDestroyed;
+  HookTemplate m_onWorkspaceCreated;
+  HookTemplate m_onWorkspaceDestroyed;
 
   std::mutex m_mutex;
   const Bar& m_bar;
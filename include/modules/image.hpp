@@ -1,14 +1,20 @@
 #pragma once
 
 #include <fmt/format.h>
+#include <gdkmm/pixbuf.h>
 #include <gtkmm/image.h>
+#include <sys/types.h>
 
+#include <atomic>
 #include <csignal>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "ALabel.hpp"
 #include "gtkmm/box.h"
 #include "util/command.hpp"
+#include "util/file_watch.hpp"
 #include "util/json.hpp"
 #include "util/sleeper_thread.hpp"
 
@@ -19,22 +25,37 @@ class Image : public AModule {
   Image(const std::string&, const Json::Value&);
   virtual ~Image() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
   void refresh(int /*signal*/) override;
 
  private:
+  // What the worker found, taken by update() on the main thread
+  struct Loaded {
+    std::string path;
+    std::string tooltip;
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf;  // null when there is nothing to show
+    int scale = 0;                     // the scale factor pixbuf was decoded for
+    time_t mtime = 0;
+    bool changed = false;  // pixbuf was replaced since update() took it
+  };
+
   void delayWorker();
-  void handleEvent();
-  void parseOutputRaw();
+  // Runs the script, if any, and decodes the image unless it is the one already decoded
+  void load();
+  void parseOutputRaw(const std::string& output, std::string& path, std::string& tooltip);
 
   Gtk::Box box_;
   Gtk::Image image_;
-  std::string path_;
-  std::string tooltip_;
   int size_;
   std::chrono::milliseconds interval_;
-  util::command::res output_;
+
+  std::mutex mutex_;  // guards loaded_
+  Loaded loaded_;
+  // Set by update(): the worker decodes for the scale factor of the bar output
+  std::atomic<int> scale_{1};
 
   util::SleeperThread thread_;
+  std::unique_ptr<util::FileWatch> watch_;  // after thread_, which it wakes up
 };
 
 }  // namespace waybar::modules
@@ -17,9 +17,12 @@ class Inhibitor : public ALabel {
   auto activated() -> bool;
 
  private:
+  static void onBusReady(GObject*, GAsyncResult*, gpointer);
   auto handleToggle(::GdkEventButton* const& e) -> bool override;
 
-  const std::unique_ptr<::GDBusConnection, void (*)(::GDBusConnection*)> dbus_;
+  std::unique_ptr<::GDBusConnection, void (*)(gpointer)> dbus_;
+  const std::unique_ptr<::GCancellable, void (*)(gpointer)> cancellable_;
+  bool loading_ = true;
   const std::string inhibitors_;
   int handle_ = -1;
 };
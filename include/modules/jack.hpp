@@ -4,10 +4,12 @@
 #include <jack/jack.h>
 #include <jack/thread.h>
 
+#include <atomic>
 #include <fstream>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules {
 
@@ -24,16 +26,21 @@ class JACK : public ALabel {
 
  private:
   std::string JACKState();
+  // From the JACK threads: one update for all the callbacks until it runs, without a lock
+  void notify();
 
   jack_client_t *client_;
-  jack_nframes_t bufsize_;
-  jack_nframes_t samplerate_;
-  unsigned int xruns_;
-  float load_;
+  // Written by the callbacks
+  std::atomic<jack_nframes_t> bufsize_;
+  std::atomic<jack_nframes_t> samplerate_;
+  std::atomic<unsigned int> xruns_;
+  std::atomic<bool> xrun_{false};  // an xrun since the last update
+  std::atomic<bool> update_queued_{false};
+  float load_;  // the DSP load, sampled on the timer
   bool running_;
   std::mutex mutex_;
-  std::string state_;
-  util::SleeperThread thread_;
+  util::StyleClasses state_class_{label_};
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
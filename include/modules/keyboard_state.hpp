@@ -3,17 +3,11 @@
 #include <fmt/chrono.h>
 #include <gtkmm/label.h>
 
-#include <set>
-#include <unordered_map>
+#include <memory>
+#include <string>
 
 #include "AModule.hpp"
 #include "bar.hpp"
-#include "util/sleeper_thread.hpp"
-
-extern "C" {
-#include <libevdev/libevdev.h>
-#include <libinput.h>
-}
 
 namespace waybar::modules {
 
@@ -24,7 +18,7 @@ class KeyboardState : public AModule {
   auto update() -> void override;
 
  private:
-  auto tryAddDevice(const std::string&) -> void;
+  class Devices;
 
   Gtk::Box box_;
   Gtk::Label numlock_label_;
@@ -37,13 +31,10 @@ class KeyboardState : public AModule {
   const std::chrono::seconds interval_;
   std::string icon_locked_;
   std::string icon_unlocked_;
-  std::string devices_path_;
-
-  struct libinput* libinput_;
-  std::unordered_map<std::string, struct libinput_device*> libinput_devices_;
-  std::set<int> binding_keys;
+  std::string device_path_;
 
-  util::SleeperThread libinput_thread_, hotplug_thread_;
+  std::shared_ptr<Devices> devices_;
+  int subscription_ = -1;
 };
 
 }  // namespace waybar::modules
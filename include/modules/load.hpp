@@ -5,12 +5,15 @@
 #include <cstdint>
 #include <fstream>
 #include <numeric>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 
 namespace waybar::modules {
 
@@ -19,12 +22,16 @@ class Load : public ALabel {
   Load(const std::string&, const Json::Value&);
   virtual ~Load() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
   // This is a static member because it is also used by the cpu module.
   static std::tuple<double, double, double> getLoad();
 
  private:
-  util::SleeperThread thread_;
+  using LoadSample = std::tuple<double, double, double>;
+  // one read for the load modules of all the bars
+  std::shared_ptr<util::SharedSample<LoadSample>> sample_;
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -3,10 +3,10 @@
 #include <fmt/format.h>
 
 #include <fstream>
-#include <unordered_map>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 
 namespace waybar::modules {
 
@@ -15,13 +15,29 @@ class Memory : public ALabel {
   Memory(const std::string&, const Json::Value&);
   virtual ~Memory() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
-  void parseMeminfo();
-
-  std::unordered_map<std::string, unsigned long> meminfo_;
-
-  util::SleeperThread thread_;
+  // The /proc/meminfo fields the module uses, in kB
+  struct Meminfo {
+    unsigned long mem_total = 0;
+    unsigned long mem_free = 0;
+    unsigned long mem_available = 0;
+    bool has_mem_available = false;  // missing on old kernels
+    unsigned long buffers = 0;
+    unsigned long cached = 0;
+    unsigned long s_reclaimable = 0;
+    unsigned long shmem = 0;
+    unsigned long swap_total = 0;
+    unsigned long swap_free = 0;
+    unsigned long zfs_size = 0;  // ZFS ARC, reclaimable like the page cache
+  };
+  static Meminfo parseMeminfo();
+
+  std::shared_ptr<util::SharedSample<Meminfo>> sample_;
+  Meminfo meminfo_;
+
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -4,39 +4,24 @@
 #include <mpd/client.h>
 #include <spdlog/spdlog.h>
 
-#include <condition_variable>
-#include <thread>
+#include <chrono>
+#include <memory>
 
 #include "ALabel.hpp"
-#include "modules/mpd/state.hpp"
+#include "modules/mpd/server.hpp"
 
 namespace waybar::modules {
 
 class MPD : public ALabel {
-  friend class detail::Context;
-
-  // State machine
-  detail::Context context_{this};
-
   const std::string module_name_;
 
-  // Not using unique_ptr since we don't manage the pointer
-  // (It's either nullptr, or from the config)
-  const char* server_;
-  const unsigned port_;
-  const std::string password_;
-
-  unsigned timeout_;
-
-  detail::unique_connection connection_;
-
-  detail::unique_status status_;
-  mpd_state state_;
-  detail::unique_song song_;
+  // Shared with the other mpd modules of the same server
+  std::shared_ptr<detail::Server> server_;
+  int subscription_;
 
  public:
   MPD(const std::string&, const Json::Value&);
-  virtual ~MPD() noexcept = default;
+  virtual ~MPD() noexcept;
   auto update() -> void override;
 
  private:
@@ -48,21 +33,10 @@ class MPD : public ALabel {
 
   // GUI-side methods
   bool handlePlayPause(GdkEventButton* const&);
-  void emit() { dp.emit(); }
-
-  // MPD-side, Non-GUI methods.
-  void tryConnect();
-  void checkErrors(mpd_connection* conn);
-  void fetchState();
-  void queryMPD();
 
-  inline bool stopped() const { return connection_ && state_ == MPD_STATE_STOP; }
-  inline bool playing() const { return connection_ && state_ == MPD_STATE_PLAY; }
-  inline bool paused() const { return connection_ && state_ == MPD_STATE_PAUSE; }
+  inline bool stopped() const { return server_->stopped(); }
+  inline bool playing() const { return server_->playing(); }
+  inline bool paused() const { return server_->paused(); }
 };
 
-#if !defined(MPD_NOINLINE)
-#include "modules/mpd/state.inl.hpp"
-#endif
-
 }  // namespace waybar::modules
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <mpd/client.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "modules/mpd/state.hpp"
+
+namespace waybar::modules::detail {
+
+/* One connection to an MPD server, for every mpd module showing the same host, port and
+ * password. The state machine and its idle loop run once here, and the status and the song it
+ * fetched are what all the modules show.
+ */
+class Server {
+  friend class Context;
+
+  struct private_constructor_tag {};
+
+ public:
+  // timeout is in milliseconds, interval the seconds between connection attempts
+  static std::shared_ptr<Server> getInstance(const std::string& host, unsigned port,
+                                             const std::string& password, unsigned timeout,
+                                             std::size_t interval);
+
+  Server(std::string host, unsigned port, std::string password, unsigned timeout,
+         std::size_t interval, private_constructor_tag tag);
+
+  // on_changed is called on the main thread after every fetch, and when the connection is lost
+  int subscribe(std::function<void()> on_changed);
+  void unsubscribe(int id);
+
+  void play() { context_.play(); }
+  void pause() { context_.pause(); }
+  void stop() { context_.stop(); }
+
+  bool connected() const { return connection_ != nullptr; }
+  mpd_state state() const { return state_; }
+  // Both null until connected
+  const mpd_status* status() const { return status_.get(); }
+  const mpd_song* song() const { return song_.get(); }
+  std::chrono::steady_clock::time_point statusTime() const { return status_time_; }
+
+  inline bool stopped() const { return connection_ && state_ == MPD_STATE_STOP; }
+  inline bool playing() const { return connection_ && state_ == MPD_STATE_PLAY; }
+  inline bool paused() const { return connection_ && state_ == MPD_STATE_PAUSE; }
+
+ private:
+  void tryConnect();
+  void checkErrors(mpd_connection* conn);
+  void fetchState();
+  void emit();
+
+  const std::string name_;
+  const std::string host_;  // empty for the libmpdclient default
+  const unsigned port_;
+  const std::string password_;
+  const unsigned timeout_;
+  const std::size_t interval_;
+
+  unique_connection connection_;
+
+  unique_status status_;
+  std::chrono::steady_clock::time_point status_time_;  // when status_ was fetched
+  mpd_state state_ = MPD_STATE_UNKNOWN;
+  unique_song song_;
+
+  std::vector<std::pair<int, std::function<void()>>> subscribers_;
+  int next_subscriber_id_ = 0;
+
+  // State machine, last: entering its first state already uses the members above
+  Context context_{this};
+};
+
+}  // namespace waybar::modules::detail
+
+#if !defined(MPD_NOINLINE)
+namespace waybar::modules {
+#include "modules/mpd/state.inl.hpp"
+}  // namespace waybar::modules
+#endif
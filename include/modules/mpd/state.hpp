@@ -9,10 +9,6 @@
 
 #include "ALabel.hpp"
 
-namespace waybar::modules {
-class MPD;
-}  // namespace waybar::modules
-
 namespace waybar::modules::detail {
 
 using unique_connection = std::unique_ptr<mpd_connection, decltype(&mpd_connection_free)>;
@@ -20,6 +16,7 @@ using unique_status = std::unique_ptr<mpd_status, decltype(&mpd_status_free)>;
 using unique_song = std::unique_ptr<mpd_song, decltype(&mpd_song_free)>;
 
 class Context;
+class Server;
 
 /// This state machine loosely follows a non-hierarchical, statechart
 /// pattern, and includes ENTRY and EXIT actions.
@@ -31,7 +28,8 @@ class Context;
 /// Waybar.
 ///
 /// The following nested "top-level" states are represented:
-/// 1. Idle - await notification of MPD activity.
+/// 1. Idle - await notification of MPD activity. While playing, the
+///    elapsed time shown runs on locally, without asking MPD.
 /// 2. All Non-Idle states:
 ///    1. Playing - An active song is producing audio output.
 ///    2. Paused - The current song is paused.
@@ -51,14 +49,12 @@ class State {
   virtual void play() { spdlog::debug("mpd: ignore play state transition"); }
   virtual void stop() { spdlog::debug("mpd: ignore stop state transition"); }
   virtual void pause() { spdlog::debug("mpd: ignore pause state transition"); }
-
-  /// Request state update the GUI.
-  virtual void update() noexcept { spdlog::debug("mpd: ignoring update method request"); }
 };
 
 class Idle : public State {
   Context* const ctx_;
   sigc::connection idle_connection_;
+  sigc::connection tick_connection_;  // redraws the elapsed time while playing
 
  public:
   Idle(Context* const ctx) : ctx_{ctx} {}
@@ -70,7 +66,6 @@ class Idle : public State {
   void play() override;
   void stop() override;
   void pause() override;
-  void update() noexcept override;
 
  private:
   Idle(const Idle&) = delete;
@@ -92,7 +87,6 @@ class Playing : public State {
 
   void pause() override;
   void stop() override;
-  void update() noexcept override;
 
  private:
   Playing(Playing const&) = delete;
@@ -114,7 +108,6 @@ class Paused : public State {
 
   void play() override;
   void stop() override;
-  void update() noexcept override;
 
  private:
   Paused(Paused const&) = delete;
@@ -136,7 +129,6 @@ class Stopped : public State {
 
   void play() override;
   void pause() override;
-  void update() noexcept override;
 
  private:
   Stopped(Stopped const&) = delete;
@@ -157,7 +149,6 @@ class Disconnected : public State {
   void entry() noexcept override;
   void exit() noexcept override;
 
-  void update() noexcept override;
 
  private:
   Disconnected(Disconnected const&) = delete;
@@ -171,7 +162,7 @@ class Disconnected : public State {
 
 class Context {
   std::unique_ptr<State> state_;
-  waybar::modules::MPD* mpd_module_;
+  Server* server_;
 
   friend class State;
   friend class Playing;
@@ -196,23 +187,20 @@ class Context {
   constexpr std::size_t interval() const;
   void tryConnect() const;
   void checkErrors(mpd_connection*) const;
-  void do_update();
-  void queryMPD() const;
   void fetchState() const;
   constexpr mpd_state state() const;
   void emit() const;
   [[nodiscard]] unique_connection& connection();
 
  public:
-  explicit Context(waybar::modules::MPD* const mpd_module)
-      : state_{std::make_unique<Disconnected>(this)}, mpd_module_{mpd_module} {
+  explicit Context(Server* const server)
+      : state_{std::make_unique<Disconnected>(this)}, server_{server} {
     state_->entry();
   }
 
   void play() { state_->play(); }
   void stop() { state_->stop(); }
   void pause() { state_->pause(); }
-  void update() noexcept { state_->update(); }
 };
 
 }  // namespace waybar::modules::detail
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
 #include <optional>
 #include <string>
@@ -12,7 +13,7 @@ extern "C" {
 }
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
 
 namespace waybar::modules::mpris {
 
@@ -21,6 +22,7 @@ class Mpris : public ALabel {
   Mpris(const std::string&, const Json::Value&);
   virtual ~Mpris();
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
   bool handleToggle(GdkEventButton* const&) override;
 
  private:
@@ -30,6 +32,7 @@ class Mpris : public ALabel {
   static auto onPlayerPause(PlayerctlPlayer*, gpointer) -> void;
   static auto onPlayerStop(PlayerctlPlayer*, gpointer) -> void;
   static auto onPlayerMetadata(PlayerctlPlayer*, GVariant*, gpointer) -> void;
+  static auto onPlayerSeeked(PlayerctlPlayer*, gint64, gpointer) -> void;
 
   struct PlayerInfo {
     std::string name;
@@ -43,7 +46,10 @@ class Mpris : public ALabel {
     std::optional<std::string> position;  // same format
   };
 
+  // The last snapshot, refetched once a player signal made it stale
   auto getPlayerInfo() -> std::optional<PlayerInfo>;
+  auto fetchPlayerInfo() -> std::optional<PlayerInfo>;
+  void invalidate();
   auto getIconFromJson(const Json::Value&, const std::string&) -> std::string;
   auto getArtistStr(const PlayerInfo&, bool) -> std::string;
   auto getAlbumStr(const PlayerInfo&, bool) -> std::string;
@@ -69,9 +75,11 @@ class Mpris : public ALabel {
   std::vector<std::string> dynamic_prio_;
   std::vector<std::string> dynamic_order_;
   std::string dynamic_separator_;
+  size_t dynamic_separator_width_;
   bool truncate_hours_;
   bool tooltip_len_limits_;
   std::string ellipsis_;
+  size_t ellipsis_width_;
 
   std::string player_;
   std::vector<std::string> ignored_players_;
@@ -81,8 +89,18 @@ class Mpris : public ALabel {
   std::string lastStatus;
   std::string lastPlayer;
 
-  util::SleeperThread thread_;
+  util::PeriodicTask timer_;
   std::chrono::time_point<std::chrono::system_clock> last_update_;
+
+  // Players signal status, metadata and seeks, but not the position as it plays: between those, a
+  // snapshot is kept and the position runs on from where it was last known.
+  static constexpr auto RESYNC_INTERVAL = std::chrono::seconds(30);
+  std::optional<PlayerInfo> info_;
+  bool info_stale_ = true;
+  std::chrono::steady_clock::time_point info_at_;
+  std::optional<std::chrono::microseconds> length_us_;
+  std::optional<std::chrono::microseconds> position_us_;
+  std::chrono::steady_clock::time_point position_at_;
 };
 
 }  // namespace waybar::modules::mpris
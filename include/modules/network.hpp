@@ -6,12 +6,13 @@
 #include <netlink/genl/ctrl.h>
 #include <netlink/genl/genl.h>
 #include <netlink/netlink.h>
-#include <sys/epoll.h>
 
+#include <chrono>
 #include <optional>
 #include <vector>
 
 #include "ALabel.hpp"
+#include "util/proc_file.hpp"
 #include "util/sleeper_thread.hpp"
 #ifdef WANT_RFKILL
 #include "util/rfkill.hpp"
@@ -21,25 +22,28 @@ enum ip_addr_pref : uint8_t { IPV4, IPV6, IPV4_6 };
 
 namespace waybar::modules {
 
+class NetlinkHub;
+
 class Network : public ALabel {
  public:
   Network(const std::string&, const Json::Value&);
   virtual ~Network();
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
+  friend class NetlinkHub;
+
   static const uint8_t MAX_RETRY{5};
-  static const uint8_t EPOLL_MAX{200};
 
   static int handleEvents(struct nl_msg*, void*);
-  static int handleEventsDone(struct nl_msg*, void*);
   static int handleScan(struct nl_msg*, void*);
+  static int handleScanDone(struct nl_msg*, void*);
 
   void askForStateDump(void);
 
   void worker();
   void createInfoSocket();
-  void createEventSocket();
   void parseEssid(struct nlattr**);
   void parseSignal(struct nlattr**);
   void parseFreq(struct nlattr**);
@@ -47,7 +51,10 @@ class Network : public ALabel {
   bool associatedOrJoined(struct nlattr**);
   bool matchInterface(const std::string& ifname, const std::vector<std::string>& altnames,
                       std::string& matched) const;
-  auto getInfo() -> void;
+  /* Dumps the BSS of ifid on the worker thread, mutex_ held only to parse what came. A driver
+   * slow to answer, past SCAN_TIMEOUT, leaves the last result shown.
+   */
+  auto getInfo(int ifid) -> void;
   const std::string getNetworkState() const;
   void clearIface();
   std::optional<std::pair<unsigned long long, unsigned long long>> readBandwidthUsage();
@@ -56,18 +63,17 @@ class Network : public ALabel {
   ip_addr_pref addr_pref_{ip_addr_pref::IPV4};
   struct sockaddr_nl nladdr_{0};
   struct nl_sock* sock_{nullptr};
-  struct nl_sock* ev_sock_{nullptr};
-  int efd_{-1};
-  int ev_fd_{-1};
   int nl80211_id_{-1};
+  bool scan_done_{false};
+  static constexpr std::chrono::milliseconds SCAN_TIMEOUT{1000};
   std::mutex mutex_;
 
   bool want_route_dump_{false};
   bool want_link_dump_{false};
   bool want_addr_dump_{false};
-  bool dump_in_progress_{false};
   bool is_p2p_{false};
 
+  util::ProcFile netdev_{"/proc/net/dev"};
   unsigned long long bandwidth_down_total_{0};
   unsigned long long bandwidth_up_total_{0};
 
@@ -88,7 +94,6 @@ class Network : public ALabel {
   std::string signal_strength_app_;
   uint32_t route_priority;
 
-  util::SleeperThread thread_;
   util::SleeperThread thread_timer_;
 #ifdef WANT_RFKILL
   util::Rfkill rfkill_{RFKILL_TYPE_WLAN};
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <list>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "util/json.hpp"
 
@@ -12,39 +17,99 @@ namespace waybar::modules::niri {
 class EventHandler {
  public:
   virtual void onEvent(const Json::Value& ev) = 0;
+  // Once after a batch of events that had some for this handler: ask for a redraw here
+  virtual void onEventsDispatched() {}
   virtual ~EventHandler() = default;
 };
 
 class IPC {
  public:
+  // Outputs are interned: workspaces refer to them by an index into the output names
+  static constexpr uint32_t NO_OUTPUT = std::numeric_limits<uint32_t>::max();
+
+  struct Workspace {
+    uint64_t id;
+    unsigned idx;
+    std::optional<std::string> name;
+    uint32_t output;
+    std::optional<uint64_t> active_window_id;
+    bool is_active;
+    bool is_focused;
+    bool is_urgent;
+  };
+
+  struct Window {
+    uint64_t id;
+    std::string title;
+    std::string app_id;
+    std::optional<uint64_t> workspace_id;
+    bool is_focused;
+  };
+
   IPC() { startIPC(); }
 
-  void registerForIPC(const std::string& ev, EventHandler* ev_handler);
+  /* With an output, the handler only hears about the events that change the workspaces or windows
+   * of that output. Events that may change anything are delivered to every handler.
+   */
+  void registerForIPC(const std::string& ev, EventHandler* ev_handler,
+                      std::optional<std::string> output = std::nullopt);
   void unregisterForIPC(EventHandler* handler);
 
   static Json::Value send(const Json::Value& request);
 
   // The data members are only safe to access while dataMutex_ is locked.
   std::lock_guard<std::mutex> lockData() { return std::lock_guard(dataMutex_); }
-  const std::vector<Json::Value>& workspaces() const { return workspaces_; }
-  const std::vector<Json::Value>& windows() const { return windows_; }
+  // Sorted by output name, then index
+  const std::vector<Workspace>& workspaces() const { return workspaces_; }
+  const std::vector<Window>& windows() const { return windows_; }
+  const Workspace* workspace(uint64_t id) const;
+  const Window* window(uint64_t id) const;
+  // The interned id of an output niri told about, if any
+  std::optional<uint32_t> findOutput(const std::string& name) const;
+  const std::string& outputName(uint32_t output) const;
   const std::vector<std::string>& keyboardLayoutNames() const { return keyboardLayoutNames_; }
   unsigned keyboardLayoutCurrent() const { return keyboardLayoutCurrent_; }
 
  private:
   void startIPC();
   static int connectToSocket();
-  void parseIPC(const std::string&);
+  // Events read in one go, the handlers notified once after all of them
+  void parseBatch(const std::vector<std::string>& lines);
+  // The outputs an event changed something on
+  struct ChangedOutputs {
+    bool all = false;
+    std::vector<uint32_t> outputs;
+
+    void add(uint32_t output);
+    bool contains(const std::string& name, const IPC& ipc) const;
+  };
+
+  // With callbackMutex_ held, adds the handlers it called to notified
+  void parseIPC(const std::string&, std::vector<EventHandler*>& notified);
+  // With dataMutex_ held
+  uint32_t workspaceOutput(std::optional<uint64_t> workspaceId) const;
+  uint32_t internOutput(const Json::Value& name);
+  Workspace toWorkspace(const Json::Value& ws);
+  static Window toWindow(const Json::Value& win);
 
   std::mutex dataMutex_;
-  std::vector<Json::Value> workspaces_;
-  std::vector<Json::Value> windows_;
+  std::vector<Workspace> workspaces_;
+  std::vector<Window> windows_;
+  // From ids to their index in the vectors above
+  std::unordered_map<uint64_t, size_t> workspaceIndex_;
+  std::unordered_map<uint64_t, size_t> windowIndex_;
+  std::vector<std::string> outputNames_;
   std::vector<std::string> keyboardLayoutNames_;
   unsigned keyboardLayoutCurrent_;
 
   util::JsonParser parser_;
   std::mutex callbackMutex_;
-  std::list<std::pair<std::string, EventHandler*>> callbacks_;
+  struct Callback {
+    std::string event;
+    EventHandler* handler;
+    std::optional<std::string> output;
+  };
+  std::list<Callback> callbacks_;
 };
 
 inline std::unique_ptr<IPC> gIPC;
@@ -17,6 +17,7 @@ class Language : public ALabel, public EventHandler {
  private:
   void updateFromIPC();
   void onEvent(const Json::Value &ev) override;
+  void onEventsDispatched() override;
   void doUpdate();
 
   struct Layout {
@@ -6,6 +6,7 @@
 #include "AAppIconLabel.hpp"
 #include "bar.hpp"
 #include "modules/niri/backend.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::niri {
 
@@ -17,10 +18,12 @@ class Window : public AAppIconLabel, public EventHandler {
 
  private:
   void onEvent(const Json::Value &ev) override;
+  void onEventsDispatched() override;
   void doUpdate();
   void setClass(const std::string &className, bool enable);
 
   const Bar &bar_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
 
   std::string oldAppId_;
 };
@@ -3,9 +3,13 @@
 #include <gtkmm/button.h>
 #include <json/value.h>
 
+#include <memory>
+#include <unordered_map>
+
 #include "AModule.hpp"
 #include "bar.hpp"
 #include "modules/niri/backend.hpp"
+#include "util/widget_pool.hpp"
 
 namespace waybar::modules::niri {
 
@@ -17,14 +21,16 @@ class Workspaces : public AModule, public EventHandler {
 
  private:
   void onEvent(const Json::Value &ev) override;
+  void onEventsDispatched() override;
   void doUpdate();
-  Gtk::Button &addButton(const Json::Value &ws);
-  std::string getIcon(const std::string &value, const Json::Value &ws);
+  Gtk::Button &addButton(const IPC::Workspace &ws);
+  std::string getIcon(const std::string &value, const IPC::Workspace &ws);
 
   const Bar &bar_;
   Gtk::Box box_;
   // Map from niri workspace id to button.
-  std::unordered_map<uint64_t, Gtk::Button> buttons_;
+  std::unordered_map<uint64_t, std::unique_ptr<Gtk::Button>> buttons_;
+  util::WidgetPool<Gtk::Button> spare_buttons_;
 };
 
 }  // namespace waybar::modules::niri
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <optional>
+#include <set>
 #include <string>
 
 #include "gtkmm/box.h"
@@ -7,24 +10,34 @@
 #include "util/pipewire/pipewire_backend.hpp"
 #include "util/pipewire/privacy_node_info.hpp"
 
-using waybar::util::PipewireBackend::PrivacyNodeInfo;
+using waybar::util::PipewireBackend::PrivacyNodes;
+using waybar::util::PipewireBackend::PrivacyNodeSnapshot;
 
 namespace waybar::modules::privacy {
 
 class Privacy : public AModule {
  public:
   Privacy(const std::string &, const Json::Value &, Gtk::Orientation, const std::string &pos);
+  ~Privacy();
   auto update() -> void override;
 
-  void onPrivacyNodesChanged();
+  void onPrivacyNodeChanged(const PrivacyNodeSnapshot &node);
 
  private:
-  std::list<PrivacyNodeInfo *> nodes_screenshare;  // Screen is being shared
-  std::list<PrivacyNodeInfo *> nodes_audio_in;     // Application is using the microphone
-  std::list<PrivacyNodeInfo *> nodes_audio_out;    // Application is outputting audio
+  PrivacyNodes nodes_screenshare;  // Screen is being shared
+  PrivacyNodes nodes_audio_in;     // Application is using the microphone
+  PrivacyNodes nodes_audio_out;    // Application is outputting audio
+
+  // The types whose nodes changed since the last update
+  std::set<PrivacyNodeType> changed_types_;
 
   std::mutex mutex_;
-  sigc::connection visibility_conn;
+  /* One timer for the transitions of all items and the hiding of the module, at the earliest
+   * one due. A burst of node changes moves it instead of adding timers.
+   */
+  sigc::connection transition_conn_;
+  std::optional<std::chrono::steady_clock::time_point> transition_at_;
+  std::optional<std::chrono::steady_clock::time_point> hide_due_;
 
   // Config
   Gtk::Box box_;
@@ -35,6 +48,11 @@ class Privacy : public AModule {
   bool ignore_monitor = true;
 
   std::shared_ptr<util::PipewireBackend::PipewireBackend> backend = nullptr;
+  sigc::connection backend_conn;
+
+  PrivacyNodes *nodesOf(PrivacyNodeType type);
+  void scheduleTransitions();
+  void onTransitionsDue();
 };
 
 }  // namespace waybar::modules::privacy
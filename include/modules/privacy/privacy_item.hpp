@@ -2,6 +2,8 @@
 
 #include <json/value.h>
 
+#include <chrono>
+#include <optional>
 #include <string>
 
 #include "gtkmm/box.h"
@@ -9,7 +11,7 @@
 #include "gtkmm/revealer.h"
 #include "util/pipewire/privacy_node_info.hpp"
 
-using waybar::util::PipewireBackend::PrivacyNodeInfo;
+using waybar::util::PipewireBackend::PrivacyNodes;
 using waybar::util::PipewireBackend::PrivacyNodeType;
 
 namespace waybar::modules::privacy {
@@ -17,17 +19,20 @@ namespace waybar::modules::privacy {
 class PrivacyItem : public Gtk::Revealer {
  public:
   PrivacyItem(const Json::Value &config_, enum PrivacyNodeType privacy_type_,
-              std::list<PrivacyNodeInfo *> *nodes, Gtk::Orientation orientation,
+              const PrivacyNodes *nodes, Gtk::Orientation orientation,
               const std::string &pos, const uint icon_size, const uint transition_duration);
 
   enum PrivacyNodeType privacy_type;
 
-  void set_in_use(bool in_use);
+  // The tooltip is only rebuilt when the nodes changed
+  void set_in_use(bool in_use, bool nodes_changed);
+  // Reveals the icon once shown, or hides it once the revealer closed
+  void finish_transition();
+  // When finish_transition() is due, the module has the timer for all its items
+  std::optional<std::chrono::steady_clock::time_point> transition_due;
 
  private:
-  std::list<PrivacyNodeInfo *> *nodes;
-
-  sigc::connection signal_conn;
+  const PrivacyNodes *nodes;
 
   Gtk::Box tooltip_window;
 
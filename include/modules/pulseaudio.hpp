@@ -8,20 +8,24 @@
 
 #include "ALabel.hpp"
 #include "util/audio_backend.hpp"
+#include "util/scroll_accumulator.hpp"
 
 namespace waybar::modules {
 
 class Pulseaudio : public ALabel {
  public:
   Pulseaudio(const std::string&, const Json::Value&);
-  virtual ~Pulseaudio() = default;
+  virtual ~Pulseaudio();
   auto update() -> void override;
 
  private:
   bool handleScroll(GdkEventScroll* e) override;
+  void applyScroll(int steps);
   const std::vector<std::string> getPulseIcon() const;
 
   std::shared_ptr<util::AudioBackend> backend = nullptr;
+  int subscription_ = -1;
+  util::ScrollAccumulator scroll_;
 };
 
 }  // namespace waybar::modules
@@ -14,13 +14,14 @@ enum class PulseaudioSliderTarget {
 class PulseaudioSlider : public ASlider {
  public:
   PulseaudioSlider(const std::string&, const Json::Value&);
-  virtual ~PulseaudioSlider() = default;
+  virtual ~PulseaudioSlider();
 
   void update() override;
   void onValueChanged() override;
 
  private:
   std::shared_ptr<util::AudioBackend> backend = nullptr;
+  int subscription_ = -1;
   PulseaudioSliderTarget target = PulseaudioSliderTarget::Sink;
 };
 
@@ -4,7 +4,8 @@
 
 #include "ALabel.hpp"
 #include "bar.hpp"
-#include "river-status-unstable-v1-client-protocol.h"
+#include "modules/river/status.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules::river {
 
@@ -12,23 +13,19 @@ class Layout : public waybar::ALabel {
  public:
   Layout(const std::string &, const waybar::Bar &, const Json::Value &);
   virtual ~Layout();
+  auto boundToOutput() const -> bool override { return true; }
 
-  // Handlers for wayland events
-  void handle_name(const char *name);
-  void handle_clear();
-  void handle_focused_output(struct wl_output *output);
-  void handle_unfocused_output(struct wl_output *output);
-
-  struct zriver_status_manager_v1 *status_manager_;
-  struct wl_seat *seat_;
+  // Handlers for the changes of the river status
+  void handle_layout();
+  void handle_focused_output();
 
  private:
   const waybar::Bar &bar_;
-  std::string name_;
-  struct wl_output *output_;          // stores the output this module belongs to
-  struct wl_output *focused_output_;  // stores the currently focused output
-  struct zriver_output_status_v1 *output_status_;
-  struct zriver_seat_status_v1 *seat_status_;
+  std::shared_ptr<Status> status_;
+  int subscription_ = -1;
+  util::StyleClasses name_class_{label_};  // the layout name
+  struct wl_output *output_;  // stores the output this module belongs to
+  bool focused_ = false;      // whether the label has the focused class
 };
 
 } /* namespace waybar::modules::river */
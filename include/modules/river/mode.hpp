@@ -4,7 +4,8 @@
 
 #include "ALabel.hpp"
 #include "bar.hpp"
-#include "river-status-unstable-v1-client-protocol.h"
+#include "modules/river/status.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules::river {
 
@@ -13,16 +14,14 @@ class Mode : public waybar::ALabel {
   Mode(const std::string &, const waybar::Bar &, const Json::Value &);
   virtual ~Mode();
 
-  // Handlers for wayland events
-  void handle_mode(const char *mode);
-
-  struct zriver_status_manager_v1 *status_manager_;
-  struct wl_seat *seat_;
+  // Handler for the changes of the river status
+  void handle_mode();
 
  private:
   const waybar::Bar &bar_;
-  std::string mode_;
-  struct zriver_seat_status_v1 *seat_status_;
+  std::shared_ptr<Status> status_;
+  int subscription_ = -1;
+  util::StyleClasses mode_class_{label_};
 };
 
 } /* namespace waybar::modules::river */
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <wayland-client.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "river-control-unstable-v1-client-protocol.h"
+#include "river-status-unstable-v1-client-protocol.h"
+#include "util/shared_instance.hpp"
+
+namespace waybar::modules::river {
+
+/* The river status of the process: one status manager, one seat status, and one output status
+ * per output any module shows, for all the river modules of all the bars. The modules subscribe
+ * to it and read what they show from it.
+ */
+class Status {
+ private:
+  Status();
+
+ public:
+  ~Status();
+
+  enum class Change { FocusedOutput, FocusedView, Mode, Tags, Layout };
+
+  // What river last sent for one output
+  struct Output {
+    uint32_t focused_tags = 0;
+    uint32_t view_tags = 0;  // of all the views
+    uint32_t urgent_tags = 0;
+    std::optional<std::string> layout;  // none once cleared
+  };
+
+  using Handler = std::function<void(Change)>;
+
+  static std::shared_ptr<Status> getInstance() {
+    static util::SharedInstance<Status> instance;
+    return instance.get([] { return std::shared_ptr<Status>(new Status()); });
+  }
+
+  // The bound version of zriver_status_manager_v1, 0 when river doesn't advertise it
+  uint32_t version() const { return version_; }
+  struct wl_seat *seat() const { return seat_; }
+  struct zriver_control_v1 *control() const { return control_; }
+
+  /* on_change is called for the changes of the seat, and for those of output unless it is null.
+   * The first subscription of an output asks river for its status.
+   */
+  int subscribe(struct wl_output *output, Handler on_change);
+  void unsubscribe(int id);
+
+  struct wl_output *focusedOutput() const { return focused_output_; }
+  const std::string &focusedView() const { return focused_view_; }
+  const std::string &mode() const { return mode_; }
+  const Output &output(struct wl_output *output) const;
+
+  // Wayland event handlers
+  void handleFocusedOutput(struct wl_output *output);
+  void handleUnfocusedOutput(struct wl_output *output);
+  void handleFocusedView(const char *title);
+  void handleMode(const char *mode);
+  struct OutputStatus;
+  void handleOutputChange(OutputStatus &status, Change change);
+
+  struct zriver_status_manager_v1 *manager_ = nullptr;
+  uint32_t version_ = 0;
+  struct zriver_control_v1 *control_ = nullptr;
+  struct wl_seat *seat_ = nullptr;
+
+ private:
+  struct Subscriber {
+    int id;
+    struct wl_output *output;
+    Handler on_change;
+  };
+
+  void emit(Change change, struct wl_output *output);
+
+  struct zriver_seat_status_v1 *seat_status_ = nullptr;
+  struct wl_output *focused_output_ = nullptr;
+  std::string focused_view_;
+  std::string mode_;
+  // Boxed, their listeners point at them
+  std::vector<std::unique_ptr<OutputStatus>> outputs_;
+  std::vector<Subscriber> subscribers_;
+  int next_subscriber_id_ = 0;
+};
+
+struct Status::OutputStatus {
+  Status *owner;
+  struct wl_output *output;
+  struct zriver_output_status_v1 *status;
+  Output state;
+};
+
+}  // namespace waybar::modules::river
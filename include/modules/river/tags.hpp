@@ -5,8 +5,7 @@
 
 #include "AModule.hpp"
 #include "bar.hpp"
-#include "river-control-unstable-v1-client-protocol.h"
-#include "river-status-unstable-v1-client-protocol.h"
+#include "modules/river/status.hpp"
 #include "xdg-output-unstable-v1-client-protocol.h"
 
 namespace waybar::modules::river {
@@ -15,25 +14,26 @@ class Tags : public waybar::AModule {
  public:
   Tags(const std::string &, const waybar::Bar &, const Json::Value &);
   virtual ~Tags();
+  auto boundToOutput() const -> bool override { return true; }
 
-  // Handlers for wayland events
-  void handle_focused_tags(uint32_t tags);
-  void handle_view_tags(struct wl_array *tags);
-  void handle_urgent_tags(uint32_t tags);
+  auto update() -> void override;
 
-  void handle_show();
   void handle_primary_clicked(uint32_t tag);
   bool handle_button_press(GdkEventButton *event_button, uint32_t tag);
 
-  struct zriver_status_manager_v1 *status_manager_;
-  struct zriver_control_v1 *control_;
-  struct wl_seat *seat_;
-
  private:
   const waybar::Bar &bar_;
   Gtk::Box box_;
   std::vector<Gtk::Button> buttons_;
-  struct zriver_output_status_v1 *output_status_;
+  std::shared_ptr<Status> status_;
+  struct wl_output *output_ = nullptr;
+  int subscription_ = -1;
+
+  // The masks the buttons show
+  uint32_t shown_focused_tags_ = 0;
+  uint32_t shown_view_tags_ = 0;
+  uint32_t shown_urgent_tags_ = 0;
+  bool shown_ = false;
 };
 
 } /* namespace waybar::modules::river */
@@ -5,7 +5,7 @@
 
 #include "ALabel.hpp"
 #include "bar.hpp"
-#include "river-status-unstable-v1-client-protocol.h"
+#include "modules/river/status.hpp"
 #include "xdg-output-unstable-v1-client-protocol.h"
 
 namespace waybar::modules::river {
@@ -14,20 +14,18 @@ class Window : public waybar::ALabel {
  public:
   Window(const std::string &, const waybar::Bar &, const Json::Value &);
   virtual ~Window();
+  auto boundToOutput() const -> bool override { return true; }
 
-  // Handlers for wayland events
-  void handle_focused_view(const char *title);
-  void handle_focused_output(struct wl_output *output);
-  void handle_unfocused_output(struct wl_output *output);
-
-  struct zriver_status_manager_v1 *status_manager_;
-  struct wl_seat *seat_;
+  // Handlers for the changes of the river status
+  void handle_focused_view();
+  void handle_focused_output();
 
  private:
   const waybar::Bar &bar_;
-  struct wl_output *output_;          // stores the output this module belongs to
-  struct wl_output *focused_output_;  // stores the currently focused output
-  struct zriver_seat_status_v1 *seat_status_;
+  std::shared_ptr<Status> status_;
+  int subscription_ = -1;
+  struct wl_output *output_;  // stores the output this module belongs to
+  bool focused_ = false;      // whether the label has the focused class
 };
 
 } /* namespace waybar::modules::river */
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "ALabel.hpp"
+#include "util/scroll_accumulator.hpp"
 #include "util/sleeper_thread.hpp"
 
 namespace waybar::modules {
@@ -17,6 +18,7 @@ class Sndio : public ALabel {
   auto set_desc(struct sioctl_desc *, unsigned int) -> void;
   auto put_val(unsigned int, unsigned int) -> void;
   bool handleScroll(GdkEventScroll *) override;
+  void applyScroll(int steps);
   bool handleToggle(GdkEventButton *const &) override;
 
  private:
@@ -27,6 +29,7 @@ class Sndio : public ALabel {
   unsigned int addr_;
   unsigned int volume_, old_volume_, maxval_;
   bool muted_;
+  util::ScrollAccumulator scroll_;
 };
 
 }  // namespace waybar::modules
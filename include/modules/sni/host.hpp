@@ -3,22 +3,39 @@
 #include <dbus-status-notifier-watcher.h>
 #include <giomm.h>
 #include <glibmm/refptr.h>
-#include <json/json.h>
 
+#include <functional>
+#include <memory>
 #include <tuple>
+#include <vector>
 
-#include "bar.hpp"
-#include "modules/sni/item.hpp"
+#include "modules/sni/item_state.hpp"
+#include "util/shared_instance.hpp"
 
 namespace waybar::modules::SNI {
 
+/* The one StatusNotifierHost of the process, with the state of every registered item. The trays
+ * of all bars subscribe to it and make their own Item of each state.
+ */
 class Host {
+ private:
+  Host();
+
  public:
-  Host(const std::size_t id, const Json::Value&, const Bar&,
-       const std::function<void(std::unique_ptr<Item>&)>&,
-       const std::function<void(std::unique_ptr<Item>&)>&);
   ~Host();
 
+  using ItemHandler = std::function<void(const std::shared_ptr<ItemState>&)>;
+
+  using singleton = std::shared_ptr<Host>;
+  static singleton getInstance() {
+    static util::SharedInstance<Host> instance;
+    return instance.get([] { return std::shared_ptr<Host>(new Host()); });
+  }
+
+  // on_add is called with the items registered already too
+  int subscribe(ItemHandler on_add, ItemHandler on_remove);
+  void unsubscribe(int id);
+
  private:
   void busAcquired(const Glib::RefPtr<Gio::DBus::Connection>&, Glib::ustring);
   void nameAppeared(const Glib::RefPtr<Gio::DBus::Connection>&, Glib::ustring,
@@ -31,18 +48,23 @@ class Host {
 
   std::tuple<std::string, std::string> getBusNameAndObjectPath(const std::string);
   void addRegisteredItem(std::string service);
+  void removeItem(std::vector<std::shared_ptr<ItemState>>::iterator it);
+
+  struct Subscriber {
+    int id;
+    ItemHandler on_add;
+    ItemHandler on_remove;
+  };
 
-  std::vector<std::unique_ptr<Item>> items_;
+  std::vector<std::shared_ptr<ItemState>> items_;
+  std::vector<Subscriber> subscribers_;
+  int next_subscriber_id_ = 0;
   const std::string bus_name_;
   const std::string object_path_;
   std::size_t bus_name_id_;
-  std::size_t watcher_id_;
+  std::size_t watcher_id_ = 0;
   GCancellable* cancellable_ = nullptr;
   SnWatcher* watcher_ = nullptr;
-  const Json::Value& config_;
-  const Bar& bar_;
-  const std::function<void(std::unique_ptr<Item>&)> on_add_;
-  const std::function<void(std::unique_ptr<Item>&)> on_remove_;
 };
 
 }  // namespace waybar::modules::SNI
@@ -1,80 +1,59 @@
 #pragma once
 
-#include <dbus-status-notifier-item.h>
-#include <giomm/dbusproxy.h>
+#include <glibmm/main.h>
 #include <glibmm/refptr.h>
 #include <gtkmm/eventbox.h>
-#include <gtkmm/icontheme.h>
 #include <gtkmm/image.h>
 #include <gtkmm/menu.h>
 #include <json/json.h>
 #include <libdbusmenu-gtk/dbusmenu-gtk.h>
 #include <sigc++/trackable.h>
 
-#include <set>
-#include <string_view>
+#include <memory>
+#include <string>
 
 #include "bar.hpp"
+#include "modules/sni/item_state.hpp"
 
 namespace waybar::modules::SNI {
 
-struct ToolTip {
-  Glib::ustring icon_name;
-  Glib::ustring text;
-};
-
+/* The tray's view of an ItemState: its widgets, the icon at the tray's size and the menu. The
+ * trays of every bar show the same state.
+ */
 class Item : public sigc::trackable {
  public:
-  Item(const std::string&, const std::string&, const Json::Value&, const Bar&);
+  Item(std::shared_ptr<ItemState>, const Json::Value&, const Bar&);
   ~Item();
 
-  std::string bus_name;
-  std::string object_path;
+  const std::shared_ptr<ItemState> state;
 
   int icon_size;
   int effective_icon_size;
   Gtk::Image image;
   Gtk::EventBox event_box;
-  std::string category;
-  std::string id;
-
-  std::string title;
-  std::string icon_name;
-  Glib::RefPtr<Gdk::Pixbuf> icon_pixmap;
-  Glib::RefPtr<Gtk::IconTheme> icon_theme;
-  std::string overlay_icon_name;
-  std::string attention_icon_name;
-  std::string attention_movie_name;
-  std::string icon_theme_path;
-  std::string menu;
-  ToolTip tooltip;
   DbusmenuGtkMenu* dbus_menu = nullptr;
   Gtk::Menu* gtk_menu = nullptr;
-  /**
-   * ItemIsMenu flag means that the item only supports the context menu.
-   * Default value is true because libappindicator supports neither ItemIsMenu nor Activate method
-   * while compliant SNI implementation would always reset the flag to desired value.
-   */
-  bool item_is_menu = true;
+
+  // Emitted once the state is ready if it isn't yet, the item stays hidden until it is revealed
+  sigc::signal<void> signal_ready;
+  // Shows the item from now on, as its status says
+  void reveal();
 
  private:
   void onConfigure(GdkEventConfigure* ev);
-  void proxyReady(Glib::RefPtr<Gio::AsyncResult>& result);
-  void setProperty(const Glib::ustring& name, Glib::VariantBase& value);
-  void setStatus(const Glib::ustring& value);
-  void setCustomIcon(const std::string& id);
-  void getUpdatedProperties();
-  void processUpdatedProperties(Glib::RefPtr<Gio::AsyncResult>& result);
-  void onSignal(const Glib::ustring& sender_name, const Glib::ustring& signal_name,
-                const Glib::VariantContainerBase& arguments);
-
+  // Shows what the state says now
+  void onChanged();
   void updateImage();
-  Glib::RefPtr<Gdk::Pixbuf> extractPixBuf(GVariant* variant);
   Glib::RefPtr<Gdk::Pixbuf> getIconPixbuf();
   Glib::RefPtr<Gdk::Pixbuf> getIconByName(const std::string& name, int size);
   double getScaledIconSize();
   static void onMenuDestroyed(Item* self, GObject* old_menu_pointer);
+  /* The menu is built on the first click that opens it: dbusmenu fetches the whole layout and
+   * follows its changes from then on. It is released a while after it was last closed.
+   */
   void makeMenu();
+  void onMenuHidden();
+  void releaseMenu();
   bool handleClick(GdkEventButton* const& /*ev*/);
   bool handleScroll(GdkEventScroll* const&);
   bool handleMouseEnter(GdkEventCrossing* const&);
@@ -86,12 +65,21 @@ class Item : public sigc::trackable {
   gdouble distance_scrolled_y_ = 0;
   // visibility of items with Status == Passive
   bool show_passive_ = false;
+  // visibility the status asks for, applied once revealed
+  bool shown_ = false;
+  bool revealed_ = false;
+  bool ready_emitted_ = false;
+  // the status class and tooltip set on the event box
+  std::string status_;
+  std::string tooltip_markup_;
+  unsigned rendered_revision_ = 0;
+  int rendered_scale_ = 0;
+  // the object path gtk_menu was built for
+  std::string menu_path_;
+  static constexpr unsigned MENU_RELEASE_DELAY = 300;  // seconds
+  sigc::connection menu_release_;
 
   const Bar& bar_;
-
-  Glib::RefPtr<Gio::DBus::Proxy> proxy_;
-  Glib::RefPtr<Gio::Cancellable> cancellable_;
-  std::set<std::string_view> update_pending_;
 };
 
 }  // namespace waybar::modules::SNI
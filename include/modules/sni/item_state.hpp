@@ -0,0 +1,100 @@
+#pragma once
+
+#include <dbus-status-notifier-item.h>
+#include <gdkmm/pixbuf.h>
+#include <giomm/dbusproxy.h>
+#include <glibmm/refptr.h>
+#include <gtkmm/icontheme.h>
+#include <sigc++/signal.h>
+#include <sigc++/trackable.h>
+
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace waybar::modules::SNI {
+
+struct ToolTip {
+  Glib::ustring icon_name;
+  Glib::ustring text;
+};
+
+/* A tray application's item as it describes it: one proxy and one copy of the properties for
+ * the process, shown by the Item of each tray. Decoded icons are shared the same way.
+ */
+class ItemState : public sigc::trackable {
+ public:
+  ItemState(const std::string&, const std::string&);
+
+  const std::string bus_name;
+  const std::string object_path;
+
+  std::string category;
+  std::string id;
+
+  std::string title;
+  // Lowercase and dash-case, as the CSS class
+  std::string status;
+  std::string icon_name;
+  Glib::RefPtr<Gdk::Pixbuf> icon_pixmap;
+  Glib::RefPtr<Gtk::IconTheme> icon_theme;
+  std::string overlay_icon_name;
+  std::string attention_icon_name;
+  std::string attention_movie_name;
+  std::string icon_theme_path;
+  std::string menu;
+  ToolTip tooltip;
+  /**
+   * ItemIsMenu flag means that the item only supports the context menu.
+   * Default value is true because libappindicator supports neither ItemIsMenu nor Activate method
+   * while compliant SNI implementation would always reset the flag to desired value.
+   */
+  bool item_is_menu = true;
+
+  // The proxy brought the first properties, or failed to
+  bool ready() const { return ready_; }
+  // Whether it has the properties the spec requires
+  bool valid() const { return !id.empty() && !category.empty(); }
+  // Bumped when anything the icon is rendered from changes
+  unsigned iconRevision() const { return icon_revision_; }
+  // IconPixmap is decoded for icons this high on, once larger than the ones asked for before
+  void wantIconHeight(int height);
+  // Calls the method of the item, if the proxy is there
+  void call(const Glib::ustring& method, const Glib::VariantContainerBase& parameters);
+
+  // Once ready, and after every batch of changed properties
+  sigc::signal<void> signal_changed;
+
+ private:
+  void proxyReady(Glib::RefPtr<Gio::AsyncResult>& result);
+  void setProperty(const Glib::ustring& name, Glib::VariantBase& value);
+  void setStatus(const Glib::ustring& value);
+  void setCustomIcon(const std::string& id);
+  // Fetches properties with one GetAll shortly after, merged with the other requests until then
+  void requestUpdate(const std::set<std::string_view>& properties);
+  // Whether value differs from the last one seen for the property, which it becomes
+  bool changed(const Glib::ustring& name, const Glib::VariantBase& value);
+  void getUpdatedProperties();
+  void processUpdatedProperties(Glib::RefPtr<Gio::AsyncResult>& result);
+  void onSignal(const Glib::ustring& sender_name, const Glib::ustring& signal_name,
+                const Glib::VariantContainerBase& arguments);
+  Glib::RefPtr<Gdk::Pixbuf> extractPixBuf(GVariant* variant);
+
+  bool ready_ = false;
+  // the largest icon height a tray shows the item at
+  int wanted_height_ = 0;
+  // height icon_pixmap was extracted for, 0 if it isn't an IconPixmap
+  int pixmap_height_ = 0;
+  size_t pixmap_hash_ = 0;  // of the IconPixmap value it was extracted from
+  unsigned icon_revision_ = 1;
+
+  Glib::RefPtr<Gio::DBus::Proxy> proxy_;
+  Glib::RefPtr<Gio::Cancellable> cancellable_;
+  std::set<std::string_view> update_pending_;
+  std::set<std::string_view> update_fetching_;  // asked for by the GetAll in flight
+  // of the serialized value of each property, the values themselves can be large pixmaps
+  std::unordered_map<std::string, size_t> property_hashes_;
+};
+
+}  // namespace waybar::modules::SNI
@@ -5,6 +5,7 @@
 #include "AModule.hpp"
 #include "bar.hpp"
 #include "modules/sni/host.hpp"
+#include "modules/sni/item.hpp"
 #include "modules/sni/watcher.hpp"
 #include "util/json.hpp"
 
@@ -13,18 +14,26 @@ namespace waybar::modules::SNI {
 class Tray : public AModule {
  public:
   Tray(const std::string&, const Bar&, const Json::Value&);
-  virtual ~Tray() = default;
+  virtual ~Tray();
   auto update() -> void override;
 
  private:
-  void onAdd(std::unique_ptr<Item>& item);
-  void onRemove(std::unique_ptr<Item>& item);
+  void onAdd(const std::shared_ptr<ItemState>& state);
+  void onRemove(const std::shared_ptr<ItemState>& state);
+  void onReady(Item* item);
+  void revealReady();
 
-  static inline std::size_t nb_hosts_ = 0;
-  bool show_passive_ = false;
   Gtk::Box box_;
+  /* The items that got their icon, shown together shortly after the first: the apps of a login
+   * register within a second, this relayouts the bar once for them instead of for each.
+   */
+  std::vector<Item*> ready_;
+  sigc::connection reveal_connection_;
+  const Bar& bar_;
   SNI::Watcher::singleton watcher_;
-  SNI::Host host_;
+  SNI::Host::singleton host_;
+  int host_subscription_;
+  std::vector<std::unique_ptr<Item>> items_;
 };
 
 }  // namespace waybar::modules::SNI
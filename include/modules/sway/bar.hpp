@@ -41,7 +41,6 @@ class BarIpcClient {
 
   Bar& bar_;
   util::JsonParser parser_;
-  Ipc ipc_;
 
   swaybar_config bar_config_;
   std::string modifier_reset_;
@@ -50,10 +49,13 @@ class BarIpcClient {
   bool visible_by_urgency_ = false;
   std::atomic<bool> modifier_no_action_ = false;
 
-  SafeSignal<bool> signal_mode_;
-  SafeSignal<bool> signal_visible_;
-  SafeSignal<bool> signal_urgency_;
-  SafeSignal<swaybar_config> signal_config_;
+  // state updates, only the latest one matters
+  SafeSignal<bool> signal_mode_{SignalMode::Latest};
+  SafeSignal<bool> signal_visible_{SignalMode::Latest};
+  SafeSignal<bool> signal_urgency_{SignalMode::Latest};
+  SafeSignal<swaybar_config> signal_config_{SignalMode::Latest};
+  // last, so it unregisters before the members its handlers use are destroyed
+  Ipc ipc_;
 };
 
 }  // namespace modules::sway
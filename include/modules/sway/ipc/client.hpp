@@ -12,10 +12,22 @@
 #include <string>
 
 #include "ipc.hpp"
-#include "util/sleeper_thread.hpp"
+
+namespace Json {
+class Value;
+}
 
 namespace waybar::modules::sway {
 
+class IpcHub;
+struct TreeIndex;
+
+/* A lightweight handle on the process-wide sway IPC connection. Every handle shares one command
+ * socket and one event socket with a single reader thread. Events are only delivered to the
+ * handles that subscribed to their type, command replies only to the handle that sent the
+ * command. Signals are emitted from the reader thread for events, and from the calling thread
+ * for commands.
+ */
 class Ipc {
  public:
   Ipc();
@@ -25,6 +37,10 @@ class Ipc {
     uint32_t size;
     uint32_t type;
     std::string payload;
+    // GET_TREE replies only: the tree parsed once for all handles, see parseTree()
+    std::shared_ptr<const Json::Value> tree;
+    // and its index, see indexTree()
+    std::shared_ptr<const TreeIndex> index;
   };
 
   sigc::signal<void, const struct ipc_response &> signal_event;
@@ -32,22 +48,16 @@ class Ipc {
 
   void sendCmd(uint32_t type, const std::string &payload = "");
   void subscribe(const std::string &payload);
-  void handleEvent();
-  void setWorker(std::function<void()> &&func);
-
- protected:
-  static inline const std::string ipc_magic_ = "i3-ipc";
-  static inline const size_t ipc_header_size_ = ipc_magic_.size() + 8;
-
-  const std::string getSocketPath() const;
-  int open(const std::string &) const;
-  struct ipc_response send(int fd, uint32_t type, const std::string &payload = "");
-  struct ipc_response recv(int fd);
-
-  int fd_;
-  int fd_event_;
-  std::mutex mutex_;
-  util::SleeperThread thread_;
+  /* Delivers a GET_TREE reply on signal_cmd. From an event handler, the request is deferred until
+   * the queued events are handled, so a burst of events costs one fetch for all its requests.
+   */
+  void requestTree();
+
+ private:
+  friend class IpcHub;
+
+  uint32_t events_ = 0;       // event_mask() of the subscribed event types
+  bool treePending_ = false;  // requestTree() waiting for the end of the event burst
 };
 
 }  // namespace waybar::modules::sway
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <string>
+#include <string_view>
+
+namespace waybar::modules::sway {
+
+/* Parses a GET_TREE reply, keeping only the node fields the sway modules read (type, name, num,
+ * id, output, layout, focus/visibility flags, app_id, shell, marks, the window class/instance and
+ * the child lists). Everything else, rects, geometry, idle inhibitors and so on, is skipped in
+ * place without ever becoming a Json::Value.
+ * Throws std::runtime_error on malformed input.
+ */
+Json::Value parseTree(std::string_view payload);
+
+/* The nodes of a parsed tree the modules start from, found in one walk right after the parse, so
+ * a module reacting to an event doesn't walk the tree again. Points into the tree, which has to
+ * outlive it.
+ */
+struct TreeIndex {
+  const Json::Value* scratchpad = nullptr;  // the __i3_scratch workspace
+  const Json::Value* focused = nullptr;     // the focused window or workspace
+  // The workspace of the focused node, the node itself for a workspace
+  const Json::Value* focused_workspace = nullptr;
+  std::string focused_output;
+};
+
+TreeIndex indexTree(const Json::Value& tree);
+
+}  // namespace waybar::modules::sway
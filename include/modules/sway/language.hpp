@@ -1,7 +1,6 @@
 #pragma once
 
 #include <fmt/format.h>
-#include <xkbcommon/xkbregistry.h>
 
 #include <map>
 #include <string>
@@ -31,19 +30,6 @@ class Language : public ALabel, public sigc::trackable {
     std::string country_flag() const;
   };
 
-  class XKBContext {
-   public:
-    XKBContext();
-    ~XKBContext();
-    auto next_layout() -> Layout*;
-
-   private:
-    rxkb_context* context_ = nullptr;
-    rxkb_layout* xkb_layout_ = nullptr;
-    Layout* layout_ = nullptr;
-    std::map<std::string, rxkb_layout*> base_layouts_by_name_;
-  };
-
   void onEvent(const struct Ipc::ipc_response&);
   void onCmd(const struct Ipc::ipc_response&);
 
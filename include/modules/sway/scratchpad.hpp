@@ -30,6 +30,5 @@ class Scratchpad : public ALabel {
   int count_;
   std::mutex mutex_;
   Ipc ipc_;
-  util::JsonParser parser_;
 };
 }  // namespace waybar::modules::sway
@@ -9,6 +9,7 @@
 #include "client.hpp"
 #include "modules/sway/ipc/client.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
 
 namespace waybar::modules::sway {
 
@@ -25,9 +26,14 @@ class Window : public AAppIconLabel, public sigc::trackable {
   std::tuple<std::size_t, int, int, std::string, std::string, std::string, std::string, std::string,
              std::string>
   getFocusedNode(const Json::Value& nodes, std::string& output);
+  // The same from the index, when offscreen-css doesn't need the other workspaces
+  std::tuple<std::size_t, int, int, std::string, std::string, std::string, std::string, std::string,
+             std::string>
+  getFocusedNode(const TreeIndex& index);
   void getTree();
 
   const Bar& bar_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
   std::string window_;
   int windowId_;
   std::string app_id_;
@@ -38,7 +44,6 @@ class Window : public AAppIconLabel, public sigc::trackable {
   std::string shell_;
   std::string marks_;
   int floating_count_;
-  util::JsonParser parser_;
   std::mutex mutex_;
   Ipc ipc_;
 };
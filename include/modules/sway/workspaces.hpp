@@ -4,6 +4,7 @@
 #include <gtkmm/button.h>
 #include <gtkmm/label.h>
 
+#include <memory>
 #include <string_view>
 #include <unordered_map>
 
@@ -13,6 +14,7 @@
 #include "modules/sway/ipc/client.hpp"
 #include "util/json.hpp"
 #include "util/regex_collection.hpp"
+#include "util/widget_pool.hpp"
 
 namespace waybar::modules::sway {
 
@@ -50,8 +52,8 @@ class Workspaces : public AModule, public sigc::trackable {
   Gtk::Box box_;
   std::string m_formatWindowSeparator;
   util::RegexCollection m_windowRewriteRules;
-  util::JsonParser parser_;
-  std::unordered_map<std::string, Gtk::Button> buttons_;
+  std::unordered_map<std::string, std::unique_ptr<Gtk::Button>> buttons_;
+  util::WidgetPool<Gtk::Button> spare_buttons_;
   std::mutex mutex_;
   Ipc ipc_;
 };
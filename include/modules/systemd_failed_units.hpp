@@ -1,5 +1,6 @@
 #pragma once
 
+#include <giomm/cancellable.h>
 #include <giomm/dbusproxy.h>
 
 #include <string>
@@ -22,12 +23,21 @@ class SystemdFailedUnits : public ALabel {
   std::string system_state, user_state, overall_state;
   uint32_t nr_failed_system, nr_failed_user, nr_failed;
   std::string last_status;
+  uint32_t last_nr_failed;
   Glib::RefPtr<Gio::DBus::Proxy> system_proxy, user_proxy;
+  Glib::RefPtr<Gio::Cancellable> cancellable;
+  sigc::connection update_timer;
+  unsigned proxies_pending = 0;
+  unsigned requests_in_flight = 0;
+  bool requery = false;
 
   void notify_cb(const Glib::ustring &sender_name, const Glib::ustring &signal_name,
                  const Glib::VariantContainerBase &arguments);
-  void RequestFailedUnits();
-  void RequestSystemState();
+  void CreateProxy(const char *kind, Gio::DBus::BusType bus,
+                   Glib::RefPtr<Gio::DBus::Proxy> &proxy);
+  void RequestManagerState(const char *kind, const Glib::RefPtr<Gio::DBus::Proxy> &proxy,
+                           std::string &state, uint32_t &nr_failed_units);
+  void applyManagerStates();
   void updateData();
 };
 
@@ -2,26 +2,34 @@
 
 #include <fmt/format.h>
 
-#include <fstream>
+#include <memory>
 
 #include "ALabel.hpp"
-#include "util/sleeper_thread.hpp"
+#include "util/scheduler.hpp"
+#include "util/shared_sample.hpp"
 
 namespace waybar::modules {
 
+struct ThermalSensor;
+
 class Temperature : public ALabel {
  public:
   Temperature(const std::string&, const Json::Value&);
   virtual ~Temperature() = default;
   auto update() -> void override;
+  auto setPaused(bool paused) -> void override;
 
  private:
-  float getTemperature();
   bool isCritical(uint16_t);
   bool isWarning(uint16_t);
 
-  std::string file_path_;
-  util::SleeperThread thread_;
+#if defined(__FreeBSD__)
+  float getTemperature();
+  std::shared_ptr<util::SharedSample<float>> sample_;
+#else
+  std::shared_ptr<ThermalSensor> sensor_;  // shared with the modules reading the same sensor
+#endif
+  util::PeriodicTask timer_;
 };
 
 }  // namespace waybar::modules
@@ -4,9 +4,12 @@
 #include <gtkmm/icontheme.h>
 #include <libupower-glib/upower.h>
 
+#include <memory>
+#include <string>
 #include <unordered_map>
 
 #include "AIconLabel.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules {
 
@@ -28,25 +31,36 @@ class UPower final : public AIconLabel {
   Gtk::Box contentBox_;  // tooltip box
   std::string tooltipFormat_;
 
-  // UPower device info
+  // UPower device info, kept up to date from the notify signals
   struct upDevice_output {
     UpDevice *upDevice{NULL};
     double percentage{0.0};
     double temperature{0.0};
     guint64 time_full{0u};
     guint64 time_empty{0u};
-    gchar *icon_name{(char *)'\0'};
+    std::string icon_name;
     bool upDeviceValid{false};
-    UpDeviceState state;
-    UpDeviceKind kind;
-    char *nativePath{(char *)'\0'};
-    char *model{(char *)'\0'};
+    UpDeviceState state{UP_DEVICE_STATE_UNKNOWN};
+    UpDeviceKind kind{UP_DEVICE_KIND_UNKNOWN};
+    std::string nativePath;
+    std::string model;
+    // A shown property changed since its tooltip row was filled
+    bool tooltipDirty{true};
+  };
+
+  // Tooltip record of a device, refilled only when the device changed
+  struct TooltipRow {
+    std::unique_ptr<Gtk::Box> box;
+    Gtk::Image *iconDev;
+    Gtk::Label *labelDev;
+    Gtk::Image *iconState;
+    Gtk::Label *labelText;
   };
 
   // Technical variables
   std::string nativePath_;
   std::string model_;
-  std::string lastStatus_;
+  util::StyleClasses status_class_{box_};
   Glib::ustring label_markup_;
   std::mutex mutex_;
   Glib::RefPtr<Gtk::IconTheme> gtkTheme_;
@@ -56,8 +70,12 @@ class UPower final : public AIconLabel {
   void addDevice(UpDevice *);
   void removeDevice(const gchar *);
   void removeDevices();
+  void removeTooltipRow(const std::string &objectPath);
   void resetDevices();
   void setDisplayDevice();
+  void onDeviceNotify(UpDevice *, const gchar *property);
+  TooltipRow makeTooltipRow();
+  void fillTooltipRow(TooltipRow &, const upDevice_output &);
   const Glib::ustring getText(const upDevice_output &upDevice_, const std::string &format);
   bool queryTooltipCb(int, int, bool, const Glib::RefPtr<Gtk::Tooltip> &);
 
@@ -67,11 +85,12 @@ class UPower final : public AIconLabel {
   guint subscrID_{0u};
 
   // UPower variables
-  UpClient *upClient_;
+  UpClient *upClient_{NULL};  // made once the daemon appeared
   upDevice_output upDevice_;  // Device to display
   typedef std::unordered_map<std::string, upDevice_output> Devices;
   Devices devices_;
-  bool upRunning_{true};
+  std::unordered_map<std::string, TooltipRow> tooltipRows_;  // by device object path
+  bool upRunning_{false};
 
   // DBus callbacks
   void getConn_cb(Glib::RefPtr<Gio::AsyncResult> &result);
@@ -89,6 +108,8 @@ class UPower final : public AIconLabel {
   static void deviceNotify_cb(UpDevice *device, GParamSpec *pspec, gpointer user_data);
   // UPower secondary functions
   void getUpDeviceInfo(upDevice_output &upDevice_);
+  // Reads one property into the cache, whether it is shown and changed
+  static bool readProperty(upDevice_output &upDevice_, const gchar *property);
 };
 
 }  // namespace waybar::modules
@@ -47,6 +47,16 @@ struct State {
     size_t num_sticky_views;
   };
 
+  // The fields of a mapped toplevel view that are used, parsed once per view event
+  struct View {
+    size_t id;
+    size_t wset_idx;
+    int x, y;  // geometry origin, relative to the current workspace of the wset
+    bool sticky;
+    std::string title;
+    std::string app_id;
+  };
+
   struct Wset {
     std::optional<std::reference_wrapper<Output>> output;
     std::vector<Workspace> wss;
@@ -55,13 +65,13 @@ struct State {
 
     auto ws_idx() const { return ws_w * ws_y + ws_x; }
     auto count_ws(const Json::Value& pos) -> Workspace&;
-    auto locate_ws(const Json::Value& geo) -> Workspace&;
-    auto locate_ws(const Json::Value& geo) const -> const Workspace&;
+    auto locate_ws(const View& view) -> Workspace&;
+    auto locate_ws(const View& view) const -> const Workspace&;
   };
 
   std::unordered_map<std::string, Output> outputs;
   std::unordered_map<size_t, Wset> wsets;
-  std::unordered_map<size_t, Json::Value> views;
+  std::unordered_map<size_t, View> views;
   std::string focused_output_name;
   size_t maybe_empty_focus_wset_idx = {};
   size_t vswitch_sticky_view_id = {};
@@ -101,6 +111,7 @@ class IPC {
   IPC() { start(); }
 
   static auto connect() -> Sock;
+  // Reuses a buffer and a reader per thread, the event thread so does not allocate per message
   auto receive(Sock& sock) -> Json::Value;
   auto start() -> void;
   auto root_event_handler(const std::string& event, const Json::Value& data) -> void;
@@ -3,6 +3,8 @@
 #include "AAppIconLabel.hpp"
 #include "bar.hpp"
 #include "modules/wayfire/backend.hpp"
+#include "util/rewrite_string.hpp"
+#include "util/style_classes.hpp"
 
 namespace waybar::modules::wayfire {
 
@@ -11,7 +13,8 @@ class Window : public AAppIconLabel {
   EventHandler handler;
 
   const Bar& bar_;
-  std::string old_app_id_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
+  util::StyleClasses app_id_class_{const_cast<Bar&>(bar_).window};
 
  public:
   Window(const std::string& id, const Bar& bar, const Json::Value& config);
@@ -5,47 +5,50 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <optional>
 
 #include "ALabel.hpp"
+#include "util/scroll_accumulator.hpp"
+#include "util/wireplumber_context.hpp"
 
 namespace waybar::modules {
 
-class Wireplumber : public ALabel {
+class Wireplumber : public ALabel, private util::WireplumberContext::Listener {
  public:
   Wireplumber(const std::string&, const Json::Value&);
   virtual ~Wireplumber();
   auto update() -> void override;
 
  private:
-  void asyncLoadRequiredApiModules();
-  void prepare(waybar::modules::Wireplumber* self);
-  void activatePlugins();
   static void updateVolume(waybar::modules::Wireplumber* self, uint32_t id);
   static void updateNodeName(waybar::modules::Wireplumber* self, uint32_t id);
   static void updateSourceVolume(waybar::modules::Wireplumber* self, uint32_t id);
   static void updateSourceName(waybar::modules::Wireplumber* self, uint32_t id);  // NEW
-  static void onPluginActivated(WpObject* p, GAsyncResult* res, waybar::modules::Wireplumber* self);
-  static void onDefaultNodesApiLoaded(WpObject* p, GAsyncResult* res,
-                                      waybar::modules::Wireplumber* self);
-  static void onMixerApiLoaded(WpObject* p, GAsyncResult* res, waybar::modules::Wireplumber* self);
-  static void onObjectManagerInstalled(waybar::modules::Wireplumber* self);
-  static void onMixerChanged(waybar::modules::Wireplumber* self, uint32_t id);
-  static void onDefaultNodesApiChanged(waybar::modules::Wireplumber* self);
+  // WireplumberContext::Listener
+  void onContextReady() override;
+  bool watchesNode(uint32_t id) const override;
+  void onNodeMixerChanged(uint32_t id) override;
+  void onDefaultNodesChanged() override;
 
   bool handleScroll(GdkEventScroll* e) override;
+  void applyScroll(int steps);
 
-  static std::list<waybar::modules::Wireplumber*> modules;
-
-  WpCore* wp_core_;
-  GPtrArray* apis_;
+  std::shared_ptr<util::WireplumberContext> context_;
+  // owned by the context
   WpObjectManager* om_;
   WpPlugin* mixer_api_;
   WpPlugin* def_nodes_api_;
   gchar* default_node_name_;
-  uint32_t pending_plugins_;
   bool muted_;
   double volume_;
   double min_step_;
+  /* The volume last set by scrolling, until PipeWire reports it: the volumes reported meanwhile
+   * are the echoes of earlier steps. Given up on after a while, in case it is never reported.
+   */
+  std::optional<double> volume_set_;
+  std::chrono::steady_clock::time_point volume_set_at_;
+  util::ScrollAccumulator scroll_;
   uint32_t node_id_{0};
   std::string node_name_;
   std::string source_name_;
@@ -9,9 +9,11 @@
 #include <gtkmm/label.h>
 #include <wayland-client.h>
 
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -21,6 +23,8 @@
 #include "giomm/desktopappinfo.h"
 #include "util/icon_loader.hpp"
 #include "util/json.hpp"
+#include "util/rewrite_string.hpp"
+#include "util/string_map.hpp"
 #include "wlr-foreign-toplevel-management-unstable-v1-client-protocol.h"
 
 namespace waybar::modules::wlr {
@@ -66,6 +70,9 @@ class Task {
   Gtk::Label text_before_;
   Gtk::Label text_after_;
   Glib::RefPtr<Gio::DesktopAppInfo> app_info_;
+  // The app info icon_ was loaded for
+  Glib::RefPtr<Gio::DesktopAppInfo> icon_app_info_;
+  bool icon_loaded_ = false;
   bool button_visible_ = false;
   bool ignored_ = false;
 
@@ -80,6 +87,10 @@ class Task {
   std::string title_;
   std::string app_id_;
   uint32_t state_ = 0;
+  // The state the button classes show
+  uint32_t shown_state_ = 0;
+  // Set when something the texts show changed since the last update()
+  bool dirty_ = true;
 
   int32_t drag_start_x;
   int32_t drag_start_y;
@@ -91,6 +102,7 @@ class Task {
   void set_minimize_hint();
   void on_button_size_allocated(Gtk::Allocation &alloc);
   void hide_if_ignored();
+  void load_icon(const std::string &what);
 
  public:
   /* Getter functions */
@@ -145,15 +157,21 @@ class Taskbar : public waybar::AModule {
   Taskbar(const std::string &, const waybar::Bar &, const Json::Value &);
   ~Taskbar();
   void update();
+  auto boundToOutput() const -> bool override { return true; }
 
  private:
   const waybar::Bar &bar_;
   Gtk::Box box_;
-  std::vector<TaskPtr> tasks_;
+  struct wl_output *output_;
+  const bool all_outputs_;
+  std::list<TaskPtr> tasks_;
+  std::unordered_map<uint32_t, std::list<TaskPtr>::iterator> task_index_;
+  bool sort_pending_ = false;
 
   IconLoader icon_loader_;
   std::unordered_set<std::string> ignore_list_;
-  std::map<std::string, std::string> app_ids_replace_map_;
+  util::StringMap<std::string> app_ids_replace_map_;
+  std::shared_ptr<const util::RewriteRules> rewrite_;
 
   struct zwlr_foreign_toplevel_manager_v1 *manager_;
   struct wl_seat *seat_;
@@ -172,13 +190,16 @@ class Taskbar : public waybar::AModule {
   void move_button(Gtk::Button &, int);
   void remove_button(Gtk::Button &);
   void remove_task(uint32_t);
+  // Sorts the buttons by app_id on the next update, if configured
+  void request_sort();
 
   bool show_output(struct wl_output *) const;
   bool all_outputs() const;
 
   const IconLoader &icon_loader() const;
   const std::unordered_set<std::string> &ignore_list() const;
-  const std::map<std::string, std::string> &app_ids_replace_map() const;
+  const util::StringMap<std::string> &app_ids_replace_map() const;
+  const util::RewriteRules &rewrite_rules() const;
 };
 
 } /* namespace waybar::modules::wlr */
@@ -3,14 +3,17 @@
 #include <glibmm/dispatcher.h>
 #include <sigc++/signal.h>
 
+#include <atomic>
 #include <functional>
-#include <mutex>
-#include <queue>
+#include <memory>
 #include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
+#include "util/mpsc_ring.hpp"
+#include "util/trace.hpp"
+
 #ifdef __OpenBSD__
 #define SIGRTMIN SIGUSR1 - 1
 #define SIGRTMAX SIGUSR1 + 1
@@ -18,14 +21,27 @@
 
 namespace waybar {
 
+enum class SignalMode {
+  Queue,   // every emission is delivered, in order
+  Latest,  // only the latest value pending at handling time is delivered, for state updates
+};
+
 /**
  * Thread-safe signal wrapper.
- * Uses Glib::Dispatcher to pass events to another thread and locked queue to pass the arguments.
+ * Uses Glib::Dispatcher to pass events to another thread and a lock-free queue to pass the
+ * arguments. At most one dispatcher wakeup is pending at a time, a burst of emissions is handled on
+ * a single one.
  */
 template <typename... Args>
 struct SafeSignal : sigc::signal<void(std::decay_t<Args>...)> {
  public:
-  SafeSignal() { dp_.connect(sigc::mem_fun(*this, &SafeSignal::handle_event)); }
+  explicit SafeSignal(SignalMode mode = SignalMode::Queue) : mode_(mode) {
+    if (mode_ == SignalMode::Queue) {
+      queue_ = std::make_unique<util::MpscRing<arg_tuple_t>>(QUEUE_CAPACITY);
+    }
+    dp_.connect(sigc::mem_fun(*this, &SafeSignal::handle_event));
+  }
+  ~SafeSignal() { delete latest_.load(); }
 
   template <typename... EmitArgs>
   void emit(EmitArgs&&... args) {
@@ -39,11 +55,17 @@ struct SafeSignal : sigc::signal<void(std::decay_t<Args>...)> {
        */
       signal_t::emit(std::forward<EmitArgs>(args)...);
     } else {
-      {
-        std::unique_lock lock(mutex_);
-        queue_.emplace(std::forward<EmitArgs>(args)...);
+      if (mode_ == SignalMode::Latest) {
+        delete latest_.exchange(new arg_tuple_t(std::forward<EmitArgs>(args)...));
+      } else {
+        queue_->push(std::forward<EmitArgs>(args)...);
+      }
+      if (!pending_.exchange(true)) {
+        if (util::trace::enabled()) {
+          wakeup_requested_ = util::trace::Clock::now().time_since_epoch().count();
+        }
+        dp_.emit();
       }
-      dp_.emit();
     }
   }
 
@@ -60,18 +82,35 @@ struct SafeSignal : sigc::signal<void(std::decay_t<Args>...)> {
   using signal_t::emit_reverse;
   using signal_t::make_slot;
 
+  static constexpr size_t QUEUE_CAPACITY = 64;
+
   void handle_event() {
-    for (std::unique_lock lock(mutex_); !queue_.empty(); lock.lock()) {
-      auto args = queue_.front();
-      queue_.pop();
-      lock.unlock();
-      std::apply(cached_fn_, args);
+    // cleared first: anything emitted from here on either is handled below or wakes us up again
+    pending_.store(false);
+    if (util::trace::enabled()) {
+      util::trace::complete(
+          "SafeSignal wakeup", "signal",
+          util::trace::Clock::time_point(util::trace::Clock::duration(wakeup_requested_.load())),
+          util::trace::Clock::now());
+    }
+    util::trace::Span span("SafeSignal handle", "signal");
+    if (mode_ == SignalMode::Latest) {
+      if (std::unique_ptr<arg_tuple_t> args{latest_.exchange(nullptr)}) {
+        std::apply(cached_fn_, *args);
+      }
+      return;
+    }
+    while (queue_->consume([this](arg_tuple_t& args) { std::apply(cached_fn_, args); })) {
     }
   }
 
+  const SignalMode mode_;
   Glib::Dispatcher dp_;
-  std::mutex mutex_;
-  std::queue<arg_tuple_t> queue_;
+  std::unique_ptr<util::MpscRing<arg_tuple_t>> queue_;
+  std::atomic<arg_tuple_t*> latest_{nullptr};
+  std::atomic<bool> pending_{false};
+  // When the pending wakeup was asked for, only kept while tracing
+  std::atomic<util::trace::Clock::rep> wakeup_requested_{0};
   const std::thread::id main_tid_ = std::this_thread::get_id();
   // cache functor for signal emission to avoid recreating it on each event
   const slot_t cached_fn_ = make_slot();
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <json/value.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "util/string_map.hpp"
+
+namespace waybar::util {
+
+/* Runs the commands of a module's clicks, scrolls and updates on the spawn thread, each as the
+ * "exec-policy" of its event allows:
+ *  - "drop-if-running": not while the previous one of the event runs
+ *  - "queue-latest": after the previous one, only the latest of those that came in meanwhile
+ *  - "N/s": at most N a second, the ones in between are dropped
+ * Other events run every time. Used from the main thread.
+ */
+class ActionRunner {
+ public:
+  ActionRunner(const Json::Value& policies, bool direct);
+  ~ActionRunner();
+  ActionRunner(const ActionRunner&) = delete;
+  ActionRunner& operator=(const ActionRunner&) = delete;
+
+  void run(const std::string& event, const std::string& cmd);
+
+  // Waits for the commands started since the last call to exit, from any thread
+  void waitForChildren();
+
+ private:
+  enum class Policy { ALWAYS, DROP_IF_RUNNING, QUEUE_LATEST, RATE_LIMIT };
+  struct Action {
+    Policy policy = Policy::ALWAYS;
+    std::chrono::steady_clock::duration interval{};  // RATE_LIMIT
+    std::chrono::steady_clock::time_point next_start{};
+    bool running = false;
+    std::optional<std::string> queued;  // QUEUE_LATEST
+  };
+  // Shared with the callbacks of the children, which may outlive the runner
+  struct State {
+    std::mutex mutex;  // guards everything but actions, which is main thread only
+    std::condition_variable started;
+    int pending = 0;              // queued on the spawn thread, not started yet
+    std::vector<pid_t> children;  // started since the last waitForChildren()
+    std::vector<pid_t> running;   // killed with the runner
+    StringMap<Action> actions;
+  };
+
+  static void start(const std::shared_ptr<State>& state, const std::string& event,
+                    const std::string& cmd, bool direct);
+
+  const bool direct_;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace waybar::util
@@ -6,9 +6,15 @@
 #include <pulse/thread-mainloop.h>
 #include <pulse/volume.h>
 
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "util/backend_common.hpp"
 
@@ -19,10 +25,15 @@ class AudioBackend {
   static void subscribeCb(pa_context*, pa_subscription_event_type_t, uint32_t, void*);
   static void contextStateCb(pa_context*, void*);
   static void sinkInfoCb(pa_context*, const pa_sink_info*, int, void*);
+  static void sinkQueryCb(pa_context*, const pa_sink_info*, int, void*);
+  static void sinkInputInfoCb(pa_context*, const pa_sink_input_info*, int, void*);
   static void sourceInfoCb(pa_context*, const pa_source_info* i, int, void* data);
   static void serverInfoCb(pa_context*, const pa_server_info*, void*);
   static void volumeModifyCb(pa_context*, int, void*);
   void connectContext();
+  // Both with the mainloop locked
+  void querySink(uint32_t idx);
+  void setSinkVolume(const pa_cvolume& volume);
 
   pa_threaded_mainloop* mainloop_;
   pa_mainloop_api* mainloop_api_;
@@ -49,9 +60,23 @@ class AudioBackend {
   std::string source_desc_;
   std::string default_source_name_;
 
-  std::vector<std::string> ignored_sinks_;
+  std::unordered_set<std::string> ignored_sinks_;
 
-  std::function<void()> on_updated_cb_ = NOOP;
+  /* Pulse answers in order: the sinks queried by index are in flight in this order, and the ones
+   * that changed again meanwhile are queried once more when their answer is in. A burst of events
+   * about a sink so costs two queries.
+   */
+  std::deque<uint32_t> sink_queries_;
+  std::unordered_set<uint32_t> sink_requeries_;
+  // While a volume change is in flight, the latest one waits for it instead of queuing up
+  bool volume_in_flight_{false};
+  std::optional<pa_cvolume> next_volume_;
+
+  // Called from the pulse thread, with the mainloop locked
+  void notify();
+  std::mutex subscribers_mutex_;
+  std::vector<std::pair<int, std::function<void()>>> subscribers_;
+  int next_subscriber_id_ = 0;
 
   /* Hack to keep constructor inaccessible but still public.
    * This is required to be able to use std::make_shared.
@@ -62,16 +87,21 @@ class AudioBackend {
   struct private_constructor_tag {};
 
  public:
-  static std::shared_ptr<AudioBackend> getInstance(std::function<void()> on_updated_cb = NOOP);
+  /* One backend, with its pulse context and thread, for all the modules of every bar with the
+   * same ignored-sinks. It lives as long as one of them holds it.
+   */
+  static std::shared_ptr<AudioBackend> getInstance(const Json::Value& ignored_sinks);
 
-  AudioBackend(std::function<void()> on_updated_cb, private_constructor_tag tag);
+  AudioBackend(const Json::Value& ignored_sinks, private_constructor_tag tag);
   ~AudioBackend();
 
+  // on_updated is called from the pulse thread
+  int subscribe(std::function<void()> on_updated);
+  void unsubscribe(int id);
+
   void changeVolume(uint16_t volume, uint16_t min_volume = 0, uint16_t max_volume = 100);
   void changeVolume(ChangeType change_type, double step = 1, uint16_t max_volume = 100);
 
-  void setIgnoredSinks(const Json::Value& config);
-
   std::string getSinkPortName() const { return port_name_; }
   std::string getFormFactor() const { return form_factor_; }
   std::string getSinkDesc() const { return desc_; }
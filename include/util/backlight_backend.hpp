@@ -3,11 +3,15 @@
 #include <libudev.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "giomm/dbusproxy.h"
@@ -47,14 +51,17 @@ class BacklightDevice {
   bool powered_ = true;
 };
 
-class BacklightBackend {
+/* The backlight devices, shared by every backlight module of every bar: one enumeration, one
+ * udev monitor thread and one login1 proxy. It lives as long as one of its subscribers holds it.
+ */
+class BacklightBackend : public std::enable_shared_from_this<BacklightBackend> {
  public:
-  BacklightBackend(std::chrono::milliseconds interval, std::function<void()> on_updated_cb = NOOP);
+  // Polls at the shortest interval asked for by the modules holding it
+  static std::shared_ptr<BacklightBackend> getInstance(std::chrono::milliseconds interval);
 
-  // const inline BacklightDevice *get_best_device(std::string_view preferred_device);
-  const BacklightDevice *get_previous_best_device();
-
-  void set_previous_best_device(const BacklightDevice *device);
+  // on_updated is called from the udev thread whenever a device changed
+  int subscribe(std::function<void()> on_updated);
+  void unsubscribe(int id);
 
   void set_brightness(const std::string &preferred_device, ChangeType change_type, double step);
 
@@ -70,16 +77,26 @@ class BacklightBackend {
   std::mutex udev_thread_mutex_;
 
  private:
+  explicit BacklightBackend(std::chrono::milliseconds interval);
+
   void set_brightness_internal(const std::string &device_name, int brightness, int max_brightness);
+  void callSetBrightness(const std::string &device_name, int brightness);
+  void notify();
 
-  std::function<void()> on_updated_cb_;
-  std::chrono::milliseconds polling_interval_;
+  std::mutex subscribers_mutex_;
+  std::vector<std::pair<int, std::function<void()>>> subscribers_;
+  int next_subscriber_id_ = 0;
+  std::atomic<std::chrono::milliseconds::rep> polling_interval_;
 
-  std::optional<BacklightDevice> previous_best_;
   // thread must destruct before shared data
   util::SleeperThread udev_thread_;
 
   Glib::RefPtr<Gio::DBus::Proxy> login_proxy_;
+  /* SetBrightness goes out one call at a time, on the main thread: a slider drag asks for one a
+   * frame, and only the last one asked for while a call is out follows it.
+   */
+  bool brightness_in_flight_ = false;
+  std::optional<std::pair<std::string, int>> next_brightness_;
 
   static constexpr int EPOLL_MAX_EVENTS = 16;
 };
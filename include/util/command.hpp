@@ -2,21 +2,20 @@
 
 #include <fcntl.h>
 #include <giomm.h>
+#include <poll.h>
 #include <spdlog/spdlog.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
-#ifdef __linux__
-#include <sys/prctl.h>
-#endif
-#ifdef __FreeBSD__
-#include <sys/procctl.h>
-#endif
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <string>
 
-#include <array>
-
-extern std::mutex reap_mtx;
-extern std::list<pid_t> reap;
+#include "util/trace.hpp"
 
 namespace waybar::util::command {
 
@@ -25,14 +24,86 @@ struct res {
   std::string out;
 };
 
-inline std::string read(FILE* fp) {
-  std::array<char, 128> buffer = {0};
-  std::string output;
-  while (feof(fp) == 0) {
-    if (fgets(buffer.data(), 128, fp) != nullptr) {
-      output += buffer.data();
+/* Starts cmd in a new process group with an empty signal mask, through "/bin/sh -c". With
+ * direct, a cmd that is only plain words (no quotes, expansions, redirections...) is executed
+ * as its argv instead, without a shell. out and in, unless -1, become the child's stdout and
+ * stdin. deathsig kills the child with SIGTERM when waybar exits. The child runs on waybar's
+ * memory until it execs, instead of copying it like fork() would. Returns the pid, or -1.
+ */
+pid_t spawn(const std::string& cmd, int out, const std::string& output_name, bool deathsig,
+            bool direct, int in = -1);
+
+/* Reaps pid once it exits, for the children nobody waits for. On Linux it is watched through a
+ * pidfd on the main loop, elsewhere it is left to reapExited(). on_exit, if any, is then called
+ * on the main thread, also when someone else reaped the child. Thread safe: the watch is added
+ * from the main context.
+ */
+void reapLater(pid_t pid, std::function<void(pid_t)> on_exit = {});
+
+/* On SIGCHLD: reaps the exited children reapLater() couldn't watch. Not waitpid(-1), which
+ * would reap the children exec() and others are waiting for.
+ */
+void reapExited();
+
+/* forkExec() on the spawn thread shared by all modules, for the callers that mustn't wait for
+ * the fork, like input handlers. on_start gets the pid, or -1, on the spawn thread. on_exit gets
+ * it on the main thread once the child is gone, or right away if it couldn't be started.
+ */
+void forkExecAsync(std::string cmd, bool direct, std::function<void(pid_t)> on_start,
+                   std::function<void(pid_t)> on_exit);
+
+/* Reads the output of a child until it closes it. With a timeout, a child that is still at it
+ * by then has its process group killed, pid being the group leader, and the output so far is
+ * returned. So does it once stop_fd, unless -1, is readable: the SleeperThread::stopFd() of the
+ * thread reading.
+ */
+inline std::string read(FILE* fp, pid_t pid = -1,
+                        std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+                        int stop_fd = -1) {
+  const int fd = fileno(fp);
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const bool bounded = timeout > std::chrono::milliseconds::zero() && pid > 0;
+  std::string output(1024, '\0');
+  size_t size = 0;
+  while (true) {
+    if (bounded || stop_fd != -1) {
+      int wait = -1;
+      if (bounded) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        wait = std::max(0, static_cast<int>(left.count()));
+      }
+      struct pollfd pfds[2] = {{.fd = fd, .events = POLLIN, .revents = 0},
+                               {.fd = stop_fd, .events = POLLIN, .revents = 0}};
+      const int ret = wait != 0 ? poll(pfds, stop_fd != -1 ? 2 : 1, wait) : 0;
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret == 0) {
+        spdlog::warn("Cmd (pid {}) still running after {}ms, killing it", pid, timeout.count());
+        killpg(pid, SIGKILL);
+        break;
+      }
+      if (pfds[1].revents != 0) {
+        if (pid > 0) {
+          killpg(pid, SIGKILL);
+        }
+        break;
+      }
+    }
+    if (size == output.size()) {
+      output.resize(output.size() * 2);
     }
+    const auto got = ::read(fd, output.data() + size, output.size() - size);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      break;
+    }
+    size += got;
   }
+  output.resize(size);
 
   // Remove last newline
   if (!output.empty() && output[output.length() - 1] == '\n') {
@@ -69,7 +140,12 @@ inline int close(FILE* fp, pid_t pid) {
   return stat;
 }
 
-inline FILE* open(const std::string& cmd, int& pid, const std::string& output_name) {
+/* Starts cmd with its stdout on the returned stream. With in, its stdin is connected too and
+ * *in is set to the end to write to. That one is a socket, so that send() with MSG_NOSIGNAL
+ * reports a child that went away instead of raising SIGPIPE.
+ */
+inline FILE* open(const std::string& cmd, int& pid, const std::string& output_name,
+                  bool direct = false, int* in = nullptr) {
   if (cmd == "") return nullptr;
   int fd[2];
   // Open the pipe with the close-on-exec flag set, so it will not be inherited
@@ -81,93 +157,120 @@ inline FILE* open(const std::string& cmd, int& pid, const std::string& output_na
     return nullptr;
   }
 
-  pid_t child_pid = fork();
-
-  if (child_pid < 0) {
-    spdlog::error("Unable to exec cmd {}, error {}", cmd.c_str(), strerror(errno));
+  int stdin_fd[2] = {-1, -1};
+  if (in != nullptr && socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, stdin_fd) != 0) {
+    spdlog::error("Unable to create the stdin socket");
     ::close(fd[0]);
     ::close(fd[1]);
     return nullptr;
   }
 
-  if (!child_pid) {
-    int err;
-    sigset_t mask;
-    sigfillset(&mask);
-    // Reset sigmask
-    err = pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
-    if (err != 0) spdlog::error("pthread_sigmask in open failed: {}", strerror(err));
-    // Kill child if Waybar exits
-    int deathsig = SIGTERM;
-#ifdef __linux__
-    if (prctl(PR_SET_PDEATHSIG, deathsig) != 0) {
-      spdlog::error("prctl(PR_SET_PDEATHSIG) in open failed: {}", strerror(errno));
-    }
-#endif
-#ifdef __FreeBSD__
-    if (procctl(P_PID, 0, PROC_PDEATHSIG_CTL, reinterpret_cast<void*>(&deathsig)) == -1) {
-      spdlog::error("procctl(PROC_PDEATHSIG_CTL) in open failed: {}", strerror(errno));
-    }
-#endif
+  pid_t child_pid = spawn(cmd, fd[1], output_name, true, direct, stdin_fd[1]);
+  ::close(fd[1]);
+  if (stdin_fd[1] != -1) {
+    ::close(stdin_fd[1]);
+  }
+  if (child_pid < 0) {
     ::close(fd[0]);
-    dup2(fd[1], 1);
-    setpgid(child_pid, child_pid);
-    if (output_name != "") {
-      setenv("WAYBAR_OUTPUT_NAME", output_name.c_str(), 1);
+    if (stdin_fd[0] != -1) {
+      ::close(stdin_fd[0]);
     }
-    execlp("/bin/sh", "sh", "-c", cmd.c_str(), (char*)0);
-    exit(0);
-  } else {
-    ::close(fd[1]);
+    return nullptr;
   }
   pid = child_pid;
+  if (in != nullptr) {
+    *in = stdin_fd[0];
+  }
   return fdopen(fd[0], "r");
 }
 
-inline struct res exec(const std::string& cmd, const std::string& output_name) {
+// The exit status like a shell reports it, 128 + the signal for a killed command
+inline int exitCode(int stat) {
+  return WIFSIGNALED(stat) ? 128 + WTERMSIG(stat) : WEXITSTATUS(stat);
+}
+
+/* Reads the next line of a child's output from fd, without the newline. Whatever came after it
+ * is kept in pending for the next call. False on end of output, an error, when timeout, unless
+ * zero, passes before a whole line came, or once stop_fd, unless -1, is readable.
+ */
+inline bool readLine(int fd, std::string& pending, std::string& line,
+                     std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+                     int stop_fd = -1) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const bool bounded = timeout > std::chrono::milliseconds::zero();
+  size_t scanned = 0;
+  while (true) {
+    if (const auto end = pending.find('\n', scanned); end != std::string::npos) {
+      line.assign(pending, 0, end);
+      pending.erase(0, end + 1);
+      return true;
+    }
+    scanned = pending.size();
+    if (bounded || stop_fd != -1) {
+      int wait = -1;
+      if (bounded) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        wait = std::max(0, static_cast<int>(left.count()));
+      }
+      struct pollfd pfds[2] = {{.fd = fd, .events = POLLIN, .revents = 0},
+                               {.fd = stop_fd, .events = POLLIN, .revents = 0}};
+      const int ret = wait != 0 ? poll(pfds, stop_fd != -1 ? 2 : 1, wait) : 0;
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret == 0 || pfds[1].revents != 0) {
+        return false;
+      }
+    }
+    char buf[4096];
+    const auto got = ::read(fd, buf, sizeof(buf));
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    pending.append(buf, got);
+  }
+}
+
+inline struct res exec(const std::string& cmd, const std::string& output_name,
+                       bool direct = false,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+                       int stop_fd = -1) {
+  util::trace::Span span("exec", "process");
   int pid;
-  auto fp = command::open(cmd, pid, output_name);
+  auto fp = command::open(cmd, pid, output_name, direct);
   if (!fp) return {-1, ""};
-  auto output = command::read(fp);
+  auto output = command::read(fp, pid, timeout, stop_fd);
   auto stat = command::close(fp, pid);
-  return {WEXITSTATUS(stat), output};
+  return {exitCode(stat), output};
 }
 
-inline struct res execNoRead(const std::string& cmd) {
+inline struct res execNoRead(const std::string& cmd, bool direct = false,
+                             std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+                             int stop_fd = -1) {
+  util::trace::Span span("exec", "process");
   int pid;
-  auto fp = command::open(cmd, pid, "");
+  auto fp = command::open(cmd, pid, "", direct);
   if (!fp) return {-1, ""};
+  // drained, so that a chatty command doesn't block on a full pipe
+  command::read(fp, pid, timeout, stop_fd);
   auto stat = command::close(fp, pid);
-  return {WEXITSTATUS(stat), ""};
+  return {exitCode(stat), ""};
 }
 
-inline int32_t forkExec(const std::string& cmd) {
+// Starts cmd and reaps it once it exits. Thread safe.
+inline int32_t forkExec(const std::string& cmd, bool direct = false) {
   if (cmd == "") return -1;
 
-  pid_t pid = fork();
-
+  pid_t pid = spawn(cmd, -1, "", false, direct);
   if (pid < 0) {
-    spdlog::error("Unable to exec cmd {}, error {}", cmd.c_str(), strerror(errno));
     return pid;
   }
-
-  // Child executes the command
-  if (!pid) {
-    int err;
-    sigset_t mask;
-    sigfillset(&mask);
-    // Reset sigmask
-    err = pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
-    if (err != 0) spdlog::error("pthread_sigmask in forkExec failed: {}", strerror(err));
-    setpgid(pid, pid);
-    execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)0);
-    exit(0);
-  } else {
-    reap_mtx.lock();
-    reap.push_back(pid);
-    reap_mtx.unlock();
-    spdlog::debug("Added child to reap list: {}", pid);
-  }
+  util::trace::asyncBegin("forkExec", "process", pid);
+  reapLater(pid);
 
   return pid;
 }
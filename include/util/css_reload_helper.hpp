@@ -7,6 +7,7 @@
 
 #include "giomm/file.h"
 #include "giomm/filemonitor.h"
+#include "glibmm/main.h"
 #include "glibmm/refptr.h"
 
 struct pollfd;
@@ -16,15 +17,14 @@ class CssReloadHelper {
  public:
   CssReloadHelper(std::string cssFile, std::function<void()> callback);
 
-  virtual ~CssReloadHelper() = default;
+  virtual ~CssReloadHelper();
 
   virtual void monitorChanges();
 
  protected:
+  // The style file and everything it imports, directly or not
   std::vector<std::string> parseImports(const std::string& cssFile);
 
-  void parseImports(const std::string& cssFile, std::unordered_map<std::string, bool>& imports);
-
   void watchFiles(const std::vector<std::string>& files);
 
   bool handleInotifyEvents(int fd);
@@ -35,15 +35,40 @@ class CssReloadHelper {
 
   virtual std::string findPath(const std::string& filename);
 
+  // Whether files read differently than the last time they were compared, as of the last
+  // parseImports()
+  bool contentsChanged(const std::vector<std::string>& files);
+
   void handleFileChange(Glib::RefPtr<Gio::File> const& file,
                         Glib::RefPtr<Gio::File> const& other_type,
                         Gio::FileMonitorEvent event_type);
 
  private:
+  // Saves touch several files, or one file several times: only reload once they are quiet
+  static constexpr unsigned RELOAD_DELAY_MS = 100;
+  static constexpr size_t MAX_FILES = 100;
+
+  // What was found in a file, kept until its contents change
+  struct ParsedFile {
+    bool read = false;
+    size_t hash = 0;
+    std::vector<std::string> imports;
+  };
+
+  // The imports of cssFile, only searched again when it reads differently
+  const std::vector<std::string>& importsOf(const std::string& cssFile);
+  void reload();
+
   std::string m_cssFile;
 
   std::function<void()> m_callback;
 
-  std::vector<std::tuple<Glib::RefPtr<Gio::FileMonitor>>> m_fileMonitors;
+  std::unordered_map<std::string, Glib::RefPtr<Gio::FileMonitor>> m_fileMonitors;
+
+  std::vector<std::string> m_files;  // the watched files
+  std::unordered_map<std::string, ParsedFile> m_parsed;
+  size_t m_contentsHash = 0;
+
+  sigc::connection m_reloadTimer;
 };
 }  // namespace waybar
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <giomm/file.h>
+#include <giomm/filemonitor.h>
+#include <glibmm/refptr.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace waybar::util {
+
+/* Process-wide index of the .desktop files found in the `applications` directories of the XDG
+ * data dirs. The directories are walked once, lookups (including misses) are cached, and the
+ * whole index is invalidated when a file monitor reports a change in one of the directories.
+ * Meant to be used from the GTK main thread, which also dispatches the file monitor signals.
+ */
+class DesktopFileIndex {
+ public:
+  static DesktopFileIndex& inst();
+
+  /* Path of the first desktop file, in XDG data dir order, whose name ends with one of
+   * `suffixes`. Each data dir is searched for all of them, earlier suffixes first, before the next
+   * one is. With `ignore_case` the comparison is case-insensitive, otherwise the filename has to
+   * end with either a suffix or its lowercase form.
+   */
+  std::optional<std::string> findBySuffix(const std::vector<std::string>& suffixes,
+                                          bool ignore_case);
+
+  // Value of the "Icon" key of the given desktop file.
+  std::optional<std::string> getIconName(const std::string& desktop_file_path);
+
+  // Bumped each time the index is invalidated, so callers can keep derived caches in sync.
+  uint64_t generation() const { return generation_; }
+
+  // Builds the index now, which starts the monitors, for callers that only use generation().
+  void watch();
+
+ private:
+  DesktopFileIndex() = default;
+
+  struct Entry {
+    size_t dataDir;  // index in XDG data dir order
+    std::string filename;
+    std::string lowerFilename;
+    std::string path;
+  };
+
+  void ensureBuilt();
+  void watchDirectory(const std::string& path);
+  void handleDirectoryChange(Glib::RefPtr<Gio::File> const& file,
+                             Glib::RefPtr<Gio::File> const& other_file,
+                             Gio::FileMonitorEvent event_type);
+
+  std::mutex mutex_;
+  bool built_ = false;
+  std::atomic<uint64_t> generation_ = 0;
+  std::vector<Entry> entries_;
+  std::unordered_map<std::string, std::optional<std::string>> suffixCache_;
+  std::unordered_map<std::string, std::optional<std::string>> iconNameCache_;
+  std::unordered_map<std::string, Glib::RefPtr<Gio::FileMonitor>> monitors_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <giomm/file.h>
+#include <giomm/filemonitor.h>
+#include <sigc++/connection.h>
+
+#include <functional>
+#include <string>
+
+namespace waybar::util {
+
+/* Calls on_change on the main thread whenever the file at path is written, created, removed or
+ * replaced. Its directory is watched rather than the file, so the atomic saves that rename a new
+ * file over it are seen too, and a file that doesn't exist yet is picked up once it does.
+ * A burst of events, as a write in several chunks, makes one call. Made on the main thread.
+ */
+class FileWatch {
+ public:
+  // A leading ~ is the home directory
+  FileWatch(const std::string& path, std::function<void()> on_change);
+  ~FileWatch();
+  FileWatch(const FileWatch&) = delete;
+  FileWatch& operator=(const FileWatch&) = delete;
+
+  const std::string& path() const { return path_; }
+
+ private:
+  static constexpr unsigned SETTLE_MS = 20;
+
+  void onEvent(const Glib::RefPtr<Gio::File>& file, const Glib::RefPtr<Gio::File>& other,
+               Gio::FileMonitorEvent event);
+  bool isWatched(const Glib::RefPtr<Gio::File>& file) const;
+
+  std::string path_;
+  std::string name_;  // of the file in its directory
+  std::function<void()> on_change_;
+  Glib::RefPtr<Gio::FileMonitor> monitor_;
+  sigc::connection settle_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace waybar::util {
+
+/* The named placeholders of a fmt format string, read once so that modules can tell which of
+ * their arguments a format shows and skip computing the others. Placeholders in format specs,
+ * like the width in "{text:>{width}}", count too. A format with automatic or numbered
+ * placeholders ("{}", "{0}") may refer to any argument, so it uses them all.
+ */
+class FormatFields {
+ public:
+  FormatFields() = default;
+  explicit FormatFields(std::string_view format);
+
+  bool uses(std::string_view name) const;
+
+ private:
+  std::vector<std::string> names_;
+  bool positional_ = false;
+};
+
+}  // namespace waybar::util
@@ -19,16 +19,30 @@ class IconLoader {
   static std::vector<std::string> search_prefix();
   static Glib::RefPtr<Gio::DesktopAppInfo> get_app_info_by_name(const std::string &app_id);
   static Glib::RefPtr<Gio::DesktopAppInfo> get_desktop_app_info(const std::string &app_id);
+  static Glib::RefPtr<Gio::DesktopAppInfo> find_app_info_from_app_id_list(
+      const std::string &app_id_list);
   static Glib::RefPtr<Gdk::Pixbuf> load_icon_from_file(std::string const &icon_path, int size);
   static std::string get_icon_name_from_icon_theme(const Glib::RefPtr<Gtk::IconTheme> &icon_theme,
                                                    const std::string &app_id);
   static bool image_load_icon(Gtk::Image &image, const Glib::RefPtr<Gtk::IconTheme> &icon_theme,
                               Glib::RefPtr<Gio::DesktopAppInfo> app_info, int size);
+  static Cairo::RefPtr<Cairo::Surface> render_icon(Gtk::Image &image,
+                                                   const Glib::RefPtr<Gtk::IconTheme> &icon_theme,
+                                                   const Glib::RefPtr<Gio::DesktopAppInfo> &app_info,
+                                                   int size);
 
  public:
+  ~IconLoader();
   void add_custom_icon_theme(const std::string &theme_name);
+  /* Sets the icon of app_info, or "unknown", on image, from the first theme that has it. The
+   * rendered icons are shared by all loaders and kept until their theme changes.
+   */
   bool image_load_icon(Gtk::Image &image, Glib::RefPtr<Gio::DesktopAppInfo> app_info,
                        int size) const;
+  /* The desktop app info of the first app id of the space separated list that has one, null if
+   * none has. Results, misses included, are cached for the whole process until the desktop
+   * files change. Thread safe.
+   */
   static Glib::RefPtr<Gio::DesktopAppInfo> get_app_info_from_app_id_list(
       const std::string &app_id_list);
 };
@@ -7,7 +7,10 @@
 #include <codecvt>
 #include <iostream>
 #include <locale>
-#include <regex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 #if (FMT_VERSION >= 90000)
 
@@ -18,30 +21,42 @@ struct fmt::formatter<Json::Value> : ostream_formatter {};
 
 namespace waybar::util {
 
+/* Parses IPC replies and events, config files. The reader and the scratch buffer of "\x" escape
+ * replacement are per thread and reused between parses, so a parse allocates for the tree only.
+ */
 class JsonParser {
  public:
   JsonParser() = default;
 
   Json::Value parse(const std::string& jsonStr) {
-    Json::Value root;
+    thread_local const std::unique_ptr<Json::CharReader> reader{
+        Json::CharReaderBuilder().newCharReader()};
+    thread_local std::string escaped;
 
     // replace all occurrences of "\x" with "\u00", because JSON doesn't allow "\x" escape sequences
-    std::string modifiedJsonStr = replaceHexadecimalEscape(jsonStr);
+    std::string_view text = jsonStr;
+    if (jsonStr.find("\\x") != std::string::npos) {
+      replaceHexadecimalEscape(jsonStr, escaped);
+      text = escaped;
+    }
 
-    std::istringstream jsonStream(modifiedJsonStr);
+    Json::Value root;
     std::string errs;
-    if (!Json::parseFromStream(m_readerBuilder, jsonStream, &root, &errs)) {
+    if (!reader->parse(text.data(), text.data() + text.size(), &root, &errs)) {
       throw std::runtime_error("Error parsing JSON: " + errs);
     }
     return root;
   }
 
  private:
-  Json::CharReaderBuilder m_readerBuilder;
-
-  static std::string replaceHexadecimalEscape(const std::string& str) {
-    static std::regex re("\\\\x");
-    return std::regex_replace(str, re, "\\u00");
+  static void replaceHexadecimalEscape(const std::string& str, std::string& out) {
+    out.clear();
+    size_t start = 0;
+    for (size_t pos; (pos = str.find("\\x", start)) != std::string::npos; start = pos + 2) {
+      out.append(str, start, pos - start);
+      out += "\\u00";
+    }
+    out.append(str, start);
   }
 };
 }  // namespace waybar::util
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace waybar::util {
+
+/* Pull parser for JSON text, for readers that only want a few members of a known layout: values
+ * are consumed one by one, and the ones that aren't wanted are skipped in place without ever
+ * becoming a Json::Value. Like JsonParser, "\xXX" escapes are accepted and read as "\u00XX".
+ * Errors throw std::runtime_error, prefixed with the name of what is parsed.
+ */
+class JsonScanner {
+ public:
+  explicit JsonScanner(const char* what, std::string_view input = {}) : what_{what}, in_{input} {}
+
+  // Starts over on new input, keeping the buffers
+  void reset(std::string_view input) {
+    in_ = input;
+    pos_ = 0;
+  }
+
+  [[noreturn]] void fail(const char* what) const {
+    throw std::runtime_error("Error parsing " + std::string(what_) + ": " + what + " at offset " +
+                             std::to_string(pos_));
+  }
+
+  // The next non blank character, which is not consumed
+  char peek() {
+    skipWs();
+    if (pos_ >= in_.size()) {
+      fail("unexpected end");
+    }
+    return in_[pos_];
+  }
+
+  void expect(char c) {
+    if (peek() != c) {
+      fail("unexpected character");
+    }
+    ++pos_;
+  }
+
+  // Fails unless only blanks are left
+  void expectEnd() {
+    skipWs();
+    if (pos_ != in_.size()) {
+      fail("trailing data");
+    }
+  }
+
+  // Calls fn once per member with the decoded key, fn has to consume the value.
+  template <typename Fn>
+  void parseObject(Fn&& fn) {
+    expect('{');
+    if (peek() == '}') {
+      ++pos_;
+      return;
+    }
+    while (true) {
+      parseString(key_);
+      expect(':');
+      fn(std::string_view(key_));
+      if (peek() == ',') {
+        ++pos_;
+        continue;
+      }
+      expect('}');
+      return;
+    }
+  }
+
+  // Calls fn once per element, fn has to consume it.
+  template <typename Fn>
+  void parseArray(Fn&& fn) {
+    expect('[');
+    if (peek() == ']') {
+      ++pos_;
+      return;
+    }
+    while (true) {
+      fn();
+      if (peek() == ',') {
+        ++pos_;
+        continue;
+      }
+      expect(']');
+      return;
+    }
+  }
+
+  void parseValue(Json::Value& out) {
+    switch (peek()) {
+      case '{':
+        out = Json::Value(Json::objectValue);
+        parseObject([&](std::string_view key) { parseValue(out[std::string(key)]); });
+        break;
+      case '[':
+        out = Json::Value(Json::arrayValue);
+        parseArray([&] { parseValue(out.append(Json::Value())); });
+        break;
+      case '"': {
+        std::string str;
+        parseString(str);
+        out = std::move(str);
+        break;
+      }
+      case 't':
+        literal("true");
+        out = true;
+        break;
+      case 'f':
+        literal("false");
+        out = false;
+        break;
+      case 'n':
+        literal("null");
+        out = Json::Value();
+        break;
+      default:
+        parseNumber(out);
+    }
+  }
+
+  void skipValue() {
+    switch (peek()) {
+      case '{':
+        parseObject([&](std::string_view) { skipValue(); });
+        break;
+      case '[':
+        parseArray([&] { skipValue(); });
+        break;
+      case '"':
+        skipString();
+        break;
+      case 't':
+        literal("true");
+        break;
+      case 'f':
+        literal("false");
+        break;
+      case 'n':
+        literal("null");
+        break;
+      default: {
+        Json::Value ignored;
+        parseNumber(ignored);
+      }
+    }
+  }
+
+  void parseNumber(Json::Value& out) {
+    skipWs();
+    const size_t start = pos_;
+    bool integral = true;
+    while (pos_ < in_.size()) {
+      const char c = in_[pos_];
+      if (c == '.' || c == 'e' || c == 'E') {
+        integral = false;
+      } else if (!(c == '-' || c == '+' || (c >= '0' && c <= '9'))) {
+        break;
+      }
+      ++pos_;
+    }
+    if (start == pos_) {
+      fail("unexpected character");
+    }
+    const char* first = in_.data() + start;
+    const char* last = in_.data() + pos_;
+    if (integral) {
+      int64_t value = 0;
+      if (std::from_chars(first, last, value).ec == std::errc()) {
+        out = static_cast<Json::Int64>(value);
+        return;
+      }
+    }
+    out = std::strtod(std::string(first, last).c_str(), nullptr);
+  }
+
+  // Decodes the string value at the current position into out
+  void parseString(std::string& out) {
+    expect('"');
+    out.clear();
+    while (true) {
+      // copy the run up to the next quote or escape in one go
+      const size_t end = in_.find_first_of("\"\\", pos_);
+      if (end == std::string_view::npos) {
+        fail("unterminated string");
+      }
+      out.append(in_.data() + pos_, end - pos_);
+      pos_ = end + 1;
+      if (in_[end] == '"') {
+        return;
+      }
+      if (pos_ >= in_.size()) {
+        fail("unterminated string");
+      }
+      const char esc = in_[pos_++];
+      switch (esc) {
+        case '"':
+        case '\\':
+        case '/':
+          out += esc;
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'x':
+          appendUtf8(out, hex(2));
+          break;
+        case 'u': {
+          unsigned cp = hex(4);
+          if (cp >= 0xD800 && cp < 0xDC00 && in_.substr(pos_, 2) == "\\u") {
+            pos_ += 2;
+            const unsigned low = hex(4);
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          }
+          appendUtf8(out, cp);
+          break;
+        }
+        default:
+          fail("invalid escape");
+      }
+    }
+  }
+
+ private:
+  void skipWs() {
+    while (pos_ < in_.size() &&
+           (in_[pos_] == ' ' || in_[pos_] == '\n' || in_[pos_] == '\r' || in_[pos_] == '\t')) {
+      ++pos_;
+    }
+  }
+
+  void literal(std::string_view word) {
+    if (in_.substr(pos_, word.size()) != word) {
+      fail("invalid literal");
+    }
+    pos_ += word.size();
+  }
+
+  void skipString() {
+    expect('"');
+    while (pos_ < in_.size()) {
+      const char c = in_[pos_++];
+      if (c == '"') {
+        return;
+      }
+      if (c == '\\') {
+        ++pos_;
+      }
+    }
+    fail("unterminated string");
+  }
+
+  unsigned hex(size_t digits) {
+    if (pos_ + digits > in_.size()) {
+      fail("truncated escape");
+    }
+    unsigned value = 0;
+    for (size_t i = 0; i < digits; ++i) {
+      const char c = in_[pos_++];
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        value |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        value |= c - 'A' + 10;
+      } else {
+        fail("invalid escape");
+      }
+    }
+    return value;
+  }
+
+  static void appendUtf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  const char* what_;
+  std::string_view in_;
+  size_t pos_ = 0;
+  std::string key_;  // reused for every member name
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+/* Logging for the hot paths, as the IPC threads reading every event. spdlog::debug() checks the
+ * level at run time, but only after its arguments are built: these calls build them only when
+ * the message is logged, and are empty below the -Dlog-level the build was configured with.
+ */
+#define WAYBAR_LOG(level, ...)         \
+  do {                                 \
+    if (spdlog::should_log(level)) {   \
+      spdlog::log(level, __VA_ARGS__); \
+    }                                  \
+  } while (false)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define WAYBAR_LOG_TRACE(...) WAYBAR_LOG(spdlog::level::trace, __VA_ARGS__)
+#else
+#define WAYBAR_LOG_TRACE(...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define WAYBAR_LOG_DEBUG(...) WAYBAR_LOG(spdlog::level::debug, __VA_ARGS__)
+#else
+#define WAYBAR_LOG_DEBUG(...) (void)0
+#endif
+
+namespace waybar::util::log {
+
+// Moves the default logger's output to a thread of its own, for --log-async. A slow stderr, as
+// the journal of a user service, then drops the oldest messages instead of blocking the callers.
+void makeAsync();
+
+// Writes the messages queued so far, before the exit. The default logger is synchronous after.
+void flush();
+
+}  // namespace waybar::util::log
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+namespace waybar::util::memory {
+
+/* Where waybar's memory goes. The numbers are 0 where they can't be had: heapInUse() needs
+ * glibc's mallinfo2(), residentSize() /proc/self/statm.
+ */
+
+// Bytes malloc() handed out and that aren't freed yet, the same over all threads
+size_t heapInUse();
+
+// Bytes of the process in RAM
+size_t residentSize();
+
+// Gives the free memory at the top and inside of the heap back to the kernel, with glibc
+void trim();
+
+}  // namespace waybar::util::memory
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <utility>
+
+namespace waybar::util {
+
+/**
+ * Bounded multi-producer single-consumer queue, after D. Vyukov's sequence-numbered ring.
+ * push() takes no lock while there is room. When the ring is full, items go to a locked overflow
+ * queue instead of blocking the producer; items of one producer are still consumed in order.
+ */
+template <typename T>
+class MpscRing {
+ public:
+  // capacity is rounded up to a power of two
+  explicit MpscRing(size_t capacity)
+      : capacity_{std::bit_ceil(capacity)},
+        mask_{capacity_ - 1},
+        slots_{std::make_unique<Slot[]>(capacity_)} {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename... A>
+  void push(A&&... args) {
+    if (!overflowing_.load(std::memory_order_acquire) && tryPush(std::forward<A>(args)...)) {
+      return;
+    }
+    std::lock_guard lock(mutex_);
+    // stay on the overflow until the consumer has emptied it, to keep the order
+    overflowing_.store(true, std::memory_order_release);
+    overflow_.emplace(std::forward<A>(args)...);
+  }
+
+  /**
+   * Consumer only. Calls fn with the oldest item and discards it afterwards; ring items are passed
+   * in place. fn may call consume() again. Returns false if there was nothing to consume.
+   */
+  template <typename Fn>
+  bool consume(Fn&& fn) {
+    if (consumeRing(fn)) {
+      return true;
+    }
+    if (!overflowing_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::unique_lock lock(mutex_);
+    if (ringReady()) {
+      // pushed before the overflow started, comes first
+      lock.unlock();
+      return consumeRing(fn);
+    }
+    if (overflow_.empty()) {
+      overflowing_.store(false, std::memory_order_release);
+      return false;
+    }
+    T item = std::move(overflow_.front());
+    overflow_.pop();
+    lock.unlock();
+    fn(item);
+    return true;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    std::optional<T> value;
+  };
+
+  template <typename... A>
+  bool tryPush(A&&... args) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const size_t seq = slot.seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.value.emplace(std::forward<A>(args)...);
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool ringReady() const {
+    return slots_[head_ & mask_].seq.load(std::memory_order_acquire) == head_ + 1;
+  }
+
+  template <typename Fn>
+  bool consumeRing(Fn& fn) {
+    if (!ringReady()) {
+      return false;
+    }
+    // the slot is only handed back to producers once fn returns, a nested consume() moves on
+    struct Release {
+      Slot& slot;
+      size_t seq;
+      ~Release() {
+        slot.value.reset();
+        slot.seq.store(seq, std::memory_order_release);
+      }
+    } release{slots_[head_ & mask_], head_ + capacity_};
+    ++head_;
+    fn(*release.slot.value);
+    return true;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> tail_{0};  // next slot for producers
+  alignas(64) size_t head_ = 0;              // next slot for the consumer
+  std::atomic<bool> overflowing_{false};
+  std::mutex mutex_;  // guards overflow_
+  std::queue<T> overflow_;
+};
+
+}  // namespace waybar::util
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <pipewire/pipewire.h>
+#include <sigc++/signal.h>
 
+#include <mutex>
 #include <unordered_map>
 
 #include "util/backend_common.hpp"
@@ -27,13 +29,19 @@ class PipewireBackend {
   struct PrivateConstructorTag {};
 
  public:
-  sigc::signal<void> privacy_nodes_changed_signal_event;
+  /* Emitted from the PipeWire thread when a node starts or stops running, or changes its
+   * properties while running. Nodes that merely idle or suspend are not reported.
+   */
+  sigc::signal<void(const PrivacyNodeSnapshot&)> privacy_node_changed_signal_event;
 
   std::unordered_map<uint32_t, PrivacyNodeInfo*> privacy_nodes;
   std::mutex mutex_;
 
   static std::shared_ptr<PipewireBackend> getInstance();
 
+  // Connects the slot and replays the nodes already running to it
+  sigc::connection subscribe(const sigc::slot<void(const PrivacyNodeSnapshot&)>& slot);
+
   // Handlers for PipeWire events
   void handleRegistryEventGlobal(uint32_t id, uint32_t permissions, const char* type,
                                  uint32_t version, const struct spa_dict* props);
@@ -2,6 +2,7 @@
 
 #include <pipewire/pipewire.h>
 
+#include <map>
 #include <string>
 
 #include "util/gtk_icon.hpp"
@@ -15,6 +16,19 @@ enum PrivacyNodeType {
   PRIVACY_NODE_TYPE_AUDIO_OUTPUT
 };
 
+// What the privacy modules know of a node, copied out of the PipeWire thread
+struct PrivacyNodeSnapshot {
+  uint32_t id;
+  PrivacyNodeType type;
+  bool active;  // running, false once it stopped or went away
+  bool is_monitor;
+  std::string node_name;
+  std::string name;
+  std::string icon_name;
+};
+
+using PrivacyNodes = std::map<uint32_t, PrivacyNodeSnapshot>;
+
 class PrivacyNodeInfo {
  public:
   PrivacyNodeType type = PRIVACY_NODE_TYPE_NONE;
@@ -26,6 +40,8 @@ class PrivacyNodeInfo {
   std::string node_name;
   std::string application_name;
   bool is_monitor = false;
+  // Whether it was last reported running
+  bool active = false;
 
   std::string pipewire_access_portal_app_id;
   std::string application_icon_name;
@@ -35,12 +51,25 @@ class PrivacyNodeInfo {
 
   void *data;
 
-  std::string getName();
-  std::string getIconName();
+  // Resolved when the properties change, not on each query
+  const std::string &getName() const { return name; }
+  const std::string &getIconName() const { return icon_name; }
+
+  PrivacyNodeSnapshot snapshot() const;
 
   // Handlers for PipeWire events
   void handleProxyEventDestroy();
-  void handleNodeEventInfo(const struct pw_node_info *info);
+  // Whether the privacy modules have to hear about it
+  bool handleNodeEventInfo(const struct pw_node_info *info);
+
+ private:
+  static constexpr const char *UNKNOWN_NAME = "Unknown Application";
+  static constexpr const char *UNKNOWN_ICON_NAME = "application-x-executable-symbolic";
+
+  std::string name = UNKNOWN_NAME;
+  std::string icon_name = UNKNOWN_ICON_NAME;
+
+  void resolveNames();
 };
 
 }  // namespace waybar::util::PipewireBackend
@@ -14,6 +14,7 @@ enum class Appearance {
 class Portal : private Gio::DBus::Proxy {
  public:
   Portal();
+  // Asynchronous, signal_appearance_changed() tells the result
   void refreshAppearance();
   Appearance getAppearance();
 
@@ -23,6 +24,8 @@ class Portal : private Gio::DBus::Proxy {
  private:
   type_signal_appearance_changed m_signal_appearance_changed;
   Appearance currentMode;
+  bool signalled_ = false;  // a SettingChanged of the appearance came
+  void onAppearanceRead(const Glib::RefPtr<Gio::AsyncResult>& result);
   void on_signal(const Glib::ustring& sender_name, const Glib::ustring& signal_name,
                  const Glib::VariantContainerBase& parameters);
 };
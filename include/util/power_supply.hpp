@@ -0,0 +1,12 @@
+#pragma once
+
+#include <filesystem>
+
+namespace waybar::util {
+
+/* Whether the system runs on its battery: it has one, and no mains or USB supply is online.
+ * Peripheral batteries (scope Device) don't count, and without a battery it's always false.
+ */
+bool onBatteryPower(const std::filesystem::path& power_supplies = "/sys/class/power_supply");
+
+}  // namespace waybar::util
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <json/value.h>
+
+namespace waybar::util {
+
+/* The "background-priority" of the module threads, and the scripts they run, which inherit it.
+ * The GTK main thread, the IPC threads and the click actions keep the priority of waybar, so
+ * the bar stays responsive while the polling yields to the foreground work. Linux only: a
+ * thread has a priority of its own there, elsewhere it's the one of the process.
+ */
+struct Priority {
+  int nice = 0;
+  bool idle = false;  // SCHED_IDLE and the idle I/O class: only what nothing else wants
+};
+
+// "idle", or a nice value from 1 to 19. Anything else is the normal priority.
+Priority parsePriority(const Json::Value& config);
+
+// For the threads started from now on
+void setBackgroundPriority(Priority priority);
+// Called by the thread itself, as it starts
+void applyBackgroundPriority();
+
+}  // namespace waybar::util
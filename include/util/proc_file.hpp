@@ -0,0 +1,52 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace waybar::util {
+
+/* A procfs or sysfs file kept open between samples. read() preads it from offset 0, which makes
+ * the kernel generate fresh contents, into a buffer reused between calls. The file is (re)opened
+ * lazily, so one that is missing at first is picked up once it appears.
+ */
+class ProcFile {
+ public:
+  explicit ProcFile(std::string path);
+  ~ProcFile();
+  ProcFile(const ProcFile&) = delete;
+  ProcFile& operator=(const ProcFile&) = delete;
+
+  // The whole file, valid until the next read(). Throws std::runtime_error if it can't be read.
+  std::string_view read();
+  // Same as read(), for optional files: nothing if the file can't be read
+  std::optional<std::string_view> tryRead();
+  const std::string& path() const { return path_; }
+
+ private:
+  static constexpr size_t INITIAL_SIZE = 4096;
+
+  int readAll(std::string_view& out);  // 0 or an errno
+
+  std::string path_;
+  int fd_ = -1;
+  std::string buf_;
+};
+
+// Parses the unsigned number starting after any blanks in in, and advances in past it.
+template <typename T>
+bool nextNumber(std::string_view& in, T& out) {
+  const auto start = in.find_first_not_of(" \t");
+  if (start == std::string_view::npos) {
+    return false;
+  }
+  const auto [end, ec] = std::from_chars(in.data() + start, in.data() + in.size(), out);
+  if (ec != std::errc()) {
+    return false;
+  }
+  in.remove_prefix(end - in.data());
+  return true;
+}
+
+}  // namespace waybar::util
@@ -2,9 +2,17 @@
 
 #include <json/json.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
 namespace waybar::util {
@@ -13,6 +21,8 @@ struct Rule {
   std::regex rule;
   std::string repr;
   int priority;
+  // Index of a literal every match of `rule` must contain, -1 if none could be derived
+  int literal = -1;
 
   // Fix for Clang < 16
   // See https://en.cppreference.com/w/cpp/compiler_support/20 "Parenthesized initialization of
@@ -23,31 +33,82 @@ struct Rule {
 
 int default_priority_function(std::string& key);
 
+class LiteralMatcher;
+
 /* A collection of regexes and strings, with a default string to return if no regexes.
  * When a regex is matched, the corresponding string is returned.
- * All regexes that are matched are cached, so that the regexes are only
- * evaluated once against a given string.
+ * Results are cached in a bounded LRU, so that the regexes are only
+ * evaluated once against a recently seen string.
  * Regexes may be given a higher priority than others, so that they are matched
  * first. The priority function is given the regex string, and should return a
  * higher number for higher priority regexes.
  */
 class RegexCollection {
+ public:
+  static constexpr size_t DEFAULT_CACHE_CAPACITY = 1024;
+
+  struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    size_t size;
+  };
+
  private:
+  // The cache is split into independently locked shards, so lookups from the IPC threads and the
+  // GTK thread rarely contend.
+  class Cache {
+   public:
+    explicit Cache(size_t capacity);
+
+    bool get(std::string_view key, std::string& value, bool& matched_any);
+    void put(std::string_view key, const std::string& value, bool matched_any);
+    CacheStats stats() const;
+
+   private:
+    static constexpr size_t SHARD_COUNT = 8;
+
+    struct Entry {
+      std::string key;
+      std::string value;
+      bool matched_any;
+    };
+
+    struct Shard {
+      mutable std::mutex mutex;
+      std::list<Entry> entries;  // most recently used first
+      std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    Shard& shard_for(std::string_view key);
+
+    size_t shard_capacity_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+  };
+
   std::vector<Rule> rules;
-  std::map<std::string, std::string> regex_cache;
+  // Finds the rules' required literals in one pass, so only regexes that can match are run
+  std::shared_ptr<const LiteralMatcher> prefilter;
+  std::unique_ptr<Cache> regex_cache;
   std::string default_repr;
 
   std::string find_match(std::string& value, bool& matched_any);
 
  public:
-  RegexCollection() = default;
+  RegexCollection();
   RegexCollection(
       const Json::Value& map, std::string default_repr = "",
-      const std::function<int(std::string&)>& priority_function = default_priority_function);
+      const std::function<int(std::string&)>& priority_function = default_priority_function,
+      size_t cache_capacity = DEFAULT_CACHE_CAPACITY);
+  RegexCollection(RegexCollection&&) = default;
+  RegexCollection& operator=(RegexCollection&&) = default;
   ~RegexCollection() = default;
 
-  std::string& get(std::string& value, bool& matched_any);
-  std::string& get(std::string& value);
+  std::string get(std::string& value, bool& matched_any);
+  std::string get(std::string& value);
+
+  CacheStats cache_stats() const { return regex_cache->stats(); }
 };
 
 }  // namespace waybar::util
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <sigc++/connection.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace waybar::util {
+
+// When a sleeping thread is woken up after the system resumes
+enum class ResumeWake {
+  IMMEDIATE,  // right away, for cheap modules in sight
+  STAGGERED,  // one after the other, spread over the resume window
+  ONLINE,     // once the network is available again, staggered
+};
+
+// "immediate", "staggered" or "online", nullopt for anything else
+std::optional<ResumeWake> parseResumeWake(const std::string& wake);
+
+/* The wake-ups of the SleeperThreads after a resume. Waking every module thread at once as the
+ * devices and the network come back makes the bar stall on the reads, forks and queries they all
+ * start. The immediate ones are woken as the resume is signalled, the others one at a time over
+ * the window, the online ones once the network monitor reports the network available.
+ * The wake-ups run on the GTK thread, the resume signal is delivered there.
+ */
+class ResumeWakeups {
+ public:
+  using Id = uint64_t;
+  static constexpr auto DEFAULT_WINDOW = std::chrono::milliseconds(2000);
+
+  static ResumeWakeups& inst();
+
+  Id add(ResumeWake wake, std::function<void()> wake_up);
+  void setWake(Id id, ResumeWake wake);
+  // When this returns, the wake-up is neither running nor going to run
+  void remove(Id id);
+  // "resume-stagger" of the config
+  void setWindow(std::chrono::milliseconds window);
+
+ private:
+  struct Entry {
+    ResumeWake wake;
+    std::function<void()> wake_up;
+  };
+
+  ResumeWakeups();
+  void onResume();
+  void onNetworkChanged(bool available);
+  // Queues the entries for the staggered wake-ups and starts them if they aren't running
+  void stagger(const std::vector<Id>& ids);
+  bool wakeNext();
+  void wake(Id id);
+
+  std::mutex mutex_;  // guards everything below, held while a wake-up runs
+  std::map<Id, Entry> entries_;
+  Id nextId_ = 1;
+  std::chrono::milliseconds window_ = DEFAULT_WINDOW;
+  std::vector<Id> staggered_;  // left to wake, in order
+  size_t next_ = 0;
+  std::vector<Id> online_;  // waiting for the network
+  sigc::connection resume_;
+  sigc::connection timer_;
+  sigc::connection network_;
+};
+
+}  // namespace waybar::util
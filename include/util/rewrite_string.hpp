@@ -1,10 +1,42 @@
 #pragma once
 #include <json/json.h>
 
+#include <memory>
+#include <mutex>
+#include <regex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace waybar::util {
 std::string rewriteString(const std::string&, const Json::Value&);
 std::string rewriteStringOnce(const std::string& value, const Json::Value& rules,
                               bool& matched_any);
+
+/* A "rewrite" rule set compiled once. Every rule whose regex matches the whole input is applied
+ * in config order. Results are memoized for recently seen inputs since titles tend to repeat.
+ */
+class RewriteRules {
+ public:
+  RewriteRules() = default;
+  explicit RewriteRules(const Json::Value& rules);
+
+  // Instance shared by every module (and bar) configured with the same rules.
+  static std::shared_ptr<const RewriteRules> shared(const Json::Value& rules);
+
+  std::string apply(const std::string& value) const;
+  bool empty() const { return rules_.empty(); }
+
+ private:
+  static constexpr size_t MEMO_CAPACITY = 256;
+
+  struct Rule {
+    std::regex regex;
+    std::string replacement;
+  };
+
+  std::vector<Rule> rules_;
+  mutable std::mutex memo_mutex_;
+  mutable std::unordered_map<std::string, std::string> memo_;
+};
 }  // namespace waybar::util
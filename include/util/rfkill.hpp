@@ -5,10 +5,14 @@
 #include <sigc++/signal.h>
 #include <sigc++/trackable.h>
 
-#include <atomic>
+#include <memory>
 
 namespace waybar::util {
 
+/* The rfkill state of one type of radio. /dev/rfkill is read once for all of them, by a monitor
+ * shared by every instance alive: it keeps the state of each type, for the instances made after
+ * the events came, and emits on_update of the instances of the type an event is about.
+ */
 class Rfkill : public sigc::trackable {
  public:
   Rfkill(enum rfkill_type rfkill_type);
@@ -18,11 +22,10 @@ class Rfkill : public sigc::trackable {
   sigc::signal<void(struct rfkill_event&)> on_update;
 
  private:
-  enum rfkill_type rfkill_type_;
-  std::atomic_bool state_ = false;
-  int fd_ = -1;
+  class Monitor;
 
-  bool on_event(Glib::IOCondition cond);
+  enum rfkill_type rfkill_type_;
+  std::shared_ptr<Monitor> monitor_;
 };
 
 }  // namespace waybar::util
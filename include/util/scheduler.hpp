@@ -0,0 +1,103 @@
+#pragma once
+
+#include <sigc++/connection.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace waybar::util {
+
+/* Runs the periodic tasks of every module on one shared thread, instead of one SleeperThread each.
+ * Deadlines are multiples of the task period on the system clock, so all tasks sharing a period
+ * wake up together and run in a single pass, and a one-minute period ticks on the full minute.
+ * Tasks are expected to be short, typically a dp.emit().
+ * On battery power the tasks run on their battery period, or on their period times the battery
+ * factor without one. The power supply is only watched once a task or the factor asks for it.
+ */
+class Scheduler {
+ public:
+  using Clock = std::chrono::system_clock;
+  using Id = uint64_t;
+
+  static Scheduler& inst();
+
+  // The task first runs on the next pass, then on every multiple of period. A battery period of 0
+  // follows the battery factor.
+  Id add(std::chrono::milliseconds period, std::function<void()> task, bool paused = false,
+         std::chrono::milliseconds battery_period = std::chrono::milliseconds(0));
+  // When this returns, the task is neither running nor going to run again.
+  void remove(Id id);
+  // Runs the task on the next pass, its regular deadlines stay the same.
+  void wake_up(Id id);
+  // A paused task doesn't run until it is resumed, it then runs on the next pass.
+  void pause(Id id, bool paused);
+
+  // "interval-on-battery-factor" of the config, 1 by default
+  void setBatteryFactor(double factor);
+  // The period to sleep for now, for the modules polling on threads of their own
+  std::chrono::milliseconds currentPeriod(std::chrono::milliseconds period,
+                                          std::chrono::milliseconds battery_period);
+
+ private:
+  struct Task {
+    std::chrono::milliseconds period;  // the one in use, for the power source
+    std::chrono::milliseconds mainsPeriod;
+    std::chrono::milliseconds batteryPeriod;  // 0 to follow the factor
+    Clock::time_point next;
+    std::function<void()> fn;
+    bool woken = false;    // run on the next pass regardless of next
+    bool paused = false;   // skipped, regardless of woken and next
+    bool removed = false;  // skip, erased once it is no longer running
+  };
+
+  Scheduler();
+  void run();
+  static Clock::time_point nextDeadline(Clock::time_point now, std::chrono::milliseconds period);
+  std::chrono::milliseconds periodOn(bool battery, std::chrono::milliseconds period,
+                                     std::chrono::milliseconds battery_period) const;
+  void retime(Clock::time_point now);
+  // Checks the power source when due, and retimes the tasks when it changed
+  void checkPower(std::unique_lock<std::mutex>& lock, Clock::time_point now);
+
+  std::mutex mutex_;  // guards everything below
+  std::condition_variable condvar_;  // wakes the scheduler thread
+  std::condition_variable done_;     // signalled whenever a task returns
+  std::unordered_map<Id, Task> tasks_;
+  std::vector<Id> due_;  // reused between passes
+  Id running_ = 0;
+  Id nextId_ = 1;
+  double batteryFactor_ = 1;
+  bool watchPower_ = false;
+  bool onBattery_ = false;
+  Clock::time_point powerCheckAt_ = Clock::time_point::min();
+  std::thread thread_;
+  sigc::connection resume_;
+};
+
+// A Scheduler task owned by a module, removed on destruction.
+class PeriodicTask {
+ public:
+  PeriodicTask() = default;
+  PeriodicTask(const PeriodicTask&) = delete;
+  PeriodicTask& operator=(const PeriodicTask&) = delete;
+  ~PeriodicTask() { stop(); }
+
+  void start(std::chrono::milliseconds period, std::function<void()> fn,
+             std::chrono::milliseconds battery_period = std::chrono::milliseconds(0));
+  void stop();
+  void wake_up();
+  // Kept across start(), resuming runs the task right away
+  void pause(bool paused);
+
+ private:
+  Scheduler::Id id_ = 0;
+  bool paused_ = false;
+};
+
+}  // namespace waybar::util
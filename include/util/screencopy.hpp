@@ -0,0 +1,29 @@
+#pragma once
+
+#include <gdkmm/pixbuf.h>
+#include <glibmm/refptr.h>
+
+#include <functional>
+
+namespace waybar::util {
+
+/* In-process capture of a screen region through wlr-screencopy into a wl_shm buffer.
+ * The frame events are dispatched by the GDK event loop, so captures have to be started from the
+ * GTK main thread and the callback is invoked there as well.
+ */
+namespace screencopy {
+
+// Invoked with the captured region, or with an empty RefPtr if the capture failed.
+using Callback = std::function<void(Glib::RefPtr<Gdk::Pixbuf>)>;
+
+// Whether the compositor advertised both zwlr_screencopy_manager_v1 and wl_shm.
+bool isSupported();
+
+/* Capture a region given in global layout (logical) coordinates. The region is mapped onto the
+ * monitor containing its center and clipped to that monitor by the compositor.
+ */
+void captureRegion(int x, int y, int width, int height, Callback callback);
+
+}  // namespace screencopy
+
+}  // namespace waybar::util
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gtkmm/widget.h>
+
+#include <functional>
+
+namespace waybar::util {
+
+/* Scroll steps collected between two frames of a widget and applied together on the next one, so
+ * a fast touchpad costs one volume change per frame instead of one per event.
+ */
+class ScrollAccumulator {
+ public:
+  // apply gets the sum of the steps since the last frame, positive up, and never 0
+  ScrollAccumulator(Gtk::Widget& widget, std::function<void(int)> apply);
+  ScrollAccumulator(const ScrollAccumulator&) = delete;
+  ScrollAccumulator& operator=(const ScrollAccumulator&) = delete;
+  ~ScrollAccumulator();
+
+  void add(int steps);
+
+ private:
+  bool onTick(const Glib::RefPtr<Gdk::FrameClock>& clock);
+
+  Gtk::Widget& widget_;
+  std::function<void(int)> apply_;
+  int steps_ = 0;
+  guint tick_ = 0;  // the pending tick callback, 0 if there is none
+};
+
+}  // namespace waybar::util
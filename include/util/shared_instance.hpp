@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace waybar::util {
+
+/* The instance of a backend shared by every module that uses it, alive as long as one of them
+ * holds it and made again by the next one that asks once they are all gone. Not synchronized:
+ * callers that get it from several threads lock around it.
+ */
+template <typename T>
+class SharedInstance {
+ public:
+  // The instance alive, or the one make() returns if there is none
+  template <typename Make>
+  std::shared_ptr<T> get(Make&& make) {
+    auto instance = instance_.lock();
+    if (!instance) {
+      instance = std::forward<Make>(make)();
+      instance_ = instance;
+    }
+    return instance;
+  }
+
+ private:
+  std::weak_ptr<T> instance_;
+};
+
+/* Shared instances by key, e.g. one per configuration of the backend. The keys of the instances
+ * that are gone are dropped on every lookup, so configurations that come and go with reloads
+ * don't pile up. Not synchronized either.
+ */
+template <typename Key, typename T>
+class SharedInstances {
+ public:
+  // The instance for key alive, or the one make() returns if there is none
+  template <typename Make>
+  std::shared_ptr<T> get(const Key& key, Make&& make) {
+    std::erase_if(instances_, [](const auto& entry) { return entry.second.expired(); });
+    auto& slot = instances_[key];
+    auto instance = slot.lock();
+    if (!instance) {
+      instance = std::forward<Make>(make)();
+      slot = instance;
+    }
+    return instance;
+  }
+
+  // Calls fn with every instance alive, dropping the keys of those that are gone
+  template <typename Fn>
+  void forEach(Fn&& fn) {
+    for (auto it = instances_.begin(); it != instances_.end();) {
+      auto instance = it->second.lock();
+      if (!instance) {
+        it = instances_.erase(it);
+        continue;
+      }
+      fn(instance);
+      ++it;
+    }
+  }
+
+  size_t size() const { return instances_.size(); }
+
+ private:
+  std::map<Key, std::weak_ptr<T>> instances_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "util/shared_instance.hpp"
+
+namespace waybar::util {
+
+/* A system reading shared by every module instance that polls the same source on the same
+ * interval, typically one module config rendered on several outputs. The first instance to update
+ * on a tick reads the source, the others get its snapshot, so N bars cost one read per period.
+ */
+template <typename T>
+class SharedSample {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // source names what is read, e.g. "disk:/home"; interval is the module interval
+  static std::shared_ptr<SharedSample> get(const std::string& source,
+                                           std::chrono::milliseconds interval) {
+    static std::mutex mutex;
+    static SharedInstances<std::string, SharedSample> instances;
+
+    std::lock_guard lock(mutex);
+    return instances.get(source + '@' + std::to_string(interval.count()), [interval] {
+      return std::shared_ptr<SharedSample>(new SharedSample(interval));
+    });
+  }
+
+  // source key made of the given members of a module config
+  static std::string sourceOf(const std::string& module, const Json::Value& config,
+                              std::initializer_list<const char*> keys) {
+    Json::Value source(Json::objectValue);
+    for (const auto* key : keys) {
+      if (config.isMember(key)) {
+        source[key] = config[key];
+      }
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return module + ':' + Json::writeString(builder, source);
+  }
+
+  /* Returns the current snapshot, calling read(previous) first if it is stale. previous is the
+   * last snapshot, or nullptr on the first read, for readings computed as deltas. If read throws,
+   * the exception reaches the caller and the previous snapshot is kept.
+   */
+  template <typename Read>
+  std::shared_ptr<const T> sample(Read&& read) {
+    std::lock_guard lock(mutex_);
+    const auto now = Clock::now();
+    if (!value_ || now - sampledAt_ >= maxAge_) {
+      value_ = std::make_shared<const T>(read(value_.get()));
+      sampledAt_ = now;
+    }
+    return value_;
+  }
+
+ private:
+  // Instances on the same tick update within a few milliseconds of each other. The cap keeps
+  // click and event driven updates of long interval modules from reading an old snapshot.
+  static constexpr std::chrono::milliseconds MAX_AGE{250};
+
+  explicit SharedSample(std::chrono::milliseconds interval)
+      : maxAge_{std::min<std::chrono::milliseconds>(interval / 2, MAX_AGE)} {}
+
+  std::mutex mutex_;
+  std::shared_ptr<const T> value_;
+  Clock::time_point sampledAt_;
+  const std::chrono::milliseconds maxAge_;
+};
+
+}  // namespace waybar::util
@@ -1,72 +1,93 @@
 #pragma once
 
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
 #include <functional>
 #include <thread>
 
-#include "prepare_for_sleep.h"
+#include "priority.hpp"
+#include "resume_wakeups.hpp"
 
 namespace waybar::util {
 
-/**
- * Defer pthread_cancel until the end of a current scope.
- *
- * Required to protect a scope where it's unsafe to raise `__forced_unwind` exception.
- * An example of these is a call of a method marked as `noexcept`; an attempt to cancel within such
- * a method may result in a `std::terminate` call.
+/* A worker thread that loops on its function until stopped. Stopping is cooperative: the sleeps
+ * end at once, and the blocking reads of a worker wait through waitReadable() or poll stopFd()
+ * along with their own fds, so that they end too and the thread exits without being cancelled.
  */
-class CancellationGuard {
-  int oldstate;
-
- public:
-  CancellationGuard() { pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate); }
-  ~CancellationGuard() { pthread_setcancelstate(oldstate, &oldstate); }
-};
-
 class SleeperThread {
  public:
   SleeperThread() = default;
 
   SleeperThread(std::function<void()> func)
       : thread_{[this, func] {
+          applyBackgroundPriority();
           while (do_run_) {
-            signal_ = false;
+            waitWhilePaused();
             func();
           }
         }} {
-    connection_ = prepare_for_sleep().connect([this](bool sleep) {
-      if (not sleep) wake_up();
-    });
+    resume_id_ = ResumeWakeups::inst().add(resume_wake_, [this] { wake_up(); });
   }
 
   SleeperThread& operator=(std::function<void()> func) {
     thread_ = std::thread([this, func] {
+      applyBackgroundPriority();
       while (do_run_) {
-        signal_ = false;
+        waitWhilePaused();
         func();
       }
     });
-    if (connection_.empty()) {
-      connection_ = prepare_for_sleep().connect([this](bool sleep) {
-        if (not sleep) wake_up();
-      });
+    if (resume_id_ == 0) {
+      resume_id_ = ResumeWakeups::inst().add(resume_wake_, [this] { wake_up(); });
     }
     return *this;
   }
 
   bool isRunning() const { return do_run_; }
 
+  // When the thread is woken up after a resume, staggered by default
+  void setResumeWake(ResumeWake wake) {
+    resume_wake_ = wake;
+    if (resume_id_ != 0) {
+      ResumeWakeups::inst().setWake(resume_id_, wake);
+    }
+  }
+
+  /* Waits for fd to be readable, or hung up, for timeout at most, forever when negative. False
+   * on timeout, and once the thread is stopped.
+   */
+  bool waitReadable(int fd, std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) {
+    std::array<pollfd, 2> fds{{{.fd = fd, .events = POLLIN, .revents = 0},
+                               {.fd = stop_fd_, .events = POLLIN, .revents = 0}}};
+    const int wait = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+    while (do_run_) {
+      const int ret = poll(fds.data(), fds.size(), wait);
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      return ret > 0 && fds[1].revents == 0 && fds[0].revents != 0;
+    }
+    return false;
+  }
+
+  // Readable once the thread is stopped, for the workers that poll fds of their own
+  int stopFd() const { return stop_fd_; }
+
   auto sleep() {
     std::unique_lock lk(mutex_);
-    CancellationGuard cancel_lock;
     return condvar_.wait(lk, [this] { return signal_ || !do_run_; });
   }
 
   auto sleep_for(std::chrono::system_clock::duration dur) {
     std::unique_lock lk(mutex_);
-    CancellationGuard cancel_lock;
     constexpr auto max_time_point = std::chrono::steady_clock::time_point::max();
     auto wait_end = max_time_point;
     auto now = std::chrono::steady_clock::now();
@@ -80,7 +101,6 @@ class SleeperThread {
       std::chrono::time_point<std::chrono::system_clock, std::chrono::system_clock::duration>
           time_point) {
     std::unique_lock lk(mutex_);
-    CancellationGuard cancel_lock;
     return condvar_.wait_until(lk, time_point, [this] { return signal_ || !do_run_; });
   }
 
@@ -92,6 +112,19 @@ class SleeperThread {
     condvar_.notify_all();
   }
 
+  /* A paused thread finishes the current iteration, sleep included, and waits before the next.
+   * Resuming ends a sleep in progress, so the next iteration catches up right away.
+   */
+  void pause(bool paused) {
+    {
+      std::lock_guard<std::mutex> lck(mutex_);
+      paused_ = paused;
+      signal_ = signal_ || !paused;
+    }
+    condvar_.notify_all();
+  }
+
+  // Returns right away, the thread ends with the current iteration: join() waits for it
   auto stop() {
     {
       std::lock_guard<std::mutex> lck(mutex_);
@@ -99,28 +132,48 @@ class SleeperThread {
       do_run_ = false;
     }
     condvar_.notify_all();
-    auto handle = thread_.native_handle();
-    if (handle != 0) {
-      // TODO: find a proper way to terminate thread...
-      pthread_cancel(handle);
+    if (stop_fd_ != -1) {
+      eventfd_write(stop_fd_, 1);
     }
   }
 
-  ~SleeperThread() {
-    connection_.disconnect();
-    stop();
+  // Waits for the thread to end, after stop()
+  void join() {
     if (thread_.joinable()) {
       thread_.join();
     }
   }
 
+  ~SleeperThread() {
+    if (resume_id_ != 0) {
+      ResumeWakeups::inst().remove(resume_id_);
+    }
+    stop();
+    join();
+    if (stop_fd_ != -1) {
+      close(stop_fd_);
+    }
+  }
+
  private:
+  // Then clears the wake-up, the iteration to come starts with none pending
+  void waitWhilePaused() {
+    std::unique_lock lk(mutex_);
+    condvar_.wait(lk, [this] { return !paused_ || !do_run_; });
+    signal_ = false;
+  }
+
   std::thread thread_;
   std::condition_variable condvar_;
   std::mutex mutex_;
-  bool do_run_ = true;
+  // Written under mutex_ for the waits, read without it by the loop and waitReadable()
+  std::atomic<bool> do_run_ = true;
   bool signal_ = false;
-  sigc::connection connection_;
+  bool paused_ = false;
+  // Stays readable once stop() wrote to it
+  int stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  ResumeWake resume_wake_ = ResumeWake::STAGGERED;
+  ResumeWakeups::Id resume_id_ = 0;
 };
 
 }  // namespace waybar::util
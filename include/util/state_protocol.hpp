@@ -0,0 +1,46 @@
+#pragma once
+
+#include <json/value.h>
+#include <json/writer.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace waybar::util {
+
+/* The protocol of the state socket, apart from its IO, see StateSocket: the last state of every
+ * module, and the lines they are sent as. Each line is one JSON object.
+ */
+class StateProtocol {
+ public:
+  enum class Request { GET, SUBSCRIBE };
+  static constexpr size_t MAX_REQUEST = 64;
+
+  StateProtocol();
+
+  // The request of a line, nothing if it isn't one
+  static std::optional<Request> parseRequest(std::string_view line);
+  // Takes the first complete line off in, nothing until its newline came in
+  static std::optional<std::string> nextLine(std::string& in);
+  // The answer to a request: every state, or an error for an unknown one
+  std::string answer(std::optional<Request> request) const;
+
+  // Keeps the new state of key, and returns it for the subscribers. nullptr if it didn't change.
+  const Json::Value* update(const std::string& key, Json::Value state);
+  /* Drops the state of key, for a module that is gone. What to send the subscribers: its
+   * "module" and "output" with "removed": true, nothing if it had no state.
+   */
+  std::optional<Json::Value> forget(const std::string& key);
+  // A state as the line sent for it
+  std::string line(const Json::Value& state) const;
+
+  size_t size() const { return states_.size(); }
+
+ private:
+  std::map<std::string, Json::Value> states_;
+  Json::StreamWriterBuilder writer_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glibmm/iochannel.h>
+#include <json/value.h>
+#include <sigc++/connection.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/state_protocol.hpp"
+
+namespace waybar::util {
+
+/* The "state-socket": a unix socket serving the state of the modules, so that other tools show
+ * what waybar already reads instead of polling it again. A client writes one line:
+ *   get        the state of every module, as one JSON object per line, then the socket closes
+ *   subscribe  the same, then a line each time a module updates or is gone
+ * A state is {"module": ..., "output": ..., "text": ..., "tooltip": ..., "class": [...],
+ * "visible": ..., "fields": {...}}, the fields being the raw values of the module, like the
+ * battery capacity. A module that is gone is sent as {"module": ..., "output": ...,
+ * "removed": true}. Runs on the main thread, a client that doesn't keep up is dropped.
+ */
+class StateSocket {
+ public:
+  // nullptr unless the config asked for it
+  static StateSocket* inst() { return instance_.get(); }
+  // true for $XDG_RUNTIME_DIR/waybar-<pid>.sock, or a path. Anything else stops it.
+  static void configure(const Json::Value& option);
+
+  ~StateSocket();
+  StateSocket(const StateSocket&) = delete;
+  StateSocket& operator=(const StateSocket&) = delete;
+
+  // key tells the modules apart, state has their "module" and "output"
+  void publish(const std::string& key, Json::Value state);
+  // Drops the state of a module that is gone
+  void forget(const std::string& key);
+
+ private:
+  static constexpr size_t MAX_PENDING = 1024 * 1024;  // of output per client
+
+  struct Client {
+    int fd = -1;
+    std::string in;
+    std::string out;
+    bool subscribed = false;
+    bool closing = false;  // once out is written
+    bool dropped = false;
+    bool eof = false;      // nothing more to read
+    bool reading = false;  // io watches IO_IN
+    bool writing = false;  // io watches IO_OUT
+    sigc::connection io;
+  };
+
+  StateSocket(std::string path, int fd);
+  bool onAccept();
+  bool onClientIo(Client* client, Glib::IOCondition condition);
+  void handleRequest(Client* client, const std::string& line);
+  // Whether a client is subscribed, before making a line for nobody
+  bool subscribed() const;
+  // Sends line to every subscriber
+  void broadcast(const std::string& line);
+  void send(Client* client, const std::string& line);
+  // Writes what it can without blocking, false once the client is to be dropped
+  bool flush(Client* client);
+  void watch(Client* client);
+  // Drops the dropped clients from an idle callback, not from their own watch
+  void scheduleDrop();
+  void dropClosed();
+
+  static std::unique_ptr<StateSocket> instance_;
+
+  const std::string path_;
+  const int fd_;
+  sigc::connection accept_;
+  sigc::connection drop_;
+  StateProtocol protocol_;
+  std::vector<std::unique_ptr<Client>> clients_;
+};
+
+}  // namespace waybar::util
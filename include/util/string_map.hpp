@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace waybar::util {
+
+// Hashes std::string, string_view and string literals alike, for lookups that don't build a key
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view str) const noexcept {
+    return std::hash<std::string_view>{}(str);
+  }
+};
+
+/* A hash map with string keys that is looked up with any string type: find("active") or
+ * find(some_string_view) neither allocate a std::string nor walk a tree. For the config derived
+ * maps consulted on events, where the order of the keys doesn't matter.
+ */
+template <typename T>
+using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+}  // namespace waybar::util
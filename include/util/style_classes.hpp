@@ -0,0 +1,30 @@
+#pragma once
+
+#include <gtkmm/widget.h>
+
+#include <string>
+#include <vector>
+
+namespace waybar::util {
+
+/* The classes one role gives a widget, like its status or the classes of a script's output.
+ * set() only adds and removes the ones that changed: removing a class and adding it back
+ * invalidates the style of the widget twice for the same result. The other classes of the widget
+ * are left alone.
+ */
+class StyleClasses {
+ public:
+  explicit StyleClasses(Gtk::Widget& widget) : widget_{widget} {}
+  StyleClasses(const StyleClasses&) = delete;
+  StyleClasses& operator=(const StyleClasses&) = delete;
+
+  // Empty names are skipped
+  void set(std::vector<std::string> classes);
+  void set(const std::string& name);
+
+ private:
+  Gtk::Widget& widget_;
+  std::vector<std::string> current_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace waybar::util {
+
+/* Display width of UTF-8 text in terminal-like columns: wide characters count as two, zero-width
+ * ones and soft hyphens as zero. Text that isn't valid UTF-8 counts one column per byte. Pure
+ * ASCII, the common case, is measured without decoding.
+ */
+struct TextMeasure {
+  size_t width;
+  /* The length in bytes of the longest prefix that fits in limit and doesn't end in a blank,
+   * npos if there is none. Invalid text is cut at limit bytes, only if it is longer.
+   */
+  size_t cut;
+  size_t cut_short;  // same for short_limit
+};
+
+// Measures text and finds its cut points for two limits, in one pass
+TextMeasure measureText(std::string_view text, size_t limit = std::string::npos,
+                        size_t short_limit = std::string::npos);
+
+/* measureText(text).width. The widths of the last non-ASCII texts measured on the thread are
+ * kept in a small direct-mapped table, since labels measure the same titles on every update.
+ */
+size_t textWidth(std::string_view text);
+
+/* Columns as ustring_clen() counts them: two for a wide character, one for any other, one per byte
+ * for invalid text. ASCII and the cache as in textWidth().
+ */
+size_t columnCount(std::string_view text);
+
+// Whether text only has 7-bit characters, checked a word at a time
+bool isAscii(std::string_view text);
+
+}  // namespace waybar::util
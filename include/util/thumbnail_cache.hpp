@@ -1,5 +1,8 @@
 #pragma once
 
+#include <gdkmm/pixbuf.h>
+#include <glibmm/refptr.h>
+
 #include <string>
 #include <optional>
 #include <memory>
@@ -22,40 +25,69 @@ class ThumbnailCache {
   ThumbnailCache();
   ~ThumbnailCache() = default;
 
-  // Capture thumbnail for a window (async, non-blocking)
+  // Queue a thumbnail capture for a window (async, non-blocking). The capture runs after the
+  // settle delay on a shared worker, using wlr-screencopy when the compositor supports it and
+  // grim otherwise. A newer request for the same window replaces a queued one.
+  // now skips the settle delay, for a window that is settled already. done is released once the
+  // capture is through, taken, skipped or failed, from whichever thread that happens on.
   void captureWindow(const std::string& windowAddress, int x, int y, int width, int height,
                      const std::string& windowClass, const std::string& windowTitle,
-                     const std::string& workspaceName);
+                     const std::string& workspaceName, bool now = false,
+                     std::shared_ptr<void> done = nullptr);
 
-  // Capture thumbnail synchronously (blocking, for immediate capture before workspace switch)
+  // Capture thumbnail synchronously (blocking, for immediate capture before workspace switch).
+  // Always uses the external tools.
   void captureWindowSync(const std::string& windowAddress, int x, int y, int width, int height,
                          const std::string& windowClass, const std::string& windowTitle,
                          const std::string& workspaceName);
 
-  // Get cached thumbnail path (returns empty if not cached or too old)
+  // Get cached thumbnail path (returns empty if not cached or too old). The file holds the raw
+  // rows of the thumbnail behind a small header, not an image format other programs read.
   std::optional<std::string> getThumbnailPath(const std::string& windowAddress,
                                               int maxAgeSeconds = 300);
 
-  // Get thumbnail metadata
+  // Drop the captures queued through this cache that haven't started yet, e.g. because the user
+  // already switched away. Those of the other bars stay queued.
+  void cancelPendingCaptures();
+
+  // Delay between queueing a capture and taking it, lets workspace switch animations finish
+  static void setSettleDelay(std::chrono::milliseconds delay);
+
+  // Captures of a window requested sooner than this after its last one are dropped
+  static void setRecaptureInterval(std::chrono::milliseconds interval);
+
+  // Thumbnail mapped from its file, served from a process-wide in-memory LRU once loaded. Entries
+  // are dropped when a new capture for the window lands, so this is cheap enough for tooltip
+  // handlers.
+  static Glib::RefPtr<Gdk::Pixbuf> getThumbnailPixbuf(const std::string& windowAddress,
+                                                      int maxAgeSeconds = 300);
+
+  // Upper bound for the decoded pixbufs kept by getThumbnailPixbuf
+  static void setPixbufCacheLimit(size_t maxBytes);
+
+  // Get thumbnail metadata (served from the in-memory index)
   std::optional<ThumbnailMetadata> getMetadata(const std::string& windowAddress);
 
-  // Clear old thumbnails (LRU cleanup)
+  // Clear old thumbnails, then the oldest past maxSizeMB, which new captures keep to from then on.
+  // Driven by the index, no directory scan
   void cleanup(int maxAgeSeconds = 3600, size_t maxSizeMB = 100);
 
-  // Check if capture tools are available
+  // The window closed: its thumbnail and queued capture are dropped
+  static void forget(const std::string& windowAddress);
+
+  // Check if native capture or the capture tools are available
   bool isAvailable() const { return m_captureAvailable; }
 
  private:
   std::string getCachePath() const;
   std::string getThumbnailFilePath(const std::string& windowAddress) const;
-  std::string getMetadataFilePath(const std::string& windowAddress) const;
   
   bool m_captureAvailable;
+  bool m_nativeCapture;
   std::string m_cacheDir;
   
-  // Helper to check for grim and magick/convert
+  // Helper to check for grim (looked up once per process)
   bool checkCaptureTools();
-  std::string getResizeCommand() const;
 };
 
 }  // namespace waybar::util
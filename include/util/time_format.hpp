@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+#include <string_view>
+
+namespace waybar::util {
+
+// Whether a strftime-like format shows seconds: %S, %T, %r, %X, %c or %s, %OS and %EX alike
+inline bool showsSeconds(std::string_view fmt) {
+  for (auto pos = fmt.find('%'); pos != std::string_view::npos; pos = fmt.find('%', pos + 1)) {
+    auto spec = pos + 1;
+    if (spec < fmt.size() && (fmt[spec] == 'E' || fmt[spec] == 'O')) ++spec;
+    if (spec < fmt.size() && std::string_view{"STrXcs"}.find(fmt[spec]) != std::string_view::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* The tick period of a clock showing these formats: the interval, raised to a minute when none of
+ * them shows seconds. The scheduler aligns a one-minute period on the full minute, which is a
+ * boundary in every time zone, unlike the full hour.
+ */
+inline std::chrono::milliseconds clockPeriod(std::chrono::milliseconds interval,
+                                             std::initializer_list<std::string_view> formats) {
+  if (std::any_of(formats.begin(), formats.end(), showsSeconds)) {
+    return interval;
+  }
+  return std::max<std::chrono::milliseconds>(interval, std::chrono::minutes(1));
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <json/writer.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace waybar::util::trace {
+
+/* Chrome trace events, written to the file given with --trace for Perfetto or chrome://tracing.
+ * Built in with -Dtracing=true only: otherwise every call is empty and inlined away, and even
+ * then nothing is recorded before start().
+ */
+using Clock = std::chrono::steady_clock;
+
+#ifdef HAVE_TRACING
+
+namespace detail {
+
+inline std::atomic<bool> enabled{false};
+inline std::mutex mutex;
+inline FILE* file = nullptr;
+inline std::string buffer;
+inline bool first = true;
+
+inline int64_t micros(Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+// Small numbers in the order the threads first traced something, the viewers show them as is
+inline int threadId() {
+  static std::atomic<int> next{1};
+  static thread_local const int tid = next++;
+  return tid;
+}
+
+// Written out in chunks so that tracing doesn't cost a syscall per event
+inline void write(std::string_view name, const char* category, char phase, int64_t ts,
+                  std::string_view extra) {
+  std::string event = "{\"name\":";
+  event += Json::valueToQuotedString(std::string(name).c_str());
+  event += ",\"cat\":\"";
+  event += category;
+  event += "\",\"ph\":\"";
+  event += phase;
+  event += "\",\"ts\":" + std::to_string(ts);
+  event += ",\"pid\":" + std::to_string(getpid());
+  event += ",\"tid\":" + std::to_string(threadId());
+  event += extra;
+  event += '}';
+
+  std::lock_guard lock(mutex);
+  if (file == nullptr) {
+    return;
+  }
+  buffer += first ? "\n" : ",\n";
+  buffer += event;
+  first = false;
+  if (buffer.size() >= 64 * 1024) {
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+  }
+}
+
+}  // namespace detail
+
+inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+inline bool start(const std::string& path) {
+  std::lock_guard lock(detail::mutex);
+  if (detail::file != nullptr) {
+    return true;
+  }
+  detail::file = fopen(path.c_str(), "we");
+  if (detail::file == nullptr) {
+    return false;
+  }
+  // The JSON array format, the viewers also take it without its ] after a crash
+  detail::buffer = "[";
+  detail::first = true;
+  detail::enabled = true;
+  return true;
+}
+
+inline void stop() {
+  std::lock_guard lock(detail::mutex);
+  if (detail::file == nullptr) {
+    return;
+  }
+  detail::enabled = false;
+  detail::buffer += "\n]\n";
+  fwrite(detail::buffer.data(), 1, detail::buffer.size(), detail::file);
+  detail::buffer.clear();
+  fclose(detail::file);
+  detail::file = nullptr;
+}
+
+// Something that took from start to end
+inline void complete(std::string_view name, const char* category, Clock::time_point start,
+                     Clock::time_point end = Clock::now()) {
+  if (!enabled()) {
+    return;
+  }
+  detail::write(name, category, 'X', detail::micros(start),
+                ",\"dur\":" + std::to_string(detail::micros(end) - detail::micros(start)));
+}
+
+// Something that begins and ends on different threads or calls, told apart by id
+inline void asyncBegin(std::string_view name, const char* category, int64_t id) {
+  if (!enabled()) {
+    return;
+  }
+  detail::write(name, category, 'b', detail::micros(Clock::now()),
+                ",\"id\":" + std::to_string(id));
+}
+
+inline void asyncEnd(std::string_view name, const char* category, int64_t id) {
+  if (!enabled()) {
+    return;
+  }
+  detail::write(name, category, 'e', detail::micros(Clock::now()),
+                ",\"id\":" + std::to_string(id));
+}
+
+// The value of a counter from now on, shown as a graph
+inline void counter(std::string_view name, const char* category, int64_t value) {
+  if (!enabled()) {
+    return;
+  }
+  detail::write(name, category, 'C', detail::micros(Clock::now()),
+                ",\"args\":{\"value\":" + std::to_string(value) + "}");
+}
+
+// The scope it lives in, name must outlive it
+class Span {
+ public:
+  Span(std::string_view name, const char* category) : name_(name), category_(category) {
+    if (enabled()) {
+      start_ = Clock::now();
+    }
+  }
+  ~Span() {
+    if (start_ != Clock::time_point{}) {
+      complete(name_, category_, start_);
+    }
+  }
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+ private:
+  std::string_view name_;
+  const char* category_;
+  Clock::time_point start_{};
+};
+
+#else
+
+inline bool enabled() { return false; }
+inline bool start(const std::string&) { return false; }
+inline void stop() {}
+inline void complete(std::string_view, const char*, Clock::time_point, Clock::time_point = {}) {}
+inline void asyncBegin(std::string_view, const char*, int64_t) {}
+inline void asyncEnd(std::string_view, const char*, int64_t) {}
+inline void counter(std::string_view, const char*, int64_t) {}
+
+class Span {
+ public:
+  Span(std::string_view, const char*) {}
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+};
+
+#endif
+
+}  // namespace waybar::util::trace
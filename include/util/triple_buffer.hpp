@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace waybar::util {
+
+/**
+ * Lock-free triple buffer handing the latest value from one producer thread to one consumer
+ * thread. The producer fills back() and publishes it, the consumer picks up the latest published
+ * value with update() and reads it from front(); values published in between are dropped. Neither
+ * side ever waits or allocates, slots are reused as they are, so a T that keeps its capacity on
+ * assignment is updated without allocating once warmed up.
+ */
+template <typename T>
+class TripleBuffer {
+ public:
+  // every slot starts as a copy of init, e.g. with reserved capacity
+  explicit TripleBuffer(const T& init = T{}) : slots_{init, init, init} {}
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Producer side: the slot to fill, only valid until publish()
+  T& back() { return slots_[back_]; }
+
+  // Producer side: makes back() the latest value and hands out a free slot as the next back()
+  void publish() {
+    back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // Consumer side: moves to the latest value, false if nothing was published since the last call
+  bool update() {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  // Consumer side: the value picked up by the last update(), stable until the next one
+  const T& front() const { return slots_[front_]; }
+
+ private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+
+  T slots_[3];
+  uint8_t back_ = 0;
+  std::atomic<uint8_t> middle_ = 1;
+  uint8_t front_ = 2;
+};
+
+}  // namespace waybar::util
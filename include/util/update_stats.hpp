@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace waybar::util {
+
+/* How long the updates of a module take: their count, total and worst, and the percentiles from
+ * a histogram of power of two microseconds. A percentile is the upper bound of its bucket, so it
+ * is off by less than a factor of two, at a constant cost per update.
+ * Only used from the main thread.
+ */
+class UpdateStats {
+ public:
+  using Duration = std::chrono::microseconds;
+
+  void record(Duration duration) {
+    const auto us = static_cast<uint64_t>(std::max<Duration::rep>(duration.count(), 0));
+    const auto bucket = std::min<size_t>(std::bit_width(us), buckets_.size() - 1);
+    ++buckets_[bucket];
+    ++count_;
+    total_ += duration;
+    max_ = std::max(max_, duration);
+  }
+
+  uint64_t count() const { return count_; }
+  Duration total() const { return total_; }
+  Duration max() const { return max_; }
+
+  // The duration of which at least p of the updates took no longer, p in [0, 1]
+  Duration percentile(double p) const {
+    if (count_ == 0) {
+      return Duration::zero();
+    }
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(p * count_ + 0.5), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+      seen += buckets_[bucket];
+      if (seen >= rank) {
+        // Bucket b holds [2^(b-1), 2^b) us, the worst of them is no worse than the worst overall
+        return std::min(Duration(bucket == 0 ? 0 : (Duration::rep{1} << bucket) - 1), max_);
+      }
+    }
+    return max_;
+  }
+
+ private:
+  // Up to 2^31 us, a half hour, the rest go to the last one
+  std::array<uint64_t, 32> buckets_{};
+  uint64_t count_ = 0;
+  Duration total_{0};
+  Duration max_{0};
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <gtkmm/container.h>
+#include <gtkmm/widget.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace waybar::util {
+
+/* Spare workspace buttons, or what holds one, of a module. A removed one is kept hidden in its
+ * container instead of being destroyed, and handed out again when the next one is added: it is
+ * already realized, its CSS already resolved, so only the classes that differ change. Hidden
+ * children take no space and GTK leaves them out of :first-child and the like. Past the limit
+ * they are destroyed. GTK main thread only.
+ */
+template <typename T>
+class WidgetPool {
+ public:
+  explicit WidgetPool(size_t limit = 8) : limit_(limit) {}
+
+  // A spare one, still hidden in its container, or nullptr
+  std::unique_ptr<T> take() {
+    if (spares_.empty()) {
+      return nullptr;
+    }
+    auto spare = std::move(spares_.back());
+    spares_.pop_back();
+    return spare;
+  }
+
+  // Hides widget, the one of item shown in the container
+  void give(std::unique_ptr<T> item, Gtk::Widget& widget) {
+    widget.hide();
+    if (spares_.size() < limit_) {
+      spares_.push_back(std::move(item));
+    } else if (auto* parent = widget.get_parent(); parent != nullptr) {
+      parent->remove(widget);
+    }
+  }
+
+ private:
+  size_t limit_;
+  std::vector<std::unique_ptr<T>> spares_;
+};
+
+}  // namespace waybar::util
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <wp/wp.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace waybar::util {
+
+/* The connection to WirePlumber shared by every wireplumber module: one core, one object manager
+ * mirroring the nodes and one pair of mixer and default nodes plugins, however many modules and
+ * bars there are. It lives as long as one of its listeners holds it.
+ */
+class WireplumberContext {
+ public:
+  class Listener {
+   public:
+    virtual ~Listener() = default;
+    // The plugins and the object manager are ready, called once
+    virtual void onContextReady() = 0;
+    // Mixer changes are only passed on for the nodes a listener watches
+    virtual bool watchesNode(uint32_t id) const = 0;
+    virtual void onNodeMixerChanged(uint32_t id) = 0;
+    virtual void onDefaultNodesChanged() = 0;
+  };
+
+  static std::shared_ptr<WireplumberContext> getInstance();
+  ~WireplumberContext();
+
+  // onContextReady() is called right away if the context already is
+  void subscribe(Listener* listener);
+  void unsubscribe(Listener* listener);
+
+  // Owned by the context, valid once it is ready
+  WpObjectManager* objectManager() const { return om_; }
+  WpPlugin* mixerApi() const { return mixer_api_; }
+  WpPlugin* defaultNodesApi() const { return def_nodes_api_; }
+
+ private:
+  WireplumberContext();
+
+  static void onDefaultNodesApiLoaded(WpObject* p, GAsyncResult* res, WireplumberContext* self);
+  static void onMixerApiLoaded(WpObject* p, GAsyncResult* res, WireplumberContext* self);
+  static void onPluginActivated(WpObject* p, GAsyncResult* res, WireplumberContext* self);
+  static void onObjectManagerInstalled(WireplumberContext* self);
+  static void onMixerChanged(WireplumberContext* self, uint32_t id);
+  static void onDefaultNodesApiChanged(WireplumberContext* self);
+  void activatePlugins();
+
+  WpCore* wp_core_ = nullptr;
+  GPtrArray* apis_ = nullptr;
+  WpObjectManager* om_ = nullptr;
+  WpPlugin* mixer_api_ = nullptr;
+  WpPlugin* def_nodes_api_ = nullptr;
+  uint32_t pending_plugins_ = 0;
+  bool ready_ = false;
+  std::vector<Listener*> listeners_;
+};
+
+}  // namespace waybar::util
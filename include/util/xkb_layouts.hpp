@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "util/string_map.hpp"
+
+namespace waybar::util {
+
+/* Process-wide index of the keyboard layouts of the xkb registry, by description ("English (US)"),
+ * which is how both sway and Hyprland name the active layout. The registry parses evdev.xml, tens
+ * of ms and several MB: that is done once, on the first lookup, and only the strings the language
+ * modules show are kept. Thread safe, it doesn't change once built.
+ */
+class XkbLayouts {
+ public:
+  struct Layout {
+    std::string short_name;  // "us"
+    std::string variant;     // "intl", empty for a base layout
+    // The brief of the layout, or of its base layout for a variant without one
+    std::string short_description;
+  };
+
+  static const XkbLayouts& inst();
+
+  // Null for a description the registry doesn't have
+  const Layout* find(std::string_view description) const;
+
+ private:
+  XkbLayouts();
+
+  StringMap<Layout> layouts_;
+};
+
+}  // namespace waybar::util
@@ -7,7 +7,7 @@
 extern "C" {
 #endif
 
-/// Waybar ABI version. 2 is the latest version
+/// Waybar ABI version. 3 is the latest version
 extern const size_t wbcffi_version;
 
 /// Private Waybar CFFI module
@@ -29,6 +29,37 @@ typedef struct {
   /// loop iteration
   /// @param obj Waybar CFFI object pointer
   void (*queue_update)(wbcffi_module*);
+
+  /// The fields below are only set from ABI version 3 onwards
+
+  /// Hands data over to the GTK main event loop, from any thread. The data is copied, and
+  /// wbcffi_update_data() is called with the latest one on the next main event loop iteration:
+  /// data published meanwhile is dropped, a burst of calls costs a single update.
+  /// @param obj Waybar CFFI object pointer
+  /// @param data Data to copy
+  /// @param len Size of data, in bytes
+  void (*publish)(wbcffi_module* obj, const void* data, size_t len);
+
+  /// Calls fn(user_data) every period_ms milliseconds, on the timer thread Waybar shares
+  /// between all modules. fn must return quickly, e.g. after publish() or queue_update(). Timers
+  /// are paused with the module, and removed before wbcffi_deinit() is called.
+  /// @param obj Waybar CFFI object pointer
+  /// @return The timer, for remove_timer()
+  uint64_t (*add_timer)(wbcffi_module* obj, uint32_t period_ms, void (*fn)(void* user_data),
+                        void* user_data);
+
+  /// Removes a timer. When this returns, fn is neither running nor going to run again, unless
+  /// called from fn itself.
+  /// @param obj Waybar CFFI object pointer
+  /// @param timer Timer returned by add_timer()
+  void (*remove_timer)(wbcffi_module* obj, uint64_t timer);
+
+  /// Records the value of a counter in the trace written with `waybar --trace`, does nothing
+  /// otherwise
+  /// @param obj Waybar CFFI object pointer
+  /// @param name Counter name, prefixed with the module name
+  /// @param value Counter value
+  void (*count)(wbcffi_module* obj, const char* name, int64_t value);
 } wbcffi_init_info;
 
 /// Config key-value pair
@@ -73,6 +104,16 @@ void wbcffi_deinit(void* instance);
 /// @param action_name Action name
 void wbcffi_update(void* instance);
 
+/// Called from the GTK main event loop with the latest data given to publish(), before
+/// wbcffi_update()
+///
+/// Optional CFFI function, from ABI version 3 onwards
+///
+/// @param instance Module instance data (as returned by `wbcffi_init`)
+/// @param data Published data, only valid during the call
+/// @param len Size of data, in bytes
+void wbcffi_update_data(void* instance, const void* data, size_t len);
+
 /// Called when Waybar receives a POSIX signal and forwards it to each module
 ///
 /// Optional CFFI function
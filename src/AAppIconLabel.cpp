@@ -6,9 +6,11 @@
 #include <glibmm/miscutils.h>
 #include <spdlog/spdlog.h>
 
-#include <filesystem>
 #include <optional>
+#include <string>
+#include <vector>
 
+#include "util/desktop_file_index.hpp"
 #include "util/gtk_icon.hpp"
 
 namespace waybar {
@@ -31,60 +33,21 @@ std::string toLowerCase(const std::string& input) {
   return result;
 }
 
-std::optional<std::string> getFileBySuffix(const std::string& dir, const std::string& suffix,
-                                           bool check_lower_case) {
-  if (!std::filesystem::exists(dir)) {
-    return {};
-  }
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
-    if (entry.is_regular_file()) {
-      std::string filename = entry.path().filename().string();
-      if (filename.size() < suffix.size()) {
-        continue;
-      }
-      if ((filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0) ||
-          (check_lower_case && filename.compare(filename.size() - suffix.size(), suffix.size(),
-                                                toLowerCase(suffix)) == 0)) {
-        return entry.path().string();
-      }
-    }
-  }
-
-  return {};
-}
-
-std::optional<std::string> getFileBySuffix(const std::string& dir, const std::string& suffix) {
-  return getFileBySuffix(dir, suffix, false);
-}
-
 std::optional<std::string> getDesktopFilePath(const std::string& app_identifier,
                                               const std::string& alternative_app_identifier) {
   if (app_identifier.empty()) {
     return {};
   }
 
-  auto data_dirs = Glib::get_system_data_dirs();
-  data_dirs.insert(data_dirs.begin(), Glib::get_user_data_dir());
-  for (const auto& data_dir : data_dirs) {
-    const auto data_app_dir = data_dir + "/applications/";
-    auto desktop_file_suffix = app_identifier + ".desktop";
-    // searching for file by suffix catches cases like terminal emulator "foot" where class is
-    // "footclient" and desktop file is named "org.codeberg.dnkl.footclient.desktop"
-    auto desktop_file_path = getFileBySuffix(data_app_dir, desktop_file_suffix, true);
-    // "true" argument allows checking for lowercase - this catches cases where class name is
-    // "LibreWolf" and desktop file is named "librewolf.desktop"
-    if (desktop_file_path.has_value()) {
-      return desktop_file_path;
-    }
-    if (!alternative_app_identifier.empty()) {
-      desktop_file_suffix = alternative_app_identifier + ".desktop";
-      desktop_file_path = getFileBySuffix(data_app_dir, desktop_file_suffix, true);
-      if (desktop_file_path.has_value()) {
-        return desktop_file_path;
-      }
-    }
+  // searching for file by suffix catches cases like terminal emulator "foot" where class is
+  // "footclient" and desktop file is named "org.codeberg.dnkl.footclient.desktop"
+  std::vector<std::string> suffixes{app_identifier + ".desktop"};
+  if (!alternative_app_identifier.empty()) {
+    suffixes.push_back(alternative_app_identifier + ".desktop");
   }
-  return {};
+  // the lowercase fallback in findBySuffix catches cases where class name is "LibreWolf" and
+  // desktop file is named "librewolf.desktop"
+  return util::DesktopFileIndex::inst().findBySuffix(suffixes, false);
 }
 
 std::optional<Glib::ustring> getIconName(const std::string& app_identifier,
@@ -121,18 +84,7 @@ std::optional<Glib::ustring> getIconName(const std::string& app_identifier,
     return {};
   }
 
-  try {
-    Glib::KeyFile desktop_file;
-    desktop_file.load_from_file(desktop_file_path.value());
-    return desktop_file.get_string("Desktop Entry", "Icon");
-  } catch (Glib::FileError& error) {
-    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path.value(),
-                 error.what().c_str());
-  } catch (Glib::KeyFileError& error) {
-    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path.value(),
-                 error.what().c_str());
-  }
-  return {};
+  return util::DesktopFileIndex::inst().getIconName(desktop_file_path.value());
 }
 
 void AAppIconLabel::updateAppIconName(const std::string& app_identifier,
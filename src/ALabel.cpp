@@ -1,7 +1,9 @@
 #include "ALabel.hpp"
 
 #include <fmt/format.h>
+#include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <util/command.hpp>
@@ -10,6 +12,32 @@
 
 namespace waybar {
 
+DiffLabel::~DiffLabel() {
+  spdlog::debug("Label {}: {} updates applied, {} skipped", std::string(get_name()), applied_,
+                skipped_);
+}
+
+void DiffLabel::set_markup(const Glib::ustring& markup) {
+  if (get_use_markup() && markup.raw() == gtk_label_get_label(gobj())) {
+    ++skipped_;
+    return;
+  }
+  ++applied_;
+  Gtk::Label::set_markup(markup);
+}
+
+void DiffLabel::set_tooltip_markup(const Glib::ustring& markup) {
+  gchar* current = gtk_widget_get_tooltip_markup(GTK_WIDGET(gobj()));
+  const bool same = current != nullptr && markup.raw() == current;
+  g_free(current);
+  if (same) {
+    ++skipped_;
+    return;
+  }
+  ++applied_;
+  Gtk::Label::set_tooltip_markup(markup);
+}
+
 ALabel::ALabel(const Json::Value& config, const std::string& name, const std::string& id,
                const std::string& format, uint16_t interval, bool ellipsize, bool enable_click,
                bool enable_scroll)
@@ -28,7 +56,37 @@ ALabel::ALabel(const Json::Value& config, const std::string& name, const std::st
                                ? std::max(1L,  // Minimum 1ms due to millisecond precision
                                           static_cast<long>(config_["interval"].asDouble()) * 1000)
                                : 1000 * (long)interval))),
-      default_format_(format_) {
+      interval_on_battery_(
+          config_["interval-on-battery"] == "once"
+              ? std::chrono::milliseconds::max()
+              : std::chrono::milliseconds(
+                    config_["interval-on-battery"].isNumeric()
+                        ? std::max(1L, static_cast<long>(
+                                           config_["interval-on-battery"].asDouble() * 1000))
+                        : 0)),
+      default_format_(format_),
+      state_module_(id.empty() ? name : name + '#' + id) {
+  const auto& format_icons = config_["format-icons"];
+  if (format_icons.isObject()) {
+    for (const auto& alt : format_icons.getMemberNames()) {
+      if (format_icons[alt].isString() || format_icons[alt].isArray()) {
+        format_icons_.alts.emplace(alt, iconList(format_icons[alt]));
+      }
+    }
+    format_icons_.fallback = iconList(format_icons["default"]);
+  } else {
+    format_icons_.fallback = iconList(format_icons);
+  }
+
+  if (config_["states"].isObject()) {
+    for (auto it = config_["states"].begin(); it != config_["states"].end(); ++it) {
+      if (it->isUInt() && it.key().isString()) {
+        states_.emplace_back(it.key().asString(), it->asUInt());
+      }
+    }
+    std::ranges::sort(states_, {}, &std::pair<std::string, uint8_t>::second);
+  }
+
   label_.set_name(name);
   if (!id.empty()) {
     label_.get_style_context()->add_class(id);
@@ -127,54 +185,95 @@ ALabel::ALabel(const Json::Value& config, const std::string& name, const std::st
   }
 }
 
-auto ALabel::update() -> void { AModule::update(); }
+ALabel::~ALabel() {
+  if (!state_key_.empty() && publishesState()) {
+    util::StateSocket::inst()->forget(state_key_);
+  }
+}
+
+void ALabel::setStateOutput(const std::string& output) {
+  state_output_ = output;
+  state_key_ = output + '/' + state_module_;
+}
 
-std::string ALabel::getIcon(uint16_t percentage, const std::string& alt, uint16_t max) {
-  auto format_icons = config_["format-icons"];
-  if (format_icons.isObject()) {
-    if (!alt.empty() && (format_icons[alt].isString() || format_icons[alt].isArray())) {
-      format_icons = format_icons[alt];
-    } else {
-      format_icons = format_icons["default"];
-    }
+auto ALabel::update() -> void {
+  if (!state_key_.empty() && publishesState()) {
+    publishState();
   }
-  if (format_icons.isArray()) {
-    auto size = format_icons.size();
-    if (size != 0U) {
-      auto idx = std::clamp(percentage / ((max == 0 ? 100 : max) / size), 0U, size - 1);
-      format_icons = format_icons[idx];
+  AModule::update();
+}
+
+void ALabel::publishState() {
+  Json::Value state(Json::objectValue);
+  state["module"] = state_module_;
+  state["output"] = state_output_;
+  state["text"] = label_.get_text().raw();
+  state["tooltip"] = label_.get_tooltip_text().raw();
+  state["visible"] = event_box_.get_visible();
+  auto &classes = state["class"] = Json::Value(Json::arrayValue);
+  for (const auto &name : label_.get_style_context()->list_classes()) {
+    classes.append(name.raw());
+  }
+  auto &fields = state["fields"] = Json::Value(Json::objectValue);
+  if (state_fields_.isObject()) {
+    fields.swap(state_fields_);
+  }
+  state_fields_ = Json::Value();
+  util::StateSocket::inst()->publish(state_key_, std::move(state));
+}
+
+bool ALabel::formatUses(const std::string& format, std::string_view name) {
+  if (format != format_fields_of_) {
+    format_fields_ = util::FormatFields(format);
+    format_fields_of_ = format;
+  }
+  return format_fields_.uses(name);
+}
+
+std::vector<std::string> ALabel::iconList(const Json::Value& icons) {
+  if (icons.isString()) {
+    return {icons.asString()};
+  }
+  std::vector<std::string> list;
+  if (icons.isArray()) {
+    list.reserve(icons.size());
+    for (const auto& icon : icons) {
+      list.push_back(icon.isString() ? icon.asString() : "");
     }
   }
-  if (format_icons.isString()) {
-    return format_icons.asString();
+  return list;
+}
+
+const std::string& ALabel::pickIcon(const std::vector<std::string>& icons, uint16_t percentage,
+                                    uint16_t max) const {
+  static const std::string none;
+  if (icons.empty()) {
+    return none;
   }
-  return "";
+  const unsigned size = icons.size();
+  const unsigned step = std::max((max == 0 ? 100U : max) / size, 1U);
+  return icons[std::min(percentage / step, size - 1)];
+}
+
+std::string ALabel::getIcon(uint16_t percentage, const std::string& alt, uint16_t max) {
+  if (!alt.empty()) {
+    if (auto it = format_icons_.alts.find(alt); it != format_icons_.alts.end()) {
+      return pickIcon(it->second, percentage, max);
+    }
+  }
+  return pickIcon(format_icons_.fallback, percentage, max);
 }
 
 std::string ALabel::getIcon(uint16_t percentage, const std::vector<std::string>& alts,
                             uint16_t max) {
-  auto format_icons = config_["format-icons"];
-  if (format_icons.isObject()) {
-    std::string _alt = "default";
-    for (const auto& alt : alts) {
-      if (!alt.empty() && (format_icons[alt].isString() || format_icons[alt].isArray())) {
-        _alt = alt;
-        break;
+  for (const auto& alt : alts) {
+    if (!alt.empty()) {
+      if (auto it = format_icons_.alts.find(alt); it != format_icons_.alts.end()) {
+        return pickIcon(it->second, percentage, max);
       }
     }
-    format_icons = format_icons[_alt];
-  }
-  if (format_icons.isArray()) {
-    auto size = format_icons.size();
-    if (size != 0U) {
-      auto idx = std::clamp(percentage / ((max == 0 ? 100 : max) / size), 0U, size - 1);
-      format_icons = format_icons[idx];
-    }
-  }
-  if (format_icons.isString()) {
-    return format_icons.asString();
   }
-  return "";
+  return pickIcon(format_icons_.fallback, percentage, max);
 }
 
 bool waybar::ALabel::handleToggle(GdkEventButton* const& e) {
@@ -194,32 +293,27 @@ void ALabel::handleGtkMenuEvent(GtkMenuItem* /*menuitem*/, gpointer data) {
 }
 
 std::string ALabel::getState(uint8_t value, bool lesser) {
-  if (!config_["states"].isObject()) {
-    return "";
+  // The lowest state at or above value when lesser, else the highest one at or below it
+  const std::string* valid_state = nullptr;
+  if (lesser) {
+    auto it = std::ranges::find_if(states_, [value](const auto& s) { return value <= s.second; });
+    valid_state = it != states_.end() ? &it->first : nullptr;
+  } else {
+    auto it = std::find_if(states_.rbegin(), states_.rend(),
+                           [value](const auto& s) { return value >= s.second; });
+    valid_state = it != states_.rend() ? &it->first : nullptr;
   }
-  // Get current state
-  std::vector<std::pair<std::string, uint8_t>> states;
-  if (config_["states"].isObject()) {
-    for (auto it = config_["states"].begin(); it != config_["states"].end(); ++it) {
-      if (it->isUInt() && it.key().isString()) {
-        states.emplace_back(it.key().asString(), it->asUInt());
-      }
+  const std::string state = valid_state != nullptr ? *valid_state : "";
+  if (state != current_state_) {
+    if (!current_state_.empty()) {
+      label_.get_style_context()->remove_class(current_state_);
     }
-  }
-  // Sort states
-  std::ranges::sort(states.begin(), states.end(), [&lesser](auto& a, auto& b) {
-    return lesser ? a.second < b.second : a.second > b.second;
-  });
-  std::string valid_state;
-  for (auto const& state : states) {
-    if ((lesser ? value <= state.second : value >= state.second) && valid_state.empty()) {
-      label_.get_style_context()->add_class(state.first);
-      valid_state = state.first;
-    } else {
-      label_.get_style_context()->remove_class(state.first);
+    if (!state.empty()) {
+      label_.get_style_context()->add_class(state);
     }
+    current_state_ = state;
   }
-  return valid_state;
+  return state;
 }
 
 }  // namespace waybar
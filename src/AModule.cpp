@@ -1,8 +1,10 @@
 #include "AModule.hpp"
 
 #include <fmt/format.h>
+#include <glibmm/main.h>
 #include <spdlog/spdlog.h>
 
+#include <csignal>
 #include <util/command.hpp>
 
 #include "gdk/gdk.h"
@@ -14,10 +16,16 @@ AModule::AModule(const Json::Value& config, const std::string& name, const std::
                  bool enable_click, bool enable_scroll)
     : name_(name),
       config_(config),
+      execDirect_{config_["exec-direct"].isBool() && config_["exec-direct"].asBool()},
+      refreshSignal_{config_["signal"].isInt() ? SIGRTMIN + config_["signal"].asInt() : 0},
+      action_runner_{config_["exec-policy"], execDirect_},
       isTooltip{config_["tooltip"].isBool() ? config_["tooltip"].asBool() : true},
       isExpand{config_["expand"].isBool() ? config_["expand"].asBool() : false},
       distance_scrolled_y_(0.0),
-      distance_scrolled_x_(0.0) {
+      distance_scrolled_x_(0.0),
+      minUpdateInterval_{config_["min-update-interval"].isUInt()
+                             ? config_["min-update-interval"].asUInt()
+                             : 0} {
   // Configure module action Map
   const Json::Value actions{config_["actions"]};
 
@@ -41,8 +49,8 @@ AModule::AModule(const Json::Value& config, const std::string& name, const std::
   bool hasUserEvents =
       std::find_if(eventMap_.cbegin(), eventMap_.cend(), [&config](const auto& eventEntry) {
         // True if there is any non-release type event
-        return eventEntry.first.second != GdkEventType::GDK_BUTTON_RELEASE &&
-               config[eventEntry.second].isString();
+        return eventEntry.type != GdkEventType::GDK_BUTTON_RELEASE &&
+               config[eventEntry.name].isString();
       }) != eventMap_.cend();
 
   if (enable_click || hasUserEvents) {
@@ -56,8 +64,8 @@ AModule::AModule(const Json::Value& config, const std::string& name, const std::
   bool hasReleaseEvent =
       std::find_if(eventMap_.cbegin(), eventMap_.cend(), [&config](const auto& eventEntry) {
         // True if there is any non-release type event
-        return eventEntry.first.second == GdkEventType::GDK_BUTTON_RELEASE &&
-               config[eventEntry.second].isString();
+        return eventEntry.type == GdkEventType::GDK_BUTTON_RELEASE &&
+               config[eventEntry.name].isString();
       }) != eventMap_.cend();
   if (hasReleaseEvent) {
     event_box_.add_events(Gdk::BUTTON_RELEASE_MASK);
@@ -82,25 +90,69 @@ AModule::AModule(const Json::Value& config, const std::string& name, const std::
   }
 }
 
-AModule::~AModule() {
-  for (const auto& pid : pid_children_) {
-    if (pid != -1) {
-      killpg(pid, SIGTERM);
-    }
+AModule::~AModule() { updateSource_.disconnect(); }
+
+auto AModule::connectUpdate(std::function<void()> fn) -> void {
+  updateFn_ = std::move(fn);
+  dp.connect(sigc::mem_fun(*this, &AModule::scheduleUpdate));
+}
+
+auto AModule::setPaused(bool paused) -> void {
+  paused_ = paused;
+  runHeldUpdate();
+}
+
+auto AModule::setHidden(bool hidden) -> void {
+  hidden_ = hidden;
+  runHeldUpdate();
+}
+
+void AModule::runHeldUpdate() {
+  if (!paused_ && !hidden_ && updateHeld_) {
+    updateHeld_ = false;
+    scheduleUpdate();
   }
 }
 
+void AModule::scheduleUpdate() {
+  if (paused_ || hidden_) {
+    updateHeld_ = true;
+    return;
+  }
+  if (updatePending_) {
+    return;  // the pending update will see the latest data
+  }
+  updatePending_ = true;
+  const auto since = std::chrono::steady_clock::now() - lastUpdate_;
+  if (since < minUpdateInterval_) {
+    const auto delay = std::chrono::ceil<std::chrono::milliseconds>(minUpdateInterval_ - since);
+    updateSource_ = Glib::signal_timeout().connect(sigc::mem_fun(*this, &AModule::runUpdate),
+                                                   delay.count(), Glib::PRIORITY_HIGH_IDLE);
+  } else {
+    updateSource_ = Glib::signal_idle().connect(sigc::mem_fun(*this, &AModule::runUpdate),
+                                                Glib::PRIORITY_HIGH_IDLE);
+  }
+}
+
+bool AModule::runUpdate() {
+  // cleared first, so data arriving during the update schedules the next one
+  updatePending_ = false;
+  lastUpdate_ = std::chrono::steady_clock::now();
+  updateFn_();
+  return false;
+}
+
 auto AModule::update() -> void {
   // Run user-provided update handler if configured
   if (config_["on-update"].isString()) {
-    pid_children_.push_back(util::command::forkExec(config_["on-update"].asString()));
+    action_runner_.run("on-update", config_["on-update"].asString());
   }
 }
 // Get mapping between event name and module action name
 // Then call overridden doAction in order to call appropriate module action
 auto AModule::doAction(const std::string& name) -> void {
   if (!name.empty()) {
-    const std::map<std::string, std::string>::const_iterator& recA{eventActionMap_.find(name)};
+    const auto recA = eventActionMap_.find(name);
     // Call overridden action if derived class has implemented it
     if (recA != eventActionMap_.cend() && name != recA->second) this->doAction(recA->second);
   }
@@ -153,22 +205,28 @@ bool AModule::handleToggle(GdkEventButton* const& e) { return handleUserEvent(e)
 
 bool AModule::handleRelease(GdkEventButton* const& e) { return handleUserEvent(e); }
 
+const AModule::Event* AModule::findEvent(uint button, GdkEventType type) {
+  const auto* event = std::find_if(eventMap_.begin(), eventMap_.end(), [&](const Event& event) {
+    return event.button == button && event.type == type;
+  });
+  return event != eventMap_.end() ? event : nullptr;
+}
+
 bool AModule::handleUserEvent(GdkEventButton* const& e) {
   std::string format{};
-  const std::map<std::pair<uint, GdkEventType>, std::string>::const_iterator& rec{
-      eventMap_.find(std::pair(e->button, e->type))};
+  const Event* rec = findEvent(e->button, e->type);
 
-  if (rec != eventMap_.cend()) {
+  if (rec != nullptr) {
     // First call module actions
-    this->AModule::doAction(rec->second);
+    this->AModule::doAction(rec->name);
 
-    format = rec->second;
+    format = rec->name;
   }
 
   // Check that a menu has been configured
-  if (config_["menu"].isString()) {
+  if (rec != nullptr && config_["menu"].isString()) {
     // Check if the event is the one specified for the "menu" option
-    if (rec->second == config_["menu"].asString()) {
+    if (config_["menu"].asString() == rec->name) {
       // Popup the menu
       gtk_widget_show_all(GTK_WIDGET(menu_));
       gtk_menu_popup_at_pointer(GTK_MENU(menu_), reinterpret_cast<GdkEvent*>(e));
@@ -186,7 +244,7 @@ bool AModule::handleUserEvent(GdkEventButton* const& e) {
       format.clear();
   }
   if (!format.empty()) {
-    pid_children_.push_back(util::command::forkExec(format));
+    action_runner_.run(rec->name, format);
   }
   dp.emit();
   return true;
@@ -270,8 +328,7 @@ bool AModule::handleScroll(GdkEventScroll* e) {
   // First call module actions
   this->AModule::doAction(eventName);
   // Second call user scripts
-  if (config_[eventName].isString())
-    pid_children_.push_back(util::command::forkExec(config_[eventName].asString()));
+  if (config_[eventName].isString()) action_runner_.run(eventName, config_[eventName].asString());
 
   dp.emit();
   return true;
@@ -15,7 +15,22 @@ ASlider::ASlider(const Json::Value& config, const std::string& name, const std::
   }
   scale_.get_style_context()->add_class(MODULE_CLASS);
   event_box_.add(scale_);
-  scale_.signal_value_changed().connect(sigc::mem_fun(*this, &ASlider::onValueChanged));
+  // A scroll or a drag moves the scale several times a frame, the backend hears of the last one
+  value_changed_ =
+      scale_.signal_value_changed().connect(sigc::mem_fun(*this, &ASlider::queueValueChanged));
+  // before the scale's own handlers, which take the events
+  scale_.signal_button_press_event().connect(
+      [this](GdkEventButton*) {
+        dragging_ = true;
+        return false;
+      },
+      false);
+  scale_.signal_button_release_event().connect(
+      [this](GdkEventButton*) {
+        dragging_ = false;
+        return false;
+      },
+      false);
 
   if (config_["min"].isUInt()) {
     min_ = config_["min"].asUInt();
@@ -30,6 +45,32 @@ ASlider::ASlider(const Json::Value& config, const std::string& name, const std::
   scale_.set_adjustment(Gtk::Adjustment::create(curr_, min_, max_ + 1, 1, 1, 1));
 }
 
+ASlider::~ASlider() {
+  if (value_tick_ != 0) {
+    scale_.remove_tick_callback(value_tick_);
+  }
+}
+
+void ASlider::queueValueChanged() {
+  if (value_tick_ != 0) {
+    return;
+  }
+  value_tick_ = scale_.add_tick_callback([this](const Glib::RefPtr<Gdk::FrameClock>&) {
+    value_tick_ = 0;
+    onValueChanged();
+    return false;
+  });
+}
+
+void ASlider::setValue(double value) {
+  if (dragging_) {
+    return;
+  }
+  value_changed_.block();
+  scale_.set_value(value);
+  value_changed_.unblock();
+}
+
 void ASlider::onValueChanged() {}
 
 }  // namespace waybar
\ No newline at end of file
@@ -1,15 +1,21 @@
 #include "bar.hpp"
 
+#include <fmt/chrono.h>
 #include <gtk-layer-shell.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
 #include <type_traits>
 
+#include "ALabel.hpp"
 #include "client.hpp"
 #include "factory.hpp"
 #include "group.hpp"
 #include "util/enum.hpp"
 #include "util/kill_signal.hpp"
+#include "util/memory.hpp"
+#include "util/trace.hpp"
 
 #ifdef HAVE_SWAY
 #include "modules/sway/bar.hpp"
@@ -139,6 +145,7 @@ waybar::Bar::Bar(struct waybar_output* w_output, const Json::Value& w_config)
       x_global(0),
       y_global(0),
       margins_{.top = 0, .right = 0, .bottom = 0, .left = 0},
+      loaded_config_(w_config),
       left_(Gtk::ORIENTATION_HORIZONTAL, 0),
       center_(Gtk::ORIENTATION_HORIZONTAL, 0),
       right_(Gtk::ORIENTATION_HORIZONTAL, 0),
@@ -221,7 +228,14 @@ waybar::Bar::Bar(struct waybar_output* w_output, const Json::Value& w_config)
   }
 
   window.signal_configure_event().connect_notify(sigc::mem_fun(*this, &Bar::onConfigure));
-  output->monitor->property_geometry().signal_changed().connect(
+  if (config["opaque"].isBool()) {
+    opaque_ = config["opaque"].asBool();
+    // GtkWindow sets its opaque region on both, these run after it
+    window.signal_size_allocate().connect_notify(
+        [this](Gtk::Allocation& /*allocation*/) { setOpaqueRegion(); }, true);
+    window.signal_style_updated().connect_notify([this] { setOpaqueRegion(); }, true);
+  }
+  geometry_connection_ = output->monitor->property_geometry().signal_changed().connect(
       sigc::mem_fun(*this, &Bar::onOutputGeometryChanged));
 
   // this has to be executed before GtkWindow.realize
@@ -305,7 +319,11 @@ waybar::Bar::Bar(struct waybar_output* w_output, const Json::Value& w_config)
     }
   }
 
+  const auto modules_start = std::chrono::steady_clock::now();
   setupWidgets();
+  spdlog::info("Bar on {}: modules built in {}", output->name,
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - modules_start));
   window.show_all();
 
   if (spdlog::should_log(spdlog::level::debug)) {
@@ -368,6 +386,7 @@ void waybar::Bar::setMode(const struct bar_mode& mode) {
     window.get_style_context()->add_class("hidden");
     window.set_opacity(0);
   }
+  setModulesPaused(!mode.visible);
   /*
    * All the changes above require `wl_surface_commit`.
    * gtk-layer-shell schedules a commit on the next frame event in GTK, but this could fail in
@@ -377,6 +396,17 @@ void waybar::Bar::setMode(const struct bar_mode& mode) {
   wl_display_flush(Client::inst()->wl_display);
 }
 
+void waybar::Bar::setModulesPaused(bool paused) {
+  if (paused == modules_paused_) {
+    return;
+  }
+  modules_paused_ = paused;
+  spdlog::debug("Bar {}: {} modules", output->name, paused ? "pausing" : "resuming");
+  for (auto& module : modules_all_) {
+    module->setPaused(paused);
+  }
+}
+
 void waybar::Bar::setPassThrough(bool passthrough) {
   auto gdk_window = window.get_window();
   if (gdk_window) {
@@ -388,6 +418,22 @@ void waybar::Bar::setPassThrough(bool passthrough) {
   }
 }
 
+void waybar::Bar::setOpaqueRegion() {
+  auto gdk_window = window.get_window();
+  if (!gdk_window || !opaque_) {
+    return;
+  }
+  /* The compositor doesn't blend what is under an opaque region, nor redraw it when only what is
+   * under changes. A null region is none at all.
+   */
+  Cairo::RefPtr<Cairo::Region> region;
+  if (*opaque_) {
+    region = Cairo::Region::create(
+        Cairo::RectangleInt{0, 0, gdk_window->get_width(), gdk_window->get_height()});
+  }
+  gdk_window_set_opaque_region(gdk_window->gobj(), region ? region->cobj() : nullptr);
+}
+
 void waybar::Bar::setPosition(Gtk::PositionType position) {
   std::array<gboolean, GTK_LAYER_SHELL_EDGE_ENTRY_NUMBER> anchors;
   anchors.fill(TRUE);
@@ -445,10 +491,17 @@ void waybar::Bar::onMap(GdkEventAny* /*unused*/) {
     return;
   }
 
+  if (surface == nullptr) {
+    spdlog::info("Bar on {}: mapped {} after startup", output->name,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - Client::inst()->started));
+    Client::inst()->trimMemorySoon();
+  }
   surface = gdk_wayland_window_get_wl_surface(gdk_window);
   configureGlobalOffset(gdk_window_get_width(gdk_window), gdk_window_get_height(gdk_window));
 
   setPassThrough(passthrough_);
+  setOpaqueRegion();
 }
 
 void waybar::Bar::setVisible(bool value) {
@@ -460,6 +513,26 @@ void waybar::Bar::setVisible(bool value) {
   }
 }
 
+bool waybar::Bar::boundToOutput() const {
+  return std::any_of(modules_all_.begin(), modules_all_.end(),
+                     [](const auto& module) { return module->boundToOutput(); });
+}
+
+void waybar::Bar::detachOutput() {
+  geometry_connection_.disconnect();
+  window.hide();
+  setModulesPaused(true);
+}
+
+void waybar::Bar::attachOutput() {
+  geometry_connection_ = output->monitor->property_geometry().signal_changed().connect(
+      sigc::mem_fun(*this, &Bar::onOutputGeometryChanged));
+  // Unmapped, the window gets its new layer surface on this monitor as it shows
+  gtk_layer_set_monitor(window.gobj(), output->monitor->gobj());
+  setModulesPaused(!configured_modes.at(last_mode_).visible);
+  window.show();
+}
+
 void waybar::Bar::toggle() { setVisible(!visible); }
 void waybar::Bar::show() { setVisible(true); }
 void waybar::Bar::hide() { setVisible(false); }
@@ -515,8 +588,21 @@ void waybar::Bar::setupAltFormatKeyForModuleList(const char* module_list_name) {
 }
 
 void waybar::Bar::handleSignal(int signal) {
-  for (auto& module : modules_all_) {
-    module->refresh(signal);
+  for (auto key : {signal, AModule::ANY_SIGNAL}) {
+    if (auto it = signal_modules_.find(key); it != signal_modules_.end()) {
+      for (auto* module : it->second) {
+        module->refresh(signal);
+      }
+    }
+  }
+}
+
+void waybar::Bar::logUpdateStats() {
+  spdlog::info("Bar on {}: module updates (count, p50, p99, max, total)", output->name);
+  for (const auto& [ref, stats] : update_stats_) {
+    spdlog::info("  {}: {}, {}, {}, {}, {}", ref, stats->count(), stats->percentile(0.5),
+                 stats->percentile(0.99), stats->max(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(stats->total()));
   }
 }
 
@@ -524,10 +610,11 @@ waybar::util::KillSignalAction waybar::Bar::getOnSigusr1Action() { return this->
 waybar::util::KillSignalAction waybar::Bar::getOnSigusr2Action() { return this->onSigusr2; }
 
 void waybar::Bar::getModules(const Factory& factory, const std::string& pos,
-                             waybar::Group* group = nullptr) {
+                             waybar::Group* group, Json::ArrayIndex first, Json::ArrayIndex last) {
   auto module_list = group != nullptr ? config[pos]["modules"] : config[pos];
   if (module_list.isArray()) {
-    for (const auto& name : module_list) {
+    for (auto i = first; i < std::min(last, module_list.size()); ++i) {
+      const auto& name = module_list[i];
       try {
         auto ref = name.asString();
         AModule* module;
@@ -540,21 +627,50 @@ void waybar::Bar::getModules(const Factory& factory, const std::string& pos,
           auto vertical = (group != nullptr ? group->getBox().get_orientation()
                                             : box_.get_orientation()) == Gtk::ORIENTATION_VERTICAL;
 
-          auto group_config = config[ref];
+          // by reference: the group module keeps it
+          const auto& group_config = config[ref];
           if (group_config["modules"].isNull()) {
             spdlog::warn("Group definition '{}' has not been found, group will be hidden", ref);
           }
           auto* group_module = new waybar::Group(id_name, class_name, group_config, vertical);
-          getModules(factory, ref, group_module);
+          if (group_module->isLazy()) {
+            // only the first module shows while the drawer is closed
+            getModules(factory, ref, group_module, 0, 1);
+            group_module->setBuilder(
+                [this, factory, ref, group_module] { getModules(factory, ref, group_module, 1); });
+          } else {
+            getModules(factory, ref, group_module);
+          }
           module = group_module;
         } else {
+          const bool account = spdlog::should_log(spdlog::level::debug);
+          const auto heap = account ? util::memory::heapInUse() : 0;
+          const auto start = std::chrono::steady_clock::now();
           module = factory.makeModule(ref, pos);
+          if (auto* label = dynamic_cast<ALabel*>(module)) {
+            label->setStateOutput(output->name);
+          }
+          if (account) {
+            // The startup allocations of its backend with it, for the first module using one
+            spdlog::debug("{} built in {}, {:+} KiB of heap", ref,
+                          std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - start),
+                          (static_cast<int64_t>(util::memory::heapInUse()) -
+                           static_cast<int64_t>(heap)) /
+                              1024);
+          }
         }
 
         std::shared_ptr<AModule> module_sp(module);
         modules_all_.emplace_back(module_sp);
+        if (auto signal = module->refreshSignal(); signal != 0) {
+          signal_modules_[signal].push_back(module);
+        }
+        if (modules_paused_) {
+          module->setPaused(true);
+        }
         if (group != nullptr) {
-          group->addWidget(*module);
+          group->addModule(*module);
         } else {
           if (pos == "modules-left") {
             modules_left_.emplace_back(module_sp);
@@ -566,12 +682,17 @@ void waybar::Bar::getModules(const Factory& factory, const std::string& pos,
             modules_right_.emplace_back(module_sp);
           }
         }
-        module->dp.connect([module, ref] {
+        auto stats = update_stats_.emplace_back(ref, std::make_shared<util::UpdateStats>()).second;
+        module->connectUpdate([module, ref, stats] {
+          const auto start = std::chrono::steady_clock::now();
           try {
+            util::trace::Span span(ref, "update");
             module->update();
           } catch (const std::exception& e) {
             spdlog::error("{}: {}", ref, e.what());
           }
+          stats->record(std::chrono::duration_cast<util::UpdateStats::Duration>(
+              std::chrono::steady_clock::now() - start));
         });
       } catch (const std::exception& e) {
         spdlog::warn("module {}: {}", name.asString(), e.what());
@@ -1,15 +1,40 @@
 #include "client.hpp"
 
+#include <fmt/chrono.h>
 #include <gtk-layer-shell.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <utility>
 
 #include "gtkmm/icontheme.h"
-#include "idle-inhibit-unstable-v1-client-protocol.h"
 #include "util/clara.hpp"
 #include "util/format.hpp"
+#include "util/log.hpp"
+#include "util/memory.hpp"
+#include "util/priority.hpp"
+#include "util/resume_wakeups.hpp"
+#include "util/scheduler.hpp"
+#include "util/state_socket.hpp"
+#include "util/trace.hpp"
+
+#include "idle-inhibit-unstable-v1-client-protocol.h"
+#include "wlr-screencopy-unstable-v1-client-protocol.h"
+
+namespace {
+
+// Set by any of the bars
+bool reloadStyleOnChange(const Json::Value &config) {
+  if (config.isArray()) {
+    return std::ranges::any_of(
+        config, [](const auto &conf) { return conf["reload_style_on_change"].asBool(); });
+  }
+  return config.isObject() && config["reload_style_on_change"].asBool();
+}
+
+}  // namespace
 
 waybar::Client *waybar::Client::inst() {
   static auto *c = new Client();
@@ -26,6 +51,12 @@ void waybar::Client::handleGlobal(void *data, struct wl_registry *registry, uint
   } else if (strcmp(interface, zwp_idle_inhibit_manager_v1_interface.name) == 0) {
     client->idle_inhibit_manager = static_cast<struct zwp_idle_inhibit_manager_v1 *>(
         wl_registry_bind(registry, name, &zwp_idle_inhibit_manager_v1_interface, 1));
+  } else if (strcmp(interface, zwlr_screencopy_manager_v1_interface.name) == 0) {
+    client->screencopy_manager = static_cast<struct zwlr_screencopy_manager_v1 *>(
+        wl_registry_bind(registry, name, &zwlr_screencopy_manager_v1_interface, 1));
+  } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+    client->shm =
+        static_cast<struct wl_shm *>(wl_registry_bind(registry, name, &wl_shm_interface, 1));
   }
 }
 
@@ -57,7 +88,7 @@ struct waybar::waybar_output &waybar::Client::getOutput(void *addr) {
   return *it;
 }
 
-std::vector<Json::Value> waybar::Client::getOutputConfigs(struct waybar_output &output) {
+std::vector<const Json::Value *> waybar::Client::getOutputConfigs(struct waybar_output &output) {
   return config.getOutputConfigs(output.name, output.identifier);
 }
 
@@ -77,11 +108,14 @@ void waybar::Client::handleOutputDone(void *data, struct zxdg_output_v1 * /*xdg_
     if (output.xdg_output) {
       output.xdg_output.reset();
       spdlog::debug("Output detection done: {} ({})", output.name, output.identifier);
+      if (client->restoreParkedOutput(output)) {
+        return;
+      }
 
       auto configs = client->getOutputConfigs(output);
       if (!configs.empty()) {
-        for (const auto &config : configs) {
-          client->bars.emplace_back(std::make_unique<Bar>(&output, config));
+        for (const auto *config : configs) {
+          client->bars.emplace_back(std::make_unique<Bar>(&output, *config));
         }
       }
     }
@@ -135,20 +169,69 @@ void waybar::Client::handleMonitorRemoved(Glib::RefPtr<Gdk::Monitor> monitor) {
 }
 
 void waybar::Client::handleDeferredMonitorRemoval(Glib::RefPtr<Gdk::Monitor> monitor) {
+  auto output = std::find_if(outputs_.begin(), outputs_.end(),
+                             [&monitor](const auto &output) { return output.monitor == monitor; });
+  /* Not when the output is back already, under another monitor: its bars are built. Nor when
+   * one of its bars is bound to it, which the restored output would then be missing.
+   */
+  const bool can_park =
+      output != outputs_.end() && !output->identifier.empty() &&
+      std::none_of(outputs_.begin(), outputs_.end(),
+                   [&output](const auto &other) {
+                     return &other != &*output && other.name == output->name &&
+                            other.identifier == output->identifier;
+                   }) &&
+      std::none_of(bars.begin(), bars.end(), [&monitor](const auto &bar) {
+        return bar->output->monitor == monitor && bar->boundToOutput();
+      });
+
+  ParkedOutput parked;
   for (auto it = bars.begin(); it != bars.end();) {
     if ((*it)->output->monitor == monitor) {
       auto output_name = (*it)->output->name;
-      (*it)->window.hide();
-      gtk_app->remove_window((*it)->window);
+      if (can_park) {
+        (*it)->detachOutput();
+        parked.bars.push_back(std::move(*it));
+        spdlog::info("Bar parked until output {} is back", output_name);
+      } else {
+        (*it)->window.hide();
+        gtk_app->remove_window((*it)->window);
+        spdlog::info("Bar removed from output: {}", output_name);
+      }
       it = bars.erase(it);
-      spdlog::info("Bar removed from output: {}", output_name);
     } else {
       ++it;
     }
   }
+  if (!parked.bars.empty()) {
+    parked.output.splice(parked.output.end(), outputs_, output);
+    parked_outputs_.push_back(std::move(parked));
+  }
   outputs_.remove_if([&monitor](const auto &output) { return output.monitor == monitor; });
 }
 
+bool waybar::Client::restoreParkedOutput(struct waybar_output &output) {
+  auto parked = std::find_if(parked_outputs_.begin(), parked_outputs_.end(), [&output](auto &p) {
+    return p.output.front().name == output.name && p.output.front().identifier == output.identifier;
+  });
+  if (parked == parked_outputs_.end()) {
+    return false;
+  }
+  // The bars and their modules point to the parked one: it takes the place of the new one
+  parked->output.front().monitor = output.monitor;
+  auto added = std::find_if(outputs_.begin(), outputs_.end(),
+                            [&output](const auto &other) { return &other == &output; });
+  outputs_.splice(added, parked->output);
+  outputs_.erase(added);
+  for (auto &bar : parked->bars) {
+    bar->attachOutput();
+    spdlog::info("Bar back on output: {}", bar->output->name);
+    bars.push_back(std::move(bar));
+  }
+  parked_outputs_.erase(parked);
+  return true;
+}
+
 const std::string waybar::Client::getStyle(const std::string &style,
                                            std::optional<Appearance> appearance = std::nullopt) {
   auto gtk_settings = Gtk::Settings::get_default();
@@ -182,25 +265,31 @@ const std::string waybar::Client::getStyle(const std::string &style,
   return css_file.value();
 };
 
-auto waybar::Client::setupCss(const std::string &css_file) -> void {
+auto waybar::Client::setupCss(Glib::RefPtr<Gtk::CssProvider> &provider,
+                              const std::string &css_file) -> void {
   auto screen = Gdk::Screen::get_default();
   if (!screen) {
     throw std::runtime_error("No default screen");
   }
 
-  if (css_provider_) {
-    Gtk::StyleContext::remove_provider_for_screen(screen, css_provider_);
-    css_provider_.reset();
+  // Reloading the provider in place restyles the bars once, where removing it and adding a new
+  // one restyled them twice. It is loaded from the path so relative @imports keep resolving.
+  const bool added = static_cast<bool>(provider);
+  if (!added) {
+    provider = Gtk::CssProvider::create();
   }
-
-  css_provider_ = Gtk::CssProvider::create();
-  if (!css_provider_->load_from_path(css_file)) {
-    css_provider_.reset();
+  if (!provider->load_from_path(css_file)) {
+    if (added) {
+      Gtk::StyleContext::remove_provider_for_screen(screen, provider);
+    }
+    provider.reset();
     throw std::runtime_error("Can't open style file");
   }
 
-  Gtk::StyleContext::add_provider_for_screen(screen, css_provider_,
-                                             GTK_STYLE_PROVIDER_PRIORITY_USER);
+  if (!added) {
+    Gtk::StyleContext::add_provider_for_screen(screen, provider,
+                                               GTK_STYLE_PROVIDER_PRIORITY_USER);
+  }
 }
 
 void waybar::Client::bindInterfaces() {
@@ -239,19 +328,29 @@ void waybar::Client::bindInterfaces() {
 }
 
 int waybar::Client::main(int argc, char *argv[]) {
+  started = std::chrono::steady_clock::now();
   bool show_help = false;
   bool show_version = false;
-  std::string config_opt;
-  std::string style_opt;
+  // Both repeatable: the bars of every config run in this one process, with every style
+  std::vector<std::string> config_opts;
+  std::vector<std::string> style_opts;
   std::string log_level;
+  std::string trace_path;
+  bool log_async = false;
   auto cli = clara::detail::Help(show_help) |
              clara::detail::Opt(show_version)["-v"]["--version"]("Show version") |
-             clara::detail::Opt(config_opt, "config")["-c"]["--config"]("Config path") |
-             clara::detail::Opt(style_opt, "style")["-s"]["--style"]("Style path") |
+             clara::detail::Opt([&](const std::string &path) { config_opts.push_back(path); },
+                                "config")["-c"]["--config"]("Config path, may be repeated") |
+             clara::detail::Opt([&](const std::string &path) { style_opts.push_back(path); },
+                                "style")["-s"]["--style"]("Style path, may be repeated") |
              clara::detail::Opt(
                  log_level,
                  "trace|debug|info|warning|error|critical|off")["-l"]["--log-level"]("Log level") |
+             clara::detail::Opt(log_async)["--log-async"]("Log from a thread of its own") |
              clara::detail::Opt(bar_id, "id")["-b"]["--bar"]("Bar id");
+#ifdef HAVE_TRACING
+  cli |= clara::detail::Opt(trace_path, "file")["--trace"]("Write Chrome trace events to file");
+#endif
   auto res = cli.parse(clara::detail::Args(argc, argv));
   if (!res) {
     spdlog::error("Error in command line: {}", res.errorMessage());
@@ -265,9 +364,15 @@ int waybar::Client::main(int argc, char *argv[]) {
     std::cout << "Waybar v" << VERSION << '\n';
     return 0;
   }
+  if (log_async) {
+    util::log::makeAsync();
+  }
   if (!log_level.empty()) {
     spdlog::set_level(spdlog::level::from_str(log_level));
   }
+  if (!trace_path.empty() && !util::trace::start(trace_path)) {
+    spdlog::error("Can't write the trace to {}: {}", trace_path, strerror(errno));
+  }
   gtk_app = Gtk::Application::create(argc, argv, "fr.arouillard.waybar",
                                      Gio::APPLICATION_HANDLES_COMMAND_LINE);
 
@@ -283,38 +388,179 @@ int waybar::Client::main(int argc, char *argv[]) {
     throw std::runtime_error("Bar need to run under Wayland");
   }
   wl_display = gdk_wayland_display_get_wl_display(gdk_display->gobj());
-  config.load(config_opt);
+  auto phase_start = std::chrono::steady_clock::now();
+  // The time since phase_start, which then starts the next phase
+  auto phase = [&phase_start] {
+    const auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now -
+                                                                 std::exchange(phase_start, now));
+  };
+  const auto gtk_init =
+      std::chrono::duration_cast<std::chrono::milliseconds>(phase_start - started);
+  config_opts_ = config_opts;
+  config.load(config_opts, true);
+  const auto config_load = phase();
   if (!portal) {
     portal = std::make_unique<waybar::Portal>();
   }
-  m_cssFile = getStyle(style_opt);
-  setupCss(m_cssFile);
-  m_cssReloadHelper = std::make_unique<CssReloadHelper>(m_cssFile, [&]() { setupCss(m_cssFile); });
+  if (style_opts.empty()) {
+    style_opts.emplace_back();
+  }
+  // Sized once, the reload helpers keep a pointer to their style. The providers of the last run
+  // go, the -s may differ.
+  if (auto screen = Gdk::Screen::get_default()) {
+    for (auto &style : styles_) {
+      if (style.provider) {
+        Gtk::StyleContext::remove_provider_for_screen(screen, style.provider);
+      }
+    }
+  }
+  styles_.clear();
+  styles_.reserve(style_opts.size());
+  for (auto &opt : style_opts) {
+    auto &style = styles_.emplace_back(Style{.opt = std::move(opt)});
+    style.file = getStyle(style.opt);
+    setupCss(style.provider, style.file);
+    style.reload_helper = std::make_unique<CssReloadHelper>(
+        style.file, [this, &style]() { setupCss(style.provider, style.file); });
+  }
   portal->signal_appearance_changed().connect([&](waybar::Appearance appearance) {
-    auto css_file = getStyle(style_opt, appearance);
-    setupCss(css_file);
+    for (auto &style : styles_) {
+      setupCss(style.provider, getStyle(style.opt, appearance));
+    }
   });
 
-  auto m_config = config.getConfig();
-  if (m_config.isObject() && m_config["reload_style_on_change"].asBool()) {
-    m_cssReloadHelper->monitorChanges();
-  } else if (m_config.isArray()) {
+  const auto &m_config = config.getConfig();
+  reload_style_on_change_ = reloadStyleOnChange(m_config);
+  if (reload_style_on_change_) {
+    for (auto &style : styles_) {
+      style.reload_helper->monitorChanges();
+    }
+  }
+
+  // The options of the process rather than of a bar, the first bar with one sets it
+  auto global = [&m_config](const char *key) -> const Json::Value * {
+    if (m_config.isObject()) {
+      return m_config.isMember(key) ? &m_config[key] : nullptr;
+    }
     for (const auto &conf : m_config) {
-      if (conf["reload_style_on_change"].asBool()) {
-        m_cssReloadHelper->monitorChanges();
-        break;
+      if (conf.isObject() && conf.isMember(key)) {
+        return &conf[key];
       }
     }
-  }
+    return nullptr;
+  };
+  // set on every reload, to the defaults once removed
+  const auto *stagger = global("resume-stagger");
+  util::ResumeWakeups::inst().setWindow(stagger && stagger->isUInt()
+                                            ? std::chrono::milliseconds(stagger->asUInt())
+                                            : util::ResumeWakeups::DEFAULT_WINDOW);
+  const auto *priority = global("background-priority");
+  util::setBackgroundPriority(priority ? util::parsePriority(*priority) : util::Priority{});
+  const auto *state_socket = global("state-socket");
+  util::StateSocket::configure(state_socket ? *state_socket : Json::Value());
+  const auto *factor = global("interval-on-battery-factor");
+  util::Scheduler::inst().setBatteryFactor(factor && factor->isNumeric() ? factor->asDouble() : 1);
+
+  const auto style_load = phase();
 
   bindInterfaces();
+  spdlog::info("Startup: gtk {}, config {}, style {}, outputs and bars {}", gtk_init, config_load,
+               style_load, phase());
+  logMemory("after startup");
   gtk_app->hold();
   gtk_app->run();
-  m_cssReloadHelper.reset();  // stop watching css file
+  for (auto &style : styles_) {
+    style.reload_helper.reset();  // stop watching css file
+  }
   bars.clear();
+  parked_outputs_.clear();
   return 0;
 }
 
+void waybar::Client::trimMemorySoon() {
+  if (trim_connection_.connected()) {
+    return;
+  }
+  // By then the modules have run their first updates, and dropped the replies, theme scans and
+  // desktop files that went into them
+  trim_connection_ = Glib::signal_timeout().connect_seconds(
+      [this] {
+        util::memory::trim();
+        logMemory("after trimming");
+        return false;
+      },
+      2);
+}
+
+void waybar::Client::logMemory(const char *when) {
+  spdlog::info("Memory {}: {} KiB resident, {} KiB of heap in use", when,
+               util::memory::residentSize() / 1024, util::memory::heapInUse() / 1024);
+}
+
+bool waybar::Client::reload() {
+  const auto start = std::chrono::steady_clock::now();
+  Config next;
+  try {
+    next.load(config_opts_, true);
+  } catch (const std::exception &e) {
+    spdlog::error("Can't reload the config, keeping the running one: {}", e.what());
+    return false;
+  }
+  config = std::move(next);
+  const bool reload_style_on_change = reloadStyleOnChange(config.getConfig());
+  for (auto &style : styles_) {
+    auto file = getStyle(style.opt);
+    // A style that resolves to another file now, or is watched as of this config, gets a helper
+    // watching what it resolved to
+    if (file != style.file || reload_style_on_change != reload_style_on_change_) {
+      style.reload_helper = std::make_unique<CssReloadHelper>(
+          file, [this, &style]() { setupCss(style.provider, style.file); });
+      if (reload_style_on_change) {
+        style.reload_helper->monitorChanges();
+      }
+    }
+    style.file = std::move(file);
+    setupCss(style.provider, style.file);
+  }
+  reload_style_on_change_ = reload_style_on_change;
+
+  // Their config may have changed meanwhile, they are built again when the output comes back
+  parked_outputs_.clear();
+
+  std::vector<std::unique_ptr<Bar>> kept;
+  size_t built = 0;
+  for (auto &output : outputs_) {
+    if (output.xdg_output) {
+      continue;  // its bars are built as it's done, with the new config
+    }
+    for (const auto *bar_config : getOutputConfigs(output)) {
+      auto same = std::find_if(bars.begin(), bars.end(), [&](const auto &bar) {
+        return bar && bar->output == &output && bar->loadedConfig() == *bar_config;
+      });
+      if (same != bars.end()) {
+        kept.push_back(std::move(*same));
+      } else {
+        kept.push_back(std::make_unique<Bar>(&output, *bar_config));
+        ++built;
+      }
+    }
+  }
+  // Gone only now: a backend that the new bars use too was never without a user
+  for (auto &bar : bars) {
+    if (bar) {
+      bar->window.hide();
+      gtk_app->remove_window(bar->window);
+    }
+  }
+  bars = std::move(kept);
+  spdlog::info("Reloaded in {}: {} bars kept, {} built",
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start),
+               bars.size() - built, built);
+  return true;
+}
+
 void waybar::Client::reset() {
   gtk_app->quit();
   // delete signal handler for css changes
@@ -1,6 +1,7 @@
 #include "config.hpp"
 
 #include <spdlog/spdlog.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #ifndef __OpenBSD__
 #include <wordexp.h>
@@ -8,8 +9,11 @@
 #include <glob.h>
 #endif
 
+#include <cctype>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <map>
 #include <stdexcept>
 
 #include "util/json.hpp"
@@ -25,6 +29,180 @@ const std::vector<std::string> Config::CONFIG_DIRS = {
 
 const char *Config::CONFIG_PATH_ENV = "WAYBAR_CONFIG_DIR";
 
+namespace {
+
+/* What a load looked at: the paths it tried by the state they were in, the variables it expanded
+ * by their value. Its result holds as long as all of them are as recorded.
+ */
+struct LoadInputs {
+  std::map<std::string, std::string> paths;  // to stamp(), empty if missing
+  std::map<std::string, std::optional<std::string>> env;
+  bool cacheable = true;  // false once a path ran a command substitution
+};
+
+constexpr int CACHE_VERSION = 1;
+
+// Of the load in progress, if it is to be cached. Configs are loaded on the main thread only
+LoadInputs *recording = nullptr;
+
+std::string stamp(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return {};
+  }
+  return fmt::format("{}:{}:{}:{}.{}", st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec,
+                     st.st_mtim.tv_nsec);
+}
+
+std::optional<std::string> getEnv(const std::string &name) {
+  if (const char *value = std::getenv(name.c_str())) {
+    return value;
+  }
+  return std::nullopt;
+}
+
+// The path, and its directory: a file appearing there can change what a lookup or a glob finds
+void recordPath(const std::string &path) {
+  recording->paths.emplace(path, stamp(path));
+  if (auto dir = fs::path(path).parent_path(); !dir.empty()) {
+    recording->paths.emplace(dir.string(), stamp(dir.string()));
+  }
+}
+
+void recordVariables(const std::string &pattern) {
+  if (pattern.starts_with('~')) {
+    recording->env.emplace("HOME", getEnv("HOME"));
+  }
+  for (size_t i = 0; i < pattern.size(); i++) {
+    if (pattern[i] == '`') {
+      recording->cacheable = false;
+    }
+    if (pattern[i] != '$' || i + 1 == pattern.size()) {
+      continue;
+    }
+    size_t start = i + 1;
+    size_t end = start;
+    if (pattern[start] == '(') {
+      recording->cacheable = false;
+      continue;
+    }
+    if (pattern[start] == '{') {
+      end = pattern.find_first_of("}:-=?+", ++start);
+      if (end == std::string::npos) {
+        end = pattern.size();
+      }
+    } else {
+      while (end < pattern.size() && (std::isalnum(static_cast<unsigned char>(pattern[end])) != 0 ||
+                                      pattern[end] == '_')) {
+        end++;
+      }
+    }
+    if (end > start) {
+      auto name = pattern.substr(start, end - start);
+      recording->env.emplace(name, getEnv(name));
+    }
+  }
+}
+
+// One file per config argument and working directory, empty without a cache directory
+std::string cachePath(const std::string &config, const std::string &cwd) {
+  fs::path dir;
+  if (const char *cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home) {
+    dir = cache_home;
+  } else if (const char *home = std::getenv("HOME"); home && *home) {
+    dir = fs::path(home) / ".cache";
+  } else {
+    return {};
+  }
+  const auto key = std::hash<std::string>{}(config + '\0' + cwd);
+  return (dir / "waybar" / fmt::format("config-{:016x}.json", key)).string();
+}
+
+std::string currentDir() {
+  std::error_code ec;
+  return fs::current_path(ec).string();
+}
+
+// The config file and the resolved config of the cache, if it's still what a load would give
+bool readCache(const std::string &cache_file, const std::string &config, std::string &file,
+               Json::Value &value) {
+  std::ifstream in(cache_file);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::string str((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  Json::Value cache;
+  try {
+    cache = util::JsonParser().parse(str);
+  } catch (const std::exception &e) {
+    spdlog::debug("Ignoring config cache {}: {}", cache_file, e.what());
+    return false;
+  }
+  if (!cache.isObject() || cache["version"] != CACHE_VERSION || cache["config-arg"] != config ||
+      cache["cwd"] != currentDir() || !cache["file"].isString()) {
+    return false;
+  }
+  const auto &env = cache["env"];
+  for (auto it = env.begin(); it != env.end(); ++it) {
+    auto value = getEnv(it.name());
+    if (it->isNull() ? value.has_value() : value != it->asString()) {
+      spdlog::debug("Config cache is stale: ${} changed", it.name());
+      return false;
+    }
+  }
+  const auto &paths = cache["paths"];
+  for (auto it = paths.begin(); it != paths.end(); ++it) {
+    if (stamp(it.name()) != it->asString()) {
+      spdlog::debug("Config cache is stale: {} changed", it.name());
+      return false;
+    }
+  }
+  file = cache["file"].asString();
+  value = std::move(cache["config"]);
+  return true;
+}
+
+void writeCache(const std::string &cache_file, const std::string &config, const LoadInputs &inputs,
+                const std::string &file, const Json::Value &value) {
+  Json::Value cache(Json::objectValue);
+  cache["version"] = CACHE_VERSION;
+  cache["config-arg"] = config;
+  cache["cwd"] = currentDir();
+  cache["file"] = file;
+  auto &env = cache["env"] = Json::Value(Json::objectValue);
+  for (const auto &[name, val] : inputs.env) {
+    env[name] = val ? Json::Value(*val) : Json::Value();
+  }
+  auto &paths = cache["paths"] = Json::Value(Json::objectValue);
+  for (const auto &[path, path_stamp] : inputs.paths) {
+    paths[path] = path_stamp;
+  }
+  cache["config"] = value;
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  std::error_code ec;
+  fs::create_directories(fs::path(cache_file).parent_path(), ec);
+  // Written aside and renamed over, so that another waybar never reads half of it
+  const auto tmp_file = fmt::format("{}.{}", cache_file, getpid());
+  {
+    std::ofstream out(tmp_file, std::ios::trunc);
+    out << Json::writeString(builder, cache);
+    if (!out.good()) {
+      spdlog::debug("Can't write the config cache {}", tmp_file);
+      fs::remove(tmp_file, ec);
+      return;
+    }
+  }
+  fs::rename(tmp_file, cache_file, ec);
+  if (ec) {
+    spdlog::debug("Can't write the config cache {}: {}", cache_file, ec.message());
+    fs::remove(tmp_file, ec);
+  }
+}
+
+}  // namespace
+
 std::vector<std::string> Config::tryExpandPath(const std::string &base,
                                                const std::string &filename) {
   fs::path path;
@@ -36,12 +214,18 @@ std::vector<std::string> Config::tryExpandPath(const std::string &base,
   }
 
   spdlog::debug("Try expanding: {}", path.string());
+  if (recording != nullptr) {
+    recordVariables(path.string());
+  }
 
   std::vector<std::string> results;
 #ifndef __OpenBSD__
   wordexp_t p;
   if (wordexp(path.c_str(), &p, 0) == 0) {
     for (size_t i = 0; i < p.we_wordc; i++) {
+      if (recording != nullptr) {
+        recordPath(p.we_wordv[i]);
+      }
       if (access(p.we_wordv[i], F_OK) == 0) {
         results.emplace_back(p.we_wordv[i]);
         spdlog::debug("Found config file: {}", p.we_wordv[i]);
@@ -51,8 +235,14 @@ std::vector<std::string> Config::tryExpandPath(const std::string &base,
   }
 #else
   glob_t p;
+  if (recording != nullptr) {
+    recordPath(path.string());
+  }
   if (glob(path.c_str(), 0, NULL, &p) == 0) {
     for (size_t i = 0; i < p.gl_pathc; i++) {
+      if (recording != nullptr) {
+        recordPath(p.gl_pathv[i]);
+      }
       if (access(p.gl_pathv[i], F_OK) == 0) {
         results.emplace_back(p.gl_pathv[i]);
         spdlog::debug("Found config file: {}", p.gl_pathv[i]);
@@ -89,6 +279,9 @@ void Config::setupConfig(Json::Value &dst, const std::string &config_file, int d
   if (depth > 100) {
     throw std::runtime_error("Aborting due to likely recursive include in config files");
   }
+  if (recording != nullptr) {
+    recordPath(config_file);
+  }
   std::ifstream file(config_file);
   if (!file.is_open()) {
     throw std::runtime_error("Can't open config file");
@@ -211,28 +404,72 @@ bool isValidOutput(const Json::Value &config, const std::string &name,
   return true;
 }
 
-void Config::load(const std::string &config) {
+void Config::load(const std::string &config, bool cached) {
+  const auto cache_file = cached ? cachePath(config, currentDir()) : std::string();
+  std::string config_file;
+  if (!cache_file.empty() && readCache(cache_file, config, config_file, config_)) {
+    spdlog::info("Using configuration file {} (cached)", config_file);
+    config_files_ = {std::move(config_file)};
+    return;
+  }
+
+  LoadInputs inputs;
+  struct Recording {
+    explicit Recording(LoadInputs *inputs) { recording = inputs; }
+    ~Recording() { recording = nullptr; }
+  } scope(cache_file.empty() ? nullptr : &inputs);
+  inputs.env.emplace(CONFIG_PATH_ENV, getEnv(CONFIG_PATH_ENV));
+
   auto file = config.empty() ? findConfigPath({"config", "config.jsonc"}) : config;
   if (!file) {
     throw std::runtime_error("Missing required resource files");
   }
-  config_file_ = file.value();
-  spdlog::info("Using configuration file {}", config_file_);
+  config_file = file.value();
+  spdlog::info("Using configuration file {}", config_file);
   config_ = Json::Value();
-  setupConfig(config_, config_file_, 0);
+  setupConfig(config_, config_file, 0);
+  if (!cache_file.empty() && inputs.cacheable) {
+    writeCache(cache_file, config, inputs, config_file, config_);
+  }
+  config_files_ = {std::move(config_file)};
+}
+
+void Config::load(const std::vector<std::string> &configs, bool cached) {
+  if (configs.size() <= 1) {
+    load(configs.empty() ? std::string() : configs.front(), cached);
+    return;
+  }
+  Json::Value bars(Json::arrayValue);
+  std::vector<std::string> files;
+  for (const auto &path : configs) {
+    // each cached on its own, against the inputs of that one
+    Config one;
+    one.load(path, cached);
+    files.insert(files.end(), one.config_files_.begin(), one.config_files_.end());
+    auto &loaded = one.getConfig();
+    if (loaded.isArray()) {
+      for (auto &bar : loaded) {
+        bars.append(std::move(bar));
+      }
+    } else {
+      bars.append(std::move(loaded));
+    }
+  }
+  config_files_ = std::move(files);
+  config_ = std::move(bars);
 }
 
-std::vector<Json::Value> Config::getOutputConfigs(const std::string &name,
-                                                  const std::string &identifier) {
-  std::vector<Json::Value> configs;
+std::vector<const Json::Value *> Config::getOutputConfigs(const std::string &name,
+                                                          const std::string &identifier) {
+  std::vector<const Json::Value *> configs;
   if (config_.isArray()) {
     for (auto const &config : config_) {
       if (config.isObject() && isValidOutput(config, name, identifier)) {
-        configs.push_back(config);
+        configs.push_back(&config);
       }
     }
   } else if (isValidOutput(config_, name, identifier)) {
-    configs.push_back(config_);
+    configs.push_back(&config_);
   }
   return configs;
 }
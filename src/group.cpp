@@ -1,6 +1,7 @@
 #include "group.hpp"
 
 #include <fmt/format.h>
+#include <glibmm/main.h>
 
 #include <util/command.hpp>
 
@@ -63,6 +64,10 @@ Group::Group(const std::string& name, const std::string& id, const Json::Value&
                                     ? drawer_config["transition-left-to-right"].asBool()
                                     : true);
     click_to_reveal = drawer_config["click-to-reveal"].asBool();
+    lazy_ = drawer_config["lazy"].asBool();
+    reveal_delay_ =
+        drawer_config["reveal-delay"].isUInt() ? drawer_config["reveal-delay"].asUInt() : 100;
+    hide_delay_ = drawer_config["hide-delay"].isUInt() ? drawer_config["hide-delay"].asUInt() : 250;
 
     auto transition_type = getPreferredTransitionType(vertical);
 
@@ -84,26 +89,81 @@ Group::Group(const std::string& name, const std::string& id, const Json::Value&
   event_box_.add(box);
 }
 
+Group::~Group() {
+  reveal_timer_.disconnect();
+  hide_timer_.disconnect();
+}
+
 void Group::show_group() {
-  box.set_state_flags(Gtk::StateFlags::STATE_FLAG_PRELIGHT);
+  reveal_timer_.disconnect();
+  hide_timer_.disconnect();
+  if (revealed_) {
+    return;
+  }
+  revealed_ = true;
+  if (build_) {
+    // moved out first, the widgets it adds must not build again
+    auto build = std::move(build_);
+    build_ = nullptr;
+    build();
+    revealer_box.show_all();
+  }
+  updateHidden();
+  // Only the drawer changes state: one on the whole box would restyle the leader with it
+  revealer.set_state_flags(Gtk::StateFlags::STATE_FLAG_PRELIGHT);
   revealer.set_reveal_child(true);
 }
 
 void Group::hide_group() {
-  box.unset_state_flags(Gtk::StateFlags::STATE_FLAG_PRELIGHT);
+  reveal_timer_.disconnect();
+  hide_timer_.disconnect();
+  if (!revealed_) {
+    return;
+  }
+  revealed_ = false;
+  revealer.unset_state_flags(Gtk::StateFlags::STATE_FLAG_PRELIGHT);
   revealer.set_reveal_child(false);
+  updateHidden();
 }
 
 bool Group::handleMouseEnter(GdkEventCrossing* const& e) {
-  if (!click_to_reveal) {
+  if (click_to_reveal) {
+    return false;
+  }
+  hide_timer_.disconnect();
+  if (revealed_ || reveal_timer_.connected()) {
+    return false;
+  }
+  if (reveal_delay_ == 0) {
     show_group();
+  } else {
+    reveal_timer_ = Glib::signal_timeout().connect(
+        [this] {
+          show_group();
+          return false;
+        },
+        reveal_delay_);
   }
   return false;
 }
 
 bool Group::handleMouseLeave(GdkEventCrossing* const& e) {
-  if (!click_to_reveal && e->detail != GDK_NOTIFY_INFERIOR) {
+  if (click_to_reveal || e->detail == GDK_NOTIFY_INFERIOR) {
+    return false;
+  }
+  reveal_timer_.disconnect();
+  if (!revealed_ || hide_timer_.connected()) {
+    return false;
+  }
+  if (hide_delay_ == 0) {
     hide_group();
+  } else {
+    hide_timer_ = Glib::signal_timeout().connect(
+        [this] {
+          hide_group();
+          return false;
+        },
+        hide_delay_);
   }
   return false;
 }
@@ -112,7 +172,7 @@ bool Group::handleToggle(GdkEventButton* const& e) {
   if (!click_to_reveal || e->button != 1) {
     return false;
   }
-  if ((box.get_state_flags() & Gtk::StateFlags::STATE_FLAG_PRELIGHT) != 0U) {
+  if (revealed_) {
     hide_group();
   } else {
     show_group();
@@ -124,6 +184,21 @@ auto Group::update() -> void {
   // noop
 }
 
+auto Group::setHidden(bool hidden) -> void {
+  AModule::setHidden(hidden);
+  hidden_ = hidden;
+  updateHidden();
+}
+
+void Group::updateHidden() {
+  for (auto* module : modules_) {
+    module->setHidden(hidden_);
+  }
+  for (auto* module : drawer_modules_) {
+    module->setHidden(hidden_ || !revealed_);
+  }
+}
+
 Gtk::Box& Group::getBox() { return is_drawer ? (is_first_widget ? box : revealer_box) : box; }
 
 void Group::addWidget(Gtk::Widget& widget) {
@@ -136,6 +211,18 @@ void Group::addWidget(Gtk::Widget& widget) {
   is_first_widget = false;
 }
 
+void Group::addModule(AModule& module) {
+  const bool in_drawer = is_drawer && !is_first_widget;
+  addWidget(module);
+  if (in_drawer) {
+    drawer_modules_.push_back(&module);
+    module.setHidden(hidden_ || !revealed_);
+  } else {
+    modules_.push_back(&module);
+    module.setHidden(hidden_);
+  }
+}
+
 Group::operator Gtk::Widget&() { return event_box_; }
 
 }  // namespace waybar
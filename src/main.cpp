@@ -3,19 +3,30 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <atomic>
 #include <csignal>
-#include <list>
-#include <mutex>
+#include <cstdint>
 
 #include "bar.hpp"
 #include "client.hpp"
 #include "util/SafeSignal.hpp"
-
-std::mutex reap_mtx;
-std::list<pid_t> reap;
+#include "util/command.hpp"
+#include "util/log.hpp"
+#include "util/trace.hpp"
 
 static int signal_pipe_write_fd;
 
+/* The SIGRTMIN+N signals on their way to the main thread, bit N. A key held down makes scripts
+ * send the same one dozens of times a second: the repeats are dropped until the main thread
+ * took the first, so the modules refresh once per main loop iteration.
+ */
+static std::atomic<uint64_t> pending_refresh_signals{0};
+
+static uint64_t refreshSignalBit(int signum) {
+  const int rtmin = SIGRTMIN;  // not parenthesized on OpenBSD
+  return uint64_t{1} << (signum - rtmin);
+}
+
 // Write a single signal to `signal_pipe_write_fd`.
 // This function is set as a signal handler, so it must be async-signal-safe.
 static void writeSignalToPipe(int signum) {
@@ -29,7 +40,7 @@ static void writeSignalToPipe(int signum) {
 // This initializes `signal_pipe_write_fd`, and sets up signal handlers.
 //
 // This function will run forever, emitting every `SIGUSR1`, `SIGUSR2`,
-// `SIGINT`, `SIGCHLD`, and `SIGRTMIN + 1`...`SIGRTMAX` signal received
+// `SIGINT`, `SIGCHLD`, and `SIGRTMIN`...`SIGRTMAX` signal received
 // to `signal_handler`.
 static void catchSignals(waybar::SafeSignal<int>& signal_handler) {
   int fd[2];
@@ -51,6 +62,7 @@ static void catchSignals(waybar::SafeSignal<int>& signal_handler) {
   std::signal(SIGUSR2, writeSignalToPipe);
   std::signal(SIGINT, writeSignalToPipe);
   std::signal(SIGCHLD, writeSignalToPipe);
+  std::signal(SIGRTMIN, writeSignalToPipe);
 
   for (int sig = SIGRTMIN + 1; sig <= SIGRTMAX; ++sig) {
     std::signal(sig, writeSignalToPipe);
@@ -68,6 +80,13 @@ static void catchSignals(waybar::SafeSignal<int>& signal_handler) {
       continue;
     }
 
+    if (signum >= SIGRTMIN + 1 && signum <= SIGRTMAX) {
+      const uint64_t bit = refreshSignalBit(signum);
+      if ((pending_refresh_signals.fetch_or(bit) & bit) != 0) {
+        continue;
+      }
+    }
+
     signal_handler.emit(signum);
   }
 }
@@ -83,7 +102,7 @@ waybar::util::KillSignalAction getActionForBar(waybar::Bar* bar, int signal) {
   }
 }
 
-void handleUserSignal(int signal, bool& reload) {
+void handleUserSignal(int signal) {
   int i = 0;
   for (auto& bar : waybar::Client::inst()->bars) {
     switch (getActionForBar(bar.get(), signal)) {
@@ -101,8 +120,7 @@ void handleUserSignal(int signal, bool& reload) {
         break;
       case waybar::util::KillSignalAction::RELOAD:
         spdlog::info("Reloading...");
-        reload = true;
-        waybar::Client::inst()->reset();
+        waybar::Client::inst()->reload();
         return;
       case waybar::util::KillSignalAction::NOOP:
         break;
@@ -117,18 +135,27 @@ void handleUserSignal(int signal, bool& reload) {
 // `true` or `false`, respectively, into `reload`.
 static void handleSignalMainThread(int signum, bool& reload) {
   if (signum >= SIGRTMIN + 1 && signum <= SIGRTMAX) {
+    // cleared first: a signal coming in from here on is delivered again
+    pending_refresh_signals.fetch_and(~refreshSignalBit(signum));
     for (auto& bar : waybar::Client::inst()->bars) {
       bar->handleSignal(signum);
     }
     return;
   }
+  if (signum == SIGRTMIN) {
+    for (auto& bar : waybar::Client::inst()->bars) {
+      bar->logUpdateStats();
+    }
+    waybar::Client::inst()->logMemory("now");
+    return;
+  }
 
   switch (signum) {
     case SIGUSR1:
-      handleUserSignal(SIGUSR1, reload);
+      handleUserSignal(SIGUSR1);
       break;
     case SIGUSR2:
-      handleUserSignal(SIGUSR2, reload);
+      handleUserSignal(SIGUSR2);
       break;
     case SIGINT:
       spdlog::info("Quitting.");
@@ -136,16 +163,7 @@ static void handleSignalMainThread(int signum, bool& reload) {
       waybar::Client::inst()->reset();
       break;
     case SIGCHLD:
-      if (!reap.empty()) {
-        reap_mtx.lock();
-        for (auto it = reap.begin(); it != reap.end(); ++it) {
-          if (waitpid(*it, nullptr, WNOHANG) == *it) {
-            spdlog::debug("Reaped child with PID: {}", *it);
-            it = reap.erase(it);
-          }
-        }
-        reap_mtx.unlock();
-      }
+      waybar::util::command::reapExited();
       break;
     default:
       spdlog::debug("Received signal with number {}, but not handling", signum);
@@ -179,6 +197,8 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, SIG_IGN);
 
     delete client;
+    waybar::util::trace::stop();
+    waybar::util::log::flush();
     return ret;
   } catch (const std::exception& e) {
     spdlog::error("{}", e.what());
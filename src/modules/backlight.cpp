@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <memory>
 
 #include "util/backend_common.hpp"
@@ -16,7 +17,9 @@
 waybar::modules::Backlight::Backlight(const std::string &id, const Json::Value &config)
     : ALabel(config, "backlight", id, "{percent}%", 2),
       preferred_device_(config["device"].isString() ? config["device"].asString() : ""),
-      backend(interval_, [this] { dp.emit(); }) {
+      backend(util::BacklightBackend::getInstance(interval_)),
+      subscription_(backend->subscribe([this] { dp.emit(); })),
+      scroll_{event_box_, [this](int steps) { applyScroll(steps); }} {
   dp.emit();
 
   // Set up scroll handler
@@ -24,10 +27,12 @@ waybar::modules::Backlight::Backlight(const std::string &id, const Json::Value &
   event_box_.signal_scroll_event().connect(sigc::mem_fun(*this, &Backlight::handleScroll));
 }
 
+waybar::modules::Backlight::~Backlight() { backend->unsubscribe(subscription_); }
+
 auto waybar::modules::Backlight::update() -> void {
-  GET_BEST_DEVICE(best, backend, preferred_device_);
+  GET_BEST_DEVICE(best, (*backend), preferred_device_);
 
-  const auto previous_best_device = backend.get_previous_best_device();
+  const auto *previous_best_device = previous_best_ ? &*previous_best_ : nullptr;
   if (best != nullptr) {
     if (previous_best_device != nullptr && *previous_best_device == *best &&
         !previous_format_.empty() && previous_format_ == format_) {
@@ -74,7 +79,11 @@ auto waybar::modules::Backlight::update() -> void {
     }
     label_.set_markup("");
   }
-  backend.set_previous_best_device(best);
+  if (best == nullptr) {
+    previous_best_ = std::nullopt;
+  } else {
+    previous_best_ = *best;
+  }
   previous_format_ = format_;
   ALabel::update();
 }
@@ -86,34 +95,20 @@ bool waybar::modules::Backlight::handleScroll(GdkEventScroll *e) {
   }
 
   // Fail fast if the proxy could not be initialized
-  if (!backend.is_login_proxy_initialized()) {
+  if (!backend->is_login_proxy_initialized()) {
     return true;
   }
 
-  // Check scroll direction
   auto dir = AModule::getScrollDir(e);
-
-  // No worries, it will always be set because of the switch below. This is purely to suppress a
-  // warning
-  util::ChangeType ct = util::ChangeType::Increase;
-
-  switch (dir) {
-    case SCROLL_DIR::UP:
-      [[fallthrough]];
-    case SCROLL_DIR::RIGHT:
-      ct = util::ChangeType::Increase;
-      break;
-
-    case SCROLL_DIR::DOWN:
-      [[fallthrough]];
-    case SCROLL_DIR::LEFT:
-      ct = util::ChangeType::Decrease;
-      break;
-
-    case SCROLL_DIR::NONE:
-      return true;
-      break;
+  if (dir == SCROLL_DIR::NONE) {
+    return true;
   }
+  scroll_.add((dir == SCROLL_DIR::UP || dir == SCROLL_DIR::RIGHT) ? 1 : -1);
+  return true;
+}
+
+void waybar::modules::Backlight::applyScroll(int steps) {
+  auto ct = steps > 0 ? util::ChangeType::Increase : util::ChangeType::Decrease;
 
   // Get scroll step
   double step = 1;
@@ -126,11 +121,9 @@ bool waybar::modules::Backlight::handleScroll(GdkEventScroll *e) {
   if (config_["min-brightness"].isDouble()) {
     min_brightness = config_["min-brightness"].asDouble();
   }
-  if (backend.get_scaled_brightness(preferred_device_) <= min_brightness &&
+  if (backend->get_scaled_brightness(preferred_device_) <= min_brightness &&
       ct == util::ChangeType::Decrease) {
-    return true;
+    return;
   }
-  backend.set_brightness(preferred_device_, ct, step);
-
-  return true;
+  backend->set_brightness(preferred_device_, ct, step * std::abs(steps));
 }
@@ -8,16 +8,22 @@ BacklightSlider::BacklightSlider(const std::string& id, const Json::Value& confi
     : ASlider(config, "backlight-slider", id),
       interval_(config_["interval"].isUInt() ? config_["interval"].asUInt() : 1000),
       preferred_device_(config["device"].isString() ? config["device"].asString() : ""),
-      backend(interval_, [this] { this->dp.emit(); }) {}
+      backend(util::BacklightBackend::getInstance(interval_)),
+      subscription_(backend->subscribe([this] { this->dp.emit(); })) {
+  // The backend only calls back on changes
+  dp.emit();
+}
+
+BacklightSlider::~BacklightSlider() { backend->unsubscribe(subscription_); }
 
 void BacklightSlider::update() {
-  uint16_t brightness = backend.get_scaled_brightness(preferred_device_);
-  scale_.set_value(brightness);
+  uint16_t brightness = backend->get_scaled_brightness(preferred_device_);
+  setValue(brightness);
 }
 
 void BacklightSlider::onValueChanged() {
   auto brightness = scale_.get_value();
-  backend.set_scaled_brightness(preferred_device_, brightness);
+  backend->set_scaled_brightness(preferred_device_, brightness);
 }
 
 }  // namespace waybar::modules
\ No newline at end of file
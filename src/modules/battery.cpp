@@ -2,23 +2,115 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <utility>
 
 #include "util/command.hpp"
+#include "util/proc_file.hpp"
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
 #endif
 #include <libudev.h>
 #include <poll.h>
 #include <spdlog/spdlog.h>
-#include <sys/signalfd.h>
 
-waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const Json::Value& config)
-    : ALabel(config, "battery", id, "{capacity}%", 60), last_event_(""), bar_(bar) {
 #if defined(__linux__)
-  battery_watch_fd_ = inotify_init1(IN_CLOEXEC);
-  if (battery_watch_fd_ == -1) {
-    throw std::runtime_error("Unable to listen batteries.");
+namespace {
+
+namespace fs = std::filesystem;
+
+/* The POWER_SUPPLY_* properties of one power supply. Its uevent file lists all of them, so they
+ * come from one read of it; attributes are only read one file at a time when there is no uevent.
+ */
+class SupplyProps {
+ public:
+  SupplyProps(fs::path dir, waybar::util::ProcFile* uevent) : dir_{std::move(dir)} {
+    if (uevent == nullptr) {
+      return;
+    }
+    if (auto data = uevent->tryRead()) {
+      parse(*data);
+    }
+  }
+
+  // From the uevent text of a kernel event, which must outlive this
+  SupplyProps(fs::path dir, std::string_view uevent) : dir_{std::move(dir)} { parse(uevent); }
+
+  // attr is the name of the attribute file, e.g. "current_now"
+  bool get(std::string_view attr, std::string& out) const {
+    if (!has_uevent_) {
+      std::ifstream file(dir_ / attr);
+      return file && std::getline(file, out);
+    }
+    if (const auto* value = find(attr)) {
+      out = *value;
+      return true;
+    }
+    return false;
+  }
+
+  // Same for a number; a property that doesn't parse is left at out and still counts as existing
+  template <typename T>
+  bool get(std::string_view attr, T& out) const {
+    std::string owned;
+    std::string_view value;
+    if (!has_uevent_) {
+      if (!get(attr, owned)) {
+        return false;
+      }
+      value = owned;
+    } else if (const auto* found = find(attr)) {
+      value = *found;
+    } else {
+      return false;
+    }
+    std::from_chars(value.data(), value.data() + value.size(), out);
+    return true;
+  }
+
+ private:
+  void parse(std::string_view data) {
+    has_uevent_ = true;
+    constexpr std::string_view prefix = "POWER_SUPPLY_";
+    while (!data.empty()) {
+      auto line = data.substr(0, data.find('\n'));
+      data.remove_prefix(std::min(line.size() + 1, data.size()));
+      const auto sep = line.find('=');
+      if (line.starts_with(prefix) && sep != std::string_view::npos) {
+        props_.emplace_back(line.substr(prefix.size(), sep - prefix.size()), line.substr(sep + 1));
+      }
+    }
   }
+
+  const std::string_view* find(std::string_view attr) const {
+    for (const auto& [key, value] : props_) {
+      if (key.size() == attr.size() &&
+          std::equal(attr.begin(), attr.end(), key.begin(),
+                     [](char a, char k) { return std::toupper(a) == k; })) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+
+  fs::path dir_;
+  bool has_uevent_ = false;
+  std::vector<std::pair<std::string_view, std::string_view>> props_;  // valid until the next read
+};
+
+}  // namespace
+#endif
+
+waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const Json::Value& config)
+    : ALabel(config, "battery", id, "{capacity}%", 60),
+      last_event_(""),
+      infos_(util::SharedSample<Infos>::get(
+          util::SharedSample<Infos>::sourceOf("battery", config,
+                                              {"bat", "bat-compatibility", "adapter", "full-at",
+                                               "design-capacity", "weighted-average"}),
+          interval_)),
+      bar_(bar) {
+#if defined(__linux__)
   udev_ = std::unique_ptr<udev, util::UdevDeleter>(udev_new());
   if (udev_ == nullptr) {
     throw std::runtime_error("udev_new failed");
@@ -34,62 +126,40 @@ waybar::modules::Battery::Battery(const std::string& id, const Bar& bar, const J
   udev_monitor_enable_receiving(mon_.get());
 
   if (config_["weighted-average"].isBool()) weightedAverage_ = config_["weighted-average"].asBool();
+  if (config_["event-driven"].isBool()) eventDriven_ = config_["event-driven"].asBool();
+  for (const auto& key : config_.getMemberNames()) {
+    if ((key.starts_with("format") || key.starts_with("tooltip-format")) &&
+        config_[key].isString() && config_[key].asString().find("{time") != std::string::npos) {
+      showsTime_ = true;
+    }
+  }
 #endif
   spdlog::debug("battery: worker interval is {}", interval_.count());
   worker();
 }
 
-waybar::modules::Battery::~Battery() {
-#if defined(__linux__)
-  std::lock_guard<std::mutex> guard(battery_list_mutex_);
-
-  for (auto it = batteries_.cbegin(), next_it = it; it != batteries_.cend(); it = next_it) {
-    ++next_it;
-    auto watch_id = (*it).second;
-    if (watch_id >= 0) {
-      inotify_rm_watch(battery_watch_fd_, watch_id);
-    }
-    batteries_.erase(it);
-  }
-  close(battery_watch_fd_);
-#endif
-}
+waybar::modules::Battery::~Battery() = default;
 
 void waybar::modules::Battery::worker() {
 #if defined(__FreeBSD__)
-  thread_timer_ = [this] {
-    dp.emit();
-    thread_timer_.sleep_for(interval_);
-  };
+  timer_.start(interval_, [this] { dp.emit(); });
 #else
-  thread_timer_ = [this] {
-    // Make sure we eventually update the list of batteries even if we miss an
-    // inotify event for some reason
-    refreshBatteries();
-    dp.emit();
-    thread_timer_.sleep_for(interval_);
-  };
-  thread_ = [this] {
-    struct inotify_event event = {0};
-    int nbytes = read(battery_watch_fd_, &event, sizeof(event));
-    if (nbytes != sizeof(event) || event.mask & IN_IGNORED) {
-      thread_.stop();
-      return;
-    }
-    dp.emit();
-  };
+  startPolling(interval_);
+  // the charge that changed during the sleep is shown with the clock
+  thread_battery_update_.setResumeWake(util::ResumeWake::IMMEDIATE);
   thread_battery_update_ = [this] {
     poll_fds_[0].revents = 0;
     poll_fds_[0].events = POLLIN;
     poll_fds_[0].fd = udev_monitor_get_fd(mon_.get());
+    poll_fds_[1] = {.fd = thread_battery_update_.stopFd(), .events = POLLIN, .revents = 0};
     int ret = poll(poll_fds_.data(), poll_fds_.size(), -1);
-    if (ret < 0) {
-      thread_.stop();
+    if (ret < 0 || poll_fds_[1].revents != 0) {
+      thread_battery_update_.stop();
       return;
     }
-    if ((poll_fds_[0].revents & POLLIN) != 0) {
-      signalfd_siginfo signal_info;
-      read(poll_fds_[0].fd, &signal_info, sizeof(signal_info));
+    if ((poll_fds_[0].revents & POLLIN) != 0 && handleEvent()) {
+      dp.emit();
+      return;
     }
     refreshBatteries();
     dp.emit();
@@ -97,6 +167,80 @@ void waybar::modules::Battery::worker() {
 #endif
 }
 
+#if defined(__linux__)
+void waybar::modules::Battery::startPolling(std::chrono::milliseconds period) {
+  pollPeriod_ = period;
+  if (period.count() == 0) {
+    timer_.stop();
+    return;
+  }
+  // already polling on the discharge rate, the battery factor doesn't apply
+  timer_.start(
+      period,
+      [this] {
+        // Make sure we eventually update the list of batteries even if we miss a
+        // udev event for some reason
+        refreshBatteries();
+        dp.emit();
+      },
+      period);
+}
+
+bool waybar::modules::Battery::handleEvent() {
+  std::unique_ptr<udev_device, util::UdevDeviceDeleter> dev(
+      udev_monitor_receive_device(mon_.get()));
+  if (dev == nullptr) {
+    return false;
+  }
+  const char* action = udev_device_get_action(dev.get());
+  const char* name = udev_device_get_sysname(dev.get());
+  if (action == nullptr || name == nullptr || strcmp(action, "change") != 0) {
+    return false;  // added or removed, the list of batteries needs a refresh
+  }
+  auto path = data_dir_ / name;
+  std::lock_guard<std::mutex> guard(battery_list_mutex_);
+  if (!batteries_.contains(path) && path != adapter_) {
+    return false;
+  }
+  // The event carries every property of the supply, the next update uses them as they are
+  std::string uevent;
+  struct udev_list_entry* entry;
+  udev_list_entry_foreach(entry, udev_device_get_properties_list_entry(dev.get())) {
+    uevent.append(udev_list_entry_get_name(entry))
+        .append("=")
+        .append(udev_list_entry_get_value(entry))
+        .append("\n");
+  }
+  eventProps_[path] = std::move(uevent);
+  return true;
+}
+
+void waybar::modules::Battery::adjustPolling(const std::string& status, float time_remaining,
+                                             uint8_t capacity) {
+  // Charging and full supplies report what matters through events, only the slow discharge
+  // drifts silently. Poll about once per percent of charge drained, or once per minute when
+  // the remaining time is shown, as neither changes any faster.
+  std::chrono::milliseconds period{0};
+  if (status == "Discharging") {
+    period = interval_;
+    if (time_remaining > 0 && capacity > 0) {
+      std::chrono::milliseconds per_percent{
+          static_cast<int64_t>(time_remaining * 3600000.0f / capacity)};
+      if (showsTime_) {
+        per_percent = std::min<std::chrono::milliseconds>(per_percent, std::chrono::minutes(1));
+      }
+      period = std::max(period, per_percent);
+      // whole seconds, so that instances on several bars keep polling together
+      period = std::chrono::duration_cast<std::chrono::seconds>(period);
+    }
+  }
+  if (period != pollPeriod_) {
+    spdlog::debug("battery: polling every {} ms", period.count());
+    startPolling(period);
+  }
+}
+#endif
+
 void waybar::modules::Battery::refreshBatteries() {
 #if defined(__linux__)
   std::lock_guard<std::mutex> guard(battery_list_mutex_);
@@ -106,6 +250,7 @@ void waybar::modules::Battery::refreshBatteries() {
     check_map[bat.first] = false;
   }
 
+  fs::path adapter;
   try {
     for (auto& node : fs::directory_iterator(data_dir_)) {
       if (!fs::is_directory(node)) {
@@ -135,25 +280,25 @@ void waybar::modules::Battery::refreshBatteries() {
           check_map[node.path()] = true;
           auto search = batteries_.find(node.path());
           if (search == batteries_.end()) {
-            // We've found a new battery save it and start listening for events
-            auto event_path = (node.path() / "uevent");
-            auto wd = inotify_add_watch(battery_watch_fd_, event_path.c_str(), IN_ACCESS);
-            if (wd < 0) {
-              throw std::runtime_error("Could not watch events for " + node.path().string());
-            }
-            batteries_[node.path()] = wd;
+            // We've found a new battery, keep its uevent open to read it on every update
+            batteries_[node.path()] =
+                std::make_unique<util::ProcFile>((node.path() / "uevent").string());
           }
         }
       }
       auto adap_defined = config_["adapter"].isString();
       if (((adap_defined && dir_name == config_["adapter"].asString()) || !adap_defined) &&
           (fs::exists(node.path() / "online") || fs::exists(node.path() / "status"))) {
-        adapter_ = node.path();
+        adapter = node.path();
       }
     }
   } catch (fs::filesystem_error& e) {
     throw std::runtime_error(e.what());
   }
+  if (!adapter.empty() && adapter != adapter_) {
+    adapter_ = adapter;
+    adapter_uevent_ = std::make_unique<util::ProcFile>((adapter_ / "uevent").string());
+  }
   if (warnFirstTime_ && batteries_.empty()) {
     if (config_["bat"].isString()) {
       spdlog::warn("No battery named {0}", config_["bat"].asString());
@@ -164,13 +309,9 @@ void waybar::modules::Battery::refreshBatteries() {
     warnFirstTime_ = false;
   }
 
-  // Remove any batteries that are no longer present and unwatch them
+  // Remove any batteries that are no longer present
   for (auto const& check : check_map) {
     if (!check.second) {
-      auto watch_id = batteries_[check.first];
-      if (watch_id >= 0) {
-        inotify_rm_watch(battery_watch_fd_, watch_id);
-      }
       batteries_.erase(check.first);
     }
   }
@@ -192,8 +333,7 @@ static bool status_gt(const std::string& a, const std::string& b) {
   return false;
 }
 
-std::tuple<uint8_t, float, std::string, float, uint16_t, float>
-waybar::modules::Battery::getInfos() {
+waybar::modules::Battery::Infos waybar::modules::Battery::getInfos() {
   std::lock_guard<std::mutex> guard(battery_list_mutex_);
 
   try {
@@ -268,16 +408,21 @@ waybar::modules::Battery::getInfos() {
     uint16_t mainBatCycleCount = 0;
     float mainBatHealthPercent = 0.0F;
 
+    // Supplies that sent a change event since the last update are read from the event
+    const auto events = std::exchange(eventProps_, {});
+    const auto props = [&events](const fs::path& dir, util::ProcFile* uevent) {
+      auto event = events.find(dir);
+      return event != events.end() ? SupplyProps(dir, event->second) : SupplyProps(dir, uevent);
+    };
+    const auto adapter = props(adapter_, adapter_uevent_.get());
     std::string status = "Unknown";
     for (auto const& item : batteries_) {
-      auto bat = item.first;
+      const auto bat = props(item.first, item.second.get());
       std::string _status;
 
       /* Check for adapter status if battery is not available */
-      if (!std::ifstream(bat / "status")) {
-        std::getline(std::ifstream(adapter_ / "status"), _status);
-      } else {
-        std::getline(std::ifstream(bat / "status"), _status);
+      if (!bat.get("status", _status) && !adapter_.empty()) {
+        adapter.get("status", _status);
       }
 
       // Some battery will report current and charge in μA/μAh.
@@ -286,64 +431,54 @@ waybar::modules::Battery::getInfos() {
       uint32_t current_now = 0;
       int32_t _current_now_int = 0;
       bool current_now_exists = false;
-      if (fs::exists(bat / "current_now")) {
+      if (bat.get("current_now", _current_now_int)) {
         current_now_exists = true;
-        std::ifstream(bat / "current_now") >> _current_now_int;
-      } else if (fs::exists(bat / "current_avg")) {
+      } else if (bat.get("current_avg", _current_now_int)) {
         current_now_exists = true;
-        std::ifstream(bat / "current_avg") >> _current_now_int;
       }
       // Documentation ABI allows a negative value when discharging, positive
       // value when charging.
       current_now = std::abs(_current_now_int);
 
-      if (fs::exists(bat / "time_to_empty_now")) {
+      if (bat.get("time_to_empty_now", time_to_empty_now)) {
         time_to_empty_now_exists = true;
-        std::ifstream(bat / "time_to_empty_now") >> time_to_empty_now;
       }
 
-      if (fs::exists(bat / "time_to_full_now")) {
+      if (bat.get("time_to_full_now", time_to_full_now)) {
         time_to_full_now_exists = true;
-        std::ifstream(bat / "time_to_full_now") >> time_to_full_now;
       }
 
       uint32_t voltage_now = 0;
       bool voltage_now_exists = false;
-      if (fs::exists(bat / "voltage_now")) {
+      if (bat.get("voltage_now", voltage_now)) {
         voltage_now_exists = true;
-        std::ifstream(bat / "voltage_now") >> voltage_now;
-      } else if (fs::exists(bat / "voltage_avg")) {
+      } else if (bat.get("voltage_avg", voltage_now)) {
         voltage_now_exists = true;
-        std::ifstream(bat / "voltage_avg") >> voltage_now;
       }
 
       uint32_t charge_full = 0;
       bool charge_full_exists = false;
-      if (fs::exists(bat / "charge_full")) {
+      if (bat.get("charge_full", charge_full)) {
         charge_full_exists = true;
-        std::ifstream(bat / "charge_full") >> charge_full;
       }
 
       uint32_t charge_full_design = 0;
       bool charge_full_design_exists = false;
-      if (fs::exists(bat / "charge_full_design")) {
+      if (bat.get("charge_full_design", charge_full_design)) {
         charge_full_design_exists = true;
-        std::ifstream(bat / "charge_full_design") >> charge_full_design;
       }
 
       uint32_t charge_now = 0;
       bool charge_now_exists = false;
-      if (fs::exists(bat / "charge_now")) {
+      if (bat.get("charge_now", charge_now)) {
         charge_now_exists = true;
-        std::ifstream(bat / "charge_now") >> charge_now;
       }
 
       uint32_t power_now = 0;
       int32_t _power_now_int = 0;
       bool power_now_exists = false;
-      if (fs::exists(bat / "power_now")) {
+      if (bat.get("power_now", _power_now_int)) {
         power_now_exists = true;
-        std::ifstream(bat / "power_now") >> _power_now_int;
       }
       // Some drivers (example: Qualcomm) exposes use a negative value when
       // discharging, positive value when charging.
@@ -351,29 +486,24 @@ waybar::modules::Battery::getInfos() {
 
       uint32_t energy_now = 0;
       bool energy_now_exists = false;
-      if (fs::exists(bat / "energy_now")) {
+      if (bat.get("energy_now", energy_now)) {
         energy_now_exists = true;
-        std::ifstream(bat / "energy_now") >> energy_now;
       }
 
       uint32_t energy_full = 0;
       bool energy_full_exists = false;
-      if (fs::exists(bat / "energy_full")) {
+      if (bat.get("energy_full", energy_full)) {
         energy_full_exists = true;
-        std::ifstream(bat / "energy_full") >> energy_full;
       }
 
       uint32_t energy_full_design = 0;
       bool energy_full_design_exists = false;
-      if (fs::exists(bat / "energy_full_design")) {
+      if (bat.get("energy_full_design", energy_full_design)) {
         energy_full_design_exists = true;
-        std::ifstream(bat / "energy_full_design") >> energy_full_design;
       }
 
       uint16_t cycleCount = 0;
-      if (fs::exists(bat / "cycle_count")) {
-        std::ifstream(bat / "cycle_count") >> cycleCount;
-      }
+      bat.get("cycle_count", cycleCount);
       if (charge_full_design >= largestDesignCapacity) {
         largestDesignCapacity = charge_full_design;
 
@@ -402,9 +532,8 @@ waybar::modules::Battery::getInfos() {
       } else if (energy_now_exists && energy_full_exists && energy_full != 0) {
         capacity_exists = true;
         capacity = 100 * (uint64_t)energy_now / (uint64_t)energy_full;
-      } else if (fs::exists(bat / "capacity")) {
+      } else if (bat.get("capacity", capacity)) {
         capacity_exists = true;
-        std::ifstream(bat / "capacity") >> capacity;
       }
 
       if (!voltage_now_exists) {
@@ -555,10 +684,10 @@ waybar::modules::Battery::getInfos() {
     // Give `Plugged` higher priority over `Not charging`.
     // So in a setting where TLP is used, `Plugged` is shown when the threshold is reached
     if (!adapter_.empty() && (status == "Discharging" || status == "Not charging")) {
-      bool online;
+      int online = 0;
       std::string current_status;
-      std::ifstream(adapter_ / "online") >> online;
-      std::getline(std::ifstream(adapter_ / "status"), current_status);
+      adapter.get("online", online);
+      adapter.get("status", current_status);
       if (online && current_status != "Discharging") status = "Plugged";
     }
 
@@ -641,10 +770,12 @@ const std::string waybar::modules::Battery::getAdapterStatus(uint8_t capacity) c
   {
 #else
   if (!adapter_.empty()) {
-    bool online;
+    util::ProcFile uevent{(adapter_ / "uevent").string()};
+    const SupplyProps adapter(adapter_, &uevent);
+    int online = 0;
     std::string status;
-    std::ifstream(adapter_ / "online") >> online;
-    std::getline(std::ifstream(adapter_ / "status"), status);
+    adapter.get("online", online);
+    adapter.get("status", status);
 #endif
     if (capacity == 100) {
       return "Full";
@@ -674,6 +805,11 @@ const std::string waybar::modules::Battery::formatTimeRemaining(float hoursRemai
                      fmt::arg("m", zero_pad_minutes));
 }
 
+auto waybar::modules::Battery::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
+}
+
 auto waybar::modules::Battery::update() -> void {
 #if defined(__linux__)
   if (batteries_.empty()) {
@@ -681,10 +817,16 @@ auto waybar::modules::Battery::update() -> void {
     return;
   }
 #endif
-  auto [capacity, time_remaining, status, power, cycles, health] = getInfos();
+  auto [capacity, time_remaining, status, power, cycles, health] =
+      *infos_->sample([this](const Infos*) { return getInfos(); });
   if (status == "Unknown") {
     status = getAdapterStatus(capacity);
   }
+#if defined(__linux__)
+  if (eventDriven_) {
+    adjustPolling(status, time_remaining, capacity);
+  }
+#endif
   auto status_pretty = status;
   puts(status.c_str());
   // Transform to lowercase  and replace space with dash
@@ -695,6 +837,14 @@ auto waybar::modules::Battery::update() -> void {
   processEvents(state, status, capacity);
   setBarClass(state);
   auto time_remaining_formatted = formatTimeRemaining(time_remaining);
+  if (publishesState()) {
+    state_fields_["capacity"] = capacity;
+    state_fields_["status"] = status_pretty;
+    state_fields_["power"] = power;
+    state_fields_["time-remaining"] = time_remaining;  // hours, negative until full
+    state_fields_["cycles"] = cycles;
+    state_fields_["health"] = health;
+  }
   if (tooltipEnabled()) {
     std::string tooltip_text_default;
     std::string tooltip_format = "{timeTo}";
@@ -722,11 +872,7 @@ auto waybar::modules::Battery::update() -> void {
                     fmt::arg("time", time_remaining_formatted), fmt::arg("cycles", cycles),
                     fmt::arg("health", fmt::format("{:.3}", health))));
   }
-  if (!old_status_.empty()) {
-    label_.get_style_context()->remove_class(old_status_);
-  }
-  label_.get_style_context()->add_class(status);
-  old_status_ = status;
+  status_class_.set(status);
   if (!state.empty() && config_["format-" + status + "-" + state].isString()) {
     format = config_["format-" + status + "-" + state].asString();
   } else if (config_["format-" + status].isString()) {
@@ -741,8 +887,9 @@ auto waybar::modules::Battery::update() -> void {
     auto icons = std::vector<std::string>{status + "-" + state, status, state};
     label_.set_markup(fmt::format(
         fmt::runtime(format), fmt::arg("capacity", capacity), fmt::arg("power", power),
-        fmt::arg("icon", getIcon(capacity, icons)), fmt::arg("time", time_remaining_formatted),
-        fmt::arg("cycles", cycles), fmt::arg("health", fmt::format("{:.3}", health))));
+        fmt::arg("icon", formatUses(format, "icon") ? getIcon(capacity, icons) : ""),
+        fmt::arg("time", time_remaining_formatted), fmt::arg("cycles", cycles),
+        fmt::arg("health", formatUses(format, "health") ? fmt::format("{:.3}", health) : "")));
   }
   // Call parent update
   ALabel::update();
@@ -4,39 +4,11 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 
-#include "util/scope_guard.hpp"
-
 namespace {
 
-using GDBusManager = std::unique_ptr<GDBusObjectManager, void (*)(GDBusObjectManager*)>;
-
-auto generateManager() -> GDBusManager {
-  GError* error = nullptr;
-  waybar::util::ScopeGuard error_deleter([error]() {
-    if (error) {
-      g_error_free(error);
-    }
-  });
-  GDBusObjectManager* manager = g_dbus_object_manager_client_new_for_bus_sync(
-      G_BUS_TYPE_SYSTEM,
-      GDBusObjectManagerClientFlags::G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_DO_NOT_AUTO_START,
-      "org.bluez", "/", NULL, NULL, NULL, NULL, &error);
-
-  if (error) {
-    spdlog::error("g_dbus_object_manager_client_new_for_bus_sync() failed: {}", error->message);
-  }
-
-  auto destructor = [](GDBusObjectManager* manager) {
-    if (manager) {
-      g_object_unref(manager);
-    }
-  };
-
-  return GDBusManager{manager, destructor};
-}
-
 auto getBoolProperty(GDBusProxy* proxy, const char* property_name) -> bool {
   auto gvar = g_dbus_proxy_get_cached_property(proxy, property_name);
   if (gvar) {
@@ -83,14 +55,33 @@ auto getUcharProperty(GDBusProxy* proxy, const char* property_name) -> unsigned
   return 0;
 }
 
+// Stores value in field, whether that changed it
+template <typename T>
+auto updateField(T& field, T value) -> bool {
+  if (field == value) return false;
+  field = std::move(value);
+  return true;
+}
+
+auto updateBool(bool& field, GVariant* value) -> bool {
+  return g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN) &&
+         updateField(field, static_cast<bool>(g_variant_get_boolean(value)));
+}
+
+auto updateString(std::string& field, GVariant* value) -> bool {
+  return g_variant_is_of_type(value, G_VARIANT_TYPE_STRING) &&
+         updateField(field, std::string{g_variant_get_string(value, NULL)});
+}
+
 }  // namespace
 
 waybar::modules::Bluetooth::Bluetooth(const std::string& id, const Json::Value& config)
-    : ALabel(config, "bluetooth", id, " {status}", 10),
+    : ALabel(config, "bluetooth", id, " {status}", 10),
 #ifdef WANT_RFKILL
       rfkill_{RFKILL_TYPE_BLUETOOTH},
 #endif
-      manager_(generateManager()) {
+      manager_(nullptr, g_object_unref),
+      cancellable_(g_cancellable_new(), g_object_unref) {
 
   if (config_["format-device-preference"].isArray()) {
     std::transform(config_["format-device-preference"].begin(),
@@ -98,32 +89,66 @@ waybar::modules::Bluetooth::Bluetooth(const std::string& id, const Json::Value&
                    std::back_inserter(device_preference_), [](auto x) { return x.asString(); });
   }
 
-  if (cur_controller_ = findCurController(); !cur_controller_) {
-    if (config_["controller-alias"].isString()) {
+  // Shown as loading until bluez answered, the bar doesn't wait for its activation
+  g_dbus_object_manager_client_new_for_bus(
+      G_BUS_TYPE_SYSTEM,
+      GDBusObjectManagerClientFlags::G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_DO_NOT_AUTO_START,
+      "org.bluez", "/", NULL, NULL, NULL, cancellable_.get(), onManagerReady, this);
+
+#ifdef WANT_RFKILL
+  rfkill_.on_update.connect(sigc::hide(sigc::mem_fun(*this, &Bluetooth::update)));
+#endif
+
+  dp.emit();
+}
+
+waybar::modules::Bluetooth::~Bluetooth() {
+  g_cancellable_cancel(cancellable_.get());
+  if (manager_) {
+    g_signal_handlers_disconnect_by_data(manager_.get(), this);
+  }
+}
+
+auto waybar::modules::Bluetooth::onManagerReady(GObject* /*source*/, GAsyncResult* result,
+                                                gpointer user_data) -> void {
+  GError* error = nullptr;
+  GDBusObjectManager* manager = g_dbus_object_manager_client_new_for_bus_finish(result, &error);
+  if (error) {
+    // Cancelled when the module is gone already
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      spdlog::error("g_dbus_object_manager_client_new_for_bus() failed: {}", error->message);
+      auto* self = static_cast<Bluetooth*>(user_data);
+      self->loading_ = false;
+      self->dp.emit();
+    }
+    g_error_free(error);
+    return;
+  }
+
+  auto* self = static_cast<Bluetooth*>(user_data);
+  self->manager_.reset(manager);
+  self->loading_ = false;
+
+  if (self->cur_controller_ = self->findCurController(); !self->cur_controller_) {
+    if (self->config_["controller-alias"].isString()) {
       spdlog::warn("no bluetooth controller found with alias '{}'",
-                   config_["controller-alias"].asString());
+                   self->config_["controller-alias"].asString());
     } else {
       spdlog::warn("no bluetooth controller found");
     }
-    update();
   } else {
     // This call only make sense if a controller could be found
-    findConnectedDevices(cur_controller_->path, connected_devices_);
+    self->findConnectedDevices(self->cur_controller_->path, self->connected_devices_);
   }
 
-  g_signal_connect(manager_.get(), "object-added", G_CALLBACK(onObjectAdded), this);
-  g_signal_connect(manager_.get(), "object-removed", G_CALLBACK(onObjectRemoved), this);
-  g_signal_connect(manager_.get(), "interface-proxy-properties-changed",
-                   G_CALLBACK(onInterfaceProxyPropertiesChanged), this);
-  g_signal_connect(manager_.get(), "interface-added", G_CALLBACK(onInterfaceAddedOrRemoved), this);
-  g_signal_connect(manager_.get(), "interface-removed", G_CALLBACK(onInterfaceAddedOrRemoved),
-                   this);
-
-#ifdef WANT_RFKILL
-  rfkill_.on_update.connect(sigc::hide(sigc::mem_fun(*this, &Bluetooth::update)));
-#endif
+  g_signal_connect(manager, "object-added", G_CALLBACK(onObjectAdded), self);
+  g_signal_connect(manager, "object-removed", G_CALLBACK(onObjectRemoved), self);
+  g_signal_connect(manager, "interface-proxy-properties-changed",
+                   G_CALLBACK(onInterfaceProxyPropertiesChanged), self);
+  g_signal_connect(manager, "interface-added", G_CALLBACK(onInterfaceAddedOrRemoved), self);
+  g_signal_connect(manager, "interface-removed", G_CALLBACK(onInterfaceAddedOrRemoved), self);
 
-  dp.emit();
+  self->dp.emit();
 }
 
 auto waybar::modules::Bluetooth::update() -> void {
@@ -135,9 +160,9 @@ auto waybar::modules::Bluetooth::update() -> void {
     bool preferred_device_connected = false;
     if (!device_preference_.empty()) {
       for (const std::string& device_alias : device_preference_) {
-        auto it =
-            std::find_if(connected_devices_.begin(), connected_devices_.end(),
-                         [device_alias](auto device) { return device_alias == device.alias; });
+        auto it = std::find_if(
+            connected_devices_.begin(), connected_devices_.end(),
+            [&device_alias](const auto& device) { return device_alias == device.alias; });
         if (it != connected_devices_.end()) {
           preferred_device_connected = true;
           cur_focussed_device_ = *it;
@@ -152,7 +177,9 @@ auto waybar::modules::Bluetooth::update() -> void {
 
   std::string state;
   std::string tooltip_format;
-  if (cur_controller_) {
+  if (loading_) {
+    state = "loading";
+  } else if (cur_controller_) {
     if (!cur_controller_->powered)
       state = "off";
     else if (!connected_devices_.empty())
@@ -239,7 +266,7 @@ auto waybar::modules::Bluetooth::update() -> void {
         config_["tooltip-format-enumerate-connected-battery"].isString();
     if (tooltip_enumerate_connections_ || tooltip_enumerate_connections_battery_) {
       std::stringstream ss;
-      for (DeviceInfo dev : connected_devices_) {
+      for (const DeviceInfo& dev : connected_devices_) {
         if ((tooltip_enumerate_connections_battery_ && dev.battery_percentage.has_value()) ||
             tooltip_enumerate_connections_) {
           ss << "\n";
@@ -333,10 +360,9 @@ auto waybar::modules::Bluetooth::onInterfaceAddedOrRemoved(GDBusObjectManager* m
   if (interface_name == "org.bluez.Battery1") {
     Bluetooth* bt = static_cast<Bluetooth*>(user_data);
     if (bt->cur_controller_.has_value()) {
-      auto device = std::find_if(bt->connected_devices_.begin(), bt->connected_devices_.end(),
-                                 [object_path](auto d) { return d.path == object_path; });
-      if (device != bt->connected_devices_.end()) {
-        device->battery_percentage = bt->getDeviceBatteryPercentage(object);
+      auto device = bt->connectedDevice(object_path);
+      if (device != bt->connected_devices_.end() &&
+          updateField(device->battery_percentage, bt->getDeviceBatteryPercentage(object))) {
         bt->dp.emit();
       }
     }
@@ -356,30 +382,118 @@ auto waybar::modules::Bluetooth::onInterfaceProxyPropertiesChanged(
     return;
   }
 
+  // Something was dropped from the cache: read the interface again
+  const bool invalidated = invalidated_properties != NULL && *invalidated_properties != NULL;
+  bool changed = false;
+
   if (interface_name == "org.bluez.Adapter1") {
-    if (object_path == bt->cur_controller_->path) {
+    if (object_path != bt->cur_controller_->path) {
+      return;
+    }
+    if (invalidated) {
       bt->getControllerProperties(G_DBUS_OBJECT(object_proxy), *bt->cur_controller_);
-      bt->dp.emit();
+      changed = true;
+    } else {
+      GVariantIter iter;
+      const gchar* key;
+      GVariant* value;
+      g_variant_iter_init(&iter, changed_properties);
+      while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        changed |= applyControllerProperty(*bt->cur_controller_, key, value);
+        g_variant_unref(value);
+      }
     }
-  } else if (interface_name == "org.bluez.Device1" || interface_name == "org.bluez.Battery1") {
-    DeviceInfo device;
-    bt->getDeviceProperties(G_DBUS_OBJECT(object_proxy), device);
-    auto cur_device = std::find_if(bt->connected_devices_.begin(), bt->connected_devices_.end(),
-                                   [device](auto d) { return d.path == device.path; });
+  } else if (interface_name == "org.bluez.Device1") {
+    auto cur_device = bt->connectedDevice(object_path);
     if (cur_device == bt->connected_devices_.end()) {
-      if (device.connected) {
-        bt->connected_devices_.push_back(device);
-        bt->dp.emit();
+      // Only a device connecting to the current controller matters
+      gboolean connected = FALSE;
+      g_variant_lookup(changed_properties, "Connected", "b", &connected);
+      if (!connected && !invalidated) {
+        return;
+      }
+      DeviceInfo device;
+      if (bt->getDeviceProperties(G_DBUS_OBJECT(object_proxy), device) && device.connected &&
+          device.paired_controller == bt->cur_controller_->path) {
+        bt->connected_devices_.push_back(std::move(device));
+        changed = true;
       }
     } else {
-      if (!device.connected) {
-        bt->connected_devices_.erase(cur_device);
+      if (invalidated) {
+        bt->getDeviceProperties(G_DBUS_OBJECT(object_proxy), *cur_device);
+        changed = true;
       } else {
-        *cur_device = device;
+        GVariantIter iter;
+        const gchar* key;
+        GVariant* value;
+        g_variant_iter_init(&iter, changed_properties);
+        while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+          changed |= applyDeviceProperty(*cur_device, key, value);
+          g_variant_unref(value);
+        }
       }
-      bt->dp.emit();
+      if (!cur_device->connected) {
+        bt->connected_devices_.erase(cur_device);
+        changed = true;
+      }
+    }
+  } else if (interface_name == "org.bluez.Battery1") {
+    auto cur_device = bt->connectedDevice(object_path);
+    if (cur_device == bt->connected_devices_.end()) {
+      return;
     }
+    changed = updateField(cur_device->battery_percentage,
+                          bt->getDeviceBatteryPercentage(G_DBUS_OBJECT(object_proxy)));
   }
+
+  if (changed) {
+    bt->dp.emit();
+  }
+}
+
+auto waybar::modules::Bluetooth::applyDeviceProperty(DeviceInfo& device, const gchar* key,
+                                                     GVariant* value) -> bool {
+  if (strcmp(key, "Connected") == 0) return updateBool(device.connected, value);
+  if (strcmp(key, "Alias") == 0) return updateString(device.alias, value);
+  if (strcmp(key, "Address") == 0) return updateString(device.address, value);
+  if (strcmp(key, "AddressType") == 0) return updateString(device.address_type, value);
+  if (strcmp(key, "Adapter") == 0) {
+    // An object path, not a string
+    return g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH) &&
+           updateField(device.paired_controller, std::string{g_variant_get_string(value, NULL)});
+  }
+  // Kept up to date, but not shown
+  if (strcmp(key, "Paired") == 0) {
+    updateBool(device.paired, value);
+  } else if (strcmp(key, "Trusted") == 0) {
+    updateBool(device.trusted, value);
+  } else if (strcmp(key, "Blocked") == 0) {
+    updateBool(device.blocked, value);
+  } else if (strcmp(key, "ServicesResolved") == 0) {
+    updateBool(device.services_resolved, value);
+  } else if (strcmp(key, "Icon") == 0 && g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+    device.icon = g_variant_get_string(value, NULL);
+  }
+  return false;
+}
+
+auto waybar::modules::Bluetooth::applyControllerProperty(ControllerInfo& controller,
+                                                         const gchar* key, GVariant* value)
+    -> bool {
+  if (strcmp(key, "Powered") == 0) return updateBool(controller.powered, value);
+  if (strcmp(key, "Discoverable") == 0) return updateBool(controller.discoverable, value);
+  if (strcmp(key, "Pairable") == 0) return updateBool(controller.pairable, value);
+  if (strcmp(key, "Discovering") == 0) return updateBool(controller.discovering, value);
+  if (strcmp(key, "Alias") == 0) return updateString(controller.alias, value);
+  if (strcmp(key, "Address") == 0) return updateString(controller.address, value);
+  if (strcmp(key, "AddressType") == 0) return updateString(controller.address_type, value);
+  return false;
+}
+
+auto waybar::modules::Bluetooth::connectedDevice(const std::string& path)
+    -> std::vector<DeviceInfo>::iterator {
+  return std::find_if(connected_devices_.begin(), connected_devices_.end(),
+                      [&path](const auto& device) { return device.path == path; });
 }
 
 auto waybar::modules::Bluetooth::getDeviceBatteryPercentage(GDBusObject* object)
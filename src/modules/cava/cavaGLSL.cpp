@@ -1,12 +1,47 @@
 #include "modules/cava/cavaGLSL.hpp"
 
+#include <glibmm/main.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+/* Shader sources by file name, shared by every module and kept across reloads: each bar realizes
+ * its own GL context, but the files only need to be read again once they change.
+ */
+const std::string& shaderSource(const std::string& fileName) {
+  struct Source {
+    std::filesystem::file_time_type mtime;
+    std::string text;
+  };
+  static std::unordered_map<std::string, Source> sources;
+
+  std::error_code ec;
+  const auto mtime = std::filesystem::last_write_time(fileName, ec);
+  auto& source = sources[fileName];
+  if (ec || source.text.empty() || source.mtime != mtime) {
+    std::ifstream shaderFile{fileName};
+    if (!shaderFile.is_open()) {
+      spdlog::error("cavaGLSL. Could not open shader file: {0}", fileName);
+    }
+    std::ostringstream buffer;
+    buffer << shaderFile.rdbuf();  // read file content into stringstream
+    source = {mtime, buffer.str()};
+  }
+  return source.text;
+}
+
+}  // namespace
 
 waybar::modules::cava::CavaGLSL::CavaGLSL(const std::string& id, const Json::Value& config)
     : AModule(config, "cavaGLSL", id, false, false),
-      backend_{waybar::modules::cava::CavaBackend::inst(config)} {
+      backend_{waybar::modules::cava::CavaBackend::inst(config)},
+      frames_{backend_->subscribe()} {
   set_name(name_);
   if (config_["hide_on_silence"].isBool()) hide_on_silence_ = config_["hide_on_silence"].asBool();
   if (!id.empty()) {
@@ -33,53 +68,75 @@ waybar::modules::cava::CavaGLSL::CavaGLSL(const std::string& id, const Json::Val
 
   set_size_request(length, prm_.sdl_height);
 
-  // Subscribe for changes
-  backend_->signal_audio_raw_update().connect(sigc::mem_fun(*this, &CavaGLSL::onUpdate));
-  // Subscribe for silence
-  backend_->signal_silence().connect(sigc::mem_fun(*this, &CavaGLSL::onSilence));
+  // Pick up the latest frame once per display refresh, on the event box as the area may hide
+  event_box_.add_tick_callback(sigc::mem_fun(*this, &CavaGLSL::onTick));
   event_box_.add(*this);
 }
 
-auto waybar::modules::cava::CavaGLSL::onUpdate(const ::cava::audio_raw& input) -> void {
-  Glib::signal_idle().connect_once([this, input]() {
-    m_data_ = std::make_shared<::cava::audio_raw>(input);
-    if (silence_) {
-      get_style_context()->remove_class("silent");
-      if (!get_style_context()->has_class("updated")) get_style_context()->add_class("updated");
-      show();
-      silence_ = false;
-    }
+auto waybar::modules::cava::CavaGLSL::onTick(const Glib::RefPtr<Gdk::FrameClock>&) -> bool {
+  if (frames_->update() && onFrame()) {
+    // The backend publishes nothing until it hears something again: no tick meanwhile
+    idle_check_ = Glib::signal_timeout().connect(sigc::mem_fun(*this, &CavaGLSL::onIdleCheck),
+                                                 CavaBackend::IDLE_CHECK_INTERVAL.count());
+    return false;
+  }
+  return true;
+}
 
-    queue_render();
-  });
+auto waybar::modules::cava::CavaGLSL::onIdleCheck() -> bool {
+  if (!frames_->update() || onFrame()) {
+    return true;
+  }
+  event_box_.add_tick_callback(sigc::mem_fun(*this, &CavaGLSL::onTick));
+  return false;
+}
+
+auto waybar::modules::cava::CavaGLSL::onFrame() -> bool {
+  const bool silence = frames_->front().silence;
+  if (silence)
+    onSilence();
+  else
+    onUpdate();
+  return silence;
+}
+
+auto waybar::modules::cava::CavaGLSL::onUpdate() -> void {
+  if (silence_) {
+    get_style_context()->remove_class("silent");
+    if (!get_style_context()->has_class("updated")) get_style_context()->add_class("updated");
+    show();
+    silence_ = false;
+  }
+
+  queue_render();
 }
 
 auto waybar::modules::cava::CavaGLSL::onSilence() -> void {
-  Glib::signal_idle().connect_once([this]() {
-    if (!silence_) {
-      if (get_style_context()->has_class("updated")) get_style_context()->remove_class("updated");
-
-      if (hide_on_silence_) hide();
-      silence_ = true;
-      get_style_context()->add_class("silent");
-      // Set clear color to black
-      glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-      queue_render();
-    }
-  });
+  if (!silence_) {
+    if (get_style_context()->has_class("updated")) get_style_context()->remove_class("updated");
+
+    if (hide_on_silence_) hide();
+    silence_ = true;
+    get_style_context()->add_class("silent");
+    // Set clear color to black
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    queue_render();
+  }
 }
 
 bool waybar::modules::cava::CavaGLSL::onRender(const Glib::RefPtr<Gdk::GLContext>& context) {
-  if (!m_data_) return true;
+  // front() stays put between ticks, which run on this thread
+  const auto& frame = frames_->front();
+  if (frame.bars.empty()) return true;
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, texture_);
-  glUniform1i(glGetUniformLocation(shaderProgram_, "inputTexture"), 0);
 
-  glUniform1fv(uniform_bars_, m_data_->number_of_bars, m_data_->bars_raw);
-  glUniform1fv(uniform_previous_bars_, m_data_->number_of_bars, m_data_->previous_bars_raw);
-  glUniform1i(uniform_bars_count_, m_data_->number_of_bars);
+  const auto bars_count = static_cast<GLsizei>(frame.bars.size());
+  glUniform1fv(uniform_bars_, bars_count, frame.bars.data());
+  glUniform1fv(uniform_previous_bars_, bars_count, frame.previous_bars.data());
+  glUniform1i(uniform_bars_count_, bars_count);
   ++frame_counter;
   glUniform1f(uniform_time_, (frame_counter / backend_->getFrameTimeMilsec().count()) / 1e3);
 
@@ -166,6 +223,8 @@ void waybar::modules::cava::CavaGLSL::initGLSL() {
   uniform_previous_bars_ = glGetUniformLocation(shaderProgram_, "previous_bars");
   uniform_bars_count_ = glGetUniformLocation(shaderProgram_, "bars_count");
   uniform_time_ = glGetUniformLocation(shaderProgram_, "shader_time");
+  // The previous frame is always read from unit 0
+  glUniform1i(glGetUniformLocation(shaderProgram_, "inputTexture"), 0);
 
   GLuint err{glGetError()};
   if (err != 0) {
@@ -224,9 +283,9 @@ void waybar::modules::cava::CavaGLSL::initShaders() {
   glGetProgramiv(shaderProgram_, GL_LINK_STATUS, &success);
   if (!success) {
     glGetProgramiv(shaderProgram_, GL_INFO_LOG_LENGTH, &len);
-    GLchar* infoLog{(char*)'\0'};
-    glGetProgramInfoLog(shaderProgram_, len, &len, infoLog);
-    spdlog::error("{0}. Shader linking error: {1}", name_, infoLog);
+    std::string infoLog(std::max(len, 1), '\0');
+    glGetProgramInfoLog(shaderProgram_, len, &len, infoLog.data());
+    spdlog::error("{0}. Shader linking error: {1}", name_, infoLog.c_str());
   }
 
   glReleaseShaderCompiler();
@@ -236,22 +295,11 @@ void waybar::modules::cava::CavaGLSL::initShaders() {
 GLuint waybar::modules::cava::CavaGLSL::loadShader(const std::string& fileName, GLenum type) {
   spdlog::debug("{0}. loadShader: {1}", name_, fileName);
 
-  // Read shader source code from the file
-  std::ifstream shaderFile{fileName};
-
-  if (!shaderFile.is_open()) {
-    spdlog::error("{0}. Could not open shader file: {1}", name_, fileName);
-  }
-
-  std::ostringstream buffer;
-  buffer << shaderFile.rdbuf();  // read file content into stringstream
-  std::string str{buffer.str()};
-  const char* shaderSource = str.c_str();
-  shaderFile.close();
+  const char* source = shaderSource(fileName).c_str();
 
   GLuint shaderID{glCreateShader(type)};
   if (shaderID == 0) spdlog::error("{0}. Error creating shader type: {0}", type);
-  glShaderSource(shaderID, 1, &shaderSource, nullptr);
+  glShaderSource(shaderID, 1, &source, nullptr);
   glCompileShader(shaderID);
 
   // Check for compilation errors
@@ -262,9 +310,9 @@ GLuint waybar::modules::cava::CavaGLSL::loadShader(const std::string& fileName,
   if (!success) {
     glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &len);
 
-    GLchar* infoLog{(char*)'\0'};
-    glGetShaderInfoLog(shaderID, len, nullptr, infoLog);
-    spdlog::error("{0}. Shader compilation error in {1}: {2}", name_, fileName, infoLog);
+    std::string infoLog(std::max(len, 1), '\0');
+    glGetShaderInfoLog(shaderID, len, nullptr, infoLog.data());
+    spdlog::error("{0}. Shader compilation error in {1}: {2}", name_, fileName, infoLog.c_str());
   }
 
   return shaderID;
@@ -1,16 +1,22 @@
 #include "modules/cava/cavaRaw.hpp"
 
+#include <glibmm/main.h>
 #include <spdlog/spdlog.h>
 
 waybar::modules::cava::Cava::Cava(const std::string& id, const Json::Value& config)
     : ALabel(config, "cava", id, "{}", 60, false, false, false),
-      backend_{waybar::modules::cava::CavaBackend::inst(config)} {
+      backend_{waybar::modules::cava::CavaBackend::inst(config)},
+      frames_{backend_->subscribe()} {
   if (config_["hide_on_silence"].isBool()) hide_on_silence_ = config_["hide_on_silence"].asBool();
   if (config_["format_silent"].isString()) format_silent_ = config_["format_silent"].asString();
 
   ascii_range_ = backend_->getAsciiRange();
-  backend_->signal_update().connect(sigc::mem_fun(*this, &Cava::onUpdate));
-  backend_->signal_silence().connect(sigc::mem_fun(*this, &Cava::onSilence));
+  // Bar heights come as chars, clamped to the top icon: one lookup per bar from then on
+  for (int ch = -128; ch < 128; ++ch)
+    glyphs_[static_cast<unsigned char>(ch)] =
+        getIcon((ch > ascii_range_) ? ascii_range_ : ch, "", ascii_range_ + 1);
+  // The latest frame is drawn once per display refresh, on the event box as the label may hide
+  event_box_.add_tick_callback(sigc::mem_fun(*this, &Cava::onTick));
   backend_->Update();
 }
 
@@ -23,36 +29,63 @@ auto waybar::modules::cava::Cava::doAction(const std::string& name) -> void {
 
 // Cava actions
 void waybar::modules::cava::Cava::pause_resume() { backend_->doPauseResume(); }
+
+auto waybar::modules::cava::Cava::onTick(const Glib::RefPtr<Gdk::FrameClock>&) -> bool {
+  if (frames_->update() && onFrame()) {
+    // The backend publishes nothing until it hears something again: no tick meanwhile
+    idle_check_ = Glib::signal_timeout().connect(sigc::mem_fun(*this, &Cava::onIdleCheck),
+                                                 CavaBackend::IDLE_CHECK_INTERVAL.count());
+    return false;
+  }
+  return true;
+}
+
+auto waybar::modules::cava::Cava::onIdleCheck() -> bool {
+  if (!frames_->update() || onFrame()) {
+    return true;
+  }
+  event_box_.add_tick_callback(sigc::mem_fun(*this, &Cava::onTick));
+  return false;
+}
+
+auto waybar::modules::cava::Cava::onFrame() -> bool {
+  const auto& frame = frames_->front();
+  if (frame.silence)
+    onSilence();
+  else
+    onUpdate(frame.text);
+  return frame.silence;
+}
+
 auto waybar::modules::cava::Cava::onUpdate(const std::string& input) -> void {
-  Glib::signal_idle().connect_once([this, input]() {
-    if (silence_) {
-      label_.get_style_context()->remove_class("silent");
-      if (!label_.get_style_context()->has_class("updated"))
-        label_.get_style_context()->add_class("updated");
-    }
-    label_text_.clear();
-    for (auto& ch : input)
-      label_text_.append(getIcon((ch > ascii_range_) ? ascii_range_ : ch, "", ascii_range_ + 1));
+  if (silence_) {
+    label_.get_style_context()->remove_class("silent");
+    if (!label_.get_style_context()->has_class("updated"))
+      label_.get_style_context()->add_class("updated");
+  }
+  // Buffers keep their capacity, so steady frames don't allocate here
+  label_text_.clear();
+  for (const char ch : input) label_text_.append(glyphs_[static_cast<unsigned char>(ch)]);
 
+  if (silence_ || label_text_ != shown_text_) {
     label_.set_markup(label_text_);
     label_.show();
     ALabel::update();
-  });
+    shown_text_.swap(label_text_);
+  }
   silence_ = false;
 }
 
 auto waybar::modules::cava::Cava::onSilence() -> void {
-  Glib::signal_idle().connect_once([this]() {
-    if (!silence_) {
-      if (label_.get_style_context()->has_class("updated"))
-        label_.get_style_context()->remove_class("updated");
-
-      if (hide_on_silence_)
-        label_.hide();
-      else if (config_["format_silent"].isString())
-        label_.set_markup(format_silent_);
-      silence_ = true;
-      label_.get_style_context()->add_class("silent");
-    }
-  });
+  if (!silence_) {
+    if (label_.get_style_context()->has_class("updated"))
+      label_.get_style_context()->remove_class("updated");
+
+    if (hide_on_silence_)
+      label_.hide();
+    else if (config_["format_silent"].isString())
+      label_.set_markup(format_silent_);
+    silence_ = true;
+    label_.get_style_context()->add_class("silent");
+  }
 }
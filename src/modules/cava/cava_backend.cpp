@@ -2,11 +2,43 @@
 
 #include <spdlog/spdlog.h>
 
+#include <mutex>
+
+#include "util/shared_instance.hpp"
+
+namespace {
+
+// The members of a module config the backend reads, the others only matter to the frontend
+std::string backendKey(const Json::Value& config) {
+  static constexpr const char* KEYS[] = {
+      "cava_config", "data_format", "raw_target", "bar_spacing", "bar_width", "bar_height",
+      "gravity", "integral", "framerate", "autosens", "sensitivity", "bars", "lower_cutoff_freq",
+      "higher_cutoff_freq", "sleep_timer", "method", "source", "sample_rate", "sample_bits",
+      "stereo", "reverse", "bar_delimiter", "monstercat", "waves", "noise_reduction",
+      "input_delay", "gradient", "gradient_count", "sdl_width", "sdl_height"};
+  Json::Value key(Json::objectValue);
+  for (const auto* member : KEYS) {
+    if (config.isMember(member)) {
+      key[member] = config[member];
+    }
+  }
+  // only the number of icons is used
+  key["format-icons"] = config["format-icons"].size();
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, key);
+}
+
+}  // namespace
+
 std::shared_ptr<waybar::modules::cava::CavaBackend> waybar::modules::cava::CavaBackend::inst(
     const Json::Value& config) {
-  static auto* backend = new CavaBackend(config);
-  static std::shared_ptr<CavaBackend> backend_ptr{backend};
-  return backend_ptr;
+  static std::mutex mutex;
+  static util::SharedInstances<std::string, CavaBackend> backends;
+
+  std::lock_guard lock(mutex);
+  return backends.get(backendKey(config),
+                      [&config] { return std::shared_ptr<CavaBackend>(new CavaBackend(config)); });
 }
 
 waybar::modules::cava::CavaBackend::CavaBackend(const Json::Value& config) : config_(config) {
@@ -20,18 +52,34 @@ waybar::modules::cava::CavaBackend::CavaBackend(const Json::Value& config) : con
       spdlog::warn("Cava backend. Read source error: {0}", e.what());
     }
     read_thread_.sleep_for(fetch_input_delay_);
-    loadConfig();
+    if (read_thread_.isRunning()) loadConfig();
   };
   // Write outcoming data. Emit signals
   out_thread_ = [this] {
+    if (idle_ && !heardInput()) {
+      out_thread_.sleep_for(IDLE_CHECK_INTERVAL);
+      return;
+    }
+    if (idle_.exchange(false)) {
+      sleep_counter_ = 0;  // awake for sleep_timer again, whatever isSilence() makes of it
+    }
     doUpdate(false);
     out_thread_.sleep_for(frame_time_milsec_);
   };
 }
 
 waybar::modules::cava::CavaBackend::~CavaBackend() {
+  // Let the input loop return, suspended or not
+  pthread_mutex_lock(&audio_data_.lock);
+  audio_data_.terminate = 1;
+  audio_data_.suspendFlag = false;
+  pthread_cond_broadcast(&audio_data_.resumeCond);
+  pthread_mutex_unlock(&audio_data_.lock);
+
   out_thread_.stop();
   read_thread_.stop();
+  out_thread_.join();
+  read_thread_.join();
 
   freeBackend();
 }
@@ -64,6 +112,18 @@ bool waybar::modules::cava::CavaBackend::isSilence() {
   return true;
 }
 
+bool waybar::modules::cava::CavaBackend::heardInput() {
+  pthread_mutex_lock(&audio_data_.lock);
+  bool heard = false;
+  for (int i{0}; i < audio_data_.samples_counter && !heard; ++i) {
+    heard = audio_data_.cava_in[i] != 0;
+  }
+  // Kept for the next execute() otherwise, so that the first frame has the sound that woke it
+  if (!heard) audio_data_.samples_counter = 0;
+  pthread_mutex_unlock(&audio_data_.lock);
+  return heard;
+}
+
 int waybar::modules::cava::CavaBackend::getAsciiRange() { return prm_.ascii_range; }
 
 // Process: execute cava
@@ -104,19 +164,37 @@ void waybar::modules::cava::CavaBackend::doPauseResume() {
   Update();
 }
 
-waybar::modules::cava::CavaBackend::type_signal_update
-waybar::modules::cava::CavaBackend::signal_update() {
-  return m_signal_update_;
+std::shared_ptr<waybar::modules::cava::CavaBackend::Frames>
+waybar::modules::cava::CavaBackend::subscribe() {
+  // Slots come with room for the current bar count
+  CavaFrame init;
+  init.text.reserve(output_.capacity());
+  init.bars.reserve(audio_raw_.number_of_bars);
+  init.previous_bars.reserve(audio_raw_.number_of_bars);
+  auto frames = std::make_shared<Frames>(init);
+
+  std::lock_guard lock(frames_mutex_);
+  frames_.push_back(frames);
+  return frames;
 }
 
-waybar::modules::cava::CavaBackend::type_signal_audio_raw_update
-waybar::modules::cava::CavaBackend::signal_audio_raw_update() {
-  return m_signal_audio_raw_;
-}
-
-waybar::modules::cava::CavaBackend::type_signal_silence
-waybar::modules::cava::CavaBackend::signal_silence() {
-  return m_signal_silence_;
+void waybar::modules::cava::CavaBackend::publish(bool silence) {
+  std::lock_guard lock(frames_mutex_);
+  std::erase_if(frames_, [](const auto& frames) { return frames.expired(); });
+  for (const auto& weak : frames_) {
+    auto frames = weak.lock();
+    if (!frames) continue;
+    auto& frame = frames->back();
+    frame.silence = silence;
+    if (!silence) {
+      const auto* bars = audio_raw_.bars_raw;
+      const auto* previous_bars = audio_raw_.previous_bars_raw;
+      frame.text.assign(output_);
+      frame.bars.assign(bars, bars + audio_raw_.number_of_bars);
+      frame.previous_bars.assign(previous_bars, previous_bars + audio_raw_.number_of_bars);
+    }
+    frames->publish();
+  }
 }
 
 void waybar::modules::cava::CavaBackend::Update() { doUpdate(true); }
@@ -136,15 +214,11 @@ void waybar::modules::cava::CavaBackend::doUpdate(bool force) {
   }
 
   if (!silence_ || prm_.sleep_timer == 0) {
-    if (downThreadDelay(frame_time_milsec_, suspend_silence_delay_)) Update();
     execute();
-    if (re_paint_ == 1 || force || prm_.continuous_rendering) {
-      m_signal_update_.emit(output_);
-      m_signal_audio_raw_.emit(audio_raw_);
-    }
+    if (re_paint_ == 1 || force || prm_.continuous_rendering) publish(false);
   } else {
-    if (upThreadDelay(frame_time_milsec_, suspend_silence_delay_)) Update();
-    if (silence_ != silence_prev_ || force) m_signal_silence_.emit();
+    idle_ = true;
+    if (silence_ != silence_prev_ || force) publish(true);
   }
   silence_prev_ = silence_;
 }
@@ -218,7 +292,7 @@ void waybar::modules::cava::CavaBackend::loadConfig() {
     prm_.input = ::cava::input_method_by_name(config_["method"].asString().c_str());
   if (config_["source"].isString()) {
     if (prm_.audio_source) free(prm_.audio_source);
-    prm_.audio_source = config_["source"].asString().data();
+    prm_.audio_source = strdup(config_["source"].asString().c_str());
   }
   if (config_["sample_rate"].isNumeric()) prm_.samplerate = config_["sample_rate"].asLargestInt();
   if (config_["sample_bits"].isInt()) prm_.samplebits = config_["sample_bits"].asInt();
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <type_traits>
 
+#include "util/trace.hpp"
+
 namespace waybar::modules {
 
 CFFI::CFFI(const std::string& name, const std::string& id, const Json::Value& config)
@@ -28,7 +30,7 @@ CFFI::CFFI(const std::string& name, const std::string& id, const Json::Value& co
   }
 
   // Fetch functions
-  if (*wbcffi_version == 1 || *wbcffi_version == 2) {
+  if (*wbcffi_version >= 1 && *wbcffi_version <= 3) {
     // Mandatory functions
     hooks_.init = reinterpret_cast<InitFn*>(dlsym(handle, "wbcffi_init"));
     if (!hooks_.init) {
@@ -44,10 +46,16 @@ CFFI::CFFI(const std::string& name, const std::string& id, const Json::Value& co
     }
     if (auto fn = reinterpret_cast<RefreshFn*>(dlsym(handle, "wbcffi_refresh"))) {
       hooks_.refresh = fn;
+      has_refresh_ = true;
     }
     if (auto fn = reinterpret_cast<DoActionFn*>(dlsym(handle, "wbcffi_doaction"))) {
       hooks_.doAction = fn;
     }
+    if (*wbcffi_version >= 3) {
+      if (auto fn = reinterpret_cast<UpdateDataFn*>(dlsym(handle, "wbcffi_update_data"))) {
+        hooks_.updateData = fn;
+      }
+    }
   } else {
     throw std::runtime_error{"Unknown wbcffi_version " + std::to_string(*wbcffi_version)};
   }
@@ -83,6 +91,18 @@ CFFI::CFFI(const std::string& name, const std::string& id, const Json::Value& co
             return dynamic_cast<Gtk::Container*>(&((CFFI*)obj)->event_box_)->gobj();
           },
       .queue_update = [](ffi::wbcffi_module* obj) { ((CFFI*)obj)->dp.emit(); },
+      .publish = [](ffi::wbcffi_module* obj, const void* data,
+                    size_t len) { ((CFFI*)obj)->publish(data, len); },
+      .add_timer =
+          [](ffi::wbcffi_module* obj, uint32_t period_ms, void (*fn)(void*), void* user_data) {
+            return ((CFFI*)obj)->addTimer(period_ms, fn, user_data);
+          },
+      .remove_timer = [](ffi::wbcffi_module* obj,
+                         uint64_t timer) { ((CFFI*)obj)->removeTimer(timer); },
+      .count =
+          [](ffi::wbcffi_module* obj, const char* name, int64_t value) {
+            util::trace::counter(((CFFI*)obj)->name_ + "/" + name, "cffi", value);
+          },
   };
 
   // Call init
@@ -95,6 +115,21 @@ CFFI::CFFI(const std::string& name, const std::string& id, const Json::Value& co
 }
 
 CFFI::~CFFI() {
+  // Not running anymore once removed, so the plugin state they use can go. Again for the ones
+  // added meanwhile by a timer
+  for (std::vector<util::Scheduler::Id> timers;;) {
+    {
+      std::lock_guard lock(timers_mutex_);
+      timers.swap(timers_);
+    }
+    if (timers.empty()) {
+      break;
+    }
+    for (auto id : timers) {
+      util::Scheduler::inst().remove(id);
+    }
+    timers.clear();
+  }
   if (cffi_instance_ != nullptr) {
     hooks_.deinit(cffi_instance_);
   }
@@ -102,17 +137,69 @@ CFFI::~CFFI() {
 
 auto CFFI::update() -> void {
   assert(cffi_instance_ != nullptr);
+  // cleared first: a publish() from here on wakes us up again
+  publish_pending_ = false;
+  if (published_.update()) {
+    const auto& data = published_.front();
+    hooks_.updateData(cffi_instance_, data.data(), data.size());
+  }
   hooks_.update(cffi_instance_);
 
   // Execute the on-update command set in config
   AModule::update();
 }
 
+auto CFFI::setPaused(bool paused) -> void {
+  AModule::setPaused(paused);
+  std::lock_guard lock(timers_mutex_);
+  timers_paused_ = paused;
+  for (auto id : timers_) {
+    util::Scheduler::inst().pause(id, paused);
+  }
+}
+
+void CFFI::publish(const void* data, size_t len) {
+  {
+    std::lock_guard lock(publish_mutex_);
+    auto& back = published_.back();
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    back.assign(bytes, bytes + len);
+    published_.publish();
+  }
+  // One wakeup for a burst, the update only sees the latest
+  if (!publish_pending_.exchange(true)) {
+    dp.emit();
+  }
+}
+
+uint64_t CFFI::addTimer(uint32_t period_ms, void (*fn)(void*), void* user_data) {
+  std::lock_guard lock(timers_mutex_);
+  const auto period = std::chrono::milliseconds(std::max<uint32_t>(period_ms, 1));
+  auto id = util::Scheduler::inst().add(period, [fn, user_data] { fn(user_data); }, timers_paused_);
+  timers_.push_back(id);
+  return id;
+}
+
+void CFFI::removeTimer(uint64_t timer) {
+  {
+    std::lock_guard lock(timers_mutex_);
+    auto it = std::find(timers_.begin(), timers_.end(), timer);
+    if (it == timers_.end()) {
+      return;
+    }
+    timers_.erase(it);
+  }
+  // Unlocked: this waits for a run of the timer in progress, which may add or remove timers
+  util::Scheduler::inst().remove(timer);
+}
+
 auto CFFI::refresh(int signal) -> void {
   assert(cffi_instance_ != nullptr);
   hooks_.refresh(cffi_instance_, signal);
 }
 
+auto CFFI::refreshSignal() const -> int { return has_refresh_ ? ANY_SIGNAL : 0; }
+
 auto CFFI::doAction(const std::string& name) -> void {
   assert(cffi_instance_ != nullptr);
   if (!name.empty()) {
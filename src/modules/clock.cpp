@@ -4,11 +4,14 @@
 #include <gtkmm/tooltip.h>
 #include <spdlog/spdlog.h>
 
+#include <array>
 #include <chrono>
 #include <iomanip>
 #include <regex>
 #include <sstream>
+#include <string_view>
 
+#include "util/time_format.hpp"
 #include "util/ustring_clen.hpp"
 
 #ifdef HAVE_LANGINFO_1STDAY
@@ -26,8 +29,6 @@ waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
       m_tlpFmt_{(config_["tooltip-format"].isString()) ? config_["tooltip-format"].asString() : ""},
       m_tooltip_{new Gtk::Label()},
       cldInTooltip_{m_tlpFmt_.find("{" + kCldPlaceholder + "}") != std::string::npos},
-      cldYearShift_{January / 1 / 1900},
-      cldMonShift_{year(1900) / January},
       tzInTooltip_{m_tlpFmt_.find("{" + kTZPlaceholder + "}") != std::string::npos},
       tzCurrIdx_{0},
       tzTooltipFormat_{config_["timezone-tooltip-format"].isString()
@@ -36,6 +37,27 @@ waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
       ordInTooltip_{m_tlpFmt_.find("{" + kOrdPlaceholder + "}") != std::string::npos} {
   m_tlpText_ = m_tlpFmt_;
 
+  // Split the tooltip format once, so placeholders are spliced in by plain concatenation
+  const std::array<std::pair<std::string, TlpPart>, 3> placeholders{
+      {{"{" + kTZPlaceholder + "}", TlpPart::TZ},
+       {"{" + kCldPlaceholder + "}", TlpPart::CALENDAR},
+       {"{" + kOrdPlaceholder + "}", TlpPart::ORDINAL}}};
+  for (std::string::size_type pos{0}; pos < m_tlpFmt_.size();) {
+    auto next{std::string::npos};
+    const std::pair<std::string, TlpPart>* found{nullptr};
+    for (const auto& ph : placeholders) {
+      auto at{m_tlpFmt_.find(ph.first, pos)};
+      if (at < next) {
+        next = at;
+        found = &ph;
+      }
+    }
+    if (next > pos) m_tlpParts_.emplace_back(TlpPart::LITERAL, m_tlpFmt_.substr(pos, next - pos));
+    if (found == nullptr) break;
+    m_tlpParts_.emplace_back(found->second, "");
+    pos = next + found->first.size();
+  }
+
   if (config_["timezones"].isArray() && !config_["timezones"].empty()) {
     for (const auto& zone_name : config_["timezones"]) {
       if (!zone_name.isString()) continue;
@@ -61,6 +83,7 @@ waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
       }
   }
   if (!tzList_.size()) tzList_.push_back(nullptr);
+  tzTextSeconds_ = util::showsSeconds(tzTooltipFormat_.empty() ? format_ : tzTooltipFormat_);
 
   // Calendar properties
   if (cldInTooltip_) {
@@ -98,11 +121,9 @@ waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
       fmtMap_.insert({2, config_[kCldPlaceholder]["format"]["days"].asString()});
     else
       fmtMap_.insert({2, "{}"});
-    if (config_[kCldPlaceholder]["format"]["today"].isString()) {
+    if (config_[kCldPlaceholder]["format"]["today"].isString())
       fmtMap_.insert({3, config_[kCldPlaceholder]["format"]["today"].asString()});
-      auto local_time = zoned_time{local_zone(), system_clock::now()}.get_local_time();
-      cldBaseDay_ = year_month_day{floor<days>(local_time)}.day();
-    } else
+    else
       fmtMap_.insert({3, "{}"});
     if (config_[kCldPlaceholder]["format"]["weeks"].isString() && cldWPos_ != WS::HIDDEN) {
       const auto defaultFmt =
@@ -146,58 +167,92 @@ waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
     label_.signal_query_tooltip().connect(sigc::mem_fun(*this, &Clock::query_tlp_cb));
   }
 
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_ - system_clock::now().time_since_epoch() % interval_);
-  };
+  // the scheduler aligns the ticks to multiples of the period, the full minute without seconds
+  const auto period{util::clockPeriod(
+      interval_, {format_, config_["format-alt"].asString(),
+                  tooltipEnabled() ? m_tlpFmt_ : std::string{}, tzTooltipFormat_})};
+  if (period != interval_) spdlog::debug("Clock: no format shows seconds, ticking every minute");
+  // the time is shown on battery power too
+  timer_.start(period, [this] { dp.emit(); }, period);
 }
 
 bool waybar::modules::Clock::query_tlp_cb(int, int, bool,
                                           const Glib::RefPtr<Gtk::Tooltip>& tooltip) {
+  if (m_tlpDirty_) update_tooltip();
   tooltip->set_custom(*m_tooltip_.get());
   return true;
 }
 
 auto waybar::modules::Clock::update() -> void {
-  const auto* tz = tzList_[tzCurrIdx_] != nullptr ? tzList_[tzCurrIdx_] : local_zone();
-  const zoned_time now{tz, floor<seconds>(system_clock::now())};
+  const auto sysNow{floor<seconds>(system_clock::now())};
+  const zoned_time now{active_zone(sysNow), sysNow};
 
   label_.set_markup(fmt_lib::vformat(m_locale_, format_, fmt_lib::make_format_args(now)));
 
   if (tooltipEnabled()) {
-    const year_month_day today{floor<days>(now.get_local_time())};
-    const auto shiftedDay{today + cldCurrShift_};
-    const zoned_time shiftedNow{
-        tz, local_days(shiftedDay) + (now.get_local_time() - floor<days>(now.get_local_time()))};
-
-    if (tzInTooltip_) tzText_ = getTZtext(now.get_sys_time());
-    if (cldInTooltip_) cldText_ = get_calendar(today, shiftedDay, tz);
-    if (ordInTooltip_) ordText_ = get_ordinal_date(shiftedDay);
-    if (tzInTooltip_ || cldInTooltip_ || ordInTooltip_) {
-      // std::vformat doesn't support named arguments.
-      m_tlpText_ =
-          std::regex_replace(m_tlpFmt_, std::regex("\\{" + kTZPlaceholder + "\\}"), tzText_);
-      m_tlpText_ = std::regex_replace(
-          m_tlpText_, std::regex("\\{" + kCldPlaceholder + "\\}"),
-          fmt_lib::vformat(m_locale_, cldText_, fmt_lib::make_format_args(shiftedNow)));
-      m_tlpText_ =
-          std::regex_replace(m_tlpText_, std::regex("\\{" + kOrdPlaceholder + "\\}"), ordText_);
-    } else {
-      m_tlpText_ = m_tlpFmt_;
-    }
-
-    m_tlpText_ = fmt_lib::vformat(m_locale_, m_tlpText_, fmt_lib::make_format_args(now));
-    m_tooltip_->set_markup(m_tlpText_);
+    // The tooltip is only built from query_tlp_cb. The query below reaches it only while the
+    // pointer is over the label, so a hidden tooltip costs nothing per tick
+    m_tlpDirty_ = true;
     label_.trigger_tooltip_query();
   }
 
   ALabel::update();
 }
 
-auto waybar::modules::Clock::getTZtext(sys_seconds now) -> std::string {
-  if (tzList_.size() == 1) return "";
+auto waybar::modules::Clock::update_tooltip() -> void {
+  const auto sysNow{floor<seconds>(system_clock::now())};
+  const auto* tz = active_zone(sysNow);
+  const zoned_time now{tz, sysNow};
+  const year_month_day today{floor<days>(now.get_local_time())};
+  const auto shiftedDay{today + cldCurrShift_};
+  const zoned_time shiftedNow{
+      tz, local_days(shiftedDay) + (now.get_local_time() - floor<days>(now.get_local_time()))};
+
+  if (tzInTooltip_) update_tz_text(sysNow);
+  if (cldInTooltip_) cldText_ = get_calendar(today, shiftedDay, tz);
+  if (ordInTooltip_) ordText_ = get_ordinal_date(shiftedDay);
+  if (tzInTooltip_ || cldInTooltip_ || ordInTooltip_) {
+    // std::vformat doesn't support named arguments.
+    const auto cldText{
+        cldInTooltip_
+            ? fmt_lib::vformat(m_locale_, cldText_, fmt_lib::make_format_args(shiftedNow))
+            : std::string{}};
+    m_tlpText_.clear();
+    for (const auto& [part, literal] : m_tlpParts_) {
+      switch (part) {
+        case TlpPart::LITERAL:
+          m_tlpText_ += literal;
+          break;
+        case TlpPart::TZ:
+          m_tlpText_ += tzText_;
+          break;
+        case TlpPart::CALENDAR:
+          m_tlpText_ += cldText;
+          break;
+        case TlpPart::ORDINAL:
+          m_tlpText_ += ordText_;
+          break;
+      }
+    }
+  } else {
+    m_tlpText_ = m_tlpFmt_;
+  }
+
+  m_tlpText_ = fmt_lib::vformat(m_locale_, m_tlpText_, fmt_lib::make_format_args(now));
+  m_tooltip_->set_markup(m_tlpText_);
+  m_tlpDirty_ = false;
+}
+
+auto waybar::modules::Clock::update_tz_text(sys_seconds now) -> void {
+  // The offsets of the zones change on the minute too, a text without seconds holds until the next
+  const TzTextKey key{tzTextSeconds_ ? now : floor<minutes>(now), tzCurrIdx_};
+  if (tzTextKey_ == key) return;
+  tzTextKey_ = key;
+  tzText_.clear();
+  if (tzList_.size() == 1) return;
 
-  std::stringstream os;
+  // Use timezone-tooltip-format if specified, otherwise use format_
+  const std::string& fmt = tzTooltipFormat_.empty() ? format_ : tzTooltipFormat_;
   bool first = true;
   for (size_t tz_idx{0}; tz_idx < tzList_.size(); ++tz_idx) {
     // Skip local timezone (nullptr) - never show it in tooltip
@@ -206,21 +261,13 @@ auto waybar::modules::Clock::getTZtext(sys_seconds now) -> std::string {
     // Skip current timezone unless timezone-tooltip-format is specified
     if (static_cast<int>(tz_idx) == tzCurrIdx_ && tzTooltipFormat_.empty()) continue;
 
-    const auto* tz = tzList_[tz_idx];
-    auto zt{zoned_time{tz, now}};
+    const zoned_time zt{tzList_[tz_idx], now};
 
     // Add newline before each entry except the first
-    if (!first) {
-      os << '\n';
-    }
+    if (!first) tzText_ += '\n';
     first = false;
-
-    // Use timezone-tooltip-format if specified, otherwise use format_
-    const std::string& fmt = tzTooltipFormat_.empty() ? format_ : tzTooltipFormat_;
-    os << fmt_lib::vformat(m_locale_, fmt, fmt_lib::make_format_args(zt));
+    tzText_ += fmt_lib::vformat(m_locale_, fmt, fmt_lib::make_format_args(zt));
   }
-
-  return os.str();
 }
 
 const unsigned cldRowsInMonth(const year_month& ym, const weekday& firstdow) {
@@ -321,33 +368,20 @@ auto getCalendarLine(const year_month_day& currDate, const year_month ym, const
 
 auto waybar::modules::Clock::get_calendar(const year_month_day& today, const year_month_day& ymd,
                                           const time_zone* tz) -> const std::string {
-  const auto firstdow{first_day_of_week()};
-  const auto maxRows{12 / cldMonCols_};
   const auto ym{ymd.year() / ymd.month()};
   const auto y{ymd.year()};
   const auto d{ymd.day()};
 
+  // The calendar only changes at midnight, on shift/mode actions or on a time zone switch
+  const CldKey key{(cldMode_ == CldMode::YEAR) ? y / January : ym, cldMode_, today, tz};
+  if (cldCachedKey_ == key) return cldText_;
+
+  const auto firstdow{first_day_of_week()};
+  const auto maxRows{12 / cldMonCols_};
+
   std::ostringstream os;
   std::ostringstream tmp;
 
-  if (cldMode_ == CldMode::YEAR) {
-    if (y / month{1} / 1 == cldYearShift_)
-      if (d == cldBaseDay_ || (uint)cldBaseDay_ == 0u)
-        return cldYearCached_;
-      else
-        cldBaseDay_ = d;
-    else
-      cldYearShift_ = y / month{1} / 1;
-  }
-  if (cldMode_ == CldMode::MONTH) {
-    if (ym == cldMonShift_)
-      if (d == cldBaseDay_ || (uint)cldBaseDay_ == 0u)
-        return cldMonCached_;
-      else
-        cldBaseDay_ = d;
-    else
-      cldMonShift_ = ym;
-  }
   // Pad object
   const std::string pads(cldWnLen_, ' ');
   // Compute number of lines needed for each calendar month
@@ -448,14 +482,21 @@ auto waybar::modules::Clock::get_calendar(const year_month_day& today, const yea
                        fmt_lib::make_format_args(
                            static_cast<const std::string_view&&>(date::format("{:L%e}", d)))));
 
-  if (cldMode_ == CldMode::YEAR)
-    cldYearCached_ = os.str();
-  else
-    cldMonCached_ = os.str();
+  cldCachedKey_ = key;
 
   return os.str();
 }
 
+auto waybar::modules::Clock::active_zone(sys_seconds now) -> const time_zone* {
+  if (tzList_[tzCurrIdx_] != nullptr) return tzList_[tzCurrIdx_];
+  // TZ and /etc/localtime only change with the system settings, looked up again once a minute
+  if (localZone_ == nullptr || floor<minutes>(now) != localZoneCheckedAt_) {
+    localZone_ = local_zone();
+    localZoneCheckedAt_ = floor<minutes>(now);
+  }
+  return localZone_;
+}
+
 auto waybar::modules::Clock::local_zone() -> const time_zone* {
   const char* tz_name = getenv("TZ");
   if (tz_name) {
@@ -14,18 +14,25 @@
 #endif
 
 waybar::modules::Cpu::Cpu(const std::string& id, const Json::Value& config)
-    : ALabel(config, "cpu", id, "{usage}%", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+    : ALabel(config, "cpu", id, "{usage}%", 10),
+      usage_(CpuUsage::sharedSample(interval_)),
+      frequency_(CpuFrequency::sharedSample(interval_)) {
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::Cpu::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::Cpu::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
   auto [load1, load5, load15] = Load::getLoad();
-  auto [cpu_usage, tooltip] = CpuUsage::getCpuUsage(prev_times_);
-  auto [max_frequency, min_frequency, avg_frequency] = CpuFrequency::getCpuFrequency();
+  auto usage = usage_->sample(CpuUsage::readSample);
+  const auto& cpu_usage = usage->usage;
+  const auto& tooltip = usage->tooltip;
+  auto [max_frequency, min_frequency, avg_frequency] =
+      *frequency_->sample(CpuFrequency::readSample);
   if (tooltipEnabled()) {
     label_.set_tooltip_text(tooltip);
   }
@@ -44,16 +51,26 @@ auto waybar::modules::Cpu::update() -> void {
     fmt::dynamic_format_arg_store<fmt::format_context> store;
     store.push_back(fmt::arg("load", load1));
     store.push_back(fmt::arg("usage", total_usage));
-    store.push_back(fmt::arg("icon", getIcon(total_usage, icons)));
+    store.push_back(
+        fmt::arg("icon", formatUses(format, "icon") ? getIcon(total_usage, icons) : ""));
     store.push_back(fmt::arg("max_frequency", max_frequency));
     store.push_back(fmt::arg("min_frequency", min_frequency));
     store.push_back(fmt::arg("avg_frequency", avg_frequency));
-    for (size_t i = 1; i < cpu_usage.size(); ++i) {
-      auto core_i = i - 1;
-      auto core_format = fmt::format("usage{}", core_i);
-      store.push_back(fmt::arg(core_format.c_str(), cpu_usage[i]));
-      auto icon_format = fmt::format("icon{}", core_i);
-      store.push_back(fmt::arg(icon_format.c_str(), getIcon(cpu_usage[i], icons)));
+    if (CpuUsage::hasPerCoreArgs(format)) {
+      for (size_t i = 1; i < cpu_usage.size(); ++i) {
+        auto core_i = i - 1;
+        auto core_format = fmt::format("usage{}", core_i);
+        store.push_back(fmt::arg(core_format.c_str(), cpu_usage[i]));
+        auto icon_format = fmt::format("icon{}", core_i);
+        store.push_back(fmt::arg(icon_format.c_str(), getIcon(cpu_usage[i], icons)));
+      }
+    }
+    if (format.find("{icons") != std::string::npos) {
+      std::string all_icons;
+      for (size_t i = 1; i < cpu_usage.size(); ++i) {
+        all_icons += getIcon(cpu_usage[i], icons);
+      }
+      store.push_back(fmt::arg("icons", all_icons));
     }
     label_.set_markup(fmt::vformat(format, store));
   }
@@ -10,16 +10,19 @@
 #endif
 
 waybar::modules::CpuFrequency::CpuFrequency(const std::string& id, const Json::Value& config)
-    : ALabel(config, "cpu_frequency", id, "{avg_frequency}", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+    : ALabel(config, "cpu_frequency", id, "{avg_frequency}", 10),
+      sample_(sharedSample(interval_)) {
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::CpuFrequency::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::CpuFrequency::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [max_frequency, min_frequency, avg_frequency] = CpuFrequency::getCpuFrequency();
+  auto [max_frequency, min_frequency, avg_frequency] = *sample_->sample(readSample);
   if (tooltipEnabled()) {
     auto tooltip =
         fmt::format("Minimum frequency: {}\nAverage frequency: {}\nMaximum frequency: {}\n",
@@ -65,3 +68,8 @@ std::tuple<float, float, float> waybar::modules::CpuFrequency::getCpuFrequency()
 
   return {max_frequency, min_frequency, avg_frequency};
 }
+
+std::shared_ptr<waybar::util::SharedSample<waybar::modules::CpuFrequency::Sample>>
+waybar::modules::CpuFrequency::sharedSample(std::chrono::milliseconds interval) {
+  return util::SharedSample<Sample>::get("cpu_frequency", interval);
+}
@@ -1,44 +1,77 @@
 #include <filesystem>
+#include <memory>
+#include <mutex>
 
 #include "modules/cpu_frequency.hpp"
+#include "util/proc_file.hpp"
 
-std::vector<float> waybar::modules::CpuFrequency::parseCpuFrequencies() {
-  const std::string file_path_ = "/proc/cpuinfo";
-  std::ifstream info(file_path_);
-  if (!info.is_open()) {
-    throw std::runtime_error("Can't open " + file_path_);
+namespace {
+
+// A cpufreq policy: the CPUs it covers run at the same frequency, read once for all of them
+struct Policy {
+  std::unique_ptr<waybar::util::ProcFile> cur_freq;
+  size_t cpus;
+};
+
+std::vector<Policy> findPolicies() {
+  std::vector<Policy> policies;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator("/sys/devices/system/cpu/cpufreq", ec)) {
+    if (!entry.path().filename().string().starts_with("policy")) {
+      continue;
+    }
+    // The online CPUs of the policy, eg. "0 1 2 3"
+    waybar::util::ProcFile affected_file{(entry.path() / "affected_cpus").string()};
+    size_t cpus = 0;
+    if (auto affected = affected_file.tryRead()) {
+      for (size_t cpu; waybar::util::nextNumber(*affected, cpu);) {
+        ++cpus;
+      }
+    }
+    if (cpus == 0) {
+      continue;
+    }
+    policies.push_back(
+        {std::make_unique<waybar::util::ProcFile>((entry.path() / "scaling_cur_freq").string()),
+         cpus});
   }
+  return policies;
+}
+
+}  // namespace
+
+std::vector<float> waybar::modules::CpuFrequency::parseCpuFrequencies() {
+  static std::mutex mutex;
+  // Scanned once, along with the first sample
+  static const std::vector<Policy> policies = findPolicies();
+  // Only when cpufreq can't be read: generating it costs an IPI per CPU
+  static util::ProcFile info{"/proc/cpuinfo"};
+
+  std::lock_guard lock(mutex);
   std::vector<float> frequencies;
-  std::string line;
-  while (getline(info, line)) {
-    if (line.substr(0, 7).compare("cpu MHz") != 0) {
+  for (const auto& policy : policies) {
+    auto cur_freq = policy.cur_freq->tryRead();
+    size_t frequency = 0;
+    if (!cur_freq || !util::nextNumber(*cur_freq, frequency)) {
       continue;
     }
-
-    std::string frequency_str = line.substr(line.find(":") + 2);
-    float frequency = std::strtol(frequency_str.c_str(), nullptr, 10);
-    frequencies.push_back(frequency);
+    // kHz, one value per CPU for the average to weigh the policies by their size
+    frequencies.insert(frequencies.end(), policy.cpus, frequency / 1000.f);
   }
-  info.close();
-
-  if (frequencies.size() <= 0) {
-    std::string cpufreq_dir = "/sys/devices/system/cpu/cpufreq";
-    if (std::filesystem::exists(cpufreq_dir)) {
-      std::vector<std::string> frequency_files = {"/cpuinfo_min_freq", "/cpuinfo_max_freq"};
-      for (auto& p : std::filesystem::directory_iterator(cpufreq_dir)) {
-        for (auto freq_file : frequency_files) {
-          std::string freq_file_path = p.path().string() + freq_file;
-          if (std::filesystem::exists(freq_file_path)) {
-            std::string freq_value;
-            std::ifstream freq(freq_file_path);
-            if (freq.is_open()) {
-              getline(freq, freq_value);
-              float frequency = std::strtol(freq_value.c_str(), nullptr, 10);
-              frequencies.push_back(frequency / 1000);
-              freq.close();
-            }
-          }
-        }
+
+  if (frequencies.empty()) {
+    auto data = info.read();
+    while (!data.empty()) {
+      auto line = data.substr(0, data.find('\n'));
+      data.remove_prefix(std::min(line.size() + 1, data.size()));
+      if (!line.starts_with("cpu MHz")) {
+        continue;
+      }
+      line.remove_prefix(std::min(line.find(':') + 1, line.size()));
+      float frequency = 0;
+      if (util::nextNumber(line, frequency)) {
+        frequencies.push_back(frequency);
       }
     }
   }
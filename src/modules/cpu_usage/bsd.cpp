@@ -28,7 +28,7 @@ typedef uint64_t pcp_time_t;
 typedef long pcp_time_t;
 #endif
 
-std::vector<std::tuple<size_t, size_t>> waybar::modules::CpuUsage::parseCpuinfo() {
+void waybar::modules::CpuUsage::parseCpuinfo(Times &times) {
   cp_time_t sum_cp_time[CPUSTATES];
   size_t sum_sz = sizeof(sum_cp_time);
   int ncpu = sysconf(_SC_NPROCESSORS_CONF);
@@ -95,13 +95,14 @@ std::vector<std::tuple<size_t, size_t>> waybar::modules::CpuUsage::parseCpuinfo(
     throw std::runtime_error("sysctl kern.cp_times failed");
   }
 #endif
-  std::vector<std::tuple<size_t, size_t>> cpuinfo;
+  times.idle.clear();
+  times.total.clear();
   for (int cpu = 0; cpu < ncpu + 1; cpu++) {
     pcp_time_t total = 0, *single_cp_time = &cp_time[cpu * CPUSTATES];
     for (int state = 0; state < CPUSTATES; state++) {
       total += single_cp_time[state];
     }
-    cpuinfo.emplace_back(single_cp_time[CP_IDLE], total);
+    times.idle.push_back(single_cp_time[CP_IDLE]);
+    times.total.push_back(total);
   }
-  return cpuinfo;
 }
@@ -1,5 +1,10 @@
 #include "modules/cpu_usage.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <string_view>
+
 // In the 80000 version of fmt library authors decided to optimize imports
 // and moved declarations required for fmt::dynamic_format_arg_store in new
 // header fmt/args.h
@@ -10,16 +15,20 @@
 #endif
 
 waybar::modules::CpuUsage::CpuUsage(const std::string& id, const Json::Value& config)
-    : ALabel(config, "cpu_usage", id, "{usage}%", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+    : ALabel(config, "cpu_usage", id, "{usage}%", 10), sample_(sharedSample(interval_)) {
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::CpuUsage::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::CpuUsage::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [cpu_usage, tooltip] = CpuUsage::getCpuUsage(prev_times_);
+  auto sample = sample_->sample(CpuUsage::readSample);
+  const auto& cpu_usage = sample->usage;
+  const auto& tooltip = sample->tooltip;
   if (tooltipEnabled()) {
     label_.set_tooltip_text(tooltip);
   }
@@ -38,12 +47,21 @@ auto waybar::modules::CpuUsage::update() -> void {
     fmt::dynamic_format_arg_store<fmt::format_context> store;
     store.push_back(fmt::arg("usage", total_usage));
     store.push_back(fmt::arg("icon", getIcon(total_usage, icons)));
-    for (size_t i = 1; i < cpu_usage.size(); ++i) {
-      auto core_i = i - 1;
-      auto core_format = fmt::format("usage{}", core_i);
-      store.push_back(fmt::arg(core_format.c_str(), cpu_usage[i]));
-      auto icon_format = fmt::format("icon{}", core_i);
-      store.push_back(fmt::arg(icon_format.c_str(), getIcon(cpu_usage[i], icons)));
+    if (CpuUsage::hasPerCoreArgs(format)) {
+      for (size_t i = 1; i < cpu_usage.size(); ++i) {
+        auto core_i = i - 1;
+        auto core_format = fmt::format("usage{}", core_i);
+        store.push_back(fmt::arg(core_format.c_str(), cpu_usage[i]));
+        auto icon_format = fmt::format("icon{}", core_i);
+        store.push_back(fmt::arg(icon_format.c_str(), getIcon(cpu_usage[i], icons)));
+      }
+    }
+    if (format.find("{icons") != std::string::npos) {
+      std::string all_icons;
+      for (size_t i = 1; i < cpu_usage.size(); ++i) {
+        all_icons += getIcon(cpu_usage[i], icons);
+      }
+      store.push_back(fmt::arg("icons", all_icons));
     }
     label_.set_markup(fmt::vformat(format, store));
   }
@@ -52,55 +70,99 @@ auto waybar::modules::CpuUsage::update() -> void {
   ALabel::update();
 }
 
+namespace {
+
+uint16_t busyPercent(size_t delta_idle, size_t delta_total) {
+  if (delta_total == 0) {
+    return 0;
+  }
+  return 100 * (1 - static_cast<float>(delta_idle) / static_cast<float>(delta_total));
+}
+
+}  // namespace
+
 std::tuple<std::vector<uint16_t>, std::string> waybar::modules::CpuUsage::getCpuUsage(
-    std::vector<std::tuple<size_t, size_t>>& prev_times) {
-  if (prev_times.empty()) {
-    prev_times = CpuUsage::parseCpuinfo();
+    Times& prev_times) {
+  if (prev_times.idle.empty()) {
+    CpuUsage::parseCpuinfo(prev_times);
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
-  std::vector<std::tuple<size_t, size_t>> curr_times = CpuUsage::parseCpuinfo();
+  // swapped with prev_times at the end, so both keep their capacity between samples
+  thread_local Times curr_times;
+  CpuUsage::parseCpuinfo(curr_times);
   std::string tooltip;
   std::vector<uint16_t> usage;
 
-  if (curr_times.size() != prev_times.size()) {
+  if (curr_times.idle.size() != prev_times.idle.size() || curr_times.idle.empty()) {
     // The number of CPUs has changed, eg. due to CPU hotplug
     // We don't know which CPU came up or went down
     // so only give total usage (if we can)
-    if (!curr_times.empty() && !prev_times.empty()) {
-      auto [curr_idle, curr_total] = curr_times[0];
-      auto [prev_idle, prev_total] = prev_times[0];
-      const float delta_idle = curr_idle - prev_idle;
-      const float delta_total = curr_total - prev_total;
-      uint16_t tmp = 100 * (1 - delta_idle / delta_total);
+    if (!curr_times.idle.empty() && !prev_times.idle.empty()) {
+      uint16_t tmp = busyPercent(curr_times.idle[0] - prev_times.idle[0],
+                                 curr_times.total[0] - prev_times.total[0]);
       tooltip = fmt::format("Total: {}%\nCores: (pending)", tmp);
       usage.push_back(tmp);
     } else {
       tooltip = "(pending)";
       usage.push_back(0);
     }
-    prev_times = curr_times;
+    std::swap(prev_times, curr_times);
     return {usage, tooltip};
   }
 
-  for (size_t i = 0; i < curr_times.size(); ++i) {
-    auto [curr_idle, curr_total] = curr_times[i];
-    auto [prev_idle, prev_total] = prev_times[i];
-    if (i > 0 && (curr_total == 0 || prev_total == 0)) {
+  const size_t count = curr_times.idle.size();
+  const size_t* curr_idle = curr_times.idle.data();
+  const size_t* curr_total = curr_times.total.data();
+  const size_t* prev_idle = prev_times.idle.data();
+  const size_t* prev_total = prev_times.total.data();
+  usage.resize(count);
+  usage[0] = busyPercent(curr_idle[0] - prev_idle[0], curr_total[0] - prev_total[0]);
+  // Per core: 32-bit deltas and no branches, so the loop vectorizes on machines with hundreds
+  // of cores. A jiffy counter won't move by 2^31 within one interval.
+  for (size_t i = 1; i < count; ++i) {
+    const auto delta_idle = static_cast<int32_t>(curr_idle[i] - prev_idle[i]);
+    const auto delta_total = static_cast<int32_t>(curr_total[i] - prev_total[i]);
+    const float busy =
+        1.f - static_cast<float>(delta_idle) / static_cast<float>(std::max(delta_total, 1));
+    usage[i] = static_cast<uint16_t>((delta_total > 0) * static_cast<int32_t>(100.f * busy));
+  }
+
+  tooltip.reserve(16 * count);
+  fmt::format_to(std::back_inserter(tooltip), "Total: {}%", usage[0]);
+  for (size_t i = 1; i < count; ++i) {
+    if (curr_total[i] == 0 || prev_total[i] == 0) {
       // This CPU is offline
-      tooltip = tooltip + fmt::format("\nCore{}: offline", i - 1);
-      usage.push_back(0);
-      continue;
-    }
-    const float delta_idle = curr_idle - prev_idle;
-    const float delta_total = curr_total - prev_total;
-    uint16_t tmp = 100 * (1 - delta_idle / delta_total);
-    if (i == 0) {
-      tooltip = fmt::format("Total: {}%", tmp);
+      usage[i] = 0;
+      fmt::format_to(std::back_inserter(tooltip), "\nCore{}: offline", i - 1);
     } else {
-      tooltip = tooltip + fmt::format("\nCore{}: {}%", i - 1, tmp);
+      fmt::format_to(std::back_inserter(tooltip), "\nCore{}: {}%", i - 1, usage[i]);
     }
-    usage.push_back(tmp);
   }
-  prev_times = curr_times;
+  std::swap(prev_times, curr_times);
   return {usage, tooltip};
 }
+
+bool waybar::modules::CpuUsage::hasPerCoreArgs(const std::string& format) {
+  for (std::string_view name : {"usage", "icon"}) {
+    for (auto pos = format.find(name); pos != std::string::npos; pos = format.find(name, pos + 1)) {
+      const auto next = pos + name.size();
+      if (next < format.size() && std::isdigit(static_cast<unsigned char>(format[next]))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<waybar::util::SharedSample<waybar::modules::CpuUsage::Sample>>
+waybar::modules::CpuUsage::sharedSample(std::chrono::milliseconds interval) {
+  return util::SharedSample<Sample>::get("cpu_usage", interval);
+}
+
+waybar::modules::CpuUsage::Sample waybar::modules::CpuUsage::readSample(const Sample* previous) {
+  Sample sample;
+  // Only readSample touches the times, under the lock of the shared sample
+  sample.times = previous != nullptr ? previous->times : std::make_shared<Times>();
+  std::tie(sample.usage, sample.tooltip) = getCpuUsage(*sample.times);
+  return sample;
+}
@@ -1,66 +1,85 @@
-#include <filesystem>
+#include <mutex>
 
 #include "modules/cpu_usage.hpp"
+#include "util/proc_file.hpp"
 
-std::vector<std::tuple<size_t, size_t>> waybar::modules::CpuUsage::parseCpuinfo() {
+namespace {
+
+// Highest CPU number in /sys/devices/system/cpu/present, 0 if it can't be read
+size_t readCpuPresentLast() {
   // Get the "existing CPU count" from /sys/devices/system/cpu/present
   // Probably this is what the user wants the offline CPUs accounted from
   // For further details see:
   // https://www.kernel.org/doc/html/latest/core-api/cpu_hotplug.html
-  const std::string sys_cpu_present_path = "/sys/devices/system/cpu/present";
+  static waybar::util::ProcFile cpu_present_file{"/sys/devices/system/cpu/present"};
   size_t cpu_present_last = 0;
-  std::ifstream cpu_present_file(sys_cpu_present_path);
-  std::string cpu_present_text;
-  if (cpu_present_file.is_open()) {
-    getline(cpu_present_file, cpu_present_text);
+  if (auto cpu_present_text = cpu_present_file.tryRead()) {
     // This is a comma-separated list of ranges, eg. 0,2-4,7
-    size_t last_separator = cpu_present_text.find_last_of("-,");
-    if (last_separator < cpu_present_text.size()) {
-      std::stringstream(cpu_present_text.substr(last_separator + 1)) >> cpu_present_last;
+    size_t last_separator = cpu_present_text->find_last_of("-,");
+    if (last_separator != std::string_view::npos) {
+      cpu_present_text->remove_prefix(last_separator + 1);
     }
+    waybar::util::nextNumber(*cpu_present_text, cpu_present_last);
   }
+  return cpu_present_last;
+}
 
-  const std::string data_dir_ = "/proc/stat";
-  std::ifstream info(data_dir_);
-  if (!info.is_open()) {
-    throw std::runtime_error("Can't open " + data_dir_);
-  }
-  std::vector<std::tuple<size_t, size_t>> cpuinfo;
-  std::string line;
-  size_t current_cpu_number = -1;  // First line is total, second line is cpu 0
-  while (getline(info, line)) {
-    if (line.substr(0, 3).compare("cpu") != 0) {
-      break;
-    }
-    size_t line_cpu_number;
-    if (current_cpu_number >= 0) {
-      std::stringstream(line.substr(3)) >> line_cpu_number;
-      while (line_cpu_number > current_cpu_number) {
+}  // namespace
+
+void waybar::modules::CpuUsage::parseCpuinfo(Times& times) {
+  static std::mutex mutex;
+  static util::ProcFile info{"/proc/stat"};
+  // The present CPUs only change on hotplug, which also changes the CPU lines of /proc/stat
+  static size_t cpu_lines_seen = 0;
+  static size_t cpu_present_last = 0;
+
+  std::lock_guard lock(mutex);
+  auto data = info.read();
+  times.idle.clear();
+  times.total.clear();
+
+  size_t next_cpu_number = 0;
+  for (bool first = true; data.starts_with("cpu"); first = false) {
+    auto line = data.substr(0, data.find('\n'));
+    data.remove_prefix(std::min(line.size() + 1, data.size()));
+    line.remove_prefix(3);
+
+    // First line is total, second line is cpu 0
+    if (!first) {
+      size_t line_cpu_number = 0;
+      util::nextNumber(line, line_cpu_number);
+      for (; next_cpu_number < line_cpu_number; ++next_cpu_number) {
         // Fill in 0 for offline CPUs missing inside the lines of /proc/stat
-        cpuinfo.emplace_back(0, 0);
-        current_cpu_number++;
+        times.idle.push_back(0);
+        times.total.push_back(0);
       }
+      ++next_cpu_number;
     }
-    std::stringstream sline(line.substr(5));
-    std::vector<size_t> times;
-    for (size_t time = 0; sline >> time; times.push_back(time));
 
     size_t idle_time = 0;
     size_t total_time = 0;
-    if (times.size() >= 5) {
+    size_t fields = 0;
+    for (size_t time; util::nextNumber(line, time); ++fields) {
       // idle + iowait
-      idle_time = times[3] + times[4];
-      total_time = std::accumulate(times.begin(), times.end(), 0);
+      if (fields == 3 || fields == 4) {
+        idle_time += time;
+      }
+      total_time += time;
     }
-    cpuinfo.emplace_back(idle_time, total_time);
-    current_cpu_number++;
+    if (fields < 5) {
+      idle_time = total_time = 0;
+    }
+    times.idle.push_back(idle_time);
+    times.total.push_back(total_time);
   }
 
-  while (cpu_present_last >= current_cpu_number) {
+  if (next_cpu_number != cpu_lines_seen) {
+    cpu_lines_seen = next_cpu_number;
+    cpu_present_last = readCpuPresentLast();
+  }
+  for (; cpu_present_last >= next_cpu_number; ++next_cpu_number) {
     // Fill in 0 for offline CPUs missing after the lines of /proc/stat
-    cpuinfo.emplace_back(0, 0);
-    current_cpu_number++;
+    times.idle.push_back(0);
+    times.total.push_back(0);
   }
-
-  return cpuinfo;
 }
@@ -2,7 +2,12 @@
 
 #include <spdlog/spdlog.h>
 
-#include "util/scope_guard.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "util/scheduler.hpp"
 
 waybar::modules::Custom::Custom(const std::string& name, const std::string& id,
                                 const Json::Value& config, const std::string& output_name)
@@ -11,24 +16,56 @@ waybar::modules::Custom::Custom(const std::string& name, const std::string& id,
       output_name_(output_name),
       id_(id),
       tooltip_format_enabled_{config_["tooltip-format"].isString()},
+      exec_timeout_{config_["exec-timeout"].isNumeric()
+                        ? static_cast<long>(config_["exec-timeout"].asDouble() * 1000)
+                        : 0},
+      persistent_{config_["exec-persistent"].isBool() && config_["exec-persistent"].asBool()},
       percentage_(0),
       fp_(nullptr),
-      pid_(-1) {
+      pid_(-1),
+      coproc_in_(-1) {
   if (config.isNull()) {
     spdlog::warn("There is no configuration for 'custom/{}', element will be hidden", name);
   }
+  if (config_["resume"].isString()) {
+    if (auto wake = util::parseResumeWake(config_["resume"].asString())) {
+      thread_.setResumeWake(*wake);
+    } else {
+      spdlog::warn("custom/{}: unknown resume '{}'", name, config_["resume"].asString());
+    }
+  }
   dp.emit();
-  if (!config_["signal"].empty() && config_["interval"].empty() &&
+  if (config_["watch"].isString()) {
+    watchWorker();
+  } else if (!config_["signal"].empty() && config_["interval"].empty() &&
       config_["restart-interval"].empty()) {
     waitingWorker();
   } else if (interval_.count() > 0) {
+    // The same commands on the same interval, as on each output of a bar, run once per tick.
+    // Unless the output name is used: a script might use it without the command mentioning it.
+    const bool per_output =
+        (config_["exec-per-output"].isBool() && config_["exec-per-output"].asBool()) ||
+        config_["exec"].asString().find("WAYBAR_OUTPUT_NAME") != std::string::npos;
+    if (!persistent_ && !per_output) {
+      shared_exec_ = util::SharedSample<util::command::res>::get(
+          util::SharedSample<util::command::res>::sourceOf(
+              "custom", config_, {"exec", "exec-if", "exec-direct", "exec-timeout"}),
+          interval_);
+    }
     delayWorker();
   } else if (config_["exec"].isString()) {
+    streaming_ = config_["return-type"].asString() == "json";
     continuousWorker();
   }
 }
 
 waybar::modules::Custom::~Custom() {
+  // The worker first: it may be reading the script, or starting it again
+  thread_.stop();
+  thread_.join();
+  if (coproc_in_ != -1) {
+    close(coproc_in_);
+  }
   if (pid_ != -1) {
     killpg(pid_, SIGTERM);
     waitpid(pid_, NULL, 0);
@@ -38,63 +75,82 @@ waybar::modules::Custom::~Custom() {
 
 void waybar::modules::Custom::delayWorker() {
   thread_ = [this] {
-    for (int i : this->pid_children_) {
-      int status;
-      waitpid(i, &status, 0);
-    }
-
-    this->pid_children_.clear();
+    // The state the clicks' commands change is shown right away
+    action_runner_.waitForChildren();
 
-    bool can_update = true;
-    if (config_["exec-if"].isString()) {
-      output_ = util::command::execNoRead(config_["exec-if"].asString());
-      if (output_.exit_code != 0) {
-        can_update = false;
-        dp.emit();
-      }
-    }
-    if (can_update) {
-      if (config_["exec"].isString()) {
-        output_ = util::command::exec(config_["exec"].asString(), output_name_);
-      }
-      dp.emit();
+    if (shared_exec_) {
+      output_ = *shared_exec_->sample([this](const util::command::res*) { return runExec(); });
+    } else {
+      output_ = runExec();
     }
-    thread_.sleep_for(interval_);
+    dp.emit();
+    thread_.sleep_for(util::Scheduler::inst().currentPeriod(interval_, interval_on_battery_));
   };
 }
 
+waybar::util::command::res waybar::modules::Custom::runExec() {
+  util::command::res output{0, ""};
+  if (config_["exec-if"].isString()) {
+    output = util::command::execNoRead(config_["exec-if"].asString(), execDirect_, exec_timeout_,
+                                       thread_.stopFd());
+    if (output.exit_code != 0) {
+      return output;
+    }
+  }
+  if (config_["exec"].isString()) {
+    output = persistent_ ? tickCoprocess()
+                         : util::command::exec(config_["exec"].asString(), output_name_,
+                                               execDirect_, exec_timeout_, thread_.stopFd());
+  }
+  return output;
+}
+
 void waybar::modules::Custom::continuousWorker() {
   auto cmd = config_["exec"].asString();
   pid_ = -1;
-  fp_ = util::command::open(cmd, pid_, output_name_);
+  fp_ = util::command::open(cmd, pid_, output_name_, execDirect_);
   if (!fp_) {
     throw std::runtime_error("Unable to open " + cmd);
   }
   thread_ = [this, cmd] {
-    char* buff = nullptr;
-    waybar::util::ScopeGuard buff_deleter([&buff]() {
-      if (buff) {
-        free(buff);
-      }
-    });
-    size_t len = 0;
-    if (getline(&buff, &len, fp_) == -1) {
+    std::string line;
+    bool read = util::command::readLine(fileno(fp_), pending_, line,
+                                        std::chrono::milliseconds::zero(), thread_.stopFd());
+    if (!thread_.isRunning()) {
+      return;  // the destructor ends the script
+    }
+    if (!read && !pending_.empty()) {
+      line = std::exchange(pending_, {});  // a last line without its newline
+      read = true;
+    }
+    if (!read) {
       int exit_code = 1;
       if (fp_) {
         exit_code = WEXITSTATUS(util::command::close(fp_, pid_));
         fp_ = nullptr;
       }
       if (exit_code != 0) {
-        output_ = {exit_code, ""};
+        if (streaming_) {
+          std::lock_guard lock(streamed_.mutex);
+          streamed_.exit_code = exit_code;
+          streamed_.shown = false;
+          streamed_.fresh = true;
+        } else {
+          output_ = {exit_code, ""};
+        }
         dp.emit();
         spdlog::error("{} stopped unexpectedly, is it endless?", name_);
       }
       if (config_["restart-interval"].isNumeric()) {
         pid_ = -1;
+        pending_.clear();
         thread_.sleep_for(std::chrono::milliseconds(
             std::max(1L,  // Minimum 1ms due to millisecond precision
                      static_cast<long>(config_["restart-interval"].asDouble() * 1000))));
-        fp_ = util::command::open(cmd, pid_, output_name_);
+        if (!thread_.isRunning()) {
+          return;
+        }
+        fp_ = util::command::open(cmd, pid_, output_name_, execDirect_);
         if (!fp_) {
           throw std::runtime_error("Unable to open " + cmd);
         }
@@ -102,14 +158,28 @@ void waybar::modules::Custom::continuousWorker() {
         thread_.stop();
         return;
       }
-    } else {
-      std::string output = buff;
-
-      // Remove last newline
-      if (!output.empty() && output[output.length() - 1] == '\n') {
-        output.erase(output.length() - 1);
+    } else if (streaming_) {
+      JsonOutput json;
+      try {
+        json = parseJsonLine(line);
+      } catch (const std::exception& e) {
+        spdlog::error("{}: {}", name_, e.what());
+        return;
+      }
+      bool emit;
+      {
+        std::lock_guard lock(streamed_.mutex);
+        streamed_.json = std::move(json);
+        streamed_.exit_code = 0;
+        streamed_.shown = true;
+        emit = !std::exchange(streamed_.fresh, true);
       }
-      output_ = {0, output};
+      // an update is already on its way otherwise, and will show this line
+      if (emit) {
+        dp.emit();
+      }
+    } else {
+      output_ = {0, std::move(line)};
       dp.emit();
     }
   };
@@ -117,26 +187,83 @@ void waybar::modules::Custom::continuousWorker() {
 
 void waybar::modules::Custom::waitingWorker() {
   thread_ = [this] {
-    bool can_update = true;
-    if (config_["exec-if"].isString()) {
-      output_ = util::command::execNoRead(config_["exec-if"].asString());
-      if (output_.exit_code != 0) {
-        can_update = false;
-        dp.emit();
-      }
+    output_ = runExec();
+    dp.emit();
+    thread_.sleep();
+  };
+}
+
+void waybar::modules::Custom::watchWorker() {
+  watch_ = std::make_unique<util::FileWatch>(config_["watch"].asString(),
+                                             [this] { thread_.wake_up(); });
+  thread_ = [this] {
+    action_runner_.waitForChildren();
+    if (config_["exec"].isString() || config_["exec-if"].isString()) {
+      output_ = runExec();
+    } else {
+      output_ = readWatched();
     }
-    if (can_update) {
-      if (config_["exec"].isString()) {
-        output_ = util::command::exec(config_["exec"].asString(), output_name_);
-      }
-      dp.emit();
+    dp.emit();
+    // the file changing is what updates it, an interval only comes on top
+    if (interval_.count() > 0) {
+      thread_.sleep_for(util::Scheduler::inst().currentPeriod(interval_, interval_on_battery_));
+    } else {
+      thread_.sleep();
     }
-    thread_.sleep();
   };
 }
 
+// Read again on every change: an atomic save replaces the file, an open one would go stale
+waybar::util::command::res waybar::modules::Custom::readWatched() {
+  std::ifstream file(watch_->path(), std::ios::binary);
+  if (!file) {
+    return {1, ""};
+  }
+  std::string contents(MAX_WATCHED_SIZE, '\0');
+  file.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+  contents.resize(file.gcount());
+  if (contents.ends_with('\n')) {
+    contents.pop_back();
+  }
+  return {0, std::move(contents)};
+}
+
+waybar::util::command::res waybar::modules::Custom::tickCoprocess() {
+  if (fp_ == nullptr) {
+    fp_ = util::command::open(config_["exec"].asString(), pid_, output_name_, execDirect_,
+                              &coproc_in_);
+    if (fp_ == nullptr) {
+      return {-1, ""};
+    }
+  }
+  std::string reply;
+  if (send(coproc_in_, "\n", 1, MSG_NOSIGNAL) == 1 &&
+      util::command::readLine(fileno(fp_), pending_, reply, exec_timeout_, thread_.stopFd())) {
+    return {0, reply};
+  }
+  if (!thread_.isRunning()) {
+    return {0, ""};  // the destructor ends it
+  }
+  spdlog::error("{} stopped replying, restarting it on the next tick", name_);
+  return {stopCoprocess(), ""};
+}
+
+int waybar::modules::Custom::stopCoprocess() {
+  close(coproc_in_);
+  coproc_in_ = -1;
+  pending_.clear();
+  // a co-process that is stuck would never exit by itself
+  killpg(pid_, SIGKILL);
+  const int stat = util::command::close(fp_, pid_);
+  fp_ = nullptr;
+  pid_ = -1;
+  const int exit_code = util::command::exitCode(stat);
+  // a clean exit still leaves nothing to show
+  return exit_code != 0 ? exit_code : 1;
+}
+
 void waybar::modules::Custom::refresh(int sig) {
-  if (sig == SIGRTMIN + config_["signal"].asInt()) {
+  if (sig == refreshSignal_) {
     thread_.wake_up();
   }
 }
@@ -159,16 +286,28 @@ bool waybar::modules::Custom::handleToggle(GdkEventButton* const& e) {
   return ret;
 }
 
+auto waybar::modules::Custom::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  // a continuous script keeps streaming, only the lines it writes meanwhile are held back
+  if (interval_.count() > 0) {
+    thread_.pause(paused);
+  }
+}
+
 auto waybar::modules::Custom::update() -> void {
   // Hide label if output is empty
-  if ((config_["exec"].isString() || config_["exec-if"].isString()) &&
-      (output_.out.empty() || output_.exit_code != 0)) {
+  if (streaming_ ? !takeStreamed()
+                 : (config_["exec"].isString() || config_["exec-if"].isString() || watch_) &&
+                       (output_.out.empty() || output_.exit_code != 0)) {
     event_box_.hide();
   } else {
-    if (config_["return-type"].asString() == "json") {
-      parseOutputJson();
-    } else {
-      parseOutputRaw();
+    // streamed output was parsed by the worker
+    if (!streaming_) {
+      if (config_["return-type"].asString() == "json") {
+        parseOutputJson();
+      } else {
+        parseOutputRaw();
+      }
     }
 
     try {
@@ -196,15 +335,8 @@ auto waybar::modules::Custom::update() -> void {
             }
           }
         }
+        output_classes_.set(class_);
         auto style = label_.get_style_context();
-        auto classes = style->list_classes();
-        for (auto const& c : classes) {
-          if (c == id_) continue;
-          style->remove_class(c);
-        }
-        for (auto const& c : class_) {
-          style->add_class(c);
-        }
         style->add_class("flat");
         style->add_class("text-button");
         style->add_class(MODULE_CLASS);
@@ -219,6 +351,10 @@ auto waybar::modules::Custom::update() -> void {
           "try replacing \"{}\" with \"{text}\" in your format specifier");
     }
   }
+  if (publishesState()) {
+    state_fields_["alt"] = alt_;
+    state_fields_["percentage"] = percentage_;
+  }
   // Call parent update
   ALabel::update();
 }
@@ -259,38 +395,69 @@ void waybar::modules::Custom::parseOutputRaw() {
 }
 
 void waybar::modules::Custom::parseOutputJson() {
-  std::istringstream output(output_.out);
-  std::string line;
-  class_.clear();
-  while (getline(output, line)) {
-    auto parsed = parser_.parse(line);
-    if (config_["escape"].isBool() && config_["escape"].asBool()) {
-      text_ = Glib::Markup::escape_text(parsed["text"].asString());
-    } else {
-      text_ = parsed["text"].asString();
-    }
-    if (config_["escape"].isBool() && config_["escape"].asBool()) {
-      alt_ = Glib::Markup::escape_text(parsed["alt"].asString());
-    } else {
-      alt_ = parsed["alt"].asString();
-    }
-    if (config_["escape"].isBool() && config_["escape"].asBool()) {
-      tooltip_ = Glib::Markup::escape_text(parsed["tooltip"].asString());
+  std::string_view output = output_.out;
+  // a watched file is one document, it may well be pretty-printed
+  applyJson(parseJsonLine(watch_ ? output : output.substr(0, output.find('\n'))));
+}
+
+waybar::modules::Custom::JsonOutput waybar::modules::Custom::parseJsonLine(std::string_view line) {
+  JsonOutput json;
+  // values that aren't strings are converted like Json::Value::asString() does
+  auto parseText = [this](std::string& out) {
+    if (scanner_.peek() == '"') {
+      scanner_.parseString(out);
     } else {
-      tooltip_ = parsed["tooltip"].asString();
+      Json::Value value;
+      scanner_.parseValue(value);
+      out = value.asString();
     }
-    if (parsed["class"].isString()) {
-      class_.push_back(parsed["class"].asString());
-    } else if (parsed["class"].isArray()) {
-      for (auto const& c : parsed["class"]) {
-        class_.push_back(c.asString());
+  };
+  scanner_.reset(line);
+  scanner_.parseObject([&](std::string_view key) {
+    if (key == "text") {
+      parseText(json.text);
+    } else if (key == "alt") {
+      parseText(json.alt);
+    } else if (key == "tooltip") {
+      parseText(json.tooltip);
+    } else if (key == "class") {
+      json.classes.clear();
+      if (scanner_.peek() == '"') {
+        scanner_.parseString(json.classes.emplace_back());
+      } else if (scanner_.peek() == '[') {
+        scanner_.parseArray([&] { parseText(json.classes.emplace_back()); });
+      } else {
+        scanner_.skipValue();
       }
-    }
-    if (!parsed["percentage"].asString().empty() && parsed["percentage"].isNumeric()) {
-      percentage_ = (int)lround(parsed["percentage"].asFloat());
+    } else if (key == "percentage") {
+      Json::Value value;
+      scanner_.parseValue(value);
+      json.percentage = value.isNumeric() ? (int)lround(value.asFloat()) : 0;
     } else {
-      percentage_ = 0;
+      scanner_.skipValue();
     }
-    break;
+  });
+  // anything after the object is ignored, as jsoncpp did
+  if (config_["escape"].isBool() && config_["escape"].asBool()) {
+    json.text = Glib::Markup::escape_text(json.text);
+    json.alt = Glib::Markup::escape_text(json.alt);
+    json.tooltip = Glib::Markup::escape_text(json.tooltip);
+  }
+  return json;
+}
+
+void waybar::modules::Custom::applyJson(JsonOutput&& json) {
+  text_ = std::move(json.text);
+  alt_ = std::move(json.alt);
+  tooltip_ = std::move(json.tooltip);
+  class_ = std::move(json.classes);
+  percentage_ = json.percentage;
+}
+
+bool waybar::modules::Custom::takeStreamed() {
+  std::lock_guard lock(streamed_.mutex);
+  if (std::exchange(streamed_.fresh, false) && streamed_.shown) {
+    applyJson(std::move(streamed_.json));
   }
+  return streamed_.shown && streamed_.exit_code == 0;
 }
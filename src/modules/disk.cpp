@@ -1,19 +1,227 @@
 #include "modules/disk.hpp"
 
+#include <fcntl.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/shared_instance.hpp"
+
 using namespace waybar::util;
 
+namespace waybar::modules {
+
+struct DiskMount {
+  explicit DiskMount(std::string path) : path{std::move(path)} {}
+
+  const std::string path;
+  // everything below is guarded by the sampler mutex
+  std::optional<struct statvfs> stats;  // empty when statvfs() failed
+  bool sampled = false;
+  bool inflight = false;  // queued or being sampled
+  std::chrono::steady_clock::time_point sampledAt;
+  std::vector<Disk*> modules;
+};
+
+}  // namespace waybar::modules
+
+namespace {
+
+using waybar::modules::Disk;
+using waybar::modules::DiskMount;
+
+/* Runs the statvfs() calls of every disk module on one worker thread, off the main loop. The
+ * modules of the same path, e.g. on several bars, share each result. A call stuck on a dead
+ * network mount is left behind: its mount is not sampled again until it returns, and the queue
+ * carries on on a fresh worker, so a hung mount holds one thread at most.
+ * On Linux a change of the mount table triggers a refresh of every path.
+ */
+class DiskSampler {
+ public:
+  static DiskSampler& inst() {
+    static auto* sampler = new DiskSampler();
+    return *sampler;
+  }
+
+  std::shared_ptr<DiskMount> add(Disk* module, const std::string& path) {
+    std::lock_guard lock(mutex_);
+    auto mount = mounts_.get(path, [&path] { return std::make_shared<DiskMount>(path); });
+    mount->modules.push_back(module);
+    startThreads();
+    return mount;
+  }
+
+  void remove(Disk* module, DiskMount& mount) {
+    std::lock_guard lock(mutex_);
+    std::erase(mount.modules, module);
+  }
+
+  // Samples the mount in the background, module is updated once the result is in
+  void request(Disk* module, const std::shared_ptr<DiskMount>& mount) {
+    std::lock_guard lock(mutex_);
+    checkWorker();
+    if (mount->inflight) {
+      return;  // every module of the mount gets the pending result
+    }
+    if (mount->sampled && std::chrono::steady_clock::now() - mount->sampledAt < MAX_AGE) {
+      module->dp.emit();
+      return;
+    }
+    enqueue(mount);
+  }
+
+  // The last result, nothing until the first one is in or if statvfs() failed
+  std::optional<struct statvfs> stats(const DiskMount& mount) {
+    std::lock_guard lock(mutex_);
+    return mount.stats;
+  }
+
+ private:
+  // Modules on the same tick request within a few milliseconds of each other
+  static constexpr std::chrono::milliseconds MAX_AGE{250};
+  // statvfs() on a local filesystem takes microseconds, a network mount that doesn't answer
+  // within this is considered hung
+  static constexpr std::chrono::seconds TIMEOUT{5};
+
+  DiskSampler() = default;
+
+  void startThreads() {
+    if (threadsStarted_) {
+      return;
+    }
+    threadsStarted_ = true;
+    std::thread([this, generation = generation_] { work(generation); }).detach();
+#if defined(__linux__)
+    std::thread([this] { watchMounts(); }).detach();
+#endif
+  }
+
+  void enqueue(const std::shared_ptr<DiskMount>& mount) {
+    mount->inflight = true;
+    queue_.push_back(mount);
+    cv_.notify_one();
+  }
+
+  // Replaces the worker if it is stuck in a call for too long
+  void checkWorker() {
+    if (!running_ || std::chrono::steady_clock::now() - runningSince_ < TIMEOUT) {
+      return;
+    }
+    spdlog::warn("disk: statvfs on {} has not returned for {}s, leaving it behind",
+                 running_->path, TIMEOUT.count());
+    running_.reset();
+    std::thread([this, generation = ++generation_] { work(generation); }).detach();
+  }
+
+  void work(uint64_t generation) {
+    std::unique_lock lock(mutex_);
+    while (generation == generation_) {
+      if (queue_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto mount = std::move(queue_.front());
+      queue_.pop_front();
+      running_ = mount;
+      runningSince_ = std::chrono::steady_clock::now();
+      lock.unlock();
+
+      struct statvfs buf;
+      const bool ok = statvfs(mount->path.c_str(), &buf) == 0;
+
+      lock.lock();
+      if (running_ == mount) {
+        running_.reset();
+      }
+      mount->stats = ok ? std::optional(buf) : std::nullopt;
+      mount->sampled = true;
+      mount->inflight = false;
+      mount->sampledAt = std::chrono::steady_clock::now();
+      for (auto* module : mount->modules) {
+        module->dp.emit();
+      }
+    }
+    // replaced while stuck in statvfs(), the new worker has the queue
+  }
+
+#if defined(__linux__)
+  // The kernel flags /proc/self/mountinfo with POLLPRI when the mount table changes
+  void watchMounts() {
+    const int fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      spdlog::warn("disk: can't watch the mount table, mounts are picked up on the next interval");
+      return;
+    }
+    std::array<char, 4096> buf;
+    while (true) {
+      // reading the file to the end acknowledges the change
+      while (read(fd, buf.data(), buf.size()) > 0) {
+      }
+      lseek(fd, 0, SEEK_SET);
+      struct pollfd pfd = {.fd = fd, .events = POLLPRI};
+      if (poll(&pfd, 1, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        spdlog::error("disk: polling the mount table failed: {}", strerror(errno));
+        close(fd);
+        return;
+      }
+      std::lock_guard lock(mutex_);
+      checkWorker();
+      mounts_.forEach([this](const std::shared_ptr<DiskMount>& mount) {
+        if (!mount->inflight) {
+          enqueue(mount);
+        }
+      });
+    }
+  }
+#endif
+
+  std::mutex mutex_;  // guards everything below and the mount states
+  std::condition_variable cv_;
+  SharedInstances<std::string, DiskMount> mounts_;
+  std::deque<std::shared_ptr<DiskMount>> queue_;
+  std::shared_ptr<DiskMount> running_;  // sampled by the current worker
+  std::chrono::steady_clock::time_point runningSince_;
+  uint64_t generation_ = 0;  // of the current worker, the others exit
+  bool threadsStarted_ = false;
+};
+
+}  // namespace
+
 waybar::modules::Disk::Disk(const std::string& id, const Json::Value& config)
     : ALabel(config, "disk", id, "{}%", 30), path_("/") {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
   if (config["path"].isString()) {
     path_ = config["path"].asString();
   }
   if (config["unit"].isString()) {
     unit_ = config["unit"].asString();
   }
+  mount_ = DiskSampler::inst().add(this, path_);
+  timer_.start(
+      interval_, [this] { DiskSampler::inst().request(this, mount_); }, interval_on_battery_);
+}
+
+waybar::modules::Disk::~Disk() {
+  timer_.stop();
+  DiskSampler::inst().remove(this, *mount_);
+}
+
+auto waybar::modules::Disk::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::Disk::update() -> void {
@@ -31,7 +239,7 @@ auto waybar::modules::Disk::update() -> void {
       unsigned long  f_namemax;  // maximum filename length
   }; */
       stats;
-  int err = statvfs(path_.c_str(), &stats);
+  auto sample = DiskSampler::inst().stats(*mount_);
 
   /* Conky options
     fs_bar - Bar that shows how much space is used
@@ -41,10 +249,11 @@ auto waybar::modules::Disk::update() -> void {
     fs_used - File system used space
   */
 
-  if (err != 0) {
+  if (!sample) {
     event_box_.hide();
     return;
   }
+  stats = *sample;
 
   float specific_free, specific_used, specific_total, divisor;
 
@@ -10,10 +10,6 @@
 #include "client.hpp"
 #include "dwl-ipc-unstable-v2-client-protocol.h"
 
-#define TAG_INACTIVE 0
-#define TAG_ACTIVE 1
-#define TAG_URGENT 2
-
 namespace waybar::modules::dwl {
 
 /* dwl stuff */
@@ -46,7 +42,7 @@ static void title(void *data, zdwl_ipc_output_v2 *zdwl_output_v2, const char *ti
 }
 
 static void dwl_frame(void *data, zdwl_ipc_output_v2 *zdwl_output_v2) {
-  // Intentionally empty
+  static_cast<Tags *>(data)->handle_frame();
 }
 
 static void set_layout(void *data, zdwl_ipc_output_v2 *zdwl_output_v2, uint32_t layout) {
@@ -179,31 +175,53 @@ bool Tags::handle_button_press(GdkEventButton *event_button, uint32_t tag) {
 }
 
 void Tags::handle_view_tags(uint32_t tag, uint32_t state, uint32_t clients, uint32_t focused) {
-  // First clear all occupied state
-  auto &button = buttons_[tag];
-  if (clients) {
-    button.get_style_context()->add_class("occupied");
-  } else {
-    button.get_style_context()->remove_class("occupied");
-  }
-
-  if (clients & TAG_INACTIVE) {
-    button.get_style_context()->remove_class("empty");
-  } else {
-    button.get_style_context()->add_class("empty");
-  }
-
-  if (state & TAG_ACTIVE) {
-    button.get_style_context()->add_class("focused");
-  } else {
-    button.get_style_context()->remove_class("focused");
-  }
+  if (tag >= 32) return;
+  const uint32_t bit = 1U << tag;
+  occupied_tags_ = clients ? occupied_tags_ | bit : occupied_tags_ & ~bit;
+  focused_tags_ = (state & ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE) ? focused_tags_ | bit
+                                                                 : focused_tags_ & ~bit;
+  urgent_tags_ = (state & ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT) ? urgent_tags_ | bit
+                                                                : urgent_tags_ & ~bit;
+}
 
-  if (state & TAG_URGENT) {
-    button.get_style_context()->add_class("urgent");
-  } else {
-    button.get_style_context()->remove_class("urgent");
+void Tags::handle_frame() {
+  // dwl sends every tag of the output before the frame, only the changed buttons are restyled
+  const uint32_t all = shown_ ? 0 : ~0U;
+  const uint32_t occupied = all | (occupied_tags_ ^ shown_occupied_tags_);
+  const uint32_t focused = all | (focused_tags_ ^ shown_focused_tags_);
+  const uint32_t urgent = all | (urgent_tags_ ^ shown_urgent_tags_);
+  for (size_t i = 0; i < buttons_.size(); ++i) {
+    const uint32_t tag = 1U << i;
+    if (((occupied | focused | urgent) & tag) == 0) {
+      continue;
+    }
+    auto ctx = buttons_[i].get_style_context();
+    if ((occupied & tag) != 0) {
+      if ((occupied_tags_ & tag) != 0) {
+        ctx->add_class("occupied");
+        ctx->remove_class("empty");
+      } else {
+        ctx->remove_class("occupied");
+        ctx->add_class("empty");
+      }
+    }
+    if ((focused & tag) != 0) {
+      if ((focused_tags_ & tag) != 0)
+        ctx->add_class("focused");
+      else
+        ctx->remove_class("focused");
+    }
+    if ((urgent & tag) != 0) {
+      if ((urgent_tags_ & tag) != 0)
+        ctx->add_class("urgent");
+      else
+        ctx->remove_class("urgent");
+    }
   }
+  shown_occupied_tags_ = occupied_tags_;
+  shown_focused_tags_ = focused_tags_;
+  shown_urgent_tags_ = urgent_tags_;
+  shown_ = true;
 }
 
 } /* namespace waybar::modules::dwl */
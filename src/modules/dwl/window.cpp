@@ -74,7 +74,9 @@ static const wl_registry_listener registry_listener_impl = {.global = handle_glo
                                                             .global_remove = handle_global_remove};
 
 Window::Window(const std::string &id, const Bar &bar, const Json::Value &config)
-    : AAppIconLabel(config, "window", id, "{}", 0, true), bar_(bar) {
+    : AAppIconLabel(config, "window", id, "{}", 0, true),
+      bar_(bar),
+      rewrite_(util::RewriteRules::shared(config["rewrite"])) {
   struct wl_display *display = Client::inst()->wl_display;
   struct wl_registry *registry = wl_display_get_registry(display);
 
@@ -98,25 +100,43 @@ Window::~Window() {
   }
 }
 
-void Window::handle_title(const char *title) { title_ = Glib::Markup::escape_text(title); }
+// dwl repeats the unchanged values in every frame of the output, those are skipped
+static bool assign_escaped(std::string &field, const char *text) {
+  auto escaped = Glib::Markup::escape_text(text);
+  if (field == escaped.raw()) return false;
+  field = escaped.raw();
+  return true;
+}
 
-void Window::handle_appid(const char *appid) { appid_ = Glib::Markup::escape_text(appid); }
+void Window::handle_title(const char *title) { label_dirty_ |= assign_escaped(title_, title); }
+
+void Window::handle_appid(const char *appid) {
+  if (assign_escaped(appid_, appid)) {
+    label_dirty_ = true;
+    icon_dirty_ = true;
+  }
+}
 
 void Window::handle_layout_symbol(const char *layout_symbol) {
-  layout_symbol_ = Glib::Markup::escape_text(layout_symbol);
+  label_dirty_ |= assign_escaped(layout_symbol_, layout_symbol);
 }
 
 void Window::handle_layout(const uint32_t layout) { layout_ = layout; }
 
 void Window::handle_frame() {
-  label_.set_markup(waybar::util::rewriteString(
-      fmt::format(fmt::runtime(format_), fmt::arg("title", title_),
-                  fmt::arg("layout", layout_symbol_), fmt::arg("app_id", appid_)),
-      config_["rewrite"]));
-  updateAppIconName(appid_, "");
-  updateAppIcon();
-  if (tooltipEnabled()) {
-    label_.set_tooltip_text(title_);
+  if (label_dirty_) {
+    label_.set_markup(rewrite_->apply(
+        fmt::format(fmt::runtime(format_), fmt::arg("title", title_),
+                    fmt::arg("layout", layout_symbol_), fmt::arg("app_id", appid_))));
+    if (tooltipEnabled()) {
+      label_.set_tooltip_text(title_);
+    }
+    label_dirty_ = false;
+  }
+  if (icon_dirty_) {
+    updateAppIconName(appid_, "");
+    updateAppIcon();
+    icon_dirty_ = false;
   }
 }
 
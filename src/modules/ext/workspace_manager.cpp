@@ -18,7 +18,6 @@ namespace waybar::modules::ext {
 
 uint32_t WorkspaceManager::group_global_id = 0;
 uint32_t WorkspaceManager::workspace_global_id = 0;
-std::map<std::string, std::string> Workspace::icon_map_;
 
 WorkspaceManager::WorkspaceManager(const std::string &id, const waybar::Bar &bar,
                                    const Json::Value &config)
@@ -53,6 +52,11 @@ WorkspaceManager::WorkspaceManager(const std::string &id, const waybar::Bar &bar
     all_outputs_ = config_all_outputs.asBool();
   }
 
+  const auto &format_icons = config_["format-icons"];
+  for (const auto &n : format_icons.getMemberNames()) {
+    icon_map_.emplace(n, format_icons[n].asString());
+  }
+
   // setup UI
 
   box_.set_name("workspaces");
@@ -118,6 +122,8 @@ void WorkspaceManager::remove_workspace(uint32_t id) {
     return;
   }
 
+  // its button leaves the box as it is destroyed
+  std::erase(shown_buttons_, &(*it)->button());
   workspaces_.erase(it);
 }
 
@@ -149,7 +155,6 @@ void WorkspaceManager::update() {
   spdlog::debug("[ext/workspaces]: Updating state");
 
   if (needs_sorting_) {
-    clear_buttons();
     sort_workspaces();
     needs_sorting_ = false;
   }
@@ -158,11 +163,6 @@ void WorkspaceManager::update() {
   AModule::update();
 }
 
-bool WorkspaceManager::has_button(const Gtk::Button *button) {
-  const auto buttons = box_.get_children();
-  return std::find(buttons.begin(), buttons.end(), button) != buttons.end();
-}
-
 void WorkspaceManager::sort_workspaces() {
   // determine if workspace ID's and names can be sort numerically or literally
 
@@ -217,19 +217,12 @@ void WorkspaceManager::sort_workspaces() {
   });
 }
 
-void WorkspaceManager::clear_buttons() {
-  for (const auto &workspace : workspaces_) {
-    if (has_button(&workspace->button())) {
-      box_.remove(workspace->button());
-    }
-  }
-}
-
 void WorkspaceManager::update_buttons() {
   const auto *output = gdk_wayland_monitor_get_wl_output(bar_.output->monitor->gobj());
 
-  // go through all workspace
+  // the workspaces on this bar, in order
 
+  std::vector<Workspace *> shown;
   for (const auto &workspace : workspaces_) {
     const bool workspace_on_any_group_for_output =
         std::any_of(groups_.begin(), groups_.end(), [&](const auto &group) {
@@ -237,24 +230,46 @@ void WorkspaceManager::update_buttons() {
           const bool workspace_on_group = group->has_workspace(workspace->handle());
           return group_on_output && workspace_on_group;
         });
-    const bool bar_contains_button = has_button(&workspace->button());
+    if (workspace_on_any_group_for_output) {
+      shown.push_back(workspace.get());
+    }
+  }
 
-    // add or remove buttons if needed, update button state
+  // remove buttons that left, add the new ones at the end
 
-    if (workspace_on_any_group_for_output) {
-      if (!bar_contains_button) {
-        // add button to bar
-        box_.pack_start(workspace->button(), false, false);
-        workspace->button().show_all();
-      }
-      workspace->update();
+  std::vector<Gtk::Button *> buttons;
+  for (auto *button : shown_buttons_) {
+    const bool kept = std::any_of(shown.begin(), shown.end(),
+                                  [button](auto *w) { return &w->button() == button; });
+    if (kept) {
+      buttons.push_back(button);
     } else {
-      if (bar_contains_button) {
-        // remove button from bar
-        box_.remove(workspace->button());
-      }
+      box_.remove(*button);
+    }
+  }
+  for (auto *workspace : shown) {
+    auto *button = &workspace->button();
+    if (std::find(buttons.begin(), buttons.end(), button) == buttons.end()) {
+      box_.pack_start(*button, false, false);
+      button->show_all();
+      // show_all() undid its visibility
+      workspace->set_needs_update();
+      buttons.push_back(button);
+    }
+    workspace->update();
+  }
+
+  // move only the buttons that are out of place
+
+  for (size_t i = 0; i < shown.size(); ++i) {
+    auto *button = &shown[i]->button();
+    if (buttons[i] != button) {
+      const auto it = std::find(buttons.begin() + i, buttons.end(), button);
+      std::rotate(buttons.begin() + i, it, it + 1);
+      box_.reorder_child(*button, i);
     }
   }
+  shown_buttons_ = std::move(buttons);
 }
 
 // WorkspaceGroup
@@ -336,13 +351,6 @@ Workspace::Workspace(const Json::Value &config, WorkspaceManager &manager,
   format_ = config_format.isString() ? config_format.asString() : "{name}";
   with_icon_ = format_.find("{icon}") != std::string::npos;
 
-  if (with_icon_ && icon_map_.empty()) {
-    const auto &format_icons = config["format-icons"];
-    for (auto &n : format_icons.getMemberNames()) {
-      icon_map_.emplace(n, format_icons[n].asString());
-    }
-  }
-
   const bool config_on_click = config["on-click"].isString();
   if (config_on_click) {
     on_click_action_ = config["on-click"].asString();
@@ -377,6 +385,11 @@ Workspace::~Workspace() {
 }
 
 void Workspace::update() {
+  if (!needs_update_) {
+    return;
+  }
+  needs_update_ = false;
+
   const auto style_context = button_.get_style_context();
 
   // update style and visibility
@@ -416,12 +429,14 @@ void Workspace::update() {
 void Workspace::handle_id(const std::string &id) {
   spdlog::debug("[ext/workspaces]:     ID for workspace {}: {}", id_, id);
   workspace_id_ = id;
+  needs_update_ = true;
   workspace_manager_.set_needs_sorting();
 }
 
 void Workspace::handle_name(const std::string &name) {
   spdlog::debug("[ext/workspaces]:     Name for workspace {}: {}", id_, name);
   name_ = name;
+  needs_update_ = true;
   workspace_manager_.set_needs_sorting();
 }
 
@@ -430,7 +445,10 @@ void Workspace::handle_coordinates(const std::vector<uint32_t> &coordinates) {
   workspace_manager_.set_needs_sorting();
 }
 
-void Workspace::handle_state(uint32_t state) { state_ = state; }
+void Workspace::handle_state(uint32_t state) {
+  needs_update_ |= state != state_;
+  state_ = state;
+}
 
 void Workspace::handle_capabilities(uint32_t capabilities) {
   spdlog::debug("[ext/workspaces]:     Capabilities for workspace {}:", id_);
@@ -481,20 +499,21 @@ bool Workspace::handle_clicked(const GdkEventButton *button) const {
 }
 
 std::string Workspace::icon() {
+  const auto &icon_map = workspace_manager_.icon_map();
   if (has_state(EXT_WORKSPACE_HANDLE_V1_STATE_ACTIVE)) {
-    const auto active_icon_it = icon_map_.find("active");
-    if (active_icon_it != icon_map_.end()) {
+    const auto active_icon_it = icon_map.find("active");
+    if (active_icon_it != icon_map.end()) {
       return active_icon_it->second;
     }
   }
 
-  const auto named_icon_it = icon_map_.find(name_);
-  if (named_icon_it != icon_map_.end()) {
+  const auto named_icon_it = icon_map.find(name_);
+  if (named_icon_it != icon_map.end()) {
     return named_icon_it->second;
   }
 
-  const auto default_icon_it = icon_map_.find("default");
-  if (default_icon_it != icon_map_.end()) {
+  const auto default_icon_it = icon_map.find("default");
+  if (default_icon_it != icon_map.end()) {
     return default_icon_it->second;
   }
 
@@ -3,6 +3,7 @@
 #include <fmt/core.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <string>
@@ -84,24 +85,14 @@ Gamemode::Gamemode(const std::string& id, const Json::Value& config)
       sigc::mem_fun(*this, &Gamemode::disappear),
       Gio::DBus::BusNameWatcherFlags::BUS_NAME_WATCHER_FLAGS_AUTO_START);
 
-  // Connect to gamemode
-  gamemode_proxy = Gio::DBus::Proxy::create_for_bus_sync(Gio::DBus::BusType::BUS_TYPE_SESSION,
-                                                         dbus_name, dbus_obj_path, dbus_interface);
-  if (!gamemode_proxy) {
-    throw std::runtime_error("Unable to connect to gamemode DBus!...");
-  } else {
-    gamemode_proxy->signal_signal().connect(sigc::mem_fun(*this, &Gamemode::notify_cb));
-  }
+  // Connect to gamemode. The proxy caches ClientCount and follows its changes, none of it blocks
+  Gio::DBus::Proxy::create_for_bus(Gio::DBus::BusType::BUS_TYPE_SESSION, dbus_name, dbus_obj_path,
+                                   dbus_get_interface,
+                                   sigc::mem_fun(*this, &Gamemode::proxyCreated_cb));
 
   // Connect to Login1 PrepareForSleep signal
-  system_connection = Gio::DBus::Connection::get_sync(Gio::DBus::BusType::BUS_TYPE_SYSTEM);
-  if (!system_connection) {
-    throw std::runtime_error("Unable to connect to the SYSTEM Bus!...");
-  } else {
-    login1_id = system_connection->signal_subscribe(
-        sigc::mem_fun(*this, &Gamemode::prepareForSleep_cb), "org.freedesktop.login1",
-        "org.freedesktop.login1.Manager", "PrepareForSleep", "/org/freedesktop/login1");
-  }
+  Gio::DBus::Connection::get(Gio::DBus::BusType::BUS_TYPE_SYSTEM,
+                             sigc::mem_fun(*this, &Gamemode::getConn_cb));
 
   event_box_.signal_button_press_event().connect(sigc::mem_fun(*this, &Gamemode::handleToggle));
 }
@@ -118,34 +109,49 @@ Gamemode::~Gamemode() {
   }
 }
 
-// Gets the DBus ClientCount
-void Gamemode::getData() {
-  if (gamemodeRunning && gamemode_proxy) {
-    try {
-      // Get game count
-      auto parameters = Glib::VariantContainerBase(
-          g_variant_new("(ss)", dbus_get_interface.c_str(), "ClientCount"));
-      Glib::VariantContainerBase data = gamemode_proxy->call_sync("Get", parameters);
-      if (data && data.is_of_type(Glib::VariantType("(v)"))) {
-        Glib::VariantBase variant;
-        g_variant_get(data.gobj_copy(), "(v)", &variant);
-        if (variant && variant.is_of_type(Glib::VARIANT_TYPE_INT32)) {
-          g_variant_get(variant.gobj_copy(), "i", &gameCount);
-          return;
-        }
-      }
-    } catch (Glib::Error& e) {
-      spdlog::error("Gamemode Error {}", e.what().c_str());
-    }
+void Gamemode::proxyCreated_cb(Glib::RefPtr<Gio::AsyncResult>& result) {
+  try {
+    gamemode_proxy = Gio::DBus::Proxy::create_for_bus_finish(result);
+    gamemode_proxy->signal_properties_changed().connect(
+        sigc::mem_fun(*this, &Gamemode::propertiesChanged_cb));
+    getData();
+    dp.emit();
+  } catch (const Glib::Error& e) {
+    spdlog::error("Gamemode. Unable to connect to gamemode DBus. {}", e.what().c_str());
   }
+}
+
+void Gamemode::getConn_cb(Glib::RefPtr<Gio::AsyncResult>& result) {
+  try {
+    system_connection = Gio::DBus::Connection::get_finish(result);
+    login1_id = system_connection->signal_subscribe(
+        sigc::mem_fun(*this, &Gamemode::prepareForSleep_cb), "org.freedesktop.login1",
+        "org.freedesktop.login1.Manager", "PrepareForSleep", "/org/freedesktop/login1");
+  } catch (const Glib::Error& e) {
+    spdlog::error("Gamemode. Unable to connect to the SYSTEM Bus. {}", e.what().c_str());
+  }
+}
+
+// Gets the ClientCount the proxy has cached
+void Gamemode::getData() {
   gameCount = 0;
+  if (!gamemodeRunning || !gamemode_proxy) {
+    return;
+  }
+  Glib::VariantBase count;
+  gamemode_proxy->get_cached_property(count, "ClientCount");
+  if (count && count.is_of_type(Glib::VARIANT_TYPE_INT32)) {
+    gameCount = std::max(0, Glib::VariantBase::cast_dynamic<Glib::Variant<gint32>>(count).get());
+  }
 }
 
-// Whenever the DBus ClientCount changes
-void Gamemode::notify_cb(const Glib::ustring& sender_name, const Glib::ustring& signal_name,
-                         const Glib::VariantContainerBase& arguments) {
-  if (signal_name == "PropertiesChanged") {
-    getData();
+// Whenever the DBus ClientCount changes, or the proxy loaded it for a new gamemode instance.
+// The other properties changing leave the module as it is.
+void Gamemode::propertiesChanged_cb(const Gio::DBus::Proxy::MapChangedProperties& changed,
+                                    const std::vector<Glib::ustring>& invalidated) {
+  const auto before = gameCount;
+  getData();
+  if (gameCount != before) {
     dp.emit();
   }
 }
@@ -27,11 +27,6 @@ waybar::modules::Gps::Gps(const std::string& id, const Json::Value& config)
       rfkill_{RFKILL_TYPE_GPS}
 #endif
 {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
-
   if (0 != gps_open("localhost", "2947", &gps_data_)) {
     throw std::runtime_error("Can't open gpsd socket");
   }
@@ -47,9 +42,10 @@ waybar::modules::Gps::Gps(const std::string& id, const Json::Value& config)
   gps_thread_ = [this] {
     dp.emit();
     gps_stream(&gps_data_, WATCH_ENABLE, NULL);
-    int last_gps_mode = 0;
 
-    while (gps_waiting(&gps_data_, 5000000)) {
+    // what libgps buffered first, then the socket along with the stop fd of the thread
+    while (gps_waiting(&gps_data_, 0) ||
+           gps_thread_.waitReadable(gps_data_.gps_fd, std::chrono::seconds(5))) {
       if (gps_read(&gps_data_, NULL, 0) == -1) {
         throw std::runtime_error("Can't read data from gpsd.");
       }
@@ -59,11 +55,11 @@ waybar::modules::Gps::Gps(const std::string& id, const Json::Value& config)
         continue;
       }
 
-      if (gps_data_.fix.mode != last_gps_mode) {
-        // significant update
+      // gpsd has no watch policy for TPV alone: SKY reports come along, most only move numbers
+      // the formats round away
+      if (changesText({gps_data_.fix, gps_data_.satellites_used, gps_data_.satellites_visible})) {
         dp.emit();
       }
-      last_gps_mode = gps_data_.fix.mode;
     }
   };
 
@@ -73,7 +69,7 @@ waybar::modules::Gps::Gps(const std::string& id, const Json::Value& config)
 }
 
 const std::string waybar::modules::Gps::getFixModeName() const {
-  switch (gps_data_.fix.mode) {
+  switch (shown_.fix.mode) {
     case MODE_NO_FIX:
       return "fix-none";
     case MODE_2D:
@@ -88,8 +84,8 @@ const std::string waybar::modules::Gps::getFixModeName() const {
   }
 }
 
-const std::string waybar::modules::Gps::getFixModeString() const {
-  switch (gps_data_.fix.mode) {
+const std::string waybar::modules::Gps::getFixModeString(const Fix& fix) const {
+  switch (fix.fix.mode) {
     case MODE_NO_FIX:
       return "No fix";
     case MODE_2D:
@@ -101,8 +97,8 @@ const std::string waybar::modules::Gps::getFixModeString() const {
   }
 }
 
-const std::string waybar::modules::Gps::getFixStatusString() const {
-  switch (gps_data_.fix.status) {
+const std::string waybar::modules::Gps::getFixStatusString(const Fix& fix) const {
+  switch (fix.fix.status) {
     case STATUS_GPS:
       return "GPS";
     case STATUS_DGPS:
@@ -129,11 +125,68 @@ const std::string waybar::modules::Gps::getFixStatusString() const {
   }
 }
 
+auto waybar::modules::Gps::formatArgs(const Fix& fix) const
+    -> fmt::dynamic_format_arg_store<fmt::format_context> {
+  fmt::dynamic_format_arg_store<fmt::format_context> store;
+  store.push_back(fmt::arg("mode", getFixModeString(fix)));
+  store.push_back(fmt::arg("status", getFixStatusString(fix)));
+
+  store.push_back(fmt::arg("latitude", fix.fix.latitude));
+  store.push_back(fmt::arg("latitude_error", fix.fix.epy));
+
+  store.push_back(fmt::arg("longitude", fix.fix.longitude));
+  store.push_back(fmt::arg("longitude_error", fix.fix.epx));
+
+  store.push_back(fmt::arg("altitude_hae", fix.fix.altHAE));
+  store.push_back(fmt::arg("altitude_msl", fix.fix.altMSL));
+  store.push_back(fmt::arg("altitude_error", fix.fix.epv));
+
+  store.push_back(fmt::arg("speed", fix.fix.speed));
+  store.push_back(fmt::arg("speed_error", fix.fix.eps));
+
+  store.push_back(fmt::arg("climb", fix.fix.climb));
+  store.push_back(fmt::arg("climb_error", fix.fix.epc));
+
+  store.push_back(fmt::arg("satellites_used", fix.satellites_used));
+  store.push_back(fmt::arg("satellites_visible", fix.satellites_visible));
+  return store;
+}
+
+auto waybar::modules::Gps::changesText(const Fix& fix) -> bool {
+  std::lock_guard lock(mutex_);
+  const bool mode_changed = fix.fix.mode != fix_.fix.mode;
+  fix_ = fix;
+  // A new fix mode shows right away, the rest at most once per interval
+  const auto now = std::chrono::steady_clock::now();
+  if (!mode_changed && now - emitted_at_ < interval_) {
+    return false;
+  }
+  if (!mode_changed) {
+    try {
+      const auto store = formatArgs(fix);
+      auto text = fmt::vformat(format_shown_, store);
+      if (!tooltip_format_shown_.empty()) {
+        text += '\0' + fmt::vformat(tooltip_format_shown_, store);
+      }
+      if (text == text_shown_) {
+        return false;
+      }
+    } catch (const std::exception&) {
+      // update() reports the format errors
+    }
+  }
+  emitted_at_ = now;
+  return true;
+}
+
 auto waybar::modules::Gps::update() -> void {
-  sleep(0);  // Wait for gps status change
+  {
+    std::lock_guard lock(mutex_);
+    shown_ = fix_;
+  }
 
-  if ((gps_data_.fix.mode == MODE_NOT_SEEN && hideDisconnected) ||
-      (gps_data_.fix.mode == MODE_NO_FIX && hideNoFix)) {
+  if ((shown_.fix.mode == MODE_NOT_SEEN && hideDisconnected) ||
+      (shown_.fix.mode == MODE_NO_FIX && hideNoFix)) {
     event_box_.set_visible(false);
     return;
   }
@@ -167,37 +220,17 @@ auto waybar::modules::Gps::update() -> void {
 
   auto format = format_;
 
-  fmt::dynamic_format_arg_store<fmt::format_context> store;
-  store.push_back(fmt::arg("mode", getFixModeString()));
-  store.push_back(fmt::arg("status", getFixStatusString()));
-
-  store.push_back(fmt::arg("latitude", gps_data_.fix.latitude));
-  store.push_back(fmt::arg("latitude_error", gps_data_.fix.epy));
-
-  store.push_back(fmt::arg("longitude", gps_data_.fix.longitude));
-  store.push_back(fmt::arg("longitude_error", gps_data_.fix.epx));
-
-  store.push_back(fmt::arg("altitude_hae", gps_data_.fix.altHAE));
-  store.push_back(fmt::arg("altitude_msl", gps_data_.fix.altMSL));
-  store.push_back(fmt::arg("altitude_error", gps_data_.fix.epv));
-
-  store.push_back(fmt::arg("speed", gps_data_.fix.speed));
-  store.push_back(fmt::arg("speed_error", gps_data_.fix.eps));
-
-  store.push_back(fmt::arg("climb", gps_data_.fix.climb));
-  store.push_back(fmt::arg("climb_error", gps_data_.fix.epc));
-
-  store.push_back(fmt::arg("satellites_used", gps_data_.satellites_used));
-  store.push_back(fmt::arg("satellites_visible", gps_data_.satellites_visible));
+  const auto store = formatArgs(shown_);
 
   auto text = fmt::vformat(format, store);
 
+  std::string tooltip_text;
   if (tooltipEnabled()) {
     if (tooltip_format.empty() && config_["tooltip-format"].isString()) {
       tooltip_format = config_["tooltip-format"].asString();
     }
     if (!tooltip_format.empty()) {
-      auto tooltip_text = fmt::vformat(tooltip_format, store);
+      tooltip_text = fmt::vformat(tooltip_format, store);
       if (label_.get_tooltip_text() != tooltip_text) {
         label_.set_tooltip_markup(tooltip_text);
       }
@@ -206,11 +239,20 @@ auto waybar::modules::Gps::update() -> void {
     }
   }
   label_.set_markup(text);
+  {
+    std::lock_guard lock(mutex_);
+    format_shown_ = format;
+    tooltip_format_shown_ = tooltipEnabled() ? tooltip_format : "";
+    text_shown_ = tooltip_format_shown_.empty() ? text : text + '\0' + tooltip_text;
+  }
   // Call parent update
   ALabel::update();
 }
 
 waybar::modules::Gps::~Gps() {
+  // the thread reads gps_data_
+  gps_thread_.stop();
+  gps_thread_.join();
   gps_stream(&gps_data_, WATCH_DISABLE, NULL);
   gps_close(&gps_data_);
 }
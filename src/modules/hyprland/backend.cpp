@@ -1,7 +1,9 @@
 #include "modules/hyprland/backend.hpp"
 
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <spdlog/spdlog.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -9,9 +11,16 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <filesystem>
 #include <string>
 
+#include "util/log.hpp"
+#include "util/trace.hpp"
+
 namespace waybar::modules::hyprland {
 
 std::filesystem::path IPC::socketFolder_;
@@ -57,11 +66,11 @@ IPC::~IPC() {
   running_ = false;
   spdlog::info("Hyprland IPC stopping...");
   if (socketfd_ != -1) {
-    spdlog::trace("Shutting down socket");
+    WAYBAR_LOG_TRACE("Shutting down socket");
     if (shutdown(socketfd_, SHUT_RDWR) == -1) {
       spdlog::error("Hyprland IPC: Couldn't shutdown socket");
     }
-    spdlog::trace("Closing socket");
+    WAYBAR_LOG_TRACE("Closing socket");
     if (close(socketfd_) == -1) {
       spdlog::error("Hyprland IPC: Couldn't close socket");
     }
@@ -106,47 +115,100 @@ void IPC::socketListener() {
     spdlog::error("Hyprland IPC: Unable to connect?");
     return;
   }
-  auto* file = fdopen(socketfd_, "r");
-  if (file == nullptr) {
-    spdlog::error("Hyprland IPC: Couldn't open file descriptor");
+
+  // Switch the socket to non-blocking mode so a single wakeup can drain everything the compositor
+  // has queued up instead of handling one event per read.
+  int flags = fcntl(socketfd_, F_GETFL, 0);
+  if (flags == -1 || fcntl(socketfd_, F_SETFL, flags | O_NONBLOCK) == -1) {
+    spdlog::error("Hyprland IPC: Couldn't set socket to non-blocking mode");
     return;
   }
-  while (running_) {
-    std::array<char, 1024> buffer;  // Hyprland socket2 events are max 1024 bytes
 
-    auto* receivedCharPtr = fgets(buffer.data(), buffer.size(), file);
+  pollfd pfd = {.fd = socketfd_, .events = POLLIN, .revents = 0};
+  std::array<char, 8192> chunk;
+  std::string buffer;  // holds incomplete trailing data between wakeups, grows as needed
 
-    if (receivedCharPtr == nullptr) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-      continue;
+  while (running_) {
+    if (poll(&pfd, 1, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("Hyprland IPC: poll failed: {}", strerror(errno));
+      break;
     }
 
-    std::string messageReceived(buffer.data());
-    messageReceived = messageReceived.substr(0, messageReceived.find_first_of('\n'));
-    spdlog::debug("hyprland IPC received {}", messageReceived);
+    bool closed = (pfd.revents & (POLLERR | POLLNVAL)) != 0;
+    while (!closed) {
+      auto bytesRead = read(socketfd_, chunk.data(), chunk.size());
+      if (bytesRead > 0) {
+        buffer.append(chunk.data(), bytesRead);
+      } else if (bytesRead == 0) {
+        closed = true;
+      } else if (errno == EINTR) {
+        continue;
+      } else {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          closed = true;
+        }
+        break;
+      }
+    }
 
-    try {
-      parseIPC(messageReceived);
-    } catch (std::exception& e) {
-      spdlog::warn("Failed to parse IPC message: {}, reason: {}", messageReceived, e.what());
-    } catch (...) {
-      throw;
+    // dispatch every complete line received in this wakeup
+    size_t lineStart = 0;
+    for (auto lineEnd = buffer.find('\n'); lineEnd != std::string::npos;
+         lineEnd = buffer.find('\n', lineStart)) {
+      std::string messageReceived = buffer.substr(lineStart, lineEnd - lineStart);
+      lineStart = lineEnd + 1;
+      if (messageReceived.empty()) {
+        continue;
+      }
+      WAYBAR_LOG_DEBUG("hyprland IPC received {}", messageReceived);
+
+      try {
+        util::trace::Span span(std::string_view(messageReceived).substr(
+                                   0, std::min(messageReceived.find(">>"), messageReceived.size())),
+                               "hyprland");
+        parseIPC(messageReceived);
+      } catch (std::exception& e) {
+        spdlog::warn("Failed to parse IPC message: {}, reason: {}", messageReceived, e.what());
+      } catch (...) {
+        throw;
+      }
     }
+    buffer.erase(0, lineStart);
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (closed || (pfd.revents & POLLHUP) != 0) {
+      if (running_) {
+        spdlog::warn("Hyprland IPC: socket2 connection closed");
+      }
+      break;
+    }
   }
   spdlog::debug("Hyprland IPC stopped");
 }
 
 void IPC::parseIPC(const std::string& ev) {
-  std::string request = ev.substr(0, ev.find_first_of('>'));
-  std::unique_lock lock(callbackMutex_);
-
-  for (auto& [eventname, handler] : callbacks_) {
-    if (eventname == request) {
-      handler->onEvent(ev);
+  // any event may change the compositor state, drop the cached query replies
+  invalidateSnapshots();
+  {
+    std::lock_guard lock(windowStateMutex_);
+    windowState_.apply(ev);
+    if (windowReloading_) {
+      reloadEvents_.push_back(ev);
     }
   }
+
+  std::string_view request(ev.data(), std::min(ev.find_first_of('>'), ev.size()));
+  std::shared_lock lock(callbackMutex_);
+
+  auto it = callbacks_.find(request);
+  if (it == callbacks_.end()) {
+    return;
+  }
+  for (const auto& subscriber : it->second) {
+    pool_.push(subscriber, ev);
+  }
 }
 
 void IPC::registerForIPC(const std::string& ev, EventHandler* ev_handler) {
@@ -155,7 +217,13 @@ void IPC::registerForIPC(const std::string& ev, EventHandler* ev_handler) {
   }
 
   std::unique_lock lock(callbackMutex_);
-  callbacks_.emplace_back(ev, ev_handler);
+  auto& subscriber = subscribers_[ev_handler];
+  if (!subscriber) {
+    subscriber = std::make_shared<Subscriber>(ev_handler);
+  }
+  // the map keys are views into eventNames_, whose nodes stay put for the lifetime of the IPC
+  const auto& eventName = *eventNames_.insert(ev).first;
+  callbacks_[eventName].push_back(subscriber);
 }
 
 void IPC::unregisterForIPC(EventHandler* ev_handler) {
@@ -163,48 +231,162 @@ void IPC::unregisterForIPC(EventHandler* ev_handler) {
     return;
   }
 
-  std::unique_lock lock(callbackMutex_);
+  std::shared_ptr<Subscriber> subscriber;
+  {
+    std::unique_lock lock(callbackMutex_);
+    auto node = subscribers_.extract(ev_handler);
+    if (node.empty()) {
+      return;
+    }
+    subscriber = std::move(node.mapped());
+
+    for (auto it = callbacks_.begin(); it != callbacks_.end();) {
+      auto& subscribers = it->second;
+      std::erase(subscribers, subscriber);
+      if (subscribers.empty()) {
+        it = callbacks_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // waited for without the lock, the events of the other handlers keep flowing meanwhile
+  HandlerPool::stop(*subscriber);
+}
+
+IPC::HandlerPool::HandlerPool() {
+  const auto workers = std::clamp(std::thread::hardware_concurrency(), 2U, MAX_WORKERS);
+  for (unsigned i = 0; i < workers; ++i) {
+    workers_.emplace_back([this] { run(); });
+  }
+}
 
-  for (auto it = callbacks_.begin(); it != callbacks_.end();) {
-    auto& [eventname, handler] = *it;
-    if (handler == ev_handler) {
-      callbacks_.erase(it++);
-    } else {
-      ++it;
+IPC::HandlerPool::~HandlerPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void IPC::HandlerPool::push(const std::shared_ptr<Subscriber>& subscriber, const std::string& ev) {
+  subscriber->queue.push(ev);
+  subscriber->pushed.fetch_add(1);
+  if (!subscriber->scheduled.exchange(true)) {
+    schedule(subscriber);
+  }
+}
+
+void IPC::HandlerPool::stop(Subscriber& subscriber) {
+  std::unique_lock lock(subscriber.mutex);
+  subscriber.stopped = true;
+  // from its own onEvent, the call in progress can't be waited for
+  const auto self = std::this_thread::get_id();
+  subscriber.idle.wait(lock, [&] {
+    return subscriber.runner == std::thread::id() || subscriber.runner == self;
+  });
+}
+
+void IPC::HandlerPool::schedule(std::shared_ptr<Subscriber> subscriber) {
+  {
+    std::lock_guard lock(mutex_);
+    runnable_.push_back(std::move(subscriber));
+  }
+  ready_.notify_one();
+}
+
+void IPC::HandlerPool::run() {
+  while (true) {
+    std::shared_ptr<Subscriber> subscriber;
+    {
+      std::unique_lock lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !runnable_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      subscriber = std::move(runnable_.front());
+      runnable_.pop_front();
+    }
+    drain(subscriber);
+  }
+}
+
+void IPC::HandlerPool::drain(const std::shared_ptr<Subscriber>& subscriber) {
+  {
+    std::lock_guard lock(subscriber->mutex);
+    if (subscriber->stopped) {
+      return;  // left scheduled, nothing pushes to it anymore
     }
+    subscriber->runner = std::this_thread::get_id();
   }
+  for (size_t i = 0; i < BATCH && !subscriber->stopped; ++i) {
+    if (!subscriber->queue.consume([&subscriber](std::string& ev) {
+          try {
+            subscriber->handler->onEvent(ev);
+          } catch (std::exception& e) {
+            spdlog::warn("Failed to handle IPC message: {}, reason: {}", ev, e.what());
+          }
+        })) {
+      break;
+    }
+    subscriber->handled.fetch_add(1);
+  }
+  {
+    std::lock_guard lock(subscriber->mutex);
+    subscriber->runner = std::thread::id();
+  }
+  subscriber->idle.notify_all();
+
+  // events pushed as it was draining found it scheduled, and the rest of a full batch waits
+  subscriber->scheduled.store(false);
+  if (!subscriber->stopped && subscriber->pushed.load() != subscriber->handled.load() &&
+      !subscriber->scheduled.exchange(true)) {
+    schedule(subscriber);
+  }
+}
+
+const std::string& IPC::getSocket1Path() {
+  // Resolved on first use only. If the initializer throws, the next call retries.
+  static const std::string socketPath = [] {
+    auto* instanceSig = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+
+    if (instanceSig == nullptr) {
+      throw std::runtime_error(
+          "Hyprland IPC: HYPRLAND_INSTANCE_SIGNATURE was not set! (Is Hyprland running?)");
+    }
+
+    return std::string(IPC::getSocketFolder(instanceSig) / ".socket.sock");
+  }();
+  return socketPath;
 }
 
 std::string IPC::getSocket1Reply(const std::string& rq) {
   // basically hyprctl
 
+  const auto& socketPath = getSocket1Path();
+
   const auto serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
 
   if (serverSocket < 0) {
     throw std::runtime_error("Hyprland IPC: Couldn't open a socket (1)");
   }
 
-  // get the instance signature
-  auto* instanceSig = getenv("HYPRLAND_INSTANCE_SIGNATURE");
-
-  if (instanceSig == nullptr) {
-    throw std::runtime_error(
-        "Hyprland IPC: HYPRLAND_INSTANCE_SIGNATURE was not set! (Is Hyprland running?)");
-  }
-
   sockaddr_un serverAddress = {0};
   serverAddress.sun_family = AF_UNIX;
 
-  std::string socketPath = IPC::getSocketFolder(instanceSig) / ".socket.sock";
-
   // Use snprintf to copy the socketPath string into serverAddress.sun_path
   if (snprintf(serverAddress.sun_path, sizeof(serverAddress.sun_path), "%s", socketPath.c_str()) <
       0) {
+    close(serverSocket);
     throw std::runtime_error("Hyprland IPC: Couldn't copy socket path (6)");
   }
 
   if (connect(serverSocket, reinterpret_cast<sockaddr*>(&serverAddress), sizeof(serverAddress)) <
       0) {
+    close(serverSocket);
     throw std::runtime_error("Hyprland IPC: Couldn't connect to " + socketPath + ". (3)");
   }
 
@@ -212,6 +394,7 @@ std::string IPC::getSocket1Reply(const std::string& rq) {
 
   if (sizeWritten < 0) {
     spdlog::error("Hyprland IPC: Couldn't write (4)");
+    close(serverSocket);
     return "";
   }
 
@@ -233,7 +416,11 @@ std::string IPC::getSocket1Reply(const std::string& rq) {
   return response;
 }
 
-Json::Value IPC::getSocket1JsonReply(const std::string& rq) {
+bool IPC::isSnapshotQuery(const std::string& rq) {
+  return rq == "clients" || rq == "workspaces" || rq == "monitors" || rq == "activeworkspace";
+}
+
+Json::Value IPC::fetchJson(const std::string& rq) {
   std::string reply = getSocket1Reply("j/" + rq);
 
   if (reply.empty()) {
@@ -243,4 +430,125 @@ Json::Value IPC::getSocket1JsonReply(const std::string& rq) {
   return parser_.parse(reply);
 }
 
+// Upper bound on the age of a snapshot, for state changes Hyprland doesn't report on socket2
+// (e.g. floating window geometry). Long enough to share one fetch across an update pass.
+constexpr auto SNAPSHOT_LIFETIME = std::chrono::milliseconds(100);
+
+IPC::Snapshot& IPC::snapshotFor(const std::string& rq) {
+  std::unique_lock lock(snapshotsMutex_);
+  return snapshots_[rq];
+}
+
+bool IPC::isSnapshotFresh(const Snapshot& snapshot) const {
+  return snapshot.valid && snapshot.generation == stateGeneration_ &&
+         std::chrono::steady_clock::now() - snapshot.fetchedAt < SNAPSHOT_LIFETIME;
+}
+
+Json::Value IPC::getSocket1JsonReply(const std::string& rq) {
+  if (!isSnapshotQuery(rq)) {
+    return fetchJson(rq);
+  }
+
+  auto& snapshot = snapshotFor(rq);
+  std::unique_lock lock(snapshot.mutex);
+  if (isSnapshotFresh(snapshot)) {
+    return snapshot.value;
+  }
+
+  // Remember the generation from before the fetch: if an event arrives while the request is in
+  // flight, the reply may predate it and must not be reused.
+  const auto generation = stateGeneration_.load();
+  const auto fetchedAt = std::chrono::steady_clock::now();
+  snapshot.value = fetchJson(rq);
+  snapshot.valid = !snapshot.value.isNull();
+  snapshot.generation = generation;
+  snapshot.fetchedAt = fetchedAt;
+  return snapshot.value;
+}
+
+void IPC::loadWindowState() {
+  {
+    std::lock_guard lock(windowStateMutex_);
+    windowReloading_ = true;
+  }
+  // without the lock, so that the socket2 thread doesn't wait on the queries
+  const auto replies = getSocket1JsonReplies({"monitors", "workspaces", "clients"});
+  std::lock_guard lock(windowStateMutex_);
+  windowState_.load(replies[0], replies[1], replies[2]);
+  // the replies may predate the events that came meanwhile
+  for (const auto& ev : reloadEvents_) {
+    windowState_.apply(ev);
+  }
+  reloadEvents_.clear();
+  windowReloading_ = false;
+}
+
+std::vector<Json::Value> IPC::getSocket1JsonReplies(const std::vector<std::string>& rqs) {
+  std::vector<Json::Value> replies(rqs.size());
+  std::vector<size_t> pending;
+  std::string batch = "[[BATCH]]";
+
+  for (size_t i = 0; i < rqs.size(); ++i) {
+    if (isSnapshotQuery(rqs[i])) {
+      auto& snapshot = snapshotFor(rqs[i]);
+      std::unique_lock lock(snapshot.mutex);
+      if (isSnapshotFresh(snapshot)) {
+        replies[i] = snapshot.value;
+        continue;
+      }
+    }
+    if (!pending.empty()) {
+      batch += ';';
+    }
+    batch += "j/" + rqs[i];
+    pending.push_back(i);
+  }
+
+  if (pending.empty()) {
+    return replies;
+  }
+  if (pending.size() == 1) {
+    replies[pending.front()] = getSocket1JsonReply(rqs[pending.front()]);
+    return replies;
+  }
+
+  const auto generation = stateGeneration_.load();
+  const auto fetchedAt = std::chrono::steady_clock::now();
+  const std::string reply = getSocket1Reply(batch);
+
+  // Hyprland separates the replies of a batch with three newlines
+  constexpr std::string_view separator = "\n\n\n";
+  size_t start = 0;
+  for (auto index : pending) {
+    if (start > reply.size()) {
+      spdlog::warn("Hyprland IPC: batch reply is missing a result for {}", rqs[index]);
+      break;
+    }
+    auto end = reply.find(separator, start);
+    if (end == std::string::npos) {
+      end = reply.size();
+    }
+    auto part = reply.substr(start, end - start);
+    start = end + separator.size();
+
+    if (part.empty()) {
+      continue;
+    }
+    replies[index] = parser_.parse(part);
+
+    if (isSnapshotQuery(rqs[index])) {
+      auto& snapshot = snapshotFor(rqs[index]);
+      std::unique_lock lock(snapshot.mutex);
+      if (!snapshot.valid || snapshot.generation <= generation) {
+        snapshot.value = replies[index];
+        snapshot.valid = !snapshot.value.isNull();
+        snapshot.generation = generation;
+        snapshot.fetchedAt = fetchedAt;
+      }
+    }
+  }
+
+  return replies;
+}
+
 }  // namespace waybar::modules::hyprland
@@ -11,12 +11,13 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "modules/hyprland/fancy-workspaces.hpp"
 #include "util/command.hpp"
+#include "util/desktop_file_index.hpp"
 #include "util/gtk_icon.hpp"
 #include "util/icon_loader.hpp"
-#include "util/thumbnail_cache.hpp"
 
 namespace waybar::modules::hyprland {
 
@@ -30,51 +31,17 @@ std::string toLowerCase(const std::string& input) {
   return result;
 }
 
-std::optional<std::string> getFileBySuffix(const std::string& dir, const std::string& suffix,
-                                           bool check_lower_case) {
-  if (!std::filesystem::exists(dir)) {
-    return {};
-  }
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
-    if (entry.is_regular_file()) {
-      std::string filename = entry.path().filename().string();
-      if (filename.size() < suffix.size()) {
-        continue;
-      }
-      if ((filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0) ||
-          (check_lower_case && filename.compare(filename.size() - suffix.size(), suffix.size(),
-                                                toLowerCase(suffix)) == 0)) {
-        return entry.path().string();
-      }
-    }
-  }
-  return {};
-}
-
 std::optional<std::string> getDesktopFilePath(const std::string& app_identifier,
                                               const std::string& alternative_app_identifier) {
   if (app_identifier.empty()) {
     return {};
   }
 
-  auto data_dirs = Glib::get_system_data_dirs();
-  data_dirs.insert(data_dirs.begin(), Glib::get_user_data_dir());
-  for (const auto& data_dir : data_dirs) {
-    const auto data_app_dir = data_dir + "/applications/";
-    auto desktop_file_suffix = app_identifier + ".desktop";
-    auto desktop_file_path = getFileBySuffix(data_app_dir, desktop_file_suffix, true);
-    if (desktop_file_path.has_value()) {
-      return desktop_file_path;
-    }
-    if (!alternative_app_identifier.empty()) {
-      desktop_file_suffix = alternative_app_identifier + ".desktop";
-      desktop_file_path = getFileBySuffix(data_app_dir, desktop_file_suffix, true);
-      if (desktop_file_path.has_value()) {
-        return desktop_file_path;
-      }
-    }
+  std::vector<std::string> suffixes{app_identifier + ".desktop"};
+  if (!alternative_app_identifier.empty()) {
+    suffixes.push_back(alternative_app_identifier + ".desktop");
   }
-  return {};
+  return util::DesktopFileIndex::inst().findBySuffix(suffixes, false);
 }
 
 std::optional<Glib::ustring> getIconName(const std::string& app_identifier,
@@ -110,18 +77,7 @@ std::optional<Glib::ustring> getIconName(const std::string& app_identifier,
     return {};
   }
 
-  try {
-    Glib::KeyFile desktop_file;
-    desktop_file.load_from_file(desktop_file_path.value());
-    return desktop_file.get_string("Desktop Entry", "Icon");
-  } catch (Glib::FileError& error) {
-    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path.value(),
-                 std::string(error.what()));
-  } catch (Glib::KeyFileError& error) {
-    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path.value(),
-                 std::string(error.what()));
-  }
-  return {};
+  return util::DesktopFileIndex::inst().getIconName(desktop_file_path.value());
 }
 
 }  // namespace
@@ -180,6 +136,7 @@ std::optional<FancyWindowRepr> FancyWorkspace::closeWindow(WindowAddress const&
   if (it != m_windowMap.end()) {
     FancyWindowRepr windowRepr = *it;
     m_windowMap.erase(it);
+    m_workspaceManager.unindexWindow(addr, this);
     return windowRepr;
   }
   return std::nullopt;
@@ -220,16 +177,17 @@ bool FancyWorkspace::handleClicked(GdkEventButton* bt) const {
       if (bt->button == 1) {
         if (id() > 0) {  // normal
           if (m_workspaceManager.moveToMonitor()) {
-            m_ipc.getSocket1Reply("dispatch focusworkspaceoncurrentmonitor " +
-                                  std::to_string(id()));
+            m_workspaceManager.switchWorkspace("dispatch focusworkspaceoncurrentmonitor " +
+                                               std::to_string(id()));
           } else {
-            m_ipc.getSocket1Reply("dispatch workspace " + std::to_string(id()));
+            m_workspaceManager.switchWorkspace("dispatch workspace " + std::to_string(id()));
           }
         } else if (!isSpecial()) {  // named (this includes persistent)
           if (m_workspaceManager.moveToMonitor()) {
-            m_ipc.getSocket1Reply("dispatch focusworkspaceoncurrentmonitor name:" + name());
+            m_workspaceManager.switchWorkspace("dispatch focusworkspaceoncurrentmonitor name:" +
+                                               name());
           } else {
-            m_ipc.getSocket1Reply("dispatch workspace name:" + name());
+            m_workspaceManager.switchWorkspace("dispatch workspace name:" + name());
           }
         } else if (id() != -99) {  // named special
           m_ipc.getSocket1Reply("dispatch togglespecialworkspace " + name());
@@ -245,7 +203,20 @@ bool FancyWorkspace::handleClicked(GdkEventButton* bt) const {
   return false;
 }
 
+FancyWorkspace::~FancyWorkspace() {
+  for (const auto& window : m_windowMap) {
+    m_workspaceManager.unindexWindow(window.address, this);
+  }
+}
+
+bool FancyWorkspace::containsWindow(WindowAddress const& addr) const {
+  return m_workspaceManager.windowWorkspace(addr) == this;
+}
+
 void FancyWorkspace::initializeWindowMap(const Json::Value& clients_data) {
+  for (const auto& window : m_windowMap) {
+    m_workspaceManager.unindexWindow(window.address, this);
+  }
   m_windowMap.clear();
   for (auto client : clients_data) {
     if (client["workspace"]["id"].asInt() == id()) {
@@ -290,6 +261,7 @@ void FancyWorkspace::insertWindow(FancyWindowCreationPayload create_window_paylo
         *it = repr;
       } else {
         m_windowMap.emplace_back(repr);
+        m_workspaceManager.indexWindow(addr, this);
       }
     }
   }
@@ -303,7 +275,7 @@ bool FancyWorkspace::onWindowOpened(FancyWindowCreationPayload const& create_win
   return false;
 }
 
-std::string& FancyWorkspace::selectIcon(std::map<std::string, std::string>& icons_map) {
+std::string& FancyWorkspace::selectIcon(util::StringMap<std::string>& icons_map) {
   spdlog::trace("Selecting icon for workspace {}", name());
   if (isUrgent()) {
     auto urgentIconIt = icons_map.find("urgent");
@@ -414,7 +386,7 @@ void FancyWorkspace::update(const std::string& workspace_icon) {
     }
   }
 
-  auto formatBefore = m_workspaceManager.formatBefore();
+  const auto& formatBefore = m_workspaceManager.formatBefore();
   m_labelBefore.set_markup(fmt::format(fmt::runtime(formatBefore), fmt::arg("id", id()),
                                        fmt::arg("name", name()), fmt::arg("icon", workspace_icon),
                                        fmt::arg("windows", windows)));
@@ -429,29 +401,17 @@ void FancyWorkspace::update(const std::string& workspace_icon) {
 }
 
 void FancyWorkspace::updateWindowIcons() {
-  // Clear ALL children from IconBox (fixes EventBox accumulation bug)
-  // Previous code only removed images from m_iconImages vector but left EventBox containers
-  for (auto* child : m_iconBox.get_children()) {
-    m_iconBox.remove(*child);
-    delete child;
-  }
-  m_iconImages.clear();
-  m_iconBox.hide();
-
   auto showMode = m_workspaceManager.showWindowIcons();
 
-  if (showMode == FancyWorkspaces::ShowWindowIcons::NONE) {
+  // Check if we should show icons based on current-group logic. The icons of a workspace out of
+  // the active group are kept, hidden, for when it is in it again.
+  if (showMode == FancyWorkspaces::ShowWindowIcons::NONE ||
+      (showMode == FancyWorkspaces::ShowWindowIcons::CURRENT_GROUP &&
+       !m_workspaceManager.isWorkspaceInActiveGroup(m_name))) {
+    m_iconBox.hide();
     return;
   }
 
-  // Check if we should show icons based on current-group logic
-  if (showMode == FancyWorkspaces::ShowWindowIcons::CURRENT_GROUP) {
-    // Show icons only if this workspace is in the active group
-    if (!m_workspaceManager.isWorkspaceInActiveGroup(m_name)) {
-      return;
-    }
-  }
-
   int icon_size = m_workspaceManager.windowIconSize();
 
   // Collect window icons, titles, and addresses (deduplicate icons, collect all data)
@@ -459,25 +419,32 @@ void FancyWorkspace::updateWindowIcons() {
   std::vector<std::string> icon_names_ordered;
   std::map<std::string, std::vector<std::string>> icon_to_titles;
   std::map<std::string, std::vector<std::string>> icon_to_addresses;
+  std::unordered_map<WindowAddress, ResolvedIcon> resolved;
 
   for (const auto& window : m_windowMap) {
     if (shouldSkipWindow(window)) {
       continue;
     }
 
-    auto icon_name_opt = getIconName(window.window_class, "");
-    std::string icon_name;
-    if (icon_name_opt.has_value()) {
-      icon_name = icon_name_opt.value();
+    auto& icon = resolved[window.address];
+    if (auto kept = m_resolvedIcons.find(window.address);
+        kept != m_resolvedIcons.end() && kept->second.windowClass == window.window_class) {
+      icon = std::move(kept->second);
     } else {
-      // Use fallback icon for unrecognized apps
-      icon_name = "application-x-executable";  // Generic app icon
-      spdlog::debug("No icon found for class '{}', using fallback", window.window_class);
+      icon.windowClass = window.window_class;
+      auto icon_name_opt = getIconName(window.window_class, "");
+      if (icon_name_opt.has_value()) {
+        icon.iconName = icon_name_opt.value();
+      } else {
+        // Use fallback icon for unrecognized apps
+        icon.iconName = "application-x-executable";  // Generic app icon
+        spdlog::debug("No icon found for class '{}', using fallback", window.window_class);
+      }
     }
+    const auto& icon_name = icon.iconName;
 
     // Add to ordered list if first occurrence
-    if (unique_icons.find(icon_name) == unique_icons.end()) {
-      unique_icons.insert(icon_name);
+    if (unique_icons.insert(icon_name).second) {
       icon_names_ordered.push_back(icon_name);
     }
 
@@ -485,169 +452,103 @@ void FancyWorkspace::updateWindowIcons() {
     icon_to_titles[icon_name].push_back(window.window_title);
     icon_to_addresses[icon_name].push_back(window.address);
   }
+  m_resolvedIcons = std::move(resolved);
 
-  // Create and add icon images
+  // The icons of the apps gone leave the box as they are destroyed
+  std::erase_if(m_windowIcons,
+                [&unique_icons](const auto& icon) { return !unique_icons.contains(icon.first); });
+
+  std::vector<std::string> order;
   for (const auto& icon_name : icon_names_ordered) {
-    auto* img = new Gtk::Image();
-    img->set_pixel_size(icon_size);
-
-    if (icon_name.front() == '/') {
-      // File path - load from file
-      try {
-        auto pixbuf = Gdk::Pixbuf::create_from_file(icon_name, icon_size, icon_size);
-        img->set(pixbuf);
-      } catch (const Glib::Error& e) {
-        spdlog::warn("[WICONS] Failed to load icon from file {}: {}", icon_name, e.what().c_str());
-        delete img;
+    auto [it, created] = m_windowIcons.try_emplace(icon_name);
+    auto& icon = it->second;
+    if (created) {
+      if (!initWindowIcon(icon, icon_name, icon_size)) {
+        m_windowIcons.erase(it);
         continue;
       }
-    } else {
-      // Icon name - load from theme
-      img->set_from_icon_name(icon_name, Gtk::ICON_SIZE_INVALID);
+      m_iconBox.pack_start(icon.eventBox, false, false);
     }
 
-    // Build tooltip from window titles
+    // Thumbnails interleaved with the titles, built when the tooltip is first shown
     const auto& titles = icon_to_titles[icon_name];
-    std::string tooltip;
+    const auto& addresses = icon_to_addresses[icon_name];
+    std::vector<ThumbnailTooltip::Entry> entries;
     if (titles.size() == 1) {
-      // Single window: just show the title
-      tooltip = titles[0];
+      entries.push_back({addresses[0], titles[0]});
+      icon.tooltip.setContent("", std::move(entries), false);
     } else {
-      // Multiple windows: show as list
-      tooltip = icon_name + ":\n";
-      for (const auto& title : titles) {
-        tooltip += "• " + title + "\n";
-      }
-      // Remove trailing newline
-      if (!tooltip.empty() && tooltip.back() == '\n') {
-        tooltip.pop_back();
+      for (size_t i = 0; i < titles.size(); i++) {
+        entries.push_back({addresses[i], "• " + titles[i]});
       }
+      icon.tooltip.setContent(icon_name + ":", std::move(entries), true);
     }
+    icon.firstAddress = addresses[0];
+    order.push_back(icon_name);
+  }
 
-    // Wrap icon in EventBox to capture clicks
-    auto* eventBox = new Gtk::EventBox();
-    eventBox->add(*img);
-    
-    // Set up custom tooltip with thumbnails - interleave thumbnails and titles
-    // Note: titles and addresses already declared above
-    eventBox->set_has_tooltip(true);
-    const auto& addresses = icon_to_addresses[icon_name];
-    eventBox->signal_query_tooltip().connect(
-        [icon_name, addresses, titles](int x, int y, bool keyboard_tooltip, 
-                            const Glib::RefPtr<Gtk::Tooltip>& tooltip_widget) -> bool {
-          // Create tooltip content box
-          auto* vbox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL, 4));
-          
-          if (titles.size() == 1) {
-            // Single window - simple layout
-            waybar::util::ThumbnailCache cache;
-            if (!addresses.empty()) {
-              auto thumbnail_path = cache.getThumbnailPath(addresses[0]);
-              if (thumbnail_path.has_value()) {
-                try {
-                  auto pixbuf = Gdk::Pixbuf::create_from_file(thumbnail_path.value());
-                  int width = pixbuf->get_width();
-                  int height = pixbuf->get_height();
-                  if (width > 256 || height > 256) {
-                    double scale = std::min(256.0 / width, 256.0 / height);
-                    width = static_cast<int>(width * scale);
-                    height = static_cast<int>(height * scale);
-                    pixbuf = pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR);
-                  }
-                  auto* thumb_img = Gtk::manage(new Gtk::Image(pixbuf));
-                  vbox->pack_start(*thumb_img, false, false);
-                } catch (const Glib::Error& e) {
-                  spdlog::debug("[WICONS] Failed to load thumbnail for {}: {}", addresses[0], e.what().c_str());
-                }
-              }
-            }
-            // Single title
-            auto* label = Gtk::manage(new Gtk::Label(titles[0]));
-            label->set_xalign(0.0);
-            vbox->pack_start(*label, false, false);
-          } else {
-            // Multiple windows - interleave thumbnails and titles
-            auto* header = Gtk::manage(new Gtk::Label(icon_name + ":"));
-            header->set_xalign(0.0);
-            vbox->pack_start(*header, false, false);
-            
-            waybar::util::ThumbnailCache cache;
-            size_t count = std::min(addresses.size(), titles.size());
-            
-            for (size_t i = 0; i < count; i++) {
-              // Thumbnail
-              auto thumbnail_path = cache.getThumbnailPath(addresses[i]);
-              if (thumbnail_path.has_value()) {
-                try {
-                  auto pixbuf = Gdk::Pixbuf::create_from_file(thumbnail_path.value());
-                  int width = pixbuf->get_width();
-                  int height = pixbuf->get_height();
-                  if (width > 256 || height > 256) {
-                    double scale = std::min(256.0 / width, 256.0 / height);
-                    width = static_cast<int>(width * scale);
-                    height = static_cast<int>(height * scale);
-                    pixbuf = pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR);
-                  }
-                  auto* thumb_img = Gtk::manage(new Gtk::Image(pixbuf));
-                  vbox->pack_start(*thumb_img, false, false);
-                } catch (const Glib::Error& e) {
-                  spdlog::debug("[WICONS] Failed to load thumbnail for {}: {}", addresses[i], e.what().c_str());
-                }
-              }
-              
-              // Title
-              std::string titleText = "• " + titles[i];
-              auto* titleLabel = Gtk::manage(new Gtk::Label(titleText));
-              titleLabel->set_xalign(0.0);
-              titleLabel->set_line_wrap(true);
-              titleLabel->set_max_width_chars(50);
-              vbox->pack_start(*titleLabel, false, false);
-            }
-          }
-          
-          vbox->show_all();
-          tooltip_widget->set_custom(*vbox);
-          return true;
-        });
-
-    // Add click handler to focus the first window
-    if (!addresses.empty()) {
-      std::string firstWindowAddress = addresses[0];
-      eventBox->signal_button_press_event().connect(
-          [this, firstWindowAddress, icon_name](GdkEventButton* event) -> bool {
-            if (event->button == 1) {  // Left click
-              spdlog::debug("[WICONS] Icon clicked, focusing window: {}", firstWindowAddress);
-              std::string response = m_workspaceManager.getIpc().getSocket1Reply(
-                  "dispatch focuswindow address:0x" + firstWindowAddress);
-              if (response.find("ok") == std::string::npos && !response.empty()) {
-                spdlog::debug("[WICONS] Hyprland response: '{}'", response);
-              }
-              return true;
-            }
-            return false;
-          });
-    }
-
-    eventBox->show();
-    img->show();
-    m_iconBox.pack_start(*eventBox, false, false);
-    m_iconImages.push_back(img);
-  }
-
-  if (!m_iconImages.empty()) {
-    m_iconBox.show();
+  // Moved rather than made again when the windows change order
+  if (order != m_windowIconOrder) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      m_iconBox.reorder_child(m_windowIcons.at(order[i]).eventBox, static_cast<int>(i));
+    }
+    m_windowIconOrder = std::move(order);
   }
+
+  m_iconBox.set_visible(!m_windowIcons.empty());
+}
+
+bool FancyWorkspace::initWindowIcon(WindowIcon& icon, const std::string& icon_name,
+                                    int icon_size) {
+  icon.image.set_pixel_size(icon_size);
+
+  if (icon_name.front() == '/') {
+    // File path - load from file
+    try {
+      auto pixbuf = Gdk::Pixbuf::create_from_file(icon_name, icon_size, icon_size);
+      icon.image.set(pixbuf);
+    } catch (const Glib::Error& e) {
+      spdlog::warn("[WICONS] Failed to load icon from file {}: {}", icon_name, e.what().c_str());
+      return false;
+    }
+  } else {
+    // Icon name - load from theme
+    icon.image.set_from_icon_name(icon_name, Gtk::ICON_SIZE_INVALID);
+  }
+
+  // Wrap icon in EventBox to capture clicks
+  icon.eventBox.add(icon.image);
+  icon.eventBox.set_has_tooltip(true);
+  icon.eventBox.signal_query_tooltip().connect(
+      [&icon](int, int, bool, const Glib::RefPtr<Gtk::Tooltip>& tooltip_widget) {
+        return icon.tooltip.query(tooltip_widget);
+      });
+
+  // Add click handler to focus the first window
+  icon.eventBox.signal_button_press_event().connect([this, &icon](GdkEventButton* event) -> bool {
+    if (event->button == 1) {  // Left click
+      spdlog::debug("[WICONS] Icon clicked, focusing window: {}", icon.firstAddress);
+      std::string response = m_workspaceManager.getIpc().getSocket1Reply(
+          "dispatch focuswindow address:0x" + icon.firstAddress);
+      if (response.find("ok") == std::string::npos && !response.empty()) {
+        spdlog::debug("[WICONS] Hyprland response: '{}'", response);
+      }
+      return true;
+    }
+    return false;
+  });
+
+  icon.eventBox.show_all();
+  return true;
 }
 
 bool FancyWorkspace::isEmpty() const {
-  auto ignore_list = m_workspaceManager.getIgnoredWindows();
-  if (ignore_list.empty()) {
+  if (m_workspaceManager.getIgnoredWindows().empty()) {
     return m_windows == 0;
   }
   // If there are windows but they are all ignored, consider the workspace empty
-  return std::all_of(
-      m_windowMap.begin(), m_windowMap.end(),
-      [this, &ignore_list](const auto& window_repr) { return shouldSkipWindow(window_repr); });
+  return std::all_of(m_windowMap.begin(), m_windowMap.end(),
+                     [this](const auto& window_repr) { return shouldSkipWindow(window_repr); });
 }
 
 void FancyWorkspace::setLabelText(const std::string& text) { m_labelBefore.set_markup(text); }
@@ -741,7 +642,7 @@ void FancyWorkspace::updateTaskbar(const std::string& workspace_icon) {
     }
   }
 
-  auto formatAfter = m_workspaceManager.formatAfter();
+  const auto& formatAfter = m_workspaceManager.formatAfter();
   if (!formatAfter.empty()) {
     m_labelAfter.set_markup(fmt::format(fmt::runtime(formatAfter), fmt::arg("id", id()),
                                         fmt::arg("name", name()),
@@ -767,12 +668,8 @@ bool FancyWorkspace::handleClick(const GdkEventButton* event_button,
 }
 
 bool FancyWorkspace::shouldSkipWindow(const FancyWindowRepr& window_repr) const {
-  auto ignore_list = m_workspaceManager.getIgnoredWindows();
-  auto it = std::ranges::find_if(ignore_list, [&window_repr](const auto& ignoreItem) {
-    return std::regex_match(window_repr.window_class, ignoreItem) ||
-           std::regex_match(window_repr.window_title, ignoreItem);
-  });
-  return it != ignore_list.end();
+  return m_workspaceManager.getIgnoredWindows().ignores(window_repr.window_class,
+                                                        window_repr.window_title);
 }
 
 }  // namespace waybar::modules::hyprland
@@ -3,6 +3,7 @@
 #include <gdkmm/pixbuf.h>
 #include <glibmm/fileutils.h>
 #include <glibmm/keyfile.h>
+#include <glibmm/main.h>
 #include <glibmm/miscutils.h>
 #include <json/value.h>
 #include <spdlog/spdlog.h>
@@ -13,11 +14,15 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "util/command.hpp"
+#include "util/desktop_file_index.hpp"
 #include "util/gtk_icon.hpp"
+#include "util/log.hpp"
 #include "util/regex_collection.hpp"
+#include "util/scope_guard.hpp"
 #include "util/string.hpp"
 
 namespace waybar::modules::hyprland {
@@ -36,9 +41,13 @@ FancyWorkspaces::FancyWorkspaces(const std::string& id, const Bar& bar, const Js
   m_box.get_style_context()->add_class(MODULE_CLASS);
   event_box_.add(m_box);
 
-  // Clean up old thumbnail cache on startup
-  spdlog::info("Cleaning up thumbnail cache on startup");
-  m_thumbnailCache.cleanup(0, 100);  // Remove all thumbnails
+  // The thumbnails of a previous session are of windows that are gone, once for all bars
+  static const bool cleaned = [this] {
+    spdlog::info("Cleaning up thumbnail cache on startup");
+    m_thumbnailCache.cleanup(0, 100);  // Remove all thumbnails
+    return true;
+  }();
+  (void)cleaned;
 
   setCurrentMonitorId();
   init();
@@ -46,9 +55,10 @@ FancyWorkspaces::FancyWorkspaces(const std::string& id, const Bar& bar, const Js
 }
 
 FancyWorkspaces::~FancyWorkspaces() {
+  // returns once no event handler runs anymore
   m_ipc.unregisterForIPC(this);
-  // wait for possible event handler to finish
-  std::lock_guard<std::mutex> lg(m_mutex);
+  m_titleFlush.disconnect();
+  m_idleCapture.disconnect();
 }
 
 void FancyWorkspaces::init() {
@@ -60,7 +70,7 @@ void FancyWorkspaces::init() {
 
 Json::Value FancyWorkspaces::createMonitorWorkspaceData(std::string const& name,
                                                    std::string const& monitor) {
-  spdlog::trace("Creating persistent workspace: {} on monitor {}", name, monitor);
+  WAYBAR_LOG_TRACE("Creating persistent workspace: {} on monitor {}", name, monitor);
   Json::Value workspaceData;
 
   auto workspaceId = parseWorkspaceId(name);
@@ -118,6 +128,7 @@ void FancyWorkspaces::createWorkspace(Json::Value const& workspace_data,
     return;
   }
 
+  m_sortInputs.invalidate();
   // create new workspace
   m_workspaces.emplace_back(std::make_unique<FancyWorkspace>(workspace_data, *this, clients_data));
   Gtk::Button& newWorkspaceButton = m_workspaces.back()->button();
@@ -140,12 +151,14 @@ void FancyWorkspaces::createWorkspacesToCreate() {
 /**
  *  FancyWorkspaces::doUpdate - update workspaces in UI thread.
  *
- * Note: some memberfields are modified by both UI thread and event listener thread, use m_mutex to
- *       protect these member fields, and lock should released before calling AModule::update().
+ * Note: the IPC thread only queues events with their replies, the state is the UI thread's alone
+ *       and the events are applied here first.
  */
 void FancyWorkspaces::doUpdate() {
-  std::unique_lock lock(m_mutex);
+  while (m_events.consume([this](const PendingEvent& event) { handleEvent(event); })) {
+  }
 
+  flushWindowTitles();
   removeWorkspacesToRemove();
   createWorkspacesToCreate();
   updateWorkspaceStates();
@@ -161,7 +174,7 @@ void FancyWorkspaces::doUpdate() {
 }
 
 void FancyWorkspaces::extendOrphans(int workspaceId, Json::Value const& clientsJson) {
-  spdlog::trace("Extending orphans with workspace {}", workspaceId);
+  WAYBAR_LOG_TRACE("Extending orphans with workspace {}", workspaceId);
   for (const auto& client : clientsJson) {
     if (client["workspace"]["id"].asInt() == workspaceId) {
       registerOrphanWindow({client});
@@ -169,6 +182,33 @@ void FancyWorkspaces::extendOrphans(int workspaceId, Json::Value const& clientsJ
   }
 }
 
+void FancyWorkspaces::resyncClients(Json::Value const& clientsJson) {
+  WAYBAR_LOG_TRACE("Resyncing client index from {} clients", clientsJson.size());
+  m_clients.clear();
+  for (const auto& client : clientsJson) {
+    auto address = client["address"].asString();
+    if (address.starts_with("0x")) {
+      address = address.substr(2);
+    }
+    m_clients[address] = {.workspaceName = client["workspace"]["name"].asString(),
+                          .workspaceId = client["workspace"]["id"].asInt(),
+                          .windowClass = client["class"].asString(),
+                          .windowTitle = client["title"].asString()};
+  }
+}
+
+FancyWorkspaces::ClientState* FancyWorkspaces::findClient(WindowAddress const& address) {
+  auto client = m_clients.find(address);
+  if (client == m_clients.end()) {
+    // The index missed a delta (e.g. a window that existed before an event was dropped), fall
+    // back to a full resync.
+    spdlog::debug("Window {} not in client index, resyncing", address);
+    resyncClients(m_ipc.getSocket1JsonReply("clients"));
+    client = m_clients.find(address);
+  }
+  return client != m_clients.end() ? &client->second : nullptr;
+}
+
 std::string FancyWorkspaces::getRewrite(std::string window_class, std::string window_title) {
   std::string windowReprKey;
   if (windowRewriteConfigUsesTitle()) {
@@ -207,8 +247,10 @@ void FancyWorkspaces::initializeWorkspaces() {
   }
 
   // get all current workspaces
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
-  auto const clientsJson = m_ipc.getSocket1JsonReply("clients");
+  auto const replies = m_ipc.getSocket1JsonReplies({"workspaces", "clients"});
+  auto const& workspacesJson = replies[0];
+  auto const& clientsJson = replies[1];
+  resyncClients(clientsJson);
 
   for (Json::Value workspaceJson : workspacesJson) {
     std::string workspaceName = workspaceJson["name"].asString();
@@ -238,17 +280,28 @@ bool isDoubleSpecial(std::string const& workspace_name) {
   // See hyprwm/Hyprland#3424 for more info.
   return workspace_name.find("special:special:") != std::string::npos;
 }
+
+// Older Hyprland sends a bool, newer the fullscreen mode, 1 being maximized
+bool isFullscreen(const Json::Value& client) {
+  const auto& fullscreen = client["fullscreen"];
+  return fullscreen.isBool() ? fullscreen.asBool() : fullscreen.asInt() >= 2;
+}
 }  // namespace
 
 bool FancyWorkspaces::isWorkspaceIgnored(std::string const& name) {
-  for (auto& rule : m_ignoreWorkspaces) {
-    if (std::regex_match(name, rule)) {
-      return true;
-      break;
-    }
+  if (m_ignoreWorkspaces.empty()) {
+    return false;
   }
-
-  return false;
+  // Names of the workspaces gone or renamed would pile up otherwise
+  if (m_ignoredWorkspaceNames.size() > 2 * m_workspaces.size() + 64) {
+    m_ignoredWorkspaceNames.clear();
+  }
+  auto [verdict, inserted] = m_ignoredWorkspaceNames.try_emplace(name, false);
+  if (inserted) {
+    verdict->second = std::ranges::any_of(
+        m_ignoreWorkspaces, [&name](const auto& rule) { return std::regex_match(name, rule); });
+  }
+  return verdict->second;
 }
 
 void FancyWorkspaces::loadPersistentWorkspacesFromConfig(Json::Value const& clientsJson) {
@@ -264,7 +317,7 @@ void FancyWorkspaces::loadPersistentWorkspacesFromConfig(Json::Value const& clie
     // 2. key is "*" and this monitor is not already defined in the config
     bool canCreate = key == currentMonitor || (key == "*" && !monitorInConfig);
     const Json::Value& value = m_persistentWorkspaceConfig[key];
-    spdlog::trace("Parsing persistent workspace config: {} => {}", key, value.toStyledString());
+    WAYBAR_LOG_TRACE("Parsing persistent workspace config: {} => {}", key, value.toStyledString());
 
     if (value.isInt()) {
       // value is a number => create that many workspaces for this monitor
@@ -346,41 +399,99 @@ void FancyWorkspaces::loadPersistentWorkspacesFromWorkspaceRules(const Json::Val
 }
 
 void FancyWorkspaces::onEvent(const std::string& ev) {
-  std::lock_guard<std::mutex> lock(m_mutex);
-  std::string eventName(begin(ev), begin(ev) + ev.find_first_of('>'));
-  std::string payload = ev.substr(eventName.size() + 2);
+  PendingEvent event;
+  event.name.assign(begin(ev), begin(ev) + ev.find_first_of('>'));
+  event.payload = ev.substr(event.name.size() + 2);
+
+  // Fetched here, so the UI thread doesn't wait on the socket for them
+  auto queries = eventQueries(event.name);
+  if (!queries.empty()) {
+    auto replies = m_ipc.getSocket1JsonReplies(queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+      event.replies.emplace(std::move(queries[i]), std::move(replies[i]));
+    }
+  }
+  m_events.push(std::move(event));
+
+  dp.emit();
+}
 
+std::vector<std::string> FancyWorkspaces::eventQueries(const std::string& eventName) const {
   if (eventName == "workspacev2") {
-    onWorkspaceActivated(payload);
-  } else if (eventName == "activespecial") {
-    onSpecialWorkspaceActivated(payload);
-  } else if (eventName == "destroyworkspacev2") {
-    onWorkspaceDestroyed(payload);
+    if (m_captureOnActivation && m_thumbnailCache.isAvailable()) {
+      return {"clients"};
+    }
   } else if (eventName == "createworkspacev2") {
-    onWorkspaceCreated(payload);
-  } else if (eventName == "focusedmonv2") {
-    onMonitorFocused(payload);
+    return {"workspacerules", "workspaces"};
   } else if (eventName == "moveworkspacev2") {
-    onWorkspaceMoved(payload);
-  } else if (eventName == "openwindow") {
-    onWindowOpened(payload);
-  } else if (eventName == "closewindow") {
-    onWindowClosed(payload);
-  } else if (eventName == "movewindowv2") {
-    onWindowMoved(payload);
-  } else if (eventName == "urgent") {
-    setUrgentWorkspace(payload);
-  } else if (eventName == "renameworkspace") {
-    onWorkspaceRenamed(payload);
-  } else if (eventName == "windowtitlev2") {
-    onWindowTitleEvent(payload);
+    return {"activeworkspace", "clients", "workspacerules", "workspaces"};
+  } else if (eventName == "focusedmonv2") {
+    return {"monitors"};
+  } else if (eventName == "openwindow" || eventName == "closewindow" ||
+             eventName == "movewindowv2") {
+    return {"workspaces"};
   } else if (eventName == "activewindowv2") {
-    onActiveWindowChanged(payload);
-  } else if (eventName == "configreloaded") {
-    onConfigReloaded();
+    if (m_captureOnActivation && m_thumbnailCache.isAvailable()) {
+      return {"clients"};
+    }
   }
+  return {};
+}
 
-  dp.emit();
+void FancyWorkspaces::handleEvent(const PendingEvent& event) {
+  m_handledEvent = &event;
+  // Reset however the handler returns: the event is gone after it
+  util::ScopeGuard handled([this] { m_handledEvent = nullptr; });
+  try {
+    const auto& eventName = event.name;
+    const auto& payload = event.payload;
+
+    if (eventName == "workspacev2") {
+      onWorkspaceActivated(payload);
+    } else if (eventName == "activespecial") {
+      onSpecialWorkspaceActivated(payload);
+    } else if (eventName == "destroyworkspacev2") {
+      onWorkspaceDestroyed(payload);
+    } else if (eventName == "createworkspacev2") {
+      onWorkspaceCreated(payload);
+    } else if (eventName == "focusedmonv2") {
+      onMonitorFocused(payload);
+    } else if (eventName == "moveworkspacev2") {
+      onWorkspaceMoved(payload);
+    } else if (eventName == "openwindow") {
+      onWindowOpened(payload);
+    } else if (eventName == "closewindow") {
+      onWindowClosed(payload);
+    } else if (eventName == "movewindowv2") {
+      onWindowMoved(payload);
+    } else if (eventName == "urgent") {
+      setUrgentWorkspace(payload);
+    } else if (eventName == "renameworkspace") {
+      onWorkspaceRenamed(payload);
+    } else if (eventName == "windowtitlev2") {
+      onWindowTitleEvent(payload);
+    } else if (eventName == "activewindowv2") {
+      onActiveWindowChanged(payload);
+    } else if (eventName == "configreloaded") {
+      onConfigReloaded();
+    }
+    if (eventName == "workspacev2" || eventName == "activewindowv2" || eventName == "openwindow" ||
+        eventName == "closewindow" || eventName == "movewindowv2") {
+      scheduleIdleCapture();
+    }
+  } catch (const std::exception& e) {
+    // Only this event is lost, the next ones and the rest of the update still run
+    spdlog::error("Failed to handle event {}: {}", event.name, e.what());
+  }
+}
+
+Json::Value FancyWorkspaces::eventReply(const std::string& rq) {
+  if (m_handledEvent != nullptr) {
+    if (auto it = m_handledEvent->replies.find(rq); it != m_handledEvent->replies.end()) {
+      return it->second;
+    }
+  }
+  return m_ipc.getSocket1JsonReply(rq);
 }
 
 void FancyWorkspaces::onWorkspaceActivated(std::string const& payload) {
@@ -388,22 +499,13 @@ void FancyWorkspaces::onWorkspaceActivated(std::string const& payload) {
   const auto workspaceId = parseWorkspaceId(workspaceIdStr);
   if (workspaceId.has_value()) {
     m_activeWorkspaceId = *workspaceId;
-    
-    // Kill any pending capture process from previous workspace switch
-    if (m_captureProcessPid > 0) {
-      kill(m_captureProcessPid, SIGTERM);
-      m_captureProcessPid = 0;
-    }
-    
-    // Start background capture for all windows in this workspace
-    auto workspace = std::find_if(m_workspaces.begin(), m_workspaces.end(),
-                                   [&workspaceName](const auto& ws) { return ws->name() == workspaceName; });
-    if (workspace != m_workspaces.end()) {
+
+    if (m_captureOnActivation) {
       captureThumbnailsForWorkspace(workspaceName);
     }
 
     // Track last active workspace per group for collapsed button behavior
-    auto prefix = extractProjectPrefix(workspaceName);
+    const auto& prefix = extractProjectPrefix(workspaceName);
     if (prefix) {
       // Find the workspace object to get its actual monitor
       auto workspaceIt =
@@ -418,7 +520,7 @@ void FancyWorkspaces::onWorkspaceActivated(std::string const& payload) {
         if (workspaceMonitor == barMonitor) {
           std::string key = *prefix + "@" + barMonitor;
           m_lastActivePerGroup[key] = workspaceName;
-          spdlog::trace("Tracked last active workspace: {} for key {}", workspaceName, key);
+          WAYBAR_LOG_TRACE("Tracked last active workspace: {} for key {}", workspaceName, key);
         }
       }
     }
@@ -452,8 +554,8 @@ void FancyWorkspaces::onWorkspaceCreated(std::string const& payload, Json::Value
     return;
   }
 
-  auto const workspaceRules = m_ipc.getSocket1JsonReply("workspacerules");
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
+  auto const workspaceRules = eventReply("workspacerules");
+  auto const workspacesJson = eventReply("workspaces");
 
   for (Json::Value workspaceJson : workspacesJson) {
     const auto currentId = workspaceJson["id"].asInt();
@@ -461,8 +563,8 @@ void FancyWorkspaces::onWorkspaceCreated(std::string const& payload, Json::Value
       std::string workspaceName = workspaceJson["name"].asString();
       // This workspace name is more up-to-date than the one in the event payload.
       if (isWorkspaceIgnored(workspaceName)) {
-        spdlog::trace("Not creating workspace because it is ignored: id={} name={}", *workspaceId,
-                      workspaceName);
+        WAYBAR_LOG_TRACE("Not creating workspace because it is ignored: id={} name={}",
+                         *workspaceId, workspaceName);
         break;
       }
 
@@ -499,7 +601,7 @@ void FancyWorkspaces::onWorkspaceMoved(std::string const& payload) {
   spdlog::debug("Workspace moved: {}", payload);
 
   // Update active workspace
-  m_activeWorkspaceId = (m_ipc.getSocket1JsonReply("activeworkspace"))["id"].asInt();
+  m_activeWorkspaceId = eventReply("activeworkspace")["id"].asInt();
 
   if (allOutputs()) return;
 
@@ -508,7 +610,7 @@ void FancyWorkspaces::onWorkspaceMoved(std::string const& payload) {
   const auto subPayload = makePayload(workspaceIdStr, workspaceName);
 
   if (m_bar.output->name == monitorName) {
-    Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
+    Json::Value clientsData = eventReply("clients");
     onWorkspaceCreated(subPayload, clientsData);
   } else {
     spdlog::debug("Removing workspace because it was moved to another monitor: {}", subPayload);
@@ -535,7 +637,7 @@ void FancyWorkspaces::onWorkspaceRenamed(std::string const& payload) {
 }
 
 void FancyWorkspaces::onMonitorFocused(std::string const& payload) {
-  spdlog::trace("Monitor focused: {}", payload);
+  WAYBAR_LOG_TRACE("Monitor focused: {}", payload);
 
   const auto [monitorName, workspaceIdStr] = splitDoublePayload(payload);
 
@@ -546,7 +648,7 @@ void FancyWorkspaces::onMonitorFocused(std::string const& payload) {
 
   m_activeWorkspaceId = *workspaceId;
 
-  for (Json::Value& monitor : m_ipc.getSocket1JsonReply("monitors")) {
+  for (Json::Value& monitor : eventReply("monitors")) {
     if (monitor["name"].asString() == monitorName) {
       const auto name = monitor["specialWorkspace"]["name"].asString();
       m_activeSpecialWorkspaceName = !name.starts_with("special:") ? name : name.substr(8);
@@ -555,7 +657,7 @@ void FancyWorkspaces::onMonitorFocused(std::string const& payload) {
 }
 
 void FancyWorkspaces::onWindowOpened(std::string const& payload) {
-  spdlog::trace("Window opened: {}", payload);
+  WAYBAR_LOG_TRACE("Window opened: {}", payload);
   updateWindowCount();
   size_t lastCommaIdx = 0;
   size_t nextCommaIdx = payload.find(',');
@@ -571,25 +673,35 @@ void FancyWorkspaces::onWindowOpened(std::string const& payload) {
 
   std::string windowTitle = payload.substr(nextCommaIdx + 1, payload.length() - nextCommaIdx);
 
+  m_clients[windowAddress] = {.workspaceName = workspaceName,
+                              .windowClass = windowClass,
+                              .windowTitle = windowTitle};
+
   bool isActive = m_currentActiveWindowAddress == windowAddress;
   m_windowsToCreate.emplace_back(workspaceName, windowAddress, windowClass, windowTitle, isActive);
 }
 
 void FancyWorkspaces::onWindowClosed(std::string const& addr) {
-  spdlog::trace("Window closed: {}", addr);
+  WAYBAR_LOG_TRACE("Window closed: {}", addr);
   updateWindowCount();
+  m_clients.erase(addr);
   m_orphanWindowMap.erase(addr);
-  for (auto& workspace : m_workspaces) {
-    if (workspace->closeWindow(addr)) {
-      break;
-    }
+  m_titleThrottle.forget(addr);
+  util::ThumbnailCache::forget(addr);
+  if (auto* workspace = windowWorkspace(addr); workspace != nullptr) {
+    workspace->closeWindow(addr);
   }
 }
 
 void FancyWorkspaces::onWindowMoved(std::string const& payload) {
-  spdlog::trace("Window moved: {}", payload);
+  WAYBAR_LOG_TRACE("Window moved: {}", payload);
   updateWindowCount();
-  auto [windowAddress, _, workspaceName] = splitTriplePayload(payload);
+  auto [windowAddress, workspaceIdStr, workspaceName] = splitTriplePayload(payload);
+
+  if (auto client = m_clients.find(windowAddress); client != m_clients.end()) {
+    client->second.workspaceName = workspaceName;
+    client->second.workspaceId = parseWorkspaceId(workspaceIdStr).value_or(-1);
+  }
 
   FancyWindowRepr windowRepr;
 
@@ -603,10 +715,9 @@ void FancyWorkspaces::onWindowMoved(std::string const& payload) {
   }
 
   // Take the window's representation from the old workspace...
-  for (auto& workspace : m_workspaces) {
+  if (auto* workspace = windowWorkspace(windowAddress); workspace != nullptr) {
     if (auto windowAddr = workspace->closeWindow(windowAddress); windowAddr != std::nullopt) {
       windowRepr = windowAddr.value();
-      break;
     }
   }
 
@@ -623,49 +734,66 @@ void FancyWorkspaces::onWindowMoved(std::string const& payload) {
 }
 
 void FancyWorkspaces::onWindowTitleEvent(std::string const& payload) {
-  spdlog::trace("Window title changed: {}", payload);
-  std::optional<std::function<void(FancyWindowCreationPayload)>> inserter;
+  WAYBAR_LOG_TRACE("Window title changed: {}", payload);
+  auto [windowAddress, windowTitle] = splitDoublePayload(payload);
 
-  const auto [windowAddress, _] = splitDoublePayload(payload);
+  // Held back for the next update if the window changes its title too often
+  if (m_titleThrottle.enabled()) {
+    m_titleThrottle.push(windowAddress, std::move(windowTitle));
+    return;
+  }
+  updateWindowTitle(windowAddress, windowTitle);
+}
 
-  // If the window was an orphan, rename it at the orphan's vector
-  if (m_orphanWindowMap.contains(windowAddress)) {
-    inserter = [this](FancyWindowCreationPayload wcp) { this->registerOrphanWindow(std::move(wcp)); };
-  } else {
-    auto windowWorkspace = std::ranges::find_if(m_workspaces, [windowAddress](auto& workspace) {
-      return workspace->containsWindow(windowAddress);
-    });
+void FancyWorkspaces::updateWindowTitle(WindowAddress const& windowAddress,
+                                        std::string const& windowTitle) {
+  // The representation only changes with the title
+  auto* client = findClient(windowAddress);
+  if (client == nullptr || client->windowTitle == windowTitle) {
+    return;
+  }
+  client->windowTitle = windowTitle;
 
-    // If the window exists on a workspace, rename it at the workspace's window
-    // map
-    if (windowWorkspace != m_workspaces.end()) {
-      inserter = [windowWorkspace](FancyWindowCreationPayload wcp) {
-        (*windowWorkspace)->insertWindow(std::move(wcp));
-      };
-    } else {
-      auto queuedWindow =
-          std::ranges::find_if(m_windowsToCreate, [&windowAddress](auto& windowPayload) {
-            return windowPayload.getAddress() == windowAddress;
-          });
+  FancyWindowCreationPayload payload{client->workspaceName, windowAddress, client->windowClass,
+                                     client->windowTitle,
+                                     windowAddress == m_currentActiveWindowAddress};
 
-      // If the window was queued, rename it in the queue
-      if (queuedWindow != m_windowsToCreate.end()) {
-        inserter = [queuedWindow](FancyWindowCreationPayload wcp) { *queuedWindow = std::move(wcp); };
-      }
-    }
+  // If the window was an orphan, rename it at the orphan's vector
+  if (m_orphanWindowMap.contains(windowAddress)) {
+    registerOrphanWindow(std::move(payload));
+    return;
   }
 
-  if (inserter.has_value()) {
-    Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
-    std::string jsonWindowAddress = fmt::format("0x{}", windowAddress);
+  // If the window exists on a workspace, rename it at the workspace's window
+  // map
+  if (auto* workspace = windowWorkspace(windowAddress); workspace != nullptr) {
+    workspace->insertWindow(std::move(payload));
+    return;
+  }
 
-    auto client = std::ranges::find_if(clientsData, [jsonWindowAddress](auto& client) {
-      return client["address"].asString() == jsonWindowAddress;
-    });
+  // If the window was queued, rename it in the queue
+  auto queuedWindow =
+      std::ranges::find_if(m_windowsToCreate, [&windowAddress](auto& windowPayload) {
+        return windowPayload.getAddress() == windowAddress;
+      });
+  if (queuedWindow != m_windowsToCreate.end()) {
+    *queuedWindow = std::move(payload);
+  }
+}
 
-    if (client != clientsData.end() && !client->empty()) {
-      (*inserter)({*client});
-    }
+void FancyWorkspaces::flushWindowTitles() {
+  auto next = m_titleThrottle.flush(
+      [this](WindowAddress const& address, std::string const& title) {
+        updateWindowTitle(address, title);
+      });
+  // the titles held back are applied by the update following their interval
+  if (next && !m_titleFlush.connected()) {
+    m_titleFlush = Glib::signal_timeout().connect(
+        [this] {
+          dp.emit();
+          return false;
+        },
+        next->count());
   }
 }
 
@@ -674,22 +802,22 @@ void FancyWorkspaces::onActiveWindowChanged(WindowAddress const& activeWindowAdd
   m_currentActiveWindowAddress = activeWindowAddress;
 
   // Capture thumbnail of the newly active window (async)
-  if (!activeWindowAddress.empty() && m_thumbnailCache.isAvailable()) {
+  if (m_captureOnActivation && !activeWindowAddress.empty() && m_thumbnailCache.isAvailable()) {
     spdlog::debug("[THUMBNAIL] Starting capture process for {}", activeWindowAddress);
-    Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
+    Json::Value clientsData = eventReply("clients");
     std::string jsonWindowAddress = "0x" + activeWindowAddress;
     
     auto client = std::ranges::find_if(clientsData, [&jsonWindowAddress](auto& client) {
       return client["address"].asString() == jsonWindowAddress;
     });
     
-    if (client != clientsData.end() && !client->empty()) {
+    if (client != clientsData.end() && !client->empty() && !isFullscreen(*client)) {
       int workspaceId = (*client)["workspace"]["id"].asInt();
       
       spdlog::debug("[THUMBNAIL] Window workspace ID: {}, active workspace ID: {}", 
                     workspaceId, m_activeWorkspaceId);
       
-      // Capture the window (the 300ms delay in captureWindow will let animation finish)
+      // Capture the window (the settle delay in captureWindow will let animation finish)
       int x = (*client)["at"][0].asInt();
       int y = (*client)["at"][1].asInt();
       int w = (*client)["size"][0].asInt();
@@ -701,7 +829,7 @@ void FancyWorkspaces::onActiveWindowChanged(WindowAddress const& activeWindowAdd
       spdlog::debug("[THUMBNAIL] Capturing active window {} ({}x{} at {},{})", 
                     activeWindowAddress, w, h, x, y);
       
-      // Capture async (with 300ms delay for animation)
+      // Capture async (after the settle delay for animation)
       m_thumbnailCache.captureWindow(activeWindowAddress, x, y, w, h,
                                      windowClass, windowTitle, workspaceName);
     }
@@ -720,6 +848,7 @@ void FancyWorkspaces::onActiveWindowChanged(WindowAddress const& activeWindowAdd
 
 void FancyWorkspaces::onConfigReloaded() {
   spdlog::info("Hyprland config reloaded, reinitializing hyprland/workspaces module...");
+  m_ignoredWorkspaceNames.clear();
   init();
 }
 
@@ -773,16 +902,41 @@ auto FancyWorkspaces::parseConfig(const Json::Value& config) -> void {
                  m_windowIconSize);
   }
 
+  if (const auto& capture = config["thumbnail-capture"]; capture.isArray()) {
+    auto has = [&capture](const char* trigger) {
+      return std::ranges::any_of(capture, [trigger](const auto& t) { return t == trigger; });
+    };
+    m_captureOnLeave = has("leave");
+    m_captureOnIdle = has("idle");
+    m_captureOnActivation = has("activation");
+  }
+  if (config["thumbnail-idle-delay"].isUInt()) {
+    m_captureIdleDelay = std::chrono::milliseconds(config["thumbnail-idle-delay"].asUInt());
+  }
+  if (config["thumbnail-settle-delay"].isUInt()) {
+    util::ThumbnailCache::setSettleDelay(
+        std::chrono::milliseconds(config["thumbnail-settle-delay"].asUInt()));
+  }
+  if (config["thumbnail-recapture-interval"].isUInt()) {
+    util::ThumbnailCache::setRecaptureInterval(
+        std::chrono::milliseconds(config["thumbnail-recapture-interval"].asUInt()));
+  }
+  if (config["thumbnail-cache-size"].isUInt()) {
+    util::ThumbnailCache::setPixbufCacheLimit(
+        static_cast<size_t>(config["thumbnail-cache-size"].asUInt()) * 1024 * 1024);
+  }
+
   m_persistentWorkspaceConfig = config.get("persistent-workspaces", Json::Value());
   
-  m_onWorkspaceCreated = config.get("on-workspace-created", "").asString();
-  m_onWorkspaceDestroyed = config.get("on-workspace-destroyed", "").asString();
+  m_onWorkspaceCreated = HookTemplate(config.get("on-workspace-created", "").asString());
+  m_onWorkspaceDestroyed = HookTemplate(config.get("on-workspace-destroyed", "").asString());
   
   if (!m_onWorkspaceCreated.empty()) {
-    spdlog::info("Workspace hook: on-workspace-created = {}", m_onWorkspaceCreated);
+    spdlog::info("Workspace hook: on-workspace-created = {}", m_onWorkspaceCreated.command());
   }
   if (!m_onWorkspaceDestroyed.empty()) {
-    spdlog::info("Workspace hook: on-workspace-destroyed = {}", m_onWorkspaceDestroyed);
+    spdlog::info("Workspace hook: on-workspace-destroyed = {}",
+                 m_onWorkspaceDestroyed.command());
   }
   
   populateSortByConfig(config);
@@ -830,6 +984,7 @@ auto FancyWorkspaces::populateSortByConfig(const Json::Value& config) -> void {
 }
 
 auto FancyWorkspaces::populateIgnoreWorkspacesConfig(const Json::Value& config) -> void {
+  m_ignoredWorkspaceNames.clear();
   auto ignoreWorkspaces = config["ignore-workspaces"];
   if (ignoreWorkspaces.isArray()) {
     for (const auto& workspaceRegex : ignoreWorkspaces) {
@@ -865,9 +1020,15 @@ auto FancyWorkspaces::populateWindowRewriteConfig(const Json::Value& config) ->
   std::string windowRewriteDefault =
       windowRewriteDefaultConfig.isString() ? windowRewriteDefaultConfig.asString() : "?";
 
+  const auto& titleInterval = config["window-title-interval"];
+  m_titleThrottle.setInterval(
+      std::chrono::milliseconds(titleInterval.isUInt() ? titleInterval.asUInt() : 0));
+
+  const auto& cacheSize = config["window-rewrite-cache-size"];
   m_windowRewriteRules = util::RegexCollection(
       windowRewrite, windowRewriteDefault,
-      [this](std::string& window_rule) { return windowRewritePriorityFunction(window_rule); });
+      [this](std::string& window_rule) { return windowRewritePriorityFunction(window_rule); },
+      cacheSize.isUInt() ? cacheSize.asUInt() : util::RegexCollection::DEFAULT_CACHE_CAPACITY);
 }
 
 auto FancyWorkspaces::populateWorkspaceTaskbarConfig(const Json::Value& config) -> void {
@@ -918,14 +1079,7 @@ auto FancyWorkspaces::populateWorkspaceTaskbarConfig(const Json::Value& config)
   }
 
   if (workspaceTaskbar["ignore-list"].isArray()) {
-    for (auto& windowRegex : workspaceTaskbar["ignore-list"]) {
-      std::string ruleString = windowRegex.asString();
-      try {
-        m_ignoreWindows.emplace_back(ruleString, std::regex_constants::icase);
-      } catch (const std::regex_error& e) {
-        spdlog::error("Invalid rule {}: {}", ruleString, e.what());
-      }
-    }
+    m_ignoreWindows.load(workspaceTaskbar["ignore-list"]);
   }
 
   if (workspaceTaskbar["active-window-position"].isString()) {
@@ -1011,13 +1165,14 @@ void FancyWorkspaces::removeWorkspace(std::string const& workspaceString) {
   }
 
   if ((*workspace)->isPersistentConfig()) {
-    spdlog::trace("Not removing config persistent workspace id={} name={}", (*workspace)->id(),
-                  (*workspace)->name());
+    WAYBAR_LOG_TRACE("Not removing config persistent workspace id={} name={}",
+                     (*workspace)->id(), (*workspace)->name());
     return;
   }
 
   m_box.remove(workspace->get()->button());
   m_workspaces.erase(workspace);
+  m_sortInputs.invalidate();
 }
 
 void FancyWorkspaces::setCurrentMonitorId() {
@@ -1031,7 +1186,7 @@ void FancyWorkspaces::setCurrentMonitorId() {
     spdlog::error("Monitor '{}' does not have an ID? Using 0", m_bar.output->name);
   } else {
     m_monitorId = (*currentMonitor)["id"].asInt();
-    spdlog::trace("Current monitor ID: {}", m_monitorId);
+    WAYBAR_LOG_TRACE("Current monitor ID: {}", m_monitorId);
   }
 }
 
@@ -1070,83 +1225,90 @@ void FancyWorkspaces::sortSpecialCentered() {
 }
 
 void FancyWorkspaces::sortWorkspaces() {
-  std::ranges::sort(  //
-      m_workspaces, [&](std::unique_ptr<FancyWorkspace>& a, std::unique_ptr<FancyWorkspace>& b) {
-        // Helper comparisons
-        auto isIdLess = a->id() < b->id();
-        auto isNameLess = a->name() < b->name();
-
-        switch (m_sortBy) {
-          case SortMethod::ID:
-            return isIdLess;
-          case SortMethod::NAME:
-            return isNameLess;
-          case SortMethod::NUMBER:
-            try {
-              return std::stoi(a->name()) < std::stoi(b->name());
-            } catch (const std::invalid_argument&) {
-              // Handle the exception if necessary.
-              break;
-            }
-          case SortMethod::DEFAULT:
-          default:
-            // Handle the default case here.
-            // normal -> named persistent -> named -> special -> named special
-
-            // both normal (includes numbered persistent) => sort by ID
-            if (a->id() > 0 && b->id() > 0) {
-              return isIdLess;
-            }
-
-            // one normal, one special => normal first
-            if ((a->isSpecial()) ^ (b->isSpecial())) {
-              return b->isSpecial();
-            }
-
-            // only one normal, one named
-            if ((a->id() > 0) ^ (b->id() > 0)) {
-              return a->id() > 0;
-            }
-
-            // both special
-            if (a->isSpecial() && b->isSpecial()) {
-              // if one is -99 => put it last
-              if (a->id() == -99 || b->id() == -99) {
-                return b->id() == -99;
-              }
-              // both are 0 (not yet named persistents) / named specials
-              // (-98 <= ID <= -1)
-              return isNameLess;
-            }
-
-            // sort non-special named workspaces by name (ID <= -1377)
-            return isNameLess;
-            break;
-        }
+  auto inputs = [this] {
+    std::vector<WorkspaceSortInputs::Entry> entries;
+    entries.reserve(m_workspaces.size());
+    for (const auto& workspace : m_workspaces) {
+      entries.push_back({workspace.get(), workspace->id(), workspace->isSpecial(),
+                         workspace->button().is_visible(), workspace->name()});
+    }
+    return entries;
+  };
+  if (!m_sortInputs.changed(inputs())) {
+    return;
+  }
+
+  auto less = defaultLess;
+  switch (m_sortBy) {
+    case SortMethod::ID:
+      less = idLess;
+      break;
+    case SortMethod::NAME:
+      less = nameLess;
+      break;
+    case SortMethod::NUMBER:
+      less = numberLess;
+      break;
+    case SortMethod::SPECIAL_CENTERED:
+    case SortMethod::DEFAULT:
+    default:
+      break;
+  }
+
+  // The keys view the names of the workspaces, which stay where they are while sorted
+  std::vector<std::pair<WorkspaceSortKey, std::unique_ptr<FancyWorkspace>>> sorted;
+  sorted.reserve(m_workspaces.size());
+  for (auto& workspace : m_workspaces) {
+    auto key = workspaceSortKey(workspace->id(), workspace->name(), workspace->isSpecial());
+    sorted.emplace_back(key, std::move(workspace));
+  }
+  std::ranges::sort(sorted, less, &decltype(sorted)::value_type::first);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    m_workspaces[i] = std::move(sorted[i].second);
+  }
 
-        // Return a default value if none of the cases match.
-        return isNameLess;  // You can adjust this to your specific needs.
-      });
   if (m_sortBy == SortMethod::SPECIAL_CENTERED) {
     this->sortSpecialCentered();
   }
+  m_sortInputs.record(inputs());
 
-  for (size_t i = 0; i < m_workspaces.size(); ++i) {
-    m_box.reorder_child(m_workspaces[i]->button(), i);
+  // With the project features on, the box is ordered along with the group widgets
+  if (m_collapseInactiveProjects || m_transformWorkspaceNames) {
+    return;
+  }
+  std::vector<Gtk::Widget*> order;
+  order.reserve(m_workspaces.size());
+  for (auto& workspace : m_workspaces) {
+    order.push_back(&workspace->button());
+  }
+  reorderBox(order);
+}
+
+FancyWorkspace* FancyWorkspaces::windowWorkspace(WindowAddress const& addr) const {
+  auto it = m_windowIndex.find(addr);
+  return it != m_windowIndex.end() ? it->second : nullptr;
+}
+
+void FancyWorkspaces::indexWindow(WindowAddress const& addr, FancyWorkspace* workspace) {
+  m_windowIndex[addr] = workspace;
+}
+
+void FancyWorkspaces::unindexWindow(WindowAddress const& addr, const FancyWorkspace* workspace) {
+  // a window moved meanwhile belongs to its new workspace
+  if (auto it = m_windowIndex.find(addr); it != m_windowIndex.end() && it->second == workspace) {
+    m_windowIndex.erase(it);
   }
 }
 
 void FancyWorkspaces::setUrgentWorkspace(std::string const& windowaddress) {
-  const Json::Value clientsJson = m_ipc.getSocket1JsonReply("clients");
   int workspaceId = -1;
+  std::string workspaceName;
   std::string fullAddress;
 
-  for (Json::Value clientJson : clientsJson) {
-    if (clientJson["address"].asString().ends_with(windowaddress)) {
-      workspaceId = clientJson["workspace"]["id"].asInt();
-      fullAddress = clientJson["address"].asString();
-      break;
-    }
+  if (const auto* client = findClient(windowaddress); client != nullptr) {
+    workspaceId = client->workspaceId;
+    workspaceName = client->workspaceName;
+    fullAddress = "0x" + windowaddress;
   }
 
   // Track the specific urgent window address
@@ -1156,8 +1318,14 @@ void FancyWorkspaces::setUrgentWorkspace(std::string const& windowaddress) {
   }
 
   auto workspace = std::ranges::find_if(
-      m_workspaces,
-      [workspaceId](std::unique_ptr<FancyWorkspace>& x) { return x->id() == workspaceId; });
+      m_workspaces, [workspaceId, &workspaceName](std::unique_ptr<FancyWorkspace>& x) {
+        if (workspaceId != -1) {
+          return x->id() == workspaceId;
+        }
+        // windows opened after the last resync only know their workspace by name
+        return !workspaceName.empty() &&
+               (x->name() == workspaceName || "special:" + x->name() == workspaceName);
+      });
   if (workspace != m_workspaces.end()) {
     workspace->get()->setUrgent();
   }
@@ -1169,7 +1337,7 @@ auto FancyWorkspaces::update() -> void {
 }
 
 void FancyWorkspaces::updateWindowCount() {
-  const Json::Value workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
+  const Json::Value workspacesJson = eventReply("workspaces");
   for (auto const& workspace : m_workspaces) {
     auto workspaceJson = std::ranges::find_if(workspacesJson, [&](Json::Value const& x) {
       return x["name"].asString() == workspace->name() ||
@@ -1323,13 +1491,17 @@ std::optional<int> FancyWorkspaces::parseWorkspaceId(std::string const& workspac
   }
 }
 
-std::optional<std::string> FancyWorkspaces::extractProjectPrefix(const std::string& workspaceName) {
-  static std::regex pattern(R"(^\.(\d*[a-zA-Z]+)\d+)");
-  std::smatch match;
-  if (std::regex_search(workspaceName, match, pattern)) {
-    return "." + match[1].str();
+const std::optional<std::string>& FancyWorkspaces::extractProjectPrefix(
+    const std::string& workspaceName) {
+  auto [cached, inserted] = m_projectPrefixes.try_emplace(workspaceName);
+  if (inserted) {
+    static std::regex pattern(R"(^\.(\d*[a-zA-Z]+)\d+)");
+    std::smatch match;
+    if (std::regex_search(workspaceName, match, pattern)) {
+      cached->second = "." + match[1].str();
+    }
   }
-  return std::nullopt;
+  return cached->second;
 }
 
 std::string FancyWorkspaces::extractNumber(const std::string& workspaceName) {
@@ -1355,63 +1527,43 @@ std::vector<FancyWorkspaces::WindowInfo> FancyWorkspaces::getWorkspaceWindows(Fa
 }
 
 std::optional<std::string> FancyWorkspaces::getIconNameForClass(const std::string& windowClass) {
-  // Reuse the icon lookup logic from workspace.cpp
-  // For now, we'll include the helper functions directly
-
-  auto data_dirs = Glib::get_system_data_dirs();
-  data_dirs.insert(data_dirs.begin(), Glib::get_user_data_dir());
-
-  // Helper to find desktop file
-  auto getDesktopFile = [&](const std::string& appId) -> std::optional<std::string> {
-    for (const auto& data_dir : data_dirs) {
-      const auto data_app_dir = data_dir + "/applications/";
-      if (!std::filesystem::exists(data_app_dir)) continue;
-
-      for (const auto& entry : std::filesystem::recursive_directory_iterator(data_app_dir)) {
-        if (entry.is_regular_file()) {
-          std::string filename = entry.path().filename().string();
-          std::string suffix = appId + ".desktop";
-
-          if (filename.size() >= suffix.size()) {
-            std::string lowerFilename = filename;
-            std::string lowerSuffix = suffix;
-            std::transform(lowerFilename.begin(), lowerFilename.end(), lowerFilename.begin(),
-                           ::tolower);
-            std::transform(lowerSuffix.begin(), lowerSuffix.end(), lowerSuffix.begin(), ::tolower);
-
-            if (lowerFilename.compare(lowerFilename.size() - lowerSuffix.size(), lowerSuffix.size(),
-                                      lowerSuffix) == 0) {
-              return entry.path().string();
-            }
-          }
-        }
+  // Results are dropped whenever the desktop file index is invalidated. The cache is per instance,
+  // and only the GTK thread reads and fills it.
+  auto& desktopFiles = util::DesktopFileIndex::inst();
+  if (m_iconNameCacheGeneration != desktopFiles.generation()) {
+    m_iconNameCache.clear();
+    m_iconNameCacheGeneration = desktopFiles.generation();
+  }
+  if (auto cached = m_iconNameCache.find(windowClass); cached != m_iconNameCache.end()) {
+    return cached->second;
+  }
+
+  auto resolve = [&]() -> std::optional<std::string> {
+    auto desktopFile = desktopFiles.findBySuffix({windowClass + ".desktop"}, true);
+    if (desktopFile.has_value()) {
+      auto iconName = desktopFiles.getIconName(desktopFile.value());
+      if (iconName.has_value()) {
+        return iconName;
       }
+      // Fall through to heuristics
     }
-    return std::nullopt;
-  };
 
-  auto desktopFile = getDesktopFile(windowClass);
-  if (desktopFile.has_value()) {
-    try {
-      Glib::KeyFile keyfile;
-      keyfile.load_from_file(desktopFile.value());
-      return keyfile.get_string("Desktop Entry", "Icon");
-    } catch (...) {
-      // Fall through to heuristics
+    // Try heuristics
+    if (DefaultGtkIconThemeWrapper::has_icon(windowClass)) {
+      return windowClass;
     }
-  }
 
-  // Try heuristics
-  if (DefaultGtkIconThemeWrapper::has_icon(windowClass)) {
-    return windowClass;
-  }
+    auto desktopSuffix = windowClass + "-desktop";
+    if (DefaultGtkIconThemeWrapper::has_icon(desktopSuffix)) {
+      return desktopSuffix;
+    }
 
-  auto desktopSuffix = windowClass + "-desktop";
-  if (DefaultGtkIconThemeWrapper::has_icon(desktopSuffix)) {
-    return desktopSuffix;
-  }
+    return std::nullopt;
+  };
 
-  return std::nullopt;
+  auto iconName = resolve();
+  m_iconNameCache.emplace(windowClass, iconName);
+  return iconName;
 }
 
 bool FancyWorkspaces::isWorkspaceInActiveGroup(const std::string& workspaceName) {
@@ -1425,8 +1577,8 @@ bool FancyWorkspaces::isWorkspaceInActiveGroup(const std::string& workspaceName)
   }
 
   // Extract project prefix from both workspaces
-  auto activePrefix = extractProjectPrefix((*activeWorkspace)->name());
-  auto thisPrefix = extractProjectPrefix(workspaceName);
+  const auto& activePrefix = extractProjectPrefix((*activeWorkspace)->name());
+  const auto& thisPrefix = extractProjectPrefix(workspaceName);
 
   // Both must have a prefix and they must match
   if (!activePrefix.has_value() || !thisPrefix.has_value()) {
@@ -1438,28 +1590,6 @@ bool FancyWorkspaces::isWorkspaceInActiveGroup(const std::string& workspaceName)
   return activePrefix.value() == thisPrefix.value();
 }
 
-int FancyWorkspaces::countWorkspacesInProject(const std::string& prefix) {
-  int count = 0;
-  for (const auto& ws : m_workspaces) {
-    auto wsPrefix = extractProjectPrefix(ws->name());
-    if (wsPrefix && *wsPrefix == prefix) {
-      count++;
-    }
-  }
-  return count;
-}
-
-std::unique_ptr<Gtk::Button> FancyWorkspaces::createLabelButton(const std::string& text) {
-  auto btn = std::make_unique<Gtk::Button>();
-  btn->set_label(text);
-  btn->set_relief(Gtk::RELIEF_NONE);
-  btn->set_sensitive(false);  // Non-clickable
-  btn->get_style_context()->add_class("workspace-label");
-  btn->get_style_context()->add_class("grouped");  // For CSS spacing
-  btn->get_style_context()->add_class(MODULE_CLASS);
-  return btn;
-}
-
 std::string FancyWorkspaces::selectBestWindowForIcon(
     const std::vector<std::string>& addresses,
     const std::map<std::string, std::string>& addressToWorkspace, const std::string& groupPrefix,
@@ -1513,6 +1643,28 @@ std::string FancyWorkspaces::selectBestWindowForIcon(
   return addresses[0];
 }
 
+namespace {
+void addOrRemoveClass(const Glib::RefPtr<Gtk::StyleContext>& context, bool condition,
+                      const std::string& class_name) {
+  if (condition) {
+    context->add_class(class_name);
+  } else {
+    context->remove_class(class_name);
+  }
+}
+
+void setGroupedClasses(Gtk::Button& button, bool grouped, bool activeGroup) {
+  auto context = button.get_style_context();
+  addOrRemoveClass(context, grouped, "grouped");  // For CSS spacing
+  addOrRemoveClass(context, activeGroup, "active-group");
+}
+}  // namespace
+
+/**
+ * Groups are kept across updates along with their widgets: each update refreshes the groups'
+ * members and state, adjusts the widgets in place and reorders the box only when its order
+ * changed.
+ */
 void FancyWorkspaces::applyProjectCollapsing() {
   // Check if any feature is enabled
   if (!m_collapseInactiveProjects && !m_transformWorkspaceNames) {
@@ -1520,60 +1672,51 @@ void FancyWorkspaces::applyProjectCollapsing() {
     return;
   }
 
-  // spdlog::debug("Workspace project collapsing/transform: processing {} workspaces",
-  //               m_workspaces.size());
-
-  // Group workspaces by project prefix
-  struct ProjectGroup {
-    std::string prefix;
-    std::vector<FancyWorkspace*> workspaces;
-    bool hasActive = false;
-    bool hasWindows = false;  // Track if any workspace in group has windows
-    bool hasUrgent = false;   // Track if any workspace in group is urgent
-    int firstPosition = -1;
-  };
+  // Names of the workspaces gone or renamed would pile up otherwise
+  if (m_projectPrefixes.size() > 2 * m_workspaces.size() + 8) {
+    m_projectPrefixes.clear();
+  }
 
-  std::map<std::string, ProjectGroup> groups;
+  for (auto& [prefix, group] : m_projectGroups) {
+    group.workspaces.clear();
+    group.hasActive = false;
+    group.hasWindows = false;
+    group.hasUrgent = false;
+    group.placed = false;
+  }
 
-  // Get current bar's monitor for filtering
+  // Group workspaces by project prefix, only the ones of the current bar's monitor
   std::string currentMonitor = getBarOutput();
+  std::vector<ProjectGroup*> workspaceGroups(m_workspaces.size(), nullptr);
 
   for (size_t i = 0; i < m_workspaces.size(); ++i) {
     auto& workspace = m_workspaces[i];
-    auto prefix = extractProjectPrefix(workspace->name());
+    const auto& prefix = extractProjectPrefix(workspace->name());
 
-    spdlog::trace("Workspace '{}' -> prefix: {}", workspace->name(), prefix ? *prefix : "none");
+    WAYBAR_LOG_TRACE("Workspace '{}' -> prefix: {}", workspace->name(), prefix ? *prefix : "none");
 
-    // Only include workspaces from current monitor in groups
     if (prefix && workspace->output() == currentMonitor) {
-      auto& group = groups[*prefix];
-      group.prefix = *prefix;
+      auto& group = m_projectGroups[*prefix];
       group.workspaces.push_back(workspace.get());
-
-      if (workspace->isActive()) {
-        group.hasActive = true;
-      }
-
-      if (workspace->isUrgent()) {
-        group.hasUrgent = true;
-      }
-
+      group.hasActive = group.hasActive || workspace->isActive();
+      group.hasUrgent = group.hasUrgent || workspace->isUrgent();
       // Check if this workspace has windows by checking if it has "empty" CSS class
-      auto styleContext = workspace->button().get_style_context();
-      if (!styleContext->has_class("empty")) {
-        group.hasWindows = true;
-      }
-
-      if (group.firstPosition == -1) {
-        group.firstPosition = i;
-      }
+      group.hasWindows =
+          group.hasWindows || !workspace->button().get_style_context()->has_class("empty");
+      workspaceGroups[i] = &group;
     }
   }
 
-  // spdlog::debug("Workspace project features: found {} project groups", groups.size());
+  for (auto it = m_projectGroups.begin(); it != m_projectGroups.end();) {
+    auto& [prefix, group] = *it;
+    if (group.workspaces.empty()) {
+      dropCollapsedWidgets(group);
+      dropExpandedWidgets(group);
+      it = m_projectGroups.erase(it);
+      continue;
+    }
 
-  // Sort workspaces within each group numerically by their number
-  for (auto& [prefix, group] : groups) {
+    // Sort workspaces within the group numerically by their number
     std::sort(group.workspaces.begin(), group.workspaces.end(),
               [this](FancyWorkspace* a, FancyWorkspace* b) {
                 std::string numA = extractNumber(a->name());
@@ -1584,488 +1727,478 @@ void FancyWorkspaces::applyProjectCollapsing() {
                   return a->name() < b->name();  // Fallback to name comparison
                 }
               });
-  }
 
-  // Clear old collapsed groups
-  for (auto* groupBox : m_collapsedGroups) {
-    m_box.remove(*groupBox);
+    layoutProjectGroup(prefix, group);
+    ++it;
   }
-  m_collapsedGroups.clear();
 
-  // Clear old expanded group boxes
-  for (auto* groupBox : m_expandedGroupBoxes) {
-    m_box.remove(*groupBox);
-  }
-  m_expandedGroupBoxes.clear();
+  // The box in order: a collapsed or expanded group takes the place of its first workspace
+  std::vector<Gtk::Widget*> order;
+  order.reserve(m_workspaces.size() + 2 * m_projectGroups.size());
+  for (size_t i = 0; i < m_workspaces.size(); ++i) {
+    auto* group = workspaceGroups[i];
+    if (group == nullptr || group->layout == ProjectLayout::PLAIN) {
+      if (group == nullptr) {
+        setGroupedClasses(m_workspaces[i]->button(), false, false);
+      }
+      order.push_back(&m_workspaces[i]->button());
+      continue;
+    }
+    if (group->placed) {
+      continue;
+    }
+    group->placed = true;
 
-  for (auto& btn : m_labelButtons) {
-    m_box.remove(*btn);
+    if (group->layout == ProjectLayout::COLLAPSED) {
+      order.push_back(group->collapsedBox);
+    } else {
+      order.push_back(group->startBox);
+    }
+    for (auto* ws : group->workspaces) {
+      order.push_back(&ws->button());
+    }
+    if (group->layout == ProjectLayout::EXPANDED) {
+      order.push_back(group->endBox);
+    }
   }
-  m_labelButtons.clear();
-
-  // Apply collapsing/transform logic
-  // Track position offset as groups add elements
-  int positionOffset = 0;
-
-  for (auto& [prefix, group] : groups) {
-    std::string cleanPrefix = prefix.substr(1);  // Remove leading dot
+  reorderBox(order);
+}
 
-    // Decide what to do based on enabled features
-    bool shouldCollapse =
-        m_collapseInactiveProjects && !group.hasActive && group.workspaces.size() > 1;
-    bool shouldTransform = m_transformWorkspaceNames;
+void FancyWorkspaces::layoutProjectGroup(const std::string& prefix, ProjectGroup& group) {
+  std::string cleanPrefix = prefix.substr(1);  // Remove leading dot
+  bool multiple = group.workspaces.size() > 1;
 
-    // Choose display name based on transform flag
-    std::string displayPrefix = shouldTransform ? cleanPrefix : prefix;
+  // Decide what to do based on enabled features
+  if (m_collapseInactiveProjects && !group.hasActive && multiple) {
+    group.layout = ProjectLayout::COLLAPSED;
+  } else if (m_transformWorkspaceNames && multiple) {
+    group.layout = ProjectLayout::EXPANDED;
+  } else {
+    group.layout = ProjectLayout::PLAIN;
+  }
 
-    // Track elements added by this group
-    int elementsAdded = 0;
+  if (group.layout != ProjectLayout::COLLAPSED) {
+    dropCollapsedWidgets(group);
+  }
+  if (group.layout != ProjectLayout::EXPANDED) {
+    dropExpandedWidgets(group);
+  }
 
-    if (shouldCollapse) {
+  switch (group.layout) {
+    case ProjectLayout::COLLAPSED:
       // Collapse: hide individual workspaces, show [prefix] with icons as sibling buttons
-      // spdlog::debug("Workspace group '{}' -> collapsing to [{}]", prefix, displayPrefix);
+      updateCollapsedGroup(prefix, group, m_transformWorkspaceNames ? cleanPrefix : prefix);
       for (auto* ws : group.workspaces) {
+        setGroupedClasses(ws->button(), false, false);
         ws->button().hide();
       }
+      break;
 
-      // Create container box for the group (not a button!)
-      auto* groupBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
-      groupBox->get_style_context()->add_class("collapsed-project");  // Backward compat
-      groupBox->get_style_context()->add_class("collapsed-project-group");
-
-      // Add opening bracket label
-      auto* openBracket = Gtk::manage(new Gtk::Label("["));
-      groupBox->pack_start(*openBracket, false, false);
-
-      // Create label button: prefix (without brackets)
-      auto* labelBtn = Gtk::manage(new Gtk::Button());
-      labelBtn->set_relief(Gtk::RELIEF_NONE);
-      labelBtn->get_style_context()->add_class("collapsed-project-label");
-      labelBtn->get_style_context()->add_class(MODULE_CLASS);
-      labelBtn->set_label(displayPrefix);  // Just the prefix, no brackets
-
-      // Add click handler for label - switches to workspace
-      FancyWorkspace* firstWorkspace = group.workspaces[0];
-      std::string groupPrefix = prefix;  // Capture by value
-      labelBtn->signal_clicked().connect([this, firstWorkspace, groupPrefix]() {
-        try {
-          // Build compound key for this group+monitor
-          std::string monitor = getBarOutput();
-          std::string key = groupPrefix + "@" + monitor;
-
-          // Look up last active workspace for this group
-          std::string workspaceName;
-          auto it = m_lastActivePerGroup.find(key);
-          if (it != m_lastActivePerGroup.end()) {
-            workspaceName = it->second;
-            spdlog::debug("Workspace collapsed label '{}' clicked: switching to last active {}",
-                          groupPrefix, workspaceName);
-          } else {
-            // No history, fall back to first workspace
-            workspaceName = firstWorkspace->name();
-            spdlog::debug(
-                "Workspace collapsed label '{}' clicked: no history, switching to first {}",
-                groupPrefix, workspaceName);
-          }
-
-          m_ipc.getSocket1Reply("dispatch workspace name:" + workspaceName);
-        } catch (const std::exception& e) {
-          spdlog::error("Workspace group label click failed: {}", e.what());
-        }
-      });
-
-      // Add right-click handler for label - cleanup empty workspaces
-      std::vector<FancyWorkspace*> groupWorkspaces = group.workspaces;  // Capture by value
-      labelBtn->signal_button_press_event().connect([this, groupWorkspaces, groupPrefix](GdkEventButton* bt) {
-        if (bt->type == GDK_BUTTON_PRESS && bt->button == 3) {
-          spdlog::debug("Right-click on collapsed group '{}', removing empty workspaces", groupPrefix);
-          for (auto* ws : groupWorkspaces) {
-            if (ws->isEmpty()) {
-              std::string cmd = "waybar-workspace-remove.sh " + ws->name();
-              util::command::res result = util::command::exec(cmd, "workspace-remove");
-              if (result.exit_code == 0) {
-                spdlog::info("Removed workspace '{}'", ws->name());
-              } else {
-                spdlog::warn("Workspace removal failed: {}", result.out);
-              }
-            }
-          }
-          return true;
+    case ProjectLayout::EXPANDED:
+      // Transform names: show as [prefix num num num]
+      updateExpandedGroup(prefix, group, cleanPrefix);
+      for (auto* ws : group.workspaces) {
+        std::string number = extractNumber(ws->name());
+        if (number.empty()) {
+          number = "?";
         }
-        return false;
-      });
 
-      // Apply empty class if group has no windows
-      if (!group.hasWindows) {
-        labelBtn->get_style_context()->add_class("empty");
+        // Use setLabelText to update label without destroying icon boxes
+        ws->setLabelText(number);
+        setGroupedClasses(ws->button(), true, group.hasActive);
+        ws->button().show();
       }
+      break;
 
-      // Apply urgent class if any workspace in group is urgent
-      if (group.hasUrgent) {
-        labelBtn->get_style_context()->add_class("urgent");
+    case ProjectLayout::PLAIN:
+      // A single workspace shows as just the prefix name when transforming (no number, no
+      // brackets), otherwise the workspaces show normally
+      for (auto* ws : group.workspaces) {
+        if (m_transformWorkspaceNames) {
+          ws->setLabelText(cleanPrefix);
+        }
+        setGroupedClasses(ws->button(), false, false);
+        ws->button().show();
       }
+      break;
+  }
+}
+
+void FancyWorkspaces::updateCollapsedGroup(const std::string& prefix, ProjectGroup& group,
+                                           const std::string& displayPrefix) {
+  if (group.collapsedBox == nullptr) {
+    // Create container box for the group (not a button!)
+    group.collapsedBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
+    group.collapsedBox->get_style_context()->add_class("collapsed-project");  // Backward compat
+    group.collapsedBox->get_style_context()->add_class("collapsed-project-group");
+
+    // Add opening bracket label
+    auto* openBracket = Gtk::manage(new Gtk::Label("["));
+    group.collapsedBox->pack_start(*openBracket, false, false);
+
+    // Create label button: prefix (without brackets)
+    group.collapsedLabel = Gtk::manage(new Gtk::Button());
+    group.collapsedLabel->set_relief(Gtk::RELIEF_NONE);
+    group.collapsedLabel->get_style_context()->add_class("collapsed-project-label");
+    group.collapsedLabel->get_style_context()->add_class(MODULE_CLASS);
 
-      groupBox->pack_start(*labelBtn, false, false);
-
-      // Collect and deduplicate icons from all workspaces in this group
-      if (m_showWindowIcons == ShowWindowIcons::ALL) {
-        std::set<std::string> uniqueIconNames;
-        std::vector<std::string> iconNamesOrdered;
-        std::map<std::string, std::vector<std::pair<std::string, std::string>>>
-            iconToWorkspaceAndTitles;
-        std::map<std::string, std::vector<std::string>> iconToAddresses;
-        std::map<std::string, std::string> addressToWorkspace;  // For smart selection
-
-        for (auto* ws : group.workspaces) {
-          auto windows = getWorkspaceWindows(ws);
-          for (const auto& window : windows) {
-            auto iconNameOpt = getIconNameForClass(window.windowClass);
-            if (iconNameOpt.has_value()) {
-              std::string iconName = iconNameOpt.value();
-              if (uniqueIconNames.find(iconName) == uniqueIconNames.end()) {
-                uniqueIconNames.insert(iconName);
-                iconNamesOrdered.push_back(iconName);
-              }
-              // Collect workspace name and window title for tooltip
-              iconToWorkspaceAndTitles[iconName].push_back({ws->name(), window.windowTitle});
-              // Collect window address for click handler
-              iconToAddresses[iconName].push_back(window.windowAddress);
-              // Map address to workspace for smart selection
-              addressToWorkspace[window.windowAddress] = ws->name();
-            }
+    // Add click handler for label - switches to workspace. The handlers outlive the group's
+    // members, so they look the group up when clicked.
+    group.collapsedLabel->signal_clicked().connect([this, prefix]() {
+      try {
+        // Build compound key for this group+monitor
+        std::string monitor = getBarOutput();
+        std::string key = prefix + "@" + monitor;
+
+        // Look up last active workspace for this group
+        std::string workspaceName;
+        auto it = m_lastActivePerGroup.find(key);
+        if (it != m_lastActivePerGroup.end()) {
+          workspaceName = it->second;
+          spdlog::debug("Workspace collapsed label '{}' clicked: switching to last active {}",
+                        prefix, workspaceName);
+        } else {
+          // No history, fall back to first workspace
+          auto group = m_projectGroups.find(prefix);
+          if (group == m_projectGroups.end() || group->second.workspaces.empty()) {
+            return;
           }
+          workspaceName = group->second.workspaces.front()->name();
+          spdlog::debug(
+              "Workspace collapsed label '{}' clicked: no history, switching to first {}", prefix,
+              workspaceName);
         }
 
-        // Create icon buttons
-        for (const auto& iconName : iconNamesOrdered) {
-          auto* iconBtn = Gtk::manage(new Gtk::Button());
-          iconBtn->set_relief(Gtk::RELIEF_NONE);
-          iconBtn->get_style_context()->add_class("collapsed-project-icon");
-          iconBtn->get_style_context()->add_class(MODULE_CLASS);
-
-          auto* icon = Gtk::manage(new Gtk::Image());
-          icon->set_pixel_size(m_windowIconSize);
-
-          if (iconName.front() == '/') {
-            // File path
-            try {
-              auto pixbuf =
-                  Gdk::Pixbuf::create_from_file(iconName, m_windowIconSize, m_windowIconSize);
-              icon->set(pixbuf);
-            } catch (const Glib::Error& e) {
-              spdlog::warn("[ICON_CLICK] Failed to load icon from file {}: {}", iconName,
-                           e.what().c_str());
-              continue;
-            }
-          } else {
-            // Icon name from theme
-            icon->set_from_icon_name(iconName, Gtk::ICON_SIZE_INVALID);
+        switchWorkspace("dispatch workspace name:" + workspaceName);
+      } catch (const std::exception& e) {
+        spdlog::error("Workspace group label click failed: {}", e.what());
+      }
+    });
+
+    // Add right-click handler for label - cleanup empty workspaces
+    group.collapsedLabel->signal_button_press_event().connect(
+        [this, prefix](GdkEventButton* bt) {
+          if (bt->type == GDK_BUTTON_PRESS && bt->button == 3) {
+            spdlog::debug("Right-click on collapsed group '{}', removing empty workspaces",
+                          prefix);
+            removeEmptyProjectWorkspaces(prefix);
+            return true;
           }
+          return false;
+        });
 
-          iconBtn->add(*icon);
-
-          // Build tooltip data - keep structured for interleaving
-          const auto& workspaceAndTitles = iconToWorkspaceAndTitles[iconName];
-          
-          // Set up custom tooltip with thumbnails
-          const auto& iconAddresses = iconToAddresses[iconName];
-          iconBtn->set_has_tooltip(true);
-          iconBtn->signal_query_tooltip().connect(
-              [iconName, workspaceAndTitles, iconAddresses](int x, int y, bool keyboard_tooltip,
-                                       const Glib::RefPtr<Gtk::Tooltip>& tooltip_widget) -> bool {
-                // Create tooltip content box
-                auto* vbox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL, 4));
-                
-                // Add header
-                auto* header = Gtk::manage(new Gtk::Label(iconName + ":"));
-                header->set_xalign(0.0);
-                vbox->pack_start(*header, false, false);
-                
-                // Interleave thumbnails and titles
-                waybar::util::ThumbnailCache cache;
-                size_t count = std::min(iconAddresses.size(), workspaceAndTitles.size());
-                
-                for (size_t i = 0; i < count; i++) {
-                  const auto& addr = iconAddresses[i];
-                  const auto& [wsName, title] = workspaceAndTitles[i];
-                  
-                  // Try to load thumbnail
-                  auto thumbnail_path = cache.getThumbnailPath(addr);
-                  if (thumbnail_path.has_value()) {
-                    try {
-                      auto pixbuf = Gdk::Pixbuf::create_from_file(thumbnail_path.value());
-                      // Scale thumbnail if needed (max 256x256)
-                      int width = pixbuf->get_width();
-                      int height = pixbuf->get_height();
-                      if (width > 256 || height > 256) {
-                        double scale = std::min(256.0 / width, 256.0 / height);
-                        width = static_cast<int>(width * scale);
-                        height = static_cast<int>(height * scale);
-                        pixbuf = pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR);
-                      }
-                      
-                      auto* thumb_img = Gtk::manage(new Gtk::Image(pixbuf));
-                      vbox->pack_start(*thumb_img, false, false);
-                    } catch (const Glib::Error& e) {
-                      spdlog::debug("[ICON_TOOLTIP] Failed to load thumbnail for {}: {}", addr,
-                                    e.what().c_str());
-                    }
-                  }
-                  
-                  // Add title with workspace
-                  std::string titleText = "  " + wsName + ": " + title;
-                  auto* titleLabel = Gtk::manage(new Gtk::Label(titleText));
-                  titleLabel->set_xalign(0.0);
-                  titleLabel->set_line_wrap(true);
-                  titleLabel->set_max_width_chars(50);
-                  vbox->pack_start(*titleLabel, false, false);
-                }
-                
-                vbox->show_all();
-                tooltip_widget->set_custom(*vbox);
-                return true;
-              });
+    group.collapsedBox->pack_start(*group.collapsedLabel, false, false);
 
-          // Check if any of this icon's windows are urgent (by address)
-          // (iconAddresses already captured in lambda above)
-          bool hasUrgentWindow = std::ranges::any_of(iconAddresses, [this](const std::string& addr) {
-            bool isUrgent = m_urgentWindows.contains("0x" + addr);
-            if (isUrgent) {
-              spdlog::debug("[ICON_URGENT] Icon address 0x{} is urgent", addr);
-            }
-            return isUrgent;
-          });
-          if (hasUrgentWindow) {
-            spdlog::debug("[ICON_URGENT] Icon '{}' has urgent window, applying class", iconName);
-            iconBtn->get_style_context()->add_class("urgent");
-          }
+    // Add closing bracket label, the icons go before it
+    group.collapsedClose = Gtk::manage(new Gtk::Label("]"));
+    group.collapsedBox->pack_start(*group.collapsedClose, false, false);
 
-          // Add click handler for icon - smart window focus
-          std::vector<std::string> allAddresses = iconToAddresses[iconName];
-          std::map<std::string, std::string> addrToWs = addressToWorkspace;
-          iconBtn->signal_clicked().connect(
-              [this, allAddresses, addrToWs, groupPrefix, iconName]() {
-                std::string targetAddress =
-                    selectBestWindowForIcon(allAddresses, addrToWs, groupPrefix, getBarOutput());
-                if (!targetAddress.empty()) {
-                  spdlog::info("[ICON_CLICK] Icon '{}' clicked, focusing window: {}", iconName,
-                               targetAddress);
-                  m_ipc.getSocket1Reply("dispatch focuswindow address:0x" + targetAddress);
-                }
-              });
+    m_box.add(*group.collapsedBox);
+    group.collapsedBox->show_all();
+  }
 
-          groupBox->pack_start(*iconBtn, false, false);
+  if (group.collapsedLabel->get_label() != displayPrefix) {
+    group.collapsedLabel->set_label(displayPrefix);  // Just the prefix, no brackets
+  }
+
+  // Apply empty class if group has no windows, urgent if any workspace in group is urgent
+  auto labelContext = group.collapsedLabel->get_style_context();
+  addOrRemoveClass(labelContext, !group.hasWindows, "empty");
+  addOrRemoveClass(labelContext, group.hasUrgent, "urgent");
+
+  updateCollapsedIcons(prefix, group);
+}
+
+void FancyWorkspaces::updateCollapsedIcons(const std::string& prefix, ProjectGroup& group) {
+  // Collect and deduplicate icons from all workspaces in this group
+  std::vector<std::string> iconNamesOrdered;
+  std::map<std::string, std::vector<std::pair<std::string, std::string>>>
+      iconToWorkspaceAndTitles;
+  std::map<std::string, std::vector<std::string>> iconToAddresses;
+  std::map<std::string, std::string> addressToWorkspace;  // For smart selection
+
+  if (m_showWindowIcons == ShowWindowIcons::ALL) {
+    for (auto* ws : group.workspaces) {
+      auto windows = getWorkspaceWindows(ws);
+      for (const auto& window : windows) {
+        auto iconNameOpt = getIconNameForClass(window.windowClass);
+        if (iconNameOpt.has_value()) {
+          std::string iconName = iconNameOpt.value();
+          if (!iconToAddresses.contains(iconName)) {
+            iconNamesOrdered.push_back(iconName);
+          }
+          // Collect workspace name and window title for tooltip
+          iconToWorkspaceAndTitles[iconName].push_back({ws->name(), window.windowTitle});
+          // Collect window address for click handler
+          iconToAddresses[iconName].push_back(window.windowAddress);
+          // Map address to workspace for smart selection
+          addressToWorkspace[window.windowAddress] = ws->name();
         }
       }
+    }
+  }
 
-      // Add closing bracket label
-      auto* closeBracket = Gtk::manage(new Gtk::Label("]"));
-      groupBox->pack_start(*closeBracket, false, false);
-
-      // Calculate adjusted position accounting for elements added by earlier groups
-      int targetPosition = group.firstPosition + positionOffset;
+  // Check which icons have urgent windows (by address)
+  std::vector<bool> iconUrgent;
+  iconUrgent.reserve(iconNamesOrdered.size());
+  for (const auto& iconName : iconNamesOrdered) {
+    iconUrgent.push_back(
+        std::ranges::any_of(iconToAddresses[iconName], [this](const std::string& addr) {
+          return m_urgentWindows.contains("0x" + addr);
+        }));
+  }
+
+  // The icons are rebuilt only when what they show changed
+  std::string iconsKey;
+  for (size_t i = 0; i < iconNamesOrdered.size(); ++i) {
+    const auto& iconName = iconNamesOrdered[i];
+    iconsKey += iconName;
+    iconsKey += iconUrgent[i] ? "\x1f!" : "\x1f";
+    const auto& iconAddresses = iconToAddresses[iconName];
+    const auto& workspaceAndTitles = iconToWorkspaceAndTitles[iconName];
+    for (size_t j = 0; j < iconAddresses.size(); ++j) {
+      iconsKey += iconAddresses[j];
+      iconsKey += '\x1f';
+      iconsKey += workspaceAndTitles[j].first;
+      iconsKey += '\x1f';
+      iconsKey += workspaceAndTitles[j].second;
+      iconsKey += '\x1f';
+    }
+    iconsKey += '\x1e';
+  }
+  if (iconsKey == group.iconsKey) {
+    return;
+  }
+  group.iconsKey = std::move(iconsKey);
 
-      m_box.add(*groupBox);
-      m_box.reorder_child(*groupBox, targetPosition);
-      groupBox->show_all();
+  for (auto* iconBtn : group.icons) {
+    group.collapsedBox->remove(*iconBtn);
+  }
+  group.icons.clear();
 
-      m_collapsedGroups.push_back(groupBox);
+  // Create icon buttons
+  for (size_t i = 0; i < iconNamesOrdered.size(); ++i) {
+    const auto& iconName = iconNamesOrdered[i];
 
-      // Collapsed group adds 1 element (the groupBox)
-      elementsAdded = 1;
+    // File path, loaded first so that nothing is created for it if it fails
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+    if (iconName.front() == '/') {
+      try {
+        pixbuf = Gdk::Pixbuf::create_from_file(iconName, m_windowIconSize, m_windowIconSize);
+      } catch (const Glib::Error& e) {
+        spdlog::warn("[ICON_CLICK] Failed to load icon from file {}: {}", iconName,
+                     e.what().c_str());
+        continue;
+      }
+    }
 
-    } else if (shouldTransform) {
-      // Transform names without collapsing
-      if (group.workspaces.size() == 1) {
-        // Single workspace: show as just prefix name (no number, no brackets)
-        // spdlog::debug("Workspace group '{}' -> single workspace, display as '{}'", prefix,
-        //               cleanPrefix);
-        auto* ws = group.workspaces[0];
+    auto* iconBtn = Gtk::manage(new Gtk::Button());
+    iconBtn->set_relief(Gtk::RELIEF_NONE);
+    iconBtn->get_style_context()->add_class("collapsed-project-icon");
+    iconBtn->get_style_context()->add_class(MODULE_CLASS);
 
-        // Set display name to just the prefix - use setLabelText to preserve icons
-        ws->setLabelText(cleanPrefix);
-        ws->button().show();
+    auto* icon = Gtk::manage(new Gtk::Image());
+    icon->set_pixel_size(m_windowIconSize);
 
-        // Single workspace adds 0 extra elements (workspace already exists)
-        elementsAdded = 0;
+    if (pixbuf) {
+      icon->set(pixbuf);
+    } else {
+      // Icon name from theme
+      icon->set_from_icon_name(iconName, Gtk::ICON_SIZE_INVALID);
+    }
 
-      } else {
-        // Multiple workspaces: show as [prefix num num num]
-        // spdlog::debug("Workspace group '{}' -> transformed as [{}...]", prefix, cleanPrefix);
+    iconBtn->add(*icon);
 
-        // Calculate adjusted position
-        int pos = group.firstPosition + positionOffset;
+    // Thumbnails interleaved with the titles, built when the tooltip is first shown. The
+    // button, and the tooltip with it, lives until what the icons show changes
+    const auto& workspaceAndTitles = iconToWorkspaceAndTitles[iconName];
+    const auto& iconAddresses = iconToAddresses[iconName];
+    std::vector<ThumbnailTooltip::Entry> entries;
+    for (size_t j = 0; j < iconAddresses.size(); j++) {
+      const auto& [wsName, title] = workspaceAndTitles[j];
+      entries.push_back({iconAddresses[j], "  " + wsName + ": " + title});
+    }
+    auto tooltip = std::make_shared<ThumbnailTooltip>();
+    tooltip->setContent(iconName + ":", std::move(entries), true);
+    iconBtn->set_has_tooltip(true);
+    iconBtn->signal_query_tooltip().connect(
+        [tooltip](int, int, bool, const Glib::RefPtr<Gtk::Tooltip>& tooltip_widget) {
+          return tooltip->query(tooltip_widget);
+        });
 
-        // Create start container: [bracket + label] matching collapsed group structure
-        auto* startBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
-        startBox->get_style_context()->add_class("expanded-group-start");
-        if (group.hasActive) {
-          startBox->get_style_context()->add_class("active-group");
-        }
-        
-        // Use Label for bracket (like collapsed groups do)
-        auto* openBracket = Gtk::manage(new Gtk::Label("["));
-        openBracket->get_style_context()->add_class("group-bracket");
-        if (group.hasActive) {
-          openBracket->get_style_context()->add_class("active-group");
-        }
-        startBox->pack_start(*openBracket, false, false);
-
-        // Add project name (make it clickable to create new workspace)
-        auto* projectLabel = Gtk::manage(new Gtk::Button());
-        projectLabel->set_label(cleanPrefix);
-        projectLabel->set_relief(Gtk::RELIEF_NONE);
-        projectLabel->get_style_context()->add_class("workspace-label");
-        projectLabel->get_style_context()->add_class("grouped");
-        projectLabel->get_style_context()->add_class(
-            "empty");  // Use empty style for project labels
-        projectLabel->get_style_context()->add_class(MODULE_CLASS);
-        if (group.hasActive) {
-          projectLabel->get_style_context()->add_class("active-group");
-        }
+    if (iconUrgent[i]) {
+      spdlog::debug("[ICON_URGENT] Icon '{}' has urgent window, applying class", iconName);
+      iconBtn->get_style_context()->add_class("urgent");
+    }
 
-        // Add click handler to create new workspace in this project
-        std::string projectName = cleanPrefix;
-        projectLabel->signal_clicked().connect([this, projectName]() {
-          try {
-            spdlog::debug("Workspace project label '{}' clicked: creating new workspace",
-                          projectName);
-
-            std::string cmd = "waybar-workspace-create.sh " + projectName;
-            util::command::res result = util::command::exec(cmd, "workspace-create");
-
-            if (result.exit_code == 0) {
-              spdlog::info("Created new workspace for project '{}'", projectName);
-            } else {
-              spdlog::warn("Workspace creation failed: {}", result.out);
-            }
-          } catch (const std::exception& e) {
-            spdlog::error("Workspace project label click failed: {}", e.what());
+    // Add click handler for icon - smart window focus
+    iconBtn->signal_clicked().connect(
+        [this, allAddresses = iconAddresses, addrToWs = addressToWorkspace, prefix, iconName]() {
+          std::string targetAddress =
+              selectBestWindowForIcon(allAddresses, addrToWs, prefix, getBarOutput());
+          if (!targetAddress.empty()) {
+            spdlog::info("[ICON_CLICK] Icon '{}' clicked, focusing window: {}", iconName,
+                         targetAddress);
+            m_ipc.getSocket1Reply("dispatch focuswindow address:0x" + targetAddress);
           }
         });
 
-        // Add right-click handler to cleanup empty workspaces
-        std::vector<FancyWorkspace*> groupWorkspaces = group.workspaces;
-        projectLabel->signal_button_press_event().connect([this, groupWorkspaces, projectName](GdkEventButton* bt) {
+    group.collapsedBox->pack_start(*iconBtn, false, false);
+    group.icons.push_back(iconBtn);
+  }
+
+  group.collapsedBox->reorder_child(*group.collapsedClose, -1);
+  group.collapsedBox->show_all();
+}
+
+void FancyWorkspaces::updateExpandedGroup(const std::string& prefix, ProjectGroup& group,
+                                          const std::string& cleanPrefix) {
+  if (group.startBox == nullptr) {
+    // Create start container: [bracket + label] matching collapsed group structure
+    group.startBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
+    group.startBox->get_style_context()->add_class("expanded-group-start");
+
+    // Use Label for bracket (like collapsed groups do)
+    group.startBracket = Gtk::manage(new Gtk::Label("["));
+    group.startBracket->get_style_context()->add_class("group-bracket");
+    group.startBox->pack_start(*group.startBracket, false, false);
+
+    // Add project name (make it clickable to create new workspace)
+    group.projectLabel = Gtk::manage(new Gtk::Button());
+    group.projectLabel->set_label(cleanPrefix);
+    group.projectLabel->set_relief(Gtk::RELIEF_NONE);
+    group.projectLabel->get_style_context()->add_class("workspace-label");
+    group.projectLabel->get_style_context()->add_class("grouped");
+    group.projectLabel->get_style_context()->add_class(
+        "empty");  // Use empty style for project labels
+    group.projectLabel->get_style_context()->add_class(MODULE_CLASS);
+
+    // Add click handler to create new workspace in this project
+    group.projectLabel->signal_clicked().connect([projectName = cleanPrefix]() {
+      try {
+        spdlog::debug("Workspace project label '{}' clicked: creating new workspace",
+                      projectName);
+
+        std::string cmd = "waybar-workspace-create.sh " + projectName;
+        util::command::res result = util::command::exec(cmd, "workspace-create");
+
+        if (result.exit_code == 0) {
+          spdlog::info("Created new workspace for project '{}'", projectName);
+        } else {
+          spdlog::warn("Workspace creation failed: {}", result.out);
+        }
+      } catch (const std::exception& e) {
+        spdlog::error("Workspace project label click failed: {}", e.what());
+      }
+    });
+
+    // Add right-click handler to cleanup empty workspaces
+    group.projectLabel->signal_button_press_event().connect(
+        [this, prefix](GdkEventButton* bt) {
           if (bt->type == GDK_BUTTON_PRESS && bt->button == 3) {
-            spdlog::debug("Right-click on expanded group '{}', removing empty workspaces", projectName);
-            for (auto* ws : groupWorkspaces) {
-              if (ws->isEmpty()) {
-                std::string cmd = "waybar-workspace-remove.sh " + ws->name();
-                util::command::res result = util::command::exec(cmd, "workspace-remove");
-                if (result.exit_code == 0) {
-                  spdlog::info("Removed workspace '{}'", ws->name());
-                } else {
-                  spdlog::warn("Workspace removal failed: {}", result.out);
-                }
-              }
-            }
+            spdlog::debug("Right-click on expanded group '{}', removing empty workspaces",
+                          prefix);
+            removeEmptyProjectWorkspaces(prefix);
             return true;
           }
           return false;
         });
 
-        startBox->pack_start(*projectLabel, false, false);
-        
-        m_box.add(*startBox);
-        m_box.reorder_child(*startBox, pos++);
-        startBox->show_all();
-        m_expandedGroupBoxes.push_back(startBox);
-
-        // Add workspaces (just numbers)
-        for (auto* ws : group.workspaces) {
-          std::string number = extractNumber(ws->name());
-          if (number.empty()) {
-            number = "?";
-          }
+    group.startBox->pack_start(*group.projectLabel, false, false);
+    m_box.add(*group.startBox);
+    group.startBox->show_all();
 
-          // Use setLabelText to update label without destroying icon boxes
-          ws->setLabelText(number);
-          ws->button().get_style_context()->add_class("grouped");  // For CSS spacing
-          if (group.hasActive) {
-            ws->button().get_style_context()->add_class("active-group");
-          }
-          ws->button().show();
-          m_box.reorder_child(ws->button(), pos++);
-        }
+    // Create end container: [closing bracket] matching collapsed group structure
+    group.endBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
+    group.endBox->get_style_context()->add_class("expanded-group-end");
 
-        // Create end container: [closing bracket] matching collapsed group structure
-        auto* endBox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0));
-        endBox->get_style_context()->add_class("expanded-group-end");
-        if (group.hasActive) {
-          endBox->get_style_context()->add_class("active-group");
-        }
-        
-        // Use Label for bracket (like collapsed groups do)
-        auto* closeBracket = Gtk::manage(new Gtk::Label("]"));
-        closeBracket->get_style_context()->add_class("group-bracket");
-        if (group.hasActive) {
-          closeBracket->get_style_context()->add_class("active-group");
-        }
-        endBox->pack_start(*closeBracket, false, false);
-        
-        m_box.add(*endBox);
-        m_box.reorder_child(*endBox, pos);
-        endBox->show_all();
-        m_expandedGroupBoxes.push_back(endBox);
-        endBox->show_all();
-
-        // Transformed group adds: startBox + endBox = 2 elements
-        // (workspaces already exist, just reordered)
-        elementsAdded = 2;
-      }
-    } else {
-      // No transform, no collapse - just show normally
-      for (auto* ws : group.workspaces) {
-        ws->button().show();
-      }
-      elementsAdded = 0;
-    }
+    group.endBracket = Gtk::manage(new Gtk::Label("]"));
+    group.endBracket->get_style_context()->add_class("group-bracket");
+    group.endBox->pack_start(*group.endBracket, false, false);
+
+    m_box.add(*group.endBox);
+    group.endBox->show_all();
+  }
 
-    // Update position offset for next group
-    positionOffset += elementsAdded;
+  for (Gtk::Widget* widget : {static_cast<Gtk::Widget*>(group.startBox),
+                              static_cast<Gtk::Widget*>(group.startBracket),
+                              static_cast<Gtk::Widget*>(group.projectLabel),
+                              static_cast<Gtk::Widget*>(group.endBox),
+                              static_cast<Gtk::Widget*>(group.endBracket)}) {
+    addOrRemoveClass(widget->get_style_context(), group.hasActive, "active-group");
   }
 }
 
-void FancyWorkspaces::executeHook(const std::string& command, const std::string& workspaceName,
-                                  const std::string& workspaceMonitor, int workspaceId) {
-  if (command.empty()) {
+void FancyWorkspaces::dropCollapsedWidgets(ProjectGroup& group) {
+  if (group.collapsedBox == nullptr) {
     return;
   }
+  // Managed, removing the box destroys it along with its children
+  m_box.remove(*group.collapsedBox);
+  group.collapsedBox = nullptr;
+  group.collapsedLabel = nullptr;
+  group.collapsedClose = nullptr;
+  group.icons.clear();
+  group.iconsKey.clear();
+}
 
-  // Replace variables in command
-  std::string cmd = command;
-  size_t pos = 0;
-  while ((pos = cmd.find("{name}", pos)) != std::string::npos) {
-    cmd.replace(pos, 6, workspaceName);
-    pos += workspaceName.length();
+void FancyWorkspaces::dropExpandedWidgets(ProjectGroup& group) {
+  if (group.startBox == nullptr) {
+    return;
   }
-  
-  pos = 0;
-  while ((pos = cmd.find("{monitor}", pos)) != std::string::npos) {
-    cmd.replace(pos, 9, workspaceMonitor);
-    pos += workspaceMonitor.length();
+  m_box.remove(*group.startBox);
+  m_box.remove(*group.endBox);
+  group.startBox = nullptr;
+  group.startBracket = nullptr;
+  group.projectLabel = nullptr;
+  group.endBox = nullptr;
+  group.endBracket = nullptr;
+}
+
+void FancyWorkspaces::removeEmptyProjectWorkspaces(const std::string& prefix) {
+  auto group = m_projectGroups.find(prefix);
+  if (group == m_projectGroups.end()) {
+    return;
   }
-  
-  pos = 0;
-  std::string idStr = std::to_string(workspaceId);
-  while ((pos = cmd.find("{id}", pos)) != std::string::npos) {
-    cmd.replace(pos, 4, idStr);
-    pos += idStr.length();
+  std::vector<std::string> emptyWorkspaces;
+  for (auto* ws : group->second.workspaces) {
+    if (ws->isEmpty()) {
+      emptyWorkspaces.push_back(ws->name());
+    }
+  }
+  for (const auto& name : emptyWorkspaces) {
+    std::string cmd = "waybar-workspace-remove.sh " + name;
+    util::command::res result = util::command::exec(cmd, "workspace-remove");
+    if (result.exit_code == 0) {
+      spdlog::info("Removed workspace '{}'", name);
+    } else {
+      spdlog::warn("Workspace removal failed: {}", result.out);
+    }
+  }
+}
+
+void FancyWorkspaces::reorderBox(const std::vector<Gtk::Widget*>& order) {
+  if (std::ranges::equal(m_box.get_children(), order)) {
+    return;
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    m_box.reorder_child(*order[i], static_cast<int>(i));
+  }
+}
+
+void FancyWorkspaces::executeHook(const HookTemplate& hook, const std::string& workspaceName,
+                                  const std::string& workspaceMonitor, int workspaceId) {
+  if (hook.empty()) {
+    return;
   }
 
+  std::string cmd = hook.expand(workspaceName, workspaceMonitor, workspaceId);
   spdlog::debug("Executing hook: {}", cmd);
 
-  // Fork and execute command asynchronously
-  pid_t pid = fork();
-  if (pid == 0) {
-    // Child process
-    execl("/bin/sh", "sh", "-c", cmd.c_str(), nullptr);
-    _exit(1);
-  } else if (pid < 0) {
-    spdlog::error("Failed to fork process for hook execution");
+  // Spawned without forking waybar and reaped along with the other children
+  if (util::command::forkExec(cmd, true) < 0) {
+    spdlog::error("Failed to spawn process for hook execution");
   }
-  // Parent continues without waiting
 }
 
 void FancyWorkspaces::captureThumbnailsForWorkspace(const std::string& workspaceName) {
@@ -2074,6 +2207,9 @@ void FancyWorkspaces::captureThumbnailsForWorkspace(const std::string& workspace
   }
   
   spdlog::debug("[THUMBNAIL] Starting batch capture for workspace '{}'", workspaceName);
+
+  // Anything still queued belongs to a workspace that is no longer visible
+  m_thumbnailCache.cancelPendingCaptures();
   
   // Find the workspace
   auto workspace = std::find_if(m_workspaces.begin(), m_workspaces.end(),
@@ -2082,54 +2218,106 @@ void FancyWorkspaces::captureThumbnailsForWorkspace(const std::string& workspace
   if (workspace == m_workspaces.end()) {
     return;
   }
-  
+
+  // Queued on the capture worker, which waits for the settle delay
+  captureWorkspace(workspace->get(), eventReply("clients"), false);
+}
+
+FancyWorkspace* FancyWorkspaces::activeWorkspace() const {
+  auto workspace = std::ranges::find(m_workspaces, m_activeWorkspaceId, &FancyWorkspace::id);
+  return workspace != m_workspaces.end() ? workspace->get() : nullptr;
+}
+
+void FancyWorkspaces::captureWorkspace(FancyWorkspace* workspace, const Json::Value& clients,
+                                       bool now, std::shared_ptr<void> done) {
+  const auto& workspaceName = workspace->name();
   // Get all windows in this workspace
-  auto windows = getWorkspaceWindows(workspace->get());
+  auto windows = getWorkspaceWindows(workspace);
   
   if (windows.empty()) {
     spdlog::debug("[THUMBNAIL] No windows in workspace '{}'", workspaceName);
     return;
   }
-  
-  // Get current clients data for geometry
-  Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
-  
-  // Fork a process to handle batch capture with delay
-  pid_t pid = fork();
-  if (pid == 0) {
-    // Child process: wait for animation, then capture all windows one by one
-    usleep(300000); // 300ms for animation
-    
-    spdlog::debug("[THUMBNAIL] Capturing {} windows in workspace '{}'", windows.size(), workspaceName);
-    
-    // Create a new cache instance in child process
-    waybar::util::ThumbnailCache cache;
-    
-    for (const auto& window : windows) {
-      // Find this window's geometry
-      std::string jsonWindowAddress = "0x" + window.windowAddress;
-      
-      auto client = std::ranges::find_if(clientsData, [&jsonWindowAddress](auto& client) {
-        return client["address"].asString() == jsonWindowAddress;
-      });
-      
-      if (client != clientsData.end() && !client->empty()) {
-        int x = (*client)["at"][0].asInt();
-        int y = (*client)["at"][1].asInt();
-        int w = (*client)["size"][0].asInt();
-        int h = (*client)["size"][1].asInt();
-        
-        // Capture synchronously (no extra delay needed, we already waited)
-        cache.captureWindowSync(window.windowAddress, x, y, w, h,
-                               window.windowClass, window.windowTitle, workspaceName);
-      }
+
+  // Find the windows' geometry
+  std::vector<std::pair<const WindowInfo*, const Json::Value*>> captures;
+  for (const auto& window : windows) {
+    std::string jsonWindowAddress = "0x" + window.windowAddress;
+
+    auto client = std::ranges::find_if(clients, [&jsonWindowAddress](auto& client) {
+      return client["address"].asString() == jsonWindowAddress;
+    });
+
+    if (client == clients.end() || client->empty()) {
+      continue;
     }
-    
-    _exit(0);
-  } else if (pid > 0) {
-    // Parent: track the PID so we can kill it if needed
-    m_captureProcessPid = pid;
+    // A fullscreen game or video would lose frames to the captures
+    if (isFullscreen(*client)) {
+      spdlog::debug("[THUMBNAIL] Workspace '{}' has a fullscreen window, not capturing",
+                    workspaceName);
+      return;
+    }
+    captures.emplace_back(&window, &*client);
   }
+
+  spdlog::debug("[THUMBNAIL] Capturing {} windows in workspace '{}'", captures.size(),
+                workspaceName);
+
+  for (const auto& [window, client] : captures) {
+    int x = (*client)["at"][0].asInt();
+    int y = (*client)["at"][1].asInt();
+    int w = (*client)["size"][0].asInt();
+    int h = (*client)["size"][1].asInt();
+    m_thumbnailCache.captureWindow(window->windowAddress, x, y, w, h, window->windowClass,
+                                   window->windowTitle, workspaceName, now, done);
+  }
+}
+
+void FancyWorkspaces::switchWorkspace(const std::string& dispatch) {
+  // Sent once, by the end of the captures or by the timeout. The IPC outlives the module.
+  auto send = [&ipc = m_ipc, dispatch, sent = std::make_shared<bool>(false)] {
+    if (std::exchange(*sent, true)) {
+      return;
+    }
+    try {
+      ipc.getSocket1Reply(dispatch);
+    } catch (const std::exception& e) {
+      spdlog::error("Failed to dispatch workspace: {}", e.what());
+    }
+  };
+
+  auto* workspace =
+      m_captureOnLeave && m_thumbnailCache.isAvailable() ? activeWorkspace() : nullptr;
+  if (workspace == nullptr) {
+    send();
+    return;
+  }
+
+  // Released by the last capture, from the capture worker or the GTK thread
+  std::shared_ptr<void> done(nullptr, [send](void*) {
+    Glib::MainContext::get_default()->invoke([send] {
+      send();
+      return false;
+    });
+  });
+  Glib::signal_timeout().connect_once(send, LEAVE_CAPTURE_TIMEOUT.count());
+  captureWorkspace(workspace, m_ipc.getSocket1JsonReply("clients"), true, std::move(done));
+}
+
+void FancyWorkspaces::scheduleIdleCapture() {
+  if (!m_captureOnIdle || !m_thumbnailCache.isAvailable()) {
+    return;
+  }
+  // Restarted by each change, so the capture comes once the workspace has been still a while
+  m_idleCapture.disconnect();
+  m_idleCapture = Glib::signal_timeout().connect(
+      [this] {
+        if (auto* workspace = activeWorkspace()) {
+          captureWorkspace(workspace, m_ipc.getSocket1JsonReply("clients"), true);
+        }
+        return false;
+      },
+      m_captureIdleDelay.count());
 }
 
 }  // namespace waybar::modules::hyprland
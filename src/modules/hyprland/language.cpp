@@ -1,11 +1,13 @@
 #include "modules/hyprland/language.hpp"
 
 #include <spdlog/spdlog.h>
-#include <xkbcommon/xkbcommon.h>
-#include <xkbcommon/xkbregistry.h>
+
+#include <algorithm>
+#include <string_view>
 
 #include "util/sanitize_str.hpp"
 #include "util/string.hpp"
+#include "util/xkb_layouts.hpp"
 
 namespace waybar::modules::hyprland {
 
@@ -63,26 +65,33 @@ auto Language::update() -> void {
 
 void Language::onEvent(const std::string& ev) {
   std::lock_guard<std::mutex> lg(mutex_);
-  std::string kbName(begin(ev) + ev.find_last_of('>') + 1, begin(ev) + ev.find_first_of(','));
-
-  // Last comma before variants parenthesis, eg:
+  // activelayout>>KEYBOARD,LAYOUT where both may have commas, eg:
   // activelayout>>micro-star-int'l-co.,-ltd.-msi-gk50-elite-gaming-keyboard,English (US, intl.,
   // with dead keys)
-  std::string beforeParenthesis;
-  auto parenthesisPos = ev.find_last_of('(');
-  if (parenthesisPos == std::string::npos) {
-    beforeParenthesis = ev;
+  std::string_view data(ev);
+  if (const auto separator = data.find(">>"); separator != std::string_view::npos) {
+    data.remove_prefix(separator + 2);
+  }
+
+  std::string_view kbName;
+  std::string_view layoutName;
+  const auto keyboard = std::ranges::find_if(keyboards_, [&](const std::string& name) {
+    return data.size() > name.size() && data.starts_with(name) && data[name.size()] == ',';
+  });
+  if (keyboard != keyboards_.end()) {
+    kbName = data.substr(0, keyboard->size());
+    layoutName = data.substr(keyboard->size() + 1);
   } else {
-    beforeParenthesis = std::string(begin(ev), begin(ev) + parenthesisPos);
+    // Plugged in since: the last comma before the variant's parenthesis ends its name
+    kbName = data.substr(0, data.find(','));
+    const auto beforeParenthesis = data.substr(0, data.find_last_of('('));
+    layoutName = data.substr(std::min(beforeParenthesis.find_last_of(',') + 1, data.size()));
   }
-  auto layoutName = ev.substr(beforeParenthesis.find_last_of(',') + 1);
 
   if (config_.isMember("keyboard-name") && kbName != config_["keyboard-name"].asString())
     return;  // ignore
 
-  layoutName = waybar::util::sanitize_string(layoutName);
-
-  layout_ = getLayout(layoutName);
+  layout_ = getLayout(waybar::util::sanitize_string(std::string(layoutName)));
 
   spdlog::debug("hyprland language onevent with {}", layoutName);
 
@@ -90,20 +99,30 @@ void Language::onEvent(const std::string& ev) {
 }
 
 void Language::initLanguage() {
-  const auto inputDevices = m_ipc.getSocket1Reply("devices");
-
   const auto kbName = config_["keyboard-name"].asString();
 
   try {
-    auto searcher = kbName.empty()
-                        ? inputDevices
-                        : inputDevices.substr(inputDevices.find(kbName) + kbName.length());
-    searcher = searcher.substr(searcher.find("keymap:") + 8);
-    searcher = searcher.substr(0, searcher.find_first_of("\n\t"));
+    const auto devices = m_ipc.getSocket1JsonReply("devices");
+    const Json::Value* active = nullptr;
+    for (const auto& keyboard : devices["keyboards"]) {
+      keyboards_.push_back(keyboard["name"].asString());
+      // The configured keyboard, or else the main one, or else the first
+      const bool main =
+          keyboard["main"].asBool() && (active == nullptr || !(*active)["main"].asBool());
+      if (kbName.empty() ? active == nullptr || main : keyboards_.back() == kbName) {
+        active = &keyboard;
+      }
+    }
+    // The longest first, for a name that another one starts with
+    std::ranges::sort(keyboards_, [](const auto& a, const auto& b) { return a.size() > b.size(); });
 
-    searcher = waybar::util::sanitize_string(searcher);
+    if (active == nullptr) {
+      spdlog::warn("hyprland language found no keyboard{}",
+                   kbName.empty() ? "" : " named " + kbName);
+      return;
+    }
 
-    layout_ = getLayout(searcher);
+    layout_ = getLayout(waybar::util::sanitize_string((*active)["active_keymap"].asString()));
 
     spdlog::debug("hyprland language initLanguage found {}", layout_.full_name);
 
@@ -114,37 +133,12 @@ void Language::initLanguage() {
 }
 
 auto Language::getLayout(const std::string& fullName) -> Layout {
-  auto* const context = rxkb_context_new(RXKB_CONTEXT_LOAD_EXOTIC_RULES);
-  rxkb_context_parse_default_ruleset(context);
-
-  rxkb_layout* layout = rxkb_layout_first(context);
-  while (layout != nullptr) {
-    std::string nameOfLayout = rxkb_layout_get_description(layout);
-
-    if (nameOfLayout != fullName) {
-      layout = rxkb_layout_next(layout);
-      continue;
-    }
-
-    auto name = std::string(rxkb_layout_get_name(layout));
-    const auto* variantPtr = rxkb_layout_get_variant(layout);
-    std::string variant = variantPtr == nullptr ? "" : std::string(variantPtr);
-
-    const auto* descriptionPtr = rxkb_layout_get_brief(layout);
-    std::string description = descriptionPtr == nullptr ? "" : std::string(descriptionPtr);
-
-    Layout info = Layout{nameOfLayout, name, variant, description};
-
-    rxkb_context_unref(context);
-
-    return info;
+  const auto* layout = util::XkbLayouts::inst().find(fullName);
+  if (layout == nullptr) {
+    spdlog::debug("hyprland language didn't find matching layout");
+    return Layout{"", "", "", ""};
   }
-
-  rxkb_context_unref(context);
-
-  spdlog::debug("hyprland language didn't find matching layout");
-
-  return Layout{"", "", "", ""};
+  return Layout{fullName, layout->short_name, layout->variant, layout->short_description};
 }
 
 }  // namespace waybar::modules::hyprland
@@ -0,0 +1,63 @@
+#include "modules/hyprland/thumbnail_tooltip.hpp"
+
+#include <gtkmm/image.h>
+#include <gtkmm/label.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "util/thumbnail_cache.hpp"
+
+namespace waybar::modules::hyprland {
+
+void ThumbnailTooltip::setContent(std::string header, std::vector<Entry> entries, bool wrap) {
+  const auto same = [](const Entry& a, const Entry& b) {
+    return a.address == b.address && a.title == b.title;
+  };
+  if (header == header_ && wrap == wrap_ &&
+      std::equal(entries.begin(), entries.end(), entries_.begin(), entries_.end(), same)) {
+    return;
+  }
+  header_ = std::move(header);
+  entries_ = std::move(entries);
+  wrap_ = wrap;
+  box_.reset();
+}
+
+bool ThumbnailTooltip::query(const Glib::RefPtr<Gtk::Tooltip>& tooltip) {
+  std::vector<Glib::RefPtr<Gdk::Pixbuf>> thumbnails;
+  thumbnails.reserve(entries_.size());
+  for (const auto& entry : entries_) {
+    thumbnails.push_back(util::ThumbnailCache::getThumbnailPixbuf(entry.address));
+  }
+  if (!box_ || thumbnails != thumbnails_) {
+    build(thumbnails);
+    thumbnails_ = std::move(thumbnails);
+  }
+  tooltip->set_custom(*box_);
+  return true;
+}
+
+void ThumbnailTooltip::build(const std::vector<Glib::RefPtr<Gdk::Pixbuf>>& thumbnails) {
+  box_ = std::make_unique<Gtk::Box>(Gtk::ORIENTATION_VERTICAL, 4);
+  if (!header_.empty()) {
+    auto* header = Gtk::manage(new Gtk::Label(header_));
+    header->set_xalign(0.0);
+    box_->pack_start(*header, false, false);
+  }
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (thumbnails[i]) {
+      box_->pack_start(*Gtk::manage(new Gtk::Image(thumbnails[i])), false, false);
+    }
+    auto* title = Gtk::manage(new Gtk::Label(entries_[i].title));
+    title->set_xalign(0.0);
+    if (wrap_) {
+      title->set_line_wrap(true);
+      title->set_max_width_chars(50);
+    }
+    box_->pack_start(*title, false, false);
+  }
+  box_->show_all();
+}
+
+}  // namespace waybar::modules::hyprland
@@ -18,7 +18,10 @@ namespace waybar::modules::hyprland {
 std::shared_mutex windowIpcSmtx;
 
 Window::Window(const std::string& id, const Bar& bar, const Json::Value& config)
-    : AAppIconLabel(config, "window", id, "{title}", 0, true), bar_(bar), m_ipc(IPC::inst()) {
+    : AAppIconLabel(config, "window", id, "{title}", 0, true),
+      bar_(bar),
+      rewrite_(util::RewriteRules::shared(config["rewrite"])),
+      m_ipc(IPC::inst()) {
   std::unique_lock<std::shared_mutex> windowIpcUniqueLock(windowIpcSmtx);
 
   separateOutputs_ = config["separate-outputs"].asBool();
@@ -53,12 +56,11 @@ auto Window::update() -> void {
   std::string label_text;
   if (!format_.empty()) {
     label_.show();
-    label_text = waybar::util::rewriteString(
-        fmt::format(fmt::runtime(format_), fmt::arg("title", windowName),
-                    fmt::arg("initialTitle", windowData_.initial_title),
-                    fmt::arg("class", windowData_.class_name),
-                    fmt::arg("initialClass", windowData_.initial_class_name)),
-        config_["rewrite"]);
+    label_text = rewrite_->apply(fmt::format(
+        fmt::runtime(format_), fmt::arg("title", windowName),
+        fmt::arg("initialTitle", windowData_.initial_title),
+        fmt::arg("class", windowData_.class_name),
+        fmt::arg("initialClass", windowData_.initial_class_name)));
     label_.set_markup(label_text);
   } else {
     label_.hide();
@@ -108,109 +110,54 @@ auto Window::update() -> void {
   AAppIconLabel::update();
 }
 
-auto Window::getActiveWorkspace() -> Workspace {
-  const auto workspace = IPC::inst().getSocket1JsonReply("activeworkspace");
-
-  if (workspace.isObject()) {
-    return Workspace::parse(workspace);
-  }
-
-  return {};
-}
-
-auto Window::getActiveWorkspace(const std::string& monitorName) -> Workspace {
-  const auto monitors = IPC::inst().getSocket1JsonReply("monitors");
-  if (monitors.isArray()) {
-    auto monitor = std::ranges::find_if(
-        monitors, [&](Json::Value monitor) { return monitor["name"] == monitorName; });
-    if (monitor == std::end(monitors)) {
-      spdlog::warn("Monitor not found: {}", monitorName);
-      return Workspace{
-          .id = -1,
-          .windows = 0,
-          .last_window = "",
-          .last_window_title = "",
-      };
-    }
-    const int id = (*monitor)["activeWorkspace"]["id"].asInt();
-
-    const auto workspaces = IPC::inst().getSocket1JsonReply("workspaces");
-    if (workspaces.isArray()) {
-      auto workspace = std::ranges::find_if(
-          workspaces, [&](Json::Value workspace) { return workspace["id"] == id; });
-      if (workspace == std::end(workspaces)) {
-        spdlog::warn("No workspace with id {}", id);
-        return Workspace{
-            .id = -1,
-            .windows = 0,
-            .last_window = "",
-            .last_window_title = "",
-        };
-      }
-      return Workspace::parse(*workspace);
-    };
-  };
-
-  return {};
-}
-
-auto Window::Workspace::parse(const Json::Value& value) -> Window::Workspace {
-  return Workspace{
-      .id = value["id"].asInt(),
-      .windows = value["windows"].asInt(),
-      .last_window = value["lastwindow"].asString(),
-      .last_window_title = value["lastwindowtitle"].asString(),
-  };
-}
-
-auto Window::WindowData::parse(const Json::Value& value) -> Window::WindowData {
-  return WindowData{.floating = value["floating"].asBool(),
-                    .monitor = value["monitor"].asInt(),
-                    .class_name = value["class"].asString(),
-                    .initial_class_name = value["initialClass"].asString(),
-                    .title = value["title"].asString(),
-                    .initial_title = value["initialTitle"].asString(),
-                    .fullscreen = value["fullscreen"].asBool(),
-                    .grouped = !value["grouped"].empty()};
+auto Window::WindowData::from(const WindowState::Client& client) -> Window::WindowData {
+  return WindowData{.floating = client.floating,
+                    .monitor = client.monitor,
+                    .class_name = client.class_name,
+                    .initial_class_name = client.initial_class_name,
+                    .title = client.title,
+                    .initial_title = client.initial_title,
+                    .fullscreen = client.fullscreen,
+                    .grouped = client.grouped};
 }
 
 void Window::queryActiveWorkspace() {
   std::shared_lock<std::shared_mutex> windowIpcShareLock(windowIpcSmtx);
 
-  if (separateOutputs_) {
-    workspace_ = getActiveWorkspace(this->bar_.output->name);
-  } else {
-    workspace_ = getActiveWorkspace();
-  }
-
-  focused_ = true;
-  if (workspace_.windows > 0) {
-    const auto clients = m_ipc.getSocket1JsonReply("clients");
-    if (clients.isArray()) {
-      auto activeWindow = std::ranges::find_if(
-          clients, [&](Json::Value window) { return window["address"] == workspace_.last_window; });
+  m_ipc.readWindowState([this](const WindowState& state) {
+    const auto* workspace = state.activeWorkspace(separateOutputs_ ? bar_.output->name : "");
+    if (workspace == nullptr) {
+      if (separateOutputs_) {
+        spdlog::warn("No active workspace on monitor {}", bar_.output->name);
+      }
+      workspace_ = Workspace{.id = -1, .windows = 0, .last_window = "", .last_window_title = ""};
+    } else {
+      workspace_ = Workspace{.id = workspace->id,
+                             .windows = workspace->windows,
+                             .last_window = workspace->last_window,
+                             .last_window_title = workspace->last_window_title};
+    }
 
-      if (activeWindow == std::end(clients)) {
+    focused_ = true;
+    if (workspace_.windows > 0) {
+      const auto* activeWindow = state.client(workspace_.last_window);
+      if (activeWindow == nullptr) {
         focused_ = false;
         return;
       }
 
-      windowData_ = WindowData::parse(*activeWindow);
+      windowData_ = WindowData::from(*activeWindow);
       updateAppIconName(windowData_.class_name, windowData_.initial_class_name);
-      std::vector<Json::Value> workspaceWindows;
-      std::ranges::copy_if(clients, std::back_inserter(workspaceWindows), [&](Json::Value window) {
-        return window["workspace"]["id"] == workspace_.id && window["mapped"].asBool();
-      });
-      swallowing_ = std::ranges::any_of(workspaceWindows, [&](Json::Value window) {
-        return !window["swallowing"].isNull() && window["swallowing"].asString() != "0x0";
-      });
-      std::vector<Json::Value> visibleWindows;
+      const auto workspaceWindows = state.clientsOn(workspace_.id);
+      swallowing_ = std::ranges::any_of(workspaceWindows,
+                                        [](const auto* window) { return window->swallowing; });
+      std::vector<const WindowState::Client*> visibleWindows;
       std::ranges::copy_if(workspaceWindows, std::back_inserter(visibleWindows),
-                           [&](Json::Value window) { return !window["hidden"].asBool(); });
-      solo_ = 1 == std::count_if(visibleWindows.begin(), visibleWindows.end(),
-                                 [&](Json::Value window) { return !window["floating"].asBool(); });
-      allFloating_ = std::ranges::all_of(
-          visibleWindows, [&](Json::Value window) { return window["floating"].asBool(); });
+                           [](const auto* window) { return !window->hidden; });
+      solo_ = 1 == std::ranges::count_if(visibleWindows,
+                                         [](const auto* window) { return !window->floating; });
+      allFloating_ =
+          std::ranges::all_of(visibleWindows, [](const auto* window) { return window->floating; });
       fullscreen_ = windowData_.fullscreen;
 
       // Fullscreen windows look like they are solo
@@ -223,16 +170,16 @@ void Window::queryActiveWorkspace() {
       } else {
         soloClass_ = "";
       }
+    } else {
+      focused_ = false;
+      windowData_ = WindowData{};
+      allFloating_ = false;
+      swallowing_ = false;
+      fullscreen_ = false;
+      solo_ = false;
+      soloClass_ = "";
     }
-  } else {
-    focused_ = false;
-    windowData_ = WindowData{};
-    allFloating_ = false;
-    swallowing_ = false;
-    fullscreen_ = false;
-    solo_ = false;
-    soloClass_ = "";
-  }
+  });
 }
 
 void Window::onEvent(const std::string& ev) {
@@ -0,0 +1,70 @@
+#include "modules/hyprland/window_ignore_list.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace waybar::modules::hyprland {
+
+void WindowIgnoreList::load(const Json::Value& patterns) {
+  std::lock_guard lock(mutex_);
+  patterns_.clear();
+  results_.clear();
+
+  std::vector<std::string> valid;
+  for (const auto& pattern : patterns) {
+    std::string ruleString = pattern.asString();
+    try {
+      patterns_.emplace_back(ruleString, std::regex_constants::icase);
+      valid.push_back(std::move(ruleString));
+    } catch (const std::regex_error& e) {
+      spdlog::error("Invalid rule {}: {}", ruleString, e.what());
+    }
+  }
+  if (valid.size() < 2) {
+    return;
+  }
+
+  static const std::regex backreference(R"(\\[1-9])");
+  if (std::ranges::any_of(valid, [](const auto& rule) {
+        return std::regex_search(rule, backreference);
+      })) {
+    return;
+  }
+  std::string combined;
+  for (const auto& rule : valid) {
+    combined += (combined.empty() ? "(?:" : "|(?:") + rule + ")";
+  }
+  try {
+    std::regex alternation(combined, std::regex_constants::icase);
+    patterns_.clear();
+    patterns_.push_back(std::move(alternation));
+  } catch (const std::regex_error& e) {
+    // Keeps running them one by one
+    spdlog::debug("Could not combine the ignore-list: {}", e.what());
+  }
+}
+
+bool WindowIgnoreList::ignores(const std::string& window_class,
+                               const std::string& window_title) const {
+  if (patterns_.empty()) {
+    return false;
+  }
+  std::lock_guard lock(mutex_);
+  return matches(window_class) || matches(window_title);
+}
+
+bool WindowIgnoreList::matches(const std::string& value) const {
+  if (auto it = results_.find(value); it != results_.end()) {
+    return it->second;
+  }
+  bool matched = std::ranges::any_of(
+      patterns_, [&value](const auto& pattern) { return std::regex_match(value, pattern); });
+  if (results_.size() >= CACHE_CAPACITY) {
+    results_.clear();
+  }
+  results_.emplace(value, matched);
+  return matched;
+}
+
+}  // namespace waybar::modules::hyprland
@@ -0,0 +1,245 @@
+#include "modules/hyprland/window_state.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+namespace waybar::modules::hyprland {
+
+namespace {
+
+// The name and the data of "name>>data"
+std::pair<std::string_view, std::string_view> splitEvent(std::string_view event) {
+  const auto separator = event.find(">>");
+  if (separator == std::string_view::npos) {
+    return {event, {}};
+  }
+  return {event.substr(0, separator), event.substr(separator + 2)};
+}
+
+// The text up to the first comma, and the rest after it, which may have commas of its own
+std::pair<std::string_view, std::string_view> splitFirst(std::string_view data) {
+  const auto comma = data.find(',');
+  if (comma == std::string_view::npos) {
+    return {data, {}};
+  }
+  return {data.substr(0, comma), data.substr(comma + 1)};
+}
+
+bool parseInt(std::string_view text, int& value) {
+  const auto* end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+// The events give addresses without the "0x" of the replies
+std::string replyAddress(std::string_view address) {
+  std::string result = "0x";
+  result += address;
+  return result;
+}
+
+// The events that change what the state can't follow without the full picture
+bool needsReload(std::string_view name) {
+  static constexpr std::string_view EVENTS[] = {
+      "openwindow",        "closewindow",        "movewindow",        "movewindowv2",
+      "createworkspace",   "createworkspacev2",  "destroyworkspace",  "destroyworkspacev2",
+      "moveworkspace",     "moveworkspacev2",    "renameworkspace",   "monitoradded",
+      "monitoraddedv2",    "monitorremoved",     "monitorremovedv2",  "togglegroup",
+      "moveintogroup",     "moveoutofgroup",     "configreloaded",
+  };
+  return std::find(std::begin(EVENTS), std::end(EVENTS), name) != std::end(EVENTS);
+}
+
+}  // namespace
+
+void WindowState::load(const Json::Value& monitors, const Json::Value& workspaces,
+                       const Json::Value& clients) {
+  monitors_.clear();
+  workspaces_.clear();
+  clients_.clear();
+  focused_monitor_.clear();
+  active_window_.clear();
+
+  for (const auto& monitor : monitors) {
+    monitors_.push_back({.name = monitor["name"].asString(),
+                         .active_workspace = monitor["activeWorkspace"]["id"].asInt()});
+    if (monitor["focused"].asBool()) {
+      focused_monitor_ = monitors_.back().name;
+    }
+  }
+  for (const auto& workspace : workspaces) {
+    workspaces_.push_back({.id = workspace["id"].asInt(),
+                           .name = workspace["name"].asString(),
+                           .monitor = workspace["monitor"].asString(),
+                           .windows = workspace["windows"].asInt(),
+                           .has_fullscreen = workspace["hasfullscreen"].asBool(),
+                           .last_window = workspace["lastwindow"].asString(),
+                           .last_window_title = workspace["lastwindowtitle"].asString()});
+  }
+  for (const auto& client : clients) {
+    auto address = client["address"].asString();
+    const auto& swallowing = client["swallowing"];
+    clients_[address] = {
+        .address = address,
+        .workspace = client["workspace"]["id"].asInt(),
+        .monitor = client["monitor"].asInt(),
+        .class_name = client["class"].asString(),
+        .initial_class_name = client["initialClass"].asString(),
+        .title = client["title"].asString(),
+        .initial_title = client["initialTitle"].asString(),
+        .floating = client["floating"].asBool(),
+        .fullscreen = client["fullscreen"].asBool(),
+        .mapped = client["mapped"].asBool(),
+        .hidden = client["hidden"].asBool(),
+        .swallowing = !swallowing.isNull() && swallowing.asString() != "0x0",
+        .grouped = !client["grouped"].empty(),
+    };
+    if (client["focusHistoryID"].isInt() && client["focusHistoryID"].asInt() == 0) {
+      active_window_ = address;
+    }
+  }
+  // Only a reply that came in makes it so: without Hyprland, the next read tries again
+  stale_ = !monitors.isArray() || !workspaces.isArray() || !clients.isArray();
+}
+
+void WindowState::apply(std::string_view event) {
+  const auto [name, data] = splitEvent(event);
+  if (name == "windowtitlev2") {
+    title_events_ = true;
+  }
+  if (stale_) {
+    return;  // loaded from scratch on the next read anyway
+  }
+
+  if (needsReload(name)) {
+    stale_ = true;
+  } else if (name == "activewindowv2") {
+    if (data.empty() || data == ",") {
+      active_window_.clear();
+      return;
+    }
+    auto* client = findClient(replyAddress(data));
+    auto* workspace = client != nullptr ? findWorkspace(client->workspace) : nullptr;
+    if (workspace == nullptr) {
+      stale_ = true;
+      return;
+    }
+    active_window_ = client->address;
+    workspace->last_window = client->address;
+    workspace->last_window_title = client->title;
+  } else if (name == "windowtitle") {
+    // It only has the address, but since 0.42 windowtitlev2 follows with the title
+    stale_ = !title_events_;
+  } else if (name == "windowtitlev2") {
+    const auto [address, title] = splitFirst(data);
+    if (auto* client = findClient(replyAddress(address)); client != nullptr) {
+      client->title = title;
+      if (auto* workspace = findWorkspace(client->workspace);
+          workspace != nullptr && workspace->last_window == client->address) {
+        workspace->last_window_title = client->title;
+      }
+    }
+  } else if (name == "changefloatingmode") {
+    const auto [address, floating] = splitFirst(data);
+    auto* client = findClient(replyAddress(address));
+    if (client == nullptr) {
+      stale_ = true;
+      return;
+    }
+    client->floating = floating == "1";
+  } else if (name == "fullscreen") {
+    auto* client = findClient(active_window_);
+    auto* workspace = client != nullptr ? findWorkspace(client->workspace) : nullptr;
+    if (workspace == nullptr) {
+      stale_ = true;
+      return;
+    }
+    client->fullscreen = data == "1";
+    workspace->has_fullscreen = client->fullscreen;
+  } else if (name == "workspacev2") {
+    int id;
+    if (!parseInt(splitFirst(data).first, id) ||
+        !focusWorkspace(focused_monitor_, findWorkspace(id))) {
+      stale_ = true;
+    }
+  } else if (name == "workspace") {
+    if (!focusWorkspace(focused_monitor_, findWorkspace(data))) {
+      stale_ = true;
+    }
+  } else if (name == "focusedmonv2") {
+    const auto [monitor, workspace] = splitFirst(data);
+    int id;
+    if (!parseInt(workspace, id) || !focusWorkspace(monitor, findWorkspace(id))) {
+      stale_ = true;
+    }
+  } else if (name == "focusedmon") {
+    const auto [monitor, workspace] = splitFirst(data);
+    if (!focusWorkspace(monitor, findWorkspace(workspace))) {
+      stale_ = true;
+    }
+  }
+}
+
+const WindowState::Workspace* WindowState::activeWorkspace(std::string_view monitor) const {
+  const auto name = monitor.empty() ? std::string_view(focused_monitor_) : monitor;
+  const auto found = std::find_if(monitors_.begin(), monitors_.end(),
+                                  [&](const auto& other) { return other.name == name; });
+  if (found == monitors_.end()) {
+    return nullptr;
+  }
+  const auto workspace =
+      std::find_if(workspaces_.begin(), workspaces_.end(),
+                   [&](const auto& other) { return other.id == found->active_workspace; });
+  return workspace != workspaces_.end() ? &*workspace : nullptr;
+}
+
+const WindowState::Client* WindowState::client(std::string_view address) const {
+  const auto found = clients_.find(address);
+  return found != clients_.end() ? &found->second : nullptr;
+}
+
+std::vector<const WindowState::Client*> WindowState::clientsOn(int workspace) const {
+  std::vector<const Client*> clients;
+  for (const auto& [address, client] : clients_) {
+    if (client.workspace == workspace && client.mapped) {
+      clients.push_back(&client);
+    }
+  }
+  return clients;
+}
+
+WindowState::Workspace* WindowState::findWorkspace(int id) {
+  const auto found = std::find_if(workspaces_.begin(), workspaces_.end(),
+                                  [&](const auto& workspace) { return workspace.id == id; });
+  return found != workspaces_.end() ? &*found : nullptr;
+}
+
+WindowState::Workspace* WindowState::findWorkspace(std::string_view name) {
+  const auto found = std::find_if(workspaces_.begin(), workspaces_.end(),
+                                  [&](const auto& workspace) { return workspace.name == name; });
+  return found != workspaces_.end() ? &*found : nullptr;
+}
+
+WindowState::Monitor* WindowState::findMonitor(std::string_view name) {
+  const auto found = std::find_if(monitors_.begin(), monitors_.end(),
+                                  [&](const auto& monitor) { return monitor.name == name; });
+  return found != monitors_.end() ? &*found : nullptr;
+}
+
+WindowState::Client* WindowState::findClient(std::string_view address) {
+  const auto found = clients_.find(address);
+  return found != clients_.end() ? &found->second : nullptr;
+}
+
+bool WindowState::focusWorkspace(std::string_view monitor, Workspace* workspace) {
+  auto* found = findMonitor(monitor);
+  if (found == nullptr || workspace == nullptr || workspace->monitor != monitor) {
+    return false;
+  }
+  focused_monitor_ = found->name;
+  found->active_workspace = workspace->id;
+  return true;
+}
+
+}  // namespace waybar::modules::hyprland
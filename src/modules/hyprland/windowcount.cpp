@@ -63,66 +63,22 @@ auto WindowCount::update() -> void {
   AAppIconLabel::update();
 }
 
-auto WindowCount::getActiveWorkspace() -> Workspace {
-  const auto workspace = m_ipc.getSocket1JsonReply("activeworkspace");
-
-  if (workspace.isObject()) {
-    return Workspace::parse(workspace);
-  }
-
-  return {};
-}
-
-auto WindowCount::getActiveWorkspace(const std::string& monitorName) -> Workspace {
-  const auto monitors = m_ipc.getSocket1JsonReply("monitors");
-  if (monitors.isArray()) {
-    auto monitor = std::ranges::find_if(
-        monitors, [&](Json::Value monitor) { return monitor["name"] == monitorName; });
-    if (monitor == std::end(monitors)) {
-      spdlog::warn("Monitor not found: {}", monitorName);
-      return Workspace{
-          .id = -1,
-          .windows = 0,
-          .hasfullscreen = false,
-      };
-    }
-    const int id = (*monitor)["activeWorkspace"]["id"].asInt();
-
-    const auto workspaces = m_ipc.getSocket1JsonReply("workspaces");
-    if (workspaces.isArray()) {
-      auto workspace = std::ranges::find_if(
-          workspaces, [&](Json::Value workspace) { return workspace["id"] == id; });
-      if (workspace == std::end(workspaces)) {
-        spdlog::warn("No workspace with id {}", id);
-        return Workspace{
-            .id = -1,
-            .windows = 0,
-            .hasfullscreen = false,
-        };
-      }
-      return Workspace::parse(*workspace);
-    };
-  };
-
-  return {};
-}
-
-auto WindowCount::Workspace::parse(const Json::Value& value) -> WindowCount::Workspace {
-  return Workspace{
-      .id = value["id"].asInt(),
-      .windows = value["windows"].asInt(),
-      .hasfullscreen = value["hasfullscreen"].asBool(),
-  };
-}
-
 void WindowCount::queryActiveWorkspace() {
   std::lock_guard<std::mutex> lg(mutex_);
 
-  if (separateOutputs_) {
-    workspace_ = getActiveWorkspace(this->bar_.output->name);
-  } else {
-    workspace_ = getActiveWorkspace();
-  }
+  m_ipc.readWindowState([this](const WindowState& state) {
+    const auto* workspace = state.activeWorkspace(separateOutputs_ ? bar_.output->name : "");
+    if (workspace == nullptr) {
+      if (separateOutputs_) {
+        spdlog::warn("No active workspace on monitor {}", bar_.output->name);
+      }
+      workspace_ = Workspace{.id = -1, .windows = 0, .hasfullscreen = false};
+      return;
+    }
+    workspace_ = Workspace{.id = workspace->id,
+                           .windows = workspace->windows,
+                           .hasfullscreen = workspace->has_fullscreen};
+  });
 }
 
 void WindowCount::onEvent(const std::string& ev) {
@@ -13,22 +13,7 @@ namespace waybar::modules::hyprland {
 
 Workspace::Workspace(const Json::Value &workspace_data, Workspaces &workspace_manager,
                      const Json::Value &clients_data)
-    : m_workspaceManager(workspace_manager),
-      m_id(workspace_data["id"].asInt()),
-      m_name(workspace_data["name"].asString()),
-      m_output(workspace_data["monitor"].asString()),  // TODO:allow using monitor desc
-      m_windows(workspace_data["windows"].asInt()),
-      m_isActive(true),
-      m_isPersistentRule(workspace_data["persistent-rule"].asBool()),
-      m_isPersistentConfig(workspace_data["persistent-config"].asBool()),
-      m_ipc(IPC::inst()) {
-  if (m_name.starts_with("name:")) {
-    m_name = m_name.substr(5);
-  } else if (m_name.starts_with("special")) {
-    m_name = m_id == -99 ? m_name : m_name.substr(8);
-    m_isSpecial = true;
-  }
-
+    : m_workspaceManager(workspace_manager), m_ipc(IPC::inst()) {
   m_button.add_events(Gdk::BUTTON_PRESS_MASK);
   m_button.signal_button_press_event().connect(sigc::mem_fun(*this, &Workspace::handleClicked),
                                                false);
@@ -42,6 +27,27 @@ Workspace::Workspace(const Json::Value &workspace_data, Workspaces &workspace_ma
   }
   m_button.add(m_content);
 
+  bind(workspace_data, clients_data);
+}
+
+void Workspace::bind(const Json::Value &workspace_data, const Json::Value &clients_data) {
+  m_id = workspace_data["id"].asInt();
+  m_name = workspace_data["name"].asString();
+  m_output = workspace_data["monitor"].asString();  // TODO:allow using monitor desc
+  m_windows = workspace_data["windows"].asInt();
+  m_isActive = true;
+  m_isSpecial = false;
+  m_isPersistentRule = workspace_data["persistent-rule"].asBool();
+  m_isPersistentConfig = workspace_data["persistent-config"].asBool();
+  m_isUrgent = false;
+  m_isVisible = false;
+  if (m_name.starts_with("name:")) {
+    m_name = m_name.substr(5);
+  } else if (m_name.starts_with("special")) {
+    m_name = m_id == -99 ? m_name : m_name.substr(8);
+    m_isSpecial = true;
+  }
+
   initializeWindowMap(clients_data);
 }
 
@@ -61,6 +67,7 @@ std::optional<WindowRepr> Workspace::closeWindow(WindowAddress const &addr) {
   if (it != m_windowMap.end()) {
     WindowRepr windowRepr = *it;
     m_windowMap.erase(it);
+    m_workspaceManager.unindexWindow(addr, this);
     return windowRepr;
   }
   return std::nullopt;
@@ -94,7 +101,26 @@ bool Workspace::handleClicked(GdkEventButton *bt) const {
   return false;
 }
 
+Workspace::~Workspace() {
+  for (const auto &window : m_windowMap) {
+    m_workspaceManager.unindexWindow(window.address, this);
+  }
+}
+
+bool Workspace::containsWindow(WindowAddress const &addr) const {
+  return m_workspaceManager.windowWorkspace(addr) == this;
+}
+
+const WindowRepr *Workspace::findWindow(WindowAddress const &addr) const {
+  auto it = std::ranges::find_if(m_windowMap,
+                                 [&addr](const auto &window) { return window.address == addr; });
+  return it != m_windowMap.end() ? &*it : nullptr;
+}
+
 void Workspace::initializeWindowMap(const Json::Value &clients_data) {
+  for (const auto &window : m_windowMap) {
+    m_workspaceManager.unindexWindow(window.address, this);
+  }
   m_windowMap.clear();
   for (auto client : clients_data) {
     if (client["workspace"]["id"].asInt() == id()) {
@@ -139,6 +165,7 @@ void Workspace::insertWindow(WindowCreationPayload create_window_payload) {
         *it = repr;
       } else {
         m_windowMap.emplace_back(repr);
+        m_workspaceManager.indexWindow(addr, this);
       }
     }
   }
@@ -152,7 +179,7 @@ bool Workspace::onWindowOpened(WindowCreationPayload const &create_window_payloa
   return false;
 }
 
-std::string &Workspace::selectIcon(std::map<std::string, std::string> &icons_map) {
+std::string &Workspace::selectIcon(util::StringMap<std::string> &icons_map) {
   spdlog::trace("Selecting icon for workspace {}", name());
   if (isUrgent()) {
     auto urgentIconIt = icons_map.find("urgent");
@@ -257,7 +284,7 @@ void Workspace::update(const std::string &workspace_icon) {
     }
   }
 
-  auto formatBefore = m_workspaceManager.formatBefore();
+  const auto &formatBefore = m_workspaceManager.formatBefore();
   m_labelBefore.set_markup(fmt::format(fmt::runtime(formatBefore), fmt::arg("id", id()),
                                        fmt::arg("name", name()), fmt::arg("icon", workspace_icon),
                                        fmt::arg("windows", windows)));
@@ -269,14 +296,12 @@ void Workspace::update(const std::string &workspace_icon) {
 }
 
 bool Workspace::isEmpty() const {
-  auto ignore_list = m_workspaceManager.getIgnoredWindows();
-  if (ignore_list.empty()) {
+  if (m_workspaceManager.getIgnoredWindows().empty()) {
     return m_windows == 0;
   }
   // If there are windows but they are all ignored, consider the workspace empty
-  return std::all_of(
-      m_windowMap.begin(), m_windowMap.end(),
-      [this, &ignore_list](const auto &window_repr) { return shouldSkipWindow(window_repr); });
+  return std::all_of(m_windowMap.begin(), m_windowMap.end(),
+                     [this](const auto &window_repr) { return shouldSkipWindow(window_repr); });
 }
 
 void Workspace::updateTaskbar(const std::string &workspace_icon) {
@@ -348,7 +373,7 @@ void Workspace::updateTaskbar(const std::string &workspace_icon) {
     }
   }
 
-  auto formatAfter = m_workspaceManager.formatAfter();
+  const auto &formatAfter = m_workspaceManager.formatAfter();
   if (!formatAfter.empty()) {
     m_labelAfter.set_markup(fmt::format(fmt::runtime(formatAfter), fmt::arg("id", id()),
                                         fmt::arg("name", name()),
@@ -373,12 +398,8 @@ bool Workspace::handleClick(const GdkEventButton *event_button, WindowAddress co
 }
 
 bool Workspace::shouldSkipWindow(const WindowRepr &window_repr) const {
-  auto ignore_list = m_workspaceManager.getIgnoredWindows();
-  auto it = std::ranges::find_if(ignore_list, [&window_repr](const auto &ignoreItem) {
-    return std::regex_match(window_repr.window_class, ignoreItem) ||
-           std::regex_match(window_repr.window_title, ignoreItem);
-  });
-  return it != ignore_list.end();
+  return m_workspaceManager.getIgnoredWindows().ignores(window_repr.window_class,
+                                                        window_repr.window_title);
 }
 
 }  // namespace waybar::modules::hyprland
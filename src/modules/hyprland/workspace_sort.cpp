@@ -0,0 +1,69 @@
+#include "modules/hyprland/workspace_sort.hpp"
+
+#include <cctype>
+#include <charconv>
+
+namespace waybar::modules::hyprland {
+
+WorkspaceSortKey workspaceSortKey(int id, std::string_view name, bool special) {
+  WorkspaceSortKey key{id, std::nullopt, special, name};
+
+  // std::stoi skips leading whitespace and takes a sign, from_chars only takes '-'
+  auto first = name.data();
+  auto last = name.data() + name.size();
+  while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+    ++first;
+  }
+  if (first != last && *first == '+' && first + 1 != last && *(first + 1) != '-') {
+    ++first;
+  }
+  int number = 0;
+  if (auto [ptr, ec] = std::from_chars(first, last, number); ec == std::errc()) {
+    key.number = number;
+  }
+  return key;
+}
+
+bool idLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b) { return a.id < b.id; }
+
+bool nameLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b) { return a.name < b.name; }
+
+bool numberLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b) {
+  if (a.number && b.number) {
+    return *a.number < *b.number;
+  }
+  return nameLess(a, b);
+}
+
+bool defaultLess(const WorkspaceSortKey& a, const WorkspaceSortKey& b) {
+  // both normal (includes numbered persistent) => sort by ID
+  if (a.id > 0 && b.id > 0) {
+    return idLess(a, b);
+  }
+
+  // one normal, one special => normal first
+  if (a.special ^ b.special) {
+    return b.special;
+  }
+
+  // only one normal, one named
+  if ((a.id > 0) ^ (b.id > 0)) {
+    return a.id > 0;
+  }
+
+  // both special
+  if (a.special && b.special) {
+    // if one is -99 => put it last
+    if (a.id == -99 || b.id == -99) {
+      return b.id == -99;
+    }
+    // both are 0 (not yet named persistents) / named specials
+    // (-98 <= ID <= -1)
+    return nameLess(a, b);
+  }
+
+  // sort non-special named workspaces by name (ID <= -1377)
+  return nameLess(a, b);
+}
+
+}  // namespace waybar::modules::hyprland
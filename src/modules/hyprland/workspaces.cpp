@@ -1,5 +1,6 @@
 #include "modules/hyprland/workspaces.hpp"
 
+#include <glibmm/main.h>
 #include <json/value.h>
 #include <spdlog/spdlog.h>
 #include <unistd.h>
@@ -10,6 +11,7 @@
 #include <string>
 #include <utility>
 
+#include "util/command.hpp"
 #include "util/regex_collection.hpp"
 #include "util/string.hpp"
 
@@ -38,6 +40,7 @@ Workspaces::~Workspaces() {
   m_ipc.unregisterForIPC(this);
   // wait for possible event handler to finish
   std::lock_guard<std::mutex> lg(m_mutex);
+  m_titleFlush.disconnect();
 }
 
 void Workspaces::init() {
@@ -99,10 +102,16 @@ void Workspaces::createWorkspace(Json::Value const &workspace_data,
     return;
   }
 
-  // create new workspace
-  m_workspaces.emplace_back(std::make_unique<Workspace>(workspace_data, *this, clients_data));
+  m_sortInputs.invalidate();
+  // create new workspace, with the widgets of a destroyed one if there is
+  if (auto spare = m_spareWorkspaces.take()) {
+    spare->bind(workspace_data, clients_data);
+    m_workspaces.emplace_back(std::move(spare));
+  } else {
+    m_workspaces.emplace_back(std::make_unique<Workspace>(workspace_data, *this, clients_data));
+    m_box.pack_start(m_workspaces.back()->button(), false, false);
+  }
   Gtk::Button &newWorkspaceButton = m_workspaces.back()->button();
-  m_box.pack_start(newWorkspaceButton, false, false);
   sortWorkspaces();
   newWorkspaceButton.show_all();
 }
@@ -127,6 +136,7 @@ void Workspaces::createWorkspacesToCreate() {
 void Workspaces::doUpdate() {
   std::unique_lock lock(m_mutex);
 
+  flushWindowTitles();
   removeWorkspacesToRemove();
   createWorkspacesToCreate();
   updateWorkspaceStates();
@@ -187,8 +197,9 @@ void Workspaces::initializeWorkspaces() {
   }
 
   // get all current workspaces
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
-  auto const clientsJson = m_ipc.getSocket1JsonReply("clients");
+  auto const replies = m_ipc.getSocket1JsonReplies({"workspaces", "clients"});
+  auto const& workspacesJson = replies[0];
+  auto const& clientsJson = replies[1];
 
   for (Json::Value workspaceJson : workspacesJson) {
     std::string workspaceName = workspaceJson["name"].asString();
@@ -396,8 +407,9 @@ void Workspaces::onWorkspaceCreated(std::string const &payload, Json::Value cons
     return;
   }
 
-  auto const workspaceRules = m_ipc.getSocket1JsonReply("workspacerules");
-  auto const workspacesJson = m_ipc.getSocket1JsonReply("workspaces");
+  auto const replies = m_ipc.getSocket1JsonReplies({"workspacerules", "workspaces"});
+  auto const& workspaceRules = replies[0];
+  auto const& workspacesJson = replies[1];
 
   for (Json::Value workspaceJson : workspacesJson) {
     const auto currentId = workspaceJson["id"].asInt();
@@ -523,10 +535,9 @@ void Workspaces::onWindowClosed(std::string const &addr) {
   spdlog::trace("Window closed: {}", addr);
   updateWindowCount();
   m_orphanWindowMap.erase(addr);
-  for (auto &workspace : m_workspaces) {
-    if (workspace->closeWindow(addr)) {
-      break;
-    }
+  m_titleThrottle.forget(addr);
+  if (auto *workspace = windowWorkspace(addr); workspace != nullptr) {
+    workspace->closeWindow(addr);
   }
 }
 
@@ -547,10 +558,9 @@ void Workspaces::onWindowMoved(std::string const &payload) {
   }
 
   // Take the window's representation from the old workspace...
-  for (auto &workspace : m_workspaces) {
+  if (auto *workspace = windowWorkspace(windowAddress); workspace != nullptr) {
     if (auto windowAddr = workspace->closeWindow(windowAddress); windowAddr != std::nullopt) {
       windowRepr = windowAddr.value();
-      break;
     }
   }
 
@@ -568,38 +578,44 @@ void Workspaces::onWindowMoved(std::string const &payload) {
 
 void Workspaces::onWindowTitleEvent(std::string const &payload) {
   spdlog::trace("Window title changed: {}", payload);
-  std::optional<std::function<void(WindowCreationPayload)>> inserter;
+  auto [windowAddress, windowTitle] = splitDoublePayload(payload);
 
-  const auto [windowAddress, _] = splitDoublePayload(payload);
+  // Held back for the next update if the window changes its title too often
+  if (m_titleThrottle.enabled()) {
+    m_titleThrottle.push(windowAddress, std::move(windowTitle));
+    return;
+  }
+  updateWindowTitle(windowAddress, windowTitle);
+}
 
-  // If the window was an orphan, rename it at the orphan's vector
-  if (m_orphanWindowMap.contains(windowAddress)) {
-    inserter = [this](WindowCreationPayload wcp) { this->registerOrphanWindow(std::move(wcp)); };
-  } else {
-    auto windowWorkspace = std::ranges::find_if(m_workspaces, [windowAddress](auto &workspace) {
-      return workspace->containsWindow(windowAddress);
-    });
+void Workspaces::updateWindowTitle(WindowAddress const &windowAddress,
+                                   std::string const &windowTitle) {
+  // If the window was an orphan, rename it at the orphan's map
+  if (auto orphan = m_orphanWindowMap.find(windowAddress); orphan != m_orphanWindowMap.end()) {
+    const auto &window = orphan->second;
+    if (window.window_title != windowTitle) {
+      registerOrphanWindow({"", windowAddress, window.window_class, windowTitle, window.isActive});
+    }
+    return;
+  }
 
-    // If the window exists on a workspace, rename it at the workspace's window
-    // map
-    if (windowWorkspace != m_workspaces.end()) {
-      inserter = [windowWorkspace](WindowCreationPayload wcp) {
-        (*windowWorkspace)->insertWindow(std::move(wcp));
-      };
-    } else {
-      auto queuedWindow =
-          std::ranges::find_if(m_windowsToCreate, [&windowAddress](auto &windowPayload) {
-            return windowPayload.getAddress() == windowAddress;
-          });
-
-      // If the window was queued, rename it in the queue
-      if (queuedWindow != m_windowsToCreate.end()) {
-        inserter = [queuedWindow](WindowCreationPayload wcp) { *queuedWindow = std::move(wcp); };
-      }
+  // If the window exists on a workspace, rename it at the workspace's window
+  // map
+  if (auto *workspace = windowWorkspace(windowAddress); workspace != nullptr) {
+    const auto *window = workspace->findWindow(windowAddress);
+    if (window != nullptr && window->window_title != windowTitle) {
+      workspace->insertWindow(
+          {workspace->name(), windowAddress, window->window_class, windowTitle, window->isActive});
     }
+    return;
   }
 
-  if (inserter.has_value()) {
+  // If the window was queued, rename it in the queue. Its class is only known to Hyprland.
+  auto queuedWindow =
+      std::ranges::find_if(m_windowsToCreate, [&windowAddress](auto &windowPayload) {
+        return windowPayload.getAddress() == windowAddress;
+      });
+  if (queuedWindow != m_windowsToCreate.end()) {
     Json::Value clientsData = m_ipc.getSocket1JsonReply("clients");
     std::string jsonWindowAddress = fmt::format("0x{}", windowAddress);
 
@@ -608,11 +624,27 @@ void Workspaces::onWindowTitleEvent(std::string const &payload) {
     });
 
     if (client != clientsData.end() && !client->empty()) {
-      (*inserter)({*client});
+      *queuedWindow = {*client};
     }
   }
 }
 
+void Workspaces::flushWindowTitles() {
+  auto next = m_titleThrottle.flush(
+      [this](WindowAddress const &address, std::string const &title) {
+        updateWindowTitle(address, title);
+      });
+  // the titles held back are applied by the update following their interval
+  if (next && !m_titleFlush.connected()) {
+    m_titleFlush = Glib::signal_timeout().connect(
+        [this] {
+          dp.emit();
+          return false;
+        },
+        next->count());
+  }
+}
+
 void Workspaces::onActiveWindowChanged(WindowAddress const &activeWindowAddress) {
   spdlog::trace("Active window changed: {}", activeWindowAddress);
   m_currentActiveWindowAddress = activeWindowAddress;
@@ -652,8 +684,8 @@ auto Workspaces::parseConfig(const Json::Value &config) -> void {
 
   m_persistentWorkspaceConfig = config.get("persistent-workspaces", Json::Value());
   
-  m_onWorkspaceCreated = config.get("on-workspace-created", "").asString();
-  m_onWorkspaceDestroyed = config.get("on-workspace-destroyed", "").asString();
+  m_onWorkspaceCreated = HookTemplate(config.get("on-workspace-created", "").asString());
+  m_onWorkspaceDestroyed = HookTemplate(config.get("on-workspace-destroyed", "").asString());
   
   populateSortByConfig(config);
   populateIgnoreWorkspacesConfig(config);
@@ -735,9 +767,15 @@ auto Workspaces::populateWindowRewriteConfig(const Json::Value &config) -> void
   std::string windowRewriteDefault =
       windowRewriteDefaultConfig.isString() ? windowRewriteDefaultConfig.asString() : "?";
 
+  const auto &titleInterval = config["window-title-interval"];
+  m_titleThrottle.setInterval(
+      std::chrono::milliseconds(titleInterval.isUInt() ? titleInterval.asUInt() : 0));
+
+  const auto &cacheSize = config["window-rewrite-cache-size"];
   m_windowRewriteRules = util::RegexCollection(
       windowRewrite, windowRewriteDefault,
-      [this](std::string &window_rule) { return windowRewritePriorityFunction(window_rule); });
+      [this](std::string &window_rule) { return windowRewritePriorityFunction(window_rule); },
+      cacheSize.isUInt() ? cacheSize.asUInt() : util::RegexCollection::DEFAULT_CACHE_CAPACITY);
 }
 
 auto Workspaces::populateWorkspaceTaskbarConfig(const Json::Value &config) -> void {
@@ -788,14 +826,7 @@ auto Workspaces::populateWorkspaceTaskbarConfig(const Json::Value &config) -> vo
   }
 
   if (workspaceTaskbar["ignore-list"].isArray()) {
-    for (auto &windowRegex : workspaceTaskbar["ignore-list"]) {
-      std::string ruleString = windowRegex.asString();
-      try {
-        m_ignoreWindows.emplace_back(ruleString, std::regex_constants::icase);
-      } catch (const std::regex_error &e) {
-        spdlog::error("Invalid rule {}: {}", ruleString, e.what());
-      }
-    }
+    m_ignoreWindows.load(workspaceTaskbar["ignore-list"]);
   }
 
   if (workspaceTaskbar["active-window-position"].isString()) {
@@ -888,8 +919,11 @@ void Workspaces::removeWorkspace(std::string const &workspaceString) {
     return;
   }
 
-  m_box.remove(workspace->get()->button());
+  auto &button = (*workspace)->button();
+  (*workspace)->bind(Json::Value());
+  m_spareWorkspaces.give(std::move(*workspace), button);
   m_workspaces.erase(workspace);
+  m_sortInputs.invalidate();
 }
 
 void Workspaces::setCurrentMonitorId() {
@@ -942,73 +976,81 @@ void Workspaces::sortSpecialCentered() {
 }
 
 void Workspaces::sortWorkspaces() {
-  std::ranges::sort(  //
-      m_workspaces, [&](std::unique_ptr<Workspace> &a, std::unique_ptr<Workspace> &b) {
-        // Helper comparisons
-        auto isIdLess = a->id() < b->id();
-        auto isNameLess = a->name() < b->name();
-
-        switch (m_sortBy) {
-          case SortMethod::ID:
-            return isIdLess;
-          case SortMethod::NAME:
-            return isNameLess;
-          case SortMethod::NUMBER:
-            try {
-              return std::stoi(a->name()) < std::stoi(b->name());
-            } catch (const std::invalid_argument &) {
-              // Handle the exception if necessary.
-              break;
-            }
-          case SortMethod::DEFAULT:
-          default:
-            // Handle the default case here.
-            // normal -> named persistent -> named -> special -> named special
-
-            // both normal (includes numbered persistent) => sort by ID
-            if (a->id() > 0 && b->id() > 0) {
-              return isIdLess;
-            }
-
-            // one normal, one special => normal first
-            if ((a->isSpecial()) ^ (b->isSpecial())) {
-              return b->isSpecial();
-            }
-
-            // only one normal, one named
-            if ((a->id() > 0) ^ (b->id() > 0)) {
-              return a->id() > 0;
-            }
-
-            // both special
-            if (a->isSpecial() && b->isSpecial()) {
-              // if one is -99 => put it last
-              if (a->id() == -99 || b->id() == -99) {
-                return b->id() == -99;
-              }
-              // both are 0 (not yet named persistents) / named specials
-              // (-98 <= ID <= -1)
-              return isNameLess;
-            }
-
-            // sort non-special named workspaces by name (ID <= -1377)
-            return isNameLess;
-            break;
-        }
+  auto inputs = [this] {
+    std::vector<WorkspaceSortInputs::Entry> entries;
+    entries.reserve(m_workspaces.size());
+    for (const auto &workspace : m_workspaces) {
+      entries.push_back({workspace.get(), workspace->id(), workspace->isSpecial(),
+                         workspace->button().is_visible(), workspace->name()});
+    }
+    return entries;
+  };
+  if (!m_sortInputs.changed(inputs())) {
+    return;
+  }
+
+  auto less = defaultLess;
+  switch (m_sortBy) {
+    case SortMethod::ID:
+      less = idLess;
+      break;
+    case SortMethod::NAME:
+      less = nameLess;
+      break;
+    case SortMethod::NUMBER:
+      less = numberLess;
+      break;
+    case SortMethod::SPECIAL_CENTERED:
+    case SortMethod::DEFAULT:
+    default:
+      break;
+  }
+
+  // The keys view the names of the workspaces, which stay where they are while sorted
+  std::vector<std::pair<WorkspaceSortKey, std::unique_ptr<Workspace>>> sorted;
+  sorted.reserve(m_workspaces.size());
+  for (auto &workspace : m_workspaces) {
+    auto key = workspaceSortKey(workspace->id(), workspace->name(), workspace->isSpecial());
+    sorted.emplace_back(key, std::move(workspace));
+  }
+  std::ranges::sort(sorted, less, &decltype(sorted)::value_type::first);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    m_workspaces[i] = std::move(sorted[i].second);
+  }
 
-        // Return a default value if none of the cases match.
-        return isNameLess;  // You can adjust this to your specific needs.
-      });
   if (m_sortBy == SortMethod::SPECIAL_CENTERED) {
     this->sortSpecialCentered();
   }
+  m_sortInputs.record(inputs());
 
   for (size_t i = 0; i < m_workspaces.size(); ++i) {
     m_box.reorder_child(m_workspaces[i]->button(), i);
   }
 }
 
+Workspace *Workspaces::windowWorkspace(WindowAddress const &addr) const {
+  auto it = m_windowIndex.find(addr);
+  return it != m_windowIndex.end() ? it->second : nullptr;
+}
+
+void Workspaces::indexWindow(WindowAddress const &addr, Workspace *workspace) {
+  m_windowIndex[addr] = workspace;
+}
+
+void Workspaces::unindexWindow(WindowAddress const &addr, const Workspace *workspace) {
+  // a window moved meanwhile belongs to its new workspace
+  if (auto it = m_windowIndex.find(addr); it != m_windowIndex.end() && it->second == workspace) {
+    m_windowIndex.erase(it);
+  }
+}
+
 void Workspaces::setUrgentWorkspace(std::string const &windowaddress) {
+  if (auto *workspace = windowWorkspace(windowaddress); workspace != nullptr) {
+    workspace->setUrgent();
+    return;
+  }
+
+  // the windows without a representation aren't indexed, ask Hyprland
   const Json::Value clientsJson = m_ipc.getSocket1JsonReply("clients");
   int workspaceId = -1;
 
@@ -1168,45 +1210,19 @@ std::optional<int> Workspaces::parseWorkspaceId(std::string const &workspaceIdSt
   }
 }
 
-void Workspaces::executeHook(const std::string& command, const std::string& workspaceName,
+void Workspaces::executeHook(const HookTemplate& hook, const std::string& workspaceName,
                              const std::string& workspaceMonitor, int workspaceId) {
-  if (command.empty()) {
+  if (hook.empty()) {
     return;
   }
 
-  // Replace variables in command
-  std::string cmd = command;
-  size_t pos = 0;
-  while ((pos = cmd.find("{name}", pos)) != std::string::npos) {
-    cmd.replace(pos, 6, workspaceName);
-    pos += workspaceName.length();
-  }
-  
-  pos = 0;
-  while ((pos = cmd.find("{monitor}", pos)) != std::string::npos) {
-    cmd.replace(pos, 9, workspaceMonitor);
-    pos += workspaceMonitor.length();
-  }
-  
-  pos = 0;
-  std::string idStr = std::to_string(workspaceId);
-  while ((pos = cmd.find("{id}", pos)) != std::string::npos) {
-    cmd.replace(pos, 4, idStr);
-    pos += idStr.length();
-  }
-
+  std::string cmd = hook.expand(workspaceName, workspaceMonitor, workspaceId);
   spdlog::debug("Executing hook: {}", cmd);
 
-  // Fork and execute command asynchronously
-  pid_t pid = fork();
-  if (pid == 0) {
-    // Child process
-    execl("/bin/sh", "sh", "-c", cmd.c_str(), nullptr);
-    _exit(1);
-  } else if (pid < 0) {
-    spdlog::error("Failed to fork process for hook execution");
+  // Spawned without forking waybar and reaped along with the other children
+  if (util::command::forkExec(cmd, true) < 0) {
+    spdlog::error("Failed to spawn process for hook execution");
   }
-  // Parent continues without waiting
 }
 
 }  // namespace waybar::modules::hyprland
@@ -1,5 +1,8 @@
 #include "modules/image.hpp"
 
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+
 waybar::modules::Image::Image(const std::string& id, const Json::Value& config)
     : AModule(config, "image", id), box_(Gtk::ORIENTATION_HORIZONTAL, 0) {
   box_.pack_start(image_);
@@ -31,45 +34,103 @@ waybar::modules::Image::Image(const std::string& id, const Json::Value& config)
   }
 
   delayWorker();
+  if (config_["watch"].isString()) {
+    watch_ = std::make_unique<util::FileWatch>(config_["watch"].asString(),
+                                               [this] { thread_.wake_up(); });
+  }
 }
 
+// The script and the decode run here, not in update(): a slow one would stall every bar
 void waybar::modules::Image::delayWorker() {
   thread_ = [this] {
+    load();
     dp.emit();
     thread_.sleep_for(interval_);
   };
 }
 
+void waybar::modules::Image::load() {
+  const int scale = scale_;
+  std::string path;
+  std::string tooltip;
+  if (config_["path"].isString()) {
+    path = config_["path"].asString();
+  } else if (config_["exec"].isString()) {
+    auto output = util::command::exec(config_["exec"].asString(), "", false,
+                                      std::chrono::milliseconds::zero(), thread_.stopFd());
+    parseOutputRaw(output.out, path, tooltip);
+  }
+
+  struct stat st {};
+  const bool exists = !path.empty() && ::stat(path.c_str(), &st) == 0;
+  {
+    std::lock_guard lock(mutex_);
+    loaded_.tooltip = tooltip;
+    if (exists && loaded_.pixbuf && loaded_.path == path && loaded_.mtime == st.st_mtime &&
+        loaded_.scale == scale) {
+      return;
+    }
+  }
+
+  Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+  if (exists) {
+    try {
+      pixbuf = Gdk::Pixbuf::create_from_file(path, size_ * scale, size_ * scale);
+    } catch (const Glib::Error& e) {
+      spdlog::warn("image: can't load {}: {}", path, e.what().c_str());
+    }
+  }
+
+  std::lock_guard lock(mutex_);
+  loaded_.path = path;
+  loaded_.pixbuf = pixbuf;
+  loaded_.scale = scale;
+  loaded_.mtime = exists ? st.st_mtime : 0;
+  loaded_.changed = true;
+}
+
 void waybar::modules::Image::refresh(int sig) {
-  if (sig == SIGRTMIN + config_["signal"].asInt()) {
+  if (sig == refreshSignal_) {
     thread_.wake_up();
   }
 }
 
+auto waybar::modules::Image::setPaused(bool paused) -> void {
+  AModule::setPaused(paused);
+  thread_.pause(paused);
+}
+
 auto waybar::modules::Image::update() -> void {
-  if (config_["path"].isString()) {
-    path_ = config_["path"].asString();
-  } else if (config_["exec"].isString()) {
-    output_ = util::command::exec(config_["exec"].asString(), "");
-    parseOutputRaw();
-  } else {
-    path_ = "";
+  const int scale = image_.get_scale_factor();
+  if (scale_.exchange(scale) != scale) {
+    // Decoded for the former output, a sharper one is on its way
+    thread_.wake_up();
   }
 
-  if (Glib::file_test(path_, Glib::FILE_TEST_EXISTS)) {
-    Glib::RefPtr<Gdk::Pixbuf> pixbuf;
-
-    int scaled_icon_size = size_ * image_.get_scale_factor();
-    pixbuf = Gdk::Pixbuf::create_from_file(path_, scaled_icon_size, scaled_icon_size);
+  Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+  std::string tooltip;
+  int pixbuf_scale;
+  bool changed;
+  {
+    std::lock_guard lock(mutex_);
+    pixbuf = loaded_.pixbuf;
+    pixbuf_scale = loaded_.scale;
+    tooltip = loaded_.tooltip;
+    changed = loaded_.changed;
+    loaded_.changed = false;
+  }
 
-    auto surface = Gdk::Cairo::create_surface_from_pixbuf(pixbuf, image_.get_scale_factor(),
-                                                          image_.get_window());
-    image_.set(surface);
+  if (pixbuf) {
+    if (changed) {
+      auto surface =
+          Gdk::Cairo::create_surface_from_pixbuf(pixbuf, pixbuf_scale, image_.get_window());
+      image_.set(surface);
+    }
     image_.show();
 
-    if (tooltipEnabled() && !tooltip_.empty()) {
-      if (box_.get_tooltip_markup() != tooltip_) {
-        box_.set_tooltip_markup(tooltip_);
+    if (tooltipEnabled() && !tooltip.empty()) {
+      if (box_.get_tooltip_markup() != tooltip) {
+        box_.set_tooltip_markup(tooltip);
       }
     }
 
@@ -83,15 +144,16 @@ auto waybar::modules::Image::update() -> void {
   AModule::update();
 }
 
-void waybar::modules::Image::parseOutputRaw() {
-  std::istringstream output(output_.out);
+void waybar::modules::Image::parseOutputRaw(const std::string& output, std::string& path,
+                                            std::string& tooltip) {
+  std::istringstream stream(output);
   std::string line;
   int i = 0;
-  while (getline(output, line)) {
+  while (getline(stream, line)) {
     if (i == 0) {
-      path_ = line;
+      path = line;
     } else if (i == 1) {
-      tooltip_ = line;
+      tooltip = line;
     } else {
       break;
     }
@@ -6,37 +6,13 @@
 
 namespace {
 
-using DBus = std::unique_ptr<GDBusConnection, void (*)(GDBusConnection*)>;
-
-auto dbus() -> DBus {
-  GError* error = nullptr;
-  GDBusConnection* connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
-
-  if (error) {
-    spdlog::error("g_bus_get_sync() failed: {}", error->message);
-    g_error_free(error);
-    connection = nullptr;
-  }
-
-  auto destructor = [](GDBusConnection* connection) {
-    GError* error = nullptr;
-    g_dbus_connection_close_sync(connection, nullptr, &error);
-    if (error) {
-      spdlog::error("g_bus_connection_close_sync failed(): {}", error->message);
-      g_error_free(error);
-    }
-  };
-
-  return DBus{connection, destructor};
-}
-
-auto getLocks(const DBus& bus, const std::string& inhibitors) -> int {
+auto getLocks(GDBusConnection* bus, const std::string& inhibitors) -> int {
   GError* error = nullptr;
   GUnixFDList* fd_list;
   int handle;
 
   auto reply = g_dbus_connection_call_with_unix_fd_list_sync(
-      bus.get(), "org.freedesktop.login1", "/org/freedesktop/login1",
+      bus, "org.freedesktop.login1", "/org/freedesktop/login1",
       "org.freedesktop.login1.Manager", "Inhibit",
       g_variant_new("(ssss)", inhibitors.c_str(), "waybar", "Asked by user", "block"),
       G_VARIANT_TYPE("(h)"), G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &fd_list, nullptr, &error);
@@ -99,25 +75,53 @@ namespace waybar::modules {
 
 Inhibitor::Inhibitor(const std::string& id, const Bar& bar, const Json::Value& config)
     : ALabel(config, "inhibitor", id, "{status}", true),
-      dbus_(::dbus()),
+      dbus_(nullptr, g_object_unref),
+      cancellable_(g_cancellable_new(), g_object_unref),
       inhibitors_(::getInhibitors(config)) {
+  // The shared connection of the process, shown as loading while it is being set up
+  g_bus_get(G_BUS_TYPE_SYSTEM, cancellable_.get(), onBusReady, this);
   event_box_.add_events(Gdk::BUTTON_PRESS_MASK);
   event_box_.signal_button_press_event().connect(sigc::mem_fun(*this, &Inhibitor::handleToggle));
   dp.emit();
 }
 
 Inhibitor::~Inhibitor() {
+  g_cancellable_cancel(cancellable_.get());
   if (handle_ != -1) {
     ::close(handle_);
   }
 }
 
+void Inhibitor::onBusReady(GObject* /*source*/, GAsyncResult* result, gpointer user_data) {
+  GError* error = nullptr;
+  GDBusConnection* connection = g_bus_get_finish(result, &error);
+  if (error) {
+    // Cancelled when the module is gone already
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      spdlog::error("g_bus_get() failed: {}", error->message);
+      auto* self = static_cast<Inhibitor*>(user_data);
+      self->loading_ = false;
+      self->dp.emit();
+    }
+    g_error_free(error);
+    return;
+  }
+  auto* self = static_cast<Inhibitor*>(user_data);
+  self->dbus_.reset(connection);
+  self->loading_ = false;
+  self->dp.emit();
+}
+
 auto Inhibitor::activated() -> bool { return handle_ != -1; }
 
 auto Inhibitor::update() -> void {
-  std::string status_text = activated() ? "activated" : "deactivated";
+  std::string status_text = loading_ ? "loading" : activated() ? "activated" : "deactivated";
 
-  label_.get_style_context()->remove_class(activated() ? "deactivated" : "activated");
+  for (const auto* status : {"loading", "activated", "deactivated"}) {
+    if (status_text != status) {
+      label_.get_style_context()->remove_class(status);
+    }
+  }
   label_.set_markup(fmt::format(fmt::runtime(format_), fmt::arg("status", status_text),
                                 fmt::arg("icon", getIcon(0, status_text))));
   label_.get_style_context()->add_class(status_text);
@@ -134,8 +138,10 @@ auto Inhibitor::handleToggle(GdkEventButton* const& e) -> bool {
     if (activated()) {
       ::close(handle_);
       handle_ = -1;
+    } else if (!dbus_) {
+      spdlog::error("cannot get inhibitor locks without the system bus");
     } else {
-      handle_ = ::getLocks(dbus_, inhibitors_);
+      handle_ = ::getLocks(dbus_.get(), inhibitors_);
       if (handle_ == -1) {
         spdlog::error("cannot get inhibitor locks");
       }
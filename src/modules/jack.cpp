@@ -7,20 +7,20 @@ JACK::JACK(const std::string &id, const Json::Value &config)
   running_ = false;
   client_ = NULL;
 
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+  // The DSP load is polled, and (re)connecting is attempted, on the interval. The callbacks
+  // update the rest as it changes.
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
 }
 
 std::string JACK::JACKState() {
   std::lock_guard<std::mutex> lock(mutex_);
   if (running_) {
     load_ = jack_cpu_load(client_);
-    return state_;
+    return xrun_.exchange(false) ? "xrun" : "connected";
   }
 
   xruns_ = 0;
+  xrun_ = false;
   load_ = 0;
   bufsize_ = 0;
   samplerate_ = 0;
@@ -51,19 +51,15 @@ std::string JACK::JACKState() {
 }
 
 auto JACK::update() -> void {
+  update_queued_ = false;
   std::string format;
   std::string state = JACKState();
-  float latency = 1000 * (float)bufsize_ / (float)samplerate_;
-
-  if (label_.get_style_context()->has_class("xrun")) {
-    label_.get_style_context()->remove_class("xrun");
-    state = "connected";
-  }
+  const jack_nframes_t bufsize = bufsize_;
+  const jack_nframes_t samplerate = samplerate_;
+  const unsigned int xruns = xruns_;
+  float latency = 1000 * (float)bufsize / (float)samplerate;
 
-  if (label_.get_style_context()->has_class(state_))
-    label_.get_style_context()->remove_class(state_);
-  label_.get_style_context()->add_class(state);
-  state_ = state;
+  state_class_.set(state);
 
   if (config_["format-" + state].isString()) {
     format = config_["format-" + state].asString();
@@ -73,17 +69,17 @@ auto JACK::update() -> void {
     format = "{load}%";
 
   label_.set_markup(fmt::format(fmt::runtime(format), fmt::arg("load", std::round(load_)),
-                                fmt::arg("bufsize", bufsize_), fmt::arg("samplerate", samplerate_),
+                                fmt::arg("bufsize", bufsize), fmt::arg("samplerate", samplerate),
                                 fmt::arg("latency", fmt::format("{:.2f}", latency)),
-                                fmt::arg("xruns", xruns_)));
+                                fmt::arg("xruns", xruns)));
 
   if (tooltipEnabled()) {
     std::string tooltip_format = "{bufsize}/{samplerate} {latency}ms";
     if (config_["tooltip-format"].isString()) tooltip_format = config_["tooltip-format"].asString();
     label_.set_tooltip_text(fmt::format(
         fmt::runtime(tooltip_format), fmt::arg("load", std::round(load_)),
-        fmt::arg("bufsize", bufsize_), fmt::arg("samplerate", samplerate_),
-        fmt::arg("latency", fmt::format("{:.2f}", latency)), fmt::arg("xruns", xruns_)));
+        fmt::arg("bufsize", bufsize), fmt::arg("samplerate", samplerate),
+        fmt::arg("latency", fmt::format("{:.2f}", latency)), fmt::arg("xruns", xruns)));
   }
 
   // Call parent update
@@ -92,23 +88,35 @@ auto JACK::update() -> void {
 
 int JACK::bufSize(jack_nframes_t size) {
   bufsize_ = size;
+  notify();
   return 0;
 }
 
 int JACK::sampleRate(jack_nframes_t rate) {
   samplerate_ = rate;
+  notify();
   return 0;
 }
 
 int JACK::xrun() {
   xruns_ += 1;
-  state_ = "xrun";
+  xrun_ = true;
+  notify();
   return 0;
 }
 
 void JACK::shutdown() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  notify();
+}
+
+void JACK::notify() {
+  if (!update_queued_.exchange(true)) {
+    dp.emit();
+  }
 }
 
 }  // namespace waybar::modules
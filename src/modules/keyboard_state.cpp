@@ -4,19 +4,33 @@
 #include <spdlog/spdlog.h>
 #include <string.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
 
 extern "C" {
+#include <dirent.h>
 #include <fcntl.h>
-#include <libinput.h>
-#include <linux/input-event-codes.h>
-#include <poll.h>
+#include <libevdev/libevdev.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 }
 
+#include "util/shared_instance.hpp"
+#include "util/sleeper_thread.hpp"
+
 class errno_error : public std::runtime_error {
  public:
   int code;
@@ -78,6 +92,302 @@ auto supportsLockStates(const libevdev* dev) -> bool {
          libevdev_has_event_code(dev, EV_LED, LED_SCROLLL);
 }
 
+namespace waybar::modules {
+
+/* The keyboards with lock LEDs, shared by every keyboard-state module. Their fds are kept open
+ * and masked to the LED events, so the one thread watching them and the hotplug inotify only
+ * wakes when a lock state changes, not on every key press. It lives as long as one of its
+ * modules holds it.
+ */
+class KeyboardState::Devices {
+ public:
+  struct Leds {
+    bool numlock = false;
+    bool capslock = false;
+    bool scrolllock = false;
+    bool operator==(const Leds&) const = default;
+  };
+
+  static std::shared_ptr<Devices> getInstance();
+  ~Devices();
+
+  /* Adds the device if it has the lock LEDs. A hotplugged one that can't be opened yet waits
+   * for udev to set its permissions.
+   */
+  void tryAddDevice(const std::string& path, bool hotplugged = false);
+  bool empty();
+  bool contains(const std::string& path);
+  // The LEDs of preferred if it is one of the devices, else of the first one
+  std::optional<Leds> leds(const std::string& preferred);
+
+  // on_change is called from the devices thread when the LEDs of a device changed
+  int subscribe(std::function<void()> on_change);
+  void unsubscribe(int id);
+
+ private:
+  static constexpr const char* DEVICES_PATH = "/dev/input/";
+  static constexpr int EPOLL_MAX_EVENTS = 16;
+
+  struct Device {
+    int fd;
+    Leds leds;
+  };
+
+  Devices();
+  void watch();
+  // Both with the mutex locked
+  void readLeds(Device& device);
+  void removeDevice(std::map<std::string, Device>::iterator it);
+  void onHotplug();
+
+  std::mutex mutex_;
+  std::map<std::string, Device> devices_;
+  // Hotplugged devices without permissions yet, only used by the devices thread
+  std::set<std::string> pending_;
+
+  std::mutex subscribers_mutex_;
+  std::vector<std::pair<int, std::function<void()>>> subscribers_;
+  int next_subscriber_id_ = 0;
+
+  int epoll_fd_ = -1;
+  int inotify_fd_ = -1;
+  // thread must destruct before shared data
+  util::SleeperThread thread_;
+};
+
+std::shared_ptr<KeyboardState::Devices> KeyboardState::Devices::getInstance() {
+  static util::SharedInstance<Devices> instance;
+  return instance.get([] { return std::shared_ptr<Devices>(new Devices()); });
+}
+
+KeyboardState::Devices::Devices() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    throw errno_error(errno, "Failed to initialize epoll");
+  }
+
+  // udev sets the permissions of a new device after creating it
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    spdlog::error("Failed to initialize inotify: {}", strerror(errno));
+  } else {
+    inotify_add_watch(inotify_fd_, DEVICES_PATH, IN_CREATE | IN_DELETE | IN_ATTRIB);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = inotify_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, inotify_fd_, &event);
+  }
+
+  DIR* dev_dir = opendir(DEVICES_PATH);
+  if (dev_dir == nullptr) {
+    throw errno_error(errno, std::string("Failed to open ") + DEVICES_PATH);
+  }
+  dirent* ep;
+  while ((ep = readdir(dev_dir))) {
+    if (ep->d_type == DT_DIR) continue;
+    tryAddDevice(DEVICES_PATH + std::string(ep->d_name));
+  }
+  closedir(dev_dir);
+
+  // ends the epoll_wait once the thread is stopped
+  epoll_event stop_event{};
+  stop_event.events = EPOLLIN;
+  stop_event.data.fd = thread_.stopFd();
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, thread_.stopFd(), &stop_event);
+
+  thread_ = [this] { watch(); };
+}
+
+KeyboardState::Devices::~Devices() {
+  thread_.stop();
+  thread_.join();
+  while (!devices_.empty()) {
+    removeDevice(devices_.begin());
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  close(epoll_fd_);
+}
+
+void KeyboardState::Devices::tryAddDevice(const std::string& path, bool hotplugged) {
+  try {
+    int fd = openFile(path, O_NONBLOCK | O_CLOEXEC | O_RDONLY);
+    libevdev* dev;
+    try {
+      dev = openDevice(fd);
+    } catch (const errno_error&) {
+      closeFile(fd);
+      throw;
+    }
+    const bool supported = supportsLockStates(dev);
+    const std::string name = libevdev_get_name(dev);
+    libevdev_free(dev);
+    if (hotplugged) {
+      pending_.erase(path);
+    }
+
+    std::lock_guard lock(mutex_);
+    if (!supported || devices_.contains(path)) {
+      closeFile(fd);
+      return;
+    }
+    spdlog::info("Found device {} at '{}'", name, path);
+
+    // Only the LED events are of interest, the key ones are the bulk of the traffic
+    unsigned long types[(EV_CNT + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))]{};
+    types[EV_LED / (8 * sizeof(unsigned long))] |= 1UL << (EV_LED % (8 * sizeof(unsigned long)));
+    input_mask mask{0, sizeof(types), reinterpret_cast<uint64_t>(types)};
+    if (ioctl(fd, EVIOCSMASK, &mask) < 0) {
+      spdlog::debug("keyboard-state: can't mask the events of {}: {}", path, strerror(errno));
+    }
+
+    auto& device = devices_[path] = Device{fd, {}};
+    readLeds(device);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  } catch (const errno_error& e) {
+    if (hotplugged && e.code == EACCES) {
+      pending_.insert(path);
+      return;
+    }
+    // ENOTTY just means the device isn't an evdev device, skip it
+    if (e.code != ENOTTY) {
+      spdlog::warn(e.what());
+    }
+  }
+}
+
+bool KeyboardState::Devices::empty() {
+  std::lock_guard lock(mutex_);
+  return devices_.empty();
+}
+
+bool KeyboardState::Devices::contains(const std::string& path) {
+  std::lock_guard lock(mutex_);
+  return devices_.contains(path);
+}
+
+auto KeyboardState::Devices::leds(const std::string& preferred) -> std::optional<Leds> {
+  std::lock_guard lock(mutex_);
+  if (auto it = devices_.find(preferred); it != devices_.end()) {
+    return it->second.leds;
+  }
+  if (devices_.empty()) {
+    return std::nullopt;
+  }
+  return devices_.begin()->second.leds;
+}
+
+int KeyboardState::Devices::subscribe(std::function<void()> on_change) {
+  std::lock_guard lock(subscribers_mutex_);
+  subscribers_.emplace_back(next_subscriber_id_, std::move(on_change));
+  return next_subscriber_id_++;
+}
+
+void KeyboardState::Devices::unsubscribe(int id) {
+  std::lock_guard lock(subscribers_mutex_);
+  std::erase_if(subscribers_, [id](const auto& subscriber) { return subscriber.first == id; });
+}
+
+void KeyboardState::Devices::readLeds(Device& device) {
+  uint8_t bits[(LED_CNT + 7) / 8]{};
+  if (ioctl(device.fd, EVIOCGLED(sizeof(bits)), bits) < 0) {
+    return;
+  }
+  auto test = [&bits](int led) { return (bits[led / 8] >> (led % 8)) & 1; };
+  device.leds = {static_cast<bool>(test(LED_NUML)), static_cast<bool>(test(LED_CAPSL)),
+                 static_cast<bool>(test(LED_SCROLLL))};
+}
+
+void KeyboardState::Devices::removeDevice(std::map<std::string, Device>::iterator it) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  close(it->second.fd);
+  devices_.erase(it);
+}
+
+void KeyboardState::Devices::watch() {
+  epoll_event events[EPOLL_MAX_EVENTS];
+  int n = epoll_wait(epoll_fd_, events, EPOLL_MAX_EVENTS, -1);
+  if (n < 0) {
+    if (errno != EINTR) {
+      spdlog::error("keyboard-state: epoll_wait failed: {}", strerror(errno));
+      thread_.sleep();
+    }
+    return;
+  }
+
+  bool changed = false;
+  for (int i = 0; i < n; ++i) {
+    if (events[i].data.fd == thread_.stopFd()) {
+      return;
+    }
+    if (events[i].data.fd == inotify_fd_) {
+      onHotplug();
+      continue;
+    }
+    std::lock_guard lock(mutex_);
+    auto it = std::find_if(devices_.begin(), devices_.end(), [&](const auto& device) {
+      return device.second.fd == events[i].data.fd;
+    });
+    if (it == devices_.end()) {
+      continue;
+    }
+    // The LEDs are read whole below, the events only tell they changed
+    input_event input[64];
+    ssize_t length;
+    while ((length = read(it->second.fd, input, sizeof(input))) > 0) {
+    }
+    if (length < 0 && errno == ENODEV) {
+      spdlog::info("Keyboard {} has been removed.", it->first);
+      removeDevice(it);
+      changed = true;
+      continue;
+    }
+    const auto before = it->second.leds;
+    readLeds(it->second);
+    changed |= before != it->second.leds;
+  }
+
+  if (!changed) {
+    return;
+  }
+  std::lock_guard lock(subscribers_mutex_);
+  for (const auto& [id, on_change] : subscribers_) {
+    on_change();
+  }
+}
+
+void KeyboardState::Devices::onHotplug() {
+  char buf[1024 * (sizeof(struct inotify_event) + 16)];
+  ssize_t length;
+  while ((length = read(inotify_fd_, buf, sizeof(buf))) > 0) {
+    for (ssize_t i = 0; i < length;) {
+      auto* event = reinterpret_cast<struct inotify_event*>(&buf[i]);
+      i += sizeof(struct inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      std::string dev_path = DEVICES_PATH + std::string(event->name);
+      if ((event->mask & IN_CREATE) ||
+          ((event->mask & IN_ATTRIB) && pending_.contains(dev_path))) {
+        tryAddDevice(dev_path, true);
+      } else if (event->mask & IN_DELETE) {
+        pending_.erase(dev_path);
+        std::lock_guard lock(mutex_);
+        if (auto it = devices_.find(dev_path); it != devices_.end()) {
+          spdlog::info("Keyboard {} has been removed.", dev_path);
+          removeDevice(it);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace waybar::modules
+
 waybar::modules::KeyboardState::KeyboardState(const std::string& id, const Bar& bar,
                                               const Json::Value& config)
     : AModule(config, "keyboard-state", id, false, !config["disable-scroll"].asBool()),
@@ -104,18 +414,11 @@ waybar::modules::KeyboardState::KeyboardState(const std::string& id, const Bar&
       icon_unlocked_(config_["format-icons"]["unlocked"].isString()
                          ? config_["format-icons"]["unlocked"].asString()
                          : "unlocked"),
-      devices_path_("/dev/input/"),
-      libinput_(nullptr),
-      libinput_devices_({}) {
-  static struct libinput_interface interface = {
-      [](const char* path, int flags, void* user_data) { return open(path, flags); },
-      [](int fd, void* user_data) { close(fd); }};
+      devices_(Devices::getInstance()) {
   if (config_["interval"].isUInt()) {
     spdlog::warn("keyboard-state: interval is deprecated");
   }
 
-  libinput_ = libinput_path_create_context(&interface, NULL);
-
   box_.set_name("keyboard-state");
   if (config_["numlock"].asBool()) {
     numlock_label_.get_style_context()->add_class("numlock");
@@ -136,145 +439,29 @@ waybar::modules::KeyboardState::KeyboardState(const std::string& id, const Bar&
   event_box_.add(box_);
 
   if (config_["device-path"].isString()) {
-    std::string dev_path = config_["device-path"].asString();
-    tryAddDevice(dev_path);
-    if (libinput_devices_.empty()) {
-      spdlog::error("keyboard-state: Cannot find device {}", dev_path);
-    }
-  }
-
-  auto keys = config_["binding-keys"];
-  if (keys.isArray()) {
-    for (const auto& key : keys) {
-      if (key.isInt()) {
-        binding_keys.insert(key.asInt());
-      } else {
-        spdlog::warn("Cannot read key binding {} as int.", key.asString());
-      }
+    device_path_ = config_["device-path"].asString();
+    devices_->tryAddDevice(device_path_);
+    if (!devices_->contains(device_path_)) {
+      spdlog::error("keyboard-state: Cannot find device {}", device_path_);
     }
-  } else {
-    binding_keys.insert(KEY_CAPSLOCK);
-    binding_keys.insert(KEY_NUMLOCK);
-    binding_keys.insert(KEY_SCROLLLOCK);
   }
 
-  DIR* dev_dir = opendir(devices_path_.c_str());
-  if (dev_dir == nullptr) {
-    throw errno_error(errno, "Failed to open " + devices_path_);
-  }
-  dirent* ep;
-  while ((ep = readdir(dev_dir))) {
-    if (ep->d_type == DT_DIR) continue;
-    std::string dev_path = devices_path_ + ep->d_name;
-    tryAddDevice(dev_path);
+  if (config_["binding-keys"].isArray()) {
+    spdlog::warn("keyboard-state: binding-keys is deprecated");
   }
 
-  if (libinput_devices_.empty()) {
+  if (devices_->empty()) {
     throw errno_error(errno, "Failed to find keyboard device");
   }
 
-  libinput_thread_ = [this] {
-    dp.emit();
-    while (1) {
-      struct pollfd fd = {libinput_get_fd(libinput_), POLLIN, 0};
-      poll(&fd, 1, -1);
-      libinput_dispatch(libinput_);
-      struct libinput_event* event;
-      while ((event = libinput_get_event(libinput_))) {
-        auto type = libinput_event_get_type(event);
-        if (type == LIBINPUT_EVENT_KEYBOARD_KEY) {
-          auto keyboard_event = libinput_event_get_keyboard_event(event);
-          auto state = libinput_event_keyboard_get_key_state(keyboard_event);
-          if (state == LIBINPUT_KEY_STATE_RELEASED) {
-            uint32_t key = libinput_event_keyboard_get_key(keyboard_event);
-            if (binding_keys.contains(key)) {
-              dp.emit();
-            }
-          }
-        }
-        libinput_event_destroy(event);
-      }
-    }
-  };
-
-  hotplug_thread_ = [this] {
-    int fd;
-    fd = inotify_init();
-    if (fd < 0) {
-      spdlog::error("Failed to initialize inotify: {}", strerror(errno));
-      return;
-    }
-    inotify_add_watch(fd, devices_path_.c_str(), IN_CREATE | IN_DELETE);
-    while (1) {
-      int BUF_LEN = 1024 * (sizeof(struct inotify_event) + 16);
-      char buf[BUF_LEN];
-      int length = read(fd, buf, 1024);
-      if (length < 0) {
-        spdlog::error("Failed to read inotify: {}", strerror(errno));
-        return;
-      }
-      for (int i = 0; i < length;) {
-        struct inotify_event* event = (struct inotify_event*)&buf[i];
-        std::string dev_path = devices_path_ + event->name;
-        if (event->mask & IN_CREATE) {
-          // Wait for device setup
-          int timeout = 10;
-          while (timeout--) {
-            try {
-              int fd = openFile(dev_path, O_NONBLOCK | O_CLOEXEC | O_RDONLY);
-              closeFile(fd);
-              break;
-            } catch (const errno_error& e) {
-              if (e.code == EACCES) {
-                sleep(1);
-              }
-            }
-          }
-          tryAddDevice(dev_path);
-        } else if (event->mask & IN_DELETE) {
-          auto it = libinput_devices_.find(dev_path);
-          if (it != libinput_devices_.end()) {
-            spdlog::info("Keyboard {} has been removed.", dev_path);
-            libinput_devices_.erase(it);
-          }
-        }
-        i += sizeof(struct inotify_event) + event->len;
-      }
-    }
-  };
+  subscription_ = devices_->subscribe([this] { dp.emit(); });
+  dp.emit();
 }
 
-waybar::modules::KeyboardState::~KeyboardState() {
-  for (const auto& [_, dev_ptr] : libinput_devices_) {
-    libinput_path_remove_device(dev_ptr);
-  }
-}
+waybar::modules::KeyboardState::~KeyboardState() { devices_->unsubscribe(subscription_); }
 
 auto waybar::modules::KeyboardState::update() -> void {
-  sleep(0);  // Wait for keyboard status change
-  int numl = 0, capsl = 0, scrolll = 0;
-
-  try {
-    std::string dev_path;
-    if (config_["device-path"].isString() &&
-        libinput_devices_.find(config_["device-path"].asString()) != libinput_devices_.end()) {
-      dev_path = config_["device-path"].asString();
-    } else {
-      dev_path = libinput_devices_.begin()->first;
-    }
-    int fd = openFile(dev_path, O_NONBLOCK | O_CLOEXEC | O_RDONLY);
-    auto dev = openDevice(fd);
-    numl = libevdev_get_event_value(dev, EV_LED, LED_NUML);
-    capsl = libevdev_get_event_value(dev, EV_LED, LED_CAPSL);
-    scrolll = libevdev_get_event_value(dev, EV_LED, LED_SCROLLL);
-    libevdev_free(dev);
-    closeFile(fd);
-  } catch (const errno_error& e) {
-    // ENOTTY just means the device isn't an evdev device, skip it
-    if (e.code != ENOTTY) {
-      spdlog::warn(e.what());
-    }
-  }
+  auto leds = devices_->leds(device_path_).value_or(Devices::Leds{});
 
   struct {
     bool state;
@@ -282,9 +469,9 @@ auto waybar::modules::KeyboardState::update() -> void {
     const std::string& format;
     const char* name;
   } label_states[] = {
-      {(bool)numl, numlock_label_, numlock_format_, "Num"},
-      {(bool)capsl, capslock_label_, capslock_format_, "Caps"},
-      {(bool)scrolll, scrolllock_label_, scrolllock_format_, "Scroll"},
+      {leds.numlock, numlock_label_, numlock_format_, "Num"},
+      {leds.capslock, capslock_label_, capslock_format_, "Caps"},
+      {leds.scrolllock, scrolllock_label_, scrolllock_format_, "Scroll"},
   };
   for (auto& label_state : label_states) {
     std::string text;
@@ -301,25 +488,3 @@ auto waybar::modules::KeyboardState::update() -> void {
 
   AModule::update();
 }
-
-auto waybar::modules ::KeyboardState::tryAddDevice(const std::string& dev_path) -> void {
-  try {
-    int fd = openFile(dev_path, O_NONBLOCK | O_CLOEXEC | O_RDONLY);
-    auto dev = openDevice(fd);
-    if (supportsLockStates(dev)) {
-      spdlog::info("Found device {} at '{}'", libevdev_get_name(dev), dev_path);
-      if (libinput_devices_.find(dev_path) == libinput_devices_.end()) {
-        auto device = libinput_path_add_device(libinput_, dev_path.c_str());
-        libinput_device_ref(device);
-        libinput_devices_[dev_path] = device;
-      }
-    }
-    libevdev_free(dev);
-    closeFile(fd);
-  } catch (const errno_error& e) {
-    // ENOTTY just means the device isn't an evdev device, skip it
-    if (e.code != ENOTTY) {
-      spdlog::warn(e.what());
-    }
-  }
-}
@@ -9,17 +9,45 @@
 #include <fmt/core.h>
 #endif
 
+#include <cmath>
+#include <mutex>
+
+#include "util/proc_file.hpp"
+
+namespace {
+
+// Out of a persistent /proc/loadavg where there is one, "0.52 0.58 0.59 1/1094 23089": getloadavg
+// opens and parses it on every call
+bool readLoadavg(double (&load)[3]) {
+#ifdef __linux__
+  static std::mutex mutex;
+  static waybar::util::ProcFile loadavg{"/proc/loadavg"};
+  std::lock_guard lock(mutex);
+  auto data = loadavg.tryRead();
+  if (data && waybar::util::nextNumber(*data, load[0]) &&
+      waybar::util::nextNumber(*data, load[1]) && waybar::util::nextNumber(*data, load[2])) {
+    return true;
+  }
+#endif
+  return getloadavg(load, 3) != -1;
+}
+
+}  // namespace
+
 waybar::modules::Load::Load(const std::string& id, const Json::Value& config)
-    : ALabel(config, "load", id, "{load1}", 10) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+    : ALabel(config, "load", id, "{load1}", 10),
+      sample_(util::SharedSample<LoadSample>::get("load", interval_)) {
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::Load::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::Load::update() -> void {
   // TODO: as creating dynamic fmt::arg arrays is buggy we have to calc both
-  auto [load1, load5, load15] = Load::getLoad();
+  auto [load1, load5, load15] = *sample_->sample([](const LoadSample*) { return getLoad(); });
   if (tooltipEnabled()) {
     auto tooltip = fmt::format("Load 1: {}\nLoad 5: {}\nLoad 15: {}", load1, load5, load15);
     label_.set_tooltip_text(tooltip);
@@ -51,7 +79,7 @@ auto waybar::modules::Load::update() -> void {
 
 std::tuple<double, double, double> waybar::modules::Load::getLoad() {
   double load[3];
-  if (getloadavg(load, 3) != -1) {
+  if (readLoadavg(load)) {
     double load1 = std::ceil(load[0] * 100.0) / 100.0;
     double load5 = std::ceil(load[1] * 100.0) / 100.0;
     double load15 = std::ceil(load[2] * 100.0) / 100.0;
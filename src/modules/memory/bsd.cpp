@@ -79,7 +79,10 @@ static uint64_t get_free_memory() {
 #endif
 }
 
-void waybar::modules::Memory::parseMeminfo() {
-  meminfo_["MemTotal"] = get_total_memory() / 1024;
-  meminfo_["MemAvailable"] = get_free_memory() / 1024;
+waybar::modules::Memory::Meminfo waybar::modules::Memory::parseMeminfo() {
+  Meminfo meminfo;
+  meminfo.mem_total = get_total_memory() / 1024;
+  meminfo.mem_available = get_free_memory() / 1024;
+  meminfo.has_mem_available = true;
+  return meminfo;
 }
@@ -1,33 +1,30 @@
 #include "modules/memory.hpp"
 
 waybar::modules::Memory::Memory(const std::string& id, const Json::Value& config)
-    : ALabel(config, "memory", id, "{}%", 30) {
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+    : ALabel(config, "memory", id, "{}%", 30),
+      sample_(util::SharedSample<Meminfo>::get("memory", interval_)) {
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::Memory::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::Memory::update() -> void {
-  parseMeminfo();
+  meminfo_ = *sample_->sample([](const Meminfo*) { return parseMeminfo(); });
 
-  unsigned long memtotal = meminfo_["MemTotal"];
-  unsigned long swaptotal = 0;
-  if (meminfo_.count("SwapTotal")) {
-    swaptotal = meminfo_["SwapTotal"];
-  }
+  unsigned long memtotal = meminfo_.mem_total;
+  unsigned long swaptotal = meminfo_.swap_total;
   unsigned long memfree;
-  unsigned long swapfree = 0;
-  if (meminfo_.count("SwapFree")) {
-    swapfree = meminfo_["SwapFree"];
-  }
-  if (meminfo_.count("MemAvailable")) {
+  unsigned long swapfree = meminfo_.swap_free;
+  if (meminfo_.has_mem_available) {
     // New kernels (3.4+) have an accurate available memory field.
-    memfree = meminfo_["MemAvailable"] + meminfo_["zfs_size"];
+    memfree = meminfo_.mem_available + meminfo_.zfs_size;
   } else {
     // Old kernel; give a best-effort approximation of available memory.
-    memfree = meminfo_["MemFree"] + meminfo_["Buffers"] + meminfo_["Cached"] +
-              meminfo_["SReclaimable"] - meminfo_["Shmem"] + meminfo_["zfs_size"];
+    memfree = meminfo_.mem_free + meminfo_.buffers + meminfo_.cached + meminfo_.s_reclaimable -
+              meminfo_.shmem + meminfo_.zfs_size;
   }
 
   if (memtotal > 0 && memfree >= 0) {
@@ -1,43 +1,94 @@
-#include "modules/memory.hpp"
+#include <array>
+#include <cstdint>
+#include <mutex>
 
-static unsigned zfsArcSize() {
-  std::ifstream zfs_arc_stats{"/proc/spl/kstat/zfs/arcstats"};
+#include "modules/memory.hpp"
+#include "util/proc_file.hpp"
 
-  if (zfs_arc_stats.is_open()) {
-    std::string name;
-    std::string type;
-    unsigned long data{0};
+namespace {
 
-    std::string line;
-    while (std::getline(zfs_arc_stats, line)) {
-      std::stringstream(line) >> name >> type >> data;
+using Meminfo = waybar::modules::Memory::Meminfo;
 
-      if (name == "size") {
-        return data / 1024;  // convert to kB
-      }
-    }
+constexpr uint32_t hashKey(std::string_view key) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (const char c : key) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
   }
+  return hash;
+}
 
-  return 0;
+struct Field {
+  std::string_view key;
+  uint32_t hash;
+  unsigned long Meminfo::*value;
+};
+
+constexpr Field field(std::string_view key, unsigned long Meminfo::*value) {
+  return {key, hashKey(key), value};
 }
 
-void waybar::modules::Memory::parseMeminfo() {
-  const std::string data_dir_ = "/proc/meminfo";
-  std::ifstream info(data_dir_);
-  if (!info.is_open()) {
-    throw std::runtime_error("Can't open " + data_dir_);
+// The only lines of /proc/meminfo that are parsed, out of about 55
+constexpr std::array fields = {
+    field("MemTotal", &Meminfo::mem_total),         field("MemFree", &Meminfo::mem_free),
+    field("MemAvailable", &Meminfo::mem_available), field("Buffers", &Meminfo::buffers),
+    field("Cached", &Meminfo::cached),              field("SReclaimable", &Meminfo::s_reclaimable),
+    field("Shmem", &Meminfo::shmem),                field("SwapTotal", &Meminfo::swap_total),
+    field("SwapFree", &Meminfo::swap_free),
+};
+
+unsigned long zfsArcSize() {
+  // Only exists with ZFS loaded, tryRead() is one failing open() otherwise
+  static waybar::util::ProcFile zfs_arc_stats{"/proc/spl/kstat/zfs/arcstats"};
+  auto data = zfs_arc_stats.tryRead();
+  if (!data) {
+    return 0;
+  }
+  // name type data, eg. "size                            4    4294967296"
+  const auto pos = data->find("\nsize ");
+  if (pos == std::string_view::npos) {
+    return 0;
+  }
+  auto line = data->substr(pos + 6);
+  unsigned type;
+  unsigned long size = 0;
+  if (!waybar::util::nextNumber(line, type) || !waybar::util::nextNumber(line, size)) {
+    return 0;
   }
-  std::string line;
-  while (getline(info, line)) {
-    auto posDelim = line.find(':');
-    if (posDelim == std::string::npos) {
+  return size / 1024;  // convert to kB
+}
+
+}  // namespace
+
+waybar::modules::Memory::Meminfo waybar::modules::Memory::parseMeminfo() {
+  static std::mutex mutex;
+  static util::ProcFile info{"/proc/meminfo"};
+
+  std::lock_guard lock(mutex);
+  auto data = info.read();
+  Meminfo meminfo;
+  size_t found = 0;
+  while (!data.empty() && found < fields.size()) {
+    auto line = data.substr(0, data.find('\n'));
+    data.remove_prefix(std::min(line.size() + 1, data.size()));
+
+    const auto posDelim = line.find(':');
+    if (posDelim == std::string_view::npos) {
       continue;
     }
-
-    std::string name = line.substr(0, posDelim);
-    int64_t value = std::stol(line.substr(posDelim + 1));
-    meminfo_[name] = value;
+    const auto name = line.substr(0, posDelim);
+    const auto hash = hashKey(name);
+    for (const auto& f : fields) {
+      if (f.hash == hash && f.key == name) {
+        line.remove_prefix(posDelim + 1);
+        util::nextNumber(line, meminfo.*f.value);
+        meminfo.has_mem_available |= f.value == &Meminfo::mem_available;
+        ++found;
+        break;
+      }
+    }
   }
 
-  meminfo_["zfs_size"] = zfsArcSize();
+  meminfo.zfs_size = zfsArcSize();
+  return meminfo;
 }
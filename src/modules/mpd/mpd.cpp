@@ -4,27 +4,14 @@
 #include <glibmm/ustring.h>
 #include <spdlog/spdlog.h>
 
-#include <system_error>
+#include <algorithm>
+#include <limits>
 #include <util/sanitize_str.hpp>
 using namespace waybar::util;
 
-#include "modules/mpd/state.hpp"
-#if defined(MPD_NOINLINE)
-namespace waybar::modules {
-#include "modules/mpd/state.inl.hpp"
-}  // namespace waybar::modules
-#endif
-
 waybar::modules::MPD::MPD(const std::string& id, const Json::Value& config)
     : ALabel(config, "mpd", id, "{album} - {artist} - {title}", 5, false, true),
-      module_name_(id.empty() ? "mpd" : "mpd#" + id),
-      server_(nullptr),
-      port_(config_["port"].isUInt() ? config["port"].asUInt() : 0),
-      password_(config_["password"].empty() ? "" : config_["password"].asString()),
-      timeout_(config_["timeout"].isUInt() ? config_["timeout"].asUInt() * 1'000 : 30'000),
-      connection_(nullptr, &mpd_connection_free),
-      status_(nullptr, &mpd_status_free),
-      song_(nullptr, &mpd_song_free) {
+      module_name_(id.empty() ? "mpd" : "mpd#" + id) {
   if (!config_["port"].isNull() && !config_["port"].isUInt()) {
     spdlog::warn("{}: `port` configuration should be an unsigned int", module_name_);
   }
@@ -33,43 +20,44 @@ waybar::modules::MPD::MPD(const std::string& id, const Json::Value& config)
     spdlog::warn("{}: `timeout` configuration should be an unsigned int", module_name_);
   }
 
+  std::string server;
   if (!config["server"].isNull()) {
     if (!config_["server"].isString()) {
       spdlog::warn("{}:`server` configuration should be a string", module_name_);
     }
-    server_ = config["server"].asCString();
+    server = config["server"].asString();
   }
 
+  // The reconnection timer counts in seconds, "once" gets the longest one it can arm
+  auto interval = std::clamp<std::chrono::seconds::rep>(
+      std::chrono::duration_cast<std::chrono::seconds>(interval_).count(), 1,
+      std::numeric_limits<int>::max());
+
+  server_ = detail::Server::getInstance(
+      server, config_["port"].isUInt() ? config["port"].asUInt() : 0,
+      config_["password"].empty() ? "" : config_["password"].asString(),
+      config_["timeout"].isUInt() ? config_["timeout"].asUInt() * 1'000 : 30'000, interval);
+  subscription_ = server_->subscribe([this] { dp.emit(); });
+  // A server shared with another module may be connected already and won't notify until it changes
+  dp.emit();
+
   event_box_.add_events(Gdk::BUTTON_PRESS_MASK);
   event_box_.signal_button_press_event().connect(sigc::mem_fun(*this, &MPD::handlePlayPause));
 }
 
+waybar::modules::MPD::~MPD() noexcept { server_->unsubscribe(subscription_); }
+
 auto waybar::modules::MPD::update() -> void {
-  context_.update();
+  setLabel();
 
   // Call parent update
   ALabel::update();
 }
 
-void waybar::modules::MPD::queryMPD() {
-  if (connection_ != nullptr) {
-    spdlog::trace("{}: fetching state information", module_name_);
-    try {
-      fetchState();
-      spdlog::trace("{}: fetch complete", module_name_);
-    } catch (std::exception const& e) {
-      spdlog::error("{}: {}", module_name_, e.what());
-      state_ = MPD_STATE_UNKNOWN;
-    }
-
-    dp.emit();
-  }
-}
-
 std::string waybar::modules::MPD::getTag(mpd_tag_type type, unsigned idx) const {
   std::string result =
       config_["unknown-tag"].isString() ? config_["unknown-tag"].asString() : "N/A";
-  const char* tag = mpd_song_get_tag(song_.get(), type, idx);
+  const char* tag = mpd_song_get_tag(server_->song(), type, idx);
 
   // mpd_song_get_tag can return NULL, so make sure it's valid before setting
   if (tag) result = tag;
@@ -78,7 +66,7 @@ std::string waybar::modules::MPD::getTag(mpd_tag_type type, unsigned idx) const
 }
 
 std::string waybar::modules::MPD::getFilename() const {
-  std::string path = mpd_song_get_uri(song_.get());
+  std::string path = mpd_song_get_uri(server_->song());
   size_t position = path.find_last_of("/");
   if (position == std::string::npos) {
     return path;
@@ -88,7 +76,7 @@ std::string waybar::modules::MPD::getFilename() const {
 }
 
 void waybar::modules::MPD::setLabel() {
-  if (connection_ == nullptr) {
+  if (!server_->connected()) {
     label_.get_style_context()->add_class("disconnected");
     label_.get_style_context()->remove_class("stopped");
     label_.get_style_context()->remove_class("playing");
@@ -123,7 +111,7 @@ void waybar::modules::MPD::setLabel() {
   std::chrono::seconds elapsedTime, totalTime;
 
   std::string stateIcon = "";
-  bool no_song = song_.get() == nullptr;
+  bool no_song = server_->song() == nullptr;
   if (stopped() || no_song) {
     if (no_song) spdlog::warn("Bug in mpd: no current song but state is not stopped.");
     format =
@@ -151,24 +139,33 @@ void waybar::modules::MPD::setLabel() {
     title = sanitize_string(getTag(MPD_TAG_TITLE));
     date = sanitize_string(getTag(MPD_TAG_DATE));
     filename = sanitize_string(getFilename());
-    uri = mpd_song_get_uri(song_.get());
-    song_pos = mpd_status_get_song_pos(status_.get()) + 1;
-    volume = mpd_status_get_volume(status_.get());
+    uri = mpd_song_get_uri(server_->song());
+    song_pos = mpd_status_get_song_pos(server_->status()) + 1;
+    volume = mpd_status_get_volume(server_->status());
     if (volume < 0) {
       volume = 0;
     }
-    queue_length = mpd_status_get_queue_length(status_.get());
-    elapsedTime = std::chrono::seconds(mpd_status_get_elapsed_time(status_.get()));
-    totalTime = std::chrono::seconds(mpd_status_get_total_time(status_.get()));
+    queue_length = mpd_status_get_queue_length(server_->status());
+    totalTime = std::chrono::seconds(mpd_status_get_total_time(server_->status()));
+    // MPD only reports the elapsed time when asked, it runs on from the last status
+    auto elapsed = std::chrono::milliseconds(mpd_status_get_elapsed_ms(server_->status()));
+    if (playing()) {
+      elapsed += std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - server_->statusTime());
+      if (totalTime.count() > 0) {
+        elapsed = std::min<std::chrono::milliseconds>(elapsed, totalTime);
+      }
+    }
+    elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(elapsed);
   }
 
-  bool consumeActivated = mpd_status_get_consume(status_.get());
+  bool consumeActivated = mpd_status_get_consume(server_->status());
   std::string consumeIcon = getOptionIcon("consume", consumeActivated);
-  bool randomActivated = mpd_status_get_random(status_.get());
+  bool randomActivated = mpd_status_get_random(server_->status());
   std::string randomIcon = getOptionIcon("random", randomActivated);
-  bool repeatActivated = mpd_status_get_repeat(status_.get());
+  bool repeatActivated = mpd_status_get_repeat(server_->status());
   std::string repeatIcon = getOptionIcon("repeat", repeatActivated);
-  bool singleActivated = mpd_status_get_single(status_.get());
+  bool singleActivated = mpd_status_get_single(server_->status());
   std::string singleIcon = getOptionIcon("single", singleActivated);
   if (config_["artist-len"].isInt()) artist = artist.substr(0, config_["artist-len"].asInt());
   if (config_["album-artist-len"].isInt())
@@ -222,7 +219,7 @@ std::string waybar::modules::MPD::getStateIcon() const {
     return "";
   }
 
-  if (connection_ == nullptr) {
+  if (!server_->connected()) {
     spdlog::warn("{}: Trying to fetch state icon while disconnected", module_name_);
     return "";
   }
@@ -244,7 +241,7 @@ std::string waybar::modules::MPD::getOptionIcon(std::string optionName, bool act
     return "";
   }
 
-  if (connection_ == nullptr) {
+  if (!server_->connected()) {
     spdlog::warn("{}: Trying to fetch option icon while disconnected", module_name_);
     return "";
   }
@@ -256,117 +253,18 @@ std::string waybar::modules::MPD::getOptionIcon(std::string optionName, bool act
   }
 }
 
-static bool isServerUnavailable(const std::error_code& ec) {
-  if (ec.category() == std::system_category()) {
-    switch (ec.value()) {
-      case ECONNREFUSED:
-      case ECONNRESET:
-      case ENETDOWN:
-      case ENETUNREACH:
-      case EHOSTDOWN:
-      case ENOENT:
-        return true;
-    }
-  }
-  return false;
-}
-
-void waybar::modules::MPD::tryConnect() {
-  if (connection_ != nullptr) {
-    return;
-  }
-
-  connection_ =
-      detail::unique_connection(mpd_connection_new(server_, port_, timeout_), &mpd_connection_free);
-
-  if (connection_ == nullptr) {
-    spdlog::error("{}: Failed to connect to MPD", module_name_);
-    connection_.reset();
-    return;
-  }
-
-  try {
-    checkErrors(connection_.get());
-    spdlog::debug("{}: Connected to MPD", module_name_);
-
-    if (!password_.empty()) {
-      bool res = mpd_run_password(connection_.get(), password_.c_str());
-      if (!res) {
-        spdlog::error("{}: Wrong MPD password", module_name_);
-        connection_.reset();
-        return;
-      }
-      checkErrors(connection_.get());
-    }
-  } catch (std::system_error& e) {
-    /* Tone down logs if it's likely that the mpd server is not running */
-    auto level = isServerUnavailable(e.code()) ? spdlog::level::debug : spdlog::level::err;
-    spdlog::log(level, "{}: Failed to connect to MPD: {}", module_name_, e.what());
-    connection_.reset();
-  } catch (std::runtime_error& e) {
-    spdlog::error("{}: Failed to connect to MPD: {}", module_name_, e.what());
-    connection_.reset();
-  }
-}
-
-void waybar::modules::MPD::checkErrors(mpd_connection* conn) {
-  switch (mpd_connection_get_error(conn)) {
-    case MPD_ERROR_SUCCESS:
-      mpd_connection_clear_error(conn);
-      return;
-    case MPD_ERROR_TIMEOUT:
-    case MPD_ERROR_CLOSED:
-      mpd_connection_clear_error(conn);
-      connection_.reset();
-      state_ = MPD_STATE_UNKNOWN;
-      throw std::runtime_error("Connection to MPD closed");
-    case MPD_ERROR_SYSTEM:
-      if (auto ec = mpd_connection_get_system_error(conn); ec != 0) {
-        mpd_connection_clear_error(conn);
-        throw std::system_error(ec, std::system_category());
-      }
-      G_GNUC_FALLTHROUGH;
-    default:
-      if (conn) {
-        auto error_message = mpd_connection_get_error_message(conn);
-        std::string error(error_message);
-        mpd_connection_clear_error(conn);
-        throw std::runtime_error(error);
-      }
-      throw std::runtime_error("Invalid connection");
-  }
-}
-
-void waybar::modules::MPD::fetchState() {
-  if (connection_ == nullptr) {
-    spdlog::error("{}: Not connected to MPD", module_name_);
-    return;
-  }
-
-  auto conn = connection_.get();
-
-  status_ = detail::unique_status(mpd_run_status(conn), &mpd_status_free);
-  checkErrors(conn);
-
-  state_ = mpd_status_get_state(status_.get());
-  checkErrors(conn);
-
-  song_ = detail::unique_song(mpd_run_current_song(conn), &mpd_song_free);
-  checkErrors(conn);
-}
-
 bool waybar::modules::MPD::handlePlayPause(GdkEventButton* const& e) {
-  if (e->type == GDK_2BUTTON_PRESS || e->type == GDK_3BUTTON_PRESS || connection_ == nullptr) {
+  if (e->type == GDK_2BUTTON_PRESS || e->type == GDK_3BUTTON_PRESS || !server_->connected()) {
     return false;
   }
 
   if (e->button == 1) {
-    if (state_ == MPD_STATE_PLAY)
-      context_.pause();
+    if (server_->state() == MPD_STATE_PLAY)
+      server_->pause();
     else
-      context_.play();
+      server_->play();
   } else if (e->button == 3) {
-    context_.stop();
+    server_->stop();
   }
 
   return true;
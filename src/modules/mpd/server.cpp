@@ -0,0 +1,159 @@
+#include "modules/mpd/server.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <system_error>
+#include <tuple>
+
+#include "util/shared_instance.hpp"
+
+#if defined(MPD_NOINLINE)
+namespace waybar::modules {
+#include "modules/mpd/state.inl.hpp"
+}  // namespace waybar::modules
+#endif
+
+namespace waybar::modules::detail {
+
+std::shared_ptr<Server> Server::getInstance(const std::string& host, unsigned port,
+                                            const std::string& password, unsigned timeout,
+                                            std::size_t interval) {
+  static util::SharedInstances<std::tuple<std::string, unsigned, std::string>, Server> servers;
+
+  return servers.get({host, port, password}, [&] {
+    // The first module's timeout and interval are the ones of the connection
+    return std::make_shared<Server>(host, port, password, timeout, interval,
+                                    private_constructor_tag{});
+  });
+}
+
+Server::Server(std::string host, unsigned port, std::string password, unsigned timeout,
+               std::size_t interval, private_constructor_tag /*tag*/)
+    : name_(host.empty() ? "mpd" : "mpd " + host),
+      host_(std::move(host)),
+      port_(port),
+      password_(std::move(password)),
+      timeout_(timeout),
+      interval_(interval),
+      connection_(nullptr, &mpd_connection_free),
+      status_(nullptr, &mpd_status_free),
+      song_(nullptr, &mpd_song_free) {}
+
+int Server::subscribe(std::function<void()> on_changed) {
+  subscribers_.emplace_back(next_subscriber_id_, std::move(on_changed));
+  return next_subscriber_id_++;
+}
+
+void Server::unsubscribe(int id) {
+  std::erase_if(subscribers_, [id](const auto& subscriber) { return subscriber.first == id; });
+}
+
+void Server::emit() {
+  for (const auto& [id, on_changed] : subscribers_) {
+    on_changed();
+  }
+}
+
+static bool isServerUnavailable(const std::error_code& ec) {
+  if (ec.category() == std::system_category()) {
+    switch (ec.value()) {
+      case ECONNREFUSED:
+      case ECONNRESET:
+      case ENETDOWN:
+      case ENETUNREACH:
+      case EHOSTDOWN:
+      case ENOENT:
+        return true;
+    }
+  }
+  return false;
+}
+
+void Server::tryConnect() {
+  if (connection_ != nullptr) {
+    return;
+  }
+
+  connection_ = detail::unique_connection(
+      mpd_connection_new(host_.empty() ? nullptr : host_.c_str(), port_, timeout_),
+      &mpd_connection_free);
+
+  if (connection_ == nullptr) {
+    spdlog::error("{}: Failed to connect to MPD", name_);
+    connection_.reset();
+    return;
+  }
+
+  try {
+    checkErrors(connection_.get());
+    spdlog::debug("{}: Connected to MPD", name_);
+
+    if (!password_.empty()) {
+      bool res = mpd_run_password(connection_.get(), password_.c_str());
+      if (!res) {
+        spdlog::error("{}: Wrong MPD password", name_);
+        connection_.reset();
+        return;
+      }
+      checkErrors(connection_.get());
+    }
+  } catch (std::system_error& e) {
+    /* Tone down logs if it's likely that the mpd server is not running */
+    auto level = isServerUnavailable(e.code()) ? spdlog::level::debug : spdlog::level::err;
+    spdlog::log(level, "{}: Failed to connect to MPD: {}", name_, e.what());
+    connection_.reset();
+  } catch (std::runtime_error& e) {
+    spdlog::error("{}: Failed to connect to MPD: {}", name_, e.what());
+    connection_.reset();
+  }
+}
+
+void Server::checkErrors(mpd_connection* conn) {
+  switch (mpd_connection_get_error(conn)) {
+    case MPD_ERROR_SUCCESS:
+      mpd_connection_clear_error(conn);
+      return;
+    case MPD_ERROR_TIMEOUT:
+    case MPD_ERROR_CLOSED:
+      mpd_connection_clear_error(conn);
+      connection_.reset();
+      state_ = MPD_STATE_UNKNOWN;
+      throw std::runtime_error("Connection to MPD closed");
+    case MPD_ERROR_SYSTEM:
+      if (auto ec = mpd_connection_get_system_error(conn); ec != 0) {
+        mpd_connection_clear_error(conn);
+        throw std::system_error(ec, std::system_category());
+      }
+      G_GNUC_FALLTHROUGH;
+    default:
+      if (conn) {
+        auto error_message = mpd_connection_get_error_message(conn);
+        std::string error(error_message);
+        mpd_connection_clear_error(conn);
+        throw std::runtime_error(error);
+      }
+      throw std::runtime_error("Invalid connection");
+  }
+}
+
+void Server::fetchState() {
+  if (connection_ == nullptr) {
+    spdlog::error("{}: Not connected to MPD", name_);
+    return;
+  }
+
+  auto conn = connection_.get();
+
+  status_ = detail::unique_status(mpd_run_status(conn), &mpd_status_free);
+  status_time_ = std::chrono::steady_clock::now();
+  checkErrors(conn);
+
+  state_ = mpd_status_get_state(status_.get());
+  checkErrors(conn);
+
+  song_ = detail::unique_song(mpd_run_current_song(conn), &mpd_song_free);
+  checkErrors(conn);
+}
+
+}  // namespace waybar::modules::detail
@@ -3,7 +3,7 @@
 #include <fmt/chrono.h>
 #include <spdlog/spdlog.h>
 
-#include "modules/mpd/mpd.hpp"
+#include "modules/mpd/server.hpp"
 #if defined(MPD_NOINLINE)
 namespace waybar::modules {
 #include "modules/mpd/state.inl.hpp"
@@ -52,16 +52,12 @@ void Idle::stop() {
 
 #undef IDLE_RUN_NOIDLE_AND_CMD
 
-void Idle::update() noexcept {
-  // This is intentionally blank.
-}
-
 void Idle::entry() noexcept {
   auto conn = ctx_->connection().get();
   assert(conn != nullptr);
 
-  if (!mpd_send_idle_mask(
-          conn, static_cast<mpd_idle>(MPD_IDLE_PLAYER | MPD_IDLE_OPTIONS | MPD_IDLE_QUEUE))) {
+  if (!mpd_send_idle_mask(conn, static_cast<mpd_idle>(MPD_IDLE_PLAYER | MPD_IDLE_MIXER |
+                                                      MPD_IDLE_OPTIONS | MPD_IDLE_QUEUE))) {
     ctx_->checkErrors(conn);
     spdlog::error("mpd: Idle: failed to register for IDLE events");
   } else {
@@ -71,9 +67,19 @@ void Idle::entry() noexcept {
         Glib::signal_io().connect(idle_slot, mpd_connection_get_fd(conn),
                                   Glib::IO_IN | Glib::IO_PRI | Glib::IO_ERR | Glib::IO_HUP);
   }
+
+  if (ctx_->is_playing()) {
+    tick_connection_ = Glib::signal_timeout().connect_seconds(
+        [this] {
+          ctx_->emit();
+          return true;
+        },
+        1);
+  }
 }
 
 void Idle::exit() noexcept {
+  tick_connection_.disconnect();
   if (idle_connection_.connected()) {
     idle_connection_.disconnect();
     spdlog::debug("mpd: Idle: unwatching FD");
@@ -96,37 +102,32 @@ bool Idle::on_io(Glib::IOCondition const&) {
     return false;
   }
 
-  ctx_->fetchState();
-  mpd_state state = ctx_->state();
-
-  if (state == MPD_STATE_STOP) {
-    ctx_->emit();
-    ctx_->setState(std::make_unique<Stopped>(ctx_));
-  } else if (state == MPD_STATE_PLAY) {
-    ctx_->emit();
-    ctx_->setState(std::make_unique<Playing>(ctx_));
-  } else if (state == MPD_STATE_PAUSE) {
-    ctx_->emit();
-    ctx_->setState(std::make_unique<Paused>(ctx_));
-  } else {
-    ctx_->emit();
-    // self transition
-    ctx_->setState(std::make_unique<Idle>(ctx_));
+  try {
+    ctx_->fetchState();
+  } catch (std::exception const& e) {
+    spdlog::warn("mpd: Idle: error: {}", e.what());
+    ctx_->setState(std::make_unique<Disconnected>(ctx_));
+    return false;
   }
+  ctx_->emit();
+
+  // self transition, whatever the player does: the status just fetched is all there is to know
+  // until the next event
+  ctx_->setState(std::make_unique<Idle>(ctx_));
 
   return false;
 }
 
 void Playing::entry() noexcept {
   sigc::slot<bool> timer_slot = sigc::mem_fun(*this, &Playing::on_timer);
-  timer_connection_ = Glib::signal_timeout().connect_seconds(timer_slot, 1);
-  spdlog::debug("mpd: Playing: enabled 1 second periodic timer.");
+  timer_connection_ = Glib::signal_timeout().connect(timer_slot, /* milliseconds */ 200);
+  spdlog::debug("mpd: Playing: enabled 200 ms periodic timer.");
 }
 
 void Playing::exit() noexcept {
   if (timer_connection_.connected()) {
     timer_connection_.disconnect();
-    spdlog::debug("mpd: Playing: disabled 1 second periodic timer.");
+    spdlog::debug("mpd: Playing: disabled 200 ms periodic timer.");
   }
 }
 
@@ -152,15 +153,15 @@ bool Playing::on_timer() {
       return false;
     }
 
-    ctx_->queryMPD();
     ctx_->emit();
+    // MPD tells about the next change, the elapsed time runs on locally meanwhile
+    ctx_->setState(std::make_unique<Idle>(ctx_));
   } catch (std::exception const& e) {
     spdlog::warn("mpd: Playing: error: {}", e.what());
     ctx_->setState(std::make_unique<Disconnected>(ctx_));
-    return false;
   }
 
-  return true;
+  return false;
 }
 
 void Playing::stop() {
@@ -183,8 +184,6 @@ void Playing::pause() {
   ctx_->setState(std::make_unique<Paused>(ctx_));
 }
 
-void Playing::update() noexcept { ctx_->do_update(); }
-
 void Paused::entry() noexcept {
   sigc::slot<bool> timer_slot = sigc::mem_fun(*this, &Paused::on_timer);
   timer_connection_ = Glib::signal_timeout().connect(timer_slot, /* milliseconds */ 200);
@@ -254,8 +253,6 @@ void Paused::stop() {
   ctx_->setState(std::make_unique<Stopped>(ctx_));
 }
 
-void Paused::update() noexcept { ctx_->do_update(); }
-
 void Stopped::entry() noexcept {
   sigc::slot<bool> timer_slot = sigc::mem_fun(*this, &Stopped::on_timer);
   timer_connection_ = Glib::signal_timeout().connect(timer_slot, /* milliseconds */ 200);
@@ -325,8 +322,6 @@ void Stopped::pause() {
   ctx_->setState(std::make_unique<Paused>(ctx_));
 }
 
-void Stopped::update() noexcept { ctx_->do_update(); }
-
 bool Disconnected::arm_timer(int interval) noexcept {
   // check if it's necessary to modify the timer
   if (timer_connection_ && last_interval_ == interval) {
@@ -385,6 +380,4 @@ bool Disconnected::on_timer() {
   return arm_timer(ctx_->interval());
 }
 
-void Disconnected::update() noexcept { ctx_->do_update(); }
-
 }  // namespace waybar::modules::detail
@@ -2,11 +2,13 @@
 
 #include <fmt/core.h>
 
+#include <chrono>
 #include <optional>
 #include <sstream>
 #include <string>
 
 #include "util/scope_guard.hpp"
+#include "util/text_width.hpp"
 
 extern "C" {
 #include <playerctl/playerctl.h>
@@ -18,6 +20,18 @@ namespace waybar::modules::mpris {
 
 const std::string DEFAULT_FORMAT = "{player} ({status}): {dynamic}";
 
+namespace {
+
+// As HH:MM:SS
+std::string formatTime(std::chrono::microseconds time) {
+  auto len_h = std::chrono::duration_cast<std::chrono::hours>(time);
+  auto len_m = std::chrono::duration_cast<std::chrono::minutes>(time - len_h);
+  auto len_s = std::chrono::duration_cast<std::chrono::seconds>(time - len_h - len_m);
+  return fmt::format("{:02}:{:02}:{:02}", len_h.count(), len_m.count(), len_s.count());
+}
+
+}  // namespace
+
 Mpris::Mpris(const std::string& id, const Json::Value& config)
     : ALabel(config, "mpris", id, DEFAULT_FORMAT, 0, false, true),
       tooltip_(DEFAULT_FORMAT),
@@ -51,6 +65,8 @@ Mpris::Mpris(const std::string& id, const Json::Value& config)
   if (config_["dynamic-separator"].isString()) {
     dynamic_separator_ = config_["dynamic-separator"].asString();
   }
+  ellipsis_width_ = util::textWidth(ellipsis_);
+  dynamic_separator_width_ = util::textWidth(dynamic_separator_);
   if (tooltipEnabled()) {
     if (config_["tooltip-format"].isString()) {
       tooltip_ = config_["tooltip-format"].asString();
@@ -162,15 +178,13 @@ Mpris::Mpris(const std::string& id, const Json::Value& config)
     g_object_connect(player, "signal::play", G_CALLBACK(onPlayerPlay), this, "signal::pause",
                      G_CALLBACK(onPlayerPause), this, "signal::stop", G_CALLBACK(onPlayerStop),
                      this, "signal::stop", G_CALLBACK(onPlayerStop), this, "signal::metadata",
-                     G_CALLBACK(onPlayerMetadata), this, NULL);
+                     G_CALLBACK(onPlayerMetadata), this, "signal::seeked",
+                     G_CALLBACK(onPlayerSeeked), this, NULL);
   }
 
   // allow setting an interval count that triggers periodic refreshes
   if (interval_.count() > 0) {
-    thread_ = [this] {
-      dp.emit();
-      thread_.sleep_for(interval_);
-    };
+    timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
   }
 
   // trigger initial update
@@ -190,72 +204,44 @@ auto Mpris::getIconFromJson(const Json::Value& icons, const std::string& key) ->
   return "";
 }
 
-// Wide characters count as two, zero-width characters count as zero
-// Modifies str in-place (unless width = std::string::npos)
-// Returns the total width of the string pre-truncating
-size_t utf8_truncate(std::string& str, size_t width = std::string::npos) {
-  if (str.length() == 0) return 0;
-
-  const gchar* trunc_end = nullptr;
-
-  size_t total_width = 0;
-
-  for (gchar *data = str.data(), *end = data + str.size(); data != nullptr;) {
-    gunichar c = g_utf8_get_char_validated(data, end - data);
-    if (c == -1U || c == -2U) {
-      // invalid unicode, treat string as ascii
-      if (width != std::string::npos && str.length() > width) str.resize(width);
-      return str.length();
-    } else if (g_unichar_iswide(c)) {
-      total_width += 2;
-    } else if (!g_unichar_iszerowidth(c) && c != 0xAD) {  // neither zero-width nor soft hyphen
-      total_width += 1;
-    }
-
-    data = g_utf8_find_next_char(data, end);
-    if (width != std::string::npos && total_width <= width && !g_unichar_isspace(c))
-      trunc_end = data;
-  }
-
-  if (trunc_end) str.resize(trunc_end - str.data());
-
-  return total_width;
-}
-
-size_t utf8_width(const std::string& str) { return utf8_truncate(const_cast<std::string&>(str)); }
-
-void truncate(std::string& s, const std::string& ellipsis, size_t max_len) {
+// Cuts s to max_len columns, ending with the ellipsis if it had to be cut
+void truncate(std::string& s, const std::string& ellipsis, size_t ellipsis_width, size_t max_len) {
   if (max_len == 0) {
     s.resize(0);
     return;
   }
-  size_t len = utf8_truncate(s, max_len);
-  if (len > max_len) {
-    size_t ellipsis_len = utf8_width(ellipsis);
-    if (max_len >= ellipsis_len) {
-      if (ellipsis_len) utf8_truncate(s, max_len - ellipsis_len);
-      s += ellipsis;
-    } else {
-      s.resize(0);
+  const bool fits_ellipsis = max_len >= ellipsis_width;
+  const auto measure = util::measureText(
+      s, max_len, fits_ellipsis ? max_len - ellipsis_width : std::string::npos);
+  if (measure.width <= max_len) {
+    if (measure.cut != std::string::npos) s.resize(measure.cut);
+  } else if (fits_ellipsis) {
+    if (measure.cut_short != std::string::npos) {
+      s.resize(measure.cut_short);
+    } else if (measure.cut != std::string::npos) {
+      s.resize(measure.cut);
     }
+    s += ellipsis;
+  } else {
+    s.resize(0);
   }
 }
 
 auto Mpris::getArtistStr(const PlayerInfo& info, bool truncated) -> std::string {
   auto artist = info.artist.value_or(std::string());
-  if (truncated && artist_len_ >= 0) truncate(artist, ellipsis_, artist_len_);
+  if (truncated && artist_len_ >= 0) truncate(artist, ellipsis_, ellipsis_width_, artist_len_);
   return artist;
 }
 
 auto Mpris::getAlbumStr(const PlayerInfo& info, bool truncated) -> std::string {
   auto album = info.album.value_or(std::string());
-  if (truncated && album_len_ >= 0) truncate(album, ellipsis_, album_len_);
+  if (truncated && album_len_ >= 0) truncate(album, ellipsis_, ellipsis_width_, album_len_);
   return album;
 }
 
 auto Mpris::getTitleStr(const PlayerInfo& info, bool truncated) -> std::string {
   auto title = info.title.value_or(std::string());
-  if (truncated && title_len_ >= 0) truncate(title, ellipsis_, title_len_);
+  if (truncated && title_len_ >= 0) truncate(title, ellipsis_, ellipsis_width_, title_len_);
   return title;
 }
 
@@ -283,9 +269,9 @@ auto Mpris::getDynamicStr(const PlayerInfo& info, bool truncated, bool html) ->
   // keep position format same as length format
   auto position = getPositionStr(info, truncated && truncate_hours_ && length.length() < 6);
 
-  size_t artistLen = utf8_width(artist);
-  size_t albumLen = utf8_width(album);
-  size_t titleLen = utf8_width(title);
+  size_t artistLen = util::textWidth(artist);
+  size_t albumLen = util::textWidth(album);
+  size_t titleLen = util::textWidth(title);
   size_t lengthLen = length.length();
   size_t posLen = position.length();
 
@@ -304,7 +290,7 @@ auto Mpris::getDynamicStr(const PlayerInfo& info, bool truncated, bool html) ->
     // Since the first element doesn't present a separator and we don't know a priori which one
     // it will be, we add a "virtual separatorLen" to the dynamicLen, since we are adding the
     // separatorLen to all the other lengths.
-    size_t separatorLen = utf8_width(dynamic_separator_);
+    size_t separatorLen = dynamic_separator_width_;
     size_t dynamicLen = dynamic_len_ + separatorLen;
     if (showArtist) artistLen += separatorLen;
     if (showAlbum) albumLen += separatorLen;
@@ -414,8 +400,10 @@ auto Mpris::onPlayerNameAppeared(PlayerctlPlayerManager* manager, PlayerctlPlaye
   g_object_connect(mpris->player, "signal::play", G_CALLBACK(onPlayerPlay), mpris, "signal::pause",
                    G_CALLBACK(onPlayerPause), mpris, "signal::stop", G_CALLBACK(onPlayerStop),
                    mpris, "signal::stop", G_CALLBACK(onPlayerStop), mpris, "signal::metadata",
-                   G_CALLBACK(onPlayerMetadata), mpris, NULL);
+                   G_CALLBACK(onPlayerMetadata), mpris, "signal::seeked",
+                   G_CALLBACK(onPlayerSeeked), mpris, NULL);
 
+  mpris->invalidate();
   mpris->dp.emit();
 }
 
@@ -427,9 +415,11 @@ auto Mpris::onPlayerNameVanished(PlayerctlPlayerManager* manager, PlayerctlPlaye
   spdlog::debug("mpris: name-vanished callback: {}", player_name->name);
 
   if (mpris->player_ == "playerctld") {
+    mpris->invalidate();
     mpris->dp.emit();
   } else if (mpris->player_ == player_name->name) {
     mpris->player = nullptr;
+    mpris->invalidate();
     mpris->event_box_.set_visible(false);
     mpris->dp.emit();
   }
@@ -440,6 +430,7 @@ auto Mpris::onPlayerPlay(PlayerctlPlayer* player, gpointer data) -> void {
   if (!mpris) return;
 
   spdlog::debug("mpris: player-play callback");
+  mpris->invalidate();
   // update widget
   mpris->dp.emit();
 }
@@ -449,6 +440,7 @@ auto Mpris::onPlayerPause(PlayerctlPlayer* player, gpointer data) -> void {
   if (!mpris) return;
 
   spdlog::debug("mpris: player-pause callback");
+  mpris->invalidate();
   // update widget
   mpris->dp.emit();
 }
@@ -458,6 +450,7 @@ auto Mpris::onPlayerStop(PlayerctlPlayer* player, gpointer data) -> void {
   if (!mpris) return;
 
   spdlog::debug("mpris: player-stop callback");
+  mpris->invalidate();
 
   // hide widget
   mpris->event_box_.set_visible(false);
@@ -470,11 +463,52 @@ auto Mpris::onPlayerMetadata(PlayerctlPlayer* player, GVariant* metadata, gpoint
   if (!mpris) return;
 
   spdlog::debug("mpris: player-metadata callback");
+  mpris->invalidate();
   // update widget
   mpris->dp.emit();
 }
 
+auto Mpris::onPlayerSeeked(PlayerctlPlayer* player, gint64 position, gpointer data) -> void {
+  auto* mpris = static_cast<Mpris*>(data);
+  if (!mpris) return;
+
+  spdlog::debug("mpris: player-seeked callback: {}", position);
+  // the rest of the snapshot is still good
+  mpris->position_us_ = std::chrono::microseconds(position);
+  mpris->position_at_ = std::chrono::steady_clock::now();
+  mpris->dp.emit();
+}
+
+void Mpris::invalidate() { info_stale_ = true; }
+
 auto Mpris::getPlayerInfo() -> std::optional<PlayerInfo> {
+  const auto now = std::chrono::steady_clock::now();
+  if (info_stale_ || now - info_at_ >= RESYNC_INTERVAL) {
+    info_ = fetchPlayerInfo();
+    // errors are retried on the next update, like before
+    info_stale_ = !info_;
+    info_at_ = now;
+  }
+  if (!info_) {
+    return std::nullopt;
+  }
+  auto info = *info_;
+  if (position_us_) {
+    auto position = *position_us_;
+    if (info.status == PLAYERCTL_PLAYBACK_STATUS_PLAYING) {
+      position += std::chrono::duration_cast<std::chrono::microseconds>(now - position_at_);
+      if (length_us_ && position > *length_us_) {
+        position = *length_us_;
+      }
+    }
+    info.position = formatTime(position);
+  }
+  return info;
+}
+
+auto Mpris::fetchPlayerInfo() -> std::optional<PlayerInfo> {
+  length_us_.reset();
+  position_us_.reset();
   if (!player) {
     return std::nullopt;
   }
@@ -547,11 +581,8 @@ auto Mpris::getPlayerInfo() -> std::optional<PlayerInfo> {
 
   if (auto* length_ = playerctl_player_print_metadata_prop(player, "mpris:length", &error)) {
     spdlog::debug("mpris[{}]: mpris:length = {}", info.name, length_);
-    auto len = std::chrono::microseconds(std::strtol(length_, nullptr, 10));
-    auto len_h = std::chrono::duration_cast<std::chrono::hours>(len);
-    auto len_m = std::chrono::duration_cast<std::chrono::minutes>(len - len_h);
-    auto len_s = std::chrono::duration_cast<std::chrono::seconds>(len - len_h - len_m);
-    info.length = fmt::format("{:02}:{:02}:{:02}", len_h.count(), len_m.count(), len_s.count());
+    length_us_ = std::chrono::microseconds(std::strtol(length_, nullptr, 10));
+    info.length = formatTime(*length_us_);
     g_free(length_);
   }
   if (error) goto errorexit;
@@ -564,11 +595,8 @@ auto Mpris::getPlayerInfo() -> std::optional<PlayerInfo> {
       error = nullptr;
     } else {
       spdlog::debug("mpris[{}]: position = {}", info.name, position_);
-      auto len = std::chrono::microseconds(position_);
-      auto len_h = std::chrono::duration_cast<std::chrono::hours>(len);
-      auto len_m = std::chrono::duration_cast<std::chrono::minutes>(len - len_h);
-      auto len_s = std::chrono::duration_cast<std::chrono::seconds>(len - len_h - len_m);
-      info.position = fmt::format("{:02}:{:02}:{:02}", len_h.count(), len_m.count(), len_s.count());
+      position_us_ = std::chrono::microseconds(position_);
+      position_at_ = std::chrono::steady_clock::now();
     }
   }
 
@@ -635,6 +663,11 @@ bool Mpris::handleToggle(GdkEventButton* const& e) {
   return true;
 }
 
+auto Mpris::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
+}
+
 auto Mpris::update() -> void {
   const auto now = std::chrono::system_clock::now();
   if (now - last_update_ < interval_) return;
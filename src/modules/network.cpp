@@ -4,17 +4,20 @@
 #include <linux/if_link.h>
 #include <netlink/netlink.h>
 #include <spdlog/spdlog.h>
-#include <sys/eventfd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <fstream>
+#include <mutex>
 #include <optional>
-#include <sstream>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "util/format.hpp"
+#include "util/proc_file.hpp"
 #ifdef WANT_RFKILL
 #include "util/rfkill.hpp"
 #endif
@@ -24,32 +27,194 @@ using namespace waybar::util;
 constexpr const char *DEFAULT_FORMAT = "{ifname}";
 }  // namespace
 
-constexpr const char *NETDEV_FILE =
-    "/proc/net/dev";  // std::ifstream does not take std::string_view as param
+namespace waybar::modules {
+
+/* Owns the rtnetlink socket shared by every Network module. It is subscribed to the link,
+ * address and route groups, and one thread hands each message to all modules. Dumps requested
+ * while another is running are merged, so modules starting together share one dump of each
+ * kind instead of each running its own.
+ */
+class NetlinkHub {
+ public:
+  static NetlinkHub& inst() {
+    static auto* hub = new NetlinkHub();
+    return *hub;
+  }
+
+  void add(Network* net);
+  void remove(Network* net);
+  // The dumps are sent one at a time, in this order, as the kernel runs one per socket
+  void requestDump(bool routes, bool links, bool addrs);
+  int send(int type, int flags, void* buf, size_t size);
+
+ private:
+  NetlinkHub() = default;
+
+  void connect();
+  void run();
+  void sendNextDump();  // with sockMutex_ held
+  static int handleMessage(struct nl_msg*, void*);
+  static int handleDumpDone(struct nl_msg*, void*);
+
+  std::mutex connectMutex_;
+  struct nl_sock* sock_ = nullptr;
+  bool routes_ = false;  // subscribed to the route groups
+  std::thread thread_;
+  std::mutex sockMutex_;  // one sender at a time, guards the dump state below
+  bool wantRoutes_ = false;
+  bool wantLinks_ = false;
+  bool wantAddrs_ = false;
+  bool dumpInProgress_ = false;
+  // dispatch only takes a shared lock, a module waits for the running dispatch to unregister
+  std::shared_mutex clientsMutex_;
+  std::vector<Network*> clients_;
+};
+
+void NetlinkHub::connect() {
+  std::lock_guard<std::mutex> lock(connectMutex_);
+  if (sock_ != nullptr) {
+    return;
+  }
+  auto* sock = nl_socket_alloc();
+  nl_socket_disable_seq_check(sock);
+  nl_socket_modify_cb(sock, NL_CB_VALID, NL_CB_CUSTOM, handleMessage, this);
+  nl_socket_modify_cb(sock, NL_CB_FINISH, NL_CB_CUSTOM, handleDumpDone, this);
+  auto groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+  nl_join_groups(sock, groups);  // Deprecated
+  if (nl_connect(sock, NETLINK_ROUTE) != 0) {
+    nl_socket_free(sock);
+    // the next module retries
+    throw std::runtime_error("Can't connect network socket");
+  }
+  nl_socket_add_memberships(sock, RTNLGRP_LINK, RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR, 0);
+  sock_ = sock;
+  thread_ = std::thread([this] { run(); });
+}
+
+void NetlinkHub::run() {
+  while (true) {
+    int rc = nl_recvmsgs_default(sock_);
+    if (rc == -NLE_NOMEM) {
+      // ENOBUFS, the kernel dropped messages: start over from the current state
+      spdlog::warn("network: netlink socket overrun, asking for a new state dump");
+      {
+        std::lock_guard<std::mutex> lock(sockMutex_);
+        dumpInProgress_ = false;
+      }
+      requestDump(true, true, true);
+    } else if (rc < 0) {
+      spdlog::error("nl_recvmsgs_default error: {}", nl_geterror(-rc));
+      return;
+    }
+  }
+}
+
+void NetlinkHub::add(Network* net) {
+  connect();
+  if (!net->config_["interface"].isString()) {
+    // only the modules guessing the external interface follow the routes
+    std::lock_guard<std::mutex> lock(connectMutex_);
+    if (!routes_) {
+      nl_socket_add_memberships(sock_, RTNLGRP_IPV4_ROUTE, RTNLGRP_IPV6_ROUTE, 0);
+      routes_ = true;
+    }
+  }
+  std::unique_lock lock(clientsMutex_);
+  clients_.push_back(net);
+}
+
+void NetlinkHub::remove(Network* net) {
+  std::unique_lock lock(clientsMutex_);
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), net), clients_.end());
+}
+
+void NetlinkHub::requestDump(bool routes, bool links, bool addrs) {
+  std::lock_guard<std::mutex> lock(sockMutex_);
+  wantRoutes_ |= routes;
+  wantLinks_ |= links;
+  wantAddrs_ |= addrs;
+  sendNextDump();
+}
+
+int NetlinkHub::send(int type, int flags, void* buf, size_t size) {
+  std::lock_guard<std::mutex> lock(sockMutex_);
+  return nl_send_simple(sock_, type, flags, buf, size);
+}
+
+void NetlinkHub::sendNextDump() {
+  /* We need to wait until the current dump is done before sending new
+   * messages. handleDumpDone() is called when a dump is done. */
+  if (dumpInProgress_) return;
+
+  struct rtgenmsg rt_hdr = {
+      .rtgen_family = AF_UNSPEC,
+  };
+
+  if (wantRoutes_) {
+    nl_send_simple(sock_, RTM_GETROUTE, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
+    wantRoutes_ = false;
+    dumpInProgress_ = true;
+
+  } else if (wantLinks_) {
+    nl_send_simple(sock_, RTM_GETLINK, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
+    wantLinks_ = false;
+    dumpInProgress_ = true;
+
+  } else if (wantAddrs_) {
+    nl_send_simple(sock_, RTM_GETADDR, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
+    wantAddrs_ = false;
+    dumpInProgress_ = true;
+  }
+}
+
+int NetlinkHub::handleMessage(struct nl_msg* msg, void* data) {
+  auto* hub = static_cast<NetlinkHub*>(data);
+  const auto type = nlmsg_hdr(msg)->nlmsg_type;
+  const bool is_route = type == RTM_NEWROUTE || type == RTM_DELROUTE;
+  std::shared_lock lock(hub->clientsMutex_);
+  for (auto* net : hub->clients_) {
+    if (is_route && net->config_["interface"].isString()) {
+      continue;
+    }
+    Network::handleEvents(msg, net);
+  }
+  return NL_OK;
+}
+
+int NetlinkHub::handleDumpDone(struct nl_msg* msg, void* data) {
+  auto* hub = static_cast<NetlinkHub*>(data);
+  std::lock_guard<std::mutex> lock(hub->sockMutex_);
+  hub->dumpInProgress_ = false;
+  hub->sendNextDump();
+  return NL_OK;
+}
+
+}  // namespace waybar::modules
+
 std::optional<std::pair<unsigned long long, unsigned long long>>
 waybar::modules::Network::readBandwidthUsage() {
-  std::ifstream netdev(NETDEV_FILE);
+  auto netdev = netdev_.tryRead();
   if (!netdev) {
-    spdlog::warn("Failed to open netdev file {}", NETDEV_FILE);
+    spdlog::warn("Failed to open netdev file {}", netdev_.path());
     return {};
   }
+  if (ifname_.empty()) {
+    return {{0ull, 0ull}};
+  }
 
-  std::string line;
-  // skip the headers (first two lines)
-  std::getline(netdev, line);
-  std::getline(netdev, line);
-
+  // Interface lines look like "  eth0: 1234 56 0 ...". Rather than splitting every line, which
+  // adds up with hundreds of veth/tap interfaces, jump to the lines of our interface.
+  const std::string_view data = *netdev;
   unsigned long long receivedBytes = 0ull;
   unsigned long long transmittedBytes = 0ull;
-  while (std::getline(netdev, line)) {
-    std::istringstream iss(line);
-
-    std::string ifacename;
-    iss >> ifacename;      // ifacename contains "eth0:"
-    ifacename.pop_back();  // remove trailing ':'
-    if (ifacename != ifname_) {
+  for (auto pos = data.find(ifname_); pos != std::string_view::npos;
+       pos = data.find(ifname_, pos + 1)) {
+    const auto end = pos + ifname_.size();
+    if ((pos != 0 && data[pos - 1] != ' ' && data[pos - 1] != '\n') || end >= data.size() ||
+        data[end] != ':') {
       continue;
     }
+    auto line = data.substr(end + 1, data.find('\n', end) - end - 1);
 
     // The rest of the line consists of whitespace separated counts divided
     // into two groups (receive and transmit). Each group has the following
@@ -59,26 +224,15 @@ waybar::modules::Network::readBandwidthUsage() {
     // columns.
     unsigned long long r = 0ull;
     unsigned long long t = 0ull;
-    // Read received bytes
-    iss >> r;
-    // Skip all the other columns in the received group
+    unsigned long long skipped = 0ull;
+    util::nextNumber(line, r);
     for (int colsToSkip = 7; colsToSkip > 0; colsToSkip--) {
-      // skip whitespace between columns
-      while (iss.peek() == ' ') {
-        iss.ignore();
-      }
-      // skip the irrelevant column
-      while (iss.peek() != ' ') {
-        iss.ignore();
-      }
+      util::nextNumber(line, skipped);
     }
-    // Read transmit bytes
-    iss >> t;
-
+    util::nextNumber(line, t);
     receivedBytes += r;
     transmittedBytes += t;
   }
-
   return {{receivedBytes, transmittedBytes}};
 }
 
@@ -116,145 +270,65 @@ waybar::modules::Network::Network(const std::string &id, const Json::Value &conf
     want_addr_dump_ = true;
   }
 
-  createEventSocket();
   createInfoSocket();
 
   dp.emit();
+  worker();
+  NetlinkHub::inst().add(this);
   // Ask for a dump of interfaces and then addresses to populate our
-  // information. First the interface dump, and once done, the callback
-  // will be called again which will ask for addresses dump.
+  // information. First the interface dump, and once done, the hub
+  // sends the addresses dump.
   askForStateDump();
-  worker();
 }
 
 waybar::modules::Network::~Network() {
-  if (ev_fd_ > -1) {
-    close(ev_fd_);
-  }
-  if (efd_ > -1) {
-    close(efd_);
-  }
-  if (ev_sock_ != nullptr) {
-    nl_socket_drop_memberships(ev_sock_, RTNLGRP_LINK, RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR);
-    nl_close(ev_sock_);
-    nl_socket_free(ev_sock_);
-  }
+  NetlinkHub::inst().remove(this);
   if (sock_ != nullptr) {
     nl_close(sock_);
     nl_socket_free(sock_);
   }
 }
 
-void waybar::modules::Network::createEventSocket() {
-  ev_sock_ = nl_socket_alloc();
-  nl_socket_disable_seq_check(ev_sock_);
-  nl_socket_modify_cb(ev_sock_, NL_CB_VALID, NL_CB_CUSTOM, handleEvents, this);
-  nl_socket_modify_cb(ev_sock_, NL_CB_FINISH, NL_CB_CUSTOM, handleEventsDone, this);
-  auto groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
-  nl_join_groups(ev_sock_, groups);  // Deprecated
-  if (nl_connect(ev_sock_, NETLINK_ROUTE) != 0) {
-    throw std::runtime_error("Can't connect network socket");
-  }
-  if (nl_socket_set_nonblocking(ev_sock_)) {
-    throw std::runtime_error("Can't set non-blocking on network socket");
-  }
-  nl_socket_add_memberships(ev_sock_, RTNLGRP_LINK, RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR, 0);
-  if (!config_["interface"].isString()) {
-    nl_socket_add_memberships(ev_sock_, RTNLGRP_IPV4_ROUTE, RTNLGRP_IPV6_ROUTE, 0);
-  }
-
-  efd_ = epoll_create1(EPOLL_CLOEXEC);
-  if (efd_ < 0) {
-    throw std::runtime_error("Can't create epoll");
-  }
-  {
-    ev_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
-    struct epoll_event event;
-    memset(&event, 0, sizeof(event));
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = ev_fd_;
-    if (epoll_ctl(efd_, EPOLL_CTL_ADD, ev_fd_, &event) == -1) {
-      throw std::runtime_error("Can't add epoll event");
-    }
-  }
-  {
-    auto fd = nl_socket_get_fd(ev_sock_);
-    struct epoll_event event;
-    memset(&event, 0, sizeof(event));
-    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
-    event.data.fd = fd;
-    if (epoll_ctl(efd_, EPOLL_CTL_ADD, fd, &event) == -1) {
-      throw std::runtime_error("Can't add epoll event");
-    }
-  }
-}
-
 void waybar::modules::Network::createInfoSocket() {
   sock_ = nl_socket_alloc();
   if (genl_connect(sock_) != 0) {
     throw std::runtime_error("Can't connect to netlink socket");
   }
-  if (nl_socket_modify_cb(sock_, NL_CB_VALID, NL_CB_CUSTOM, handleScan, this) < 0) {
+  if (nl_socket_modify_cb(sock_, NL_CB_VALID, NL_CB_CUSTOM, handleScan, this) < 0 ||
+      nl_socket_modify_cb(sock_, NL_CB_FINISH, NL_CB_CUSTOM, handleScanDone, this) < 0) {
     throw std::runtime_error("Can't set callback");
   }
   nl80211_id_ = genl_ctrl_resolve(sock_, "nl80211");
   if (nl80211_id_ < 0) {
     spdlog::warn("Can't resolve nl80211 interface");
   }
+  // the replies are waited for with a timeout, the ones of a dump that timed out come late
+  nl_socket_disable_seq_check(sock_);
+  nl_socket_set_nonblocking(sock_);
 }
 
 void waybar::modules::Network::worker() {
   // update via here not working
   thread_timer_ = [this] {
+    int ifid;
     {
       std::lock_guard<std::mutex> lock(mutex_);
-      if (ifid_ > 0) {
-        getInfo();
-      }
-      dp.emit();
+      ifid = ifid_;
+    }
+    if (ifid > 0 && nl80211_id_ >= 0) {
+      getInfo(ifid);
     }
+    dp.emit();
     thread_timer_.sleep_for(interval_);
   };
 #ifdef WANT_RFKILL
   rfkill_.on_update.connect([this](auto &) {
-    /* If we are here, it's likely that the network thread already holds the mutex and will be
-     * holding it for a next few seconds.
-     * Let's delegate the update to the timer thread instead of blocking the main thread.
-     */
+    // The timer thread refreshes the wifi info along with the state
     thread_timer_.wake_up();
   });
 #else
   spdlog::warn("Waybar has been built without rfkill support.");
 #endif
-  thread_ = [this] {
-    std::array<struct epoll_event, EPOLL_MAX> events{};
-
-    int ec = epoll_wait(efd_, events.data(), EPOLL_MAX, -1);
-    if (ec > 0) {
-      for (auto i = 0; i < ec; i++) {
-        if (events[i].data.fd == nl_socket_get_fd(ev_sock_)) {
-          int rc = 0;
-          // Read as many message as possible, until the socket blocks
-          while (true) {
-            errno = 0;
-            rc = nl_recvmsgs_default(ev_sock_);
-            if (rc == -NLE_AGAIN || errno == EAGAIN) {
-              rc = 0;
-              break;
-            }
-          }
-          if (rc < 0) {
-            spdlog::error("nl_recvmsgs_default error: {}", nl_geterror(-rc));
-            thread_.stop();
-            break;
-          }
-        } else {
-          thread_.stop();
-          break;
-        }
-      }
-    }
-  };
 }
 
 const std::string waybar::modules::Network::getNetworkState() const {
@@ -273,6 +347,11 @@ const std::string waybar::modules::Network::getNetworkState() const {
   return "wifi";
 }
 
+auto waybar::modules::Network::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  thread_timer_.pause(paused);
+}
+
 auto waybar::modules::Network::update() -> void {
   std::lock_guard<std::mutex> lock(mutex_);
   std::string tooltip_format;
@@ -313,6 +392,16 @@ auto waybar::modules::Network::update() -> void {
     state_ = state;
   }
   getState(signal_strength_);
+  if (publishesState()) {
+    const double seconds = interval_.count() / 1000.0;
+    state_fields_["ifname"] = ifname_;
+    state_fields_["state"] = state_;
+    state_fields_["essid"] = essid_;
+    state_fields_["signal-strength"] = signal_strength_;
+    state_fields_["ipaddr"] = ipaddr_;
+    state_fields_["bandwidth-down"] = static_cast<double>(bandwidth_down) / seconds;  // B/s
+    state_fields_["bandwidth-up"] = static_cast<double>(bandwidth_up) / seconds;
+  }
 
   std::string final_ipaddr_;
   if (addr_pref_ == ip_addr_pref::IPV4) {
@@ -331,8 +420,9 @@ auto waybar::modules::Network::update() -> void {
       fmt::arg("signalStrengthApp", signal_strength_app_), fmt::arg("ifname", ifname_),
       fmt::arg("netmask", netmask_), fmt::arg("netmask6", netmask6_),
       fmt::arg("ipaddr", final_ipaddr_), fmt::arg("gwaddr", gwaddr_), fmt::arg("cidr", cidr_),
-      fmt::arg("cidr6", cidr6_), fmt::arg("frequency", fmt::format("{:.1f}", frequency_)),
-      fmt::arg("icon", getIcon(signal_strength_, state_)),
+      fmt::arg("cidr6", cidr6_),
+      fmt::arg("frequency", formatUses("frequency") ? fmt::format("{:.1f}", frequency_) : ""),
+      fmt::arg("icon", formatUses("icon") ? getIcon(signal_strength_, state_) : ""),
       fmt::arg("bandwidthDownBits",
                pow_format(bandwidth_down * 8ull / (interval_.count() / 1000.0), "b/s")),
       fmt::arg("bandwidthUpBits",
@@ -766,8 +856,8 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
               .ifi_index = temp_idx,
           };
           int err;
-          err = nl_send_simple(net->ev_sock_, RTM_GETLINK, NLM_F_REQUEST, &ifinfo_hdr,
-                               sizeof(ifinfo_hdr));
+          err = NetlinkHub::inst().send(RTM_GETLINK, NLM_F_REQUEST, &ifinfo_hdr,
+                                        sizeof(ifinfo_hdr));
           if (err < 0) {
             spdlog::error("network: failed to ask link info: {}", err);
             /* Ask for a dump of all links instead */
@@ -801,36 +891,10 @@ int waybar::modules::Network::handleEvents(struct nl_msg *msg, void *data) {
 }
 
 void waybar::modules::Network::askForStateDump(void) {
-  /* We need to wait until the current dump is done before sending new
-   * messages. handleEventsDone() is called when a dump is done. */
-  if (dump_in_progress_) return;
-
-  struct rtgenmsg rt_hdr = {
-      .rtgen_family = AF_UNSPEC,
-  };
-
-  if (want_route_dump_) {
-    nl_send_simple(ev_sock_, RTM_GETROUTE, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
-    want_route_dump_ = false;
-    dump_in_progress_ = true;
-
-  } else if (want_link_dump_) {
-    nl_send_simple(ev_sock_, RTM_GETLINK, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
-    want_link_dump_ = false;
-    dump_in_progress_ = true;
-
-  } else if (want_addr_dump_) {
-    nl_send_simple(ev_sock_, RTM_GETADDR, NLM_F_DUMP, &rt_hdr, sizeof(rt_hdr));
-    want_addr_dump_ = false;
-    dump_in_progress_ = true;
-  }
-}
-
-int waybar::modules::Network::handleEventsDone(struct nl_msg *msg, void *data) {
-  auto net = static_cast<waybar::modules::Network *>(data);
-  net->dump_in_progress_ = false;
-  net->askForStateDump();
-  return NL_OK;
+  NetlinkHub::inst().requestDump(want_route_dump_, want_link_dump_, want_addr_dump_);
+  want_route_dump_ = false;
+  want_link_dump_ = false;
+  want_addr_dump_ = false;
 }
 
 int waybar::modules::Network::handleScan(struct nl_msg *msg, void *data) {
@@ -957,16 +1021,44 @@ bool waybar::modules::Network::associatedOrJoined(struct nlattr **bss) {
   }
 }
 
-auto waybar::modules::Network::getInfo() -> void {
+int waybar::modules::Network::handleScanDone(struct nl_msg * /*msg*/, void *data) {
+  static_cast<waybar::modules::Network *>(data)->scan_done_ = true;
+  return NL_STOP;
+}
+
+auto waybar::modules::Network::getInfo(int ifid) -> void {
   struct nl_msg *nl_msg = nlmsg_alloc();
   if (nl_msg == nullptr) {
     return;
   }
   if (genlmsg_put(nl_msg, NL_AUTO_PORT, NL_AUTO_SEQ, nl80211_id_, 0, NLM_F_DUMP,
                   NL80211_CMD_GET_SCAN, 0) == nullptr ||
-      nla_put_u32(nl_msg, NL80211_ATTR_IFINDEX, ifid_) < 0) {
+      nla_put_u32(nl_msg, NL80211_ATTR_IFINDEX, ifid) < 0) {
     nlmsg_free(nl_msg);
     return;
   }
-  nl_send_sync(sock_, nl_msg);
+  const int sent = nl_send_auto(sock_, nl_msg);
+  nlmsg_free(nl_msg);
+  if (sent < 0) {
+    return;
+  }
+  scan_done_ = false;
+  const auto deadline = std::chrono::steady_clock::now() + SCAN_TIMEOUT;
+  while (!scan_done_) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0 || !thread_timer_.waitReadable(nl_socket_get_fd(sock_), left)) {
+      if (thread_timer_.isRunning()) {
+        spdlog::debug("network: no BSS dump of interface {} within {}ms, keeping the last one",
+                      ifid, SCAN_TIMEOUT.count());
+      }
+      return;
+    }
+    // the dump parses into the members update() shows
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int rc = nl_recvmsgs_default(sock_);
+    if (rc < 0 && rc != -NLE_AGAIN) {
+      return;  // not a wireless interface, or it went away
+    }
+  }
 }
@@ -1,7 +1,9 @@
 #include "modules/niri/backend.hpp"
 
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <spdlog/spdlog.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -9,14 +11,20 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #include "giomm/datainputstream.h"
 #include "giomm/dataoutputstream.h"
 #include "giomm/unixinputstream.h"
 #include "giomm/unixoutputstream.h"
+#include "util/log.hpp"
+#include "util/scope_guard.hpp"
 
 namespace waybar::modules::niri {
 
@@ -51,6 +59,54 @@ int IPC::connectToSocket() {
   return socketfd;
 }
 
+namespace {
+
+// Lines from a non-blocking socket, read in as large chunks as are available
+class LineReader {
+ public:
+  explicit LineReader(int fd) : fd_(fd) {}
+
+  // Waits for data and reads all of it, false once the socket is closed or failed
+  bool fill() {
+    pollfd pfd = {.fd = fd_, .events = POLLIN, .revents = 0};
+    while (poll(&pfd, 1, -1) == -1) {
+      if (errno != EINTR) return false;
+    }
+    if ((pfd.revents & (POLLERR | POLLNVAL)) != 0) return false;
+
+    // Compact what was handed out before reading more
+    buffer_.erase(0, start_);
+    start_ = 0;
+    while (true) {
+      auto bytesRead = read(fd_, chunk_.data(), chunk_.size());
+      if (bytesRead > 0) {
+        buffer_.append(chunk_.data(), bytesRead);
+      } else if (bytesRead == 0) {
+        return false;
+      } else if (errno != EINTR) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+    }
+  }
+
+  // The next complete line, false once none is left in the buffer
+  bool next(std::string &line) {
+    auto end = buffer_.find('\n', start_);
+    if (end == std::string::npos) return false;
+    line.assign(buffer_, start_, end - start_);
+    start_ = end + 1;
+    return true;
+  }
+
+ private:
+  int fd_;
+  std::string buffer_;
+  size_t start_ = 0;
+  std::array<char, 8192> chunk_;
+};
+
+}  // namespace
+
 void IPC::startIPC() {
   // will start IPC and relay events to parseIPC
 
@@ -63,102 +119,123 @@ void IPC::startIPC() {
       return;
     }
     if (socketfd == -1) return;
+    util::ScopeGuard socketCloser([socketfd]() { close(socketfd); });
 
     spdlog::info("Niri IPC starting");
 
-    auto unix_istream = Gio::UnixInputStream::create(socketfd, true);
-    auto unix_ostream = Gio::UnixOutputStream::create(socketfd, false);
-    auto istream = Gio::DataInputStream::create(unix_istream);
-    auto ostream = Gio::DataOutputStream::create(unix_ostream);
-
-    if (!ostream->put_string("\"EventStream\"\n") || !ostream->flush()) {
+    const std::string_view request = "\"EventStream\"\n";
+    if (write(socketfd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
       spdlog::error("Niri IPC: failed to start event stream");
       return;
     }
 
+    // The state is replayed as a burst of events at first: read whatever the socket holds at
+    // once and dispatch it as one batch
+    int flags = fcntl(socketfd, F_GETFL, 0);
+    if (flags == -1 || fcntl(socketfd, F_SETFL, flags | O_NONBLOCK) == -1) {
+      spdlog::error("Niri IPC: couldn't set socket to non-blocking mode");
+      return;
+    }
+    LineReader reader(socketfd);
+
     std::string line;
-    if (!istream->read_line(line) || line != R"({"Ok":"Handled"})") {
+    bool open = true;
+    while (!reader.next(line) && open) open = reader.fill();
+    if (line != R"({"Ok":"Handled"})") {
       spdlog::error("Niri IPC: failed to start event stream");
       return;
     }
 
-    while (istream->read_line(line)) {
-      spdlog::debug("Niri IPC: received {}", line);
+    // The handshake read may have brought in the first events already
+    std::vector<std::string> batch;
+    while (true) {
+      batch.clear();
+      while (reader.next(line)) batch.push_back(std::move(line));
+      if (!batch.empty()) parseBatch(batch);
+      if (!open) break;
+      open = reader.fill();
+    }
+    spdlog::warn("Niri IPC: event stream closed");
+  }).detach();
+}
 
-      try {
-        parseIPC(line);
-      } catch (std::exception &e) {
-        spdlog::warn("Failed to parse IPC message: {}, reason: {}", line, e.what());
-      } catch (...) {
-        throw;
-      }
+void IPC::parseBatch(const std::vector<std::string> &lines) {
+  std::unique_lock lock(callbackMutex_);
+
+  std::vector<EventHandler *> notified;
+  for (const auto &line : lines) {
+    WAYBAR_LOG_DEBUG("Niri IPC: received {}", line);
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    try {
+      parseIPC(line, notified);
+    } catch (std::exception &e) {
+      spdlog::warn("Failed to parse IPC message: {}, reason: {}", line, e.what());
     }
-  }).detach();
+  }
+
+  for (auto *handler : notified) handler->onEventsDispatched();
 }
 
-void IPC::parseIPC(const std::string &line) {
+void IPC::parseIPC(const std::string &line, std::vector<EventHandler *> &notified) {
   const auto ev = parser_.parse(line);
   const auto members = ev.getMemberNames();
   if (members.size() != 1) throw std::runtime_error("Event must have a single member");
 
+  ChangedOutputs changed;
   {
     auto lock = lockData();
 
     if (const auto &payload = ev["WorkspacesChanged"]) {
+      changed.all = true;
       workspaces_.clear();
-      const auto &values = payload["workspaces"];
-      std::copy(values.begin(), values.end(), std::back_inserter(workspaces_));
-
-      std::sort(workspaces_.begin(), workspaces_.end(), [](const auto &a, const auto &b) {
-        const auto &aOutput = a["output"].asString();
-        const auto &bOutput = b["output"].asString();
-        const auto aIdx = a["idx"].asUInt();
-        const auto bIdx = b["idx"].asUInt();
-        if (aOutput == bOutput) return aIdx < bIdx;
-        return aOutput < bOutput;
+      for (const auto &ws : payload["workspaces"]) workspaces_.push_back(toWorkspace(ws));
+
+      std::sort(workspaces_.begin(), workspaces_.end(), [this](const auto &a, const auto &b) {
+        if (a.output == b.output) return a.idx < b.idx;
+        return outputName(a.output) < outputName(b.output);
       });
+
+      workspaceIndex_.clear();
+      for (size_t i = 0; i < workspaces_.size(); ++i) workspaceIndex_[workspaces_[i].id] = i;
     } else if (const auto &payload = ev["WorkspaceActivated"]) {
       const auto id = payload["id"].asUInt64();
       const auto focused = payload["focused"].asBool();
-      auto it = std::find_if(workspaces_.begin(), workspaces_.end(),
-                             [id](const auto &ws) { return ws["id"].asUInt64() == id; });
-      if (it != workspaces_.end()) {
-        const auto &ws = *it;
-        const auto &output = ws["output"].asString();
+      if (const auto *activated = workspace(id)) {
+        const auto output = activated->output;
+        changed.add(output);
         for (auto &ws : workspaces_) {
-          const auto got_activated = (ws["id"].asUInt64() == id);
-          if (ws["output"] == output) ws["is_active"] = got_activated;
+          // focus may move away from another output
+          if (focused && ws.is_focused) changed.add(ws.output);
+          const auto got_activated = (ws.id == id);
+          if (ws.output == output) ws.is_active = got_activated;
 
-          if (focused) ws["is_focused"] = got_activated;
+          if (focused) ws.is_focused = got_activated;
         }
       } else {
         spdlog::error("Activated unknown workspace");
       }
     } else if (const auto &payload = ev["WorkspaceActiveWindowChanged"]) {
       const auto workspaceId = payload["workspace_id"].asUInt64();
-      auto it = std::find_if(workspaces_.begin(), workspaces_.end(), [workspaceId](const auto &ws) {
-        return ws["id"].asUInt64() == workspaceId;
-      });
-      if (it != workspaces_.end()) {
-        auto &ws = *it;
-        ws["active_window_id"] = payload["active_window_id"];
+      auto it = workspaceIndex_.find(workspaceId);
+      if (it != workspaceIndex_.end()) {
+        changed.add(workspaces_[it->second].output);
+        const auto &activeWindowId = payload["active_window_id"];
+        workspaces_[it->second].active_window_id =
+            activeWindowId.isNull() ? std::nullopt : std::optional(activeWindowId.asUInt64());
       } else {
         spdlog::error("Active window changed on unknown workspace");
       }
     } else if (const auto &payload = ev["WorkspaceUrgencyChanged"]) {
       const auto id = payload["id"].asUInt64();
-      const auto urgent = payload["urgent"].asBool();
-      auto it = std::find_if(workspaces_.begin(), workspaces_.end(),
-                             [id](const auto &ws) { return ws["id"].asUInt64() == id; });
-      if (it != workspaces_.end()) {
-        auto &ws = *it;
-        ws["is_urgent"] = urgent;
+      auto it = workspaceIndex_.find(id);
+      if (it != workspaceIndex_.end()) {
+        changed.add(workspaces_[it->second].output);
+        workspaces_[it->second].is_urgent = payload["urgent"].asBool();
       } else {
         spdlog::error("Urgency changed for unknown workspace");
       }
     } else if (const auto &payload = ev["KeyboardLayoutsChanged"]) {
+      changed.all = true;
       const auto &layouts = payload["keyboard_layouts"];
       const auto &names = layouts["names"];
       keyboardLayoutCurrent_ = layouts["current_idx"].asUInt();
@@ -166,33 +243,50 @@ void IPC::parseIPC(const std::string &line) {
       keyboardLayoutNames_.clear();
       for (const auto &fullName : names) keyboardLayoutNames_.push_back(fullName.asString());
     } else if (const auto &payload = ev["KeyboardLayoutSwitched"]) {
+      changed.all = true;
       keyboardLayoutCurrent_ = payload["idx"].asUInt();
     } else if (const auto &payload = ev["WindowsChanged"]) {
+      changed.all = true;
       windows_.clear();
-      const auto &values = payload["windows"];
-      std::copy(values.begin(), values.end(), std::back_inserter(windows_));
+      windowIndex_.clear();
+      for (const auto &win : payload["windows"]) {
+        windowIndex_[win["id"].asUInt64()] = windows_.size();
+        windows_.push_back(toWindow(win));
+      }
     } else if (const auto &payload = ev["WindowOpenedOrChanged"]) {
-      const auto &window = payload["window"];
-      const auto id = window["id"].asUInt64();
-      auto it = std::find_if(windows_.begin(), windows_.end(),
-                             [id](const auto &win) { return win["id"].asUInt64() == id; });
-      if (it == windows_.end()) {
-        windows_.push_back(window);
-
-        if (window["is_focused"].asBool()) {
+      auto window = toWindow(payload["window"]);
+      const auto id = window.id;
+      changed.add(workspaceOutput(window.workspace_id));
+      auto it = windowIndex_.find(id);
+      if (it == windowIndex_.end()) {
+        const auto focused = window.is_focused;
+        windowIndex_.emplace(id, windows_.size());
+        windows_.push_back(std::move(window));
+
+        if (focused) {
           for (auto &win : windows_) {
-            win["is_focused"] = win["id"].asUInt64() == id;
+            if (win.is_focused && win.id != id) changed.add(workspaceOutput(win.workspace_id));
+            win.is_focused = win.id == id;
           }
         }
       } else {
-        *it = window;
+        // it may have moved from another output
+        changed.add(workspaceOutput(windows_[it->second].workspace_id));
+        windows_[it->second] = std::move(window);
       }
     } else if (const auto &payload = ev["WindowClosed"]) {
       const auto id = payload["id"].asUInt64();
-      auto it = std::find_if(windows_.begin(), windows_.end(),
-                             [id](const auto &win) { return win["id"].asUInt64() == id; });
-      if (it != windows_.end()) {
-        windows_.erase(it);
+      auto it = windowIndex_.find(id);
+      if (it != windowIndex_.end()) {
+        // The order does not matter: move the last window in its place
+        const auto index = it->second;
+        changed.add(workspaceOutput(windows_[index].workspace_id));
+        windowIndex_.erase(it);
+        if (index != windows_.size() - 1) {
+          windows_[index] = std::move(windows_.back());
+          windowIndex_[windows_[index].id] = index;
+        }
+        windows_.pop_back();
       } else {
         spdlog::error("Unknown window closed");
       }
@@ -200,27 +294,110 @@ void IPC::parseIPC(const std::string &line) {
       const auto focused = !payload["id"].isNull();
       const auto id = payload["id"].asUInt64();
       for (auto &win : windows_) {
-        win["is_focused"] = focused && win["id"].asUInt64() == id;
+        const auto is_focused = focused && win.id == id;
+        if (win.is_focused != is_focused) changed.add(workspaceOutput(win.workspace_id));
+        win.is_focused = is_focused;
       }
+    } else {
+      changed.all = true;
     }
   }
 
-  std::unique_lock lock(callbackMutex_);
-
-  for (auto &[eventname, handler] : callbacks_) {
-    if (eventname == members[0]) {
+  for (auto &[eventname, handler, output] : callbacks_) {
+    if (eventname == members[0] && (!output || changed.contains(*output, *this))) {
       handler->onEvent(ev);
+      if (std::find(notified.begin(), notified.end(), handler) == notified.end()) {
+        notified.push_back(handler);
+      }
     }
   }
 }
 
-void IPC::registerForIPC(const std::string &ev, EventHandler *ev_handler) {
+uint32_t IPC::internOutput(const Json::Value &name) {
+  if (!name.isString()) return NO_OUTPUT;
+  const auto &value = name.asString();
+  auto it = std::find(outputNames_.begin(), outputNames_.end(), value);
+  if (it != outputNames_.end()) return it - outputNames_.begin();
+  outputNames_.push_back(value);
+  return outputNames_.size() - 1;
+}
+
+IPC::Workspace IPC::toWorkspace(const Json::Value &ws) {
+  const auto &name = ws["name"];
+  const auto &activeWindowId = ws["active_window_id"];
+  return {
+      .id = ws["id"].asUInt64(),
+      .idx = ws["idx"].asUInt(),
+      .name = name.isNull() ? std::nullopt : std::optional(name.asString()),
+      .output = internOutput(ws["output"]),
+      .active_window_id =
+          activeWindowId.isNull() ? std::nullopt : std::optional(activeWindowId.asUInt64()),
+      .is_active = ws["is_active"].asBool(),
+      .is_focused = ws["is_focused"].asBool(),
+      .is_urgent = ws["is_urgent"].asBool(),
+  };
+}
+
+IPC::Window IPC::toWindow(const Json::Value &win) {
+  const auto &workspaceId = win["workspace_id"];
+  return {
+      .id = win["id"].asUInt64(),
+      .title = win["title"].asString(),
+      .app_id = win["app_id"].asString(),
+      .workspace_id = workspaceId.isNull() ? std::nullopt : std::optional(workspaceId.asUInt64()),
+      .is_focused = win["is_focused"].asBool(),
+  };
+}
+
+const IPC::Workspace *IPC::workspace(uint64_t id) const {
+  auto it = workspaceIndex_.find(id);
+  return it == workspaceIndex_.end() ? nullptr : &workspaces_[it->second];
+}
+
+const IPC::Window *IPC::window(uint64_t id) const {
+  auto it = windowIndex_.find(id);
+  return it == windowIndex_.end() ? nullptr : &windows_[it->second];
+}
+
+std::optional<uint32_t> IPC::findOutput(const std::string &name) const {
+  auto it = std::find(outputNames_.begin(), outputNames_.end(), name);
+  if (it == outputNames_.end()) return std::nullopt;
+  return it - outputNames_.begin();
+}
+
+const std::string &IPC::outputName(uint32_t output) const {
+  static const std::string none;
+  return output < outputNames_.size() ? outputNames_[output] : none;
+}
+
+void IPC::ChangedOutputs::add(uint32_t output) {
+  // Changes to windows or workspaces niri has not placed are not filtered
+  if (output == NO_OUTPUT) {
+    all = true;
+  } else if (std::find(outputs.begin(), outputs.end(), output) == outputs.end()) {
+    outputs.push_back(output);
+  }
+}
+
+bool IPC::ChangedOutputs::contains(const std::string &name, const IPC &ipc) const {
+  return all || std::any_of(outputs.begin(), outputs.end(), [&](uint32_t output) {
+           return ipc.outputName(output) == name;
+         });
+}
+
+uint32_t IPC::workspaceOutput(std::optional<uint64_t> workspaceId) const {
+  const auto *ws = workspaceId ? workspace(*workspaceId) : nullptr;
+  return ws != nullptr ? ws->output : NO_OUTPUT;
+}
+
+void IPC::registerForIPC(const std::string &ev, EventHandler *ev_handler,
+                         std::optional<std::string> output) {
   if (ev_handler == nullptr) {
     return;
   }
 
   std::unique_lock lock(callbackMutex_);
-  callbacks_.emplace_back(ev, ev_handler);
+  callbacks_.push_back({ev, ev_handler, std::move(output)});
 }
 
 void IPC::unregisterForIPC(EventHandler *ev_handler) {
@@ -231,8 +408,7 @@ void IPC::unregisterForIPC(EventHandler *ev_handler) {
   std::unique_lock lock(callbackMutex_);
 
   for (auto it = callbacks_.begin(); it != callbacks_.end();) {
-    auto &[eventname, handler] = *it;
-    if (handler == ev_handler) {
+    if (it->handler == ev_handler) {
       it = callbacks_.erase(it);
     } else {
       ++it;
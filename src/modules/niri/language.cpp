@@ -105,10 +105,10 @@ void Language::onEvent(const Json::Value &ev) {
     auto ipcLock = gIPC->lockData();
     current_idx_ = gIPC->keyboardLayoutCurrent();
   }
-
-  dp.emit();
 }
 
+void Language::onEventsDispatched() { dp.emit(); }
+
 Language::Layout Language::getLayout(const std::string &fullName) {
   auto *const context = rxkb_context_new(RXKB_CONTEXT_LOAD_EXOTIC_RULES);
   rxkb_context_parse_default_ruleset(context);
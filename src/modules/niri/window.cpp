@@ -10,20 +10,27 @@
 namespace waybar::modules::niri {
 
 Window::Window(const std::string &id, const Bar &bar, const Json::Value &config)
-    : AAppIconLabel(config, "window", id, "{title}", 0, true), bar_(bar) {
+    : AAppIconLabel(config, "window", id, "{title}", 0, true),
+      bar_(bar),
+      rewrite_(util::RewriteRules::shared(config["rewrite"])) {
   if (!gIPC) gIPC = std::make_unique<IPC>();
 
-  gIPC->registerForIPC("WindowsChanged", this);
-  gIPC->registerForIPC("WindowOpenedOrChanged", this);
-  gIPC->registerForIPC("WindowClosed", this);
-  gIPC->registerForIPC("WindowFocusChanged", this);
+  // With separate-outputs, only the windows on this bar's output matter
+  std::optional<std::string> output;
+  if (config_["separate-outputs"].asBool()) output = bar_.output->name;
+  gIPC->registerForIPC("WindowsChanged", this, output);
+  gIPC->registerForIPC("WindowOpenedOrChanged", this, output);
+  gIPC->registerForIPC("WindowClosed", this, output);
+  gIPC->registerForIPC("WindowFocusChanged", this, output);
 
   dp.emit();
 }
 
 Window::~Window() { gIPC->unregisterForIPC(this); }
 
-void Window::onEvent(const Json::Value &ev) { dp.emit(); }
+void Window::onEvent(const Json::Value &ev) {}
+
+void Window::onEventsDispatched() { dp.emit(); }
 
 void Window::doUpdate() {
   auto ipcLock = gIPC->lockData();
@@ -32,47 +39,39 @@ void Window::doUpdate() {
   const auto &workspaces = gIPC->workspaces();
 
   const auto separateOutputs = config_["separate-outputs"].asBool();
+  const auto barOutput = separateOutputs ? gIPC->findOutput(bar_.output->name) : std::nullopt;
   const auto ws_it = std::find_if(workspaces.cbegin(), workspaces.cend(), [&](const auto &ws) {
     if (separateOutputs) {
-      return ws["is_active"].asBool() && ws["output"].asString() == bar_.output->name;
+      return ws.is_active && barOutput.has_value() && ws.output == *barOutput;
     }
 
-    return ws["is_focused"].asBool();
+    return ws.is_focused;
   });
 
-  std::vector<Json::Value>::const_iterator it;
-  if (ws_it == workspaces.cend() || (*ws_it)["active_window_id"].isNull()) {
-    it = windows.cend();
-  } else {
-    const auto id = (*ws_it)["active_window_id"].asUInt64();
-    it = std::find_if(windows.cbegin(), windows.cend(),
-                      [id](const auto &win) { return win["id"].asUInt64() == id; });
-  }
-
-  setClass("empty", ws_it == workspaces.cend() || (*ws_it)["active_window_id"].isNull());
+  const bool empty = ws_it == workspaces.cend() || !ws_it->active_window_id;
+  const auto *window = empty ? nullptr : gIPC->window(*ws_it->active_window_id);
 
-  if (it != windows.cend()) {
-    const auto &window = *it;
+  setClass("empty", empty);
 
-    const auto title = window["title"].asString();
-    const auto appId = window["app_id"].asString();
+  if (window != nullptr) {
+    const auto &title = window->title;
+    const auto &appId = window->app_id;
     const auto sanitizedTitle = waybar::util::sanitize_string(title);
     const auto sanitizedAppId = waybar::util::sanitize_string(appId);
 
     label_.show();
-    label_.set_markup(waybar::util::rewriteString(
+    label_.set_markup(rewrite_->apply(
         fmt::format(fmt::runtime(format_), fmt::arg("title", sanitizedTitle),
-                    fmt::arg("app_id", sanitizedAppId)),
-        config_["rewrite"]));
+                    fmt::arg("app_id", sanitizedAppId))));
 
     updateAppIconName(appId, "");
 
     if (tooltipEnabled()) label_.set_tooltip_text(title);
 
-    const auto id = window["id"].asUInt64();
-    const auto workspaceId = window["workspace_id"].asUInt64();
+    const auto id = window->id;
+    const auto workspaceId = window->workspace_id;
     const auto isSolo = std::none_of(windows.cbegin(), windows.cend(), [&](const auto &win) {
-      return win["id"].asUInt64() != id && win["workspace_id"].asUInt64() == workspaceId;
+      return win.id != id && win.workspace_id == workspaceId;
     });
     setClass("solo", isSolo);
     if (!appId.empty()) setClass(appId, isSolo);
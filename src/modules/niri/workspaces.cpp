@@ -4,6 +4,8 @@
 #include <gtkmm/label.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 namespace waybar::modules::niri {
 
 Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value &config)
@@ -17,35 +19,42 @@ Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value
 
   if (!gIPC) gIPC = std::make_unique<IPC>();
 
-  gIPC->registerForIPC("WorkspacesChanged", this);
-  gIPC->registerForIPC("WorkspaceActivated", this);
-  gIPC->registerForIPC("WorkspaceActiveWindowChanged", this);
-  gIPC->registerForIPC("WorkspaceUrgencyChanged", this);
+  // Only the workspaces of this bar's output are shown, unless all-outputs is set
+  std::optional<std::string> output;
+  if (!config_["all-outputs"].asBool()) output = bar_.output->name;
+  gIPC->registerForIPC("WorkspacesChanged", this, output);
+  gIPC->registerForIPC("WorkspaceActivated", this, output);
+  gIPC->registerForIPC("WorkspaceActiveWindowChanged", this, output);
+  gIPC->registerForIPC("WorkspaceUrgencyChanged", this, output);
 
   dp.emit();
 }
 
 Workspaces::~Workspaces() { gIPC->unregisterForIPC(this); }
 
-void Workspaces::onEvent(const Json::Value &ev) { dp.emit(); }
+void Workspaces::onEvent(const Json::Value &ev) {}
+
+void Workspaces::onEventsDispatched() { dp.emit(); }
 
 void Workspaces::doUpdate() {
   auto ipcLock = gIPC->lockData();
 
   const auto alloutputs = config_["all-outputs"].asBool();
-  std::vector<Json::Value> my_workspaces;
-  const auto &workspaces = gIPC->workspaces();
-  std::copy_if(workspaces.cbegin(), workspaces.cend(), std::back_inserter(my_workspaces),
-               [&](const auto &ws) {
-                 if (alloutputs) return true;
-                 return ws["output"].asString() == bar_.output->name;
-               });
+  const auto barOutput = gIPC->findOutput(bar_.output->name);
+  const auto onBarOutput = [&](const IPC::Workspace &ws) {
+    return barOutput.has_value() && ws.output == *barOutput;
+  };
+  std::vector<const IPC::Workspace *> my_workspaces;
+  for (const auto &ws : gIPC->workspaces()) {
+    if (alloutputs || onBarOutput(ws)) my_workspaces.push_back(&ws);
+  }
 
   // Remove buttons for removed workspaces.
   for (auto it = buttons_.begin(); it != buttons_.end();) {
-    auto ws = std::find_if(my_workspaces.begin(), my_workspaces.end(),
-                           [it](const auto &ws) { return ws["id"].asUInt64() == it->first; });
-    if (ws == my_workspaces.end()) {
+    const auto *ws = gIPC->workspace(it->first);
+    if (ws == nullptr || (!alloutputs && !onBarOutput(*ws))) {
+      auto &button = *it->second;
+      spare_buttons_.give(std::move(it->second), button);
       it = buttons_.erase(it);
     } else {
       ++it;
@@ -53,54 +62,46 @@ void Workspaces::doUpdate() {
   }
 
   // Add buttons for new workspaces, update existing ones.
-  for (const auto &ws : my_workspaces) {
-    auto bit = buttons_.find(ws["id"].asUInt64());
-    auto &button = bit == buttons_.end() ? addButton(ws) : bit->second;
+  for (const auto *wsPtr : my_workspaces) {
+    const auto &ws = *wsPtr;
+    auto bit = buttons_.find(ws.id);
+    auto &button = bit == buttons_.end() ? addButton(ws) : *bit->second;
     auto style_context = button.get_style_context();
 
-    if (ws["is_focused"].asBool())
+    if (ws.is_focused)
       style_context->add_class("focused");
     else
       style_context->remove_class("focused");
 
-    if (ws["is_active"].asBool())
+    if (ws.is_active)
       style_context->add_class("active");
     else
       style_context->remove_class("active");
 
-    if (ws["is_urgent"].asBool())
+    if (ws.is_urgent)
       style_context->add_class("urgent");
     else
       style_context->remove_class("urgent");
 
-    if (ws["output"]) {
-      if (ws["output"].asString() == bar_.output->name)
-        style_context->add_class("current_output");
-      else
-        style_context->remove_class("current_output");
-    } else {
+    if (onBarOutput(ws))
+      style_context->add_class("current_output");
+    else
       style_context->remove_class("current_output");
-    }
 
-    if (ws["active_window_id"].isNull())
+    if (!ws.active_window_id)
       style_context->add_class("empty");
     else
       style_context->remove_class("empty");
 
-    std::string name;
-    if (ws["name"]) {
-      name = ws["name"].asString();
-    } else {
-      name = std::to_string(ws["idx"].asUInt());
-    }
+    std::string name = ws.name.value_or(std::to_string(ws.idx));
     button.set_name("niri-workspace-" + name);
 
     if (config_["format"].isString()) {
       auto format = config_["format"].asString();
       name = fmt::format(fmt::runtime(format), fmt::arg("icon", getIcon(name, ws)),
-                         fmt::arg("value", name), fmt::arg("name", ws["name"].asString()),
-                         fmt::arg("index", ws["idx"].asUInt()),
-                         fmt::arg("output", ws["output"].asString()));
+                         fmt::arg("value", name), fmt::arg("name", ws.name.value_or("")),
+                         fmt::arg("index", ws.idx),
+                         fmt::arg("output", gIPC->outputName(ws.output)));
     }
     if (!config_["disable-markup"].asBool()) {
       static_cast<Gtk::Label *>(button.get_children()[0])->set_markup(name);
@@ -109,8 +110,7 @@ void Workspaces::doUpdate() {
     }
 
     if (config_["current-only"].asBool()) {
-      const auto *property = alloutputs ? "is_focused" : "is_active";
-      if (ws[property].asBool())
+      if (alloutputs ? ws.is_focused : ws.is_active)
         button.show();
       else
         button.hide();
@@ -121,13 +121,12 @@ void Workspaces::doUpdate() {
 
   // Refresh the button order.
   for (auto it = my_workspaces.cbegin(); it != my_workspaces.cend(); ++it) {
-    const auto &ws = *it;
+    const auto &ws = **it;
 
-    auto pos = ws["idx"].asUInt() - 1;
+    auto pos = ws.idx - 1;
     if (alloutputs) pos = it - my_workspaces.cbegin();
 
-    auto &button = buttons_[ws["id"].asUInt64()];
-    box_.reorder_child(button, pos);
+    box_.reorder_child(*buttons_[ws.id], pos);
   }
 }
 
@@ -136,28 +135,31 @@ void Workspaces::update() {
   AModule::update();
 }
 
-Gtk::Button &Workspaces::addButton(const Json::Value &ws) {
-  std::string name;
-  if (ws["name"]) {
-    name = ws["name"].asString();
-  } else {
-    name = std::to_string(ws["idx"].asUInt());
+Gtk::Button &Workspaces::addButton(const IPC::Workspace &ws) {
+  auto &slot = buttons_[ws.id];
+  // A recycled one is already in the box and hooked up, the update renames it
+  if ((slot = spare_buttons_.take())) {
+    return *slot;
   }
-
-  auto pair = buttons_.emplace(ws["id"].asUInt64(), name);
-  auto &&button = pair.first->second;
+  slot = std::make_unique<Gtk::Button>(ws.name.value_or(std::to_string(ws.idx)));
+  auto &button = *slot;
   box_.pack_start(button, false, false, 0);
   button.set_relief(Gtk::RELIEF_NONE);
   if (!config_["disable-click"].asBool()) {
-    const auto id = ws["id"].asUInt64();
-    button.signal_pressed().connect([=] {
+    button.signal_pressed().connect([this, &button] {
+      // The workspace the button shows now, it may have been recycled since
+      auto bound = std::find_if(buttons_.begin(), buttons_.end(),
+                                [&](const auto &pair) { return pair.second.get() == &button; });
+      if (bound == buttons_.end()) {
+        return;
+      }
       try {
         // {"Action":{"FocusWorkspace":{"reference":{"Id":1}}}}
         Json::Value request(Json::objectValue);
         auto &action = (request["Action"] = Json::Value(Json::objectValue));
         auto &focusWorkspace = (action["FocusWorkspace"] = Json::Value(Json::objectValue));
         auto &reference = (focusWorkspace["reference"] = Json::Value(Json::objectValue));
-        reference["Id"] = id;
+        reference["Id"] = bound->first;
 
         IPC::send(request);
       } catch (const std::exception &e) {
@@ -168,24 +170,23 @@ Gtk::Button &Workspaces::addButton(const Json::Value &ws) {
   return button;
 }
 
-std::string Workspaces::getIcon(const std::string &value, const Json::Value &ws) {
+std::string Workspaces::getIcon(const std::string &value, const IPC::Workspace &ws) {
   const auto &icons = config_["format-icons"];
   if (!icons) return value;
 
-  if (ws["is_urgent"].asBool() && icons["urgent"]) return icons["urgent"].asString();
+  if (ws.is_urgent && icons["urgent"]) return icons["urgent"].asString();
 
-  if (ws["active_window_id"].isNull() && icons["empty"]) return icons["empty"].asString();
+  if (!ws.active_window_id && icons["empty"]) return icons["empty"].asString();
 
-  if (ws["is_focused"].asBool() && icons["focused"]) return icons["focused"].asString();
+  if (ws.is_focused && icons["focused"]) return icons["focused"].asString();
 
-  if (ws["is_active"].asBool() && icons["active"]) return icons["active"].asString();
+  if (ws.is_active && icons["active"]) return icons["active"].asString();
 
-  if (ws["name"]) {
-    const auto &name = ws["name"].asString();
-    if (icons[name]) return icons[name].asString();
+  if (ws.name) {
+    if (icons[*ws.name]) return icons[*ws.name].asString();
   }
 
-  const auto idx = ws["idx"].asString();
+  const auto idx = std::to_string(ws.idx);
   if (icons[idx]) return icons[idx].asString();
 
   if (icons["default"]) return icons["default"].asString();
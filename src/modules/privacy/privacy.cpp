@@ -1,8 +1,10 @@
 #include "modules/privacy/privacy.hpp"
 
+#include <glibmm/main.h>
 #include <json/value.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <string>
 
 #include "AModule.hpp"
@@ -21,7 +23,6 @@ Privacy::Privacy(const std::string& id, const Json::Value& config, Gtk::Orientat
       nodes_screenshare(),
       nodes_audio_in(),
       nodes_audio_out(),
-      visibility_conn(),
       box_(orientation, 0) {
   box_.set_name(name_);
 
@@ -93,118 +94,124 @@ Privacy::Privacy(const std::string& id, const Json::Value& config, Gtk::Orientat
   }
 
   backend = util::PipewireBackend::PipewireBackend::getInstance();
-  backend->privacy_nodes_changed_signal_event.connect(
-      sigc::mem_fun(*this, &Privacy::onPrivacyNodesChanged));
+  backend_conn = backend->subscribe(sigc::mem_fun(*this, &Privacy::onPrivacyNodeChanged));
 
   dp.emit();
 }
 
-void Privacy::onPrivacyNodesChanged() {
+Privacy::~Privacy() {
+  backend_conn.disconnect();
+  transition_conn_.disconnect();
+}
+
+PrivacyNodes* Privacy::nodesOf(PrivacyNodeType type) {
+  switch (type) {
+    case PRIVACY_NODE_TYPE_VIDEO_INPUT:
+      return &nodes_screenshare;
+    case PRIVACY_NODE_TYPE_AUDIO_INPUT:
+      return &nodes_audio_in;
+    case PRIVACY_NODE_TYPE_AUDIO_OUTPUT:
+      return &nodes_audio_out;
+    case PRIVACY_NODE_TYPE_NONE:
+      break;
+  }
+  return nullptr;
+}
+
+// Runs on the PipeWire thread
+void Privacy::onPrivacyNodeChanged(const PrivacyNodeSnapshot& node) {
+  const bool ignored = (ignore_monitor && node.is_monitor) ||
+                       ignore.find(std::pair(node.type, node.node_name)) != ignore.end();
+
   mutex_.lock();
-  nodes_audio_out.clear();
-  nodes_audio_in.clear();
-  nodes_screenshare.clear();
-
-  for (auto& node : backend->privacy_nodes) {
-    if (ignore_monitor && node.second->is_monitor) continue;
-
-    auto iter = ignore.find(std::pair(node.second->type, node.second->node_name));
-    if (iter != ignore.end()) continue;
-
-    switch (node.second->state) {
-      case PW_NODE_STATE_RUNNING:
-        switch (node.second->type) {
-          case PRIVACY_NODE_TYPE_VIDEO_INPUT:
-            nodes_screenshare.push_back(node.second);
-            break;
-          case PRIVACY_NODE_TYPE_AUDIO_INPUT:
-            nodes_audio_in.push_back(node.second);
-            break;
-          case PRIVACY_NODE_TYPE_AUDIO_OUTPUT:
-            nodes_audio_out.push_back(node.second);
-            break;
-          case PRIVACY_NODE_TYPE_NONE:
-            continue;
-        }
-        break;
-      default:
-        break;
+  auto* nodes = nodesOf(node.type);
+  bool changed = false;
+  if (nodes != nullptr) {
+    if (node.active && !ignored) {
+      nodes->insert_or_assign(node.id, node);
+      changed = true;
+    } else {
+      changed = nodes->erase(node.id) != 0;
     }
   }
-
+  if (changed) {
+    changed_types_.insert(node.type);
+  }
   mutex_.unlock();
-  dp.emit();
+
+  if (changed) {
+    dp.emit();
+  }
 }
 
 auto Privacy::update() -> void {
-  // set in modules or not
-  bool setScreenshare = false;
-  bool setAudioIn = false;
-  bool setAudioOut = false;
-
-  // used or not
-  bool useScreenshare = false;
-  bool useAudioIn = false;
-  bool useAudioOut = false;
-
+  // Every item from the same counts, taken once
+  bool visible = false;
   mutex_.lock();
   for (Gtk::Widget* widget : box_.get_children()) {
     auto* module = dynamic_cast<PrivacyItem*>(widget);
     if (module == nullptr) continue;
-    switch (module->privacy_type) {
-      case util::PipewireBackend::PRIVACY_NODE_TYPE_VIDEO_INPUT:
-        setScreenshare = true;
-        useScreenshare = !nodes_screenshare.empty();
-        module->set_in_use(useScreenshare);
-        break;
-      case util::PipewireBackend::PRIVACY_NODE_TYPE_AUDIO_INPUT:
-        setAudioIn = true;
-        useAudioIn = !nodes_audio_in.empty();
-        module->set_in_use(useAudioIn);
-        break;
-      case util::PipewireBackend::PRIVACY_NODE_TYPE_AUDIO_OUTPUT:
-        setAudioOut = true;
-        useAudioOut = !nodes_audio_out.empty();
-        module->set_in_use(useAudioOut);
-        break;
-      case util::PipewireBackend::PRIVACY_NODE_TYPE_NONE:
-        break;
-    }
+    const auto* nodes = nodesOf(module->privacy_type);
+    const bool in_use = nodes != nullptr && !nodes->empty();
+    module->set_in_use(in_use, changed_types_.contains(module->privacy_type));
+    visible |= in_use;
   }
+  changed_types_.clear();
   mutex_.unlock();
 
-  // Hide the whole widget if none are in use
-  bool isVisible = (setScreenshare && useScreenshare) || (setAudioIn && useAudioIn) ||
-                   (setAudioOut && useAudioOut);
-
-  if (isVisible != event_box_.get_visible()) {
-    // Disconnect any previous connection so that it doesn't get activated in
-    // the future, hiding the module when it should be visible
-    visibility_conn.disconnect();
-    if (isVisible) {
-      event_box_.set_visible(true);
-    } else {
-      // Hides the widget when all of the privacy_item revealers animations
-      // have finished animating
-      visibility_conn = Glib::signal_timeout().connect(
-          sigc::track_obj(
-              [this, setScreenshare, setAudioOut, setAudioIn]() {
-                mutex_.lock();
-                bool visible = false;
-                visible |= setScreenshare && !nodes_screenshare.empty();
-                visible |= setAudioIn && !nodes_audio_in.empty();
-                visible |= setAudioOut && !nodes_audio_out.empty();
-                mutex_.unlock();
-                event_box_.set_visible(visible);
-                return false;
-              },
-              *this),
-          transition_duration);
-    }
+  if (visible) {
+    hide_due_.reset();
+    event_box_.set_visible(true);
+  } else if (event_box_.get_visible() && !hide_due_) {
+    // Hides the widget when all of the privacy_item revealers animations have finished animating
+    hide_due_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(transition_duration);
   }
+  scheduleTransitions();
 
   // Call parent update
   AModule::update();
 }
 
+void Privacy::scheduleTransitions() {
+  std::optional<std::chrono::steady_clock::time_point> due = hide_due_;
+  for (Gtk::Widget* widget : box_.get_children()) {
+    auto* module = dynamic_cast<PrivacyItem*>(widget);
+    if (module != nullptr && module->transition_due && (!due || *module->transition_due < *due)) {
+      due = module->transition_due;
+    }
+  }
+  if (transition_conn_.connected() && due == transition_at_) {
+    return;
+  }
+  transition_conn_.disconnect();
+  transition_at_ = due;
+  if (!due) {
+    return;
+  }
+  const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      *due - std::chrono::steady_clock::now());
+  transition_conn_ = Glib::signal_timeout().connect(
+      [this] {
+        onTransitionsDue();
+        return false;
+      },
+      static_cast<unsigned>(std::max<int64_t>(delay.count(), 0)));
+}
+
+void Privacy::onTransitionsDue() {
+  const auto now = std::chrono::steady_clock::now();
+  for (Gtk::Widget* widget : box_.get_children()) {
+    auto* module = dynamic_cast<PrivacyItem*>(widget);
+    if (module != nullptr && module->transition_due && *module->transition_due <= now) {
+      module->finish_transition();
+    }
+  }
+  if (hide_due_ && *hide_due_ <= now) {
+    hide_due_.reset();
+    event_box_.set_visible(false);
+  }
+  transition_at_.reset();
+  scheduleTransitions();
+}
+
 }  // namespace waybar::modules::privacy
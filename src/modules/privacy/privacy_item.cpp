@@ -4,7 +4,6 @@
 
 #include <string>
 
-#include "glibmm/main.h"
 #include "gtkmm/label.h"
 #include "gtkmm/revealer.h"
 #include "gtkmm/tooltip.h"
@@ -13,13 +12,12 @@
 namespace waybar::modules::privacy {
 
 PrivacyItem::PrivacyItem(const Json::Value &config_, enum PrivacyNodeType privacy_type_,
-                         std::list<PrivacyNodeInfo *> *nodes_, Gtk::Orientation orientation,
+                         const PrivacyNodes *nodes_, Gtk::Orientation orientation,
                          const std::string &pos, const uint icon_size,
                          const uint transition_duration)
     : Gtk::Revealer(),
       privacy_type(privacy_type_),
       nodes(nodes_),
-      signal_conn(),
       tooltip_window(Gtk::ORIENTATION_VERTICAL, 0),
       box_(Gtk::ORIENTATION_HORIZONTAL, 0),
       icon_() {
@@ -103,17 +101,17 @@ void PrivacyItem::update_tooltip() {
     // work differently in GTK4.
     delete child;
   }
-  for (auto *node : *nodes) {
+  for (const auto &[id, node] : *nodes) {
     auto *box = Gtk::make_managed<Gtk::Box>(Gtk::ORIENTATION_HORIZONTAL, 4);
 
     // Set device icon
     auto *node_icon = Gtk::make_managed<Gtk::Image>();
     node_icon->set_pixel_size(tooltipIconSize);
-    node_icon->set_from_icon_name(node->getIconName(), Gtk::ICON_SIZE_INVALID);
+    node_icon->set_from_icon_name(node.icon_name, Gtk::ICON_SIZE_INVALID);
     box->add(*node_icon);
 
     // Set model
-    auto *nodeName = Gtk::make_managed<Gtk::Label>(node->getName());
+    auto *nodeName = Gtk::make_managed<Gtk::Label>(node.name);
     box->add(*nodeName);
 
     tooltip_window.add(*box);
@@ -122,18 +120,14 @@ void PrivacyItem::update_tooltip() {
   tooltip_window.show_all();
 }
 
-void PrivacyItem::set_in_use(bool in_use) {
-  if (in_use) {
+void PrivacyItem::set_in_use(bool in_use, bool nodes_changed) {
+  if (in_use && nodes_changed) {
     update_tooltip();
   }
 
   if (this->in_use == in_use && init) return;
 
   if (init) {
-    // Disconnect any previous connection so that it doesn't get activated in
-    // the future, hiding the module when it should be visible
-    signal_conn.disconnect();
-
     this->in_use = in_use;
     guint duration = 0;
     if (this->in_use) {
@@ -142,18 +136,7 @@ void PrivacyItem::set_in_use(bool in_use) {
       set_reveal_child(false);
       duration = get_transition_duration();
     }
-
-    signal_conn = Glib::signal_timeout().connect(sigc::track_obj(
-                                                     [this] {
-                                                       if (this->in_use) {
-                                                         set_reveal_child(true);
-                                                       } else {
-                                                         set_visible(false);
-                                                       }
-                                                       return false;
-                                                     },
-                                                     *this),
-                                                 duration);
+    transition_due = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration);
   } else {
     set_visible(false);
     set_reveal_child(false);
@@ -161,4 +144,13 @@ void PrivacyItem::set_in_use(bool in_use) {
   this->init = true;
 }
 
+void PrivacyItem::finish_transition() {
+  transition_due.reset();
+  if (this->in_use) {
+    set_reveal_child(true);
+  } else {
+    set_visible(false);
+  }
+}
+
 }  // namespace waybar::modules::privacy
@@ -1,14 +1,20 @@
 #include "modules/pulseaudio.hpp"
 
+#include <cstdlib>
+
 waybar::modules::Pulseaudio::Pulseaudio(const std::string &id, const Json::Value &config)
-    : ALabel(config, "pulseaudio", id, "{volume}%") {
+    : ALabel(config, "pulseaudio", id, "{volume}%"),
+      scroll_{event_box_, [this](int steps) { applyScroll(steps); }} {
   event_box_.add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
   event_box_.signal_scroll_event().connect(sigc::mem_fun(*this, &Pulseaudio::handleScroll));
 
-  backend = util::AudioBackend::getInstance([this] { this->dp.emit(); });
-  backend->setIgnoredSinks(config_["ignored-sinks"]);
+  backend = util::AudioBackend::getInstance(config_["ignored-sinks"]);
+  subscription_ = backend->subscribe([this] { this->dp.emit(); });
+  dp.emit();
 }
 
+waybar::modules::Pulseaudio::~Pulseaudio() { backend->unsubscribe(subscription_); }
+
 bool waybar::modules::Pulseaudio::handleScroll(GdkEventScroll *e) {
   // change the pulse volume only when no user provided
   // events are configured
@@ -19,6 +25,11 @@ bool waybar::modules::Pulseaudio::handleScroll(GdkEventScroll *e) {
   if (dir == SCROLL_DIR::NONE) {
     return true;
   }
+  scroll_.add((dir == SCROLL_DIR::UP || dir == SCROLL_DIR::RIGHT) ? 1 : -1);
+  return true;
+}
+
+void waybar::modules::Pulseaudio::applyScroll(int steps) {
   int max_volume = 100;
   double step = 1;
   // isDouble returns true for integers as well, just in case
@@ -29,12 +40,9 @@ bool waybar::modules::Pulseaudio::handleScroll(GdkEventScroll *e) {
     max_volume = config_["max-volume"].asInt();
   }
 
-  auto change_type = (dir == SCROLL_DIR::UP || dir == SCROLL_DIR::RIGHT)
-                         ? util::ChangeType::Increase
-                         : util::ChangeType::Decrease;
+  auto change_type = steps > 0 ? util::ChangeType::Increase : util::ChangeType::Decrease;
 
-  backend->changeVolume(change_type, step, max_volume);
-  return true;
+  backend->changeVolume(change_type, step * std::abs(steps), max_volume);
 }
 
 static const std::array<std::string, 9> ports = {
@@ -4,8 +4,8 @@ namespace waybar::modules {
 
 PulseaudioSlider::PulseaudioSlider(const std::string& id, const Json::Value& config)
     : ASlider(config, "pulseaudio-slider", id) {
-  backend = util::AudioBackend::getInstance([this] { this->dp.emit(); });
-  backend->setIgnoredSinks(config_["ignored-sinks"]);
+  backend = util::AudioBackend::getInstance(config_["ignored-sinks"]);
+  subscription_ = backend->subscribe([this] { this->dp.emit(); });
 
   if (config_["target"].isString()) {
     std::string target = config_["target"].asString();
@@ -15,23 +15,26 @@ PulseaudioSlider::PulseaudioSlider(const std::string& id, const Json::Value& con
       this->target = PulseaudioSliderTarget::Source;
     }
   }
+  dp.emit();
 }
 
+PulseaudioSlider::~PulseaudioSlider() { backend->unsubscribe(subscription_); }
+
 void PulseaudioSlider::update() {
   switch (target) {
     case PulseaudioSliderTarget::Sink:
       if (backend->getSinkMuted()) {
-        scale_.set_value(min_);
+        setValue(min_);
       } else {
-        scale_.set_value(backend->getSinkVolume());
+        setValue(backend->getSinkVolume());
       }
       break;
 
     case PulseaudioSliderTarget::Source:
       if (backend->getSourceMuted()) {
-        scale_.set_value(min_);
+        setValue(min_);
       } else {
-        scale_.set_value(backend->getSourceVolume());
+        setValue(backend->getSourceVolume());
       }
       break;
   }
@@ -0,0 +1,229 @@
+#include "modules/river/status.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "client.hpp"
+
+namespace waybar::modules::river {
+
+static void listen_focused_tags(void *data, struct zriver_output_status_v1 *zriver_output_status_v1,
+                                uint32_t tags) {
+  auto *status = static_cast<Status::OutputStatus *>(data);
+  status->state.focused_tags = tags;
+  status->owner->handleOutputChange(*status, Status::Change::Tags);
+}
+
+static void listen_view_tags(void *data, struct zriver_output_status_v1 *zriver_output_status_v1,
+                             struct wl_array *view_tags) {
+  auto *status = static_cast<Status::OutputStatus *>(data);
+  uint32_t tags = 0;
+  auto view_tag = reinterpret_cast<uint32_t *>(view_tags->data);
+  auto end = view_tag + (view_tags->size / sizeof(uint32_t));
+  for (; view_tag < end; ++view_tag) {
+    tags |= *view_tag;
+  }
+  status->state.view_tags = tags;
+  status->owner->handleOutputChange(*status, Status::Change::Tags);
+}
+
+static void listen_urgent_tags(void *data, struct zriver_output_status_v1 *zriver_output_status_v1,
+                               uint32_t tags) {
+  auto *status = static_cast<Status::OutputStatus *>(data);
+  status->state.urgent_tags = tags;
+  status->owner->handleOutputChange(*status, Status::Change::Tags);
+}
+
+static void listen_layout_name(void *data, struct zriver_output_status_v1 *zriver_output_status_v1,
+                               const char *layout) {
+  auto *status = static_cast<Status::OutputStatus *>(data);
+  status->state.layout = layout;
+  status->owner->handleOutputChange(*status, Status::Change::Layout);
+}
+
+static void listen_layout_name_clear(void *data,
+                                     struct zriver_output_status_v1 *zriver_output_status_v1) {
+  auto *status = static_cast<Status::OutputStatus *>(data);
+  status->state.layout.reset();
+  status->owner->handleOutputChange(*status, Status::Change::Layout);
+}
+
+static const zriver_output_status_v1_listener output_status_listener_impl{
+    .focused_tags = listen_focused_tags,
+    .view_tags = listen_view_tags,
+    .urgent_tags = listen_urgent_tags,
+    .layout_name = listen_layout_name,
+    .layout_name_clear = listen_layout_name_clear,
+};
+
+static void listen_focused_output(void *data, struct zriver_seat_status_v1 *zriver_seat_status_v1,
+                                  struct wl_output *output) {
+  static_cast<Status *>(data)->handleFocusedOutput(output);
+}
+
+static void listen_unfocused_output(void *data, struct zriver_seat_status_v1 *zriver_seat_status_v1,
+                                    struct wl_output *output) {
+  static_cast<Status *>(data)->handleUnfocusedOutput(output);
+}
+
+static void listen_focused_view(void *data, struct zriver_seat_status_v1 *zriver_seat_status_v1,
+                                const char *title) {
+  static_cast<Status *>(data)->handleFocusedView(title);
+}
+
+static void listen_mode(void *data, struct zriver_seat_status_v1 *zriver_seat_status_v1,
+                        const char *mode) {
+  static_cast<Status *>(data)->handleMode(mode);
+}
+
+static const zriver_seat_status_v1_listener seat_status_listener_impl{
+    .focused_output = listen_focused_output,
+    .unfocused_output = listen_unfocused_output,
+    .focused_view = listen_focused_view,
+    .mode = listen_mode,
+};
+
+static void handle_global(void *data, struct wl_registry *registry, uint32_t name,
+                          const char *interface, uint32_t version) {
+  auto *status = static_cast<Status *>(data);
+  if (std::strcmp(interface, zriver_status_manager_v1_interface.name) == 0) {
+    // The highest version any module uses: 4 for the layout names
+    status->version_ = std::min(version, 4u);
+    status->manager_ = static_cast<struct zriver_status_manager_v1 *>(
+        wl_registry_bind(registry, name, &zriver_status_manager_v1_interface, status->version_));
+  }
+
+  if (std::strcmp(interface, zriver_control_v1_interface.name) == 0) {
+    version = std::min(version, 1u);
+    status->control_ = static_cast<struct zriver_control_v1 *>(
+        wl_registry_bind(registry, name, &zriver_control_v1_interface, version));
+  }
+
+  if (std::strcmp(interface, wl_seat_interface.name) == 0 && status->seat_ == nullptr) {
+    version = std::min(version, 1u);
+    status->seat_ = static_cast<struct wl_seat *>(
+        wl_registry_bind(registry, name, &wl_seat_interface, version));
+  }
+}
+
+static void handle_global_remove(void *data, struct wl_registry *registry, uint32_t name) {
+  /* Ignore event */
+}
+
+static const wl_registry_listener registry_listener_impl = {.global = handle_global,
+                                                            .global_remove = handle_global_remove};
+
+Status::Status() {
+  struct wl_display *display = Client::inst()->wl_display;
+  struct wl_registry *registry = wl_display_get_registry(display);
+  wl_registry_add_listener(registry, &registry_listener_impl, this);
+  wl_display_roundtrip(display);
+  wl_registry_destroy(registry);
+
+  if (manager_ == nullptr) {
+    spdlog::error("river_status_manager_v1 not advertised");
+    return;
+  }
+
+  if (seat_ == nullptr) {
+    spdlog::error("wl_seat not advertised");
+    return;
+  }
+
+  seat_status_ = zriver_status_manager_v1_get_river_seat_status(manager_, seat_);
+  zriver_seat_status_v1_add_listener(seat_status_, &seat_status_listener_impl, this);
+}
+
+Status::~Status() {
+  for (const auto &output : outputs_) {
+    zriver_output_status_v1_destroy(output->status);
+  }
+  if (seat_status_) {
+    zriver_seat_status_v1_destroy(seat_status_);
+  }
+  if (control_) {
+    zriver_control_v1_destroy(control_);
+  }
+  if (manager_) {
+    zriver_status_manager_v1_destroy(manager_);
+  }
+  if (seat_) {
+    wl_seat_destroy(seat_);
+  }
+}
+
+int Status::subscribe(struct wl_output *output, Handler on_change) {
+  if (output != nullptr && manager_ != nullptr &&
+      std::ranges::none_of(outputs_, [output](const auto &o) { return o->output == output; })) {
+    auto &status = outputs_.emplace_back(std::make_unique<OutputStatus>(OutputStatus{
+        this, output, zriver_status_manager_v1_get_river_output_status(manager_, output), {}}));
+    zriver_output_status_v1_add_listener(status->status, &output_status_listener_impl,
+                                         status.get());
+  }
+  subscribers_.push_back({next_subscriber_id_, output, std::move(on_change)});
+  return next_subscriber_id_++;
+}
+
+void Status::unsubscribe(int id) {
+  auto it = std::ranges::find(subscribers_, id, &Subscriber::id);
+  if (it == subscribers_.end()) {
+    return;
+  }
+  auto *output = it->output;
+  subscribers_.erase(it);
+  // The status of an output goes with its last subscriber, the output may be gone for good
+  if (output != nullptr &&
+      std::ranges::none_of(subscribers_, [output](const auto &s) { return s.output == output; })) {
+    std::erase_if(outputs_, [output](const auto &o) {
+      if (o->output != output) {
+        return false;
+      }
+      zriver_output_status_v1_destroy(o->status);
+      return true;
+    });
+  }
+}
+
+const Status::Output &Status::output(struct wl_output *output) const {
+  static const Output none;
+  auto it = std::ranges::find(outputs_, output, [](const auto &o) { return o->output; });
+  return it != outputs_.end() ? (*it)->state : none;
+}
+
+void Status::emit(Change change, struct wl_output *output) {
+  for (const auto &subscriber : subscribers_) {
+    if (output == nullptr || subscriber.output == output) {
+      subscriber.on_change(change);
+    }
+  }
+}
+
+void Status::handleFocusedOutput(struct wl_output *output) {
+  focused_output_ = output;
+  emit(Change::FocusedOutput, nullptr);
+}
+
+void Status::handleUnfocusedOutput(struct wl_output *output) {
+  if (focused_output_ == output) {
+    focused_output_ = nullptr;
+    emit(Change::FocusedOutput, nullptr);
+  }
+}
+
+void Status::handleFocusedView(const char *title) {
+  focused_view_ = title;
+  emit(Change::FocusedView, nullptr);
+}
+
+void Status::handleMode(const char *mode) {
+  mode_ = mode;
+  emit(Change::Mode, nullptr);
+}
+
+void Status::handleOutputChange(OutputStatus &status, Change change) {
+  emit(change, status.output);
+}
+
+}  // namespace waybar::modules::river
@@ -2,16 +2,14 @@
 
 #include <time.h>
 
+#include "util/time_format.hpp"
+
 waybar::modules::Clock::Clock(const std::string& id, const Json::Value& config)
     : ALabel(config, "clock", id, "{:%H:%M}", 60) {
-  thread_ = [this] {
-    dp.emit();
-    auto now = std::chrono::system_clock::now();
-    /* difference with projected wakeup time */
-    auto diff = now.time_since_epoch() % interval_;
-    /* sleep until the next projected time */
-    thread_.sleep_for(interval_ - diff);
-  };
+  /* the scheduler aligns the ticks to multiples of the period, the full minute without seconds */
+  const auto period = util::clockPeriod(
+      interval_, {format_, config_["format-alt"].asString(), config_["tooltip-format"].asString()});
+  timer_.start(period, [this] { dp.emit(); }, period);
 }
 
 auto waybar::modules::Clock::update() -> void {
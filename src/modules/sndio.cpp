@@ -37,7 +37,8 @@ auto Sndio::connect_to_sndio() -> void {
     throw std::runtime_error("sioctl_onval() failed.");
   }
 
-  pfds_.reserve(sioctl_nfds(hdl_));
+  // and one more for the stop fd of the thread
+  pfds_.resize(sioctl_nfds(hdl_) + 1);
 }
 
 Sndio::Sndio(const std::string &id, const Json::Value &config)
@@ -48,7 +49,8 @@ Sndio::Sndio(const std::string &id, const Json::Value &config)
       volume_(0),
       old_volume_(0),
       maxval_(0),
-      muted_(false) {
+      muted_(false),
+      scroll_{event_box_, [this](int steps) { applyScroll(steps); }} {
   connect_to_sndio();
 
   event_box_.show();
@@ -64,11 +66,15 @@ Sndio::Sndio(const std::string &id, const Json::Value &config)
     if (nfds == 0) {
       throw std::runtime_error("sioctl_pollfd() failed.");
     }
-    while (poll(pfds_.data(), nfds, -1) < 0) {
+    pfds_[nfds] = {.fd = thread_.stopFd(), .events = POLLIN, .revents = 0};
+    while (poll(pfds_.data(), nfds + 1, -1) < 0) {
       if (errno != EINTR) {
         throw std::runtime_error("poll() failed.");
       }
     }
+    if (pfds_[nfds].revents != 0) {
+      return;
+    }
 
     int revents = sioctl_revents(hdl_, pfds_.data());
     if (revents & POLLHUP) {
@@ -98,7 +104,14 @@ Sndio::Sndio(const std::string &id, const Json::Value &config)
   };
 }
 
-Sndio::~Sndio() { sioctl_close(hdl_); }
+Sndio::~Sndio() {
+  // the thread polls hdl_
+  thread_.stop();
+  thread_.join();
+  if (hdl_) {
+    sioctl_close(hdl_);
+  }
+}
 
 auto Sndio::update() -> void {
   auto format = format_;
@@ -151,9 +164,17 @@ bool Sndio::handleScroll(GdkEventScroll *e) {
   if (hdl_ == nullptr) return true;
 
   auto dir = AModule::getScrollDir(e);
-  if (dir == SCROLL_DIR::NONE) {
-    return true;
+  if (dir == SCROLL_DIR::UP) {
+    scroll_.add(1);
+  } else if (dir == SCROLL_DIR::DOWN) {
+    scroll_.add(-1);
   }
+  return true;
+}
+
+void Sndio::applyScroll(int steps) {
+  // the connection may be gone since the scroll
+  if (hdl_ == nullptr) return;
 
   int step = 5;
   if (config_["scroll-step"].isInt()) {
@@ -165,19 +186,13 @@ bool Sndio::handleScroll(GdkEventScroll *e) {
     new_volume = old_volume_;
   }
 
-  if (dir == SCROLL_DIR::UP) {
-    new_volume += step;
-  } else if (dir == SCROLL_DIR::DOWN) {
-    new_volume -= step;
-  }
+  new_volume += step * steps;
   new_volume = std::clamp(new_volume, 0, static_cast<int>(maxval_));
 
   // quits muted mode if volume changes
   muted_ = false;
 
   sioctl_setval(hdl_, addr_, new_volume);
-
-  return true;
 }
 
 bool Sndio::handleToggle(GdkEventButton *const &e) {
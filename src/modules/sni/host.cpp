@@ -2,22 +2,18 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "util/scope_guard.hpp"
 
 namespace waybar::modules::SNI {
 
-Host::Host(const std::size_t id, const Json::Value& config, const Bar& bar,
-           const std::function<void(std::unique_ptr<Item>&)>& on_add,
-           const std::function<void(std::unique_ptr<Item>&)>& on_remove)
-    : bus_name_("org.kde.StatusNotifierHost-" + std::to_string(getpid()) + "-" +
-                std::to_string(id)),
-      object_path_("/StatusNotifierHost/" + std::to_string(id)),
+Host::Host()
+    : bus_name_("org.kde.StatusNotifierHost-" + std::to_string(getpid())),
+      object_path_("/StatusNotifierHost"),
       bus_name_id_(Gio::DBus::own_name(Gio::DBus::BusType::BUS_TYPE_SESSION, bus_name_,
-                                       sigc::mem_fun(*this, &Host::busAcquired))),
-      config_(config),
-      bar_(bar),
-      on_add_(on_add),
-      on_remove_(on_remove) {}
+                                       sigc::mem_fun(*this, &Host::busAcquired))) {}
 
 Host::~Host() {
   if (bus_name_id_ > 0) {
@@ -30,9 +26,24 @@ Host::~Host() {
   }
   g_cancellable_cancel(cancellable_);
   g_clear_object(&cancellable_);
+  if (watcher_ != nullptr) {
+    g_signal_handlers_disconnect_by_data(watcher_, this);
+  }
   g_clear_object(&watcher_);
 }
 
+int Host::subscribe(ItemHandler on_add, ItemHandler on_remove) {
+  for (const auto& item : items_) {
+    on_add(item);
+  }
+  subscribers_.push_back({next_subscriber_id_, std::move(on_add), std::move(on_remove)});
+  return next_subscriber_id_++;
+}
+
+void Host::unsubscribe(int id) {
+  std::erase_if(subscribers_, [id](const auto& subscriber) { return subscriber.id == id; });
+}
+
 void Host::busAcquired(const Glib::RefPtr<Gio::DBus::Connection>& conn, Glib::ustring name) {
   watcher_id_ = Gio::DBus::watch_name(conn, "org.kde.StatusNotifierWatcher",
                                       sigc::mem_fun(*this, &Host::nameAppeared),
@@ -53,8 +64,13 @@ void Host::nameAppeared(const Glib::RefPtr<Gio::DBus::Connection>& conn, const G
 void Host::nameVanished(const Glib::RefPtr<Gio::DBus::Connection>& conn, const Glib::ustring name) {
   g_cancellable_cancel(cancellable_);
   g_clear_object(&cancellable_);
+  if (watcher_ != nullptr) {
+    g_signal_handlers_disconnect_by_data(watcher_, this);
+  }
   g_clear_object(&watcher_);
-  items_.clear();
+  while (!items_.empty()) {
+    removeItem(items_.end() - 1);
+  }
 }
 
 void Host::proxyReady(GObject* src, GAsyncResult* res, gpointer data) {
@@ -117,13 +133,21 @@ void Host::itemUnregistered(SnWatcher* watcher, const gchar* service, gpointer d
   auto [bus_name, object_path] = host->getBusNameAndObjectPath(service);
   for (auto it = host->items_.begin(); it != host->items_.end(); ++it) {
     if ((*it)->bus_name == bus_name && (*it)->object_path == object_path) {
-      host->on_remove_(*it);
-      host->items_.erase(it);
+      host->removeItem(it);
       break;
     }
   }
 }
 
+void Host::removeItem(std::vector<std::shared_ptr<ItemState>>::iterator it) {
+  // the trays drop their views first, the state goes with the last reference
+  auto item = *it;
+  items_.erase(it);
+  for (const auto& subscriber : subscribers_) {
+    subscriber.on_remove(item);
+  }
+}
+
 std::tuple<std::string, std::string> Host::getBusNameAndObjectPath(const std::string service) {
   auto it = service.find('/');
   if (it != std::string::npos) {
@@ -139,8 +163,10 @@ void Host::addRegisteredItem(std::string service) {
     return bus_name == item->bus_name && object_path == item->object_path;
   });
   if (it == items_.end()) {
-    items_.emplace_back(new Item(bus_name, object_path, config_, bar_));
-    on_add_(items_.back());
+    items_.push_back(std::make_shared<ItemState>(bus_name, object_path));
+    for (const auto& subscriber : subscribers_) {
+      subscriber.on_add(items_.back());
+    }
   }
 }
 
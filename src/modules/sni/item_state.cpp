@@ -0,0 +1,394 @@
+#include "modules/sni/item_state.hpp"
+
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "modules/sni/icon_manager.hpp"
+#include "util/format.hpp"
+
+template <>
+struct fmt::formatter<Glib::VariantBase> : formatter<std::string> {
+  bool is_printable(const Glib::VariantBase& value) const {
+    auto type = value.get_type_string();
+    /* Print only primitive (single character excluding 'v') and short complex types */
+    return (type.length() == 1 && islower(type[0]) && type[0] != 'v') || value.get_size() <= 32;
+  }
+
+  template <typename FormatContext>
+  auto format(const Glib::VariantBase& value, FormatContext& ctx) const {
+    if (is_printable(value)) {
+      return formatter<std::string>::format(static_cast<std::string>(value.print()), ctx);
+    } else {
+      return formatter<std::string>::format(value.get_type_string(), ctx);
+    }
+  }
+};
+
+namespace waybar::modules::SNI {
+
+static const Glib::ustring SNI_INTERFACE_NAME = sn_item_interface_info()->name;
+static const unsigned UPDATE_DEBOUNCE_TIME = 10;
+
+ItemState::ItemState(const std::string& bn, const std::string& op)
+    : bus_name(bn), object_path(op), icon_theme(Gtk::IconTheme::create()) {
+  cancellable_ = Gio::Cancellable::create();
+
+  auto interface = Glib::wrap(sn_item_interface_info(), true);
+  Gio::DBus::Proxy::create_for_bus(Gio::DBus::BusType::BUS_TYPE_SESSION, bus_name, object_path,
+                                   SNI_INTERFACE_NAME, sigc::mem_fun(*this, &ItemState::proxyReady),
+                                   cancellable_, interface);
+}
+
+void ItemState::proxyReady(Glib::RefPtr<Gio::AsyncResult>& result) {
+  try {
+    this->proxy_ = Gio::DBus::Proxy::create_for_bus_finish(result);
+    /* Properties are already cached during object creation */
+    auto cached_properties = this->proxy_->get_cached_property_names();
+    for (const auto& name : cached_properties) {
+      Glib::VariantBase value;
+      this->proxy_->get_cached_property(value, name);
+      changed(name, value);
+      setProperty(name, value);
+    }
+
+    this->proxy_->signal_signal().connect(sigc::mem_fun(*this, &ItemState::onSignal));
+
+    if (!valid()) {
+      spdlog::error("Invalid Status Notifier Item: {}, {}", bus_name, object_path);
+    }
+  } catch (const Glib::Error& err) {
+    spdlog::error("Failed to create DBus Proxy for {} {}: {}", bus_name, object_path, err.what());
+  } catch (const std::exception& err) {
+    spdlog::error("Failed to create DBus Proxy for {} {}: {}", bus_name, object_path, err.what());
+  }
+  ready_ = true;
+  signal_changed.emit();
+}
+
+void ItemState::wantIconHeight(int height) {
+  if (height <= wanted_height_) {
+    return;
+  }
+  wanted_height_ = height;
+  if (proxy_ && pixmap_height_ != 0) {
+    // the pixmap was scaled down for smaller icons, get it again for these
+    property_hashes_.erase("IconPixmap");
+    requestUpdate({"IconPixmap"});
+    pixmap_hash_ = 0;
+  }
+}
+
+void ItemState::call(const Glib::ustring& method, const Glib::VariantContainerBase& parameters) {
+  if (proxy_) {
+    proxy_->call(method, parameters);
+  }
+}
+
+template <typename T>
+T get_variant(const Glib::VariantBase& value) {
+  return Glib::VariantBase::cast_dynamic<Glib::Variant<T>>(value).get();
+}
+
+template <>
+ToolTip get_variant<ToolTip>(const Glib::VariantBase& value) {
+  ToolTip result;
+  // Unwrap (sa(iiay)ss)
+  auto container = value.cast_dynamic<Glib::VariantContainerBase>(value);
+  result.icon_name = get_variant<Glib::ustring>(container.get_child(0));
+  result.text = get_variant<Glib::ustring>(container.get_child(2));
+  auto description = get_variant<Glib::ustring>(container.get_child(3));
+  if (!description.empty()) {
+    auto escapedDescription = Glib::Markup::escape_text(description);
+    result.text = fmt::format("<b>{}</b>\n{}", result.text, escapedDescription);
+  }
+  return result;
+}
+
+void ItemState::setProperty(const Glib::ustring& name, Glib::VariantBase& value) {
+  try {
+    spdlog::trace("Set tray item property: {}.{} = {}", id.empty() ? bus_name : id, name, value);
+
+    if (name == "Category") {
+      category = get_variant<std::string>(value);
+    } else if (name == "Id") {
+      id = get_variant<std::string>(value);
+
+      /*
+       * HACK: Electron apps seem to have the same ID, but tooltip seems correct, so use that as ID
+       * to pass as the custom icon option. I'm avoiding being disruptive and setting that to the ID
+       * itself as I've no idea what this would affect.
+       * The tooltip text is converted to lowercase since that's what (most?) themes expect?
+       * I still haven't found a way for it to pick from theme automatically, although
+       * it might be my theme.
+       */
+      if (id == "chrome_status_icon_1") {
+        Glib::VariantBase value;
+        this->proxy_->get_cached_property(value, "ToolTip");
+        tooltip = get_variant<ToolTip>(value);
+        if (!tooltip.text.empty()) {
+          setCustomIcon(tooltip.text.lowercase());
+        }
+      } else {
+        setCustomIcon(id);
+      }
+    } else if (name == "Title") {
+      title = get_variant<std::string>(value);
+    } else if (name == "Status") {
+      setStatus(get_variant<Glib::ustring>(value));
+    } else if (name == "IconName") {
+      auto new_icon_name = get_variant<std::string>(value);
+      if (new_icon_name != icon_name) {
+        icon_name = std::move(new_icon_name);
+        ++icon_revision_;
+      }
+    } else if (name == "IconPixmap") {
+      // apps often send NewIcon with the same pixmaps, only decode new ones
+      const auto hash = std::hash<std::string_view>{}(
+          {static_cast<const char*>(g_variant_get_data(value.gobj())), value.get_size()});
+      if (hash != pixmap_hash_ || pixmap_height_ != wanted_height_) {
+        icon_pixmap = this->extractPixBuf(value.gobj());
+        pixmap_hash_ = hash;
+        ++icon_revision_;
+      }
+    } else if (name == "OverlayIconName") {
+      overlay_icon_name = get_variant<std::string>(value);
+    } else if (name == "OverlayIconPixmap") {
+      // TODO: overlay_icon_pixmap
+    } else if (name == "AttentionIconName") {
+      attention_icon_name = get_variant<std::string>(value);
+    } else if (name == "AttentionIconPixmap") {
+      // TODO: attention_icon_pixmap
+    } else if (name == "AttentionMovieName") {
+      attention_movie_name = get_variant<std::string>(value);
+    } else if (name == "ToolTip") {
+      tooltip = get_variant<ToolTip>(value);
+    } else if (name == "IconThemePath") {
+      auto new_icon_theme_path = get_variant<std::string>(value);
+      if (new_icon_theme_path != icon_theme_path) {
+        icon_theme_path = std::move(new_icon_theme_path);
+        if (!icon_theme_path.empty()) {
+          icon_theme->set_search_path({icon_theme_path});
+        }
+        ++icon_revision_;
+      }
+    } else if (name == "Menu") {
+      menu = get_variant<std::string>(value);
+    } else if (name == "ItemIsMenu") {
+      item_is_menu = get_variant<bool>(value);
+    }
+  } catch (const Glib::Error& err) {
+    spdlog::warn("Failed to set tray item property: {}.{}, value = {}, err = {}",
+                 id.empty() ? bus_name : id, name, value, err.what());
+  } catch (const std::exception& err) {
+    spdlog::warn("Failed to set tray item property: {}.{}, value = {}, err = {}",
+                 id.empty() ? bus_name : id, name, value, err.what());
+  }
+}
+
+void ItemState::setStatus(const Glib::ustring& value) {
+  Glib::ustring lower = value.lowercase();
+  if (lower.compare("needsattention") == 0) {
+    // convert status to dash-case for CSS
+    lower = "needs-attention";
+  }
+  status = lower;
+  // symbolic icons are colored after the style
+  ++icon_revision_;
+}
+
+void ItemState::setCustomIcon(const std::string& id) {
+  spdlog::debug("SNI tray id: {}", id);
+
+  std::string custom_icon = IconManager::instance().getIconForApp(id);
+  if (!custom_icon.empty()) {
+    if (std::filesystem::exists(custom_icon)) {
+      Glib::RefPtr<Gdk::Pixbuf> custom_pixbuf = Gdk::Pixbuf::create_from_file(custom_icon);
+      icon_name = "";  // icon_name has priority over pixmap
+      icon_pixmap = custom_pixbuf;
+      pixmap_height_ = 0;
+      pixmap_hash_ = 0;
+    } else {  // if file doesn't exist it's most likely an icon_name
+      icon_name = custom_icon;
+    }
+    ++icon_revision_;
+  }
+}
+
+void ItemState::requestUpdate(const std::set<std::string_view>& properties) {
+  /* Debounce signals and schedule update of all properties.
+   * Based on behavior of Plasma dataengine for StatusNotifierItem.
+   * While a GetAll is on its way, the properties wait for its reply, as it may predate them.
+   */
+  if (update_pending_.empty() && update_fetching_.empty()) {
+    Glib::signal_timeout().connect_once(sigc::mem_fun(*this, &ItemState::getUpdatedProperties),
+                                        UPDATE_DEBOUNCE_TIME);
+  }
+  update_pending_.insert(properties.begin(), properties.end());
+}
+
+bool ItemState::changed(const Glib::ustring& name, const Glib::VariantBase& value) {
+  const auto hash = std::hash<std::string_view>{}(
+      {static_cast<const char*>(g_variant_get_data(value.gobj())), value.get_size()});
+  auto [it, inserted] = property_hashes_.try_emplace(name.raw(), hash);
+  if (inserted) {
+    return true;
+  }
+  return std::exchange(it->second, hash) != hash;
+}
+
+void ItemState::getUpdatedProperties() {
+  update_fetching_ = std::move(update_pending_);
+  update_pending_.clear();
+  auto params = Glib::VariantContainerBase::create_tuple(
+      {Glib::Variant<Glib::ustring>::create(SNI_INTERFACE_NAME)});
+  proxy_->call("org.freedesktop.DBus.Properties.GetAll",
+               sigc::mem_fun(*this, &ItemState::processUpdatedProperties), params);
+};
+
+void ItemState::processUpdatedProperties(Glib::RefPtr<Gio::AsyncResult>& _result) {
+  try {
+    auto result = proxy_->call_finish(_result);
+    // extract "a{sv}" from VariantContainerBase
+    Glib::Variant<std::map<Glib::ustring, Glib::VariantBase>> properties_variant;
+    result.get_child(properties_variant);
+    auto properties = properties_variant.get();
+
+    bool any_changed = false;
+    for (const auto& [name, value] : properties) {
+      // only the properties a signal was about, and that really changed
+      if (update_fetching_.count(name.raw()) && changed(name, value)) {
+        setProperty(name, const_cast<Glib::VariantBase&>(value));
+        any_changed = true;
+      }
+    }
+
+    if (any_changed) {
+      signal_changed.emit();
+    }
+  } catch (const Glib::Error& err) {
+    spdlog::warn("Failed to update properties: {}", err.what());
+  } catch (const std::exception& err) {
+    spdlog::warn("Failed to update properties: {}", err.what());
+  }
+  update_fetching_.clear();
+  if (!update_pending_.empty()) {
+    // signals that came while fetching, one GetAll for all of them
+    Glib::signal_timeout().connect_once(sigc::mem_fun(*this, &ItemState::getUpdatedProperties),
+                                        UPDATE_DEBOUNCE_TIME);
+  }
+}
+
+/**
+ * Mapping from a signal name to a set of possibly changed properties.
+ * Commented signals are not handled by the tray module at the moment.
+ */
+static const std::map<std::string_view, std::set<std::string_view>> signal2props = {
+    {"NewTitle", {"Title"}},
+    {"NewIcon", {"IconName", "IconPixmap"}},
+    // {"NewAttentionIcon", {"AttentionIconName", "AttentionIconPixmap", "AttentionMovieName"}},
+    // {"NewOverlayIcon", {"OverlayIconName", "OverlayIconPixmap"}},
+    {"NewIconThemePath", {"IconThemePath"}},
+    {"NewToolTip", {"ToolTip"}},
+    {"NewStatus", {"Status"}},
+    // {"XAyatanaNewLabel", {"XAyatanaLabel"}},
+};
+
+void ItemState::onSignal(const Glib::ustring& sender_name, const Glib::ustring& signal_name,
+                         const Glib::VariantContainerBase& arguments) {
+  spdlog::trace("Tray item '{}' got signal {}", id, signal_name);
+  auto changed = signal2props.find(signal_name.raw());
+  if (changed != signal2props.end()) {
+    requestUpdate(changed->second);
+  }
+}
+
+static void pixbuf_data_deleter(const guint8* data) { g_free((void*)data); }
+
+/* SNI pixmaps are ARGB in network byte order, Pixbufs want the bytes as RGBA: that is a rotation
+ * of each pixel read as a 32 bit word, which the compiler vectorizes at -O3.
+ */
+static void argb_to_rgba(const guchar* __restrict src, guchar* __restrict dst, size_t pixels) {
+  for (size_t i = 0; i < pixels; ++i) {
+    uint32_t pixel;
+    std::memcpy(&pixel, src + 4 * i, 4);
+    if constexpr (std::endian::native == std::endian::little) {
+      pixel = std::rotr(pixel, 8);
+    } else {
+      pixel = std::rotl(pixel, 8);
+    }
+    std::memcpy(dst + 4 * i, &pixel, 4);
+  }
+}
+
+Glib::RefPtr<Gdk::Pixbuf> ItemState::extractPixBuf(GVariant* variant) {
+  GVariantIter* it;
+  g_variant_get(variant, "a(iiay)", &it);
+  if (it == nullptr) {
+    return Glib::RefPtr<Gdk::Pixbuf>{};
+  }
+  const int target = std::max(wanted_height_, 1);
+  pixmap_height_ = wanted_height_;
+
+  /* The smallest pixmap that doesn't need to be scaled up, or the largest one. Only that one is
+   * read, the others stay in the message.
+   */
+  GVariant* best = nullptr;
+  gint bwidth = 0;
+  gint bheight = 0;
+  GVariant* val;
+  gint width;
+  gint height;
+  while (g_variant_iter_next(it, "(ii@ay)", &width, &height, &val)) {
+    /* Sanity check */
+    const bool valid = width > 0 && height > 0 &&
+                       g_variant_get_size(val) == 4ULL * width * height &&
+                       g_variant_get_data(val) != nullptr;
+    const bool better =
+        best == nullptr ||
+        (bheight < target ? height > bheight : height >= target && height < bheight);
+    if (valid && better) {
+      if (best != nullptr) {
+        g_variant_unref(best);
+      }
+      best = val;
+      bwidth = width;
+      bheight = height;
+    } else {
+      g_variant_unref(val);
+    }
+  }
+  g_variant_iter_free(it);
+  if (best == nullptr) {
+    return Glib::RefPtr<Gdk::Pixbuf>{};
+  }
+
+  const auto* data = static_cast<const guchar*>(g_variant_get_data(best));
+  const size_t pixels = static_cast<size_t>(bwidth) * bheight;
+  Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+  if (bheight <= target) {
+    auto* array = static_cast<guchar*>(g_malloc(4 * pixels));
+    argb_to_rgba(data, array, pixels);
+    pixbuf = Gdk::Pixbuf::create_from_data(array, Gdk::Colorspace::COLORSPACE_RGB, true, 8, bwidth,
+                                           bheight, 4 * bwidth, &pixbuf_data_deleter);
+  } else {
+    // Only the icon at the largest size it's shown at is kept
+    std::vector<guchar> rgba(4 * pixels);
+    argb_to_rgba(data, rgba.data(), pixels);
+    auto full = Gdk::Pixbuf::create_from_data(rgba.data(), Gdk::Colorspace::COLORSPACE_RGB, true,
+                                              8, bwidth, bheight, 4 * bwidth);
+    pixbuf = full->scale_simple(std::max(1, target * bwidth / bheight), target,
+                                Gdk::InterpType::INTERP_BILINEAR);
+  }
+  g_variant_unref(best);
+  return pixbuf;
+}
+
+}  // namespace waybar::modules::SNI
@@ -8,12 +8,14 @@
 
 namespace waybar::modules::SNI {
 
+static const unsigned REVEAL_BATCH_TIME = 100;
+
 Tray::Tray(const std::string& id, const Bar& bar, const Json::Value& config)
     : AModule(config, "tray", id),
       box_(bar.orientation, 0),
+      bar_(bar),
       watcher_(SNI::Watcher::getInstance()),
-      host_(nb_hosts_, config, bar, std::bind(&Tray::onAdd, this, std::placeholders::_1),
-            std::bind(&Tray::onRemove, this, std::placeholders::_1)) {
+      host_(SNI::Host::getInstance()) {
   box_.set_name("tray");
   event_box_.add(box_);
   if (!id.empty()) {
@@ -23,40 +25,73 @@ Tray::Tray(const std::string& id, const Bar& bar, const Json::Value& config)
   if (config_["spacing"].isUInt()) {
     box_.set_spacing(config_["spacing"].asUInt());
   }
-  if (config["show-passive-items"].isBool()) {
-    show_passive_ = config["show-passive-items"].asBool();
-  }
-  nb_hosts_ += 1;
   if (config_["icons"].isObject()) {
     IconManager::instance().setIconsConfig(config_["icons"]);
   }
+  host_subscription_ =
+      host_->subscribe([this](const auto& state) { onAdd(state); },
+                       [this](const auto& state) { onRemove(state); });
   dp.emit();
 }
 
-void Tray::onAdd(std::unique_ptr<Item>& item) {
+Tray::~Tray() {
+  host_->unsubscribe(host_subscription_);
+  reveal_connection_.disconnect();
+}
+
+void Tray::onAdd(const std::shared_ptr<ItemState>& state) {
+  auto& item = items_.emplace_back(std::make_unique<Item>(state, config_, bar_));
+  // Hidden until ready, it takes no room yet
   if (config_["reverse-direction"].isBool() && config_["reverse-direction"].asBool()) {
     box_.pack_end(item->event_box);
   } else {
     box_.pack_start(item->event_box);
   }
+  if (state->ready()) {
+    onReady(item.get());
+  } else {
+    item->signal_ready.connect([this, item = item.get()] { onReady(item); });
+  }
+}
+
+void Tray::onRemove(const std::shared_ptr<ItemState>& state) {
+  auto it = std::find_if(items_.begin(), items_.end(),
+                         [&state](const auto& item) { return item->state == state; });
+  if (it == items_.end()) {
+    return;
+  }
+  ready_.erase(std::remove(ready_.begin(), ready_.end(), it->get()), ready_.end());
+  box_.remove((*it)->event_box);
+  items_.erase(it);
   dp.emit();
 }
 
-void Tray::onRemove(std::unique_ptr<Item>& item) {
-  box_.remove(item->event_box);
+void Tray::onReady(Item* item) {
+  ready_.push_back(item);
+  if (!reveal_connection_.connected()) {
+    reveal_connection_ = Glib::signal_timeout().connect(
+        [this] {
+          revealReady();
+          return false;
+        },
+        REVEAL_BATCH_TIME);
+  }
+}
+
+void Tray::revealReady() {
+  for (auto* item : ready_) {
+    item->reveal();
+  }
+  ready_.clear();
   dp.emit();
 }
 
 auto Tray::update() -> void {
   // Show tray only when items are available
+  // The items hide themselves while they aren't revealed yet or passive ones aren't shown
   std::vector<Gtk::Widget*> children = box_.get_children();
-  if (show_passive_) {
-    event_box_.set_visible(!children.empty());
-  } else {
-    event_box_.set_visible(!std::all_of(children.begin(), children.end(), [](Gtk::Widget* child) {
-      return child->get_style_context()->has_class("passive");
-    }));
-  }
+  event_box_.set_visible(std::any_of(children.begin(), children.end(),
+                                     [](Gtk::Widget* child) { return child->get_visible(); }));
 
   // Call parent update
   AModule::update();
@@ -50,14 +50,6 @@ BarIpcClient::BarIpcClient(waybar::Bar& bar) : bar_{bar} {
   ipc_.subscribe(oss_events.str());
   ipc_.signal_event.connect(sigc::mem_fun(*this, &BarIpcClient::onIpcEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &BarIpcClient::onCmd));
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("BarIpcClient::handleEvent {}", e.what());
-    }
-  });
 }
 
 bool BarIpcClient::isModuleEnabled(std::string name) {
@@ -1,41 +1,107 @@
 #include "modules/sway/ipc/client.hpp"
 
 #include <fcntl.h>
+#include <poll.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "modules/sway/ipc/tree.hpp"
+#include "util/json.hpp"
 
 namespace waybar::modules::sway {
 
-Ipc::Ipc() {
-  const std::string& socketPath = getSocketPath();
-  fd_ = open(socketPath);
-  fd_event_ = open(socketPath);
-}
+namespace {
 
-Ipc::~Ipc() {
-  thread_.stop();
+constexpr std::string_view ipc_magic = "i3-ipc";
+constexpr size_t ipc_header_size = ipc_magic.size() + 8;
 
-  if (fd_ > 0) {
-    // To fail the IPC header
-    if (write(fd_, "close-sway-ipc", 14) == -1) {
-      spdlog::error("Failed to close sway IPC");
-    }
-    close(fd_);
-    fd_ = -1;
-  }
-  if (fd_event_ > 0) {
-    if (write(fd_event_, "close-sway-ipc", 14) == -1) {
-      spdlog::error("Failed to close sway IPC event handler");
-    }
-    close(fd_event_);
-    fd_event_ = -1;
+// Upper bound on the age of a shared GET_TREE reply, for tree changes the hub is not subscribed
+// to. Long enough to share one fetch between every module reacting to the same event.
+constexpr auto TREE_LIFETIME = std::chrono::milliseconds(100);
+
+// Tree requests made from event handlers wait for the queued events to drain, but a steady stream
+// of events still gets a refresh after this many.
+constexpr unsigned MAX_COALESCED_EVENTS = 32;
+
+const std::unordered_map<std::string, uint32_t> event_types = {
+    {"workspace", IPC_EVENT_WORKSPACE},
+    {"output", IPC_EVENT_OUTPUT},
+    {"mode", IPC_EVENT_MODE},
+    {"window", IPC_EVENT_WINDOW},
+    {"barconfig_update", IPC_EVENT_BARCONFIG_UPDATE},
+    {"binding", IPC_EVENT_BINDING},
+    {"shutdown", IPC_EVENT_SHUTDOWN},
+    {"tick", IPC_EVENT_TICK},
+    {"bar_state_update", IPC_EVENT_BAR_STATE_UPDATE},
+    {"input", IPC_EVENT_INPUT},
+};
+
+}  // namespace
+
+/* Owns the sway sockets shared by every Ipc handle. The event socket carries the union of the
+ * handles' subscriptions and is read by one thread that fans the events out. GET_TREE replies are
+ * shared until the next event, so all modules on all bars reacting to it share one fetch.
+ */
+class IpcHub {
+ public:
+  static IpcHub& inst() {
+    static auto* hub = new IpcHub();
+    return *hub;
   }
-}
 
-void Ipc::setWorker(std::function<void()>&& func) { thread_ = func; }
+  void add(Ipc* client);
+  void remove(Ipc* client);
+  void subscribe(Ipc* client, const std::string& payload);
+  std::shared_ptr<const Ipc::ipc_response> command(uint32_t type, const std::string& payload);
+  void requestTree(Ipc* client);
 
-const std::string Ipc::getSocketPath() const {
+ private:
+  IpcHub() = default;
+
+  static std::string getSocketPath();
+  static int open(const std::string& socketPath);
+  static void send(int fd, uint32_t type, const std::string& payload);
+  static void recv(int fd, Ipc::ipc_response& res);
+
+  void connect();
+  void handleEvents();
+  bool eventPending() const;
+  void flushTreeRequests();
+  std::shared_ptr<const Ipc::ipc_response> tree();
+
+  std::mutex connectMutex_;
+  int fd_ = -1;
+  int fd_event_ = -1;
+  std::mutex cmdMutex_;  // one request in flight on fd_ at a time
+  std::mutex subscribeMutex_;
+  uint32_t subscribed_ = 0;  // event_mask() of the types sway sends on fd_event_
+  std::thread thread_;
+  std::atomic<std::thread::id> readerId_;
+  // dispatch only takes a shared lock, a handle waits for the running dispatch to unregister
+  std::shared_mutex clientsMutex_;
+  std::vector<Ipc*> clients_;
+  std::atomic<uint64_t> generation_ = 0;  // bumped on every event
+  std::mutex treeMutex_;                  // held while refreshing, callers wait for one fetch
+  std::shared_ptr<Ipc::ipc_response> tree_;  // copies are handed out as const
+  uint64_t treeGeneration_ = 0;
+  std::chrono::steady_clock::time_point treeFetchedAt_;
+  // deferred tree requests, only touched by the reader thread
+  bool treeRequested_ = false;
+  unsigned coalescedEvents_ = 0;
+};
+
+std::string IpcHub::getSocketPath() {
   const char* env = getenv("SWAYSOCK");
   if (env != nullptr) {
     return std::string(env);
@@ -63,7 +129,7 @@ const std::string Ipc::getSocketPath() const {
   return str;
 }
 
-int Ipc::open(const std::string& socketPath) const {
+int IpcHub::open(const std::string& socketPath) {
   int32_t fd = socket(AF_UNIX, SOCK_STREAM, 0);
   if (fd == -1) {
     throw std::runtime_error("Unable to open Unix socket");
@@ -76,82 +142,279 @@ int Ipc::open(const std::string& socketPath) const {
   addr.sun_path[sizeof(addr.sun_path) - 1] = 0;
   int l = sizeof(struct sockaddr_un);
   if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), l) == -1) {
+    close(fd);
     throw std::runtime_error("Unable to connect to Sway");
   }
   return fd;
 }
 
-struct Ipc::ipc_response Ipc::recv(int fd) {
-  std::string header;
-  header.resize(ipc_header_size_);
-  auto data32 = reinterpret_cast<uint32_t*>(header.data() + ipc_magic_.size());
+// Reads one message into res. The payload reuses the capacity res already has, so a buffer that
+// is kept around stops allocating once it has seen the largest message.
+void IpcHub::recv(int fd, Ipc::ipc_response& res) {
+  std::array<char, ipc_header_size> header;
   size_t total = 0;
 
-  while (total < ipc_header_size_) {
-    auto res = ::recv(fd, header.data() + total, ipc_header_size_ - total, 0);
-    if (fd_event_ == -1 || fd_ == -1) {
-      // IPC is closed so just return an empty response
-      return {0, 0, ""};
-    }
-    if (res <= 0) {
+  while (total < ipc_header_size) {
+    auto got = ::recv(fd, header.data() + total, ipc_header_size - total, 0);
+    if (got <= 0) {
       throw std::runtime_error("Unable to receive IPC header");
     }
-    total += res;
+    total += got;
   }
-  auto magic = std::string(header.data(), header.data() + ipc_magic_.size());
-  if (magic != ipc_magic_) {
+  if (std::string_view(header.data(), ipc_magic.size()) != ipc_magic) {
     throw std::runtime_error("Invalid IPC magic");
   }
+  memcpy(&res.size, header.data() + ipc_magic.size(), sizeof(res.size));
+  memcpy(&res.type, header.data() + ipc_magic.size() + sizeof(res.size), sizeof(res.type));
 
+  if (res.payload.capacity() < res.size) {
+    res.payload.reserve(std::max<size_t>(res.size, 2 * res.payload.capacity()));
+  }
+  res.payload.resize(res.size);
   total = 0;
-  std::string payload;
-  payload.resize(data32[0]);
-  while (total < data32[0]) {
-    auto res = ::recv(fd, payload.data() + total, data32[0] - total, 0);
-    if (res < 0) {
+  while (total < res.size) {
+    auto got = ::recv(fd, res.payload.data() + total, res.size - total, 0);
+    if (got < 0) {
       if (errno == EINTR || errno == EAGAIN) {
         continue;
       }
       throw std::runtime_error("Unable to receive IPC payload");
     }
-    total += res;
+    if (got == 0) {
+      throw std::runtime_error("Unable to receive IPC payload");
+    }
+    total += got;
   }
-  return {data32[0], data32[1], &payload.front()};
 }
 
-struct Ipc::ipc_response Ipc::send(int fd, uint32_t type, const std::string& payload) {
-  std::string header;
-  header.resize(ipc_header_size_);
-  auto data32 = reinterpret_cast<uint32_t*>(header.data() + ipc_magic_.size());
-  memcpy(header.data(), ipc_magic_.c_str(), ipc_magic_.size());
-  data32[0] = payload.size();
-  data32[1] = type;
+void IpcHub::send(int fd, uint32_t type, const std::string& payload) {
+  std::array<char, ipc_header_size> header;
+  const uint32_t size = payload.size();
+  memcpy(header.data(), ipc_magic.data(), ipc_magic.size());
+  memcpy(header.data() + ipc_magic.size(), &size, sizeof(size));
+  memcpy(header.data() + ipc_magic.size() + sizeof(size), &type, sizeof(type));
 
-  if (::send(fd, header.data(), ipc_header_size_, 0) == -1) {
+  if (::send(fd, header.data(), ipc_header_size, MSG_MORE) == -1) {
     throw std::runtime_error("Unable to send IPC header");
   }
   if (::send(fd, payload.c_str(), payload.size(), 0) == -1) {
     throw std::runtime_error("Unable to send IPC payload");
   }
-  return Ipc::recv(fd);
 }
 
-void Ipc::sendCmd(uint32_t type, const std::string& payload) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  const auto res = Ipc::send(fd_, type, payload);
-  signal_cmd.emit(res);
+void IpcHub::connect() {
+  std::lock_guard<std::mutex> lock(connectMutex_);
+  if (fd_ != -1) {
+    return;
+  }
+  // Failures propagate to the module constructor, the next handle retries
+  const std::string socketPath = getSocketPath();
+  const int fd = open(socketPath);
+  try {
+    fd_event_ = open(socketPath);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  fd_ = fd;
+}
+
+void IpcHub::add(Ipc* client) {
+  connect();
+  std::unique_lock lock(clientsMutex_);
+  clients_.push_back(client);
+}
+
+void IpcHub::remove(Ipc* client) {
+  std::unique_lock lock(clientsMutex_);
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
 }
 
-void Ipc::subscribe(const std::string& payload) {
-  auto res = Ipc::send(fd_event_, IPC_SUBSCRIBE, payload);
+void IpcHub::subscribe(Ipc* client, const std::string& payload) {
+  util::JsonParser parser;
+  const auto names = parser.parse(payload);
+  uint32_t events = 0;
+  std::vector<std::string> missing;
+  std::lock_guard<std::mutex> lock(subscribeMutex_);
+  for (const auto& name : names) {
+    const auto type = event_types.find(name.asString());
+    if (type == event_types.end()) {
+      throw std::runtime_error("Unable to subscribe ipc event");
+    }
+    events |= event_mask(type->second);
+    if ((subscribed_ & event_mask(type->second)) == 0) {
+      missing.push_back(type->first);
+    }
+  }
+  {
+    std::unique_lock clientsLock(clientsMutex_);
+    client->events_ |= events;
+  }
+  if (missing.empty()) {
+    return;
+  }
+
+  std::string request = "[";
+  for (const auto& name : missing) {
+    request += (request.size() > 1 ? ",\"" : "\"") + name + "\"";
+  }
+  request += "]";
+  send(fd_event_, IPC_SUBSCRIBE, request);
+  if (thread_.joinable()) {
+    // the reader thread consumes the reply
+    subscribed_ |= events;
+    return;
+  }
+  Ipc::ipc_response res;
+  recv(fd_event_, res);
   if (res.payload != "{\"success\": true}") {
     throw std::runtime_error("Unable to subscribe ipc event");
   }
+  subscribed_ |= events;
+  thread_ = std::thread([this] { handleEvents(); });
+}
+
+bool IpcHub::eventPending() const {
+  struct pollfd pfd = {.fd = fd_event_, .events = POLLIN, .revents = 0};
+  return poll(&pfd, 1, 0) > 0;
+}
+
+void IpcHub::handleEvents() {
+  readerId_ = std::this_thread::get_id();
+  // reused for every event, handlers only see it for the duration of the dispatch
+  Ipc::ipc_response res;
+  while (true) {
+    // a burst of events is over, answer the tree requests it left behind with one fetch
+    if (treeRequested_ && !eventPending()) {
+      flushTreeRequests();
+    }
+
+    try {
+      recv(fd_event_, res);
+    } catch (const std::exception& e) {
+      spdlog::error("Sway IPC: event socket closed: {}", e.what());
+      return;
+    }
+    if (res.type == IPC_SUBSCRIBE) {
+      if (res.payload != "{\"success\": true}") {
+        spdlog::error("Sway IPC: Unable to subscribe ipc event");
+      }
+      continue;
+    }
+
+    // any event may change the tree, drop the shared reply
+    ++generation_;
+    std::shared_lock lock(clientsMutex_);
+    for (auto* client : clients_) {
+      if ((client->events_ & event_mask(res.type)) == 0) {
+        continue;
+      }
+      try {
+        client->signal_event.emit(res);
+      } catch (const std::exception& e) {
+        spdlog::error("Sway IPC: {}", e.what());
+      }
+    }
+    lock.unlock();
+
+    if (treeRequested_ && ++coalescedEvents_ >= MAX_COALESCED_EVENTS) {
+      flushTreeRequests();
+    }
+  }
 }
 
-void Ipc::handleEvent() {
-  const auto res = Ipc::recv(fd_event_);
-  signal_event.emit(res);
+void IpcHub::requestTree(Ipc* client) {
+  if (std::this_thread::get_id() != readerId_.load()) {
+    client->signal_cmd.emit(*tree());
+    return;
+  }
+  client->treePending_ = true;
+  treeRequested_ = true;
 }
 
+void IpcHub::flushTreeRequests() {
+  treeRequested_ = false;
+  coalescedEvents_ = 0;
+  std::shared_ptr<const Ipc::ipc_response> res;
+  try {
+    res = tree();
+  } catch (const std::exception& e) {
+    spdlog::error("Sway IPC: {}", e.what());
+  }
+
+  std::shared_lock lock(clientsMutex_);
+  for (auto* client : clients_) {
+    if (!client->treePending_) {
+      continue;
+    }
+    client->treePending_ = false;
+    if (!res) {
+      continue;
+    }
+    try {
+      client->signal_cmd.emit(*res);
+    } catch (const std::exception& e) {
+      spdlog::error("Sway IPC: {}", e.what());
+    }
+  }
+}
+
+std::shared_ptr<const Ipc::ipc_response> IpcHub::tree() {
+  std::lock_guard<std::mutex> lock(treeMutex_);
+  if (tree_ && treeGeneration_ == generation_ &&
+      std::chrono::steady_clock::now() - treeFetchedAt_ < TREE_LIFETIME) {
+    return tree_;
+  }
+
+  // Remember the generation from before the fetch: if an event arrives while the request is in
+  // flight, the reply may predate it and must not be reused.
+  const auto generation = generation_.load();
+  const auto fetchedAt = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> cmdLock(cmdMutex_);
+    // refill the previous reply in place once no consumer holds on to it any more
+    if (!tree_ || tree_.use_count() > 1) {
+      tree_ = std::make_shared<Ipc::ipc_response>();
+    }
+    try {
+      send(fd_, IPC_GET_TREE, "");
+      recv(fd_, *tree_);
+      auto tree = std::make_shared<const Json::Value>(parseTree(tree_->payload));
+      tree_->index = std::make_shared<const TreeIndex>(indexTree(*tree));
+      tree_->tree = std::move(tree);
+    } catch (...) {
+      tree_.reset();
+      throw;
+    }
+  }
+  treeGeneration_ = generation;
+  treeFetchedAt_ = fetchedAt;
+  return tree_;
+}
+
+std::shared_ptr<const Ipc::ipc_response> IpcHub::command(uint32_t type,
+                                                         const std::string& payload) {
+  if (type == IPC_GET_TREE && payload.empty()) {
+    return tree();
+  }
+  std::lock_guard<std::mutex> lock(cmdMutex_);
+  send(fd_, type, payload);
+  auto res = std::make_shared<Ipc::ipc_response>();
+  recv(fd_, *res);
+  return res;
+}
+
+Ipc::Ipc() { IpcHub::inst().add(this); }
+
+Ipc::~Ipc() { IpcHub::inst().remove(this); }
+
+void Ipc::sendCmd(uint32_t type, const std::string& payload) {
+  const auto res = IpcHub::inst().command(type, payload);
+  signal_cmd.emit(*res);
+}
+
+void Ipc::subscribe(const std::string& payload) { IpcHub::inst().subscribe(this, payload); }
+
+void Ipc::requestTree() { IpcHub::inst().requestTree(this); }
+
 }  // namespace waybar::modules::sway
@@ -0,0 +1,112 @@
+#include "modules/sway/ipc/tree.hpp"
+
+#include <array>
+#include <string>
+
+#include "util/json_scanner.hpp"
+
+namespace waybar::modules::sway {
+
+namespace {
+
+// Node fields that are kept verbatim
+constexpr std::array<std::string_view, 13> kept_keys = {
+    "type",    "name",   "num",     "id",    "output", "layout",           "focused",
+    "visible", "urgent", "app_id", "shell", "marks",  "current_workspace",
+};
+constexpr std::array<std::string_view, 2> window_property_keys = {"class", "instance"};
+
+template <size_t N>
+bool contains(const std::array<std::string_view, N>& keys, std::string_view key) {
+  for (const auto& k : keys) {
+    if (k == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+class TreeParser {
+ public:
+  explicit TreeParser(std::string_view input) : in_{"sway tree", input} {}
+
+  Json::Value parse() {
+    Json::Value root;
+    parseNode(root);
+    in_.expectEnd();
+    return root;
+  }
+
+ private:
+  void parseNode(Json::Value& node) {
+    node = Json::Value(Json::objectValue);
+    in_.parseObject([&](std::string_view key) {
+      if (key == "nodes" || key == "floating_nodes") {
+        auto& children = node[std::string(key)] = Json::Value(Json::arrayValue);
+        in_.parseArray([&] { parseNode(children.append(Json::Value())); });
+      } else if (key == "window_properties" && in_.peek() == '{') {
+        auto& props = node["window_properties"] = Json::Value(Json::objectValue);
+        in_.parseObject([&](std::string_view prop) {
+          if (contains(window_property_keys, prop)) {
+            in_.parseValue(props[std::string(prop)]);
+          } else {
+            in_.skipValue();
+          }
+        });
+      } else if (contains(kept_keys, key)) {
+        in_.parseValue(node[std::string(key)]);
+      } else {
+        in_.skipValue();
+      }
+    });
+  }
+
+  util::JsonScanner in_;
+};
+
+}  // namespace
+
+Json::Value parseTree(std::string_view payload) { return TreeParser(payload).parse(); }
+
+namespace {
+
+// Compares in place, where asString() would copy
+bool equals(const Json::Value& value, std::string_view str) {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+  return value.isString() && value.getString(&begin, &end) &&
+         std::string_view(begin, end - begin) == str;
+}
+
+void indexNodes(const Json::Value& nodes, const Json::Value* output, const Json::Value* workspace,
+                TreeIndex& index) {
+  for (const auto& node : nodes) {
+    const auto& type = node["type"];
+    if (equals(type, "output")) {
+      output = &node;
+    } else if (equals(type, "workspace")) {
+      workspace = &node;
+      if (index.scratchpad == nullptr && equals(node["name"], "__i3_scratch")) {
+        index.scratchpad = &node;
+      }
+    }
+    if (index.focused == nullptr && node["focused"].asBool() &&
+        (equals(type, "workspace") || equals(type, "con") || equals(type, "floating_con"))) {
+      index.focused = &node;
+      index.focused_workspace = workspace;
+      index.focused_output = output != nullptr ? (*output)["name"].asString() : "";
+    }
+    indexNodes(node["nodes"], output, workspace, index);
+    indexNodes(node["floating_nodes"], output, workspace, index);
+  }
+}
+
+}  // namespace
+
+TreeIndex indexTree(const Json::Value& tree) {
+  TreeIndex index;
+  indexNodes(tree["nodes"], nullptr, nullptr, index);
+  return index;
+}
+
+}  // namespace waybar::modules::sway
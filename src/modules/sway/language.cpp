@@ -3,7 +3,6 @@
 #include <fmt/core.h>
 #include <json/json.h>
 #include <spdlog/spdlog.h>
-#include <xkbcommon/xkbregistry.h>
 
 #include <cstring>
 #include <string>
@@ -11,6 +10,7 @@
 
 #include "modules/sway/ipc/ipc.hpp"
 #include "util/string.hpp"
+#include "util/xkb_layouts.hpp"
 
 namespace waybar::modules::sway {
 
@@ -34,14 +34,6 @@ Language::Language(const std::string& id, const Json::Value& config)
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Language::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Language::onCmd));
   ipc_.sendCmd(IPC_GET_INPUTS);
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Language: {}", e.what());
-    }
-  });
   dp.emit();
 }
 
@@ -132,13 +124,19 @@ auto Language::set_current_layout(std::string current_layout) -> void {
 
 auto Language::init_layouts_map(const std::vector<std::string>& used_layouts) -> void {
   std::map<std::string, std::vector<Layout*>> found_by_short_names;
-  XKBContext xkb_context;
-  auto layout = xkb_context.next_layout();
-  for (; layout != nullptr; layout = xkb_context.next_layout()) {
-    if (std::find(used_layouts.begin(), used_layouts.end(), layout->full_name) ==
-        used_layouts.end()) {
+  const auto& xkb_layouts = util::XkbLayouts::inst();
+  for (const auto& used_layout_name : used_layouts) {
+    const auto* xkb_layout = xkb_layouts.find(used_layout_name);
+    if (xkb_layout == nullptr) {
+      continue;
+    }
+    auto [inserted, is_new] = layouts_map_.emplace(
+        used_layout_name, Layout{used_layout_name, xkb_layout->short_name, xkb_layout->variant,
+                                 xkb_layout->short_description});
+    if (!is_new) {
       continue;
     }
+    auto* layout = &inserted->second;
 
     if (!is_variant_displayed) {
       auto short_name = layout->short_name;
@@ -148,8 +146,6 @@ auto Language::init_layouts_map(const std::vector<std::string>& used_layouts) ->
         found_by_short_names[short_name] = {layout};
       }
     }
-
-    layouts_map_.emplace(layout->full_name, *layout);
   }
 
   if (is_variant_displayed || found_by_short_names.size() == 0) {
@@ -179,46 +175,6 @@ auto Language::init_layouts_map(const std::vector<std::string>& used_layouts) ->
   }
 }
 
-Language::XKBContext::XKBContext() {
-  context_ = rxkb_context_new(RXKB_CONTEXT_LOAD_EXOTIC_RULES);
-  rxkb_context_parse_default_ruleset(context_);
-}
-
-auto Language::XKBContext::next_layout() -> Layout* {
-  if (xkb_layout_ == nullptr) {
-    xkb_layout_ = rxkb_layout_first(context_);
-  } else {
-    xkb_layout_ = rxkb_layout_next(xkb_layout_);
-  }
-
-  if (xkb_layout_ == nullptr) {
-    return nullptr;
-  }
-
-  auto description = std::string(rxkb_layout_get_description(xkb_layout_));
-  auto name = std::string(rxkb_layout_get_name(xkb_layout_));
-  auto variant_ = rxkb_layout_get_variant(xkb_layout_);
-  std::string variant = variant_ == nullptr ? "" : std::string(variant_);
-  auto short_description_ = rxkb_layout_get_brief(xkb_layout_);
-  std::string short_description;
-  if (short_description_ != nullptr) {
-    short_description = std::string(short_description_);
-    base_layouts_by_name_.emplace(name, xkb_layout_);
-  } else {
-    auto base_layout = base_layouts_by_name_[name];
-    short_description =
-        base_layout == nullptr ? "" : std::string(rxkb_layout_get_brief(base_layout));
-  }
-  delete layout_;
-  layout_ = new Layout{description, name, variant, short_description};
-  return layout_;
-}
-
-Language::XKBContext::~XKBContext() {
-  rxkb_context_unref(context_);
-  delete layout_;
-}
-
 std::string Language::Layout::country_flag() const {
   if (short_name.size() != 2) return "";
   unsigned char result[] = "\xf0\x9f\x87\x00\xf0\x9f\x87\x00";
@@ -4,6 +4,8 @@
 
 #include <string>
 
+#include "modules/sway/ipc/tree.hpp"
+
 namespace waybar::modules::sway {
 Scratchpad::Scratchpad(const std::string& id, const Json::Value& config)
     : ALabel(config, "scratchpad", id,
@@ -19,14 +21,6 @@ Scratchpad::Scratchpad(const std::string& id, const Json::Value& config)
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Scratchpad::onCmd));
 
   getTree();
-
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Scratchpad: {}", e.what());
-    }
-  });
 }
 auto Scratchpad::update() -> void {
   if (count_ || show_empty_) {
@@ -51,20 +45,25 @@ auto Scratchpad::update() -> void {
 
 auto Scratchpad::getTree() -> void {
   try {
-    ipc_.sendCmd(IPC_GET_TREE);
+    ipc_.requestTree();
   } catch (const std::exception& e) {
     spdlog::error("Scratchpad: {}", e.what());
   }
 }
 
 auto Scratchpad::onCmd(const struct Ipc::ipc_response& res) -> void {
+  if (!res.tree) {
+    return;
+  }
   try {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto tree = parser_.parse(res.payload);
-    count_ = tree["nodes"][0]["nodes"][0]["floating_nodes"].size();
+    const auto& scratchpad = res.index && res.index->scratchpad != nullptr
+                                 ? *res.index->scratchpad
+                                 : (*res.tree)["nodes"][0]["nodes"][0];
+    count_ = scratchpad["floating_nodes"].size();
     if (tooltip_enabled_) {
       tooltip_text_.clear();
-      for (const auto& window : tree["nodes"][0]["nodes"][0]["floating_nodes"]) {
+      for (const auto& window : scratchpad["floating_nodes"]) {
         tooltip_text_.append(fmt::format(fmt::runtime(tooltip_format_ + '\n'),
                                          fmt::arg("app", window["app_id"].asString()),
                                          fmt::arg("title", window["name"].asString())));
@@ -11,38 +11,39 @@
 #include <regex>
 #include <string>
 
+#include "modules/sway/ipc/tree.hpp"
 #include "util/gtk_icon.hpp"
 #include "util/rewrite_string.hpp"
 
 namespace waybar::modules::sway {
 
 Window::Window(const std::string& id, const Bar& bar, const Json::Value& config)
-    : AAppIconLabel(config, "window", id, "{}", 0, true), bar_(bar), windowId_(-1) {
+    : AAppIconLabel(config, "window", id, "{}", 0, true),
+      bar_(bar),
+      rewrite_(util::RewriteRules::shared(config["rewrite"])),
+      windowId_(-1) {
   ipc_.subscribe(R"(["window","workspace"])");
   ipc_.signal_event.connect(sigc::mem_fun(*this, &Window::onEvent));
   ipc_.signal_cmd.connect(sigc::mem_fun(*this, &Window::onCmd));
   // Get Initial focused window
   getTree();
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception& e) {
-      spdlog::error("Window: {}", e.what());
-      spdlog::trace("Window::Window exception");
-    }
-  });
 }
 
 void Window::onEvent(const struct Ipc::ipc_response& res) { getTree(); }
 
 void Window::onCmd(const struct Ipc::ipc_response& res) {
+  if (!res.tree) {
+    return;
+  }
   try {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto payload = parser_.parse(res.payload);
+    const auto& payload = *res.tree;
     auto output = payload["output"].isString() ? payload["output"].asString() : "";
+    // offscreen-css also shows the windows of the workspaces that aren't focused, from a walk
     std::tie(app_nb_, floating_count_, windowId_, window_, app_id_, app_class_, shell_, layout_,
-             marks_) = getFocusedNode(payload["nodes"], output);
+             marks_) = res.index && !config_["offscreen-css"].asBool()
+                           ? getFocusedNode(*res.index)
+                           : getFocusedNode(payload["nodes"], output);
     updateAppIconName(app_id_, app_class_);
     dp.emit();
   } catch (const std::exception& e) {
@@ -94,10 +95,9 @@ auto Window::update() -> void {
     old_app_id_ = app_id_;
   }
 
-  label_.set_markup(waybar::util::rewriteString(
+  label_.set_markup(rewrite_->apply(
       fmt::format(fmt::runtime(format_), fmt::arg("title", window_), fmt::arg("app_id", app_id_),
-                  fmt::arg("shell", shell_), fmt::arg("marks", marks_)),
-      config_["rewrite"]));
+                  fmt::arg("shell", shell_), fmt::arg("marks", marks_))));
   if (tooltipEnabled()) {
     label_.set_tooltip_text(window_);
   }
@@ -192,6 +192,49 @@ std::tuple<std::string, std::string, std::string, std::string> getWindowInfo(
   return {app_id, app_class, shell, marks};
 }
 
+using FocusedNode = std::tuple<std::size_t, int, int, std::string, std::string, std::string,
+                               std::string, std::string, std::string>;
+
+FocusedNode focusedWorkspaceNode(const Json::Value& node, const Json::Value& config_) {
+  std::pair all_leaf_nodes = leafNodesInWorkspace(node);
+  return {all_leaf_nodes.first,
+          all_leaf_nodes.second,
+          node["id"].asInt(),
+          (((all_leaf_nodes.first > 0) || (all_leaf_nodes.second > 0)) &&
+           (config_["show-focused-workspace-name"].asBool()))
+              ? node["name"].asString()
+              : "",
+          "",
+          "",
+          "",
+          node["layout"].asString(),
+          ""};
+}
+
+FocusedNode focusedWindowNode(const Json::Value& node, const Json::Value& parentWorkspace,
+                              const Json::Value& config_) {
+  const auto [app_id, app_class, shell, marks] =
+      getWindowInfo(node, config_["show-hidden-marks"].asBool());
+  int nb = node.size();
+  int floating_count = 0;
+  std::string workspace_layout = "";
+  if (!parentWorkspace.isNull()) {
+    std::pair all_leaf_nodes = leafNodesInWorkspace(parentWorkspace);
+    nb = all_leaf_nodes.first;
+    floating_count = all_leaf_nodes.second;
+    workspace_layout = parentWorkspace["layout"].asString();
+  }
+  return {nb,
+          floating_count,
+          node["id"].asInt(),
+          Glib::Markup::escape_text(node["name"].asString()),
+          app_id,
+          app_class,
+          shell,
+          workspace_layout,
+          marks};
+}
+
 std::tuple<std::size_t, int, int, std::string, std::string, std::string, std::string, std::string,
            std::string>
 gfnWithWorkspace(const Json::Value& nodes, std::string& output, const Json::Value& config_,
@@ -210,19 +253,7 @@ gfnWithWorkspace(const Json::Value& nodes, std::string& output, const Json::Valu
         continue;
       }
       if (node["focused"].asBool()) {
-        std::pair all_leaf_nodes = leafNodesInWorkspace(node);
-        return {all_leaf_nodes.first,
-                all_leaf_nodes.second,
-                node["id"].asInt(),
-                (((all_leaf_nodes.first > 0) || (all_leaf_nodes.second > 0)) &&
-                 (config_["show-focused-workspace-name"].asBool()))
-                    ? node["name"].asString()
-                    : "",
-                "",
-                "",
-                "",
-                node["layout"].asString(),
-                ""};
+        return focusedWorkspaceNode(node, config_);
       }
       parentWorkspace = node;
     } else if ((node["type"].asString() == "con" || node["type"].asString() == "floating_con") &&
@@ -230,26 +261,7 @@ gfnWithWorkspace(const Json::Value& nodes, std::string& output, const Json::Valu
       // found node
       spdlog::trace("actual output {}, output found {}, node (focused) found {}", bar_.output->name,
                     output, node["name"].asString());
-      const auto [app_id, app_class, shell, marks] =
-          getWindowInfo(node, config_["show-hidden-marks"].asBool());
-      int nb = node.size();
-      int floating_count = 0;
-      std::string workspace_layout = "";
-      if (!parentWorkspace.isNull()) {
-        std::pair all_leaf_nodes = leafNodesInWorkspace(parentWorkspace);
-        nb = all_leaf_nodes.first;
-        floating_count = all_leaf_nodes.second;
-        workspace_layout = parentWorkspace["layout"].asString();
-      }
-      return {nb,
-              floating_count,
-              node["id"].asInt(),
-              Glib::Markup::escape_text(node["name"].asString()),
-              app_id,
-              app_class,
-              shell,
-              workspace_layout,
-              marks};
+      return focusedWindowNode(node, parentWorkspace, config_);
     }
 
     // iterate
@@ -306,9 +318,26 @@ Window::getFocusedNode(const Json::Value& nodes, std::string& output) {
   return gfnWithWorkspace(nodes, output, config_, bar_, placeholder, placeholder);
 }
 
+std::tuple<std::size_t, int, int, std::string, std::string, std::string, std::string, std::string,
+           std::string>
+Window::getFocusedNode(const TreeIndex& index) {
+  // Without offscreen-css, only the focused node shows: on this output, or on any with all-outputs
+  if (index.focused == nullptr ||
+      (!config_["all-outputs"].asBool() && index.focused_output != bar_.output->name)) {
+    return {0, 0, -1, "", "", "", "", "", ""};
+  }
+  if (index.focused == index.focused_workspace) {
+    return focusedWorkspaceNode(*index.focused, config_);
+  }
+  return focusedWindowNode(*index.focused,
+                           index.focused_workspace != nullptr ? *index.focused_workspace
+                                                              : Json::Value::nullSingleton(),
+                           config_);
+}
+
 void Window::getTree() {
   try {
-    ipc_.sendCmd(IPC_GET_TREE);
+    ipc_.requestTree();
   } catch (const std::exception& e) {
     spdlog::error("Window: {}", e.what());
     spdlog::trace("Window::getTree exception");
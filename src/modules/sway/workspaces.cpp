@@ -66,8 +66,11 @@ Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value
     const Json::Value &windowRewriteDefaultConfig = config["window-rewrite-default"];
     std::string windowRewriteDefault =
         windowRewriteDefaultConfig.isString() ? windowRewriteDefaultConfig.asString() : "?";
+    const Json::Value &cacheSize = config["window-rewrite-cache-size"];
     m_windowRewriteRules = waybar::util::RegexCollection(
-        windowRewrite, std::move(windowRewriteDefault), windowRewritePriorityFunction);
+        windowRewrite, std::move(windowRewriteDefault), windowRewritePriorityFunction,
+        cacheSize.isUInt() ? cacheSize.asUInt()
+                           : waybar::util::RegexCollection::DEFAULT_CACHE_CAPACITY);
   }
   ipc_.subscribe(R"(["workspace"])");
   ipc_.subscribe(R"(["window"])");
@@ -79,30 +82,22 @@ Workspaces::Workspaces(const std::string &id, const Bar &bar, const Json::Value
     window.add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
     window.signal_scroll_event().connect(sigc::mem_fun(*this, &Workspaces::handleScroll));
   }
-  // Launch worker
-  ipc_.setWorker([this] {
-    try {
-      ipc_.handleEvent();
-    } catch (const std::exception &e) {
-      spdlog::error("Workspaces: {}", e.what());
-    }
-  });
 }
 
 void Workspaces::onEvent(const struct Ipc::ipc_response &res) {
   try {
-    ipc_.sendCmd(IPC_GET_TREE);
+    ipc_.requestTree();
   } catch (const std::exception &e) {
     spdlog::error("Workspaces: {}", e.what());
   }
 }
 
 void Workspaces::onCmd(const struct Ipc::ipc_response &res) {
-  if (res.type == IPC_GET_TREE) {
+  if (res.type == IPC_GET_TREE && res.tree) {
     try {
       {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto payload = parser_.parse(res.payload);
+        const auto &payload = *res.tree;
         workspaces_.clear();
         std::vector<Json::Value> outputs;
         bool alloutputs = config_["all-outputs"].asBool();
@@ -230,6 +225,8 @@ bool Workspaces::filterButtons() {
                            [it](const auto &node) { return node["name"].asString() == it->first; });
     if (ws == workspaces_.end() ||
         (!config_["all-outputs"].asBool() && (*ws)["output"].asString() != bar_.output->name)) {
+      auto &button = *it->second;
+      spare_buttons_.give(std::move(it->second), button);
       it = buttons_.erase(it);
       needReorder = true;
     } else {
@@ -290,7 +287,7 @@ auto Workspaces::update() -> void {
     if (bit == buttons_.end()) {
       needReorder = true;
     }
-    auto &button = bit == buttons_.end() ? addButton(*it) : bit->second;
+    auto &button = bit == buttons_.end() ? addButton(*it) : *bit->second;
     if (needReorder) {
       box_.reorder_child(button, it - workspaces_.begin());
     }
@@ -355,14 +352,40 @@ auto Workspaces::update() -> void {
 }
 
 Gtk::Button &Workspaces::addButton(const Json::Value &node) {
-  auto pair = buttons_.emplace(node["name"].asString(), node["name"].asString());
-  auto &&button = pair.first->second;
+  const auto name = node["name"].asString();
+  auto &slot = buttons_[name];
+  // A recycled one is already in the box and hooked up, it only needs the names
+  if ((slot = spare_buttons_.take())) {
+    slot->set_name("sway-workspace-" + name);
+    return *slot;
+  }
+  slot = std::make_unique<Gtk::Button>(name);
+  auto &button = *slot;
   box_.pack_start(button, false, false, 0);
-  button.set_name("sway-workspace-" + node["name"].asString());
+  button.set_name("sway-workspace-" + name);
   button.set_relief(Gtk::RELIEF_NONE);
   if (!config_["disable-click"].asBool()) {
-    button.signal_pressed().connect([this, node] {
+    button.signal_pressed().connect([this, &button] {
       try {
+        // The workspace the button shows now, it may have been recycled since
+        Json::Value node;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          for (const auto &[bound, other] : buttons_) {
+            if (other.get() == &button) {
+              auto ws = std::find_if(workspaces_.begin(), workspaces_.end(), [&](const auto &n) {
+                return n["name"].asString() == bound;
+              });
+              if (ws != workspaces_.end()) {
+                node = *ws;
+              }
+              break;
+            }
+          }
+        }
+        if (node.isNull()) {
+          return;
+        }
         if (node["target_output"].isString()) {
           ipc_.sendCmd(IPC_COMMAND,
                        fmt::format(persistent_workspace_switch_cmd_, "--no-auto-back-and-forth",
@@ -5,6 +5,8 @@
 #include <spdlog/spdlog.h>
 
 #include <cstdint>
+#include <map>
+#include <utility>
 
 static const unsigned UPDATE_DEBOUNCE_TIME_MS = 1000;
 
@@ -17,7 +19,9 @@ SystemdFailedUnits::SystemdFailedUnits(const std::string& id, const Json::Value&
       nr_failed_system(0),
       nr_failed_user(0),
       nr_failed(0),
-      last_status() {
+      last_status(),
+      last_nr_failed(0),
+      cancellable(Gio::Cancellable::create()) {
   if (config["hide-on-ok"].isBool()) {
     hide_on_ok = config["hide-on-ok"].asBool();
   }
@@ -27,32 +31,24 @@ SystemdFailedUnits::SystemdFailedUnits(const std::string& id, const Json::Value&
     format_ok = format_;
   }
 
-  /* Default to enable both "system" and "user". */
+  /* Default to enable both "system" and "user". The proxies are made asynchronously, the bar
+   * doesn't wait on the buses to show up. */
   if (!config["system"].isBool() || config["system"].asBool()) {
-    system_proxy = Gio::DBus::Proxy::create_for_bus_sync(
-        Gio::DBus::BusType::BUS_TYPE_SYSTEM, "org.freedesktop.systemd1",
-        "/org/freedesktop/systemd1", "org.freedesktop.DBus.Properties");
-    if (!system_proxy) {
-      throw std::runtime_error("Unable to connect to systemwide systemd DBus!");
-    }
-    system_proxy->signal_signal().connect(sigc::mem_fun(*this, &SystemdFailedUnits::notify_cb));
+    CreateProxy("systemwide", Gio::DBus::BusType::BUS_TYPE_SYSTEM, system_proxy);
   }
   if (!config["user"].isBool() || config["user"].asBool()) {
-    user_proxy = Gio::DBus::Proxy::create_for_bus_sync(
-        Gio::DBus::BusType::BUS_TYPE_SESSION, "org.freedesktop.systemd1",
-        "/org/freedesktop/systemd1", "org.freedesktop.DBus.Properties");
-    if (!user_proxy) {
-      throw std::runtime_error("Unable to connect to user systemd DBus!");
-    }
-    user_proxy->signal_signal().connect(sigc::mem_fun(*this, &SystemdFailedUnits::notify_cb));
+    CreateProxy("user", Gio::DBus::BusType::BUS_TYPE_SESSION, user_proxy);
   }
 
-  updateData();
+  if (proxies_pending == 0) updateData();
   /* Always update for the first time. */
   dp.emit();
 }
 
 SystemdFailedUnits::~SystemdFailedUnits() {
+  update_timer.disconnect();
+  // Replies still in flight must not reach the module anymore
+  cancellable->cancel();
   if (system_proxy) system_proxy.reset();
   if (user_proxy) user_proxy.reset();
 }
@@ -63,75 +59,110 @@ auto SystemdFailedUnits::notify_cb(const Glib::ustring& sender_name,
   if (signal_name == "PropertiesChanged" && !update_pending) {
     update_pending = true;
     /* The fail count may fluctuate due to restarting. */
-    Glib::signal_timeout().connect_once(sigc::mem_fun(*this, &SystemdFailedUnits::updateData),
-                                        UPDATE_DEBOUNCE_TIME_MS);
+    update_timer = Glib::signal_timeout().connect(
+        [this] {
+          updateData();
+          return false;
+        },
+        UPDATE_DEBOUNCE_TIME_MS);
   }
 }
 
-void SystemdFailedUnits::RequestSystemState() {
-  auto load = [](const char* kind, Glib::RefPtr<Gio::DBus::Proxy>& proxy) -> std::string {
-    try {
-      if (!proxy) return "unknown";
-      auto parameters = Glib::VariantContainerBase(
-          g_variant_new("(ss)", "org.freedesktop.systemd1.Manager", "SystemState"));
-      Glib::VariantContainerBase data = proxy->call_sync("Get", parameters);
-      if (data && data.is_of_type(Glib::VariantType("(v)"))) {
-        Glib::VariantBase variant;
-        g_variant_get(data.gobj_copy(), "(v)", &variant);
-        if (variant && variant.is_of_type(Glib::VARIANT_TYPE_STRING)) {
-          return g_variant_get_string(variant.gobj_copy(), NULL);
+void SystemdFailedUnits::CreateProxy(const char* kind, Gio::DBus::BusType bus,
+                                     Glib::RefPtr<Gio::DBus::Proxy>& proxy) {
+  ++proxies_pending;
+  Gio::DBus::Proxy::create_for_bus(
+      bus, "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
+      "org.freedesktop.DBus.Properties",
+      [this, kind, cancellable = this->cancellable,
+       &proxy](Glib::RefPtr<Gio::AsyncResult>& result) {
+        if (cancellable->is_cancelled()) return;
+        try {
+          proxy = Gio::DBus::Proxy::create_for_bus_finish(result);
+          proxy->signal_signal().connect(sigc::mem_fun(*this, &SystemdFailedUnits::notify_cb));
+        } catch (const Glib::Error& e) {
+          spdlog::error("Unable to connect to {} systemd DBus: {}", kind, e.what().c_str());
         }
-      }
-    } catch (Glib::Error& e) {
-      spdlog::error("Failed to get {} state: {}", kind, e.what().c_str());
-    }
-    return "unknown";
-  };
-
-  system_state = load("systemwide", system_proxy);
-  user_state = load("user", user_proxy);
+        if (--proxies_pending == 0) updateData();
+      },
+      cancellable);
+}
+
+void SystemdFailedUnits::RequestManagerState(const char* kind,
+                                             const Glib::RefPtr<Gio::DBus::Proxy>& proxy,
+                                             std::string& state, uint32_t& nr_failed_units) {
+  if (!proxy) {
+    state = "unknown";
+    nr_failed_units = 0;
+    return;
+  }
+
+  auto parameters = Glib::VariantContainerBase::create_tuple(
+      {Glib::Variant<Glib::ustring>::create("org.freedesktop.systemd1.Manager")});
+  ++requests_in_flight;
+  proxy->call(
+      "GetAll",
+      [this, kind, proxy, cancellable = this->cancellable, &state,
+       &nr_failed_units](Glib::RefPtr<Gio::AsyncResult>& result) {
+        if (cancellable->is_cancelled()) return;
+        --requests_in_flight;
+
+        state = "unknown";
+        nr_failed_units = 0;
+        try {
+          auto reply = proxy->call_finish(result);
+          // extract "a{sv}" from VariantContainerBase
+          Glib::Variant<std::map<Glib::ustring, Glib::VariantBase>> properties;
+          reply.get_child(properties);
+          for (const auto& [name, value] : properties.get()) {
+            if (name == "SystemState" && value.is_of_type(Glib::VARIANT_TYPE_STRING)) {
+              state = Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::ustring>>(value).get();
+            } else if (name == "NFailedUnits" && value.is_of_type(Glib::VARIANT_TYPE_UINT32)) {
+              nr_failed_units =
+                  Glib::VariantBase::cast_dynamic<Glib::Variant<uint32_t>>(value).get();
+            }
+          }
+        } catch (const Glib::Error& e) {
+          spdlog::error("Failed to get {} state: {}", kind, e.what().c_str());
+        } catch (const std::exception& e) {
+          spdlog::error("Failed to get {} state: {}", kind, e.what());
+        }
+
+        if (requests_in_flight == 0) applyManagerStates();
+      },
+      cancellable, parameters);
+}
+
+void SystemdFailedUnits::applyManagerStates() {
   if (system_state == "running" && user_state == "running")
     overall_state = "ok";
   else
     overall_state = "degraded";
-}
-
-void SystemdFailedUnits::RequestFailedUnits() {
-  auto load = [](const char* kind, Glib::RefPtr<Gio::DBus::Proxy>& proxy) -> uint32_t {
-    try {
-      if (!proxy) return 0;
-      auto parameters = Glib::VariantContainerBase(
-          g_variant_new("(ss)", "org.freedesktop.systemd1.Manager", "NFailedUnits"));
-      Glib::VariantContainerBase data = proxy->call_sync("Get", parameters);
-      if (data && data.is_of_type(Glib::VariantType("(v)"))) {
-        Glib::VariantBase variant;
-        g_variant_get(data.gobj_copy(), "(v)", &variant);
-        if (variant && variant.is_of_type(Glib::VARIANT_TYPE_UINT32)) {
-          return g_variant_get_uint32(variant.gobj_copy());
-        }
-      }
-    } catch (Glib::Error& e) {
-      spdlog::error("Failed to get {} failed units: {}", kind, e.what().c_str());
-    }
-    return 0;
-  };
-
-  nr_failed_system = load("systemwide", system_proxy);
-  nr_failed_user = load("user", user_proxy);
   nr_failed = nr_failed_system + nr_failed_user;
+
+  dp.emit();
+
+  // Changes signalled while the replies were on their way
+  if (std::exchange(requery, false)) updateData();
 }
 
 void SystemdFailedUnits::updateData() {
   update_pending = false;
 
-  RequestSystemState();
-  if (overall_state == "degraded") RequestFailedUnits();
+  /* One GetAll per manager, and only one round of them at a time: a request made meanwhile
+   * waits for their replies. */
+  if (requests_in_flight > 0) {
+    requery = true;
+    return;
+  }
 
-  dp.emit();
+  RequestManagerState("systemwide", system_proxy, system_state, nr_failed_system);
+  RequestManagerState("user", user_proxy, user_state, nr_failed_user);
+  if (requests_in_flight == 0) applyManagerStates();
 }
 
 auto SystemdFailedUnits::update() -> void {
-  if (last_status == overall_state) return;
+  if (last_status == overall_state && last_nr_failed == nr_failed) return;
 
   // Hide if needed.
   if (overall_state == "ok" && hide_on_ok) {
@@ -150,6 +181,7 @@ auto SystemdFailedUnits::update() -> void {
   }
 
   last_status = overall_state;
+  last_nr_failed = nr_failed;
 
   label_.set_markup(fmt::format(
       fmt::runtime(nr_failed == 0 ? format_ok : format_), fmt::arg("nr_failed", nr_failed),
@@ -1,17 +1,39 @@
 #include "modules/temperature.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <string>
 
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
+#else
+#include "util/proc_file.hpp"
+#include "util/shared_instance.hpp"
 #endif
 
-waybar::modules::Temperature::Temperature(const std::string& id, const Json::Value& config)
-    : ALabel(config, "temperature", id, "{temperatureC}°C", 10) {
-#if defined(__FreeBSD__)
-// FreeBSD uses sysctlbyname instead of read from a file
-#else
+#if !defined(__FreeBSD__)
+namespace waybar::modules {
+
+struct ThermalSensor {
+  explicit ThermalSensor(std::string path) : file{std::move(path)} {}
+
+  util::ProcFile file;
+  float celsius = 0;
+  std::string error;  // why the last pass couldn't read it, if it couldn't
+};
+
+}  // namespace waybar::modules
+
+namespace {
+
+using waybar::modules::ThermalSensor;
+
+// The input file a module config points at. Globbing the hwmon directories happens once per
+// distinct config, the sampler keeps the result for as long as a module uses it.
+std::string resolveSensorPath(const Json::Value& config) {
+  std::string file_path;
   auto traverseAsArray = [](const Json::Value& value, auto&& check_set_path) {
     if (value.isString())
       check_set_path(value.asString());
@@ -21,50 +43,125 @@ waybar::modules::Temperature::Temperature(const std::string& id, const Json::Val
   };
 
   // if hwmon_path is an array, loop to find first valid item
-  traverseAsArray(config_["hwmon-path"], [this](const std::string& path) {
+  traverseAsArray(config["hwmon-path"], [&file_path](const std::string& path) {
     if (!std::filesystem::exists(path)) return false;
-    file_path_ = path;
+    file_path = path;
     return true;
   });
 
-  if (file_path_.empty() && config_["input-filename"].isString()) {
+  if (file_path.empty() && config["input-filename"].isString()) {
     // fallback to hwmon_paths-abs
-    traverseAsArray(config_["hwmon-path-abs"], [this](const std::string& path) {
+    traverseAsArray(config["hwmon-path-abs"], [&](const std::string& path) {
       if (!std::filesystem::is_directory(path)) return false;
       return std::ranges::any_of(
-          std::filesystem::directory_iterator(path), [this](const auto& hwmon) {
+          std::filesystem::directory_iterator(path), [&](const auto& hwmon) {
             if (!hwmon.path().filename().string().starts_with("hwmon")) return false;
-            file_path_ = hwmon.path().string() + "/" + config_["input-filename"].asString();
+            file_path = hwmon.path().string() + "/" + config["input-filename"].asString();
             return true;
           });
     });
   }
 
-  if (file_path_.empty()) {
-    auto zone = config_["thermal-zone"].isInt() ? config_["thermal-zone"].asInt() : 0;
-    file_path_ = fmt::format("/sys/class/thermal/thermal_zone{}/temp", zone);
+  if (file_path.empty()) {
+    auto zone = config["thermal-zone"].isInt() ? config["thermal-zone"].asInt() : 0;
+    file_path = fmt::format("/sys/class/thermal/thermal_zone{}/temp", zone);
   }
+  return file_path;
+}
+
+/* Every sensor of every temperature module, with its input file kept open. A stale snapshot is
+ * refreshed for all sensors in one pass, so the modules ticking together, whether for the same
+ * sensor on several bars or for the CPU, GPU and NVMe sensors side by side, share it.
+ */
+class ThermalSampler {
+ public:
+  static ThermalSampler& inst() {
+    static auto* sampler = new ThermalSampler();
+    return *sampler;
+  }
+
+  // The sensor of a module config, shared by the modules with the same sensor options. Throws
+  // std::runtime_error if its input can't be read.
+  std::shared_ptr<ThermalSensor> sensor(const Json::Value& config) {
+    const auto key = waybar::util::SharedSample<float>::sourceOf(
+        "temperature", config, {"hwmon-path", "hwmon-path-abs", "input-filename", "thermal-zone"});
+    std::lock_guard lock(mutex_);
+    return sensors_.get(key, [&config] {
+      auto sensor = std::make_shared<ThermalSensor>(resolveSensorPath(config));
+      // check if the path can be used to retrieve the temperature
+      sensor->celsius = parse(sensor->file.read());
+      return sensor;
+    });
+  }
+
+  // The temperature of sensor in the current snapshot, throws if it couldn't be read
+  float sample(const ThermalSensor& sensor) {
+    std::lock_guard lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    if (now - sampledAt_ >= MAX_AGE) {
+      readAll();
+      sampledAt_ = now;
+    }
+    if (!sensor.error.empty()) {
+      throw std::runtime_error(sensor.error);
+    }
+    return sensor.celsius;
+  }
+
+ private:
+  // Modules on the same tick update within a few milliseconds of each other
+  static constexpr std::chrono::milliseconds MAX_AGE{250};
+
+  ThermalSampler() = default;
 
-  // check if file_path_ can be used to retrieve the temperature
-  std::ifstream temp(file_path_);
-  if (!temp.is_open()) {
-    throw std::runtime_error("Can't open " + file_path_);
+  static float parse(std::string_view text) {
+    long millidegrees = 0;
+    waybar::util::nextNumber(text, millidegrees);
+    return millidegrees / 1000.0;
   }
-  if (!temp.good()) {
-    temp.close();
-    throw std::runtime_error("Can't read from " + file_path_);
+
+  void readAll() {
+    sensors_.forEach([](const std::shared_ptr<ThermalSensor>& sensor) {
+      try {
+        sensor->celsius = parse(sensor->file.read());
+        sensor->error.clear();
+      } catch (const std::runtime_error& e) {
+        sensor->error = e.what();
+      }
+    });
   }
-  temp.close();
+
+  std::mutex mutex_;
+  waybar::util::SharedInstances<std::string, ThermalSensor> sensors_;
+  std::chrono::steady_clock::time_point sampledAt_;
+};
+
+}  // namespace
 #endif
 
-  thread_ = [this] {
-    dp.emit();
-    thread_.sleep_for(interval_);
-  };
+waybar::modules::Temperature::Temperature(const std::string& id, const Json::Value& config)
+    : ALabel(config, "temperature", id, "{temperatureC}°C", 10) {
+#if defined(__FreeBSD__)
+  // FreeBSD uses sysctlbyname instead of read from a file, the zone is the source
+  sample_ = util::SharedSample<float>::get(
+      util::SharedSample<float>::sourceOf("temperature", config_, {"thermal-zone"}), interval_);
+#else
+  sensor_ = ThermalSampler::inst().sensor(config_);
+#endif
+  timer_.start(interval_, [this] { dp.emit(); }, interval_on_battery_);
+}
+
+auto waybar::modules::Temperature::setPaused(bool paused) -> void {
+  ALabel::setPaused(paused);
+  timer_.pause(paused);
 }
 
 auto waybar::modules::Temperature::update() -> void {
-  auto temperature = getTemperature();
+#if defined(__FreeBSD__)
+  auto temperature = *sample_->sample([this](const float*) { return getTemperature(); });
+#else
+  auto temperature = ThermalSampler::inst().sample(*sensor_);
+#endif
   uint16_t temperature_c = std::round(temperature);
   uint16_t temperature_f = std::round(temperature * 1.8 + 32);
   uint16_t temperature_k = std::round(temperature + 273.15);
@@ -109,8 +206,8 @@ auto waybar::modules::Temperature::update() -> void {
   ALabel::update();
 }
 
-float waybar::modules::Temperature::getTemperature() {
 #if defined(__FreeBSD__)
+float waybar::modules::Temperature::getTemperature() {
   int temp;
   size_t size = sizeof temp;
 
@@ -127,24 +224,8 @@ float waybar::modules::Temperature::getTemperature() {
 
   throw std::runtime_error(fmt::format(
       "sysctl hw.acpi.thermal.tz{}.temperature and dev.cpu.{}.temperature failed", zone, zone));
-
-#else  // Linux
-  std::ifstream temp(file_path_);
-  if (!temp.is_open()) {
-    throw std::runtime_error("Can't open " + file_path_);
-  }
-  std::string line;
-  if (temp.good()) {
-    getline(temp, line);
-  } else {
-    temp.close();
-    throw std::runtime_error("Can't read from " + file_path_);
-  }
-  temp.close();
-  auto temperature_c = std::strtol(line.c_str(), nullptr, 10) / 1000.0;
-  return temperature_c;
-#endif
 }
+#endif
 
 bool waybar::modules::Temperature::isWarning(uint16_t temperature_c) {
   return config_["warning-threshold"].isInt() &&
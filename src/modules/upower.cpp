@@ -58,24 +58,12 @@ UPower::UPower(const std::string &id, const Json::Value &config)
   Gio::DBus::Connection::get(Gio::DBus::BusType::BUS_TYPE_SYSTEM,
                              sigc::mem_fun(*this, &UPower::getConn_cb));
 
-  // Make UPower client
-  GError **gErr = NULL;
-  upClient_ = up_client_new_full(NULL, gErr);
-  if (upClient_ == NULL)
-    spdlog::error("Upower. UPower client connection error. {}", (*gErr)->message);
-
-  // Subscribe UPower events
-  g_signal_connect(upClient_, "device-added", G_CALLBACK(deviceAdded_cb), this);
-  g_signal_connect(upClient_, "device-removed", G_CALLBACK(deviceRemoved_cb), this);
-
   // Subscribe tooltip query events
   box_.set_has_tooltip(AModule::tooltipEnabled());
   if (AModule::tooltipEnabled()) {
     box_.signal_query_tooltip().connect(sigc::mem_fun(*this, &UPower::queryTooltipCb), false);
   }
 
-  resetDevices();
-  setDisplayDevice();
   // Update the widget
   dp.emit();
 }
@@ -193,8 +181,6 @@ auto UPower::update() -> void {
     return;
   }
 
-  getUpDeviceInfo(upDevice_);
-
   if (upDevice_.upDevice == NULL && hideIfEmpty_) {
     box_.hide();
     return;
@@ -206,11 +192,7 @@ auto UPower::update() -> void {
                            upDevice_.kind != UpDeviceKind::UP_DEVICE_KIND_LINE_POWER};
   // Get CSS status
   const auto status{getDeviceStatus(upDevice_.state)};
-  // Remove last status if it exists
-  if (!lastStatus_.empty() && box_.get_style_context()->has_class(lastStatus_))
-    box_.get_style_context()->remove_class(lastStatus_);
-  if (!box_.get_style_context()->has_class(status)) box_.get_style_context()->add_class(status);
-  lastStatus_ = status;
+  status_class_.set(status);
 
   if (devices_.size() == 0 && !upDeviceValid && hideIfEmpty_) {
     box_.hide();
@@ -221,9 +203,8 @@ auto UPower::update() -> void {
 
   label_.set_markup(getText(upDevice_, format_));
   // Set icon
-  if (upDevice_.icon_name == NULL || !gtkTheme_->has_icon(upDevice_.icon_name))
-    upDevice_.icon_name = (char *)NO_BATTERY.c_str();
-  image_.set_from_icon_name(upDevice_.icon_name, Gtk::ICON_SIZE_INVALID);
+  const bool hasIcon{!upDevice_.icon_name.empty() && gtkTheme_->has_icon(upDevice_.icon_name)};
+  image_.set_from_icon_name(hasIcon ? upDevice_.icon_name : NO_BATTERY, Gtk::ICON_SIZE_INVALID);
 
   box_.show();
 
@@ -247,6 +228,25 @@ void UPower::getConn_cb(Glib::RefPtr<Gio::AsyncResult> &result) {
 void UPower::onAppear(const Glib::RefPtr<Gio::DBus::Connection> &conn, const Glib::ustring &name,
                       const Glib::ustring &name_owner) {
   upRunning_ = true;
+  if (upClient_ == NULL) {
+    // Made once the daemon runs: creating it doesn't wait for an activation or a timeout
+    GError *gErr{NULL};
+    upClient_ = up_client_new_full(NULL, &gErr);
+    if (upClient_ == NULL) {
+      spdlog::error("Upower. UPower client connection error. {}", gErr->message);
+      g_error_free(gErr);
+      return;
+    }
+
+    // Subscribe UPower events
+    g_signal_connect(upClient_, "device-added", G_CALLBACK(deviceAdded_cb), this);
+    g_signal_connect(upClient_, "device-removed", G_CALLBACK(deviceRemoved_cb), this);
+
+    resetDevices();
+    setDisplayDevice();
+  }
+  // Update the widget
+  dp.emit();
 }
 
 void UPower::onVanished(const Glib::RefPtr<Gio::DBus::Connection> &conn,
@@ -262,14 +262,15 @@ void UPower::prepareForSleep_cb(const Glib::RefPtr<Gio::DBus::Connection> &conne
   if (parameters.is_of_type(Glib::VariantType("(b)"))) {
     Glib::Variant<bool> sleeping;
     parameters.get_child(sleeping, 0);
-    if (!sleeping.get()) {
+    if (!sleeping.get() && upClient_ != NULL) {
       resetDevices();
       setDisplayDevice();
       sleeping_ = false;
       // Update the widget
       dp.emit();
-    } else
-      sleeping_ = true;
+    } else {
+      sleeping_ = sleeping.get();
+    }
   }
 }
 
@@ -290,9 +291,28 @@ void UPower::deviceRemoved_cb(UpClient *client, const gchar *objectPath, gpointe
 }
 
 void UPower::deviceNotify_cb(UpDevice *device, GParamSpec *pspec, gpointer data) {
-  UPower *up{static_cast<UPower *>(data)};
+  static_cast<UPower *>(data)->onDeviceNotify(device, pspec->name);
+}
+
+/* Devices notify each property on its own, most of them (energy, voltage, update-time...) not
+ * shown here. Only a change to a shown one updates the widget or marks the tooltip row stale.
+ */
+void UPower::onDeviceNotify(UpDevice *device, const gchar *property) {
+  bool displayChanged{false};
+  {
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (device == upDevice_.upDevice) displayChanged = readProperty(upDevice_, property);
+
+    const gchar *objectPath{up_device_get_object_path(device)};
+    if (objectPath != NULL) {
+      auto it{devices_.find(objectPath)};
+      if (it != devices_.end() && it->second.upDevice == device &&
+          readProperty(it->second, property))
+        it->second.tooltipDirty = true;
+    }
+  }
   // Update the widget
-  up->dp.emit();
+  if (displayChanged) dp.emit();
 }
 
 void UPower::addDevice(UpDevice *device) {
@@ -301,20 +321,16 @@ void UPower::addDevice(UpDevice *device) {
   if (G_IS_OBJECT(device)) {
     const gchar *objectPath{up_device_get_object_path(device)};
 
-    // Due to the device getting cleared after this event is fired, we
-    // create a new object pointing to its objectPath
-    device = up_device_new();
+    // The client drops the device after this event is fired, the reference keeps it
+    g_object_ref(device);
     upDevice_output upDevice{.upDevice = device};
-    gboolean ret{up_device_set_object_path_sync(device, objectPath, NULL, NULL)};
-    if (!ret) {
-      g_object_unref(G_OBJECT(device));
-      return;
-    }
+    getUpDeviceInfo(upDevice);
 
     if (devices_.find(objectPath) != devices_.cend()) {
       auto upDevice{devices_[objectPath]};
       if (G_IS_OBJECT(upDevice.upDevice)) g_object_unref(upDevice.upDevice);
       devices_.erase(objectPath);
+      removeTooltipRow(objectPath);
     }
 
     g_signal_connect(device, "notify", G_CALLBACK(deviceNotify_cb), this);
@@ -328,6 +344,15 @@ void UPower::removeDevice(const gchar *objectPath) {
     auto upDevice{devices_[objectPath]};
     if (G_IS_OBJECT(upDevice.upDevice)) g_object_unref(upDevice.upDevice);
     devices_.erase(objectPath);
+    removeTooltipRow(objectPath);
+  }
+}
+
+void UPower::removeTooltipRow(const std::string &objectPath) {
+  auto row{tooltipRows_.find(objectPath)};
+  if (row != tooltipRows_.end()) {
+    contentBox_.remove(*row->second.box);
+    tooltipRows_.erase(row);
   }
 }
 
@@ -340,6 +365,8 @@ void UPower::removeDevices() {
       devices_.erase(it++);
     }
   }
+  for (auto &[objectPath, row] : tooltipRows_) contentBox_.remove(*row.box);
+  tooltipRows_.clear();
 }
 
 // Removes all devices and adds the current devices
@@ -349,27 +376,32 @@ void UPower::resetDevices() {
 
   // Adds all devices
   GPtrArray *newDevices = up_client_get_devices2(upClient_);
-  if (newDevices != NULL)
+  if (newDevices != NULL) {
     for (guint i{0}; i < newDevices->len; ++i) {
       UpDevice *device{(UpDevice *)g_ptr_array_index(newDevices, i)};
       if (device && G_IS_OBJECT(device)) addDevice(device);
     }
+    g_ptr_array_unref(newDevices);
+  }
 }
 
 void UPower::setDisplayDevice() {
   std::lock_guard<std::mutex> guard{mutex_};
 
   if (upDevice_.upDevice != NULL) {
+    g_signal_handlers_disconnect_by_data(upDevice_.upDevice, this);
     g_object_unref(upDevice_.upDevice);
-    upDevice_.upDevice = NULL;
   }
+  upDevice_ = upDevice_output{};
 
   if (nativePath_.empty() && model_.empty()) {
     upDevice_.upDevice = up_client_get_display_device(upClient_);
     getUpDeviceInfo(upDevice_);
   } else {
+    GPtrArray *devices{up_client_get_devices2(upClient_)};
+    if (devices == NULL) return;
     g_ptr_array_foreach(
-        up_client_get_devices2(upClient_),
+        devices,
         [](gpointer data, gpointer user_data) {
           upDevice_output upDevice;
           auto thisPtr{static_cast<UPower *>(user_data)};
@@ -377,35 +409,80 @@ void UPower::setDisplayDevice() {
           thisPtr->getUpDeviceInfo(upDevice);
           upDevice_output displayDevice{NULL};
           if (!thisPtr->nativePath_.empty()) {
-            if (upDevice.nativePath == nullptr) return;
-            if (0 == std::strcmp(upDevice.nativePath, thisPtr->nativePath_.c_str())) {
+            if (upDevice.nativePath == thisPtr->nativePath_) {
               displayDevice = upDevice;
             }
           } else {
-            if (upDevice.model == nullptr) return;
-            if (0 == std::strcmp(upDevice.model, thisPtr->model_.c_str())) {
+            if (upDevice.model == thisPtr->model_) {
               displayDevice = upDevice;
             }
           }
-          // Unref current upDevice if it exists
+          // Take over the last matching device, the array drops its references
           if (displayDevice.upDevice != NULL) {
+            if (thisPtr->upDevice_.upDevice != NULL) g_object_unref(thisPtr->upDevice_.upDevice);
             thisPtr->upDevice_ = displayDevice;
+            g_object_ref(thisPtr->upDevice_.upDevice);
           }
         },
         this);
+    g_ptr_array_unref(devices);
   }
 
   if (upDevice_.upDevice != NULL)
     g_signal_connect(upDevice_.upDevice, "notify", G_CALLBACK(deviceNotify_cb), this);
 }
 
+namespace {
+
+// The properties shown by the label or the tooltip
+constexpr const char *SHOWN_PROPERTIES[]{
+    "kind",         "state",       "percentage", "icon-name", "time-to-empty",
+    "time-to-full", "temperature", "native-path", "model"};
+
+template <typename T>
+bool readValue(UpDevice *device, const gchar *property, T &value) {
+  T newValue{};
+  g_object_get(device, property, &newValue, NULL);
+  if (newValue == value) return false;
+  value = newValue;
+  return true;
+}
+
+bool readValue(UpDevice *device, const gchar *property, std::string &value) {
+  gchar *newValue{NULL};
+  g_object_get(device, property, &newValue, NULL);
+  const bool changed{value != (newValue != NULL ? newValue : "")};
+  if (changed) value = newValue != NULL ? newValue : "";
+  g_free(newValue);
+  return changed;
+}
+
+}  // namespace
+
+bool UPower::readProperty(upDevice_output &upDevice_, const gchar *property) {
+  if (upDevice_.upDevice == NULL || !G_IS_OBJECT(upDevice_.upDevice)) return false;
+  UpDevice *device{upDevice_.upDevice};
+  if (std::strcmp(property, "kind") == 0) return readValue(device, property, upDevice_.kind);
+  if (std::strcmp(property, "state") == 0) return readValue(device, property, upDevice_.state);
+  if (std::strcmp(property, "percentage") == 0)
+    return readValue(device, property, upDevice_.percentage);
+  if (std::strcmp(property, "icon-name") == 0)
+    return readValue(device, property, upDevice_.icon_name);
+  if (std::strcmp(property, "time-to-empty") == 0)
+    return readValue(device, property, upDevice_.time_empty);
+  if (std::strcmp(property, "time-to-full") == 0)
+    return readValue(device, property, upDevice_.time_full);
+  if (std::strcmp(property, "temperature") == 0)
+    return readValue(device, property, upDevice_.temperature);
+  if (std::strcmp(property, "native-path") == 0)
+    return readValue(device, property, upDevice_.nativePath);
+  if (std::strcmp(property, "model") == 0) return readValue(device, property, upDevice_.model);
+  return false;
+}
+
 void UPower::getUpDeviceInfo(upDevice_output &upDevice_) {
   if (upDevice_.upDevice != NULL && G_IS_OBJECT(upDevice_.upDevice)) {
-    g_object_get(upDevice_.upDevice, "kind", &upDevice_.kind, "state", &upDevice_.state,
-                 "percentage", &upDevice_.percentage, "icon-name", &upDevice_.icon_name,
-                 "time-to-empty", &upDevice_.time_empty, "time-to-full", &upDevice_.time_full,
-                 "temperature", &upDevice_.temperature, "native-path", &upDevice_.nativePath,
-                 "model", &upDevice_.model, NULL);
+    for (const auto *property : SHOWN_PROPERTIES) readProperty(upDevice_, property);
     spdlog::debug(
         "UPower. getUpDeviceInfo. kind: \"{0}\". state: \"{1}\". percentage: \"{2}\". \
 icon_name: \"{3}\". time-to-empty: \"{4}\". time-to-full: \"{5}\". temperature: \"{6}\". \
@@ -444,50 +521,61 @@ const Glib::ustring UPower::getText(const upDevice_output &upDevice_, const std:
   return ret;
 }
 
+UPower::TooltipRow UPower::makeTooltipRow() {
+  // Make box record
+  TooltipRow row{.box = std::make_unique<Gtk::Box>(box_.get_orientation(), tooltip_spacing_)};
+  auto *boxDev{Gtk::make_managed<Gtk::Box>(box_.get_orientation())};
+  auto *boxUsr{Gtk::make_managed<Gtk::Box>(box_.get_orientation())};
+  row.box->add(*boxDev);
+  row.box->add(*boxUsr);
+  // Device box: icon from kind, label from model
+  row.iconDev = Gtk::make_managed<Gtk::Image>();
+  row.iconDev->set_pixel_size(iconSize_);
+  boxDev->add(*row.iconDev);
+  row.labelDev = Gtk::make_managed<Gtk::Label>();
+  boxDev->add(*row.labelDev);
+  // User box: icon from icon state, formatted text
+  row.iconState = Gtk::make_managed<Gtk::Image>();
+  row.iconState->set_pixel_size(iconSize_);
+  boxUsr->add(*row.iconState);
+  row.labelText = Gtk::make_managed<Gtk::Label>();
+  boxUsr->add(*row.labelText);
+  return row;
+}
+
+void UPower::fillTooltipRow(TooltipRow &row, const upDevice_output &upDevice) {
+  UpDeviceKind kind{upDevice.kind};
+  std::string iconNameDev{getDeviceIcon(kind)};
+  if (!gtkTheme_->has_icon(iconNameDev)) iconNameDev = NO_BATTERY;
+  row.iconDev->set_from_icon_name(iconNameDev, Gtk::ICON_SIZE_INVALID);
+  row.labelDev->set_text(upDevice.model);
+
+  const bool hasIcon{!upDevice.icon_name.empty() && gtkTheme_->has_icon(upDevice.icon_name)};
+  row.iconState->set_from_icon_name(hasIcon ? upDevice.icon_name : NO_BATTERY,
+                                    Gtk::ICON_SIZE_INVALID);
+  row.labelText->set_markup(getText(upDevice, tooltipFormat_));
+}
+
 bool UPower::queryTooltipCb(int x, int y, bool keyboard_tooltip,
                             const Glib::RefPtr<Gtk::Tooltip> &tooltip) {
   std::lock_guard<std::mutex> guard{mutex_};
 
-  // Clear content box
-  contentBox_.forall([this](Gtk::Widget &wg) { contentBox_.remove(wg); });
-
-  // Fill content box with the content
-  for (auto pairDev : devices_) {
-    // Get device info
-    getUpDeviceInfo(pairDev.second);
-
-    if (pairDev.second.kind != UpDeviceKind::UP_DEVICE_KIND_UNKNOWN &&
-        pairDev.second.kind != UpDeviceKind::UP_DEVICE_KIND_LINE_POWER) {
-      // Make box record
-      Gtk::Box *boxRec{new Gtk::Box{box_.get_orientation(), tooltip_spacing_}};
-      contentBox_.add(*boxRec);
-      Gtk::Box *boxDev{new Gtk::Box{box_.get_orientation()}};
-      Gtk::Box *boxUsr{new Gtk::Box{box_.get_orientation()}};
-      boxRec->add(*boxDev);
-      boxRec->add(*boxUsr);
-      // Construct device box
-      // Set icon from kind
-      std::string iconNameDev{getDeviceIcon(pairDev.second.kind)};
-      if (!gtkTheme_->has_icon(iconNameDev)) iconNameDev = (char *)NO_BATTERY.c_str();
-      Gtk::Image *iconDev{new Gtk::Image{}};
-      iconDev->set_from_icon_name(iconNameDev, Gtk::ICON_SIZE_INVALID);
-      iconDev->set_pixel_size(iconSize_);
-      boxDev->add(*iconDev);
-      // Set label from model
-      Gtk::Label *labelDev{new Gtk::Label{pairDev.second.model}};
-      boxDev->add(*labelDev);
-      // Construct user box
-      // Set icon from icon state
-      if (pairDev.second.icon_name == NULL || !gtkTheme_->has_icon(pairDev.second.icon_name))
-        pairDev.second.icon_name = (char *)NO_BATTERY.c_str();
-      Gtk::Image *iconTooltip{new Gtk::Image{}};
-      iconTooltip->set_from_icon_name(pairDev.second.icon_name, Gtk::ICON_SIZE_INVALID);
-      iconTooltip->set_pixel_size(iconSize_);
-      boxUsr->add(*iconTooltip);
-      // Set markup text
-      Gtk::Label *labelTooltip{new Gtk::Label{}};
-      labelTooltip->set_markup(getText(pairDev.second, tooltipFormat_));
-      boxUsr->add(*labelTooltip);
+  // Keep one record per battery, refilling those whose device changed
+  for (auto &[objectPath, upDevice] : devices_) {
+    if (upDevice.kind == UpDeviceKind::UP_DEVICE_KIND_UNKNOWN ||
+        upDevice.kind == UpDeviceKind::UP_DEVICE_KIND_LINE_POWER) {
+      removeTooltipRow(objectPath);
+      continue;
+    }
+    auto row{tooltipRows_.find(objectPath)};
+    if (row == tooltipRows_.end()) {
+      row = tooltipRows_.emplace(objectPath, makeTooltipRow()).first;
+      contentBox_.add(*row->second.box);
+      upDevice.tooltipDirty = true;
+    }
+    if (upDevice.tooltipDirty) {
+      fillTooltipRow(row->second, upDevice);
+      upDevice.tooltipDirty = false;
     }
   }
   tooltip->set_custom(contentBox_);
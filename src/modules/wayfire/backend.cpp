@@ -7,8 +7,10 @@
 
 #include <algorithm>
 #include <bit>
+#include <cerrno>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <ranges>
 #include <thread>
@@ -30,10 +32,27 @@ auto pack_and_write(Sock& sock, std::string&& buf) -> void {
   (void)write(sock.fd, buf.data(), buf.size());
 }
 
-auto read_exact(Sock& sock, size_t n) -> std::string {
-  auto buf = std::string(n, 0);
-  for (size_t i = 0; i < n;) i += read(sock.fd, &buf[i], n - i);
-  return buf;
+auto read_exact(Sock& sock, char* buf, size_t n) -> void {
+  for (size_t i = 0; i < n;) {
+    auto r = read(sock.fd, buf + i, n - i);
+    if (r > 0) {
+      i += r;
+    } else if (r == 0) {
+      throw std::runtime_error{"Wayfire IPC: connection closed"};
+    } else if (errno != EINTR) {
+      throw std::runtime_error{std::string{"Wayfire IPC: read() failed: "} + strerror(errno)};
+    }
+  }
+}
+
+// Assigns in place, so that a view updated again keeps the capacity of its strings
+inline auto assign_string(std::string& str, const Json::Value& value) -> void {
+  const char* begin;
+  const char* end;
+  if (value.getString(&begin, &end))
+    str.assign(begin, end);
+  else
+    str.clear();
 }
 
 // https://github.com/WayfireWM/pywayfire/blob/69b7c21/wayfire/ipc.py#L438
@@ -48,42 +67,58 @@ auto State::Wset::count_ws(const Json::Value& pos) -> Workspace& {
   return wss.at(ws_w * y + x);
 }
 
-auto State::Wset::locate_ws(const Json::Value& geo) -> Workspace& {
-  return const_cast<Workspace&>(std::as_const(*this).locate_ws(geo));
+auto State::Wset::locate_ws(const View& view) -> Workspace& {
+  return const_cast<Workspace&>(std::as_const(*this).locate_ws(view));
 }
 
-auto State::Wset::locate_ws(const Json::Value& geo) const -> const Workspace& {
+auto State::Wset::locate_ws(const View& view) const -> const Workspace& {
   const auto& out = output.value().get();
-  auto [qx, rx] = std::div(geo["x"].asInt(), out.w);
-  auto [qy, ry] = std::div(geo["y"].asInt(), out.h);
+  auto [qx, rx] = std::div(view.x, (int)out.w);
+  auto [qy, ry] = std::div(view.y, (int)out.h);
   auto x = std::max(0, (int)ws_x + qx - int{rx < 0});
   auto y = std::max(0, (int)ws_y + qy - int{ry < 0});
   return wss.at(ws_w * y + x);
 }
 
-auto State::update_view(const Json::Value& view) -> void {
-  auto id = view["id"].asUInt();
+auto State::update_view(const Json::Value& data) -> void {
+  auto id = data["id"].asUInt();
+  auto it = views.find(id);
 
-  // erase old view information
-  if (views.contains(id)) {
-    auto& old_view = views.at(id);
-    auto& ws = wsets.at(old_view["wset-index"].asUInt()).locate_ws(old_view["geometry"]);
+  // erase old view information from its workspace
+  if (it != views.end()) {
+    const auto& old_view = it->second;
+    auto& ws = wsets.at(old_view.wset_idx).locate_ws(old_view);
     ws.num_views--;
-    if (old_view["sticky"].asBool()) ws.num_sticky_views--;
-    views.erase(id);
+    if (old_view.sticky) ws.num_sticky_views--;
   }
 
   // insert or assign new view information
-  if (is_mapped_toplevel_view(view)) {
+  if (is_mapped_toplevel_view(data)) {
+    const auto& geo = data["geometry"];
+    auto wset_idx = data["wset-index"].asUInt();
+    auto x = geo["x"].asInt();
+    auto y = geo["y"].asInt();
+    auto sticky = data["sticky"].asBool();
     try {
-      // view["wset-index"] could be messed up
-      auto& ws = wsets.at(view["wset-index"].asUInt()).locate_ws(view["geometry"]);
+      // data["wset-index"] could be messed up
+      auto& wset = wsets.at(wset_idx);
+      if (it == views.end()) it = views.try_emplace(id).first;
+      auto& view = it->second;
+      view.id = id;
+      view.wset_idx = wset_idx;
+      view.x = x;
+      view.y = y;
+      view.sticky = sticky;
+      assign_string(view.title, data["title"]);
+      assign_string(view.app_id, data["app-id"]);
+      auto& ws = wset.locate_ws(view);
       ws.num_views++;
-      if (view["sticky"].asBool()) ws.num_sticky_views++;
-      views.emplace(id, view);
+      if (sticky) ws.num_sticky_views++;
+      return;
     } catch (const std::exception&) {
     }
   }
+  if (it != views.end()) views.erase(it);
 }
 
 auto IPC::get_instance() -> std::shared_ptr<IPC> {
@@ -116,14 +151,18 @@ auto IPC::connect() -> Sock {
 }
 
 auto IPC::receive(Sock& sock) -> Json::Value {
-  auto len = *reinterpret_cast<uint32_t*>(read_exact(sock, 4).data());
+  thread_local std::string buf;
+  thread_local const std::unique_ptr<Json::CharReader> reader{reader_builder.newCharReader()};
+
+  uint32_t len;
+  read_exact(sock, reinterpret_cast<char*>(&len), sizeof(len));
   if constexpr (std::endian::native != std::endian::little) len = byteswap(len);
-  auto buf = read_exact(sock, len);
+  buf.resize(len);
+  read_exact(sock, buf.data(), len);
 
   Json::Value json;
   std::string err;
-  auto* reader = reader_builder.newCharReader();
-  if (!reader->parse(&*buf.begin(), &*buf.end(), &json, &err)) {
+  if (!reader->parse(buf.data(), buf.data() + buf.size(), &json, &err)) {
     throw std::runtime_error{"Wayfire IPC: parse json failed: " + err};
   }
   return json;
@@ -154,25 +193,29 @@ auto IPC::start() -> void {
   send("window-rules/get-focused-output", {});
 
   std::thread([&] {
-    auto sock = connect();
-
-    {
-      Json::Value json;
-      json["method"] = "window-rules/events/watch";
-
-      pack_and_write(sock, Json::writeString(writer_builder, json));
-      if (receive(sock)["result"] != "ok") {
-        spdlog::error(
-            "Wayfire IPC: method \"window-rules/events/watch\""
-            " have failed");
-        return;
+    try {
+      auto sock = connect();
+
+      {
+        Json::Value json;
+        json["method"] = "window-rules/events/watch";
+
+        pack_and_write(sock, Json::writeString(writer_builder, json));
+        if (receive(sock)["result"] != "ok") {
+          spdlog::error(
+              "Wayfire IPC: method \"window-rules/events/watch\""
+              " have failed");
+          return;
+        }
       }
-    }
 
-    while (auto json = receive(sock)) {
-      auto ev = json["event"].asString();
-      spdlog::debug("Wayfire IPC: received event \"{}\"", ev);
-      root_event_handler(ev, json);
+      while (auto json = receive(sock)) {
+        auto ev = json["event"].asString();
+        spdlog::debug("Wayfire IPC: received event \"{}\"", ev);
+        root_event_handler(ev, json);
+      }
+    } catch (const std::exception& e) {
+      spdlog::error("{}", e.what());
     }
   }).detach();
 }
@@ -312,7 +355,7 @@ auto IPC::update_state_handler(const std::string& event, const Json::Value& data
     if (state.vswitching) {
       if (state.vswitch_sticky_view_id == 0) {
         auto& wset = state.wsets.at(data["view"]["wset-index"].asUInt());
-        auto& old_ws = wset.locate_ws(state.views.at(data["view"]["id"].asUInt())["geometry"]);
+        auto& old_ws = wset.locate_ws(state.views.at(data["view"]["id"].asUInt()));
         auto& new_ws = wset.count_ws(data["to"]);
         old_ws.num_views--;
         new_ws.num_views++;
@@ -352,11 +395,10 @@ auto IPC::update_state_handler(const std::string& event, const Json::Value& data
     auto& out = wset.output.value().get();
     auto dx = (int)out.w * ((int)wset.ws_x - data["previous-workspace"]["x"].asInt());
     auto dy = (int)out.h * ((int)wset.ws_y - data["previous-workspace"]["y"].asInt());
-    for (auto& [_, view] : state.views) {
-      if (view["wset-index"].asUInt() == wset_idx &&
-          view["id"].asUInt() != state.vswitch_sticky_view_id) {
-        view["geometry"]["x"] = view["geometry"]["x"].asInt() - dx;
-        view["geometry"]["y"] = view["geometry"]["y"].asInt() - dy;
+    for (auto& [id, view] : state.views) {
+      if (view.wset_idx == wset_idx && id != state.vswitch_sticky_view_id) {
+        view.x -= dx;
+        view.y -= dy;
       }
     }
     return;
@@ -13,7 +13,8 @@ Window::Window(const std::string& id, const Bar& bar, const Json::Value& config)
     : AAppIconLabel(config, "window", id, "{title}", 0, true),
       ipc{IPC::get_instance()},
       handler{[this](const auto&) { dp.emit(); }},
-      bar_{bar} {
+      bar_{bar},
+      rewrite_{util::RewriteRules::shared(config["rewrite"])} {
   ipc->register_handler("view-unmapped", handler);
   ipc->register_handler("view-focused", handler);
   ipc->register_handler("view-title-changed", handler);
@@ -41,24 +42,22 @@ auto Window::update_icon_label() -> void {
 
   if (views.contains(wset.focused_view_id)) {
     const auto& view = views.at(wset.focused_view_id);
-    auto title = view["title"].asString();
-    auto app_id = view["app-id"].asString();
+    const auto& title = view.title;
+    const auto& app_id = view.app_id;
 
     // update label
-    label_.set_markup(waybar::util::rewriteString(
+    label_.set_markup(rewrite_->apply(
         fmt::format(fmt::runtime(format_), fmt::arg("title", waybar::util::sanitize_string(title)),
-                    fmt::arg("app_id", waybar::util::sanitize_string(app_id))),
-        config_["rewrite"]));
+                    fmt::arg("app_id", waybar::util::sanitize_string(app_id)))));
 
     // update window#waybar.solo
-    if (wset.locate_ws(view["geometry"]).num_views > 1)
+    if (wset.locate_ws(view).num_views > 1)
       ctx->remove_class("solo");
     else
       ctx->add_class("solo");
 
     // update window#waybar.<app_id>
-    ctx->remove_class(old_app_id_);
-    ctx->add_class(old_app_id_ = app_id);
+    app_id_class_.set(app_id);
 
     // update window#waybar.empty
     ctx->remove_class("empty");
@@ -2,22 +2,20 @@
 
 #include <spdlog/spdlog.h>
 
-bool isValidNodeId(uint32_t id) { return id > 0 && id < G_MAXUINT32; }
+#include <cmath>
 
-std::list<waybar::modules::Wireplumber*> waybar::modules::Wireplumber::modules;
+bool isValidNodeId(uint32_t id) { return id > 0 && id < G_MAXUINT32; }
 
 waybar::modules::Wireplumber::Wireplumber(const std::string& id, const Json::Value& config)
     : ALabel(config, "wireplumber", id, "{volume}%"),
-      wp_core_(nullptr),
-      apis_(nullptr),
       om_(nullptr),
       mixer_api_(nullptr),
       def_nodes_api_(nullptr),
       default_node_name_(nullptr),
-      pending_plugins_(0),
       muted_(false),
       volume_(0.0),
       min_step_(0.0),
+      scroll_(event_box_, [this](int steps) { applyScroll(steps); }),
       node_id_(0),
       node_name_(""),
       source_name_(""),
@@ -26,40 +24,16 @@ waybar::modules::Wireplumber::Wireplumber(const std::string& id, const Json::Val
       source_muted_(false),
       source_volume_(0.0),
       default_source_name_(nullptr) {
-  waybar::modules::Wireplumber::modules.push_back(this);
-
-  wp_init(WP_INIT_PIPEWIRE);
-  wp_core_ = wp_core_new(nullptr, nullptr, nullptr);
-  apis_ = g_ptr_array_new_with_free_func(g_object_unref);
-  om_ = wp_object_manager_new();
-
   type_ = g_strdup(config_["node-type"].isString() ? config_["node-type"].asString().c_str()
                                                    : "Audio/Sink");
 
-  prepare(this);
-
-  spdlog::debug("[{}]: connecting to pipewire: '{}'...", name_, type_);
-
-  if (wp_core_connect(wp_core_) == 0) {
-    spdlog::error("[{}]: Could not connect to PipeWire: '{}'", name_, type_);
-    throw std::runtime_error("Could not connect to PipeWire\n");
-  }
-
-  spdlog::debug("[{}]: {} connected!", name_, type_);
-
-  g_signal_connect_swapped(om_, "installed", (GCallback)onObjectManagerInstalled, this);
-
-  asyncLoadRequiredApiModules();
+  // One connection for all the modules, the first one to come makes it
+  context_ = util::WireplumberContext::getInstance();
+  context_->subscribe(this);
 }
 
 waybar::modules::Wireplumber::~Wireplumber() {
-  waybar::modules::Wireplumber::modules.remove(this);
-  wp_core_disconnect(wp_core_);
-  g_clear_pointer(&apis_, g_ptr_array_unref);
-  g_clear_object(&om_);
-  g_clear_object(&wp_core_);
-  g_clear_object(&mixer_api_);
-  g_clear_object(&def_nodes_api_);
+  context_->unsubscribe(this);
   g_free(default_node_name_);
   g_free(default_source_name_);
   g_free(type_);
@@ -156,11 +130,27 @@ void waybar::modules::Wireplumber::updateVolume(waybar::modules::Wireplumber* se
     throw std::runtime_error(err);
   }
 
-  g_variant_lookup(variant, "volume", "d", &self->volume_);
+  double volume = self->volume_;
+  bool muted = self->muted_;
+  g_variant_lookup(variant, "volume", "d", &volume);
   g_variant_lookup(variant, "step", "d", &self->min_step_);
-  g_variant_lookup(variant, "mute", "b", &self->muted_);
+  g_variant_lookup(variant, "mute", "b", &muted);
   g_clear_pointer(&variant, g_variant_unref);
 
+  if (self->volume_set_) {
+    constexpr auto VOLUME_SET_TIMEOUT = std::chrono::seconds(1);
+    if (std::abs(volume - *self->volume_set_) <= std::max(self->min_step_ / 2, 1e-4) ||
+        std::chrono::steady_clock::now() - self->volume_set_at_ > VOLUME_SET_TIMEOUT) {
+      self->volume_set_.reset();
+    } else {
+      volume = self->volume_;  // an echo, what it says is already outdated
+    }
+  }
+  if (volume == self->volume_ && muted == self->muted_) {
+    return;
+  }
+  self->volume_ = volume;
+  self->muted_ = muted;
   self->dp.emit();
 }
 
@@ -189,232 +179,114 @@ void waybar::modules::Wireplumber::updateSourceVolume(waybar::modules::Wireplumb
   self->dp.emit();
 }
 
-void waybar::modules::Wireplumber::onMixerChanged(waybar::modules::Wireplumber* self, uint32_t id) {
-  g_autoptr(WpNode) node = static_cast<WpNode*>(wp_object_manager_lookup(
-      self->om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=u", id, nullptr));
-
-  if (node == nullptr) {
-    // log a warning only if no other widget is targeting the id.
-    // this reduces log spam when multiple instances of the module are used on different node types.
-    if (id != self->node_id_ && id != self->source_node_id_) {
-      for (auto const& module : waybar::modules::Wireplumber::modules) {
-        if (module->node_id_ == id || module->source_node_id_ == id) {
-          return;
-        }
-      }
-    }
-
-    spdlog::warn("[{}]: (onMixerChanged: {}) - Object with id {} not found", self->name_,
-                 self->type_, id);
-    return;
-  }
-
-  const gchar* name = wp_pipewire_object_get_property(WP_PIPEWIRE_OBJECT(node), "node.name");
+bool waybar::modules::Wireplumber::watchesNode(uint32_t id) const {
+  return id == node_id_ || id == source_node_id_;
+}
 
-  if (self->node_id_ == id) {
-    spdlog::debug("[{}]: (onMixerChanged: {}) - updating sink volume for node: {}", self->name_,
-                  self->type_, name);
-    updateVolume(self, id);
-  } else if (self->source_node_id_ == id) {
-    spdlog::debug("[{}]: (onMixerChanged: {}) - updating source volume for node: {}", self->name_,
-                  self->type_, name);
-    updateSourceVolume(self, id);
+void waybar::modules::Wireplumber::onNodeMixerChanged(uint32_t id) {
+  if (node_id_ == id) {
+    spdlog::debug("[{}]: (onMixerChanged: {}) - updating sink volume for node: {}", name_, type_,
+                  id);
+    updateVolume(this, id);
+  } else if (source_node_id_ == id) {
+    spdlog::debug("[{}]: (onMixerChanged: {}) - updating source volume for node: {}", name_,
+                  type_, id);
+    updateSourceVolume(this, id);
   }
 }
 
-void waybar::modules::Wireplumber::onDefaultNodesApiChanged(waybar::modules::Wireplumber* self) {
-  spdlog::debug("[{}]: (onDefaultNodesApiChanged: {})", self->name_, self->type_);
+void waybar::modules::Wireplumber::onDefaultNodesChanged() {
+  spdlog::debug("[{}]: (onDefaultNodesApiChanged: {})", name_, type_);
 
   // Handle sink
   uint32_t defaultNodeId;
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-node", self->type_, &defaultNodeId);
+  g_signal_emit_by_name(def_nodes_api_, "get-default-node", type_, &defaultNodeId);
 
   if (isValidNodeId(defaultNodeId)) {
     g_autoptr(WpNode) node = static_cast<WpNode*>(
-        wp_object_manager_lookup(self->om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id",
+        wp_object_manager_lookup(om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id",
                                  "=u", defaultNodeId, nullptr));
 
     if (node != nullptr) {
       const gchar* defaultNodeName =
           wp_pipewire_object_get_property(WP_PIPEWIRE_OBJECT(node), "node.name");
 
-      if (g_strcmp0(self->default_node_name_, defaultNodeName) != 0 ||
-          self->node_id_ != defaultNodeId) {
-        spdlog::debug("[{}]: Default sink changed to -> Node(name: {}, id: {})", self->name_,
+      if (g_strcmp0(default_node_name_, defaultNodeName) != 0 || node_id_ != defaultNodeId) {
+        spdlog::debug("[{}]: Default sink changed to -> Node(name: {}, id: {})", name_,
                       defaultNodeName, defaultNodeId);
 
-        g_free(self->default_node_name_);
-        self->default_node_name_ = g_strdup(defaultNodeName);
-        self->node_id_ = defaultNodeId;
-        updateVolume(self, defaultNodeId);
-        updateNodeName(self, defaultNodeId);
+        g_free(default_node_name_);
+        default_node_name_ = g_strdup(defaultNodeName);
+        node_id_ = defaultNodeId;
+        updateVolume(this, defaultNodeId);
+        updateNodeName(this, defaultNodeId);
       }
     }
   }
 
   // Handle source
   uint32_t defaultSourceId;
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-node", "Audio/Source", &defaultSourceId);
+  g_signal_emit_by_name(def_nodes_api_, "get-default-node", "Audio/Source", &defaultSourceId);
 
   if (isValidNodeId(defaultSourceId)) {
     g_autoptr(WpNode) sourceNode = static_cast<WpNode*>(
-        wp_object_manager_lookup(self->om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id",
+        wp_object_manager_lookup(om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id",
                                  "=u", defaultSourceId, nullptr));
 
     if (sourceNode != nullptr) {
       const gchar* defaultSourceName =
           wp_pipewire_object_get_property(WP_PIPEWIRE_OBJECT(sourceNode), "node.name");
 
-      if (g_strcmp0(self->default_source_name_, defaultSourceName) != 0 ||
-          self->source_node_id_ != defaultSourceId) {
-        spdlog::debug("[{}]: Default source changed to -> Node(name: {}, id: {})", self->name_,
+      if (g_strcmp0(default_source_name_, defaultSourceName) != 0 ||
+          source_node_id_ != defaultSourceId) {
+        spdlog::debug("[{}]: Default source changed to -> Node(name: {}, id: {})", name_,
                       defaultSourceName, defaultSourceId);
 
-        g_free(self->default_source_name_);
-        self->default_source_name_ = g_strdup(defaultSourceName);
-        self->source_node_id_ = defaultSourceId;
-        updateSourceVolume(self, defaultSourceId);
-        updateSourceName(self, defaultSourceId);
+        g_free(default_source_name_);
+        default_source_name_ = g_strdup(defaultSourceName);
+        source_node_id_ = defaultSourceId;
+        updateSourceVolume(this, defaultSourceId);
+        updateSourceName(this, defaultSourceId);
       }
     }
   }
 }
 
-void waybar::modules::Wireplumber::onObjectManagerInstalled(waybar::modules::Wireplumber* self) {
-  spdlog::debug("[{}]: onObjectManagerInstalled", self->name_);
-
-  self->def_nodes_api_ = wp_plugin_find(self->wp_core_, "default-nodes-api");
-
-  if (self->def_nodes_api_ == nullptr) {
-    spdlog::error("[{}]: default nodes api is not loaded.", self->name_);
-    throw std::runtime_error("Default nodes API is not loaded\n");
-  }
-
-  self->mixer_api_ = wp_plugin_find(self->wp_core_, "mixer-api");
+void waybar::modules::Wireplumber::onContextReady() {
+  spdlog::debug("[{}]: onContextReady", name_);
 
-  if (self->mixer_api_ == nullptr) {
-    spdlog::error("[{}]: mixer api is not loaded.", self->name_);
-    throw std::runtime_error("Mixer api is not loaded\n");
-  }
+  om_ = context_->objectManager();
+  mixer_api_ = context_->mixerApi();
+  def_nodes_api_ = context_->defaultNodesApi();
 
   // Get default sink
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-configured-node-name", self->type_,
-                        &self->default_node_name_);
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-node", self->type_, &self->node_id_);
+  g_signal_emit_by_name(def_nodes_api_, "get-default-configured-node-name", type_,
+                        &default_node_name_);
+  g_signal_emit_by_name(def_nodes_api_, "get-default-node", type_, &node_id_);
 
   // Get default source
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-configured-node-name", "Audio/Source",
-                        &self->default_source_name_);
-  g_signal_emit_by_name(self->def_nodes_api_, "get-default-node", "Audio/Source",
-                        &self->source_node_id_);
-
-  if (self->default_node_name_ != nullptr) {
-    spdlog::debug(
-        "[{}]: (onObjectManagerInstalled: {}) - default configured node name: {} and id: {}",
-        self->name_, self->type_, self->default_node_name_, self->node_id_);
-  }
-  if (self->default_source_name_ != nullptr) {
-    spdlog::debug("[{}]: default source: {} (id: {})", self->name_, self->default_source_name_,
-                  self->source_node_id_);
-  }
-
-  updateVolume(self, self->node_id_);
-  updateNodeName(self, self->node_id_);
-  updateSourceVolume(self, self->source_node_id_);
-  updateSourceName(self, self->source_node_id_);
-
-  g_signal_connect_swapped(self->mixer_api_, "changed", (GCallback)onMixerChanged, self);
-  g_signal_connect_swapped(self->def_nodes_api_, "changed", (GCallback)onDefaultNodesApiChanged,
-                           self);
-}
+  g_signal_emit_by_name(def_nodes_api_, "get-default-configured-node-name", "Audio/Source",
+                        &default_source_name_);
+  g_signal_emit_by_name(def_nodes_api_, "get-default-node", "Audio/Source", &source_node_id_);
 
-void waybar::modules::Wireplumber::onPluginActivated(WpObject* p, GAsyncResult* res,
-                                                     waybar::modules::Wireplumber* self) {
-  const auto* pluginName = wp_plugin_get_name(WP_PLUGIN(p));
-  spdlog::debug("[{}]: onPluginActivated: {}", self->name_, pluginName);
-  g_autoptr(GError) error = nullptr;
-
-  if (wp_object_activate_finish(p, res, &error) == 0) {
-    spdlog::error("[{}]: error activating plugin: {}", self->name_, error->message);
-    throw std::runtime_error(error->message);
-  }
-
-  if (--self->pending_plugins_ == 0) {
-    wp_core_install_object_manager(self->wp_core_, self->om_);
-  }
-}
-
-void waybar::modules::Wireplumber::activatePlugins() {
-  spdlog::debug("[{}]: activating plugins", name_);
-  for (uint16_t i = 0; i < apis_->len; i++) {
-    WpPlugin* plugin = static_cast<WpPlugin*>(g_ptr_array_index(apis_, i));
-    pending_plugins_++;
-    wp_object_activate(WP_OBJECT(plugin), WP_PLUGIN_FEATURE_ENABLED, nullptr,
-                       (GAsyncReadyCallback)onPluginActivated, this);
-  }
-}
-
-void waybar::modules::Wireplumber::prepare(waybar::modules::Wireplumber* self) {
-  spdlog::debug("[{}]: preparing object manager: '{}'", name_, self->type_);
-  wp_object_manager_add_interest(om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_PW_PROPERTY, "media.class",
-                                 "=s", self->type_, nullptr);
-  wp_object_manager_add_interest(om_, WP_TYPE_NODE, WP_CONSTRAINT_TYPE_PW_PROPERTY, "media.class",
-                                 "=s", "Audio/Source", nullptr);
-}
-
-void waybar::modules::Wireplumber::onDefaultNodesApiLoaded(WpObject* p, GAsyncResult* res,
-                                                           waybar::modules::Wireplumber* self) {
-  gboolean success = FALSE;
-  g_autoptr(GError) error = nullptr;
-
-  spdlog::debug("[{}]: callback loading default node api module", self->name_);
-
-  success = wp_core_load_component_finish(self->wp_core_, res, &error);
-
-  if (success == FALSE) {
-    spdlog::error("[{}]: default nodes API load failed", self->name_);
-    throw std::runtime_error(error->message);
+  if (default_node_name_ != nullptr) {
+    spdlog::debug("[{}]: (onContextReady: {}) - default configured node name: {} and id: {}",
+                  name_, type_, default_node_name_, node_id_);
   }
-  spdlog::debug("[{}]: loaded default nodes api", self->name_);
-  g_ptr_array_add(self->apis_, wp_plugin_find(self->wp_core_, "default-nodes-api"));
-
-  spdlog::debug("[{}]: loading mixer api module", self->name_);
-  wp_core_load_component(self->wp_core_, "libwireplumber-module-mixer-api", "module", nullptr,
-                         "mixer-api", nullptr, (GAsyncReadyCallback)onMixerApiLoaded, self);
-}
-
-void waybar::modules::Wireplumber::onMixerApiLoaded(WpObject* p, GAsyncResult* res,
-                                                    waybar::modules::Wireplumber* self) {
-  gboolean success = FALSE;
-  g_autoptr(GError) error = nullptr;
-
-  success = wp_core_load_component_finish(self->wp_core_, res, &error);
-
-  if (success == FALSE) {
-    spdlog::error("[{}]: mixer API load failed", self->name_);
-    throw std::runtime_error(error->message);
+  if (default_source_name_ != nullptr) {
+    spdlog::debug("[{}]: default source: {} (id: {})", name_, default_source_name_,
+                  source_node_id_);
   }
 
-  spdlog::debug("[{}]: loaded mixer API", self->name_);
-  g_ptr_array_add(self->apis_, ({
-                    WpPlugin* p = wp_plugin_find(self->wp_core_, "mixer-api");
-                    g_object_set(G_OBJECT(p), "scale", 1 /* cubic */, nullptr);
-                    p;
-                  }));
-
-  self->activatePlugins();
+  updateVolume(this, node_id_);
+  updateNodeName(this, node_id_);
+  updateSourceVolume(this, source_node_id_);
+  updateSourceName(this, source_node_id_);
 
-  self->dp.emit();
-
-  self->event_box_.add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
-  self->event_box_.signal_scroll_event().connect(sigc::mem_fun(*self, &Wireplumber::handleScroll));
-}
+  dp.emit();
 
-void waybar::modules::Wireplumber::asyncLoadRequiredApiModules() {
-  spdlog::debug("[{}]: loading default nodes api module", name_);
-  wp_core_load_component(wp_core_, "libwireplumber-module-default-nodes-api", "module", nullptr,
-                         "default-nodes-api", nullptr, (GAsyncReadyCallback)onDefaultNodesApiLoaded,
-                         this);
+  event_box_.add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
+  event_box_.signal_scroll_event().connect(sigc::mem_fun(*this, &Wireplumber::handleScroll));
 }
 
 auto waybar::modules::Wireplumber::update() -> void {
@@ -497,9 +369,15 @@ bool waybar::modules::Wireplumber::handleScroll(GdkEventScroll* e) {
     return AModule::handleScroll(e);
   }
   auto dir = AModule::getScrollDir(e);
-  if (dir == SCROLL_DIR::NONE) {
-    return true;
+  if (dir == SCROLL_DIR::UP) {
+    scroll_.add(1);
+  } else if (dir == SCROLL_DIR::DOWN) {
+    scroll_.add(-1);
   }
+  return true;
+}
+
+void waybar::modules::Wireplumber::applyScroll(int steps) {
   double maxVolume = 1;
   double step = 1.0 / 100.0;
   if (config_["scroll-step"].isDouble()) {
@@ -512,14 +390,14 @@ bool waybar::modules::Wireplumber::handleScroll(GdkEventScroll* e) {
   if (step < min_step_) step = min_step_;
 
   double newVol = volume_;
-  if (dir == SCROLL_DIR::UP) {
+  if (steps > 0) {
     if (volume_ < maxVolume) {
-      newVol = volume_ + step;
+      newVol = volume_ + step * steps;
       if (newVol > maxVolume) newVol = maxVolume;
     }
-  } else if (dir == SCROLL_DIR::DOWN) {
+  } else {
     if (volume_ > 0) {
-      newVol = volume_ - step;
+      newVol = volume_ + step * steps;
       if (newVol < 0) newVol = 0;
     }
   }
@@ -527,6 +405,10 @@ bool waybar::modules::Wireplumber::handleScroll(GdkEventScroll* e) {
     GVariant* variant = g_variant_new_double(newVol);
     gboolean ret;
     g_signal_emit_by_name(mixer_api_, "set-volume", node_id_, variant, &ret);
+    // shown right away, the next steps build on it
+    volume_ = newVol;
+    volume_set_ = newVol;
+    volume_set_at_ = std::chrono::steady_clock::now();
+    dp.emit();
   }
-  return true;
 }
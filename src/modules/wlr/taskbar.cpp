@@ -190,12 +190,17 @@ std::string Task::state_string(bool shortened) const {
 }
 
 void Task::handle_title(const char *title) {
+  // terminals and browsers resend their title a lot
+  if (title_ == title) {
+    return;
+  }
   if (title_.empty()) {
     spdlog::debug(fmt::format("Task ({}) setting title to {}", id_, title_));
   } else {
     spdlog::debug(fmt::format("Task ({}) overwriting title '{}' with '{}'", id_, title_, title));
   }
   title_ = title;
+  dirty_ = true;
   hide_if_ignored();
 
   if (!with_icon_ && !with_name_ || app_info_) {
@@ -209,11 +214,7 @@ void Task::handle_title(const char *title) {
     return;
   }
 
-  int icon_size = config_["icon-size"].isInt() ? config_["icon-size"].asInt() : 16;
-  if (tbar_->icon_loader().image_load_icon(icon_, app_info_, icon_size))
-    icon_.show();
-  else
-    spdlog::debug("Couldn't find icon for {}", title_);
+  load_icon(title_);
 }
 
 void Task::set_minimize_hint() {
@@ -245,14 +246,15 @@ void Task::handle_app_id(const char *app_id) {
     spdlog::debug(fmt::format("Task ({}) overwriting app_id '{}' with '{}'", id_, app_id_, app_id));
   }
   app_id_ = app_id;
+  dirty_ = true;
+  tbar_->request_sort();
   hide_if_ignored();
 
-  auto ids_replace_map = tbar_->app_ids_replace_map();
-  if (ids_replace_map.count(app_id_)) {
-    auto replaced_id = ids_replace_map[app_id_];
+  const auto &ids_replace_map = tbar_->app_ids_replace_map();
+  if (auto replaced = ids_replace_map.find(app_id_); replaced != ids_replace_map.end()) {
     spdlog::debug(
-        fmt::format("Task ({}) [{}] app_id was replaced with {}", id_, app_id_, replaced_id));
-    app_id_ = replaced_id;
+        fmt::format("Task ({}) [{}] app_id was replaced with {}", id_, app_id_, replaced->second));
+    app_id_ = replaced->second;
   }
 
   if (!with_icon_ && !with_name_) {
@@ -266,11 +268,22 @@ void Task::handle_app_id(const char *app_id) {
     return;
   }
 
+  load_icon(app_id_);
+}
+
+void Task::load_icon(const std::string &what) {
+  // the rendered icons are shared through the icon loader, the image is only set again when the
+  // app info changed
+  if (icon_loaded_ && icon_app_info_ == app_info_) {
+    return;
+  }
+  icon_loaded_ = true;
+  icon_app_info_ = app_info_;
   int icon_size = config_["icon-size"].isInt() ? config_["icon-size"].asInt() : 16;
   if (tbar_->icon_loader().image_load_icon(icon_, app_info_, icon_size))
     icon_.show();
   else
-    spdlog::debug("Couldn't find icon for {}", app_id_);
+    spdlog::debug("Couldn't find icon for {}", what);
 }
 
 void Task::on_button_size_allocated(Gtk::Allocation &alloc) {
@@ -312,48 +325,48 @@ void Task::handle_output_leave(struct wl_output *output) {
 }
 
 void Task::handle_state(struct wl_array *state) {
-  state_ = 0;
+  uint32_t new_state = 0;
   size_t size = state->size / sizeof(uint32_t);
   for (size_t i = 0; i < size; ++i) {
     auto entry = static_cast<uint32_t *>(state->data)[i];
-    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_MAXIMIZED) state_ |= MAXIMIZED;
-    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_MINIMIZED) state_ |= MINIMIZED;
-    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_ACTIVATED) state_ |= ACTIVE;
-    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_FULLSCREEN) state_ |= FULLSCREEN;
+    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_MAXIMIZED) new_state |= MAXIMIZED;
+    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_MINIMIZED) new_state |= MINIMIZED;
+    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_ACTIVATED) new_state |= ACTIVE;
+    if (entry == ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_FULLSCREEN) new_state |= FULLSCREEN;
+  }
+  if (new_state != state_) {
+    state_ = new_state;
+    dirty_ = true;
   }
 }
 
 void Task::handle_done() {
-  spdlog::debug("{} changed", repr());
-
-  if (state_ & MAXIMIZED) {
-    button.get_style_context()->add_class("maximized");
-  } else if (!(state_ & MAXIMIZED)) {
-    button.get_style_context()->remove_class("maximized");
-  }
-
-  if (state_ & MINIMIZED) {
-    button.get_style_context()->add_class("minimized");
-  } else if (!(state_ & MINIMIZED)) {
-    button.get_style_context()->remove_class("minimized");
-  }
-
-  if (state_ & ACTIVE) {
-    button.get_style_context()->add_class("active");
-  } else if (!(state_ & ACTIVE)) {
-    button.get_style_context()->remove_class("active");
-  }
-
-  if (state_ & FULLSCREEN) {
-    button.get_style_context()->add_class("fullscreen");
-  } else if (!(state_ & FULLSCREEN)) {
-    button.get_style_context()->remove_class("fullscreen");
+  if (spdlog::should_log(spdlog::level::debug)) {
+    spdlog::debug("{} changed", repr());
+  }
+
+  // only the state bits that changed since the last done are restyled
+  const uint32_t changed = state_ ^ shown_state_;
+  shown_state_ = state_;
+  if (changed != 0) {
+    auto ctx = button.get_style_context();
+    for (const auto &[bit, css_class] : {std::pair{MAXIMIZED, "maximized"},
+                                         std::pair{MINIMIZED, "minimized"},
+                                         std::pair{ACTIVE, "active"},
+                                         std::pair{FULLSCREEN, "fullscreen"}}) {
+      if ((changed & bit) == 0) continue;
+      if (state_ & bit)
+        ctx->add_class(css_class);
+      else
+        ctx->remove_class(css_class);
+    }
   }
 
-  if (config_["active-first"].isBool() && config_["active-first"].asBool() && active())
+  if ((changed & ACTIVE) && active() && config_["active-first"].isBool() &&
+      config_["active-first"].asBool())
     tbar_->move_button(button, 0);
 
-  tbar_->dp.emit();
+  if (dirty_) tbar_->dp.emit();
 }
 
 void Task::handle_closed() {
@@ -460,6 +473,11 @@ bool Task::operator==(const Task &o) const { return o.id_ == id_; }
 bool Task::operator!=(const Task &o) const { return o.id_ != id_; }
 
 void Task::update() {
+  if (!dirty_) {
+    return;
+  }
+  dirty_ = false;
+
   bool markup = config_["markup"].isBool() ? config_["markup"].asBool() : false;
   std::string title = title_;
   std::string name = name_;
@@ -475,7 +493,7 @@ void Task::update() {
                     fmt::arg("app_id", app_id), fmt::arg("state", state_string()),
                     fmt::arg("short_state", state_string(true)));
 
-    txt = waybar::util::rewriteString(txt, config_["rewrite"]);
+    txt = tbar_->rewrite_rules().apply(txt);
 
     if (markup)
       text_before_.set_markup(txt);
@@ -489,7 +507,7 @@ void Task::update() {
                     fmt::arg("app_id", app_id), fmt::arg("state", state_string()),
                     fmt::arg("short_state", state_string(true)));
 
-    txt = waybar::util::rewriteString(txt, config_["rewrite"]);
+    txt = tbar_->rewrite_rules().apply(txt);
 
     if (markup)
       text_after_.set_markup(txt);
@@ -504,7 +522,7 @@ void Task::update() {
                     fmt::arg("app_id", app_id), fmt::arg("state", state_string()),
                     fmt::arg("short_state", state_string(true)));
 
-    txt = waybar::util::rewriteString(txt, config_["rewrite"]);
+    txt = tbar_->rewrite_rules().apply(txt);
 
     if (markup)
       button.set_tooltip_markup(txt);
@@ -565,6 +583,9 @@ Taskbar::Taskbar(const std::string &id, const waybar::Bar &bar, const Json::Valu
     : waybar::AModule(config, "taskbar", id, false, false),
       bar_(bar),
       box_{bar.orientation, 0},
+      output_{gdk_wayland_monitor_get_wl_output(bar.output->monitor->gobj())},
+      all_outputs_{config["all-outputs"].isBool() && config["all-outputs"].asBool()},
+      rewrite_{util::RewriteRules::shared(config["rewrite"])},
       manager_{nullptr},
       seat_{nullptr} {
   box_.set_name("taskbar");
@@ -640,20 +661,21 @@ Taskbar::~Taskbar() {
 }
 
 void Taskbar::update() {
+  // tasks only rebuild their texts when something they show changed
   for (auto &t : tasks_) {
     t->update();
   }
 
-  if (config_["sort-by-app-id"].asBool()) {
-    std::stable_sort(tasks_.begin(), tasks_.end(),
-                     [](const std::unique_ptr<Task> &a, const std::unique_ptr<Task> &b) {
-                       return a->app_id() < b->app_id();
-                     });
+  // the order only changes with an app_id or a new button
+  if (sort_pending_ && config_["sort-by-app-id"].asBool()) {
+    tasks_.sort([](const TaskPtr &a, const TaskPtr &b) { return a->app_id() < b->app_id(); });
 
-    for (unsigned long i = 0; i < tasks_.size(); i++) {
-      move_button(tasks_[i]->button, i);
+    int i = 0;
+    for (auto &t : tasks_) {
+      move_button(t->button, i++);
     }
   }
+  sort_pending_ = false;
 
   AModule::update();
 }
@@ -707,7 +729,8 @@ void Taskbar::register_seat(struct wl_registry *registry, uint32_t name, uint32_
 }
 
 void Taskbar::handle_toplevel_create(struct zwlr_foreign_toplevel_handle_v1 *tl_handle) {
-  tasks_.push_back(std::make_unique<Task>(bar_, config_, this, tl_handle, seat_));
+  auto &task = tasks_.emplace_back(std::make_unique<Task>(bar_, config_, this, tl_handle, seat_));
+  task_index_.emplace(task->id(), std::prev(tasks_.end()));
 }
 
 void Taskbar::handle_finished() {
@@ -718,6 +741,7 @@ void Taskbar::handle_finished() {
 void Taskbar::add_button(Gtk::Button &bt) {
   box_.pack_start(bt, false, false);
   box_.get_style_context()->remove_class("empty");
+  request_sort();
 }
 
 void Taskbar::move_button(Gtk::Button &bt, int pos) { box_.reorder_child(bt, pos); }
@@ -730,31 +754,31 @@ void Taskbar::remove_button(Gtk::Button &bt) {
 }
 
 void Taskbar::remove_task(uint32_t id) {
-  auto it = std::find_if(std::begin(tasks_), std::end(tasks_),
-                         [id](const TaskPtr &p) { return p->id() == id; });
-
-  if (it == std::end(tasks_)) {
+  auto it = task_index_.find(id);
+  if (it == task_index_.end()) {
     spdlog::warn("Can't find task with id {}", id);
     return;
   }
 
-  tasks_.erase(it);
+  auto task = it->second;
+  task_index_.erase(it);
+  tasks_.erase(task);
 }
 
-bool Taskbar::show_output(struct wl_output *output) const {
-  return output == gdk_wayland_monitor_get_wl_output(bar_.output->monitor->gobj());
-}
+void Taskbar::request_sort() { sort_pending_ = true; }
 
-bool Taskbar::all_outputs() const {
-  return config_["all-outputs"].isBool() && config_["all-outputs"].asBool();
-}
+bool Taskbar::show_output(struct wl_output *output) const { return output == output_; }
+
+bool Taskbar::all_outputs() const { return all_outputs_; }
 
 const IconLoader &Taskbar::icon_loader() const { return icon_loader_; }
 
 const std::unordered_set<std::string> &Taskbar::ignore_list() const { return ignore_list_; }
 
-const std::map<std::string, std::string> &Taskbar::app_ids_replace_map() const {
+const util::StringMap<std::string> &Taskbar::app_ids_replace_map() const {
   return app_ids_replace_map_;
 }
 
+const util::RewriteRules &Taskbar::rewrite_rules() const { return *rewrite_; }
+
 } /* namespace waybar::modules::wlr */
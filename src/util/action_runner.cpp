@@ -0,0 +1,159 @@
+#include "util/action_runner.hpp"
+
+#include <spdlog/spdlog.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+
+#include "util/command.hpp"
+
+namespace waybar::util {
+
+namespace {
+
+// "N/s", N > 0
+double parseRate(const std::string& value) {
+  if (!value.ends_with("/s")) {
+    return 0;
+  }
+  char* end;
+  const double rate = std::strtod(value.c_str(), &end);
+  return end == value.c_str() + value.size() - 2 ? rate : 0;
+}
+
+}  // namespace
+
+ActionRunner::ActionRunner(const Json::Value& policies, bool direct)
+    : direct_(direct), state_(std::make_shared<State>()) {
+  if (!policies.isObject()) {
+    return;
+  }
+  for (const auto& event : policies.getMemberNames()) {
+    const auto value = policies[event].asString();
+    Action action;
+    if (value == "drop-if-running") {
+      action.policy = Policy::DROP_IF_RUNNING;
+    } else if (value == "queue-latest") {
+      action.policy = Policy::QUEUE_LATEST;
+    } else if (const double rate = parseRate(value); rate > 0) {
+      action.policy = Policy::RATE_LIMIT;
+      action.interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1 / rate));
+    } else {
+      spdlog::warn("Unknown exec-policy '{}' for {}, it runs every time", value, event);
+      continue;
+    }
+    state_->actions.emplace(event, std::move(action));
+  }
+}
+
+ActionRunner::~ActionRunner() {
+  std::lock_guard lock(state_->mutex);
+  for (auto pid : state_->running) {
+    killpg(pid, SIGTERM);
+  }
+}
+
+void ActionRunner::run(const std::string& event, const std::string& cmd) {
+  if (cmd.empty()) {
+    return;
+  }
+  if (auto it = state_->actions.find(event); it != state_->actions.end()) {
+    auto& action = it->second;
+    switch (action.policy) {
+      case Policy::ALWAYS:
+        break;
+      case Policy::DROP_IF_RUNNING:
+        if (action.running) {
+          return;
+        }
+        break;
+      case Policy::QUEUE_LATEST:
+        if (action.running) {
+          action.queued = cmd;
+          return;
+        }
+        break;
+      case Policy::RATE_LIMIT: {
+        const auto now = std::chrono::steady_clock::now();
+        if (now < action.next_start) {
+          return;
+        }
+        action.next_start = now + action.interval;
+        break;
+      }
+    }
+  }
+  start(state_, event, cmd, direct_);
+}
+
+void ActionRunner::start(const std::shared_ptr<State>& state, const std::string& event,
+                         const std::string& cmd, bool direct) {
+  if (auto it = state->actions.find(event); it != state->actions.end()) {
+    it->second.running = true;
+  }
+  {
+    std::lock_guard lock(state->mutex);
+    ++state->pending;
+  }
+  std::weak_ptr<State> weak = state;
+  command::forkExecAsync(
+      cmd, direct,
+      [weak](pid_t pid) {
+        auto state = weak.lock();
+        if (!state) {
+          // The module is gone, as it would have killed the command
+          if (pid > 0) {
+            killpg(pid, SIGTERM);
+          }
+          return;
+        }
+        {
+          std::lock_guard lock(state->mutex);
+          --state->pending;
+          if (pid > 0) {
+            state->children.push_back(pid);
+            state->running.push_back(pid);
+          }
+        }
+        state->started.notify_all();
+      },
+      [weak, event, direct](pid_t pid) {
+        auto state = weak.lock();
+        if (!state) {
+          return;
+        }
+        {
+          std::lock_guard lock(state->mutex);
+          std::erase(state->running, pid);
+        }
+        auto it = state->actions.find(event);
+        if (it == state->actions.end()) {
+          return;
+        }
+        auto& action = it->second;
+        action.running = false;
+        if (action.queued) {
+          auto next = std::move(*action.queued);
+          action.queued.reset();
+          start(state, event, next, direct);
+        }
+      });
+}
+
+void ActionRunner::waitForChildren() {
+  std::vector<pid_t> children;
+  {
+    std::unique_lock lock(state_->mutex);
+    state_->started.wait(lock, [this] { return state_->pending == 0; });
+    children.swap(state_->children);
+  }
+  for (auto pid : children) {
+    int status;
+    waitpid(pid, &status, 0);
+  }
+}
+
+}  // namespace waybar::util
@@ -1,6 +1,7 @@
 #include "util/audio_backend.hpp"
 
 #include <fmt/core.h>
+#include <json/writer.h>
 #include <pulse/def.h>
 #include <pulse/error.h>
 #include <pulse/introspect.h>
@@ -10,20 +11,31 @@
 
 #include <algorithm>
 #include <cmath>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <utility>
 
+#include "util/scope_guard.hpp"
+#include "util/shared_instance.hpp"
+
 namespace waybar::util {
 
-AudioBackend::AudioBackend(std::function<void()> on_updated_cb, private_constructor_tag tag)
+AudioBackend::AudioBackend(const Json::Value &ignored_sinks, private_constructor_tag tag)
     : mainloop_(nullptr),
       mainloop_api_(nullptr),
       context_(nullptr),
       volume_(0),
       muted_(false),
       source_volume_(0),
-      source_muted_(false),
-      on_updated_cb_(std::move(on_updated_cb)) {
+      source_muted_(false) {
+  if (ignored_sinks.isArray()) {
+    for (const auto &ignored_sink : ignored_sinks) {
+      if (ignored_sink.isString()) {
+        ignored_sinks_.insert(ignored_sink.asString());
+      }
+    }
+  }
   // Initialize pa_volume_ with safe defaults
   pa_cvolume_init(&pa_volume_);
   mainloop_ = pa_threaded_mainloop_new();
@@ -51,9 +63,34 @@ AudioBackend::~AudioBackend() {
   }
 }
 
-std::shared_ptr<AudioBackend> AudioBackend::getInstance(std::function<void()> on_updated_cb) {
-  private_constructor_tag tag;
-  return std::make_shared<AudioBackend>(on_updated_cb, tag);
+std::shared_ptr<AudioBackend> AudioBackend::getInstance(const Json::Value &ignored_sinks) {
+  static std::mutex mutex;
+  static SharedInstances<std::string, AudioBackend> instances;
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  std::lock_guard lock(mutex);
+  return instances.get(Json::writeString(builder, ignored_sinks), [&ignored_sinks] {
+    return std::make_shared<AudioBackend>(ignored_sinks, private_constructor_tag{});
+  });
+}
+
+int AudioBackend::subscribe(std::function<void()> on_updated) {
+  std::lock_guard lock(subscribers_mutex_);
+  subscribers_.emplace_back(next_subscriber_id_, std::move(on_updated));
+  return next_subscriber_id_++;
+}
+
+void AudioBackend::unsubscribe(int id) {
+  std::lock_guard lock(subscribers_mutex_);
+  std::erase_if(subscribers_, [id](const auto &subscriber) { return subscriber.first == id; });
+}
+
+void AudioBackend::notify() {
+  std::lock_guard lock(subscribers_mutex_);
+  for (const auto &[id, on_updated] : subscribers_) {
+    on_updated();
+  }
 }
 
 void AudioBackend::connectContext() {
@@ -94,6 +131,11 @@ void AudioBackend::contextStateCb(pa_context *c, void *data) {
       if (backend->context_ != nullptr) {
         pa_context_disconnect(backend->context_);
       }
+      // the answers to the old context never come
+      backend->sink_queries_.clear();
+      backend->sink_requeries_.clear();
+      backend->volume_in_flight_ = false;
+      backend->next_volume_.reset();
       backend->connectContext();
       break;
     case PA_CONTEXT_CONNECTING:
@@ -105,10 +147,11 @@ void AudioBackend::contextStateCb(pa_context *c, void *data) {
 }
 
 /*
- * Called when an event we subscribed to occurs.
+ * Called when an event we subscribed to occurs. Only the object the event is about is queried.
  */
 void AudioBackend::subscribeCb(pa_context *context, pa_subscription_event_type_t type, uint32_t idx,
                                void *data) {
+  auto *backend = static_cast<AudioBackend *>(data);
   unsigned facility = type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
   unsigned operation = type & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
   if (operation != PA_SUBSCRIPTION_EVENT_CHANGE) {
@@ -117,13 +160,56 @@ void AudioBackend::subscribeCb(pa_context *context, pa_subscription_event_type_t
   if (facility == PA_SUBSCRIPTION_EVENT_SERVER) {
     pa_context_get_server_info(context, serverInfoCb, data);
   } else if (facility == PA_SUBSCRIPTION_EVENT_SINK) {
-    pa_context_get_sink_info_by_index(context, idx, sinkInfoCb, data);
+    backend->querySink(idx);
   } else if (facility == PA_SUBSCRIPTION_EVENT_SINK_INPUT) {
-    pa_context_get_sink_info_list(context, sinkInfoCb, data);
+    // a stream changed, which may change the state of the sink it plays on
+    pa_context_get_sink_input_info(context, idx, sinkInputInfoCb, data);
   } else if (facility == PA_SUBSCRIPTION_EVENT_SOURCE) {
     pa_context_get_source_info_by_index(context, idx, sourceInfoCb, data);
   } else if (facility == PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT) {
-    pa_context_get_source_info_list(context, sourceInfoCb, data);
+    // only the default source is shown
+    if (backend->default_source_name_.empty()) {
+      pa_context_get_source_info_list(context, sourceInfoCb, data);
+    } else {
+      pa_context_get_source_info_by_name(context, backend->default_source_name_.c_str(),
+                                         sourceInfoCb, data);
+    }
+  }
+}
+
+void AudioBackend::sinkInputInfoCb(pa_context * /*context*/, const pa_sink_input_info *i,
+                                   int /*eol*/, void *data) {
+  if (i == nullptr) return;
+  static_cast<AudioBackend *>(data)->querySink(i->sink);
+}
+
+void AudioBackend::querySink(uint32_t idx) {
+  if (std::find(sink_queries_.begin(), sink_queries_.end(), idx) != sink_queries_.end()) {
+    sink_requeries_.insert(idx);
+    return;
+  }
+  auto *op = pa_context_get_sink_info_by_index(context_, idx, sinkQueryCb, this);
+  if (op != nullptr) {
+    sink_queries_.push_back(idx);
+    pa_operation_unref(op);
+  }
+}
+
+/*
+ * Called with the answer to querySink(), then once more at its end.
+ */
+void AudioBackend::sinkQueryCb(pa_context *context, const pa_sink_info *i, int eol, void *data) {
+  auto *backend = static_cast<AudioBackend *>(data);
+  if (eol == 0) {
+    sinkInfoCb(context, i, eol, data);
+    return;
+  }
+  // the end of the answer, or an error if the sink is gone
+  if (backend->sink_queries_.empty()) return;
+  const auto idx = backend->sink_queries_.front();
+  backend->sink_queries_.pop_front();
+  if (backend->sink_requeries_.erase(idx) != 0) {
+    backend->querySink(idx);
   }
 }
 
@@ -132,14 +218,37 @@ void AudioBackend::subscribeCb(pa_context *context, pa_subscription_event_type_t
  */
 void AudioBackend::volumeModifyCb(pa_context *c, int success, void *data) {
   auto *backend = static_cast<AudioBackend *>(data);
-  if (success != 0) {
-    if ((backend->context_ != nullptr) &&
-        pa_context_get_state(backend->context_) == PA_CONTEXT_READY) {
-      pa_context_get_sink_info_by_index(backend->context_, backend->sink_idx_, sinkInfoCb, data);
-    }
-  } else {
+  if (success == 0) {
     spdlog::debug("Volume modification failed");
   }
+  backend->volume_in_flight_ = false;
+  if (backend->next_volume_) {
+    // the latest change of a burst, the ones in between were never sent
+    const auto volume = *backend->next_volume_;
+    backend->next_volume_.reset();
+    backend->setSinkVolume(volume);
+  } else if ((backend->context_ != nullptr) &&
+             pa_context_get_state(backend->context_) == PA_CONTEXT_READY) {
+    backend->querySink(backend->sink_idx_);
+  }
+}
+
+void AudioBackend::setSinkVolume(const pa_cvolume &volume) {
+  // The next step of a burst starts from here, the sink info catches up when the burst is over
+  pa_volume_ = volume;
+  volume_ =
+      std::round(static_cast<float>(pa_cvolume_avg(&volume)) / float{PA_VOLUME_NORM} * 100.0F);
+  notify();
+  if (volume_in_flight_) {
+    next_volume_ = volume;
+    return;
+  }
+  auto *op =
+      pa_context_set_sink_volume_by_index(context_, sink_idx_, &volume, volumeModifyCb, this);
+  if (op != nullptr) {
+    volume_in_flight_ = true;
+    pa_operation_unref(op);
+  }
 }
 
 /*
@@ -155,18 +264,14 @@ void AudioBackend::sinkInfoCb(pa_context * /*context*/, const pa_sink_info *i, i
 
   auto *backend = static_cast<AudioBackend *>(data);
 
-  if (!backend->ignored_sinks_.empty()) {
-    for (const auto &ignored_sink : backend->ignored_sinks_) {
-      if (ignored_sink == i->description) {
-        if (i->name == backend->current_sink_name_) {
-          // If the current sink happens to be ignored it is never considered running
-          // so it will be replaced with another sink.
-          backend->current_sink_running_ = false;
-        }
-
-        return;
-      }
+  if (backend->ignored_sinks_.contains(i->description)) {
+    if (i->name == backend->current_sink_name_) {
+      // If the current sink happens to be ignored it is never considered running
+      // so it will be replaced with another sink.
+      backend->current_sink_running_ = false;
     }
+
+    return;
   }
 
   backend->default_sink_running_ = backend->default_sink_name == i->name &&
@@ -187,8 +292,12 @@ void AudioBackend::sinkInfoCb(pa_context * /*context*/, const pa_sink_info *i, i
   }
 
   if (backend->current_sink_name_ == i->name) {
+    // A change of ours in flight keeps the volume it set, the sink is queried again once through
+    const bool volume_in_flight = backend->volume_in_flight_ && backend->sink_idx_ == i->index;
     // Safely copy the volume structure
-    if (pa_cvolume_valid(&i->volume) != 0) {
+    if (volume_in_flight) {
+      // the volume stays the one last set
+    } else if (pa_cvolume_valid(&i->volume) != 0) {
       backend->pa_volume_ = i->volume;
       float volume =
           static_cast<float>(pa_cvolume_avg(&(backend->pa_volume_))) / float{PA_VOLUME_NORM};
@@ -210,7 +319,8 @@ void AudioBackend::sinkInfoCb(pa_context * /*context*/, const pa_sink_info *i, i
     } else {
       backend->form_factor_ = "";
     }
-    backend->on_updated_cb_();
+    // the echoes of our own changes are already shown
+    if (!volume_in_flight) backend->notify();
   }
 }
 
@@ -227,7 +337,7 @@ void AudioBackend::sourceInfoCb(pa_context * /*context*/, const pa_source_info *
     backend->source_muted_ = i->mute != 0;
     backend->source_desc_ = i->description;
     backend->source_port_name_ = i->active_port != nullptr ? i->active_port->name : "Unknown";
-    backend->on_updated_cb_();
+    backend->notify();
   }
 }
 
@@ -277,7 +387,7 @@ void AudioBackend::changeVolume(uint16_t volume, uint16_t min_volume, uint16_t m
 
   // Apply the volume change
   pa_threaded_mainloop_lock(mainloop_);
-  pa_context_set_sink_volume_by_index(context_, sink_idx_, &pa_volume, volumeModifyCb, this);
+  setSinkVolume(pa_volume);
   pa_threaded_mainloop_unlock(mainloop_);
 }
 
@@ -288,6 +398,10 @@ void AudioBackend::changeVolume(ChangeType change_type, double step, uint16_t ma
     return;
   }
 
+  // Steps from the volume last set, which a burst of steps hasn't reached yet
+  pa_threaded_mainloop_lock(mainloop_);
+  ScopeGuard unlock([this] { pa_threaded_mainloop_unlock(mainloop_); });
+
   // Prepare volume structure
   pa_cvolume pa_volume;
   pa_cvolume_init(&pa_volume);
@@ -308,9 +422,7 @@ void AudioBackend::changeVolume(ChangeType change_type, double step, uint16_t ma
     }
 
     // No need to continue with volume change if we had to create a new structure
-    pa_threaded_mainloop_lock(mainloop_);
-    pa_context_set_sink_volume_by_index(context_, sink_idx_, &pa_volume, volumeModifyCb, this);
-    pa_threaded_mainloop_unlock(mainloop_);
+    setSinkVolume(pa_volume);
     return;
   }
 
@@ -349,9 +461,7 @@ void AudioBackend::changeVolume(ChangeType change_type, double step, uint16_t ma
   }
 
   // Apply the volume change
-  pa_threaded_mainloop_lock(mainloop_);
-  pa_context_set_sink_volume_by_index(context_, sink_idx_, &pa_volume, volumeModifyCb, this);
-  pa_threaded_mainloop_unlock(mainloop_);
+  setSinkVolume(pa_volume);
 }
 
 void AudioBackend::toggleSinkMute() {
@@ -392,14 +502,4 @@ bool AudioBackend::isBluetooth() {
          monitor_.find("bluez") != std::string::npos;
 }
 
-void AudioBackend::setIgnoredSinks(const Json::Value &config) {
-  if (config.isArray()) {
-    for (const auto &ignored_sink : config) {
-      if (ignored_sink.isString()) {
-        ignored_sinks_.push_back(ignored_sink.asString());
-      }
-    }
-  }
-}
-
 }  // namespace waybar::util
@@ -5,9 +5,10 @@
 #include <sys/epoll.h>
 
 #include <cmath>
-#include <optional>
+#include <cstring>
 #include <utility>
 
+#include "util/shared_instance.hpp"
 #include "util/udev_deleter.hpp"
 
 namespace {
@@ -61,7 +62,15 @@ void check_nn(const void *ptr, const char *message = "ptr was null") {
 
 namespace waybar::util {
 
-static void upsert_device(std::vector<BacklightDevice> &devices, udev_device *dev) {
+// The brightness attributes of a device: udev reads them from sysfs, so before taking any lock
+struct DeviceAttrs {
+  const char *name;
+  const char *actual;
+  const char *max;
+  const char *power;
+};
+
+static DeviceAttrs read_attrs(udev_device *dev) {
   const char *name = udev_device_get_sysname(dev);
   check_nn(name);
 
@@ -70,32 +79,39 @@ static void upsert_device(std::vector<BacklightDevice> &devices, udev_device *de
           ? "brightness"
           : "actual_brightness";
 
-  const char *actual = udev_device_get_sysattr_value(dev, actual_brightness_attr);
-  const char *max = udev_device_get_sysattr_value(dev, "max_brightness");
-  const char *power = udev_device_get_sysattr_value(dev, "bl_power");
+  return {name, udev_device_get_sysattr_value(dev, actual_brightness_attr),
+          udev_device_get_sysattr_value(dev, "max_brightness"),
+          udev_device_get_sysattr_value(dev, "bl_power")};
+}
 
-  auto found = std::find_if(devices.begin(), devices.end(), [name](const BacklightDevice &device) {
-    return device.name() == name;
-  });
+// Updates the device in place, or adds it. Returns whether anything changed.
+static bool upsert_device(std::vector<BacklightDevice> &devices, const DeviceAttrs &attrs) {
+  auto found =
+      std::find_if(devices.begin(), devices.end(),
+                   [&attrs](const BacklightDevice &device) { return device.name() == attrs.name; });
   if (found != devices.end()) {
-    if (actual != nullptr) {
-      found->set_actual(std::stoi(actual));
+    const auto before = *found;
+    if (attrs.actual != nullptr) {
+      found->set_actual(std::stoi(attrs.actual));
     }
-    if (max != nullptr) {
-      found->set_max(std::stoi(max));
+    if (attrs.max != nullptr) {
+      found->set_max(std::stoi(attrs.max));
     }
-    if (power != nullptr) {
-      found->set_powered(std::stoi(power) == 0);
+    if (attrs.power != nullptr) {
+      found->set_powered(std::stoi(attrs.power) == 0);
     }
-  } else {
-    const int actual_int = actual == nullptr ? 0 : std::stoi(actual);
-    const int max_int = max == nullptr ? 0 : std::stoi(max);
-    const bool power_bool = power == nullptr ? true : std::stoi(power) == 0;
-    devices.emplace_back(name, actual_int, max_int, power_bool);
+    return !(before == *found) || before.get_powered() != found->get_powered();
   }
+
+  const int actual_int = attrs.actual == nullptr ? 0 : std::stoi(attrs.actual);
+  const int max_int = attrs.max == nullptr ? 0 : std::stoi(attrs.max);
+  const bool power_bool = attrs.power == nullptr ? true : std::stoi(attrs.power) == 0;
+  devices.emplace_back(attrs.name, actual_int, max_int, power_bool);
+  return true;
 }
 
-static void enumerate_devices(std::vector<BacklightDevice> &devices, udev *udev) {
+template <typename F>
+static void enumerate_devices(udev *udev, F &&on_device) {
   std::unique_ptr<udev_enumerate, UdevEnumerateDeleter> enumerate{udev_enumerate_new(udev)};
   udev_enumerate_add_match_subsystem(enumerate.get(), "backlight");
   udev_enumerate_scan_devices(enumerate.get());
@@ -105,7 +121,7 @@ static void enumerate_devices(std::vector<BacklightDevice> &devices, udev *udev)
     const char *path = udev_list_entry_get_name(dev_list_entry);
     std::unique_ptr<udev_device, UdevDeviceDeleter> dev{udev_device_new_from_syspath(udev, path)};
     check_nn(dev.get(), "dev new failed");
-    upsert_device(devices, dev.get());
+    on_device(dev.get());
   }
 }
 
@@ -126,12 +142,41 @@ bool BacklightDevice::get_powered() const { return powered_; }
 
 void BacklightDevice::set_powered(bool powered) { powered_ = powered; }
 
-BacklightBackend::BacklightBackend(std::chrono::milliseconds interval,
-                                   std::function<void()> on_updated_cb)
-    : on_updated_cb_(std::move(on_updated_cb)), polling_interval_(interval), previous_best_({}) {
+std::shared_ptr<BacklightBackend> BacklightBackend::getInstance(
+    std::chrono::milliseconds interval) {
+  static SharedInstance<BacklightBackend> instance;
+  auto backend = instance.get(
+      [interval] { return std::shared_ptr<BacklightBackend>(new BacklightBackend(interval)); });
+  if (interval.count() < backend->polling_interval_) {
+    backend->polling_interval_ = interval.count();
+  }
+  return backend;
+}
+
+int BacklightBackend::subscribe(std::function<void()> on_updated) {
+  std::scoped_lock<std::mutex> lock(subscribers_mutex_);
+  subscribers_.emplace_back(next_subscriber_id_, std::move(on_updated));
+  return next_subscriber_id_++;
+}
+
+void BacklightBackend::unsubscribe(int id) {
+  std::scoped_lock<std::mutex> lock(subscribers_mutex_);
+  std::erase_if(subscribers_, [id](const auto &subscriber) { return subscriber.first == id; });
+}
+
+void BacklightBackend::notify() {
+  std::scoped_lock<std::mutex> lock(subscribers_mutex_);
+  for (const auto &[id, on_updated] : subscribers_) {
+    on_updated();
+  }
+}
+
+BacklightBackend::BacklightBackend(std::chrono::milliseconds interval)
+    : polling_interval_(interval.count()) {
   std::unique_ptr<udev, UdevDeleter> udev_check{udev_new()};
   check_nn(udev_check.get(), "Udev check new failed");
-  enumerate_devices(devices_, udev_check.get());
+  enumerate_devices(udev_check.get(),
+                    [this](udev_device *dev) { upsert_device(devices_, read_attrs(dev)); });
   if (devices_.empty()) {
     throw std::runtime_error("No backlight found");
   }
@@ -170,38 +215,58 @@ BacklightBackend::BacklightBackend(std::chrono::milliseconds interval,
 
     check0(epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, ctl_event.data.fd, &ctl_event),
            "epoll_ctl failed: {}");
+    // ends the wait once the thread is stopped
+    epoll_event stop_event{};
+    stop_event.events = EPOLLIN;
+    stop_event.data.fd = udev_thread_.stopFd();
+    check0(epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, stop_event.data.fd, &stop_event),
+           "epoll_ctl failed: {}");
     epoll_event events[EPOLL_MAX_EVENTS];
 
+    // The devices are rescanned on the polling interval only until udev shows that it reports
+    // their changes, some drivers don't
+    bool udev_reports_changes = false;
+    // Applied to devices_ in place, with the attributes read beforehand
+    auto update = [this](udev_device *dev) {
+      const auto attrs = read_attrs(dev);
+      std::scoped_lock<std::mutex> lock(udev_thread_mutex_);
+      return upsert_device(devices_, attrs);
+    };
+
     while (udev_thread_.isRunning()) {
       const int event_count =
-          epoll_wait(epoll_fd.get(), events, EPOLL_MAX_EVENTS, this->polling_interval_.count());
+          epoll_wait(epoll_fd.get(), events, EPOLL_MAX_EVENTS,
+                     static_cast<int>(this->polling_interval_.load()));
       if (!udev_thread_.isRunning()) {
         break;
       }
-      decltype(devices_) devices;
-      {
-        std::scoped_lock<std::mutex> lock(udev_thread_mutex_);
-        devices = devices_;
-      }
+      bool changed = false;
       for (int i = 0; i < event_count; ++i) {
-        const auto &event = events[i];
-        check_eq(event.data.fd, udev_fd, "unexpected udev fd");
-        std::unique_ptr<udev_device, UdevDeviceDeleter> dev{udev_monitor_receive_device(mon.get())};
-        if (!dev) {
-          continue;
-        }
-        upsert_device(devices, dev.get());
+        check_eq(events[i].data.fd, udev_fd, "unexpected udev fd");
       }
-
-      // Refresh state if timed out
-      if (event_count == 0) {
-        enumerate_devices(devices, udev.get());
+      if (event_count > 0) {
+        // Everything that came in so far, for one callback: a dimming animation is a stream
+        // of events
+        while (true) {
+          std::unique_ptr<udev_device, UdevDeviceDeleter> dev{
+              udev_monitor_receive_device(mon.get())};
+          if (!dev) {
+            break;
+          }
+          const char *action = udev_device_get_action(dev.get());
+          if (action != nullptr && strcmp(action, "change") == 0) {
+            udev_reports_changes = true;
+          }
+          changed = update(dev.get()) || changed;
+        }
+      } else if (event_count == 0 && !udev_reports_changes) {
+        // Refresh state if timed out
+        enumerate_devices(udev.get(),
+                          [&](udev_device *dev) { changed = update(dev) || changed; });
       }
-      {
-        std::scoped_lock<std::mutex> lock(udev_thread_mutex_);
-        devices_ = devices;
+      if (changed) {
+        notify();
       }
-      this->on_updated_cb_();
     }
   };
 }
@@ -222,18 +287,6 @@ const BacklightDevice *BacklightBackend::best_device(const std::vector<Backlight
   return max == devices.end() ? nullptr : &(*max);
 }
 
-const BacklightDevice *BacklightBackend::get_previous_best_device() {
-  return previous_best_.has_value() ? &(*previous_best_) : nullptr;
-}
-
-void BacklightBackend::set_previous_best_device(const BacklightDevice *device) {
-  if (device == nullptr) {
-    previous_best_ = std::nullopt;
-  } else {
-    previous_best_ = std::optional{*device};
-  }
-}
-
 void BacklightBackend::set_scaled_brightness(const std::string &preferred_device, int brightness) {
   GET_BEST_DEVICE(best, (*this), preferred_device);
 
@@ -263,10 +316,36 @@ void BacklightBackend::set_brightness_internal(const std::string &device_name, i
                                                int max_brightness) {
   brightness = std::clamp(brightness, 0, max_brightness);
 
+  if (brightness_in_flight_) {
+    next_brightness_.emplace(device_name, brightness);
+    return;
+  }
+  callSetBrightness(device_name, brightness);
+}
+
+void BacklightBackend::callSetBrightness(const std::string &device_name, int brightness) {
   auto call_args = Glib::VariantContainerBase(
       g_variant_new("(ssu)", "backlight", device_name.c_str(), brightness));
 
-  login_proxy_->call_sync("SetBrightness", call_args);
+  brightness_in_flight_ = true;
+  login_proxy_->call(
+      "SetBrightness",
+      [weak = weak_from_this()](const Glib::RefPtr<Gio::AsyncResult> &result) {
+        auto self = weak.lock();
+        if (!self) {
+          return;
+        }
+        try {
+          self->login_proxy_->call_finish(result);
+        } catch (const Glib::Error &e) {
+          spdlog::error("backlight: SetBrightness failed: {}", e.what().c_str());
+        }
+        self->brightness_in_flight_ = false;
+        if (auto next = std::exchange(self->next_brightness_, std::nullopt)) {
+          self->callSetBrightness(next->first, next->second);
+        }
+      },
+      call_args);
 }
 
 int BacklightBackend::get_scaled_brightness(const std::string &preferred_device) {
@@ -0,0 +1,313 @@
+#include "util/command.hpp"
+
+#include <sched.h>
+#include <signal.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+#ifdef __FreeBSD__
+#include <sys/procctl.h>
+#endif
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+extern char** environ;
+
+namespace waybar::util::command {
+
+namespace {
+
+// Everything the child needs, prepared by the parent: the child runs on the parent's memory
+// until it execs, so it must not allocate or touch anything but this
+struct SpawnArgs {
+  const char* path;
+  char* const* argv;
+  char* const* envp;
+  int out;
+  int in;
+  bool deathsig;
+  int error;  // set by the child when exec fails
+};
+
+constexpr size_t CHILD_STACK_SIZE = 64 * 1024;
+
+// The children of reapLater() without a pidfd, with their on_exit
+std::mutex reap_mutex;
+std::unordered_map<pid_t, std::function<void(pid_t)>> reap_pids;
+
+void reaped(pid_t pid) {
+  spdlog::debug("Reaped child with PID: {}", pid);
+  util::trace::asyncEnd("forkExec", "process", pid);
+}
+
+// The queue of forkExecAsync(), run by a thread started on first use and kept for good
+struct SpawnRequest {
+  std::string cmd;
+  bool direct;
+  std::function<void(pid_t)> on_start;
+  std::function<void(pid_t)> on_exit;
+};
+std::mutex spawn_mutex;
+std::condition_variable spawn_queued;
+std::deque<SpawnRequest> spawn_queue;
+bool spawn_thread_started = false;
+
+void spawnThread() {
+  while (true) {
+    std::unique_lock lock(spawn_mutex);
+    spawn_queued.wait(lock, [] { return !spawn_queue.empty(); });
+    auto request = std::move(spawn_queue.front());
+    spawn_queue.pop_front();
+    lock.unlock();
+
+    pid_t pid = request.cmd.empty() ? -1 : spawn(request.cmd, -1, "", false, request.direct);
+    if (request.on_start) {
+      request.on_start(pid);
+    }
+    if (pid < 0) {
+      if (request.on_exit) {
+        // glibmm only attaches sources from the main context's thread, invoke() queues it there
+        Glib::MainContext::get_default()->invoke([on_exit = std::move(request.on_exit)] {
+          on_exit(-1);
+          return false;
+        });
+      }
+      continue;
+    }
+    util::trace::asyncBegin("forkExec", "process", pid);
+    reapLater(pid, std::move(request.on_exit));
+  }
+}
+
+int childMain(void* data) {
+  auto* args = static_cast<SpawnArgs*>(data);
+  // A handler installed by waybar must not run here, on the memory of the parent
+  struct sigaction dfl = {};
+  dfl.sa_handler = SIG_DFL;
+  for (int sig = 1; sig < NSIG; ++sig) {
+    struct sigaction old;
+    if (sigaction(sig, nullptr, &old) == 0 && old.sa_handler != SIG_IGN) {
+      sigaction(sig, &dfl, nullptr);
+    }
+  }
+  // Reset sigmask
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigprocmask(SIG_SETMASK, &mask, nullptr);
+  if (args->deathsig) {
+    // Kill child if Waybar exits
+    int deathsig = SIGTERM;
+#ifdef __linux__
+    prctl(PR_SET_PDEATHSIG, deathsig);
+#endif
+#ifdef __FreeBSD__
+    procctl(P_PID, 0, PROC_PDEATHSIG_CTL, reinterpret_cast<void*>(&deathsig));
+#endif
+  }
+  setpgid(0, 0);
+  if (args->out != -1) {
+    dup2(args->out, 1);
+  }
+  if (args->in != -1) {
+    dup2(args->in, 0);
+  }
+  execve(args->path, args->argv, args->envp);
+  args->error = errno;
+  _exit(127);
+}
+
+// The words of cmd, if it has nothing for a shell to interpret
+std::vector<std::string> plainWords(std::string_view cmd) {
+  constexpr std::string_view special = "|&;<>()$`\\\"'*?[]{}#~!\n";
+  if (cmd.find_first_of(special) != std::string_view::npos) {
+    return {};
+  }
+  std::vector<std::string> words;
+  while (true) {
+    const auto start = cmd.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+      break;
+    }
+    cmd.remove_prefix(start);
+    const auto word = cmd.substr(0, cmd.find_first_of(" \t"));
+    words.emplace_back(word);
+    cmd.remove_prefix(word.size());
+  }
+  // a leading FOO=bar is a variable assignment
+  if (!words.empty() && words.front().find('=') != std::string::npos) {
+    return {};
+  }
+  return words;
+}
+
+// The executable that execvp() would run for name, empty if there is none
+std::string findProgram(const std::string& name) {
+  if (name.find('/') != std::string::npos) {
+    return name;
+  }
+  const char* path = getenv("PATH");
+  std::string_view dirs = path != nullptr ? path : "/usr/local/bin:/usr/bin:/bin";
+  while (true) {
+    const auto dir = dirs.substr(0, dirs.find(':'));
+    auto candidate = (dir.empty() ? std::string(".") : std::string(dir)) + '/' + name;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return candidate;
+    }
+    if (dir.size() == dirs.size()) {
+      return {};
+    }
+    dirs.remove_prefix(dir.size() + 1);
+  }
+}
+
+}  // namespace
+
+pid_t spawn(const std::string& cmd, int out, const std::string& output_name, bool deathsig,
+            bool direct, int in) {
+  std::vector<std::string> words;
+  std::string path = "/bin/sh";
+  if (direct) {
+    words = plainWords(cmd);
+    if (!words.empty()) {
+      path = findProgram(words.front());
+      if (path.empty()) {
+        spdlog::error("Unable to exec cmd {}, {} not found", cmd, words.front());
+        return -1;
+      }
+    }
+  }
+  if (words.empty()) {
+    words = {"sh", "-c", cmd};
+  }
+  std::vector<char*> argv;
+  for (auto& word : words) {
+    argv.push_back(word.data());
+  }
+  argv.push_back(nullptr);
+
+  std::string output_var;
+  std::vector<char*> envp;
+  for (char** var = environ; *var != nullptr; ++var) {
+    if (output_name.empty() || strncmp(*var, "WAYBAR_OUTPUT_NAME=", 19) != 0) {
+      envp.push_back(*var);
+    }
+  }
+  if (!output_name.empty()) {
+    output_var = "WAYBAR_OUTPUT_NAME=" + output_name;
+    envp.push_back(output_var.data());
+  }
+  envp.push_back(nullptr);
+
+  SpawnArgs args{path.c_str(), argv.data(), envp.data(), out, in, deathsig, 0};
+
+  // Signals stay blocked until the child has reset the handlers it got from us
+  sigset_t all;
+  sigset_t old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+#ifdef __linux__
+  // Like vfork(), the child shares our memory and we wait until it has exec'd: nothing is
+  // copied, where fork() would copy the page tables of the whole bar
+  auto stack = std::make_unique<char[]>(CHILD_STACK_SIZE);
+  pid_t pid =
+      clone(childMain, stack.get() + CHILD_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+#else
+  pid_t pid = vfork();
+  if (pid == 0) {
+    childMain(&args);
+  }
+#endif
+  const int err = errno;
+  pthread_sigmask(SIG_SETMASK, &old, nullptr);
+
+  if (pid < 0) {
+    spdlog::error("Unable to exec cmd {}, error {}", cmd, strerror(err));
+    return -1;
+  }
+  if (args.error != 0) {
+    // the child is gone with status 127, it is reaped like any other
+    spdlog::error("Unable to exec cmd {}, error {}", cmd, strerror(args.error));
+  }
+  return pid;
+}
+
+void reapLater(pid_t pid, std::function<void(pid_t)> on_exit) {
+#ifdef SYS_pidfd_open
+  const int fd = syscall(SYS_pidfd_open, pid, 0);
+  if (fd >= 0) {
+    // Readable once the child exited: only that one is waited for. Watched from the main
+    // context, glibmm only attaches sources from its thread.
+    Glib::MainContext::get_default()->invoke([pid, fd, on_exit = std::move(on_exit)]() mutable {
+      Glib::signal_io().connect(
+          [pid, fd, on_exit = std::move(on_exit)](Glib::IOCondition) {
+            if (waitpid(pid, nullptr, WNOHANG) == pid) {
+              reaped(pid);
+            }
+            ::close(fd);
+            if (on_exit) {
+              on_exit(pid);
+            }
+            return false;
+          },
+          fd, Glib::IO_IN | Glib::IO_HUP);
+      return false;
+    });
+    return;
+  }
+#endif
+  std::lock_guard lock(reap_mutex);
+  reap_pids.emplace(pid, std::move(on_exit));
+  spdlog::debug("Added child to reap list: {}", pid);
+}
+
+void reapExited() {
+  std::vector<std::pair<pid_t, std::function<void(pid_t)>>> exited;
+  {
+    std::lock_guard lock(reap_mutex);
+    for (auto it = reap_pids.begin(); it != reap_pids.end();) {
+      const pid_t ret = waitpid(it->first, nullptr, WNOHANG);
+      if (ret == 0) {
+        ++it;
+        continue;
+      }
+      // Or reaped by someone else already
+      if (ret == it->first) {
+        reaped(it->first);
+      }
+      if (it->second) {
+        exited.emplace_back(it->first, std::move(it->second));
+      }
+      it = reap_pids.erase(it);
+    }
+  }
+  // Unlocked, they may start other children
+  for (auto& [pid, on_exit] : exited) {
+    on_exit(pid);
+  }
+}
+
+void forkExecAsync(std::string cmd, bool direct, std::function<void(pid_t)> on_start,
+                   std::function<void(pid_t)> on_exit) {
+  {
+    std::lock_guard lock(spawn_mutex);
+    spawn_queue.push_back({std::move(cmd), direct, std::move(on_start), std::move(on_exit)});
+    if (!spawn_thread_started) {
+      std::thread(spawnThread).detach();
+      spawn_thread_started = true;
+    }
+  }
+  spawn_queued.notify_one();
+}
+
+}  // namespace waybar::util::command
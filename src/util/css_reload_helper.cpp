@@ -10,6 +10,7 @@
 #include <sys/types.h>
 #endif
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <regex>
@@ -26,6 +27,8 @@ const std::regex IMPORT_REGEX(R"(@import\s+(?:url\()?(?:"|')([^"')]+)(?:"|')\)?;
 waybar::CssReloadHelper::CssReloadHelper(std::string cssFile, std::function<void()> callback)
     : m_cssFile(std::move(cssFile)), m_callback(std::move(callback)) {}
 
+waybar::CssReloadHelper::~CssReloadHelper() { m_reloadTimer.disconnect(); }
+
 std::string waybar::CssReloadHelper::getFileContents(const std::string& filename) {
   if (filename.empty()) {
     return {};
@@ -63,8 +66,24 @@ std::string waybar::CssReloadHelper::findPath(const std::string& filename) {
 }
 
 void waybar::CssReloadHelper::monitorChanges() {
-  auto files = parseImports(m_cssFile);
+  m_files = parseImports(m_cssFile);
+  contentsChanged(m_files);
+  watchFiles(m_files);
+}
+
+void waybar::CssReloadHelper::watchFiles(const std::vector<std::string>& files) {
+  std::erase_if(m_fileMonitors, [&](const auto& entry) {
+    if (std::find(files.begin(), files.end(), entry.first) != files.end()) {
+      return false;
+    }
+    spdlog::debug("Removing file from watch list: {}", entry.first);
+    entry.second->cancel();
+    return true;
+  });
   for (const auto& file : files) {
+    if (m_fileMonitors.contains(file)) {
+      continue;
+    }
     auto gioFile = Gio::File::create_for_path(file);
     if (!gioFile) {
       spdlog::error("Failed to create file for path: {}", file);
@@ -84,7 +103,7 @@ void waybar::CssReloadHelper::monitorChanges() {
       spdlog::error("Failed to connect to file monitor for path: {}", file);
       continue;
     }
-    m_fileMonitors.emplace_back(std::move(fileMonitor));
+    m_fileMonitors.emplace(file, std::move(fileMonitor));
   }
 }
 
@@ -94,14 +113,56 @@ void waybar::CssReloadHelper::handleFileChange(Glib::RefPtr<Gio::File> const& fi
   // Multiple events are fired on file changed (attributes, write, changes done hint, etc.), only
   // fire for one
   if (event_type == Gio::FileMonitorEvent::FILE_MONITOR_EVENT_CHANGES_DONE_HINT) {
-    spdlog::debug("Reloading style, file changed: {}", file->get_path());
-    m_callback();
+    spdlog::debug("Style file changed: {}", file->get_path());
+    m_reloadTimer.disconnect();
+    m_reloadTimer = Glib::signal_timeout().connect(
+        [this] {
+          reload();
+          return false;
+        },
+        RELOAD_DELAY_MS);
   }
 }
 
-std::vector<std::string> waybar::CssReloadHelper::parseImports(const std::string& cssFile) {
-  std::unordered_map<std::string, bool> imports;
+void waybar::CssReloadHelper::reload() {
+  auto files = parseImports(m_cssFile);
+  if (files.empty()) {
+    // the style file is gone for now, an editor replacing it will bring it back
+    return;
+  }
+  if (files != m_files) {
+    // an @import was added or removed
+    std::erase_if(m_parsed, [&](const auto& entry) {
+      return std::find(files.begin(), files.end(), entry.first) == files.end();
+    });
+    m_files = std::move(files);
+    watchFiles(m_files);
+  }
+  // editors often write the same bytes back, GTK would still restyle every widget for it
+  if (!contentsChanged(m_files)) {
+    spdlog::debug("Style files unchanged, not reloading");
+    return;
+  }
+  spdlog::debug("Reloading style");
+  m_callback();
+}
 
+bool waybar::CssReloadHelper::contentsChanged(const std::vector<std::string>& files) {
+  size_t hash = 0;
+  for (const auto& file : files) {
+    auto it = m_parsed.find(file);
+    const size_t contents = it != m_parsed.end() ? it->second.hash : 0;
+    // boost::hash_combine
+    hash ^= contents + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  if (hash == m_contentsHash) {
+    return false;
+  }
+  m_contentsHash = hash;
+  return true;
+}
+
+std::vector<std::string> waybar::CssReloadHelper::parseImports(const std::string& cssFile) {
   auto cssFullPath = findPath(cssFile);
   if (cssFullPath.empty()) {
     spdlog::error("Failed to find css file: {}", cssFile);
@@ -109,48 +170,42 @@ std::vector<std::string> waybar::CssReloadHelper::parseImports(const std::string
   }
 
   spdlog::debug("Parsing imports for file: {}", cssFullPath);
-  imports[cssFullPath] = false;
-
-  auto previousSize = 0UL;
-  auto maxIterations = 100U;
-  do {
-    previousSize = imports.size();
-    for (const auto& [file, parsed] : imports) {
-      if (!parsed) {
-        parseImports(file, imports);
+  std::vector<std::string> result = {cssFullPath};
+  // result doubles as the queue of files to read, imports already listed are not read again
+  for (size_t i = 0; i < result.size() && i < MAX_FILES; ++i) {
+    // copied, result grows under it
+    const auto imports = importsOf(result[i]);
+    for (const auto& importFile : imports) {
+      if (std::find(result.begin(), result.end(), importFile) == result.end()) {
+        result.push_back(importFile);
       }
     }
-
-  } while (imports.size() > previousSize && maxIterations-- > 0);
-
-  std::vector<std::string> result;
-  for (const auto& [file, parsed] : imports) {
-    if (parsed) {
-      spdlog::debug("Adding file to watch list: {}", file);
-      result.push_back(file);
-    }
   }
+  result.resize(std::min(result.size(), MAX_FILES));
 
+  for (const auto& file : result) {
+    spdlog::debug("Adding file to watch list: {}", file);
+  }
   return result;
 }
 
-void waybar::CssReloadHelper::parseImports(const std::string& cssFile,
-                                           std::unordered_map<std::string, bool>& imports) {
-  // if the file has already been parsed, skip
-  if (imports.find(cssFile) != imports.end() && imports[cssFile]) {
-    return;
+const std::vector<std::string>& waybar::CssReloadHelper::importsOf(const std::string& cssFile) {
+  const auto contents = getFileContents(cssFile);
+  const size_t hash = std::hash<std::string>{}(contents);
+  auto& parsed = m_parsed[cssFile];
+  if (parsed.read && parsed.hash == hash) {
+    return parsed.imports;
   }
-
-  auto contents = getFileContents(cssFile);
-  std::smatch matches;
-  while (std::regex_search(contents, matches, IMPORT_REGEX)) {
-    auto importFile = findPath({matches[1].str()});
-    if (!importFile.empty() && imports.find(importFile) == imports.end()) {
-      imports[importFile] = false;
+  parsed.read = true;
+  parsed.hash = hash;
+  parsed.imports.clear();
+
+  auto it = std::sregex_iterator(contents.begin(), contents.end(), IMPORT_REGEX);
+  for (; it != std::sregex_iterator(); ++it) {
+    auto importFile = findPath({(*it)[1].str()});
+    if (!importFile.empty()) {
+      parsed.imports.push_back(std::move(importFile));
     }
-
-    contents = matches.suffix().str();
   }
-
-  imports[cssFile] = true;
+  return parsed.imports;
 }
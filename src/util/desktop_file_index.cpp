@@ -0,0 +1,156 @@
+#include "util/desktop_file_index.hpp"
+
+#include <glibmm/keyfile.h>
+#include <glibmm/miscutils.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <filesystem>
+
+namespace waybar::util {
+
+namespace {
+
+std::string toLowerCase(const std::string& input) {
+  std::string result = input;
+  std::ranges::transform(result, result.begin(), [](unsigned char c) { return std::tolower(c); });
+  return result;
+}
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+DesktopFileIndex& DesktopFileIndex::inst() {
+  // Intentionally leaked: the file monitors must not be destroyed after GLib is torn down.
+  static auto* index = new DesktopFileIndex();
+  return *index;
+}
+
+void DesktopFileIndex::ensureBuilt() {
+  if (built_) {
+    return;
+  }
+
+  entries_.clear();
+  auto data_dirs = Glib::get_system_data_dirs();
+  data_dirs.insert(data_dirs.begin(), Glib::get_user_data_dir());
+  for (size_t dir = 0; dir < data_dirs.size(); ++dir) {
+    const auto data_app_dir = data_dirs[dir] + "/applications/";
+    std::error_code ec;
+    if (!std::filesystem::is_directory(data_app_dir, ec)) {
+      continue;
+    }
+    watchDirectory(data_app_dir);
+
+    for (auto it = std::filesystem::recursive_directory_iterator(data_app_dir, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+      if (it->is_directory(ec)) {
+        watchDirectory(it->path().string());
+      } else if (it->is_regular_file(ec)) {
+        auto filename = it->path().filename().string();
+        entries_.push_back({dir, filename, toLowerCase(filename), it->path().string()});
+      }
+    }
+  }
+
+  spdlog::debug("Indexed {} desktop files", entries_.size());
+  built_ = true;
+}
+
+void DesktopFileIndex::watchDirectory(const std::string& path) {
+  if (monitors_.contains(path)) {
+    return;
+  }
+
+  auto monitor = Gio::File::create_for_path(path)->monitor_directory();
+  if (!monitor) {
+    spdlog::debug("Failed to create file monitor for {}", path);
+    return;
+  }
+  monitor->signal_changed().connect(sigc::mem_fun(*this, &DesktopFileIndex::handleDirectoryChange));
+  monitors_.emplace(path, std::move(monitor));
+}
+
+void DesktopFileIndex::handleDirectoryChange(Glib::RefPtr<Gio::File> const& file,
+                                             Glib::RefPtr<Gio::File> const& /*other_file*/,
+                                             Gio::FileMonitorEvent event_type) {
+  if (event_type == Gio::FileMonitorEvent::FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+    return;
+  }
+
+  spdlog::debug("Desktop files changed ({}), invalidating index", file->get_path());
+  std::lock_guard lock(mutex_);
+  built_ = false;
+  suffixCache_.clear();
+  iconNameCache_.clear();
+  ++generation_;
+}
+
+void DesktopFileIndex::watch() {
+  std::lock_guard lock(mutex_);
+  ensureBuilt();
+}
+
+std::optional<std::string> DesktopFileIndex::findBySuffix(
+    const std::vector<std::string>& suffixes, bool ignore_case) {
+  std::lock_guard lock(mutex_);
+  std::string key = ignore_case ? "i" : "s";
+  for (const auto& suffix : suffixes) {
+    key += '/' + suffix;  // a filename can't contain '/'
+  }
+  if (auto cached = suffixCache_.find(key); cached != suffixCache_.end()) {
+    return cached->second;
+  }
+
+  ensureBuilt();
+  std::optional<std::string> result;
+  // The entries of a data dir are contiguous, in the order they were walked
+  for (auto first = entries_.begin(); first != entries_.end() && !result;) {
+    auto last = std::find_if(first, entries_.end(),
+                             [&](const Entry& e) { return e.dataDir != first->dataDir; });
+    for (const auto& suffix : suffixes) {
+      const auto lowerSuffix = toLowerCase(suffix);
+      auto entry = std::find_if(first, last, [&](const Entry& e) {
+        if (ignore_case) {
+          return endsWith(e.lowerFilename, lowerSuffix);
+        }
+        return endsWith(e.filename, suffix) || endsWith(e.filename, lowerSuffix);
+      });
+      if (entry != last) {
+        result = entry->path;
+        break;
+      }
+    }
+    first = last;
+  }
+  suffixCache_.emplace(key, result);
+  return result;
+}
+
+std::optional<std::string> DesktopFileIndex::getIconName(const std::string& desktop_file_path) {
+  std::lock_guard lock(mutex_);
+  if (auto cached = iconNameCache_.find(desktop_file_path); cached != iconNameCache_.end()) {
+    return cached->second;
+  }
+
+  std::optional<std::string> result;
+  try {
+    Glib::KeyFile desktop_file;
+    desktop_file.load_from_file(desktop_file_path);
+    result = desktop_file.get_string("Desktop Entry", "Icon");
+  } catch (Glib::FileError& error) {
+    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path,
+                 std::string(error.what()));
+  } catch (Glib::KeyFileError& error) {
+    spdlog::warn("Error while loading desktop file {}: {}", desktop_file_path,
+                 std::string(error.what()));
+  }
+  iconNameCache_.emplace(desktop_file_path, result);
+  return result;
+}
+
+}  // namespace waybar::util
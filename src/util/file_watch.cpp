@@ -0,0 +1,74 @@
+#include "util/file_watch.hpp"
+
+#include <glibmm/main.h>
+#include <glibmm/miscutils.h>
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+
+namespace waybar::util {
+
+static std::string expandHome(const std::string& path) {
+  if (path == "~" || path.starts_with("~/")) {
+    return Glib::get_home_dir() + path.substr(1);
+  }
+  return path;
+}
+
+FileWatch::FileWatch(const std::string& path, std::function<void()> on_change)
+    : path_(expandHome(path)), on_change_(std::move(on_change)) {
+  const std::filesystem::path file(path_);
+  name_ = file.filename().string();
+  auto dir = Gio::File::create_for_path(file.has_parent_path() ? file.parent_path().string() : ".");
+  try {
+    monitor_ = dir->monitor_directory(Gio::FILE_MONITOR_WATCH_MOVES);
+    monitor_->signal_changed().connect(sigc::mem_fun(*this, &FileWatch::onEvent));
+  } catch (const Glib::Error& e) {
+    spdlog::error("Can't watch {}: {}", path_, e.what().c_str());
+    monitor_.reset();
+  }
+}
+
+FileWatch::~FileWatch() {
+  settle_.disconnect();
+  if (monitor_) {
+    monitor_->cancel();
+  }
+}
+
+bool FileWatch::isWatched(const Glib::RefPtr<Gio::File>& file) const {
+  return file && file->get_basename() == name_;
+}
+
+void FileWatch::onEvent(const Glib::RefPtr<Gio::File>& file, const Glib::RefPtr<Gio::File>& other,
+                        Gio::FileMonitorEvent event) {
+  switch (event) {
+    case Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case Gio::FILE_MONITOR_EVENT_CREATED:
+    case Gio::FILE_MONITOR_EVENT_DELETED:
+    case Gio::FILE_MONITOR_EVENT_MOVED_IN:
+    case Gio::FILE_MONITOR_EVENT_MOVED_OUT:
+      if (!isWatched(file)) {
+        return;
+      }
+      break;
+    case Gio::FILE_MONITOR_EVENT_RENAMED:
+      // renamed over it, or away
+      if (!isWatched(file) && !isWatched(other)) {
+        return;
+      }
+      break;
+    default:
+      // the writes themselves, their end is hinted
+      return;
+  }
+  settle_.disconnect();
+  settle_ = Glib::signal_timeout().connect(
+      [this] {
+        on_change_();
+        return false;
+      },
+      SETTLE_MS);
+}
+
+}  // namespace waybar::util
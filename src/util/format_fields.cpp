@@ -0,0 +1,43 @@
+#include "util/format_fields.hpp"
+
+#include <algorithm>
+
+namespace waybar::util {
+
+FormatFields::FormatFields(std::string_view format) {
+  size_t pos = 0;
+  // open replacement fields, the ones in a spec are nested in their parent's
+  int depth = 0;
+  while (pos < format.size()) {
+    const char c = format[pos];
+    if (depth == 0 && (c == '{' || c == '}') && pos + 1 < format.size() && format[pos + 1] == c) {
+      pos += 2;  // escaped brace
+      continue;
+    }
+    if (c == '}') {
+      depth = std::max(0, depth - 1);
+      ++pos;
+      continue;
+    }
+    if (c != '{') {
+      ++pos;
+      continue;
+    }
+    ++depth;
+    ++pos;
+    const auto end = format.find_first_of(":}{", pos);
+    const auto name = format.substr(pos, end == std::string_view::npos ? end : end - pos);
+    if (name.empty() || (name.front() >= '0' && name.front() <= '9')) {
+      positional_ = true;
+    } else if (!uses(name)) {
+      names_.emplace_back(name);
+    }
+    pos += name.size();
+  }
+}
+
+bool FormatFields::uses(std::string_view name) const {
+  return positional_ || std::ranges::find(names_, name) != names_.end();
+}
+
+}  // namespace waybar::util
@@ -1,7 +1,105 @@
 #include "util/icon_loader.hpp"
 
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "util/desktop_file_index.hpp"
 #include "util/string.hpp"
 
+namespace {
+
+// app id list -> app info, null for the lists without one
+struct AppInfoCache {
+  std::mutex mutex;
+  uint64_t generation = 0;
+  std::unordered_map<std::string, Glib::RefPtr<Gio::DesktopAppInfo>> entries;
+};
+
+/* Rendered icons keyed by theme, what was looked up in it, size and scale, least recently used
+ * evicted past the limit. The themes that don't have an icon are remembered too, as a null
+ * surface, so that they aren't asked again. Entries of a theme are dropped when it changes.
+ * GTK thread only.
+ */
+class IconSurfaceLru {
+ public:
+  static IconSurfaceLru &inst() {
+    static auto *lru = new IconSurfaceLru();
+    return *lru;
+  }
+
+  // nullptr if nothing is cached for key
+  const Cairo::RefPtr<Cairo::Surface> *get(Gtk::IconTheme *theme, const std::string &key) {
+    auto it = index_.find(indexKey(theme, key));
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->surface;
+  }
+
+  void put(const Glib::RefPtr<Gtk::IconTheme> &theme, const std::string &key,
+           const Cairo::RefPtr<Cairo::Surface> &surface) {
+    auto *ptr = theme.operator->();
+    if (!watched_.contains(ptr)) {
+      watched_[ptr] = theme->signal_changed().connect([this, ptr] { drop(ptr); });
+    }
+    auto index_key = indexKey(ptr, key);
+    if (auto it = index_.find(index_key); it != index_.end()) {
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    entries_.push_front({ptr, index_key, surface});
+    index_.emplace(std::move(index_key), entries_.begin());
+    while (entries_.size() > LIMIT) {
+      index_.erase(entries_.back().key);
+      entries_.pop_back();
+    }
+  }
+
+  // The theme is going away
+  void forget(Gtk::IconTheme *theme) {
+    drop(theme);
+    if (auto it = watched_.find(theme); it != watched_.end()) {
+      it->second.disconnect();
+      watched_.erase(it);
+    }
+  }
+
+ private:
+  static constexpr size_t LIMIT = 512;
+
+  struct Entry {
+    Gtk::IconTheme *theme;
+    std::string key;
+    Cairo::RefPtr<Cairo::Surface> surface;
+  };
+
+  IconSurfaceLru() = default;
+
+  static std::string indexKey(Gtk::IconTheme *theme, const std::string &key) {
+    return std::to_string(reinterpret_cast<uintptr_t>(theme)) + '\n' + key;
+  }
+
+  void drop(Gtk::IconTheme *theme) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->theme == theme) {
+        index_.erase(it->key);
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  std::unordered_map<Gtk::IconTheme *, sigc::connection> watched_;
+};
+
+}  // namespace
+
 std::vector<std::string> IconLoader::search_prefix() {
   std::vector<std::string> prefixes = {""};
 
@@ -107,6 +205,29 @@ std::string IconLoader::get_icon_name_from_icon_theme(
 
 bool IconLoader::image_load_icon(Gtk::Image &image, const Glib::RefPtr<Gtk::IconTheme> &icon_theme,
                                  Glib::RefPtr<Gio::DesktopAppInfo> app_info, int size) {
+  std::string key = "\n";
+  if (app_info) {
+    key = app_info->get_startup_wm_class() + '\n' +
+          (app_info->get_icon() ? app_info->get_icon()->to_string() : "");
+  }
+  key += '\n' + std::to_string(size) + '@' + std::to_string(image.get_scale_factor());
+
+  auto &lru = IconSurfaceLru::inst();
+  const auto *cached = lru.get(icon_theme.operator->(), key);
+  auto surface = cached != nullptr ? *cached : render_icon(image, icon_theme, app_info, size);
+  if (cached == nullptr) {
+    lru.put(icon_theme, key, surface);
+  }
+  if (!surface) {
+    return false;
+  }
+  image.set(surface);
+  return true;
+}
+
+Cairo::RefPtr<Cairo::Surface> IconLoader::render_icon(
+    Gtk::Image &image, const Glib::RefPtr<Gtk::IconTheme> &icon_theme,
+    const Glib::RefPtr<Gio::DesktopAppInfo> &app_info, int size) {
   std::string ret_icon_name = "unknown";
   if (app_info) {
     std::string icon_name =
@@ -143,13 +264,17 @@ bool IconLoader::image_load_icon(Gtk::Image &image, const Glib::RefPtr<Gtk::Icon
       int width = scaled_icon_size * pixbuf->get_width() / pixbuf->get_height();
       pixbuf = pixbuf->scale_simple(width, scaled_icon_size, Gdk::InterpType::INTERP_BILINEAR);
     }
-    auto surface = Gdk::Cairo::create_surface_from_pixbuf(pixbuf, image.get_scale_factor(),
-                                                          image.get_window());
-    image.set(surface);
-    return true;
+    return Gdk::Cairo::create_surface_from_pixbuf(pixbuf, image.get_scale_factor(),
+                                                  image.get_window());
   }
 
-  return false;
+  return {};
+}
+
+IconLoader::~IconLoader() {
+  for (auto &icon_theme : custom_icon_themes_) {
+    IconSurfaceLru::inst().forget(icon_theme.operator->());
+  }
 }
 
 void IconLoader::add_custom_icon_theme(const std::string &theme_name) {
@@ -171,6 +296,28 @@ bool IconLoader::image_load_icon(Gtk::Image &image, Glib::RefPtr<Gio::DesktopApp
 
 Glib::RefPtr<Gio::DesktopAppInfo> IconLoader::get_app_info_from_app_id_list(
     const std::string &app_id_list) {
+  static auto *cache = [] {
+    // the desktop file index watches the applications dirs, its generation tells of changes
+    waybar::util::DesktopFileIndex::inst().watch();
+    return new AppInfoCache();
+  }();
+
+  std::lock_guard lock(cache->mutex);
+  const auto generation = waybar::util::DesktopFileIndex::inst().generation();
+  if (generation != cache->generation) {
+    cache->entries.clear();
+    cache->generation = generation;
+  }
+  if (auto cached = cache->entries.find(app_id_list); cached != cache->entries.end()) {
+    return cached->second;
+  }
+  auto app_info = find_app_info_from_app_id_list(app_id_list);
+  cache->entries.emplace(app_id_list, app_info);
+  return app_info;
+}
+
+Glib::RefPtr<Gio::DesktopAppInfo> IconLoader::find_app_info_from_app_id_list(
+    const std::string &app_id_list) {
   std::string app_id;
   std::istringstream stream(app_id_list);
   Glib::RefPtr<Gio::DesktopAppInfo> app_info_;
@@ -0,0 +1,39 @@
+#include "util/log.hpp"
+
+#include <spdlog/async.h>
+
+namespace waybar::util::log {
+
+static constexpr std::size_t QUEUE_SIZE = 8192;
+
+void makeAsync() {
+  auto current = spdlog::default_logger();
+  if (std::dynamic_pointer_cast<spdlog::async_logger>(current)) {
+    return;  // already, the client runs again on reload
+  }
+  spdlog::init_thread_pool(QUEUE_SIZE, 1);
+  auto logger = std::make_shared<spdlog::async_logger>(
+      current->name(), current->sinks().begin(), current->sinks().end(), spdlog::thread_pool(),
+      spdlog::async_overflow_policy::overrun_oldest);
+  logger->set_level(current->level());
+  logger->flush_on(spdlog::level::err);
+  spdlog::set_default_logger(logger);
+}
+
+void flush() {
+  auto current = spdlog::default_logger();
+  if (!std::dynamic_pointer_cast<spdlog::async_logger>(current)) {
+    current->flush();
+    return;
+  }
+  auto logger =
+      std::make_shared<spdlog::logger>(current->name(), current->sinks().begin(),
+                                       current->sinks().end());
+  logger->set_level(current->level());
+  current.reset();
+  // Drops the async logger and its thread pool, which writes the queue before its thread ends
+  spdlog::shutdown();
+  spdlog::set_default_logger(logger);
+}
+
+}  // namespace waybar::util::log
@@ -0,0 +1,41 @@
+#include "util/memory.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "util/proc_file.hpp"
+
+namespace waybar::util::memory {
+
+size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  const auto info = mallinfo2();
+  // the big allocations are mmapped on their own, outside of the arenas
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+size_t residentSize() {
+  ProcFile statm{"/proc/self/statm"};
+  auto data = statm.tryRead();
+  size_t size = 0;
+  size_t resident = 0;
+  if (!data || !nextNumber(*data, size) || !nextNumber(*data, resident)) {
+    return 0;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+void trim() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+}  // namespace waybar::util::memory
@@ -6,9 +6,12 @@ namespace waybar::util::PipewireBackend {
 
 static void getNodeInfo(void *data_, const struct pw_node_info *info) {
   auto *pNodeInfo = static_cast<PrivacyNodeInfo *>(data_);
-  pNodeInfo->handleNodeEventInfo(info);
+  auto *backend = static_cast<PipewireBackend *>(pNodeInfo->data);
 
-  static_cast<PipewireBackend *>(pNodeInfo->data)->privacy_nodes_changed_signal_event.emit();
+  const std::lock_guard<std::mutex> lock(backend->mutex_);
+  if (pNodeInfo->handleNodeEventInfo(info)) {
+    backend->privacy_node_changed_signal_event.emit(pNodeInfo->snapshot());
+  }
 }
 
 static const struct pw_node_events NODE_EVENTS = {
@@ -103,6 +106,17 @@ std::shared_ptr<PipewireBackend> PipewireBackend::getInstance() {
   return std::make_shared<PipewireBackend>(tag);
 }
 
+sigc::connection PipewireBackend::subscribe(
+    const sigc::slot<void(const PrivacyNodeSnapshot &)> &slot) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[id, node] : privacy_nodes) {
+    if (node->active) {
+      slot(node->snapshot());
+    }
+  }
+  return privacy_node_changed_signal_event.connect(slot);
+}
+
 void PipewireBackend::handleRegistryEventGlobal(uint32_t id, uint32_t permissions, const char *type,
                                                 uint32_t version, const struct spa_dict *props) {
   if (props == nullptr || strcmp(type, PW_TYPE_INTERFACE_Node) != 0) return;
@@ -136,19 +150,23 @@ void PipewireBackend::handleRegistryEventGlobal(uint32_t id, uint32_t permission
 
   pw_proxy_add_object_listener(proxy, &pNodeInfo->object_listener, &NODE_EVENTS, pNodeInfo);
 
+  const std::lock_guard<std::mutex> lock(mutex_);
   privacy_nodes.insert_or_assign(id, pNodeInfo);
 }
 
 void PipewireBackend::handleRegistryEventGlobalRemove(uint32_t id) {
-  mutex_.lock();
+  const std::lock_guard<std::mutex> lock(mutex_);
   auto iter = privacy_nodes.find(id);
-  if (iter != privacy_nodes.end()) {
-    privacy_nodes[id]->~PrivacyNodeInfo();
-    privacy_nodes.erase(id);
+  if (iter == privacy_nodes.end()) return;
+
+  auto *pNodeInfo = iter->second;
+  privacy_nodes.erase(iter);
+  // Only the modules showing it have anything to drop
+  if (pNodeInfo->active) {
+    pNodeInfo->active = false;
+    privacy_node_changed_signal_event.emit(pNodeInfo->snapshot());
   }
-  mutex_.unlock();
-
-  privacy_nodes_changed_signal_event.emit();
+  pNodeInfo->~PrivacyNodeInfo();
 }
 
 }  // namespace waybar::util::PipewireBackend
@@ -2,29 +2,28 @@
 
 namespace waybar::util::PipewireBackend {
 
-std::string PrivacyNodeInfo::getName() {
-  const std::vector<std::string *> names{&application_name, &node_name};
-  std::string name = "Unknown Application";
-  for (const auto &item : names) {
-    if (item != nullptr && !item->empty()) {
+void PrivacyNodeInfo::resolveNames() {
+  name = UNKNOWN_NAME;
+  for (const auto *item : {&application_name, &node_name}) {
+    if (!item->empty()) {
       name = *item;
       name[0] = toupper(name[0]);
       break;
     }
   }
-  return name;
-}
 
-std::string PrivacyNodeInfo::getIconName() {
-  const std::vector<std::string *> names{&application_icon_name, &pipewire_access_portal_app_id,
-                                         &application_name, &node_name};
-  std::string name = "application-x-executable-symbolic";
-  for (const auto &item : names) {
-    if (item != nullptr && !item->empty() && DefaultGtkIconThemeWrapper::has_icon(*item)) {
-      return *item;
+  icon_name = UNKNOWN_ICON_NAME;
+  for (const auto *item :
+       {&application_icon_name, &pipewire_access_portal_app_id, &application_name, &node_name}) {
+    if (!item->empty() && DefaultGtkIconThemeWrapper::has_icon(*item)) {
+      icon_name = *item;
+      break;
     }
   }
-  return name;
+}
+
+PrivacyNodeSnapshot PrivacyNodeInfo::snapshot() const {
+  return {id, type, active, is_monitor, node_name, name, icon_name};
 }
 
 void PrivacyNodeInfo::handleProxyEventDestroy() {
@@ -32,8 +31,17 @@ void PrivacyNodeInfo::handleProxyEventDestroy() {
   spa_hook_remove(&object_listener);
 }
 
-void PrivacyNodeInfo::handleNodeEventInfo(const struct pw_node_info *info) {
+bool PrivacyNodeInfo::handleNodeEventInfo(const struct pw_node_info *info) {
+  const bool was_active = active;
   state = info->state;
+  active = state == PW_NODE_STATE_RUNNING;
+
+  // Streams report their state far more often than their properties
+  const bool props_changed =
+      (info->change_mask & PW_NODE_CHANGE_MASK_PROPS) != 0 && info->props != nullptr;
+  if (!props_changed) {
+    return active != was_active;
+  }
 
   const struct spa_dict_item *item;
   spa_dict_for_each(item, info->props) {
@@ -53,6 +61,8 @@ void PrivacyNodeInfo::handleNodeEventInfo(const struct pw_node_info *info) {
       is_monitor = strcmp(item->value, "true") == 0;
     }
   }
+  resolveNames();
+  return active || was_active;
 }
 
 }  // namespace waybar::util::PipewireBackend
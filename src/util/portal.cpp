@@ -35,7 +35,8 @@ auto fmt::formatter<waybar::Appearance>::format(waybar::Appearance c, format_con
 
 waybar::Portal::Portal()
     : Gio::DBus::Proxy(Gio::DBus::Connection::get_sync(Gio::DBus::BusType::BUS_TYPE_SESSION),
-                       PORTAL_BUS_NAME, PORTAL_OBJ_PATH, PORTAL_INTERFACE),
+                       PORTAL_BUS_NAME, PORTAL_OBJ_PATH, PORTAL_INTERFACE, {},
+                       Gio::DBus::PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES),
       currentMode(Appearance::UNKNOWN) {
   refreshAppearance();
 };
@@ -43,13 +44,24 @@ waybar::Portal::Portal()
 void waybar::Portal::refreshAppearance() {
   auto params = Glib::Variant<std::tuple<Glib::ustring, Glib::ustring>>::create(
       {PORTAL_NAMESPACE, PORTAL_KEY});
+  /* Not call_sync(): a portal that is not running yet, or never will, would hold the main loop
+   * until the D-Bus timeout. The appearance stays unknown until the reply.
+   */
+  call(std::string(PORTAL_INTERFACE) + ".Read", sigc::mem_fun(*this, &Portal::onAppearanceRead),
+       params);
+}
+
+void waybar::Portal::onAppearanceRead(const Glib::RefPtr<Gio::AsyncResult>& result) {
   Glib::VariantBase response;
   try {
-    response = call_sync(std::string(PORTAL_INTERFACE) + ".Read", params);
+    response = call_finish(result);
   } catch (const Glib::Error& e) {
     spdlog::info("Unable to receive desktop appearance: {}", std::string(e.what()));
     return;
   }
+  if (signalled_) {
+    return;  // a SettingChanged came meanwhile, newer than what was read
+  }
 
   // unfortunately, the response is triple-nested, with type (v<v<uint32_t>>),
   // so we have cast thrice. This is a variation from the freedesktop standard
@@ -97,6 +109,7 @@ void waybar::Portal::on_signal(const Glib::ustring& sender_name, const Glib::ust
   auto value =
       Glib::VariantBase::cast_dynamic<Glib::Variant<Glib::Variant<uint32_t>>>(valuev).get().get();
   auto newMode = Appearance(value);
+  signalled_ = true;
   if (newMode == currentMode) {
     return;
   }
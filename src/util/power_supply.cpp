@@ -0,0 +1,32 @@
+#include "util/power_supply.hpp"
+
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace waybar::util {
+
+static std::string readAttribute(const std::filesystem::path& supply, const char* name) {
+  std::ifstream file(supply / name);
+  std::string value;
+  std::getline(file, value);
+  return value;
+}
+
+bool onBatteryPower(const std::filesystem::path& power_supplies) {
+  std::error_code ec;
+  bool battery = false;
+  for (const auto& entry : std::filesystem::directory_iterator(power_supplies, ec)) {
+    const auto& supply = entry.path();
+    const auto type = readAttribute(supply, "type");
+    if (type == "Battery") {
+      battery = battery || readAttribute(supply, "scope") != "Device";
+    } else if ((type == "Mains" || type.starts_with("USB")) &&
+               readAttribute(supply, "online") == "1") {
+      return false;
+    }
+  }
+  return battery;
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,69 @@
+#include "util/priority.hpp"
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+namespace waybar::util {
+
+namespace {
+
+#ifdef __linux__
+// from linux/ioprio.h, which old kernel headers don't have
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+#endif
+
+std::atomic<int> background_nice{0};
+std::atomic<bool> background_idle{false};
+
+}  // namespace
+
+Priority parsePriority(const Json::Value& config) {
+  if (config.isString()) {
+    if (config.asString() == "idle") {
+      return {.idle = true};
+    }
+    spdlog::warn("Unknown background-priority '{}'", config.asString());
+  } else if (config.isInt()) {
+    return {.nice = std::clamp(config.asInt(), 0, 19)};
+  }
+  return {};
+}
+
+void setBackgroundPriority(Priority priority) {
+  background_nice = priority.nice;
+  background_idle = priority.idle;
+}
+
+void applyBackgroundPriority() {
+#ifdef __linux__
+  const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+  if (const int nice = background_nice; nice > 0 && setpriority(PRIO_PROCESS, tid, nice) != 0) {
+    spdlog::debug("Can't set the nice value of thread {}: {}", tid, strerror(errno));
+  }
+  if (background_idle) {
+    sched_param param = {};
+    if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
+      spdlog::debug("Can't set SCHED_IDLE on thread {}: {}", tid, strerror(errno));
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) !=
+        0) {
+      spdlog::debug("Can't set the idle I/O class on thread {}: {}", tid, strerror(errno));
+    }
+  }
+#endif
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,67 @@
+#include "util/proc_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace waybar::util {
+
+ProcFile::ProcFile(std::string path) : path_{std::move(path)} {}
+
+ProcFile::~ProcFile() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+std::string_view ProcFile::read() {
+  std::string_view out;
+  const bool opened = fd_ != -1;
+  if (const int err = readAll(out); err != 0) {
+    throw std::runtime_error((opened ? "Can't read from " : "Can't open ") + path_ + ": " +
+                             strerror(err));
+  }
+  return out;
+}
+
+std::optional<std::string_view> ProcFile::tryRead() {
+  std::string_view out;
+  if (readAll(out) != 0) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+int ProcFile::readAll(std::string_view& out) {
+  if (fd_ == -1) {
+    fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+      return errno;
+    }
+  }
+  if (buf_.empty()) {
+    buf_.resize(INITIAL_SIZE);
+  }
+  while (true) {
+    const auto n = pread(fd_, buf_.data(), buf_.size(), 0);
+    if (n < 0) {
+      const int err = errno;
+      // the file went away (unplugged device, ...), reopen on the next call
+      close(fd_);
+      fd_ = -1;
+      return err;
+    }
+    if (static_cast<size_t>(n) < buf_.size()) {
+      out = {buf_.data(), static_cast<size_t>(n)};
+      return 0;
+    }
+    // may be truncated, read it again in one go so the contents stay consistent
+    buf_.resize(buf_.size() * 2);
+  }
+}
+
+}  // namespace waybar::util
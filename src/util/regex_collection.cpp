@@ -4,20 +4,250 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cctype>
 #include <utility>
 
 namespace waybar::util {
 
 int default_priority_function(std::string& key) { return 0; }
 
+namespace {
+
+char fold(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+
+/* Longest run of literal characters that every match of the (ECMAScript) pattern has to contain,
+ * lowercased for the case-insensitive rules. Deliberately conservative: groups, classes, escapes
+ * other than escaped punctuation and anchors end a run, a quantifier that allows zero repetitions
+ * takes its character out of the run, and a top-level alternation disables the literal entirely.
+ */
+std::string required_literal(const std::string& pattern) {
+  std::string best;
+  std::string run;
+  auto end_run = [&] {
+    if (run.size() > best.size()) {
+      best = run;
+    }
+    run.clear();
+  };
+
+  int depth = 0;
+  bool in_class = false;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    char c = pattern[i];
+    if (in_class) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == ']') {
+        in_class = false;
+      }
+      continue;
+    }
+    switch (c) {
+      case '\\':
+        if (i + 1 >= pattern.size()) {
+          return {};
+        }
+        ++i;
+        if (depth == 0 && std::ispunct(static_cast<unsigned char>(pattern[i]))) {
+          run += fold(pattern[i]);
+        } else {
+          end_run();
+        }
+        break;
+      case '[':
+        in_class = true;
+        end_run();
+        break;
+      case '(':
+        ++depth;
+        end_run();
+        break;
+      case ')':
+        --depth;
+        break;
+      case '|':
+        if (depth == 0) {
+          return {};
+        }
+        break;
+      case '?':
+      case '*':
+      case '{':
+        // The preceding atom is optional (or its count unknown): it can't be part of the run
+        if (depth == 0 && !run.empty()) {
+          run.pop_back();
+        }
+        end_run();
+        if (c == '{') {
+          while (i < pattern.size() && pattern[i] != '}') {
+            ++i;
+          }
+        }
+        break;
+      case '+':
+        end_run();
+        break;
+      case '.':
+      case '^':
+      case '$':
+        end_run();
+        break;
+      default:
+        if (depth == 0) {
+          run += fold(c);
+        }
+        break;
+    }
+  }
+  if (in_class || depth != 0) {
+    return {};
+  }
+  end_run();
+  return best;
+}
+
+}  // namespace
+
+/* Aho-Corasick automaton over the rules' required literals (ASCII case-folded). Scanning a string
+ * marks every literal it contains in a single pass.
+ */
+class LiteralMatcher {
+ public:
+  explicit LiteralMatcher(const std::vector<std::string>& literals) : literal_count_(literals.size()) {
+    nodes_.emplace_back();
+    for (size_t id = 0; id < literals.size(); ++id) {
+      int node = 0;
+      for (char c : literals[id]) {
+        int next = child(node, c);
+        if (next < 0) {
+          next = static_cast<int>(nodes_.size());
+          nodes_[node].edges.emplace_back(c, next);
+          nodes_.emplace_back();
+        }
+        node = next;
+      }
+      nodes_[node].outputs.push_back(static_cast<int>(id));
+    }
+
+    // Breadth-first failure links; outputs are merged along them
+    std::vector<int> queue;
+    for (auto [c, next] : nodes_[0].edges) {
+      queue.push_back(next);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+      int node = queue[head];
+      for (auto [c, next] : nodes_[node].edges) {
+        int fail = nodes_[node].fail;
+        while (fail > 0 && child(fail, c) < 0) {
+          fail = nodes_[fail].fail;
+        }
+        int target = child(fail, c);
+        nodes_[next].fail = (target >= 0 && target != next) ? target : 0;
+        const auto& inherited = nodes_[nodes_[next].fail].outputs;
+        nodes_[next].outputs.insert(nodes_[next].outputs.end(), inherited.begin(), inherited.end());
+        queue.push_back(next);
+      }
+    }
+  }
+
+  std::vector<bool> scan(const std::string& text) const {
+    std::vector<bool> found(literal_count_, false);
+    int node = 0;
+    for (char raw : text) {
+      char c = fold(raw);
+      while (node > 0 && child(node, c) < 0) {
+        node = nodes_[node].fail;
+      }
+      int next = child(node, c);
+      node = next >= 0 ? next : 0;
+      for (int id : nodes_[node].outputs) {
+        found[id] = true;
+      }
+    }
+    return found;
+  }
+
+ private:
+  struct Node {
+    std::vector<std::pair<char, int>> edges;
+    std::vector<int> outputs;
+    int fail = 0;
+  };
+
+  int child(int node, char c) const {
+    for (auto [edge, next] : nodes_[node].edges) {
+      if (edge == c) {
+        return next;
+      }
+    }
+    return -1;
+  }
+
+  size_t literal_count_;
+  std::vector<Node> nodes_;
+};
+
+RegexCollection::Cache::Cache(size_t capacity)
+    : shard_capacity_(std::max<size_t>(1, (capacity + SHARD_COUNT - 1) / SHARD_COUNT)) {}
+
+RegexCollection::Cache::Shard& RegexCollection::Cache::shard_for(std::string_view key) {
+  return shards_[std::hash<std::string_view>{}(key) % SHARD_COUNT];
+}
+
+bool RegexCollection::Cache::get(std::string_view key, std::string& value, bool& matched_any) {
+  auto& shard = shard_for(key);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.index.find(key);
+  if (it == shard.index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+  value = it->second->value;
+  matched_any = it->second->matched_any;
+  return true;
+}
+
+void RegexCollection::Cache::put(std::string_view key, const std::string& value,
+                                 bool matched_any) {
+  auto& shard = shard_for(key);
+  std::lock_guard lock(shard.mutex);
+  if (shard.index.contains(key)) {
+    return;  // another thread resolved the same string meanwhile
+  }
+  if (shard.entries.size() >= shard_capacity_) {
+    shard.index.erase(shard.entries.back().key);
+    shard.entries.pop_back();
+  }
+  shard.entries.push_front({std::string(key), value, matched_any});
+  // The key view points into the list node, which stays put until the entry is evicted
+  shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+}
+
+RegexCollection::CacheStats RegexCollection::Cache::stats() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard lock(shard.mutex);
+    size += shard.entries.size();
+  }
+  return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed), size};
+}
+
+RegexCollection::RegexCollection()
+    : regex_cache(std::make_unique<Cache>(DEFAULT_CACHE_CAPACITY)) {}
+
 RegexCollection::RegexCollection(const Json::Value& map, std::string default_repr,
-                                 const std::function<int(std::string&)>& priority_function)
-    : default_repr(std::move(default_repr)) {
+                                 const std::function<int(std::string&)>& priority_function,
+                                 size_t cache_capacity)
+    : regex_cache(std::make_unique<Cache>(cache_capacity)),
+      default_repr(std::move(default_repr)) {
   if (!map.isObject()) {
     spdlog::warn("Mapping is not an object");
     return;
   }
 
+  std::vector<std::string> literals;
   for (auto it = map.begin(); it != map.end(); ++it) {
     if (it.key().isString() && it->isString()) {
       std::string key = it.key().asString();
@@ -25,6 +255,10 @@ RegexCollection::RegexCollection(const Json::Value& map, std::string default_rep
       try {
         const std::regex rule{key, std::regex_constants::icase};
         rules.emplace_back(rule, it->asString(), priority);
+        if (auto literal = required_literal(key); !literal.empty()) {
+          rules.back().literal = static_cast<int>(literals.size());
+          literals.push_back(std::move(literal));
+        }
       } catch (const std::regex_error& e) {
         spdlog::error("Invalid rule '{}': {}", key, e.what());
       }
@@ -32,10 +266,23 @@ RegexCollection::RegexCollection(const Json::Value& map, std::string default_rep
   }
 
   std::sort(rules.begin(), rules.end(), [](Rule& a, Rule& b) { return a.priority > b.priority; });
+
+  if (!literals.empty()) {
+    prefilter = std::make_shared<const LiteralMatcher>(literals);
+  }
 }
 
 std::string RegexCollection::find_match(std::string& value, bool& matched_any) {
+  std::vector<bool> present;
+  if (prefilter) {
+    present = prefilter->scan(value);
+  }
+
+  // Still in priority order; rules whose literal is absent cannot match and are skipped
   for (auto& rule : rules) {
+    if (rule.literal >= 0 && !present[rule.literal]) {
+      continue;
+    }
     std::smatch match;
     if (std::regex_search(value, match, rule.rule)) {
       matched_any = true;
@@ -46,26 +293,24 @@ std::string RegexCollection::find_match(std::string& value, bool& matched_any) {
   return value;
 }
 
-std::string& RegexCollection::get(std::string& value, bool& matched_any) {
-  if (regex_cache.contains(value)) {
-    return regex_cache[value];
+std::string RegexCollection::get(std::string& value, bool& matched_any) {
+  std::string repr;
+  if (regex_cache->get(value, repr, matched_any)) {
+    return repr;
   }
 
-  // std::string repr =
-  // waybar::util::find_match(value, window_rewrite_rules_, matched_any);
-
-  std::string repr = find_match(value, matched_any);
+  repr = find_match(value, matched_any);
 
   if (!matched_any) {
     repr = default_repr;
   }
 
-  regex_cache.emplace(value, repr);
+  regex_cache->put(value, repr, matched_any);
 
-  return regex_cache[value];  // Necessary in order to return a reference to the heap
+  return repr;
 }
 
-std::string& RegexCollection::get(std::string& value) {
+std::string RegexCollection::get(std::string& value) {
   bool matched_any = false;
   return get(value, matched_any);
 }
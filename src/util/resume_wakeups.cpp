@@ -0,0 +1,153 @@
+#include "util/resume_wakeups.hpp"
+
+#include <giomm/networkmonitor.h>
+#include <glibmm/main.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+#include "util/prepare_for_sleep.h"
+
+namespace waybar::util {
+
+std::optional<ResumeWake> parseResumeWake(const std::string& wake) {
+  if (wake == "immediate") {
+    return ResumeWake::IMMEDIATE;
+  }
+  if (wake == "staggered") {
+    return ResumeWake::STAGGERED;
+  }
+  if (wake == "online") {
+    return ResumeWake::ONLINE;
+  }
+  return std::nullopt;
+}
+
+ResumeWakeups& ResumeWakeups::inst() {
+  static auto* wakeups = new ResumeWakeups();
+  return *wakeups;
+}
+
+ResumeWakeups::ResumeWakeups() {
+  resume_ = prepare_for_sleep().connect([this](bool sleep) {
+    if (!sleep) {
+      onResume();
+    }
+  });
+}
+
+ResumeWakeups::Id ResumeWakeups::add(ResumeWake wake, std::function<void()> wake_up) {
+  std::lock_guard lock(mutex_);
+  auto id = nextId_++;
+  entries_.emplace(id, Entry{wake, std::move(wake_up)});
+  return id;
+}
+
+void ResumeWakeups::setWake(Id id, ResumeWake wake) {
+  std::lock_guard lock(mutex_);
+  if (auto it = entries_.find(id); it != entries_.end()) {
+    it->second.wake = wake;
+  }
+}
+
+void ResumeWakeups::remove(Id id) {
+  // the ids left in the queues are skipped once their entry is gone
+  std::lock_guard lock(mutex_);
+  entries_.erase(id);
+}
+
+void ResumeWakeups::setWindow(std::chrono::milliseconds window) {
+  std::lock_guard lock(mutex_);
+  window_ = std::max(window, std::chrono::milliseconds(0));
+}
+
+void ResumeWakeups::onResume() {
+  std::vector<Id> staggered;
+  {
+    std::lock_guard lock(mutex_);
+    online_.clear();
+    for (auto& [id, entry] : entries_) {
+      switch (entry.wake) {
+        case ResumeWake::IMMEDIATE:
+          entry.wake_up();
+          break;
+        case ResumeWake::STAGGERED:
+          staggered.push_back(id);
+          break;
+        case ResumeWake::ONLINE:
+          online_.push_back(id);
+          break;
+      }
+    }
+  }
+  stagger(staggered);
+
+  auto monitor = Gio::NetworkMonitor::get_default();
+  if (!monitor || monitor->get_network_available()) {
+    onNetworkChanged(true);
+    return;
+  }
+  spdlog::debug("Resume: waiting for the network to wake the modules needing it");
+  if (!network_.connected()) {
+    network_ = monitor->signal_network_changed().connect(
+        sigc::mem_fun(*this, &ResumeWakeups::onNetworkChanged));
+  }
+}
+
+void ResumeWakeups::onNetworkChanged(bool available) {
+  if (!available) {
+    return;
+  }
+  network_.disconnect();
+  std::vector<Id> online;
+  {
+    std::lock_guard lock(mutex_);
+    online.swap(online_);
+  }
+  stagger(online);
+}
+
+void ResumeWakeups::stagger(const std::vector<Id>& ids) {
+  if (ids.empty()) {
+    return;
+  }
+  std::lock_guard lock(mutex_);
+  // a wake-up left from the previous batch comes first
+  staggered_.erase(staggered_.begin(), staggered_.begin() + next_);
+  next_ = 0;
+  staggered_.insert(staggered_.end(), ids.begin(), ids.end());
+
+  timer_.disconnect();
+  auto step = window_ / static_cast<long>(staggered_.size());
+  if (step <= std::chrono::milliseconds(0)) {
+    for (auto id : staggered_) {
+      wake(id);
+    }
+    staggered_.clear();
+    return;
+  }
+  wake(staggered_[next_++]);
+  timer_ = Glib::signal_timeout().connect(sigc::mem_fun(*this, &ResumeWakeups::wakeNext),
+                                          step.count());
+}
+
+bool ResumeWakeups::wakeNext() {
+  std::lock_guard lock(mutex_);
+  if (next_ < staggered_.size()) {
+    wake(staggered_[next_++]);
+  }
+  if (next_ < staggered_.size()) {
+    return true;
+  }
+  staggered_.clear();
+  next_ = 0;
+  return false;
+}
+
+void ResumeWakeups::wake(Id id) {
+  if (auto it = entries_.find(id); it != entries_.end()) {
+    it->second.wake_up();
+  }
+}
+
+}  // namespace waybar::util
@@ -4,29 +4,73 @@
 
 #include <regex>
 
+#include "util/shared_instance.hpp"
+
 namespace waybar::util {
 std::string rewriteString(const std::string& value, const Json::Value& rules) {
   if (!rules.isObject()) {
     return value;
   }
 
-  std::string res = value;
+  return RewriteRules(rules).apply(value);
+}
+
+RewriteRules::RewriteRules(const Json::Value& rules) {
+  if (!rules.isObject()) {
+    return;
+  }
 
   for (auto it = rules.begin(); it != rules.end(); ++it) {
     if (it.key().isString() && it->isString()) {
       try {
         // malformated regexes will cause an exception.
         // in this case, log error and try the next rule.
-        const std::regex rule{it.key().asString(), std::regex_constants::icase};
-        if (std::regex_match(value, rule)) {
-          res = std::regex_replace(res, rule, it->asString());
-        }
+        rules_.push_back({std::regex{it.key().asString(), std::regex_constants::icase},
+                          it->asString()});
       } catch (const std::regex_error& e) {
         spdlog::error("Invalid rule {}: {}", it.key().asString(), e.what());
       }
     }
   }
+}
+
+std::shared_ptr<const RewriteRules> RewriteRules::shared(const Json::Value& rules) {
+  static std::mutex mutex;
+  static SharedInstances<std::string, const RewriteRules> instances;
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  auto key = Json::writeString(builder, rules);
+
+  std::lock_guard lock(mutex);
+  return instances.get(key, [&rules] { return std::make_shared<const RewriteRules>(rules); });
+}
+
+std::string RewriteRules::apply(const std::string& value) const {
+  if (rules_.empty()) {
+    return value;
+  }
+
+  {
+    std::lock_guard lock(memo_mutex_);
+    if (auto it = memo_.find(value); it != memo_.end()) {
+      return it->second;
+    }
+  }
 
+  std::string res = value;
+  for (const auto& rule : rules_) {
+    if (std::regex_match(value, rule.regex)) {
+      res = std::regex_replace(res, rule.regex, rule.replacement);
+    }
+  }
+
+  std::lock_guard lock(memo_mutex_);
+  if (memo_.size() >= MEMO_CAPACITY) {
+    // Titles that stopped repeating are not worth tracking individually
+    memo_.clear();
+  }
+  memo_.emplace(value, res);
   return res;
 }
 }  // namespace waybar::util
@@ -24,58 +24,100 @@
 #include <spdlog/spdlog.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cerrno>
+#include <vector>
 
-waybar::util::Rfkill::Rfkill(const enum rfkill_type rfkill_type) : rfkill_type_(rfkill_type) {
-  fd_ = open("/dev/rfkill", O_RDONLY);
-  if (fd_ < 0) {
-    spdlog::error("Can't open RFKILL control device");
-    return;
+#include "util/shared_instance.hpp"
+
+class waybar::util::Rfkill::Monitor {
+ public:
+  static std::shared_ptr<Monitor> getInstance() {
+    static SharedInstance<Monitor> instance;
+    return instance.get([] { return std::make_shared<Monitor>(); });
   }
-  int rc = fcntl(fd_, F_SETFL, O_NONBLOCK);
-  if (rc < 0) {
-    spdlog::error("Can't set RFKILL control device to non-blocking: {}", errno);
-    close(fd_);
-    fd_ = -1;
-    return;
+
+  Monitor() {
+    fd_ = open("/dev/rfkill", O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+      spdlog::error("Can't open RFKILL control device");
+      return;
+    }
+    int rc = fcntl(fd_, F_SETFL, O_NONBLOCK);
+    if (rc < 0) {
+      spdlog::error("Can't set RFKILL control device to non-blocking: {}", errno);
+      close(fd_);
+      fd_ = -1;
+      return;
+    }
+    // The first reads are the ADD events of the devices present
+    connection_ = Glib::signal_io().connect(sigc::mem_fun(*this, &Monitor::onEvent), fd_,
+                                            Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP);
   }
-  Glib::signal_io().connect(sigc::mem_fun(*this, &Rfkill::on_event), fd_,
-                            Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP);
-}
 
-waybar::util::Rfkill::~Rfkill() {
-  if (fd_ >= 0) {
-    close(fd_);
+  ~Monitor() {
+    connection_.disconnect();
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  void subscribe(Rfkill* rfkill) { subscribers_.push_back(rfkill); }
+  void unsubscribe(Rfkill* rfkill) { std::erase(subscribers_, rfkill); }
+
+  bool getState(enum rfkill_type type) const {
+    return type < NUM_RFKILL_TYPES && state_[type].load();
   }
-}
 
-bool waybar::util::Rfkill::on_event(Glib::IOCondition cond) {
-  if (cond & Glib::IO_IN) {
-    struct rfkill_event event;
-    ssize_t len;
+ private:
+  bool onEvent(Glib::IOCondition cond) {
+    if (cond & Glib::IO_IN) {
+      struct rfkill_event event;
+      ssize_t len;
 
-    len = read(fd_, &event, sizeof(event));
-    if (len < 0) {
-      if (errno == EAGAIN) {
+      len = read(fd_, &event, sizeof(event));
+      if (len < 0) {
+        if (errno == EAGAIN) {
+          return true;
+        }
+        spdlog::error("Reading of RFKILL events failed: {}", errno);
+        return false;
+      }
+
+      if (static_cast<size_t>(len) < RFKILL_EVENT_SIZE_V1) {
+        spdlog::error("Wrong size of RFKILL event: {} < {}", len, RFKILL_EVENT_SIZE_V1);
         return true;
       }
-      spdlog::error("Reading of RFKILL events failed: {}", errno);
-      return false;
-    }
 
-    if (static_cast<size_t>(len) < RFKILL_EVENT_SIZE_V1) {
-      spdlog::error("Wrong size of RFKILL event: {} < {}", len, RFKILL_EVENT_SIZE_V1);
+      if (event.type < NUM_RFKILL_TYPES &&
+          (event.op == RFKILL_OP_ADD || event.op == RFKILL_OP_CHANGE)) {
+        state_[event.type] = event.soft || event.hard;
+        // a copy, an update may destroy a module and its instance
+        for (auto* rfkill : std::vector(subscribers_)) {
+          if (rfkill->rfkill_type_ == event.type && std::ranges::count(subscribers_, rfkill)) {
+            rfkill->on_update.emit(event);
+          }
+        }
+      }
       return true;
     }
-
-    if (event.type == rfkill_type_ && (event.op == RFKILL_OP_ADD || event.op == RFKILL_OP_CHANGE)) {
-      state_ = event.soft || event.hard;
-      on_update.emit(event);
-    }
-    return true;
+    spdlog::error("Failed to poll RFKILL control device");
+    return false;
   }
-  spdlog::error("Failed to poll RFKILL control device");
-  return false;
+
+  int fd_ = -1;
+  sigc::connection connection_;
+  std::array<std::atomic_bool, NUM_RFKILL_TYPES> state_{};
+  std::vector<Rfkill*> subscribers_;
+};
+
+waybar::util::Rfkill::Rfkill(const enum rfkill_type rfkill_type)
+    : rfkill_type_(rfkill_type), monitor_(Monitor::getInstance()) {
+  monitor_->subscribe(this);
 }
 
-bool waybar::util::Rfkill::getState() const { return state_; }
+waybar::util::Rfkill::~Rfkill() { monitor_->unsubscribe(this); }
+
+bool waybar::util::Rfkill::getState() const { return monitor_->getState(rfkill_type_); }
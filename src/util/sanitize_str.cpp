@@ -1,23 +1,89 @@
-#include <array>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <util/sanitize_str.hpp>
-#include <utility>
 
 namespace waybar::util {
+
+namespace {
+
+constexpr uint64_t ONES = 0x0101010101010101ULL;
+constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+// Whether one of the bytes of word is c
+constexpr bool hasByte(uint64_t word, char c) {
+  const uint64_t x = word ^ (ONES * static_cast<unsigned char>(c));
+  return ((x - ONES) & ~x & HIGH_BITS) != 0;
+}
+
+// The entity of the character, empty if it stays as it is
+constexpr std::string_view entity(char c) {
+  switch (c) {
+    case '&':
+      return "&amp;";
+    case '<':
+      return "&lt;";
+    case '>':
+      return "&gt;";
+    case '"':
+      return "&quot;";
+    case '\'':
+      return "&apos;";
+    default:
+      return {};
+  }
+}
+
+// The offset of the first of ``<>&"'`` in text, its size if there is none. Most titles have none:
+// they are scanned a word at a time
+size_t findSpecial(std::string_view text) {
+  const char* data = text.data();
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= text.size(); offset += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + offset, sizeof(word));
+    if (hasByte(word, '&') || hasByte(word, '<') || hasByte(word, '>') || hasByte(word, '"') ||
+        hasByte(word, '\'')) {
+      break;
+    }
+  }
+  for (; offset < text.size(); ++offset) {
+    if (!entity(data[offset]).empty()) {
+      break;
+    }
+  }
+  return offset;
+}
+
+}  // namespace
+
 // replaces ``<>&"'`` with their encoded counterparts
 std::string sanitize_string(std::string str) {
-  // note: it's important that '&' is replaced first; therefore we *can't* use std::map
-  const std::pair<char, std::string> replacement_table[] = {
-      {'&', "&amp;"}, {'<', "&lt;"}, {'>', "&gt;"}, {'"', "&quot;"}, {'\'', "&apos;"}};
-  size_t startpoint;
-  for (const auto& pair : replacement_table) {
-    startpoint = 0;
-    while ((startpoint = str.find(pair.first, startpoint)) != std::string::npos) {
-      str.replace(startpoint, 1, pair.second);
-      startpoint += pair.second.length();
-    }
+  const size_t first = findSpecial(str);
+  if (first == str.size()) {
+    return str;
   }
 
-  return str;
+  // One pass for the size, one to write: no replace shifting the rest of the string each time
+  size_t size = str.size();
+  for (size_t i = first; i < str.size(); ++i) {
+    if (auto replacement = entity(str[i]); !replacement.empty()) {
+      size += replacement.size() - 1;
+    }
+  }
+  std::string out(size, '\0');
+  std::memcpy(out.data(), str.data(), first);
+  char* dst = out.data() + first;
+  for (size_t i = first; i < str.size(); ++i) {
+    if (auto replacement = entity(str[i]); !replacement.empty()) {
+      std::memcpy(dst, replacement.data(), replacement.size());
+      dst += replacement.size();
+    } else {
+      *dst++ = str[i];
+    }
+  }
+  return out;
 }
+
 }  // namespace waybar::util
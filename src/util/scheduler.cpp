@@ -0,0 +1,270 @@
+#include "util/scheduler.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+#include "util/power_supply.hpp"
+#include "util/prepare_for_sleep.h"
+
+namespace waybar::util {
+
+// Periods at least this long never come back around ("interval": "once")
+constexpr auto NEVER = std::chrono::hours(24 * 365);
+// How often the power source is checked, once watched
+constexpr auto POWER_CHECK = std::chrono::seconds(10);
+
+Scheduler& Scheduler::inst() {
+  static auto* scheduler = new Scheduler();
+  return *scheduler;
+}
+
+Scheduler::Scheduler() : thread_{[this] { run(); }} {
+  // refresh everything after a resume, like SleeperThread does
+  resume_ = prepare_for_sleep().connect([this](bool sleep) {
+    if (sleep) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& [id, task] : tasks_) {
+        task.woken = true;
+      }
+    }
+    condvar_.notify_all();
+  });
+}
+
+Scheduler::Clock::time_point Scheduler::nextDeadline(Clock::time_point now,
+                                                     std::chrono::milliseconds period) {
+  if (period >= NEVER) {
+    return Clock::time_point::max();
+  }
+  period = std::max(period, std::chrono::milliseconds(1));
+  const auto sinceEpoch = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch());
+  return Clock::time_point(
+      std::chrono::duration_cast<Clock::duration>((sinceEpoch / period + 1) * period));
+}
+
+std::chrono::milliseconds Scheduler::periodOn(bool battery, std::chrono::milliseconds period,
+                                              std::chrono::milliseconds battery_period) const {
+  if (!battery) {
+    return period;
+  }
+  if (battery_period.count() > 0) {
+    return battery_period;
+  }
+  if (period >= NEVER || batteryFactor_ == 1) {
+    return period;
+  }
+  const auto never = std::chrono::duration_cast<std::chrono::milliseconds>(NEVER);
+  const double scaled = static_cast<double>(period.count()) * batteryFactor_;
+  if (scaled >= static_cast<double>(never.count())) {
+    return never;
+  }
+  return std::chrono::milliseconds(std::max<int64_t>(1, static_cast<int64_t>(scaled)));
+}
+
+Scheduler::Id Scheduler::add(std::chrono::milliseconds period, std::function<void()> task,
+                             bool paused, std::chrono::milliseconds battery_period) {
+  Id id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = nextId_++;
+    auto& added = tasks_
+                      .emplace(id, Task{periodOn(onBattery_, period, battery_period), period,
+                                        battery_period, Clock::time_point::min(), std::move(task)})
+                      .first->second;
+    added.paused = paused;
+    watchPower_ = watchPower_ || (battery_period.count() > 0 && battery_period != period);
+  }
+  condvar_.notify_all();
+  return id;
+}
+
+void Scheduler::remove(Id id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = tasks_.find(id);
+  if (it == tasks_.end()) {
+    return;
+  }
+  it->second.removed = true;
+  if (std::this_thread::get_id() == thread_.get_id() && running_ == id) {
+    return;  // removed from its own callback, run() erases it once it returns
+  }
+  done_.wait(lock, [&] { return running_ != id; });
+  tasks_.erase(id);
+}
+
+void Scheduler::wake_up(Id id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end()) {
+      return;
+    }
+    it->second.woken = true;
+  }
+  condvar_.notify_all();
+}
+
+void Scheduler::pause(Id id, bool paused) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end() || it->second.paused == paused) {
+      return;
+    }
+    it->second.paused = paused;
+    // catch up on what was missed while paused
+    it->second.woken = !paused;
+  }
+  condvar_.notify_all();
+}
+
+void Scheduler::setBatteryFactor(double factor) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batteryFactor_ = factor > 0 ? factor : 1;
+    watchPower_ = watchPower_ || batteryFactor_ != 1;
+    retime(Clock::now());
+  }
+  condvar_.notify_all();
+}
+
+std::chrono::milliseconds Scheduler::currentPeriod(std::chrono::milliseconds period,
+                                                   std::chrono::milliseconds battery_period) {
+  std::chrono::milliseconds current;
+  bool watch = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!watchPower_ && battery_period.count() > 0 && battery_period != period) {
+      watchPower_ = watch = true;
+    }
+    current = periodOn(onBattery_, period, battery_period);
+  }
+  if (watch) {
+    condvar_.notify_all();
+  }
+  return current;
+}
+
+void Scheduler::retime(Clock::time_point now) {
+  for (auto& [id, task] : tasks_) {
+    const auto period = periodOn(onBattery_, task.mainsPeriod, task.batteryPeriod);
+    if (period == task.period) {
+      continue;
+    }
+    // polling faster again, catch up right away
+    task.woken = task.woken || period < task.period;
+    task.period = period;
+    if (task.next != Clock::time_point::min()) {
+      task.next = nextDeadline(now, period);
+    }
+  }
+}
+
+void Scheduler::checkPower(std::unique_lock<std::mutex>& lock, Clock::time_point now) {
+  // a check far ahead means the system clock went back
+  if (!watchPower_ || (now < powerCheckAt_ && powerCheckAt_ - now <= POWER_CHECK)) {
+    return;
+  }
+  powerCheckAt_ = now + POWER_CHECK;
+  lock.unlock();
+  const bool battery = onBatteryPower();
+  lock.lock();
+  if (battery != onBattery_) {
+    spdlog::info("{} power, retiming the periodic updates", battery ? "Battery" : "Mains");
+    onBattery_ = battery;
+    retime(now);
+  }
+}
+
+void Scheduler::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    auto now = Clock::now();
+    checkPower(lock, now);
+    auto wakeAt = watchPower_ ? powerCheckAt_ : Clock::time_point::max();
+    for (auto& [id, task] : tasks_) {
+      if (task.removed || task.paused) {
+        continue;
+      }
+      if (task.next != Clock::time_point::max() && task.next > now &&
+          task.next - now > task.period) {
+        // the system clock went back, don't wait for the old deadline to come around again
+        task.next = nextDeadline(now, task.period);
+      }
+      if (task.woken || task.next <= now) {
+        due_.push_back(id);
+        if (task.next <= now) {
+          task.next = nextDeadline(now, task.period);
+        }
+        task.woken = false;
+      }
+      wakeAt = std::min(wakeAt, task.next);
+    }
+
+    // Tasks run without the lock, so they may add, remove or wake tasks themselves.
+    for (auto id : due_) {
+      auto it = tasks_.find(id);
+      if (it == tasks_.end() || it->second.removed) {
+        continue;
+      }
+      // references survive a rehash by add(), iterators don't
+      auto& fn = it->second.fn;
+      running_ = id;
+      lock.unlock();
+      fn();
+      lock.lock();
+      running_ = 0;
+      done_.notify_all();
+      // the node stays put while running_ is set, but the callback may have removed itself
+      it = tasks_.find(id);
+      if (it != tasks_.end() && it->second.removed) {
+        tasks_.erase(it);
+      }
+    }
+    if (!due_.empty()) {
+      // the pass took time and may have registered tasks, recompute the deadline
+      due_.clear();
+      continue;
+    }
+
+    if (wakeAt == Clock::time_point::max()) {
+      condvar_.wait(lock);
+    } else {
+      // a relative wait is measured on the steady clock, so clock changes can't stretch it
+      condvar_.wait_for(lock, wakeAt - now);
+    }
+  }
+}
+
+void PeriodicTask::start(std::chrono::milliseconds period, std::function<void()> fn,
+                         std::chrono::milliseconds battery_period) {
+  stop();
+  id_ = Scheduler::inst().add(period, std::move(fn), paused_, battery_period);
+}
+
+void PeriodicTask::stop() {
+  if (id_ != 0) {
+    Scheduler::inst().remove(id_);
+    id_ = 0;
+  }
+}
+
+void PeriodicTask::wake_up() {
+  if (id_ != 0) {
+    Scheduler::inst().wake_up(id_);
+  }
+}
+
+void PeriodicTask::pause(bool paused) {
+  paused_ = paused;
+  if (id_ != 0) {
+    Scheduler::inst().pause(id_, paused);
+  }
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,187 @@
+#include "util/screencopy.hpp"
+
+#include <gdk/gdkwayland.h>
+#include <gdkmm/display.h>
+#include <gdkmm/monitor.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "client.hpp"
+#include "wlr-screencopy-unstable-v1-client-protocol.h"
+
+namespace waybar::util::screencopy {
+
+namespace {
+
+struct Frame {
+  Callback callback;
+  struct zwlr_screencopy_frame_v1* handle = nullptr;
+  struct wl_buffer* buffer = nullptr;
+  void* data = MAP_FAILED;
+  size_t size = 0;
+  uint32_t format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t stride = 0;
+  bool yInvert = false;
+
+  ~Frame() {
+    if (buffer != nullptr) {
+      wl_buffer_destroy(buffer);
+    }
+    if (data != MAP_FAILED) {
+      munmap(data, size);
+    }
+    if (handle != nullptr) {
+      zwlr_screencopy_frame_v1_destroy(handle);
+    }
+  }
+
+  void finish(Glib::RefPtr<Gdk::Pixbuf> pixbuf) {
+    auto cb = std::move(callback);
+    delete this;
+    if (cb) {
+      cb(std::move(pixbuf));
+    }
+  }
+};
+
+bool allocateBuffer(Frame* frame) {
+  auto* shm = waybar::Client::inst()->shm;
+  int fd = memfd_create("waybar-screencopy", MFD_CLOEXEC);
+  if (fd < 0) {
+    spdlog::debug("[SCREENCOPY] memfd_create failed: {}", strerror(errno));
+    return false;
+  }
+  frame->size = static_cast<size_t>(frame->stride) * frame->height;
+  if (ftruncate(fd, static_cast<off_t>(frame->size)) < 0) {
+    close(fd);
+    return false;
+  }
+  frame->data = mmap(nullptr, frame->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (frame->data == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  auto* pool = wl_shm_create_pool(shm, fd, static_cast<int32_t>(frame->size));
+  frame->buffer = wl_shm_pool_create_buffer(pool, 0, frame->width, frame->height, frame->stride,
+                                            frame->format);
+  wl_shm_pool_destroy(pool);
+  close(fd);
+  return frame->buffer != nullptr;
+}
+
+// Converts the 32-bit shm buffer into a packed RGB pixbuf. Only the 8888 formats are handled.
+Glib::RefPtr<Gdk::Pixbuf> toPixbuf(const Frame& frame) {
+  bool bgr;
+  switch (frame.format) {
+    case WL_SHM_FORMAT_ARGB8888:
+    case WL_SHM_FORMAT_XRGB8888:
+      bgr = true;  // little-endian: B, G, R, A in memory
+      break;
+    case WL_SHM_FORMAT_ABGR8888:
+    case WL_SHM_FORMAT_XBGR8888:
+      bgr = false;
+      break;
+    default:
+      spdlog::debug("[SCREENCOPY] Unsupported shm format {:#x}", frame.format);
+      return {};
+  }
+
+  auto pixbuf = Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, false, 8, static_cast<int>(frame.width),
+                                    static_cast<int>(frame.height));
+  const auto* src = static_cast<const uint8_t*>(frame.data);
+  auto* dst = pixbuf->get_pixels();
+  const int dstStride = pixbuf->get_rowstride();
+  for (uint32_t row = 0; row < frame.height; ++row) {
+    const uint32_t srcRow = frame.yInvert ? frame.height - 1 - row : row;
+    const auto* in = src + static_cast<size_t>(srcRow) * frame.stride;
+    auto* out = dst + static_cast<size_t>(row) * dstStride;
+    for (uint32_t col = 0; col < frame.width; ++col, in += 4, out += 3) {
+      out[0] = bgr ? in[2] : in[0];
+      out[1] = in[1];
+      out[2] = bgr ? in[0] : in[2];
+    }
+  }
+  return pixbuf;
+}
+
+void handleBuffer(void* data, struct zwlr_screencopy_frame_v1* handle, uint32_t format,
+                  uint32_t width, uint32_t height, uint32_t stride) {
+  auto* frame = static_cast<Frame*>(data);
+  if (frame->buffer != nullptr) {
+    return;  // only the first advertised shm format is used
+  }
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  frame->stride = stride;
+  if (!allocateBuffer(frame)) {
+    frame->finish({});
+    return;
+  }
+  zwlr_screencopy_frame_v1_copy(handle, frame->buffer);
+}
+
+void handleFlags(void* data, struct zwlr_screencopy_frame_v1* /*handle*/, uint32_t flags) {
+  static_cast<Frame*>(data)->yInvert = (flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT) != 0;
+}
+
+void handleReady(void* data, struct zwlr_screencopy_frame_v1* /*handle*/, uint32_t /*sec_hi*/,
+                 uint32_t /*sec_lo*/, uint32_t /*nsec*/) {
+  auto* frame = static_cast<Frame*>(data);
+  frame->finish(toPixbuf(*frame));
+}
+
+void handleFailed(void* data, struct zwlr_screencopy_frame_v1* /*handle*/) {
+  spdlog::debug("[SCREENCOPY] Compositor reported a failed frame copy");
+  static_cast<Frame*>(data)->finish({});
+}
+
+const struct zwlr_screencopy_frame_v1_listener frame_listener = {
+    .buffer = handleBuffer,
+    .flags = handleFlags,
+    .ready = handleReady,
+    .failed = handleFailed,
+    .damage = [](void*, struct zwlr_screencopy_frame_v1*, uint32_t, uint32_t, uint32_t,
+                 uint32_t) {},
+    .linux_dmabuf = [](void*, struct zwlr_screencopy_frame_v1*, uint32_t, uint32_t, uint32_t) {},
+    .buffer_done = [](void*, struct zwlr_screencopy_frame_v1*) {},
+};
+
+}  // namespace
+
+bool isSupported() {
+  auto* client = waybar::Client::inst();
+  return client->screencopy_manager != nullptr && client->shm != nullptr;
+}
+
+void captureRegion(int x, int y, int width, int height, Callback callback) {
+  auto display = Gdk::Display::get_default();
+  if (!isSupported() || !display || width <= 0 || height <= 0) {
+    callback({});
+    return;
+  }
+  auto monitor = display->get_monitor_at_point(x + width / 2, y + height / 2);
+  if (!monitor) {
+    callback({});
+    return;
+  }
+  Gdk::Rectangle geometry;
+  monitor->get_geometry(geometry);
+  auto* output = gdk_wayland_monitor_get_wl_output(monitor->gobj());
+
+  auto* frame = new Frame();
+  frame->callback = std::move(callback);
+  frame->handle = zwlr_screencopy_manager_v1_capture_output_region(
+      waybar::Client::inst()->screencopy_manager, 0, output, x - geometry.get_x(),
+      y - geometry.get_y(), width, height);
+  zwlr_screencopy_frame_v1_add_listener(frame->handle, &frame_listener, frame);
+}
+
+}  // namespace waybar::util::screencopy
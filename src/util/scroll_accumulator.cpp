@@ -0,0 +1,32 @@
+#include "util/scroll_accumulator.hpp"
+
+#include <utility>
+
+namespace waybar::util {
+
+ScrollAccumulator::ScrollAccumulator(Gtk::Widget& widget, std::function<void(int)> apply)
+    : widget_{widget}, apply_{std::move(apply)} {}
+
+ScrollAccumulator::~ScrollAccumulator() {
+  if (tick_ != 0) {
+    widget_.remove_tick_callback(tick_);
+  }
+}
+
+void ScrollAccumulator::add(int steps) {
+  steps_ += steps;
+  if (tick_ == 0) {
+    tick_ = widget_.add_tick_callback(sigc::mem_fun(*this, &ScrollAccumulator::onTick));
+  }
+}
+
+bool ScrollAccumulator::onTick(const Glib::RefPtr<Gdk::FrameClock>& /*clock*/) {
+  tick_ = 0;
+  const int steps = std::exchange(steps_, 0);
+  if (steps != 0) {
+    apply_(steps);
+  }
+  return false;  // until the next scroll
+}
+
+}  // namespace waybar::util
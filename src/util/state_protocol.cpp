@@ -0,0 +1,67 @@
+#include "util/state_protocol.hpp"
+
+namespace waybar::util {
+
+StateProtocol::StateProtocol() { writer_["indentation"] = ""; }
+
+std::optional<StateProtocol::Request> StateProtocol::parseRequest(std::string_view line) {
+  if (line == "get") {
+    return Request::GET;
+  }
+  if (line == "subscribe") {
+    return Request::SUBSCRIBE;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> StateProtocol::nextLine(std::string& in) {
+  const auto end = in.find('\n');
+  if (end == std::string::npos) {
+    return std::nullopt;
+  }
+  auto line = in.substr(0, end);
+  in.erase(0, end + 1);
+  return line;
+}
+
+std::string StateProtocol::answer(std::optional<Request> request) const {
+  if (!request) {
+    return R"({"error":"unknown request, expected get or subscribe"})"
+           "\n";
+  }
+  std::string text;
+  for (const auto& [key, state] : states_) {
+    text += line(state);
+  }
+  return text;
+}
+
+const Json::Value* StateProtocol::update(const std::string& key, Json::Value state) {
+  auto& last = states_[key];
+  if (last == state) {
+    return nullptr;
+  }
+  last = std::move(state);
+  return &last;
+}
+
+std::optional<Json::Value> StateProtocol::forget(const std::string& key) {
+  auto state = states_.find(key);
+  if (state == states_.end()) {
+    return std::nullopt;
+  }
+  Json::Value removed(Json::objectValue);
+  removed["module"] = state->second["module"];
+  removed["output"] = state->second["output"];
+  removed["removed"] = true;
+  states_.erase(state);
+  return removed;
+}
+
+std::string StateProtocol::line(const Json::Value& state) const {
+  auto text = Json::writeString(writer_, state);
+  text += '\n';
+  return text;
+}
+
+}  // namespace waybar::util
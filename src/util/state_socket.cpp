@@ -0,0 +1,235 @@
+#include "util/state_socket.hpp"
+
+#include <glibmm/main.h>
+#include <glibmm/miscutils.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace waybar::util {
+
+std::unique_ptr<StateSocket> StateSocket::instance_;
+
+void StateSocket::configure(const Json::Value& option) {
+  std::string path;
+  if (option.isString()) {
+    path = option.asString();
+  } else if (option.isBool() && option.asBool()) {
+    path = Glib::get_user_runtime_dir() + "/waybar-" + std::to_string(getpid()) + ".sock";
+  }
+  if (instance_ && instance_->path_ == path) {
+    return;  // kept across reloads, with its clients
+  }
+  instance_.reset();
+  if (path.empty()) {
+    return;
+  }
+
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    spdlog::error("state-socket: path too long: {}", path);
+    return;
+  }
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  // A socket there was left behind by a waybar that crashed, anything else isn't ours
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      spdlog::error("state-socket: {} exists and isn't a socket", path);
+      return;
+    }
+    unlink(path.c_str());
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    spdlog::error("state-socket: can't create the socket: {}", strerror(errno));
+    return;
+  }
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+    spdlog::error("state-socket: can't listen on {}: {}", path, strerror(errno));
+    close(fd);
+    return;
+  }
+  spdlog::info("state-socket: serving the module states on {}", path);
+  instance_.reset(new StateSocket(std::move(path), fd));
+}
+
+StateSocket::StateSocket(std::string path, int fd) : path_(std::move(path)), fd_(fd) {
+  accept_ = Glib::signal_io().connect([this](Glib::IOCondition) { return onAccept(); }, fd_,
+                                      Glib::IO_IN);
+}
+
+StateSocket::~StateSocket() {
+  accept_.disconnect();
+  drop_.disconnect();
+  for (auto& client : clients_) {
+    client->io.disconnect();
+    close(client->fd);
+  }
+  close(fd_);
+  unlink(path_.c_str());
+}
+
+bool StateSocket::onAccept() {
+  while (true) {
+    int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        spdlog::warn("state-socket: accept failed: {}", strerror(errno));
+      }
+      return true;
+    }
+    auto& client = clients_.emplace_back(std::make_unique<Client>());
+    client->fd = fd;
+    watch(client.get());
+  }
+}
+
+void StateSocket::watch(Client* client) {
+  client->io.disconnect();
+  auto condition = Glib::IO_HUP | Glib::IO_ERR;
+  client->reading = !client->eof;
+  if (client->reading) {
+    condition |= Glib::IO_IN;
+  }
+  client->writing = !client->out.empty();
+  if (client->writing) {
+    condition |= Glib::IO_OUT;
+  }
+  client->io = Glib::signal_io().connect(
+      [this, client](Glib::IOCondition ready) { return onClientIo(client, ready); }, client->fd,
+      condition);
+}
+
+bool StateSocket::onClientIo(Client* client, Glib::IOCondition condition) {
+  // hung up, there is nobody to write to anymore
+  client->dropped = (condition & (Glib::IO_HUP | Glib::IO_ERR)) != 0;
+  char buf[StateProtocol::MAX_REQUEST];
+  while (!client->dropped && !client->eof) {
+    auto n = read(client->fd, buf, sizeof(buf));
+    if (n > 0) {
+      client->in.append(buf, n);
+      while (auto request = StateProtocol::nextLine(client->in)) {
+        handleRequest(client, *request);
+      }
+      if (client->in.size() > StateProtocol::MAX_REQUEST) {
+        client->dropped = true;
+      }
+    } else if (n == 0) {
+      // only its side is closed: a get is still answered, a subscription still streamed
+      client->eof = true;
+      client->closing = client->closing || !client->subscribed;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      client->dropped = true;
+    }
+  }
+  if (!client->dropped && !flush(client)) {
+    client->dropped = true;
+  }
+  // from an idle callback, not while this watch runs
+  if (client->dropped) {
+    scheduleDrop();
+    return false;
+  }
+  if (client->writing == client->out.empty() || client->reading == client->eof) {
+    watch(client);  // the new watch replaces this one
+    return false;
+  }
+  return true;
+}
+
+void StateSocket::handleRequest(Client* client, const std::string& line) {
+  const auto request = StateProtocol::parseRequest(line);
+  client->out += protocol_.answer(request);
+  client->subscribed = request == StateProtocol::Request::SUBSCRIBE;
+  client->closing = !client->subscribed;
+}
+
+void StateSocket::publish(const std::string& key, Json::Value state) {
+  const auto* last = protocol_.update(key, std::move(state));
+  if (last != nullptr && subscribed()) {
+    broadcast(protocol_.line(*last));
+  }
+}
+
+void StateSocket::forget(const std::string& key) {
+  if (auto removed = protocol_.forget(key); removed && subscribed()) {
+    broadcast(protocol_.line(*removed));
+  }
+}
+
+bool StateSocket::subscribed() const {
+  return std::ranges::any_of(
+      clients_, [](const auto& client) { return client->subscribed && !client->dropped; });
+}
+
+void StateSocket::broadcast(const std::string& line) {
+  for (auto& client : clients_) {
+    if (client->subscribed && !client->dropped) {
+      send(client.get(), line);
+    }
+  }
+}
+
+void StateSocket::send(Client* client, const std::string& line) {
+  client->out += line;
+  if (!flush(client)) {
+    client->dropped = true;
+    client->io.disconnect();
+    scheduleDrop();
+  } else if (!client->writing && !client->out.empty()) {
+    watch(client);  // for IO_OUT
+  }
+}
+
+bool StateSocket::flush(Client* client) {
+  while (!client->out.empty()) {
+    auto n = ::send(client->fd, client->out.data(), client->out.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+      }
+      break;
+    }
+    client->out.erase(0, n);
+  }
+  if (client->out.size() > MAX_PENDING) {
+    spdlog::warn("state-socket: dropping a client that doesn't keep up");
+    return false;
+  }
+  return !(client->closing && client->out.empty());
+}
+
+void StateSocket::scheduleDrop() {
+  if (!drop_.connected()) {
+    drop_ = Glib::signal_idle().connect([this] {
+      dropClosed();
+      return false;
+    });
+  }
+}
+
+void StateSocket::dropClosed() {
+  std::erase_if(clients_, [](const auto& client) {
+    if (!client->dropped) {
+      return false;
+    }
+    client->io.disconnect();
+    close(client->fd);
+    return true;
+  });
+}
+
+}  // namespace waybar::util
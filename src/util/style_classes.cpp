@@ -0,0 +1,34 @@
+#include "util/style_classes.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace waybar::util {
+
+void StyleClasses::set(std::vector<std::string> classes) {
+  std::erase(classes, std::string());
+  if (classes == current_) {
+    return;
+  }
+  auto style = widget_.get_style_context();
+  for (const auto& name : current_) {
+    if (std::ranges::find(classes, name) == classes.end()) {
+      style->remove_class(name);
+    }
+  }
+  for (const auto& name : classes) {
+    if (std::ranges::find(current_, name) == current_.end()) {
+      style->add_class(name);
+    }
+  }
+  current_ = std::move(classes);
+}
+
+void StyleClasses::set(const std::string& name) {
+  if (current_.size() == 1 && current_.front() == name) {
+    return;
+  }
+  set(std::vector<std::string>{name});
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,150 @@
+#include "util/text_width.hpp"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace waybar::util {
+
+namespace {
+
+constexpr auto npos = std::string::npos;
+
+// g_unichar_isspace() for ASCII
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; }
+
+// The end of the last non blank character among the first limit ones
+size_t asciiCut(std::string_view text, size_t limit) {
+  if (limit == npos) {
+    return npos;
+  }
+  for (size_t end = std::min(limit, text.size()); end > 0; --end) {
+    if (!isBlank(text[end - 1])) {
+      return end;
+    }
+  }
+  return npos;
+}
+
+// Invalid text just counts bytes
+size_t byteCut(std::string_view text, size_t limit) {
+  return limit != npos && text.size() > limit ? limit : npos;
+}
+
+/* A text only ever goes to the slot its hash picks, so a lookup is one hash and one compare, and a
+ * miss replaces whatever was there.
+ */
+class WidthCache {
+ public:
+  template <typename Measure>
+  size_t get(std::string_view text, Measure&& measure) {
+    if (text.size() > MAX_TEXT) {
+      return measure(text);
+    }
+    auto& slot = slots_[std::hash<std::string_view>{}(text) % SLOTS];
+    // only non-ASCII texts come here, an empty slot never matches
+    if (slot.text != text) {
+      slot.text.assign(text);
+      slot.width = measure(text);
+    }
+    return slot.width;
+  }
+
+ private:
+  static constexpr size_t SLOTS = 64;
+  static constexpr size_t MAX_TEXT = 512;  // longer ones are hardly measured twice
+
+  struct Slot {
+    std::string text;
+    size_t width = 0;
+  };
+  std::array<Slot, SLOTS> slots_;
+};
+
+size_t countColumns(std::string_view text) {
+  const gchar* end = text.data() + text.size();
+  size_t total = 0;
+  for (const gchar* data = text.data(); data < end; data = g_utf8_next_char(data)) {
+    const gunichar c = g_utf8_get_char_validated(data, end - data);
+    if (c == static_cast<gunichar>(-1) || c == static_cast<gunichar>(-2)) {
+      return text.size();
+    }
+    total += g_unichar_iswide(c) ? 2 : 1;
+  }
+  return total;
+}
+
+}  // namespace
+
+bool isAscii(std::string_view text) {
+  constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+  const char* data = text.data();
+  size_t left = text.size();
+  for (; left >= sizeof(uint64_t); data += sizeof(uint64_t), left -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    if ((word & HIGH_BITS) != 0) {
+      return false;
+    }
+  }
+  for (; left > 0; ++data, --left) {
+    if ((*data & 0x80) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TextMeasure measureText(std::string_view text, size_t limit, size_t short_limit) {
+  // a nul byte makes the text invalid, see below
+  if (isAscii(text) && std::memchr(text.data(), '\0', text.size()) == nullptr) {
+    return {text.size(), asciiCut(text, limit), asciiCut(text, short_limit)};
+  }
+
+  TextMeasure measure{0, npos, npos};
+  const gchar* start = text.data();
+  const gchar* end = start + text.size();
+  for (const gchar* data = start; data < end;) {
+    const gunichar c = g_utf8_get_char_validated(data, end - data);
+    if (c == static_cast<gunichar>(-1) || c == static_cast<gunichar>(-2)) {
+      return {text.size(), byteCut(text, limit), byteCut(text, short_limit)};
+    }
+    if (g_unichar_iswide(c)) {
+      measure.width += 2;
+    } else if (!g_unichar_iszerowidth(c) && c != 0xAD) {  // neither zero-width nor soft hyphen
+      measure.width += 1;
+    }
+    data = g_utf8_next_char(data);
+    if (!g_unichar_isspace(c)) {
+      if (limit != npos && measure.width <= limit) {
+        measure.cut = data - start;
+      }
+      if (short_limit != npos && measure.width <= short_limit) {
+        measure.cut_short = data - start;
+      }
+    }
+  }
+  return measure;
+}
+
+size_t textWidth(std::string_view text) {
+  if (isAscii(text) && std::memchr(text.data(), '\0', text.size()) == nullptr) {
+    return text.size();
+  }
+  thread_local WidthCache cache;
+  return cache.get(text, [](std::string_view text) { return measureText(text).width; });
+}
+
+size_t columnCount(std::string_view text) {
+  if (isAscii(text)) {
+    return text.size();
+  }
+  thread_local WidthCache cache;
+  return cache.get(text, countColumns);
+}
+
+}  // namespace waybar::util
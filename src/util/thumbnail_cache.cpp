@@ -1,35 +1,54 @@
 #include "util/thumbnail_cache.hpp"
 
+#include <fcntl.h>
+#include <glibmm/main.h>
 #include <spdlog/spdlog.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util/screencopy.hpp"
 
 namespace waybar::util {
 
 namespace fs = std::filesystem;
 
-ThumbnailCache::ThumbnailCache() {
-  m_cacheDir = getCachePath();
-  
-  // Create cache directory if it doesn't exist
-  try {
-    fs::create_directories(m_cacheDir);
-  } catch (const fs::filesystem_error& e) {
-    spdlog::warn("Failed to create thumbnail cache directory: {}", e.what());
-  }
-  
-  m_captureAvailable = checkCaptureTools();
-  if (!m_captureAvailable) {
-    spdlog::warn("Thumbnail capture tools not available (need grim and magick/convert)");
-  }
+namespace {
+
+constexpr int THUMBNAIL_SIZE = 256;
+constexpr size_t DEFAULT_PIXBUF_CACHE_BYTES = 32 * 1024 * 1024;
+constexpr uint64_t DEFAULT_DISK_BUDGET = 100 * 1024 * 1024;
+constexpr unsigned DEFAULT_SETTLE_DELAY_MS = 300;  // workspace switch animation
+constexpr unsigned DEFAULT_RECAPTURE_INTERVAL_MS = 2000;
+
+// `command -v grim` is looked up once per process instead of once per cache/capture.
+bool captureToolsAvailable() {
+  static const bool available = system("command -v grim >/dev/null 2>&1") == 0;
+  return available;
 }
 
-std::string ThumbnailCache::getCachePath() const {
+std::string cacheDirFromEnv() {
   const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
   std::string base_cache;
   
@@ -47,107 +66,841 @@ std::string ThumbnailCache::getCachePath() const {
   return base_cache + "/waybar/thumbnails";
 }
 
-std::string ThumbnailCache::getThumbnailFilePath(const std::string& windowAddress) const {
-  return m_cacheDir + "/" + windowAddress + ".png";
+/* Decoded thumbnails keyed by window address, least recently used first evicted once the decoded
+ * size exceeds the limit. Lookups happen on the GTK thread, invalidations may also come from the
+ * capture worker.
+ */
+class PixbufLru {
+ public:
+  static PixbufLru& inst() {
+    static auto* lru = new PixbufLru();
+    return *lru;
+  }
+
+  Glib::RefPtr<Gdk::Pixbuf> get(const std::string& address, std::chrono::seconds maxAge) {
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(address);
+    if (it == index_.end()) {
+      return {};
+    }
+    if (std::chrono::system_clock::now() - it->second->capturedAt > maxAge) {
+      erase(it);
+      return {};
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->pixbuf;
+  }
+
+  void put(const std::string& address, std::chrono::system_clock::time_point capturedAt,
+           const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) {
+    std::lock_guard lock(mutex_);
+    if (auto it = index_.find(address); it != index_.end()) {
+      erase(it);
+    }
+    size_t bytes = static_cast<size_t>(pixbuf->get_rowstride()) * pixbuf->get_height();
+    entries_.push_front({address, capturedAt, pixbuf, bytes});
+    index_[address] = entries_.begin();
+    bytes_ += bytes;
+    evict();
+  }
+
+  // A capture found the window as it was, the decoded thumbnail is still current
+  void touch(const std::string& address, std::chrono::system_clock::time_point capturedAt) {
+    std::lock_guard lock(mutex_);
+    if (auto it = index_.find(address); it != index_.end()) {
+      it->second->capturedAt = capturedAt;
+    }
+  }
+
+  // Called when a new capture landed.
+  void invalidate(const std::string& address) {
+    std::lock_guard lock(mutex_);
+    if (auto it = index_.find(address); it != index_.end()) {
+      erase(it);
+    }
+  }
+
+  void clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+  }
+
+  void setLimit(size_t maxBytes) {
+    std::lock_guard lock(mutex_);
+    limit_ = maxBytes;
+    evict();
+  }
+
+ private:
+  struct Entry {
+    std::string address;
+    std::chrono::system_clock::time_point capturedAt;
+    Glib::RefPtr<Gdk::Pixbuf> pixbuf;
+    size_t bytes;
+  };
+  using Index = std::unordered_map<std::string, std::list<Entry>::iterator>;
+
+  PixbufLru() = default;
+
+  void erase(Index::iterator it) {
+    bytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  void evict() {
+    while (bytes_ > limit_ && !entries_.empty()) {
+      erase(index_.find(entries_.back().address));
+    }
+  }
+
+  std::mutex mutex_;
+  std::list<Entry> entries_;
+  Index index_;
+  size_t bytes_ = 0;
+  size_t limit_ = DEFAULT_PIXBUF_CACHE_BYTES;
+};
+
+/* Metadata of every cached thumbnail, kept in memory and persisted as an append-only log of
+ * fixed-layout records in a single file next to the thumbnails. Updates append one record,
+ * removals a tombstone; the log is rewritten compacted when it has grown well past the live
+ * entries (and once on load). Lookups and age checks therefore need no syscalls at all. It keeps
+ * the total size of the thumbnails, and each new one evicts the expired and, past the budget, the
+ * oldest others, so the cache never needs a sweep. The directory is scanned once, on load, for
+ * the files no entry knows of.
+ */
+class ThumbnailIndex {
+ public:
+  struct Entry {
+    ThumbnailMetadata meta;
+    uint64_t bytes = 0;  // size of the PNG, for the cleanup budget
+  };
+
+  static ThumbnailIndex& inst() {
+    static auto* index = new ThumbnailIndex(cacheDirFromEnv());
+    return *index;
+  }
+
+  void put(const ThumbnailMetadata& meta, uint64_t bytes) {
+    std::lock_guard lock(mutex_);
+    Entry entry{meta, bytes};
+    std::string record;
+    encode(record, RECORD_PUT, entry);
+    auto& slot = entries_[meta.windowAddress];
+    bytes_ = bytes_ - slot.bytes + bytes;
+    slot = std::move(entry);
+    append(record);
+    evict(MAX_AGE, budget_, meta.windowAddress);
+  }
+
+  // Drops the thumbnails older than maxAge, then the oldest others until they fit in budget
+  void cleanup(std::chrono::seconds maxAge, uint64_t budget) {
+    std::lock_guard lock(mutex_);
+    budget_ = budget;
+    evict(maxAge, budget, {});
+  }
+
+  /* The thumbnail is confirmed current: only the timestamp in memory changes, the log gets it with
+   * the next compaction or capture. Returns it, nothing without an entry.
+   */
+  std::optional<std::chrono::system_clock::time_point> touch(const std::string& address) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(address);
+    if (it == entries_.end()) {
+      return std::nullopt;
+    }
+    it->second.meta.timestamp = std::chrono::system_clock::now();
+    return it->second.meta.timestamp;
+  }
+
+  // The thumbnail with its file
+  void remove(const std::string& address) {
+    std::lock_guard lock(mutex_);
+    if (auto it = entries_.find(address); it != entries_.end()) {
+      erase(it);
+    }
+  }
+
+  std::optional<Entry> get(const std::string& address) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(address);
+    if (it == entries_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+ private:
+  static constexpr char MAGIC[8] = {'W', 'B', 'T', 'H', 'I', 'D', 'X', '2'};
+  static constexpr uint8_t RECORD_PUT = 1;
+  static constexpr uint8_t RECORD_REMOVE = 2;
+  static constexpr size_t COMPACT_SLACK = 256;
+  static constexpr std::chrono::seconds MAX_AGE{3600};
+
+  explicit ThumbnailIndex(std::string cacheDir)
+      : cacheDir_(std::move(cacheDir)), path_(cacheDir_ + "/index") {
+    std::error_code ec;
+    fs::create_directories(cacheDir_, ec);
+    load();
+    removeUnknownFiles();
+    compact();
+  }
+
+  void erase(std::unordered_map<std::string, Entry>::iterator it) {
+    const auto address = it->first;
+    bytes_ -= it->second.bytes;
+    entries_.erase(it);
+    Entry tombstone;
+    tombstone.meta.windowAddress = address;
+    std::string record;
+    encode(record, RECORD_REMOVE, tombstone);
+    append(record);
+    unlink((cacheDir_ + "/" + address + ".thumb").c_str());
+    PixbufLru::inst().invalidate(address);
+    spdlog::debug("[THUMBNAIL] Evicted thumbnail: {}", address);
+  }
+
+  // Keeps `keep`, the thumbnail just written, even if it alone is over the budget
+  void evict(std::chrono::seconds maxAge, uint64_t budget, const std::string& keep) {
+    const auto now = std::chrono::system_clock::now();
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto next = std::next(it);
+      if (it->first != keep && now - it->second.meta.timestamp > maxAge) {
+        erase(it);
+      }
+      it = next;
+    }
+    while (bytes_ > budget && entries_.size() > (keep.empty() ? 0 : 1)) {
+      auto oldest = entries_.end();
+      for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->first != keep &&
+            (oldest == entries_.end() ||
+             it->second.meta.timestamp < oldest->second.meta.timestamp)) {
+          oldest = it;
+        }
+      }
+      if (oldest == entries_.end()) {
+        break;
+      }
+      erase(oldest);
+    }
+  }
+
+  template <typename T>
+  static void put_raw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  static void put_string(std::string& out, const std::string& value) {
+    put_raw(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+  }
+
+  template <typename T>
+  static bool get_raw(std::string_view& in, T& value) {
+    if (in.size() < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  static bool get_string(std::string_view& in, std::string& value) {
+    uint32_t size = 0;
+    if (!get_raw(in, size) || in.size() < size) {
+      return false;
+    }
+    value.assign(in.data(), size);
+    in.remove_prefix(size);
+    return true;
+  }
+
+  // [u32 payload size][u8 type][address][class][title][workspace][i64 time][i32 w][i32 h][u64 bytes]
+  static void encode(std::string& out, uint8_t type, const Entry& entry) {
+    std::string payload;
+    put_raw(payload, type);
+    put_string(payload, entry.meta.windowAddress);
+    put_string(payload, entry.meta.windowClass);
+    put_string(payload, entry.meta.windowTitle);
+    put_string(payload, entry.meta.workspaceName);
+    put_raw(payload,
+            static_cast<int64_t>(std::chrono::system_clock::to_time_t(entry.meta.timestamp)));
+    put_raw(payload, static_cast<int32_t>(entry.meta.width));
+    put_raw(payload, static_cast<int32_t>(entry.meta.height));
+    put_raw(payload, entry.bytes);
+    put_raw(out, static_cast<uint32_t>(payload.size()));
+    out.append(payload);
+  }
+
+  static bool decode(std::string_view payload, uint8_t& type, Entry& entry) {
+    int64_t timestamp = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    if (!get_raw(payload, type) || !get_string(payload, entry.meta.windowAddress) ||
+        !get_string(payload, entry.meta.windowClass) ||
+        !get_string(payload, entry.meta.windowTitle) ||
+        !get_string(payload, entry.meta.workspaceName) || !get_raw(payload, timestamp) ||
+        !get_raw(payload, width) || !get_raw(payload, height) || !get_raw(payload, entry.bytes)) {
+      return false;
+    }
+    entry.meta.timestamp = std::chrono::system_clock::from_time_t(timestamp);
+    entry.meta.width = width;
+    entry.meta.height = height;
+    return true;
+  }
+
+  // An index file of another version is ignored, as is a torn tail record.
+  void load() {
+    std::ifstream file(path_, std::ios::binary);
+    if (!file.is_open()) {
+      return;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string_view in(data);
+    if (in.size() < sizeof(MAGIC) || std::memcmp(in.data(), MAGIC, sizeof(MAGIC)) != 0) {
+      spdlog::debug("[THUMBNAIL] Discarding incompatible thumbnail index");
+      return;
+    }
+    in.remove_prefix(sizeof(MAGIC));
+    uint32_t size = 0;
+    while (get_raw(in, size) && in.size() >= size) {
+      uint8_t type = 0;
+      Entry entry;
+      if (decode(in.substr(0, size), type, entry)) {
+        if (type == RECORD_PUT) {
+          entries_[entry.meta.windowAddress] = std::move(entry);
+        } else if (type == RECORD_REMOVE) {
+          entries_.erase(entry.meta.windowAddress);
+        }
+      }
+      in.remove_prefix(size);
+    }
+    for (const auto& [address, entry] : entries_) {
+      bytes_ += entry.bytes;
+    }
+  }
+
+  /* Thumbnails of older versions (PNGs, before any index with one .meta file each), files a crash
+   * left behind and the ones the index lost track of
+   */
+  void removeUnknownFiles() {
+    std::error_code ec;
+    for (const auto& file : fs::directory_iterator(cacheDir_, ec)) {
+      const auto& path = file.path();
+      if (path == path_) {
+        continue;
+      }
+      if (path.extension() != ".thumb" || !entries_.contains(path.stem().string())) {
+        fs::remove(path, ec);
+      }
+    }
+  }
+
+  void append(const std::string& record) {
+    if (fd_ < 0) {
+      return;
+    }
+    if (write(fd_, record.data(), record.size()) != static_cast<ssize_t>(record.size())) {
+      spdlog::debug("[THUMBNAIL] Failed to append to thumbnail index: {}", strerror(errno));
+    }
+    if (++records_ > entries_.size() * 2 + COMPACT_SLACK) {
+      compact();
+    }
+  }
+
+  void compact() {
+    std::string data(MAGIC, sizeof(MAGIC));
+    for (const auto& [address, entry] : entries_) {
+      encode(data, RECORD_PUT, entry);
+    }
+    const auto tmp_path = path_ + ".tmp";
+    {
+      std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+      file.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!file) {
+        spdlog::warn("[THUMBNAIL] Failed to write thumbnail index {}", tmp_path);
+        return;
+      }
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, path_, ec);
+    if (ec) {
+      spdlog::warn("[THUMBNAIL] Failed to replace thumbnail index: {}", ec.message());
+      return;
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = open(path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    records_ = entries_.size();
+  }
+
+  std::mutex mutex_;
+  std::string cacheDir_;
+  std::string path_;
+  int fd_ = -1;
+  size_t records_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t budget_ = DEFAULT_DISK_BUDGET;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+// Records a finished capture whose thumbnail is at `thumb_path`.
+void recordThumbnail(const std::string& thumb_path, const std::string& windowAddress,
+                     const std::string& windowClass, const std::string& windowTitle,
+                     const std::string& workspaceName, int width, int height) {
+  ThumbnailMetadata meta;
+  meta.windowAddress = windowAddress;
+  meta.windowClass = windowClass;
+  meta.windowTitle = windowTitle;
+  meta.workspaceName = workspaceName;
+  meta.timestamp = std::chrono::system_clock::now();
+  meta.width = width;
+  meta.height = height;
+  std::error_code ec;
+  auto bytes = fs::file_size(thumb_path, ec);
+  ThumbnailIndex::inst().put(meta, ec ? 0 : bytes);
+}
+
+/* Perceptual hash of a capture: whether each cell of a 17x16 grid is brighter than the one to its
+ * right, from the mean luminance of 4x4 samples per cell. Small changes like a blinking cursor
+ * flip a few bits at most, a window that didn't change gives the same hash.
+ */
+using ContentHash = std::array<uint64_t, 4>;
+constexpr int HASH_TOLERANCE = 4;  // differing bits that still count as unchanged
+
+ContentHash contentHash(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) {
+  constexpr int GRID_W = 17;
+  constexpr int GRID_H = 16;
+  constexpr int SAMPLES = 4;
+  const int width = pixbuf->get_width();
+  const int height = pixbuf->get_height();
+  const int channels = pixbuf->get_n_channels();
+  const int stride = pixbuf->get_rowstride();
+  const guint8* pixels = pixbuf->get_pixels();
+
+  std::array<std::array<unsigned, GRID_W>, GRID_H> cells{};
+  for (int cy = 0; cy < GRID_H; cy++) {
+    for (int cx = 0; cx < GRID_W; cx++) {
+      unsigned sum = 0;
+      for (int sy = 0; sy < SAMPLES; sy++) {
+        const int y = ((cy * SAMPLES + sy) * 2 + 1) * height / (GRID_H * SAMPLES * 2);
+        for (int sx = 0; sx < SAMPLES; sx++) {
+          const int x = ((cx * SAMPLES + sx) * 2 + 1) * width / (GRID_W * SAMPLES * 2);
+          const guint8* p = pixels + static_cast<ptrdiff_t>(y) * stride + x * channels;
+          sum += p[0] * 299U + p[1] * 587U + p[2] * 114U;
+        }
+      }
+      cells[cy][cx] = sum;
+    }
+  }
+  ContentHash hash{};
+  for (int cy = 0; cy < GRID_H; cy++) {
+    for (int cx = 0; cx + 1 < GRID_W; cx++) {
+      if (cells[cy][cx] > cells[cy][cx + 1]) {
+        const int bit = cy * (GRID_W - 1) + cx;
+        hash[bit / 64] |= uint64_t{1} << (bit % 64);
+      }
+    }
+  }
+  return hash;
 }
 
-std::string ThumbnailCache::getMetadataFilePath(const std::string& windowAddress) const {
-  return m_cacheDir + "/" + windowAddress + ".meta";
+int hashDistance(const ContentHash& a, const ContentHash& b) {
+  int distance = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    distance += std::popcount(a[i] ^ b[i]);
+  }
+  return distance;
 }
 
-bool ThumbnailCache::checkCaptureTools() {
-  // Check for grim
-  int grim_result = system("command -v grim >/dev/null 2>&1");
-  if (grim_result != 0) {
+enum class CaptureResult { FAILED, SAVED, UNCHANGED };
+
+/* Thumbnails are stored as the rows of the pixbuf behind a small header, so that showing one is
+ * an mmap instead of a PNG decode. The file is replaced by a rename, never rewritten in place, as
+ * thumbnails still shown keep it mapped.
+ */
+struct ThumbnailHeader {
+  char magic[8];
+  uint32_t width;
+  uint32_t height;
+  uint32_t rowstride;
+  uint32_t channels;
+};
+constexpr char THUMBNAIL_MAGIC[8] = {'W', 'B', 'T', 'H', 'U', 'M', 'B', '1'};
+
+// Downscales to fit THUMBNAIL_SIZE (keeping the aspect ratio, like `-resize`) and writes it.
+bool saveThumbnail(const Glib::RefPtr<Gdk::Pixbuf>& pixbuf, const std::string& thumb_path) {
+  int width = pixbuf->get_width();
+  int height = pixbuf->get_height();
+  double scale = std::min(1.0, static_cast<double>(THUMBNAIL_SIZE) / std::max(width, height));
+  auto thumb = pixbuf;
+  if (scale < 1.0) {
+    thumb = pixbuf->scale_simple(std::max(1, static_cast<int>(width * scale)),
+                                 std::max(1, static_cast<int>(height * scale)),
+                                 Gdk::INTERP_BILINEAR);
+  }
+
+  ThumbnailHeader header{};
+  std::memcpy(header.magic, THUMBNAIL_MAGIC, sizeof(THUMBNAIL_MAGIC));
+  header.width = thumb->get_width();
+  header.height = thumb->get_height();
+  header.channels = thumb->get_n_channels();
+  header.rowstride = header.width * header.channels;
+  const auto tmp_path = thumb_path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const guint8* pixels = thumb->get_pixels();
+    for (uint32_t row = 0; row < header.height; row++) {
+      file.write(reinterpret_cast<const char*>(pixels) +
+                     static_cast<ptrdiff_t>(row) * thumb->get_rowstride(),
+                 header.rowstride);
+    }
+    if (!file) {
+      spdlog::debug("[THUMBNAIL] Failed to write {}", tmp_path);
+      unlink(tmp_path.c_str());
+      return false;
+    }
+  }
+  if (rename(tmp_path.c_str(), thumb_path.c_str()) != 0) {
+    spdlog::debug("[THUMBNAIL] Failed to save {}: {}", thumb_path, strerror(errno));
+    unlink(tmp_path.c_str());
     return false;
   }
+  return true;
+}
+
+// The thumbnail mapped from its file, unmapped when the last reference to the pixbuf goes.
+Glib::RefPtr<Gdk::Pixbuf> loadThumbnail(const std::string& thumb_path) {
+  int fd = open(thumb_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return {};
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ThumbnailHeader)) {
+    map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return {};
+  }
+  const size_t size = st.st_size;
+  ThumbnailHeader header;
+  std::memcpy(&header, map, sizeof(header));
+  constexpr auto MAX_SIZE = static_cast<uint32_t>(THUMBNAIL_SIZE);
+  if (std::memcmp(header.magic, THUMBNAIL_MAGIC, sizeof(THUMBNAIL_MAGIC)) != 0 ||
+      (header.channels != 3 && header.channels != 4) || header.width == 0 ||
+      header.width > MAX_SIZE || header.height == 0 || header.height > MAX_SIZE ||
+      header.rowstride < header.width * header.channels ||
+      size < sizeof(header) + static_cast<size_t>(header.rowstride) * header.height) {
+    munmap(map, size);
+    return {};
+  }
+  return Gdk::Pixbuf::create_from_data(
+      static_cast<const guint8*>(map) + sizeof(header), Gdk::COLORSPACE_RGB, header.channels == 4,
+      8, header.width, header.height, header.rowstride,
+      [map, size](const guint8*) { munmap(map, size); });
+}
+
+/* grim path, used when the compositor lacks wlr-screencopy. The capture is loaded and handed to
+ * `unchanged`, if given, then downscaled and saved only when that returns false.
+ */
+CaptureResult captureWithTools(
+    const std::string& full_path, const std::string& thumb_path, int x, int y, int width,
+    int height, const std::function<bool(const Glib::RefPtr<Gdk::Pixbuf>&)>& unchanged = {}) {
+  if (!captureToolsAvailable()) {
+    return CaptureResult::FAILED;
+  }
+
+  // Build capture command with -s 1 to use logical pixels (not scaled)
+  std::ostringstream capture_cmd;
+  capture_cmd << "grim -s 1 -g \"" << x << "," << y << " " << width << "x" << height << "\" "
+              << full_path << " 2>/dev/null";
+  if (system(capture_cmd.str().c_str()) != 0) {
+    return CaptureResult::FAILED;
+  }
+
+  Glib::RefPtr<Gdk::Pixbuf> capture;
+  try {
+    capture = Gdk::Pixbuf::create_from_file(full_path);
+  } catch (const Glib::Error& e) {
+    spdlog::debug("[THUMBNAIL] Failed to load capture {}: {}", full_path, e.what().c_str());
+  }
+  // Clean up full size image
+  unlink(full_path.c_str());
+  if (!capture) {
+    return CaptureResult::FAILED;
+  }
+  if (unchanged && unchanged(capture)) {
+    return CaptureResult::UNCHANGED;
+  }
+  return saveThumbnail(capture, thumb_path) ? CaptureResult::SAVED : CaptureResult::FAILED;
+}
+
+struct CaptureJob {
+  std::string windowAddress;
+  std::string windowClass;
+  std::string windowTitle;
+  std::string workspaceName;
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+  std::string fullPath;
+  std::string thumbPath;
+  bool toolsOnly = false;
+  const ThumbnailCache* requester = nullptr;  // whose cancelPendingCaptures() drops it
+  bool now = false;                           // taken without the settle delay
+  std::shared_ptr<void> done;  // released with the last copy of the job, once it is through
+  std::chrono::steady_clock::time_point due;
+};
+
+/* Long-lived thread owning the capture queue. Jobs become due after the settle delay, a newer
+ * request for the same window replaces the queued one, and the queue is bounded by dropping the
+ * oldest request. Native captures are handed to the GTK main loop once due, the external tools run
+ * on the worker itself so they never block the bar.
+ */
+class CaptureWorker {
+ public:
+  static CaptureWorker& inst() {
+    static auto* worker = new CaptureWorker();
+    return *worker;
+  }
+
+  // A retry is taken at once, even if the window was captured within the recapture interval
+  void enqueue(CaptureJob job, bool retry = false) {
+    {
+      std::lock_guard lock(mutex_);
+      if (auto recent = recent_.find(job.windowAddress);
+          !retry && recent != recent_.end() &&
+          std::chrono::steady_clock::now() - recent->second.capturedAt < interval_) {
+        spdlog::trace("[THUMBNAIL] Window {} was captured just now, skipping",
+                      job.windowAddress);
+        return;
+      }
+      job.due = std::chrono::steady_clock::now() +
+                (retry || job.now ? std::chrono::milliseconds(0) : delay_);
+      auto it = std::ranges::find(jobs_, job.windowAddress, &CaptureJob::windowAddress);
+      if (it != jobs_.end()) {
+        jobs_.erase(it);
+      } else if (jobs_.size() >= MAX_PENDING) {
+        spdlog::debug("[THUMBNAIL] Capture queue full, dropping {}", jobs_.front().windowAddress);
+        jobs_.pop_front();
+      }
+      jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+  }
+
+  void cancelPending(const ThumbnailCache* requester) {
+    std::lock_guard lock(mutex_);
+    std::erase_if(jobs_, [requester](const auto& job) { return job.requester == requester; });
+  }
+
+  void setSettleDelay(std::chrono::milliseconds delay) {
+    std::lock_guard lock(mutex_);
+    delay_ = delay;
+  }
+
+  void setRecaptureInterval(std::chrono::milliseconds interval) {
+    std::lock_guard lock(mutex_);
+    interval_ = interval;
+  }
+
+  // The window is gone, with its queued capture
+  void forget(const std::string& address) {
+    std::lock_guard lock(mutex_);
+    recent_.erase(address);
+    if (auto it = std::ranges::find(jobs_, address, &CaptureJob::windowAddress);
+        it != jobs_.end()) {
+      jobs_.erase(it);
+    }
+  }
+
+ private:
+  // The last capture of a window, and the hash and size of what its thumbnail shows
+  struct Recent {
+    std::chrono::steady_clock::time_point capturedAt;
+    std::optional<ContentHash> saved;
+    int width = 0;
+    int height = 0;
+  };
+
+  static constexpr size_t MAX_PENDING = 64;
+
+  CaptureWorker() : thread_([this] { run(); }) {}
+
+  void run() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      if (jobs_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto next = std::ranges::min_element(jobs_, {}, &CaptureJob::due);
+      if (std::chrono::steady_clock::now() < next->due) {
+        cv_.wait_until(lock, next->due);
+        continue;
+      }
+      auto job = std::move(*next);
+      jobs_.erase(next);
+      recent_[job.windowAddress].capturedAt = std::chrono::steady_clock::now();
+      lock.unlock();
+      execute(std::move(job));
+      lock.lock();
+    }
+  }
+
+  static void execute(CaptureJob job) {
+    if (job.toolsOnly) {
+      auto result = captureWithTools(job.fullPath, job.thumbPath, job.x, job.y, job.width,
+                                     job.height, [&job](const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) {
+                                       return inst().unchanged(job, pixbuf);
+                                     });
+      if (result == CaptureResult::FAILED) {
+        spdlog::debug("[THUMBNAIL] Capture failed for window {}", job.windowAddress);
+        return;
+      }
+      if (result == CaptureResult::SAVED) {
+        finish(job);
+      }
+      return;
+    }
+
+    // Wayland objects are only touched from the GTK thread
+    Glib::MainContext::get_default()->invoke([job]() {
+      screencopy::captureRegion(
+          job.x, job.y, job.width, job.height, [job](const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) {
+            if (pixbuf && inst().unchanged(job, pixbuf)) {
+              return;
+            }
+            if (pixbuf && saveThumbnail(pixbuf, job.thumbPath)) {
+              finish(job);
+              return;
+            }
+            spdlog::debug("[THUMBNAIL] Screencopy failed for window {}", job.windowAddress);
+            if (captureToolsAvailable()) {
+              auto retry = job;
+              retry.toolsOnly = true;
+              inst().enqueue(std::move(retry), true);
+            }
+          });
+      return false;
+    });
+  }
+
+  /* Whether the capture shows what the thumbnail of the window already does, which is then kept
+   * as current. Otherwise the capture's hash is taken as the one of the thumbnail about to be
+   * saved. A thumbnail is compared with the capture it was saved from, not with the ones kept
+   * since, so that a slow drift is noticed too.
+   */
+  bool unchanged(const CaptureJob& job, const Glib::RefPtr<Gdk::Pixbuf>& pixbuf) {
+    const auto hash = contentHash(pixbuf);
+    {
+      std::lock_guard lock(mutex_);
+      auto& recent = recent_[job.windowAddress];
+      if (!recent.saved || recent.width != job.width || recent.height != job.height ||
+          hashDistance(*recent.saved, hash) > HASH_TOLERANCE) {
+        recent.saved = hash;
+        recent.width = job.width;
+        recent.height = job.height;
+        return false;
+      }
+    }
+    auto capturedAt = ThumbnailIndex::inst().touch(job.windowAddress);
+    if (!capturedAt) {
+      return false;  // cleaned up meanwhile
+    }
+    PixbufLru::inst().touch(job.windowAddress, *capturedAt);
+    spdlog::trace("[THUMBNAIL] Window {} is unchanged, keeping its thumbnail", job.windowAddress);
+    return true;
+  }
+
+  static void finish(const CaptureJob& job) {
+    recordThumbnail(job.thumbPath, job.windowAddress, job.windowClass, job.windowTitle,
+                    job.workspaceName, job.width, job.height);
+    PixbufLru::inst().invalidate(job.windowAddress);
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::list<CaptureJob> jobs_;
+  std::unordered_map<std::string, Recent> recent_;
+  std::chrono::milliseconds delay_{DEFAULT_SETTLE_DELAY_MS};
+  std::chrono::milliseconds interval_{DEFAULT_RECAPTURE_INTERVAL_MS};
+  std::thread thread_;
+};
+
+}  // namespace
+
+ThumbnailCache::ThumbnailCache() {
+  m_cacheDir = getCachePath();
   
-  // Check for magick or convert
-  int magick_result = system("command -v magick >/dev/null 2>&1");
-  int convert_result = system("command -v convert >/dev/null 2>&1");
+  // Create cache directory if it doesn't exist
+  try {
+    fs::create_directories(m_cacheDir);
+  } catch (const fs::filesystem_error& e) {
+    spdlog::warn("Failed to create thumbnail cache directory: {}", e.what());
+  }
   
-  return (magick_result == 0 || convert_result == 0);
+  m_nativeCapture = screencopy::isSupported();
+  m_captureAvailable = m_nativeCapture || checkCaptureTools();
+  if (!m_captureAvailable) {
+    spdlog::warn(
+        "Thumbnail capture not available (need wlr-screencopy support or grim)");
+  }
 }
 
-std::string ThumbnailCache::getResizeCommand() const {
-  // Prefer magick (ImageMagick v7), fallback to convert (v6)
-  int magick_result = system("command -v magick >/dev/null 2>&1");
-  return (magick_result == 0) ? "magick" : "convert";
+std::string ThumbnailCache::getCachePath() const { return cacheDirFromEnv(); }
+
+std::string ThumbnailCache::getThumbnailFilePath(const std::string& windowAddress) const {
+  return m_cacheDir + "/" + windowAddress + ".thumb";
 }
 
+bool ThumbnailCache::checkCaptureTools() { return captureToolsAvailable(); }
+
+
 void ThumbnailCache::captureWindow(const std::string& windowAddress, int x, int y, int width,
                                    int height, const std::string& windowClass,
                                    const std::string& windowTitle,
-                                   const std::string& workspaceName) {
+                                   const std::string& workspaceName, bool now,
+                                   std::shared_ptr<void> done) {
   if (!m_captureAvailable) {
     return;
   }
   
-  spdlog::debug("[THUMBNAIL] Capturing window {}: {}x{} at {},{}", windowAddress, width, height, x, y);
-  
-  std::string full_path = m_cacheDir + "/full_" + windowAddress + ".png";
-  std::string thumb_path = getThumbnailFilePath(windowAddress);
-  std::string meta_path = getMetadataFilePath(windowAddress);
-  
-  // Build capture command with -s 1 to use logical pixels (not scaled)
-  std::ostringstream capture_cmd;
-  capture_cmd << "grim -s 1 -g \"" << x << "," << y << " " << width << "x" << height << "\" "
-              << full_path << " 2>/dev/null";
-  
-  // Execute capture in background (fork to avoid blocking)
-  pid_t pid = fork();
-  if (pid == 0) {
-    // Child process - wait for animation to complete before capturing
-    usleep(300000); // 300ms delay for workspace switch animation
-    
-    int result = system(capture_cmd.str().c_str());
-    if (result != 0) {
-      spdlog::debug("[THUMBNAIL] Capture failed for window {}", windowAddress);
-      _exit(1);
-    }
-    
-    // Resize to thumbnail
-    std::string resize_cmd_name = getResizeCommand();
-    std::ostringstream resize_cmd;
-    resize_cmd << resize_cmd_name << " " << full_path << " -resize 256x256 " << thumb_path
-               << " 2>/dev/null";
-    result = system(resize_cmd.str().c_str());
-    if (result != 0) {
-      spdlog::debug("[THUMBNAIL] Resize failed for window {}", windowAddress);
-      _exit(1);
-    }
-    
-    // Clean up full size image
-    unlink(full_path.c_str());
-    
-    // Write metadata
-    std::ofstream meta_file(meta_path);
-    if (meta_file.is_open()) {
-      auto now = std::chrono::system_clock::now();
-      auto timestamp = std::chrono::system_clock::to_time_t(now);
-      
-      meta_file << "address=" << windowAddress << "\n";
-      meta_file << "class=" << windowClass << "\n";
-      meta_file << "title=" << windowTitle << "\n";
-      meta_file << "workspace=" << workspaceName << "\n";
-      meta_file << "timestamp=" << timestamp << "\n";
-      meta_file << "width=" << width << "\n";
-      meta_file << "height=" << height << "\n";
-      meta_file.close();
-    }
-    
-    _exit(0);
-  } else if (pid < 0) {
-    spdlog::error("[THUMBNAIL] Failed to fork for thumbnail capture");
-  }
-  // Parent continues without waiting
+  spdlog::debug("[THUMBNAIL] Queueing capture of window {}: {}x{} at {},{}", windowAddress, width,
+                height, x, y);
+
+  CaptureJob job;
+  job.windowAddress = windowAddress;
+  job.windowClass = windowClass;
+  job.windowTitle = windowTitle;
+  job.workspaceName = workspaceName;
+  job.x = x;
+  job.y = y;
+  job.width = width;
+  job.height = height;
+  job.fullPath = m_cacheDir + "/full_" + windowAddress + ".png";
+  job.thumbPath = getThumbnailFilePath(windowAddress);
+  job.toolsOnly = !m_nativeCapture;
+  job.requester = this;
+  job.now = now;
+  job.done = std::move(done);
+  CaptureWorker::inst().enqueue(std::move(job));
 }
 
 void ThumbnailCache::captureWindowSync(const std::string& windowAddress, int x, int y, int width,
                                        int height, const std::string& windowClass,
                                        const std::string& windowTitle,
                                        const std::string& workspaceName) {
-  if (!m_captureAvailable) {
+  // Only the external tools are usable here: the native path completes on the GTK main loop.
+  if (!captureToolsAvailable()) {
     return;
   }
   
@@ -156,161 +909,85 @@ void ThumbnailCache::captureWindowSync(const std::string& windowAddress, int x,
   
   std::string full_path = m_cacheDir + "/full_" + windowAddress + ".png";
   std::string thumb_path = getThumbnailFilePath(windowAddress);
-  std::string meta_path = getMetadataFilePath(windowAddress);
   
-  // Build and execute capture command synchronously with -s 1 for logical pixels
-  std::ostringstream capture_cmd;
-  capture_cmd << "grim -s 1 -g \"" << x << "," << y << " " << width << "x" << height << "\" "
-              << full_path << " 2>/dev/null";
-  
-  int result = system(capture_cmd.str().c_str());
-  if (result != 0) {
+  if (captureWithTools(full_path, thumb_path, x, y, width, height) != CaptureResult::SAVED) {
     spdlog::debug("[THUMBNAIL] Sync capture failed for window {}", windowAddress);
     return;
   }
-  
-  // Resize to thumbnail
-  std::string resize_cmd_name = getResizeCommand();
-  std::ostringstream resize_cmd;
-  resize_cmd << resize_cmd_name << " " << full_path << " -resize 256x256 " << thumb_path
-             << " 2>/dev/null";
-  result = system(resize_cmd.str().c_str());
-  if (result != 0) {
-    spdlog::debug("[THUMBNAIL] Sync resize failed for window {}", windowAddress);
-    unlink(full_path.c_str());
-    return;
+
+  recordThumbnail(thumb_path, windowAddress, windowClass, windowTitle, workspaceName, width,
+                  height);
+  PixbufLru::inst().invalidate(windowAddress);
+}
+
+void ThumbnailCache::cancelPendingCaptures() { CaptureWorker::inst().cancelPending(this); }
+
+void ThumbnailCache::setSettleDelay(std::chrono::milliseconds delay) {
+  CaptureWorker::inst().setSettleDelay(delay);
+}
+
+void ThumbnailCache::setRecaptureInterval(std::chrono::milliseconds interval) {
+  CaptureWorker::inst().setRecaptureInterval(interval);
+}
+
+Glib::RefPtr<Gdk::Pixbuf> ThumbnailCache::getThumbnailPixbuf(const std::string& windowAddress,
+                                                            int maxAgeSeconds) {
+  auto& lru = PixbufLru::inst();
+  const auto maxAge = std::chrono::seconds(maxAgeSeconds);
+  if (auto pixbuf = lru.get(windowAddress, maxAge)) {
+    return pixbuf;
   }
-  
-  // Clean up full size image
-  unlink(full_path.c_str());
-  
-  // Write metadata
-  std::ofstream meta_file(meta_path);
-  if (meta_file.is_open()) {
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::system_clock::to_time_t(now);
-    
-    meta_file << "address=" << windowAddress << "\n";
-    meta_file << "class=" << windowClass << "\n";
-    meta_file << "title=" << windowTitle << "\n";
-    meta_file << "workspace=" << workspaceName << "\n";
-    meta_file << "timestamp=" << timestamp << "\n";
-    meta_file << "width=" << width << "\n";
-    meta_file << "height=" << height << "\n";
-    meta_file.close();
+
+  auto entry = ThumbnailIndex::inst().get(windowAddress);
+  if (!entry || std::chrono::system_clock::now() - entry->meta.timestamp > maxAge) {
+    return {};
   }
+  static const std::string cache_dir = cacheDirFromEnv();
+  auto pixbuf = loadThumbnail(cache_dir + "/" + windowAddress + ".thumb");
+  if (!pixbuf) {
+    spdlog::debug("[THUMBNAIL] Failed to load thumbnail for {}", windowAddress);
+    return {};
+  }
+  lru.put(windowAddress, entry->meta.timestamp, pixbuf);
+  return pixbuf;
 }
 
+void ThumbnailCache::setPixbufCacheLimit(size_t maxBytes) { PixbufLru::inst().setLimit(maxBytes); }
+
 std::optional<std::string> ThumbnailCache::getThumbnailPath(const std::string& windowAddress,
                                                             int maxAgeSeconds) {
-  std::string thumb_path = getThumbnailFilePath(windowAddress);
-  
-  // Check if file exists
-  if (!fs::exists(thumb_path)) {
+  auto entry = ThumbnailIndex::inst().get(windowAddress);
+  if (!entry) {
     return std::nullopt;
   }
-  
-  // Check age
-  try {
-    auto ftime = fs::last_write_time(thumb_path);
-    auto now = fs::file_time_type::clock::now();
-    auto age = std::chrono::duration_cast<std::chrono::seconds>(now - ftime).count();
-    
-    if (age > maxAgeSeconds) {
-      spdlog::debug("[THUMBNAIL] Thumbnail too old for {}: {}s", windowAddress, age);
-      return std::nullopt;
-    }
-    
-    return thumb_path;
-  } catch (const fs::filesystem_error& e) {
-    spdlog::debug("[THUMBNAIL] Error checking thumbnail age: {}", e.what());
+
+  auto age = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() -
+                                                              entry->meta.timestamp)
+                 .count();
+  if (age > maxAgeSeconds) {
+    spdlog::debug("[THUMBNAIL] Thumbnail too old for {}: {}s", windowAddress, age);
     return std::nullopt;
   }
+
+  return getThumbnailFilePath(windowAddress);
 }
 
 std::optional<ThumbnailMetadata> ThumbnailCache::getMetadata(const std::string& windowAddress) {
-  std::string meta_path = getMetadataFilePath(windowAddress);
-  
-  if (!fs::exists(meta_path)) {
-    return std::nullopt;
-  }
-  
-  std::ifstream meta_file(meta_path);
-  if (!meta_file.is_open()) {
+  auto entry = ThumbnailIndex::inst().get(windowAddress);
+  if (!entry) {
     return std::nullopt;
   }
-  
-  ThumbnailMetadata meta;
-  meta.windowAddress = windowAddress;
-  
-  std::string line;
-  while (std::getline(meta_file, line)) {
-    size_t eq_pos = line.find('=');
-    if (eq_pos == std::string::npos) continue;
-    
-    std::string key = line.substr(0, eq_pos);
-    std::string value = line.substr(eq_pos + 1);
-    
-    if (key == "class") {
-      meta.windowClass = value;
-    } else if (key == "title") {
-      meta.windowTitle = value;
-    } else if (key == "workspace") {
-      meta.workspaceName = value;
-    } else if (key == "timestamp") {
-      time_t timestamp = std::stol(value);
-      meta.timestamp = std::chrono::system_clock::from_time_t(timestamp);
-    } else if (key == "width") {
-      meta.width = std::stoi(value);
-    } else if (key == "height") {
-      meta.height = std::stoi(value);
-    }
-  }
-  
-  return meta;
+  return entry->meta;
 }
 
 void ThumbnailCache::cleanup(int maxAgeSeconds, size_t maxSizeMB) {
-  try {
-    size_t total_size = 0;
-    std::vector<std::pair<fs::file_time_type, fs::path>> files;
-    
-    // Collect all thumbnail files with their timestamps
-    for (const auto& entry : fs::directory_iterator(m_cacheDir)) {
-      if (entry.path().extension() == ".png") {
-        files.emplace_back(fs::last_write_time(entry), entry.path());
-        total_size += fs::file_size(entry);
-      }
-    }
-    
-    // Sort by age (oldest first)
-    std::sort(files.begin(), files.end());
-    
-    auto now = fs::file_time_type::clock::now();
-    size_t max_bytes = maxSizeMB * 1024 * 1024;
-    
-    // Remove old files or if over size limit
-    for (const auto& [ftime, path] : files) {
-      auto age = std::chrono::duration_cast<std::chrono::seconds>(now - ftime).count();
-      
-      bool should_remove = (age > maxAgeSeconds) || (total_size > max_bytes);
-      
-      if (should_remove) {
-        size_t file_size = fs::file_size(path);
-        fs::remove(path);
-        
-        // Remove metadata file too
-        std::string meta_path = path.string();
-        meta_path.replace(meta_path.find(".png"), 4, ".meta");
-        fs::remove(meta_path);
-        
-        total_size -= file_size;
-        spdlog::debug("[THUMBNAIL] Cleaned up old thumbnail: {}", path.filename().string());
-      }
-    }
-  } catch (const fs::filesystem_error& e) {
-    spdlog::warn("[THUMBNAIL] Cleanup error: {}", e.what());
-  }
+  ThumbnailIndex::inst().cleanup(std::chrono::seconds(maxAgeSeconds),
+                                 static_cast<uint64_t>(maxSizeMB) * 1024 * 1024);
+}
+
+void ThumbnailCache::forget(const std::string& windowAddress) {
+  CaptureWorker::inst().forget(windowAddress);
+  ThumbnailIndex::inst().remove(windowAddress);
 }
 
 }  // namespace waybar::util
@@ -0,0 +1,171 @@
+#include "util/wireplumber_context.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "util/shared_instance.hpp"
+
+namespace waybar::util {
+
+std::shared_ptr<WireplumberContext> WireplumberContext::getInstance() {
+  static SharedInstance<WireplumberContext> instance;
+  return instance.get([] { return std::shared_ptr<WireplumberContext>(new WireplumberContext()); });
+}
+
+WireplumberContext::WireplumberContext() {
+  wp_init(WP_INIT_PIPEWIRE);
+  wp_core_ = wp_core_new(nullptr, nullptr, nullptr);
+  apis_ = g_ptr_array_new_with_free_func(g_object_unref);
+  om_ = wp_object_manager_new();
+
+  // every node, whatever media class the modules are configured to follow
+  wp_object_manager_add_interest(om_, WP_TYPE_NODE, nullptr);
+
+  spdlog::debug("wireplumber: connecting to pipewire...");
+
+  if (wp_core_connect(wp_core_) == 0) {
+    spdlog::error("wireplumber: Could not connect to PipeWire");
+    g_clear_object(&om_);
+    g_clear_pointer(&apis_, g_ptr_array_unref);
+    g_clear_object(&wp_core_);
+    throw std::runtime_error("Could not connect to PipeWire\n");
+  }
+
+  spdlog::debug("wireplumber: connected!");
+
+  g_signal_connect_swapped(om_, "installed", (GCallback)onObjectManagerInstalled, this);
+
+  spdlog::debug("wireplumber: loading default nodes api module");
+  wp_core_load_component(wp_core_, "libwireplumber-module-default-nodes-api", "module", nullptr,
+                         "default-nodes-api", nullptr, (GAsyncReadyCallback)onDefaultNodesApiLoaded,
+                         this);
+}
+
+WireplumberContext::~WireplumberContext() {
+  if (mixer_api_ != nullptr) g_signal_handlers_disconnect_by_data(mixer_api_, this);
+  if (def_nodes_api_ != nullptr) g_signal_handlers_disconnect_by_data(def_nodes_api_, this);
+  g_signal_handlers_disconnect_by_data(om_, this);
+  wp_core_disconnect(wp_core_);
+  g_clear_pointer(&apis_, g_ptr_array_unref);
+  g_clear_object(&om_);
+  g_clear_object(&wp_core_);
+  g_clear_object(&mixer_api_);
+  g_clear_object(&def_nodes_api_);
+}
+
+void WireplumberContext::subscribe(Listener* listener) {
+  listeners_.push_back(listener);
+  if (ready_) {
+    listener->onContextReady();
+  }
+}
+
+void WireplumberContext::unsubscribe(Listener* listener) { std::erase(listeners_, listener); }
+
+void WireplumberContext::onDefaultNodesApiLoaded(WpObject* p, GAsyncResult* res,
+                                                 WireplumberContext* self) {
+  g_autoptr(GError) error = nullptr;
+
+  spdlog::debug("wireplumber: callback loading default node api module");
+
+  if (wp_core_load_component_finish(self->wp_core_, res, &error) == FALSE) {
+    spdlog::error("wireplumber: default nodes API load failed");
+    throw std::runtime_error(error->message);
+  }
+  spdlog::debug("wireplumber: loaded default nodes api");
+  g_ptr_array_add(self->apis_, wp_plugin_find(self->wp_core_, "default-nodes-api"));
+
+  spdlog::debug("wireplumber: loading mixer api module");
+  wp_core_load_component(self->wp_core_, "libwireplumber-module-mixer-api", "module", nullptr,
+                         "mixer-api", nullptr, (GAsyncReadyCallback)onMixerApiLoaded, self);
+}
+
+void WireplumberContext::onMixerApiLoaded(WpObject* p, GAsyncResult* res,
+                                          WireplumberContext* self) {
+  g_autoptr(GError) error = nullptr;
+
+  if (wp_core_load_component_finish(self->wp_core_, res, &error) == FALSE) {
+    spdlog::error("wireplumber: mixer API load failed");
+    throw std::runtime_error(error->message);
+  }
+
+  spdlog::debug("wireplumber: loaded mixer API");
+  g_ptr_array_add(self->apis_, ({
+                    WpPlugin* p = wp_plugin_find(self->wp_core_, "mixer-api");
+                    g_object_set(G_OBJECT(p), "scale", 1 /* cubic */, nullptr);
+                    p;
+                  }));
+
+  self->activatePlugins();
+}
+
+void WireplumberContext::activatePlugins() {
+  spdlog::debug("wireplumber: activating plugins");
+  for (uint16_t i = 0; i < apis_->len; i++) {
+    WpPlugin* plugin = static_cast<WpPlugin*>(g_ptr_array_index(apis_, i));
+    pending_plugins_++;
+    wp_object_activate(WP_OBJECT(plugin), WP_PLUGIN_FEATURE_ENABLED, nullptr,
+                       (GAsyncReadyCallback)onPluginActivated, this);
+  }
+}
+
+void WireplumberContext::onPluginActivated(WpObject* p, GAsyncResult* res,
+                                           WireplumberContext* self) {
+  const auto* pluginName = wp_plugin_get_name(WP_PLUGIN(p));
+  spdlog::debug("wireplumber: onPluginActivated: {}", pluginName);
+  g_autoptr(GError) error = nullptr;
+
+  if (wp_object_activate_finish(p, res, &error) == 0) {
+    spdlog::error("wireplumber: error activating plugin: {}", error->message);
+    throw std::runtime_error(error->message);
+  }
+
+  if (--self->pending_plugins_ == 0) {
+    wp_core_install_object_manager(self->wp_core_, self->om_);
+  }
+}
+
+void WireplumberContext::onObjectManagerInstalled(WireplumberContext* self) {
+  spdlog::debug("wireplumber: onObjectManagerInstalled");
+
+  self->def_nodes_api_ = wp_plugin_find(self->wp_core_, "default-nodes-api");
+
+  if (self->def_nodes_api_ == nullptr) {
+    spdlog::error("wireplumber: default nodes api is not loaded.");
+    throw std::runtime_error("Default nodes API is not loaded\n");
+  }
+
+  self->mixer_api_ = wp_plugin_find(self->wp_core_, "mixer-api");
+
+  if (self->mixer_api_ == nullptr) {
+    spdlog::error("wireplumber: mixer api is not loaded.");
+    throw std::runtime_error("Mixer api is not loaded\n");
+  }
+
+  g_signal_connect_swapped(self->mixer_api_, "changed", (GCallback)onMixerChanged, self);
+  g_signal_connect_swapped(self->def_nodes_api_, "changed", (GCallback)onDefaultNodesApiChanged,
+                           self);
+
+  self->ready_ = true;
+  for (auto* listener : self->listeners_) {
+    listener->onContextReady();
+  }
+}
+
+void WireplumberContext::onMixerChanged(WireplumberContext* self, uint32_t id) {
+  for (auto* listener : self->listeners_) {
+    if (listener->watchesNode(id)) {
+      listener->onNodeMixerChanged(id);
+    }
+  }
+}
+
+void WireplumberContext::onDefaultNodesApiChanged(WireplumberContext* self) {
+  for (auto* listener : self->listeners_) {
+    listener->onDefaultNodesChanged();
+  }
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,58 @@
+#include "util/xkb_layouts.hpp"
+
+#include <spdlog/spdlog.h>
+#include <xkbcommon/xkbregistry.h>
+
+#include <utility>
+
+namespace waybar::util {
+
+namespace {
+
+std::string orEmpty(const char* str) { return str == nullptr ? "" : str; }
+
+}  // namespace
+
+const XkbLayouts& XkbLayouts::inst() {
+  static const XkbLayouts layouts;
+  return layouts;
+}
+
+XkbLayouts::XkbLayouts() {
+  auto* const context = rxkb_context_new(RXKB_CONTEXT_LOAD_EXOTIC_RULES);
+  if (context == nullptr || !rxkb_context_parse_default_ruleset(context)) {
+    spdlog::warn("Failed to load the xkb registry, layouts won't have short names");
+    if (context != nullptr) rxkb_context_unref(context);
+    return;
+  }
+
+  // The registry lists a base layout before its variants
+  StringMap<std::string> base_briefs;
+  for (auto* layout = rxkb_layout_first(context); layout != nullptr;
+       layout = rxkb_layout_next(layout)) {
+    auto name = orEmpty(rxkb_layout_get_name(layout));
+    const auto* brief = rxkb_layout_get_brief(layout);
+    std::string short_description;
+    if (brief != nullptr) {
+      short_description = brief;
+      base_briefs.emplace(name, short_description);
+    } else if (auto base = base_briefs.find(name); base != base_briefs.end()) {
+      short_description = base->second;
+    }
+    // The first one with a description wins, as in a walk of the registry
+    layouts_.emplace(orEmpty(rxkb_layout_get_description(layout)),
+                     Layout{.short_name = std::move(name),
+                            .variant = orEmpty(rxkb_layout_get_variant(layout)),
+                            .short_description = std::move(short_description)});
+  }
+  rxkb_context_unref(context);
+
+  spdlog::debug("Indexed {} xkb layouts", layouts_.size());
+}
+
+const XkbLayouts::Layout* XkbLayouts::find(std::string_view description) const {
+  const auto found = layouts_.find(description);
+  return found != layouts_.end() ? &found->second : nullptr;
+}
+
+}  // namespace waybar::util
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/* A Hyprland that replays a recorded session: socket1 answers the queries with the recorded
+ * replies, socket2 sends the recorded events on replay(). The recordings are files in dir:
+ *   socket2, the event stream, eg. from a session with
+ *     socat -u UNIX-CONNECT:$XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock - >socket2
+ *   <query>.json, the reply to a j/<query>, eg. from hyprctl -j workspaces >workspaces.json
+ * It points HYPRLAND_INSTANCE_SIGNATURE and XDG_RUNTIME_DIR at itself, so it must be created
+ * before the IPC is.
+ */
+class FakeHyprland {
+ public:
+  explicit FakeHyprland(const std::filesystem::path& dir)
+      : runtime_dir_(std::filesystem::temp_directory_path() /
+                     ("waybar-bench-" + std::to_string(getpid()))) {
+    events_ = readFile(dir / "socket2");
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+      if (entry.path().extension() == ".json") {
+        replies_["j/" + entry.path().stem().string()] = readFile(entry.path());
+      }
+    }
+
+    const auto socket_dir = runtime_dir_ / "hypr" / SIGNATURE;
+    std::filesystem::create_directories(socket_dir);
+    setenv("XDG_RUNTIME_DIR", runtime_dir_.c_str(), 1);
+    setenv("HYPRLAND_INSTANCE_SIGNATURE", SIGNATURE, 1);
+    socket1_ = listenOn(socket_dir / ".socket.sock");
+    socket2_ = listenOn(socket_dir / ".socket2.sock");
+
+    socket1_thread_ = std::thread([this] { serveSocket1(); });
+    socket2_thread_ = std::thread([this] {
+      int client = accept(socket2_, nullptr, nullptr);
+      std::lock_guard lock(mutex_);
+      client2_ = client;
+      connected_.notify_all();
+    });
+  }
+
+  ~FakeHyprland() {
+    shutdown(socket1_, SHUT_RDWR);
+    shutdown(socket2_, SHUT_RDWR);
+    socket1_thread_.join();
+    socket2_thread_.join();
+    close(socket1_);
+    close(socket2_);
+    if (client2_ >= 0) {
+      close(client2_);
+    }
+    std::filesystem::remove_all(runtime_dir_);
+  }
+
+  // Sends the recorded events once, after waiting for the IPC to connect
+  void replay() {
+    std::unique_lock lock(mutex_);
+    connected_.wait(lock, [this] { return client2_ >= 0; });
+    for (size_t written = 0; written < events_.size();) {
+      auto n = write(client2_, events_.data() + written, events_.size() - written);
+      if (n <= 0) {
+        throw std::runtime_error("FakeHyprland: can't write the events");
+      }
+      written += n;
+    }
+  }
+
+  size_t eventCount() const {
+    size_t count = 0;
+    for (auto c : events_) {
+      count += c == '\n';
+    }
+    return count;
+  }
+  // The connections to socket1 so far, one per query or batch of queries
+  size_t socket1Requests() const { return socket1_requests_; }
+
+ private:
+  static constexpr const char* SIGNATURE = "replay";
+
+  static std::string readFile(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file) {
+      throw std::runtime_error("FakeHyprland: can't read " + path.string());
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  static int listenOn(const std::filesystem::path& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(fd, 16) < 0) {
+      throw std::runtime_error("FakeHyprland: can't listen on " + path.string());
+    }
+    return fd;
+  }
+
+  // As Hyprland does: one request per connection, answered and closed
+  void serveSocket1() {
+    int client;
+    while ((client = accept(socket1_, nullptr, nullptr)) >= 0) {
+      ++socket1_requests_;
+      char buf[8192];
+      auto n = read(client, buf, sizeof(buf));
+      std::string request(buf, std::max<ssize_t>(n, 0));
+      std::string reply;
+      if (request.starts_with("[[BATCH]]")) {
+        // The replies of a batch are separated by three newlines
+        std::string_view queries = std::string_view(request).substr(9);
+        while (!queries.empty()) {
+          auto query = queries.substr(0, queries.find(';'));
+          queries.remove_prefix(std::min(query.size() + 1, queries.size()));
+          reply += replyTo(std::string(query)) + "\n\n\n";
+        }
+      } else {
+        reply = replyTo(request);
+      }
+      for (size_t written = 0; written < reply.size();) {
+        auto w = write(client, reply.data() + written, reply.size() - written);
+        if (w <= 0) {
+          break;
+        }
+        written += w;
+      }
+      close(client);
+    }
+  }
+
+  std::string replyTo(const std::string& query) const {
+    auto it = replies_.find(query);
+    return it != replies_.end() ? it->second : "unknown request";
+  }
+
+  std::filesystem::path runtime_dir_;
+  std::string events_;
+  std::map<std::string, std::string> replies_;
+
+  int socket1_ = -1;
+  int socket2_ = -1;
+  std::atomic<size_t> socket1_requests_{0};
+  std::thread socket1_thread_;
+  std::thread socket2_thread_;
+
+  std::mutex mutex_;
+  std::condition_variable connected_;
+  int client2_ = -1;
+};
@@ -0,0 +1,86 @@
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "fake_hyprland.hpp"
+#include "modules/hyprland/backend.hpp"
+
+namespace hyprland = waybar::modules::hyprland;
+
+namespace {
+
+// Counts the events it gets, and queries the state on the ones a workspaces module reacts to
+class Handler : public hyprland::EventHandler {
+ public:
+  Handler(hyprland::IPC& ipc, bool query) : ipc_(ipc), query_(query) {}
+
+  void onEvent(const std::string& ev) override {
+    if (query_) {
+      ipc_.getSocket1JsonReplies({"monitors", "workspaces", "clients"});
+    }
+    std::lock_guard lock(mutex_);
+    ++count_;
+    counted_.notify_all();
+  }
+
+  void waitFor(size_t count) {
+    std::unique_lock lock(mutex_);
+    counted_.wait(lock, [&] { return count_ >= count; });
+  }
+
+ private:
+  hyprland::IPC& ipc_;
+  const bool query_;
+  std::mutex mutex_;
+  std::condition_variable counted_;
+  size_t count_ = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Hyprland session replay", "[bench][hyprland]") {
+  static FakeHyprland fake("test/bench/fixtures/hyprland");
+  auto& ipc = hyprland::IPC::inst();
+
+  // The events of the recording, all of them counted to know when a replay is through
+  static Handler counter(ipc, false);
+  static Handler workspaces(ipc, true);
+  static bool registered = false;
+  if (!registered) {
+    std::set<std::string> names;
+    std::ifstream events("test/bench/fixtures/hyprland/socket2");
+    for (std::string line; std::getline(events, line);) {
+      names.insert(line.substr(0, line.find(">>")));
+    }
+    for (const auto& name : names) {
+      ipc.registerForIPC(name, &counter);
+    }
+    for (const auto* name : {"workspacev2", "createworkspacev2", "destroyworkspacev2",
+                             "focusedmonv2", "openwindow", "closewindow", "movewindowv2",
+                             "windowtitlev2"}) {
+      ipc.registerForIPC(name, &workspaces);
+    }
+    registered = true;
+  }
+
+  size_t replayed = 0;
+  const auto requests_before = fake.socket1Requests();
+  BENCHMARK("replay, " + std::to_string(fake.eventCount()) + " events") {
+    fake.replay();
+    counter.waitFor(++replayed * fake.eventCount());
+  };
+  if (replayed > 0) {
+    spdlog::info("hyprland replay: {} socket1 requests per replay of {} events",
+                 (fake.socket1Requests() - requests_before) / replayed, fake.eventCount());
+  }
+}
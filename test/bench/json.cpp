@@ -0,0 +1,34 @@
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "util/json.hpp"
+
+namespace {
+
+std::string readFixture(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream data;
+  data << file.rdbuf();
+  return data.str();
+}
+
+}  // namespace
+
+// The IPC replies the Hyprland modules parse on every event, through the same JsonParser
+TEST_CASE("IPC reply parsing", "[bench][json]") {
+  const auto clients = readFixture("test/bench/fixtures/hyprland/clients.json");
+  const auto workspaces = readFixture("test/bench/fixtures/hyprland/workspaces.json");
+  REQUIRE_FALSE(clients.empty());
+  waybar::util::JsonParser parser;
+
+  BENCHMARK("clients") { return parser.parse(clients).size(); };
+  BENCHMARK("workspaces") { return parser.parse(workspaces).size(); };
+}
@@ -0,0 +1,62 @@
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <string_view>
+
+#include "util/proc_file.hpp"
+
+using waybar::util::nextNumber;
+using waybar::util::ProcFile;
+
+/* The procfs files the cpu, memory and network modules sample, read from fixtures through the
+ * same ProcFile and nextNumber the modules parse them with.
+ */
+namespace {
+
+// Every number of every line after its key, as the parsers go through them
+template <typename Key>
+size_t sumLines(std::string_view data, Key&& key_end) {
+  size_t sum = 0;
+  while (!data.empty()) {
+    auto line = data.substr(0, data.find('\n'));
+    data.remove_prefix(std::min(line.size() + 1, data.size()));
+    line.remove_prefix(std::min(key_end(line), line.size()));
+    for (size_t n; nextNumber(line, n);) {
+      sum += n;
+    }
+  }
+  return sum;
+}
+
+}  // namespace
+
+TEST_CASE("procfs sampling", "[bench][proc]") {
+  ProcFile stat{"test/bench/fixtures/stat"};
+  ProcFile meminfo{"test/bench/fixtures/meminfo"};
+  ProcFile net_dev{"test/bench/fixtures/net_dev"};
+  REQUIRE(stat.tryRead());
+  REQUIRE(meminfo.tryRead());
+  REQUIRE(net_dev.tryRead());
+
+  BENCHMARK("/proc/stat") {
+    return sumLines(stat.read(), [](std::string_view line) {
+      return line.starts_with("cpu") ? line.find(' ') : line.size();
+    });
+  };
+  BENCHMARK("/proc/meminfo") {
+    return sumLines(meminfo.read(), [](std::string_view line) { return line.find(':') + 1; });
+  };
+  BENCHMARK("/proc/net/dev, one interface") {
+    // As the network module does: straight to the line of its interface
+    auto data = net_dev.read();
+    auto line = data.substr(data.find("wlan0:") + 6);
+    line = line.substr(0, line.find('\n'));
+    unsigned long long bytes = 0;
+    nextNumber(line, bytes);
+    return bytes;
+  };
+}
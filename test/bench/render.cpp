@@ -0,0 +1,240 @@
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <gtkmm.h>
+#include <spdlog/spdlog.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ALabel.hpp"
+
+using namespace waybar;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// An ALabel showing a counter its "backend", a worker thread, bumps
+class Synthetic : public ALabel {
+ public:
+  Synthetic(const Json::Value& config, const std::string& id)
+      : ALabel(config, "synthetic", id, "{}") {
+    connectUpdate([this] { update(); });
+  }
+
+  // The latency is measured from the first emission after the last update
+  void bump() {
+    ++value_;
+    Clock::rep expected = 0;
+    emitted_.compare_exchange_strong(expected, Clock::now().time_since_epoch().count());
+    dp.emit();
+  }
+
+  auto update() -> void override {
+    label_.set_markup(std::to_string(value_.load()));
+    if (auto emitted = emitted_.exchange(0); emitted != 0) {
+      unpainted_.push_back(emitted);
+    }
+    ALabel::update();
+  }
+
+  // The emission times of the updates not painted yet
+  std::vector<Clock::rep> unpainted_;
+
+ private:
+  std::atomic<unsigned> value_{0};
+  std::atomic<Clock::rep> emitted_{0};
+};
+
+double millis(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+double quantile(std::vector<double>& values, double q) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::ranges::sort(values);
+  return values[std::min(values.size() - 1, static_cast<size_t>(q * values.size()))];
+}
+
+Clock::duration cpuTime() {
+  timespec ts{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+/* Times the phases of the frame clock of a window. Layout and paint have no start signal of
+ * their own: layout is timed from before-paint, paint from the end of layout. A handler runs
+ * after the ones connected before it, and GTK's container sizer connects to layout as a resize
+ * is queued, so ours is connected anew on each frame.
+ */
+class FrameProbe {
+ public:
+  FrameProbe(GdkFrameClock* clock, std::vector<std::unique_ptr<Synthetic>>& modules)
+      : clock_(clock), modules_(modules) {
+    before_paint_ = g_signal_connect(clock_, "before-paint", G_CALLBACK(beforePaint), this);
+    paint_ = g_signal_connect_after(clock_, "paint", G_CALLBACK(paint), this);
+    after_paint_ = g_signal_connect(clock_, "after-paint", G_CALLBACK(afterPaint), this);
+  }
+
+  ~FrameProbe() {
+    for (auto id : {before_paint_, paint_, after_paint_, layout_}) {
+      if (id != 0) {
+        g_signal_handler_disconnect(clock_, id);
+      }
+    }
+  }
+
+  std::vector<double> layout;   // ms
+  std::vector<double> paint;    // ms
+  std::vector<double> latency;  // ms, from the emission to the end of the paint showing it
+  size_t frames = 0;
+
+ private:
+  static void beforePaint(GdkFrameClock* clock, FrameProbe* self) {
+    self->start_ = self->layout_end_ = Clock::now();
+    self->painted_ = false;
+    self->layout_ = g_signal_connect_after(clock, "layout", G_CALLBACK(layoutDone), self);
+  }
+
+  static void layoutDone(GdkFrameClock*, FrameProbe* self) { self->layout_end_ = Clock::now(); }
+
+  static void paint(GdkFrameClock*, FrameProbe* self) {
+    self->paint_end_ = Clock::now();
+    self->painted_ = true;
+  }
+
+  static void afterPaint(GdkFrameClock* clock, FrameProbe* self) {
+    if (self->layout_ != 0) {
+      g_signal_handler_disconnect(clock, self->layout_);
+      self->layout_ = 0;
+    }
+    if (!self->painted_) {
+      return;
+    }
+    ++self->frames;
+    self->layout.push_back(millis(self->layout_end_ - self->start_));
+    self->paint.push_back(millis(self->paint_end_ - self->layout_end_));
+    for (auto& module : self->modules_) {
+      for (auto emitted : module->unpainted_) {
+        self->latency.push_back(
+            millis(self->paint_end_ - Clock::time_point(Clock::duration(emitted))));
+      }
+      module->unpainted_.clear();
+    }
+  }
+
+  GdkFrameClock* clock_;
+  std::vector<std::unique_ptr<Synthetic>>& modules_;
+  gulong before_paint_ = 0;
+  gulong paint_ = 0;
+  gulong after_paint_ = 0;
+  gulong layout_ = 0;
+  Clock::time_point start_;
+  Clock::time_point layout_end_;
+  Clock::time_point paint_end_;
+  bool painted_ = false;
+};
+
+struct Load {
+  int modules;
+  int rate;  // updates per second of each module
+};
+
+// "10x5,50x1": 10 modules at 5 updates per second, then 50 at 1
+std::vector<Load> loads() {
+  const char* spec = std::getenv("WAYBAR_BENCH_RENDER");
+  if (spec == nullptr) {
+    return {{1, 1}, {10, 1}, {10, 10}, {50, 1}, {50, 10}, {100, 10}};
+  }
+  std::vector<Load> loads;
+  std::istringstream in(spec);
+  for (std::string item; std::getline(in, item, ',');) {
+    Load load{};
+    if (std::sscanf(item.c_str(), "%dx%d", &load.modules, &load.rate) == 2 && load.modules > 0 &&
+        load.rate > 0) {
+      loads.push_back(load);
+    }
+  }
+  return loads;
+}
+
+}  // namespace
+
+/* The modules of a bar in an offscreen window: GTK lays out and paints it as it would on
+ * screen, without a compositor showing it. It still needs a display, run it under eg.
+ * `GDK_BACKEND=broadway` with broadwayd, or in a headless compositor.
+ */
+TEST_CASE("Bar rendering under module load", "[bench][render]") {
+  static const bool gtk = [] {
+    if (!gtk_init_check(nullptr, nullptr)) {
+      return false;
+    }
+    Gtk::Main::init_gtkmm_internals();
+    return true;
+  }();
+  if (!gtk) {
+    WARN("No display to render on, skipped");
+    return;
+  }
+
+  const auto duration = std::chrono::seconds(2);
+  const Json::Value config(Json::objectValue);
+
+  for (const auto& load : loads()) {
+    Gtk::OffscreenWindow window;
+    Gtk::Box box(Gtk::ORIENTATION_HORIZONTAL);
+    std::vector<std::unique_ptr<Synthetic>> modules;
+    for (int i = 0; i < load.modules; ++i) {
+      auto& module = modules.emplace_back(std::make_unique<Synthetic>(config, std::to_string(i)));
+      box.pack_start(static_cast<Gtk::Widget&>(*module), false, false);
+    }
+    window.add(box);
+    window.show_all();
+
+    FrameProbe probe(gdk_window_get_frame_clock(window.get_window()->gobj()), modules);
+    auto loop = Glib::MainLoop::create();
+    std::atomic<bool> running{true};
+    // The modules in turn, so that each one updates rate times a second
+    std::thread backend([&] {
+      const auto step =
+          std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) /
+          (load.modules * load.rate);
+      auto next = Clock::now();
+      for (size_t i = 0; running; i = (i + 1) % modules.size()) {
+        modules[i]->bump();
+        std::this_thread::sleep_until(next += step);
+      }
+    });
+    Glib::signal_timeout().connect_once([&] { loop->quit(); },
+                                        std::chrono::milliseconds(duration).count());
+
+    const auto cpu_before = cpuTime();
+    const auto wall_before = Clock::now();
+    loop->run();
+    const auto cpu = cpuTime() - cpu_before;
+    const auto wall = Clock::now() - wall_before;
+    running = false;
+    backend.join();
+
+    CHECK(probe.frames > 0);
+    spdlog::info(
+        "render: {} modules at {}/s: {} frames, layout p50 {:.3f} max {:.3f} ms, paint p50 {:.3f} "
+        "max {:.3f} ms, emit to paint p50 {:.3f} p99 {:.3f} ms, cpu {:.1f}%",
+        load.modules, load.rate, probe.frames, quantile(probe.layout, 0.5),
+        quantile(probe.layout, 1), quantile(probe.paint, 0.5), quantile(probe.paint, 1),
+        quantile(probe.latency, 0.5), quantile(probe.latency, 0.99),
+        100 * millis(cpu) / millis(wall));
+  }
+}
@@ -0,0 +1,57 @@
+#include "util/SafeSignal.hpp"
+
+#include <glibmm.h>
+
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <string>
+#include <thread>
+
+#include "../utils/fixtures/GlibTestsFixture.hpp"
+
+using namespace waybar;
+
+TEST_CASE_METHOD(GlibTestsFixture, "SafeSignal throughput", "[bench][signal]") {
+  constexpr int EVENTS = 1000;
+
+  SafeSignal<int, std::string> queued;
+  SafeSignal<int, std::string> latest(SignalMode::Latest);
+  int last = 0;
+  queued.connect([&](int value, const std::string&) {
+    if ((last = value) == EVENTS) {
+      quit();
+    }
+  });
+  latest.connect([&](int value, const std::string&) {
+    if ((last = value) == EVENTS) {
+      quit();
+    }
+  });
+
+  // From a worker thread to the main loop, as the modules' threads do
+  auto run_burst = [&](SafeSignal<int, std::string>& signal) {
+    last = 0;
+    std::thread producer;
+    run([&] {
+      producer = std::thread([&] {
+        for (int i = 1; i <= EVENTS; ++i) {
+          signal.emit(i, "workspace");
+        }
+      });
+    });
+    producer.join();
+    return last;
+  };
+
+  BENCHMARK("1000 queued emissions") { return run_burst(queued); };
+  BENCHMARK("1000 latest-only emissions") { return run_burst(latest); };
+  BENCHMARK("main thread emission") {
+    queued.emit(0, "workspace");
+    return last;
+  };
+}
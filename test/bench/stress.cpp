@@ -0,0 +1,331 @@
+#include <glibmm.h>
+#include <spdlog/spdlog.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../hyprland/fixtures/IPCTestFixture.hpp"
+#include "../utils/fixtures/GlibTestsFixture.hpp"
+#include "util/SafeSignal.hpp"
+#include "util/sleeper_thread.hpp"
+
+/* The threading primitives under contention, timed. Run them under ThreadSanitizer too, so that
+ * the races they provoke are reported, eg.
+ *   meson setup build-tsan -Db_sanitize=thread
+ *   TSAN_OPTIONS=suppressions=$PWD/tsan.supp build-tsan/test/bench/waybar_bench "[stress]"
+ */
+
+using namespace waybar;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double micros(Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); }
+
+double perSecond(size_t ops, Clock::duration d) {
+  return static_cast<double>(ops) / std::chrono::duration<double>(d).count();
+}
+
+double quantile(std::vector<double>& values, double q) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::ranges::sort(values);
+  return values[std::min(values.size() - 1, static_cast<size_t>(q * values.size()))];
+}
+
+Clock::rep ticks() { return Clock::now().time_since_epoch().count(); }
+
+Clock::duration since(Clock::rep ticks) {
+  return Clock::now() - Clock::time_point(Clock::duration(ticks));
+}
+
+}  // namespace
+
+/* Every producer numbers its emissions: queued ones must all arrive, in order for each producer,
+ * the latest-only ones may be coalesced but never arrive out of order. Once the producers are
+ * done an end marker is emitted, the last emission, which both modes deliver.
+ */
+TEST_CASE_METHOD(GlibTestsFixture, "SafeSignal under producer contention",
+                 "[bench][stress][signal]") {
+  constexpr int EMISSIONS = 20000;  // per producer
+
+  for (const int producers : {1, 4, 16}) {
+    for (const auto mode : {SignalMode::Queue, SignalMode::Latest}) {
+      const bool queued = mode == SignalMode::Queue;
+      const size_t total = static_cast<size_t>(producers) * EMISSIONS;
+
+      // producer, or -1 for the end marker, number of the emission, emission time
+      SafeSignal<int, int, Clock::rep> signal(mode);
+      std::vector<int> last(producers, 0);
+      std::vector<double> latency;  // us
+      latency.reserve(queued ? total + 1 : 0);
+      size_t delivered = 0;
+      bool ordered = true;
+      signal.connect([&](int producer, int number, Clock::rep emitted) {
+        latency.push_back(micros(since(emitted)));
+        if (producer < 0) {
+          quit();
+          return;
+        }
+        ordered = ordered && (queued ? number == last[producer] + 1 : number > last[producer]);
+        last[producer] = number;
+        ++delivered;
+      });
+
+      bool timed_out = false;
+      auto timeout = Glib::signal_timeout().connect(
+          [&] {
+            timed_out = true;
+            quit();
+            return false;
+          },
+          30000);
+
+      Clock::time_point start;
+      std::thread coordinator;
+      run([&] {
+        start = Clock::now();
+        coordinator = std::thread([&] {
+          std::vector<std::thread> threads;
+          for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&signal, p] {
+              for (int i = 1; i <= EMISSIONS; ++i) {
+                signal.emit(p, i, ticks());
+              }
+            });
+          }
+          for (auto& thread : threads) {
+            thread.join();
+          }
+          signal.emit(-1, 0, ticks());
+        });
+      });
+      const auto wall = Clock::now() - start;
+      coordinator.join();
+      timeout.disconnect();
+
+      CHECK_FALSE(timed_out);
+      CHECK(ordered);
+      if (queued) {
+        CHECK(delivered == total);
+      }
+      spdlog::info(
+          "stress SafeSignal: {} producers, {}: {:.0f} emissions/s, {} of {} delivered, emit to "
+          "handler p50 {:.1f} p99 {:.1f} max {:.1f} us",
+          producers, queued ? "queued" : "latest-only", perSecond(total, wall), delivered, total,
+          quantile(latency, 0.5), quantile(latency, 0.99), quantile(latency, 1));
+    }
+  }
+}
+
+/* Workers started, woken, paused and stopped while other threads keep waking and pausing them.
+ * Half of them sleep between their runs, as the interval modules do, half block on a read that
+ * never comes, as the event ones do: stop() must end both right away.
+ */
+TEST_CASE("SleeperThread start, wake and stop under load", "[bench][stress][sleeper]") {
+  constexpr int CYCLES = 50;
+  constexpr int THREADS = 16;
+  constexpr int WAKERS = 4;
+  constexpr int WAKE_ROUNDS = 200;  // per waker and cycle, over all the threads
+
+  const int never_readable = eventfd(0, EFD_CLOEXEC);
+  REQUIRE(never_readable >= 0);
+  std::atomic<uint64_t> iterations{0};
+  std::atomic<uint64_t> wakes{0};
+  std::vector<double> stop_latency;  // us, from stop() to the end of the thread
+
+  const auto start = Clock::now();
+  for (int cycle = 0; cycle < CYCLES; ++cycle) {
+    std::vector<std::unique_ptr<util::SleeperThread>> threads;
+    for (int i = 0; i < THREADS; ++i) {
+      auto& thread = *threads.emplace_back(std::make_unique<util::SleeperThread>());
+      if (i % 2 == 0) {
+        thread = [&thread, &iterations] {
+          ++iterations;
+          thread.sleep_for(std::chrono::seconds(10));
+        };
+      } else {
+        thread = [&thread, &iterations, never_readable] {
+          ++iterations;
+          thread.waitReadable(never_readable);
+        };
+      }
+    }
+
+    std::vector<std::thread> wakers;
+    for (int w = 0; w < WAKERS; ++w) {
+      wakers.emplace_back([&threads, &wakes, w] {
+        for (int round = 0; round < WAKE_ROUNDS; ++round) {
+          auto& thread = *threads[(round + w) % threads.size()];
+          if (round % 16 == w) {
+            thread.pause(true);
+            thread.pause(false);
+          } else {
+            thread.wake_up();
+          }
+          ++wakes;
+        }
+      });
+    }
+
+    // Stopped while the wakers are still at them
+    for (auto& thread : threads) {
+      const auto stopped = Clock::now();
+      thread->stop();
+      thread->join();
+      stop_latency.push_back(micros(Clock::now() - stopped));
+    }
+    for (auto& waker : wakers) {
+      waker.join();
+    }
+  }
+  const auto wall = Clock::now() - start;
+  close(never_readable);
+
+  // A stop that didn't end the sleep or the read would take seconds
+  CHECK(quantile(stop_latency, 1) < 1e6);
+  spdlog::info(
+      "stress SleeperThread: {:.0f} threads started and stopped/s, {:.0f} wakes/s, {} iterations, "
+      "stop to exit p50 {:.1f} p99 {:.1f} max {:.1f} us",
+      perSecond(CYCLES * THREADS, wall), perSecond(wakes, wall), iterations.load(),
+      quantile(stop_latency, 0.5), quantile(stop_latency, 0.99), quantile(stop_latency, 1));
+}
+
+namespace {
+
+// Checks the order of the numbered events it gets, and times their delivery
+class NumberedHandler : public hyprland::EventHandler {
+ public:
+  void onEvent(const std::string& ev) override {
+    // "workspacev2>>number,emission time"
+    const auto numbers = ev.find(">>") + 2;
+    const auto comma = ev.find(',', numbers);
+    const auto number = std::stoull(ev.substr(numbers, comma - numbers));
+    const auto emitted = std::stoll(ev.substr(comma + 1));
+    std::lock_guard lock(mutex_);
+    latency_.push_back(micros(since(emitted)));
+    ordered_ = ordered_ && number > last_;
+    last_ = number;
+    ++count_;
+    counted_.notify_all();
+  }
+
+  // Waits for count events, for 10s at most, the latencies are only read once they are in
+  bool waitFor(size_t count) {
+    std::unique_lock lock(mutex_);
+    return counted_.wait_for(lock, std::chrono::seconds(10), [&] { return count_ >= count; });
+  }
+
+  bool ordered() {
+    std::lock_guard lock(mutex_);
+    return ordered_;
+  }
+
+  std::vector<double>& latency() { return latency_; }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable counted_;
+  std::vector<double> latency_;  // us
+  uint64_t last_ = 0;
+  bool ordered_ = true;
+  size_t count_ = 0;
+};
+
+// Flags the events it gets after it was unregistered
+class ChurnHandler : public hyprland::EventHandler {
+ public:
+  void onEvent(const std::string&) override {
+    if (unregistered_) {
+      late_.store(true);
+    }
+  }
+
+  void setUnregistered() { unregistered_ = true; }
+  std::atomic<bool>& late() { return late_; }
+
+ private:
+  std::atomic<bool> unregistered_{false};
+  std::atomic<bool> late_{false};
+};
+
+}  // namespace
+
+/* Handlers registered and unregistered over and over while the socket2 thread, played here by a
+ * thread of ours, dispatches events to the ones that stay registered throughout.
+ */
+TEST_CASE_METHOD(IPCTestFixture, "Hyprland IPC registration under dispatch",
+                 "[bench][stress][hyprland]") {
+  constexpr uint64_t DISPATCHES = 50000;
+  constexpr int STABLE = 4;
+  constexpr int CHURNERS = 4;
+
+  std::vector<std::unique_ptr<NumberedHandler>> stable;
+  for (int i = 0; i < STABLE; ++i) {
+    registerForIPC("workspacev2", stable.emplace_back(std::make_unique<NumberedHandler>()).get());
+  }
+
+  std::atomic<bool> dispatching{true};
+  std::atomic<uint64_t> registrations{0};
+  std::atomic<bool> late{false};
+  std::vector<std::thread> churners;
+  const auto start = Clock::now();
+  for (int c = 0; c < CHURNERS; ++c) {
+    churners.emplace_back([&] {
+      while (dispatching) {
+        ChurnHandler handler;
+        registerForIPC("workspacev2", &handler);
+        registerForIPC("activewindowv2", &handler);
+        unregisterForIPC(&handler);
+        handler.setUnregistered();
+        // Events still queued for it must have been dropped
+        std::this_thread::yield();
+        if (handler.late()) {
+          late = true;
+        }
+        ++registrations;
+      }
+    });
+  }
+
+  for (uint64_t i = 1; i <= DISPATCHES; ++i) {
+    parseIPC("workspacev2>>" + std::to_string(i) + "," + std::to_string(ticks()));
+  }
+  const auto dispatched = Clock::now() - start;
+  dispatching = false;
+  for (auto& churner : churners) {
+    churner.join();
+  }
+
+  std::vector<double> latency;
+  for (auto& handler : stable) {
+    CHECK(handler->waitFor(DISPATCHES));
+    CHECK(handler->ordered());
+    latency.insert(latency.end(), handler->latency().begin(), handler->latency().end());
+    unregisterForIPC(handler.get());
+  }
+  const auto wall = Clock::now() - start;
+
+  CHECK_FALSE(late);
+  spdlog::info(
+      "stress hyprland IPC: {:.0f} events dispatched/s to {} handlers, {:.0f} register/unregister "
+      "cycles/s from {} threads, dispatch to onEvent p50 {:.1f} p99 {:.1f} max {:.1f} us",
+      perSecond(DISPATCHES, dispatched), STABLE, perSecond(registrations, wall), CHURNERS,
+      quantile(latency, 0.5), quantile(latency, 0.99), quantile(latency, 1));
+}
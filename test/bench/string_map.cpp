@@ -0,0 +1,44 @@
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/string_map.hpp"
+
+/* The lookups of the workspaces modules on every redraw: an icon by state name, then by the
+ * workspace name, mostly missing. The former std::map against util::StringMap.
+ */
+TEST_CASE("Icon map lookup", "[bench][string_map]") {
+  const std::vector<std::string> names = {"1",       "2",       "3",       "4",      "5",
+                                          "6",       "7",       "8",       "9",      "10",
+                                          "urgent",  "active",  "default", "empty",  "special",
+                                          "visible", "persistent"};
+  std::map<std::string, std::string> tree;
+  waybar::util::StringMap<std::string> hash;
+  for (const auto& name : names) {
+    tree.emplace(name, "icon-" + name);
+    hash.emplace(name, "icon-" + name);
+  }
+  const std::vector<std::string> workspaces = {"1", "3", "chat", "web", "10", "music"};
+
+  auto lookups = [&](const auto& map) {
+    size_t found = 0;
+    for (const auto& workspace : workspaces) {
+      found += map.find("urgent") != map.end();
+      found += map.find("active") != map.end();
+      found += map.find(workspace) != map.end();
+      found += map.find("default") != map.end();
+    }
+    return found;
+  };
+  REQUIRE(lookups(tree) == lookups(hash));
+
+  BENCHMARK("std::map") { return lookups(tree); };
+  BENCHMARK("StringMap") { return lookups(hash); };
+}
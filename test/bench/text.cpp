@@ -0,0 +1,84 @@
+#if __has_include(<catch2/benchmark/catch_benchmark.hpp>)
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <string>
+
+#include "util/regex_collection.hpp"
+#include "util/rewrite_string.hpp"
+#include "util/sanitize_str.hpp"
+#include "util/text_width.hpp"
+
+using namespace waybar::util;
+
+namespace {
+
+// A window-rewrite like config, as the taskbar and workspaces modules get
+Json::Value windowRules() {
+  Json::Value rules;
+  rules["class<firefox>"] = "F";
+  rules["class<kitty|alacritty|foot>"] = "T";
+  rules["title<.*youtube.*>"] = "Y";
+  rules["title<.*github.*>"] = "G";
+  rules["class<.*code.*>"] = "C";
+  rules["class<discord>"] = "D";
+  rules["class<spotify>"] = "S";
+  rules[".*mpv.*"] = "M";
+  return rules;
+}
+
+}  // namespace
+
+TEST_CASE("RegexCollection lookups", "[bench][regex]") {
+  RegexCollection collection(windowRules(), "?");
+
+  BENCHMARK("cached hit") {
+    std::string value = "class<kitty> title<~/src/waybar>";
+    return collection.get(value);
+  };
+
+  size_t n = 0;
+  BENCHMARK("miss") {
+    // Never seen before, so the rules are run
+    std::string value = "class<app" + std::to_string(n++) + "> title<untitled>";
+    return collection.get(value);
+  };
+}
+
+TEST_CASE("Rewrite rules", "[bench][rewrite]") {
+  Json::Value config;
+  config["(.*) - Mozilla Firefox"] = "🌎 $1";
+  config["(.*) - vim"] = " $1";
+  config["(.*) - zsh"] = "> [$1]";
+  const RewriteRules rules(config);
+
+  BENCHMARK("rewriteString") { return rewriteString("Waybar - Mozilla Firefox", config); };
+  BENCHMARK("RewriteRules::apply, memoized") { return rules.apply("Waybar - Mozilla Firefox"); };
+}
+
+TEST_CASE("Text measuring", "[bench][text]") {
+  const std::string ascii = "~/src/waybar - nvim src/modules/hyprland/workspaces.cpp";
+  const std::string wide = "日本語のウィンドウタイトル – 🎵 Ñandú — ﻿zero width";
+
+  BENCHMARK("ascii width") { return textWidth(ascii); };
+  BENCHMARK("utf-8 width") { return textWidth(wide); };
+  BENCHMARK("utf-8 width, uncached") { return measureText(wide).width; };
+  BENCHMARK("utf-8 truncate") { return measureText(wide, 20, 10); };
+}
+
+TEST_CASE("Markup escaping", "[bench][sanitize]") {
+  const std::string plain = "~/src/waybar - nvim src/modules/hyprland/workspaces.cpp";
+  const std::string url = "https://example.com/search?q=a&lang=en&page=2&sort=<date>&utm=\"x\"";
+
+  BENCHMARK("plain title") { return sanitize_string(plain); };
+  BENCHMARK("url") { return sanitize_string(url); };
+
+  std::string markup;
+  while (markup.size() < 4096) {
+    markup += "<span a='1'>&</span>";
+  }
+  BENCHMARK("4 KiB of markup") { return sanitize_string(markup); };
+}
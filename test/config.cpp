@@ -1,5 +1,10 @@
 #include "config.hpp"
 
+#include <stdlib.h>
+
+#include <filesystem>
+#include <fstream>
+
 #if __has_include(<catch2/catch_test_macros.hpp>)
 #include <catch2/catch_test_macros.hpp>
 #else
@@ -32,31 +37,63 @@ TEST_CASE("Load config with multiple bars", "[config]") {
   SECTION("select multiple configs #1") {
     auto data = conf.getOutputConfigs("DP-0", "Fake DisplayPort output #0");
     REQUIRE(data.size() == 4);
-    REQUIRE(data[0]["layer"].asString() == "bottom");
-    REQUIRE(data[0]["height"].asInt() == 20);
-    REQUIRE(data[1]["layer"].asString() == "top");
-    REQUIRE(data[1]["position"].asString() == "bottom");
-    REQUIRE(data[1]["height"].asInt() == 21);
-    REQUIRE(data[2]["layer"].asString() == "overlay");
-    REQUIRE(data[2]["position"].asString() == "right");
-    REQUIRE(data[2]["height"].asInt() == 23);
-    REQUIRE(data[3]["height"].asInt() == 24);
+    REQUIRE((*data[0])["layer"].asString() == "bottom");
+    REQUIRE((*data[0])["height"].asInt() == 20);
+    REQUIRE((*data[1])["layer"].asString() == "top");
+    REQUIRE((*data[1])["position"].asString() == "bottom");
+    REQUIRE((*data[1])["height"].asInt() == 21);
+    REQUIRE((*data[2])["layer"].asString() == "overlay");
+    REQUIRE((*data[2])["position"].asString() == "right");
+    REQUIRE((*data[2])["height"].asInt() == 23);
+    REQUIRE((*data[3])["height"].asInt() == 24);
   }
   SECTION("select multiple configs #2") {
     auto data = conf.getOutputConfigs("HDMI-0", "Fake HDMI output #0");
     REQUIRE(data.size() == 2);
-    REQUIRE(data[0]["layer"].asString() == "bottom");
-    REQUIRE(data[0]["height"].asInt() == 20);
-    REQUIRE(data[1]["layer"].asString() == "overlay");
-    REQUIRE(data[1]["position"].asString() == "right");
-    REQUIRE(data[1]["height"].asInt() == 23);
+    REQUIRE((*data[0])["layer"].asString() == "bottom");
+    REQUIRE((*data[0])["height"].asInt() == 20);
+    REQUIRE((*data[1])["layer"].asString() == "overlay");
+    REQUIRE((*data[1])["position"].asString() == "right");
+    REQUIRE((*data[1])["height"].asInt() == 23);
   }
   SECTION("select single config by output description") {
     auto data = conf.getOutputConfigs("HDMI-1", "Fake HDMI output #1");
     REQUIRE(data.size() == 1);
-    REQUIRE(data[0]["layer"].asString() == "overlay");
-    REQUIRE(data[0]["position"].asString() == "left");
-    REQUIRE(data[0]["height"].asInt() == 22);
+    REQUIRE((*data[0])["layer"].asString() == "overlay");
+    REQUIRE((*data[0])["position"].asString() == "left");
+    REQUIRE((*data[0])["height"].asInt() == 22);
+  }
+}
+
+TEST_CASE("Load several configs", "[config]") {
+  waybar::Config conf;
+  conf.load(std::vector<std::string>{"test/config/simple.json", "test/config/multi.json"});
+
+  SECTION("the bars of each, in order") {
+    auto& data = conf.getConfig();
+    REQUIRE(data.isArray());
+    REQUIRE(data.size() == 6);
+    REQUIRE(data[0]["layer"].asString() == "top");
+    REQUIRE(data[0]["height"].asInt() == 30);
+    REQUIRE(data[1]["layer"].asString() == "bottom");
+    REQUIRE(data[1]["height"].asInt() == 20);
+  }
+  SECTION("select configs of both for the output") {
+    auto data = conf.getOutputConfigs("HDMI-0", "Fake HDMI output #0");
+    REQUIRE(data.size() == 3);
+    REQUIRE((*data[0])["height"].asInt() == 30);
+    REQUIRE((*data[1])["height"].asInt() == 20);
+    REQUIRE((*data[2])["height"].asInt() == 23);
+  }
+  SECTION("every config file is tracked") {
+    REQUIRE(conf.files() ==
+            std::vector<std::string>{"test/config/simple.json", "test/config/multi.json"});
+  }
+  SECTION("a single config stays as it is") {
+    waybar::Config single;
+    single.load(std::vector<std::string>{"test/config/simple.json"});
+    REQUIRE(single.getConfig().isObject());
+    REQUIRE(single.files() == std::vector<std::string>{"test/config/simple.json"});
   }
 }
 
@@ -118,25 +155,25 @@ TEST_CASE("Load multiple bar config with include", "[config]") {
   SECTION("bar config with sole include") {
     auto data = conf.getOutputConfigs("OUT-0", "Fake output #0");
     REQUIRE(data.size() == 1);
-    REQUIRE(data[0]["height"].asInt() == 20);
+    REQUIRE((*data[0])["height"].asInt() == 20);
   }
 
   SECTION("bar config with output and include") {
     auto data = conf.getOutputConfigs("OUT-1", "Fake output #1");
     REQUIRE(data.size() == 1);
-    REQUIRE(data[0]["height"].asInt() == 21);
+    REQUIRE((*data[0])["height"].asInt() == 21);
   }
 
   SECTION("bar config with output override") {
     auto data = conf.getOutputConfigs("OUT-2", "Fake output #2");
     REQUIRE(data.size() == 1);
-    REQUIRE(data[0]["height"].asInt() == 22);
+    REQUIRE((*data[0])["height"].asInt() == 22);
   }
 
   SECTION("multiple levels of include") {
     auto data = conf.getOutputConfigs("OUT-3", "Fake output #3");
     REQUIRE(data.size() == 1);
-    REQUIRE(data[0]["height"].asInt() == 23);
+    REQUIRE((*data[0])["height"].asInt() == 23);
   }
 
   auto& data = conf.getConfig();
@@ -183,3 +220,46 @@ TEST_CASE("Load Hyprland Workspaces bar config", "[config]") {
   REQUIRE(hyprland_window_rewrite["title<Steam>"].asString() == "");
   REQUIRE(hyprland["sort-by"].asString() == "number");
 }
+
+TEST_CASE("Load config from the cache", "[config]") {
+  char dir_template[] = "/tmp/waybar-config-test-XXXXXX";
+  const std::filesystem::path tmp = mkdtemp(dir_template);
+  const auto dir = tmp / "config";
+  const char* old_cache_home = std::getenv("XDG_CACHE_HOME");
+  setenv("XDG_CACHE_HOME", (tmp / "cache").c_str(), 1);
+  std::filesystem::create_directories(dir / "modules");
+  auto write = [&](const std::string& name, const std::string& text) {
+    std::ofstream(dir / name) << text;
+  };
+  write("config", R"({"include": ")" + (dir / "modules").string() + R"(/*.json", "height": 30})");
+  write("modules/cpu.json", R"({"cpu": {"format": "foo"}})");
+
+  waybar::Config conf;
+  conf.load(dir / "config", true);
+  REQUIRE(conf.getConfig()["cpu"]["format"].asString() == "foo");
+  REQUIRE(!std::filesystem::is_empty(tmp / "cache" / "waybar"));
+
+  SECTION("unchanged inputs load the cached config") {
+    waybar::Config cached;
+    cached.load(dir / "config", true);
+    REQUIRE(cached.getConfig() == conf.getConfig());
+  }
+  SECTION("a changed include is read again") {
+    write("modules/cpu.json", R"({"cpu": {"format": "foobar"}})");
+    waybar::Config changed;
+    changed.load(dir / "config", true);
+    REQUIRE(changed.getConfig()["cpu"]["format"].asString() == "foobar");
+  }
+  SECTION("a new file matching a wildcard is included") {
+    write("modules/memory.json", R"({"memory": {"format": "goo"}})");
+    waybar::Config added;
+    added.load(dir / "config", true);
+    REQUIRE(added.getConfig()["memory"]["format"].asString() == "goo");
+  }
+
+  if (old_cache_home)
+    setenv("XDG_CACHE_HOME", old_cache_home, 1);
+  else
+    unsetenv("XDG_CACHE_HOME");
+  std::filesystem::remove_all(tmp);
+}
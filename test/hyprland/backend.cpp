@@ -4,11 +4,52 @@
 #include <catch2/catch.hpp>
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "fixtures/IPCTestFixture.hpp"
 
 namespace fs = std::filesystem;
 namespace hyprland = waybar::modules::hyprland;
 
+namespace {
+
+// Records its events, holding each onEvent call while blocked is set
+class RecordingHandler : public hyprland::EventHandler {
+ public:
+  void onEvent(const std::string& ev) override {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] { return !blocked_; });
+    events_.push_back(ev);
+    cv_.notify_all();
+  }
+
+  void setBlocked(bool blocked) {
+    std::lock_guard lock(mutex_);
+    blocked_ = blocked;
+    cv_.notify_all();
+  }
+
+  // Waits for count events, returns the ones received by then
+  std::vector<std::string> waitForEvents(size_t count) {
+    std::unique_lock lock(mutex_);
+    cv_.wait_for(lock, std::chrono::seconds(5), [&] { return events_.size() >= count; });
+    return events_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool blocked_ = false;
+  std::vector<std::string> events_;
+};
+
+}  // namespace
+
 TEST_CASE_METHOD(IPCTestFixture, "XDGRuntimeDirExists", "[getSocketFolder]") {
   // Test case: XDG_RUNTIME_DIR exists and contains "hypr" directory
   // Arrange
@@ -57,3 +98,67 @@ TEST_CASE_METHOD(IPCTestFixture, "getSocket1Reply throws on no socket", "[getSoc
 
   CHECK_THROWS(getSocket1Reply(request));
 }
+
+TEST_CASE_METHOD(IPCTestFixture, "Events reach each handler in order", "[IPC]") {
+  RecordingHandler handler;
+  registerForIPC("workspace", &handler);
+  registerForIPC("activewindow", &handler);
+
+  parseIPC("workspace>>1");
+  parseIPC("submap>>resize");
+  parseIPC("activewindow>>kitty,~");
+  parseIPC("workspace>>2");
+
+  CHECK(handler.waitForEvents(3) ==
+        std::vector<std::string>{"workspace>>1", "activewindow>>kitty,~", "workspace>>2"});
+  unregisterForIPC(&handler);
+}
+
+TEST_CASE_METHOD(IPCTestFixture, "A blocked handler does not hold up the others", "[IPC]") {
+  RecordingHandler slow;
+  RecordingHandler fast;
+  registerForIPC("workspace", &slow);
+  registerForIPC("workspace", &fast);
+
+  slow.setBlocked(true);
+  parseIPC("workspace>>1");
+  parseIPC("workspace>>2");
+  CHECK(fast.waitForEvents(2) == std::vector<std::string>{"workspace>>1", "workspace>>2"});
+
+  slow.setBlocked(false);
+  CHECK(slow.waitForEvents(2) == std::vector<std::string>{"workspace>>1", "workspace>>2"});
+  unregisterForIPC(&slow);
+  unregisterForIPC(&fast);
+}
+
+TEST_CASE_METHOD(IPCTestFixture, "Unregistered handlers get no more events", "[IPC]") {
+  RecordingHandler handler;
+  registerForIPC("workspace", &handler);
+  parseIPC("workspace>>1");
+  REQUIRE(handler.waitForEvents(1).size() == 1);
+
+  unregisterForIPC(&handler);
+  parseIPC("workspace>>2");
+  CHECK(handler.waitForEvents(1) == std::vector<std::string>{"workspace>>1"});
+}
+
+TEST_CASE_METHOD(IPCTestFixture, "A handler can unregister from its onEvent", "[IPC]") {
+  struct SelfRemoving : hyprland::EventHandler {
+    IPCTestFixture* ipc;
+    std::atomic<int> calls = 0;
+    void onEvent(const std::string&) override {
+      ++calls;
+      ipc->unregisterForIPC(this);
+    }
+  } handler;
+  handler.ipc = this;
+  RecordingHandler after;
+  registerForIPC("workspace", &handler);
+  registerForIPC("workspace", &after);
+
+  parseIPC("workspace>>1");
+  parseIPC("workspace>>2");
+  REQUIRE(after.waitForEvents(2).size() == 2);
+  CHECK(handler.calls == 1);
+  unregisterForIPC(&after);
+}
@@ -0,0 +1,54 @@
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "modules/hyprland/window_ignore_list.hpp"
+#include "util/json.hpp"
+
+namespace hyprland = waybar::modules::hyprland;
+
+namespace {
+
+void load(hyprland::WindowIgnoreList& list, const std::string& patterns) {
+  list.load(waybar::util::JsonParser().parse(patterns));
+}
+
+}  // namespace
+
+TEST_CASE("Windows are ignored when their class or title matches", "[hyprland][ignore]") {
+  hyprland::WindowIgnoreList list;
+  load(list, R"(["kitty", "^.*YouTube.*$", "a|ab"])");
+  REQUIRE_FALSE(list.empty());
+
+  CHECK(list.ignores("kitty", "~"));
+  CHECK(list.ignores("KITTY", "~"));
+  CHECK(list.ignores("firefox", "Music - YouTube"));
+  CHECK(list.ignores("ab", ""));
+  // Patterns match the whole class or title
+  CHECK_FALSE(list.ignores("kitty-launcher", "~"));
+  CHECK_FALSE(list.ignores("firefox", "Waybar"));
+  // Asked again, from the kept results
+  CHECK(list.ignores("kitty", "~"));
+  CHECK_FALSE(list.ignores("firefox", "Waybar"));
+}
+
+TEST_CASE("Ignore patterns with backreferences keep their groups", "[hyprland][ignore]") {
+  hyprland::WindowIgnoreList list;
+  load(list, R"(["(x)\\1", "(y)=\\1"])");
+  CHECK(list.ignores("xx", ""));
+  CHECK(list.ignores("", "y=y"));
+  CHECK_FALSE(list.ignores("y=x", ""));
+}
+
+TEST_CASE("Invalid ignore patterns are left out", "[hyprland][ignore]") {
+  hyprland::WindowIgnoreList list;
+  load(list, R"(["(", "mpv"])");
+  CHECK(list.ignores("mpv", ""));
+  CHECK_FALSE(list.ignores("(", ""));
+
+  load(list, "[]");
+  CHECK(list.empty());
+  CHECK_FALSE(list.ignores("mpv", ""));
+}
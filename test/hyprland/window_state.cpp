@@ -0,0 +1,119 @@
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "modules/hyprland/window_state.hpp"
+#include "util/json.hpp"
+
+namespace hyprland = waybar::modules::hyprland;
+
+namespace {
+
+// Two monitors, the kitty and firefox windows on workspace 1 of DP-1, mpv alone on 3 of HDMI-A-1
+hyprland::WindowState loadedState() {
+  waybar::util::JsonParser parser;
+  const auto monitors = parser.parse(R"([
+    {"name": "DP-1", "focused": true, "activeWorkspace": {"id": 1, "name": "1"}},
+    {"name": "HDMI-A-1", "focused": false, "activeWorkspace": {"id": 3, "name": "3"}}
+  ])");
+  const auto workspaces = parser.parse(R"([
+    {"id": 1, "name": "1", "monitor": "DP-1", "windows": 2, "hasfullscreen": false,
+     "lastwindow": "0xa1", "lastwindowtitle": "~"},
+    {"id": 2, "name": "2", "monitor": "DP-1", "windows": 0, "hasfullscreen": false,
+     "lastwindow": "0x0", "lastwindowtitle": ""},
+    {"id": 3, "name": "3", "monitor": "HDMI-A-1", "windows": 1, "hasfullscreen": false,
+     "lastwindow": "0xc3", "lastwindowtitle": "video.mkv"}
+  ])");
+  const auto clients = parser.parse(R"([
+    {"address": "0xa1", "mapped": true, "hidden": false, "workspace": {"id": 1, "name": "1"},
+     "floating": false, "monitor": 0, "class": "kitty", "title": "~", "initialClass": "kitty",
+     "initialTitle": "kitty", "fullscreen": 0, "grouped": [], "swallowing": "0x0",
+     "focusHistoryID": 0},
+    {"address": "0xb2", "mapped": true, "hidden": false, "workspace": {"id": 1, "name": "1"},
+     "floating": true, "monitor": 0, "class": "firefox", "title": "Waybar", "initialClass":
+     "firefox", "initialTitle": "Mozilla Firefox", "fullscreen": 0, "grouped": [],
+     "swallowing": "0x0", "focusHistoryID": 1},
+    {"address": "0xc3", "mapped": true, "hidden": false, "workspace": {"id": 3, "name": "3"},
+     "floating": false, "monitor": 1, "class": "mpv", "title": "video.mkv", "initialClass": "mpv",
+     "initialTitle": "mpv", "fullscreen": 0, "grouped": [], "swallowing": "0x0",
+     "focusHistoryID": 2}
+  ])");
+  hyprland::WindowState state;
+  state.load(monitors, workspaces, clients);
+  return state;
+}
+
+}  // namespace
+
+TEST_CASE("WindowState loads the replies", "[hyprland][window_state]") {
+  hyprland::WindowState state;
+  REQUIRE(state.stale());
+  state = loadedState();
+  REQUIRE_FALSE(state.stale());
+
+  const auto* focused = state.activeWorkspace("");
+  REQUIRE(focused != nullptr);
+  REQUIRE(focused->id == 1);
+  REQUIRE(focused->windows == 2);
+  REQUIRE(focused->last_window == "0xa1");
+  REQUIRE(state.activeWorkspace("HDMI-A-1")->id == 3);
+  REQUIRE(state.activeWorkspace("eDP-1") == nullptr);
+
+  REQUIRE(state.clientsOn(1).size() == 2);
+  REQUIRE(state.client("0xb2")->floating);
+  REQUIRE(state.client("0xb2")->initial_title == "Mozilla Firefox");
+}
+
+TEST_CASE("WindowState follows focus, titles and flags", "[hyprland][window_state]") {
+  auto state = loadedState();
+
+  state.apply("activewindowv2>>b2");
+  REQUIRE(state.activeWorkspace("")->last_window == "0xb2");
+  REQUIRE(state.activeWorkspace("")->last_window_title == "Waybar");
+
+  state.apply("windowtitlev2>>b2,Waybar, the manual");
+  REQUIRE(state.client("0xb2")->title == "Waybar, the manual");
+  REQUIRE(state.activeWorkspace("")->last_window_title == "Waybar, the manual");
+
+  state.apply("changefloatingmode>>b2,0");
+  REQUIRE_FALSE(state.client("0xb2")->floating);
+
+  state.apply("fullscreen>>1");
+  REQUIRE(state.client("0xb2")->fullscreen);
+  REQUIRE(state.activeWorkspace("")->has_fullscreen);
+
+  state.apply("workspacev2>>2,2");
+  REQUIRE(state.activeWorkspace("")->id == 2);
+
+  state.apply("focusedmonv2>>HDMI-A-1,3");
+  REQUIRE(state.activeWorkspace("")->id == 3);
+  REQUIRE(state.activeWorkspace("DP-1")->id == 2);
+
+  state.apply("activewindowv2>>");
+  REQUIRE_FALSE(state.stale());
+}
+
+TEST_CASE("WindowState reloads after the events it can't follow", "[hyprland][window_state]") {
+  auto state = loadedState();
+  state.apply("openwindow>>d4,1,foot,foot");
+  REQUIRE(state.stale());
+
+  state = loadedState();
+  state.apply("closewindow>>a1");
+  REQUIRE(state.stale());
+
+  // A window or workspace it doesn't know of
+  state = loadedState();
+  state.apply("activewindowv2>>ff");
+  REQUIRE(state.stale());
+  state = loadedState();
+  state.apply("workspacev2>>7,7");
+  REQUIRE(state.stale());
+
+  // Before Hyprland sent a windowtitlev2, the title has to be queried
+  state = loadedState();
+  state.apply("windowtitle>>a1");
+  REQUIRE(state.stale());
+}
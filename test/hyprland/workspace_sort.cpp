@@ -0,0 +1,89 @@
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "modules/hyprland/workspace_sort.hpp"
+
+namespace hyprland = waybar::modules::hyprland;
+
+namespace {
+
+struct Workspace {
+  int id;
+  std::string name;
+  bool special = false;
+};
+
+template <typename Less>
+std::vector<std::string> sortedNames(const std::vector<Workspace>& workspaces, Less less) {
+  std::vector<hyprland::WorkspaceSortKey> keys;
+  for (const auto& workspace : workspaces) {
+    keys.push_back(hyprland::workspaceSortKey(workspace.id, workspace.name, workspace.special));
+  }
+  std::ranges::sort(keys, less);
+  std::vector<std::string> names;
+  for (const auto& key : keys) {
+    names.emplace_back(key.name);
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST_CASE("Workspace names are read as numbers like std::stoi does", "[hyprland][sort]") {
+  CHECK(hyprland::workspaceSortKey(1, "12", false).number == 12);
+  CHECK(hyprland::workspaceSortKey(1, " -3", false).number == -3);
+  CHECK(hyprland::workspaceSortKey(1, "+4", false).number == 4);
+  CHECK(hyprland::workspaceSortKey(1, "7:web", false).number == 7);
+  CHECK_FALSE(hyprland::workspaceSortKey(-1337, "web", false).number);
+  CHECK_FALSE(hyprland::workspaceSortKey(1, "+-4", false).number);
+  CHECK_FALSE(hyprland::workspaceSortKey(1, "", false).number);
+}
+
+TEST_CASE("Workspaces sort by number, falling back to their names", "[hyprland][sort]") {
+  const std::vector<Workspace> workspaces{{10, "10"}, {2, "2"}, {3, "3"}};
+  CHECK(sortedNames(workspaces, hyprland::numberLess) == std::vector<std::string>{"2", "3", "10"});
+  CHECK(sortedNames(workspaces, hyprland::nameLess) == std::vector<std::string>{"10", "2", "3"});
+
+  auto web = hyprland::workspaceSortKey(-1337, "web", false);
+  auto ten = hyprland::workspaceSortKey(10, "10", false);
+  CHECK(hyprland::numberLess(ten, web));
+  CHECK_FALSE(hyprland::numberLess(web, ten));
+}
+
+TEST_CASE("Workspaces sort normal, named, then special by default", "[hyprland][sort]") {
+  const std::vector<Workspace> workspaces{{-99, "special", true},
+                                          {-98, "special:b", true},
+                                          {-1337, "web", false},
+                                          {3, "3", false},
+                                          {-97, "special:a", true},
+                                          {1, "1", false},
+                                          {-1338, "chat", false}};
+  CHECK(sortedNames(workspaces, hyprland::defaultLess) ==
+        std::vector<std::string>{"1", "3", "chat", "web", "special:a", "special:b", "special"});
+}
+
+TEST_CASE("Workspace sort inputs tell whether a sort would change anything", "[hyprland][sort]") {
+  hyprland::WorkspaceSortInputs inputs;
+  int a = 0;
+  int b = 0;
+  std::vector<hyprland::WorkspaceSortInputs::Entry> entries{{&a, 1, false, true, "1"},
+                                                            {&b, 2, false, true, "2"}};
+  CHECK(inputs.changed(entries));
+
+  inputs.record(entries);
+  CHECK_FALSE(inputs.changed(entries));
+
+  entries[1].name = "renamed";
+  CHECK(inputs.changed(entries));
+  inputs.record(entries);
+
+  inputs.invalidate();
+  CHECK(inputs.changed(entries));
+}
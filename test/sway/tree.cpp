@@ -0,0 +1,95 @@
+#include "modules/sway/ipc/tree.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <stdexcept>
+
+using waybar::modules::sway::indexTree;
+using waybar::modules::sway::parseTree;
+
+TEST_CASE("Keep the node fields the modules read", "[sway]") {
+  const auto tree = parseTree(R"({
+    "id": 1, "type": "root", "rect": {"x": 0, "y": 0, "width": 1920, "height": 1080},
+    "nodes": [{
+      "id": 3, "type": "output", "name": "DP-1", "current_workspace": "1", "percent": 1.0,
+      "nodes": [{
+        "id": 4, "type": "workspace", "name": "1", "num": 1, "output": "DP-1",
+        "focused": false, "visible": true, "urgent": false, "layout": "splith",
+        "floating_nodes": [],
+        "nodes": [{
+          "id": 7, "type": "con", "name": "foot", "app_id": "foot", "shell": "xdg_shell",
+          "focused": true, "marks": ["_hidden", "a"], "pid": 1234,
+          "idle_inhibitors": {"user": "none", "application": "none"},
+          "window_properties": {"class": "Foot", "instance": "foot", "title": "foot"},
+          "nodes": [], "floating_nodes": []
+        }]
+      }]
+    }]
+  })");
+
+  REQUIRE(tree["type"].asString() == "root");
+  REQUIRE_FALSE(tree.isMember("rect"));
+
+  const auto& output = tree["nodes"][0];
+  REQUIRE(output["current_workspace"].asString() == "1");
+  REQUIRE_FALSE(output.isMember("percent"));
+
+  const auto& workspace = output["nodes"][0];
+  REQUIRE(workspace["num"].asInt() == 1);
+  REQUIRE(workspace["visible"].asBool());
+  REQUIRE(workspace["floating_nodes"].isArray());
+
+  const auto& window = workspace["nodes"][0];
+  REQUIRE(window["id"].asInt() == 7);
+  REQUIRE(window["focused"].asBool());
+  REQUIRE(window["marks"].size() == 2);
+  REQUIRE(window["window_properties"]["class"].asString() == "Foot");
+  REQUIRE_FALSE(window["window_properties"].isMember("title"));
+  REQUIRE_FALSE(window.isMember("idle_inhibitors"));
+}
+
+TEST_CASE("Decode escapes in kept strings", "[sway]") {
+  const auto tree = parseTree(R"({"name": "a\"b\\cé😊\xab"})");
+  // "\xab" is read as "«", the same as JsonParser does
+  REQUIRE(tree["name"].asString() == "a\"b\\cé\U0001F60A«");
+}
+
+TEST_CASE("Reject malformed trees", "[sway]") {
+  REQUIRE_THROWS_AS(parseTree(R"({"nodes": [})"), std::runtime_error);
+  REQUIRE_THROWS_AS(parseTree(R"({"name": "unterminated)"), std::runtime_error);
+  REQUIRE_THROWS_AS(parseTree(R"({"rect": {"x": 1})"), std::runtime_error);
+}
+
+TEST_CASE("Index the scratchpad and the focused node", "[sway]") {
+  const auto tree = parseTree(R"({
+    "id": 1, "type": "root", "nodes": [{
+      "id": 2, "type": "output", "name": "__i3", "nodes": [{
+        "id": 5, "type": "workspace", "name": "__i3_scratch", "nodes": [],
+        "floating_nodes": [{"id": 9, "type": "floating_con", "name": "notes", "focused": false}]
+      }]
+    }, {
+      "id": 3, "type": "output", "name": "DP-1", "current_workspace": "1", "nodes": [{
+        "id": 4, "type": "workspace", "name": "1", "focused": false, "floating_nodes": [],
+        "nodes": [{"id": 6, "type": "con", "name": "", "focused": false, "nodes": [
+          {"id": 7, "type": "con", "name": "foot", "focused": true, "nodes": []}
+        ]}]
+      }]
+    }]
+  })");
+
+  const auto index = indexTree(tree);
+  REQUIRE(index.scratchpad != nullptr);
+  REQUIRE((*index.scratchpad)["floating_nodes"].size() == 1);
+  REQUIRE(index.focused != nullptr);
+  REQUIRE((*index.focused)["id"].asInt() == 7);
+  REQUIRE((*index.focused_workspace)["id"].asInt() == 4);
+  REQUIRE(index.focused_output == "DP-1");
+
+  const auto empty = indexTree(parseTree(R"({"type": "root", "nodes": []})"));
+  REQUIRE(empty.scratchpad == nullptr);
+  REQUIRE(empty.focused == nullptr);
+}
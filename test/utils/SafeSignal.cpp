@@ -141,3 +141,40 @@ TEST_CASE_METHOD(GlibTestsFixture, "SafeSignal copy/move counter", "[signal][thr
   producer.join();
   REQUIRE(count == NUM_EVENTS);
 }
+
+/*
+ * In SignalMode::Latest, a burst of emissions is coalesced: values may be skipped, but they are
+ * never delivered out of order and the last one always arrives
+ */
+TEST_CASE_METHOD(GlibTestsFixture, "SafeSignal latest value mode", "[signal][thread][util]") {
+  const int NUM_EVENTS = 100;
+  int count = 0;
+  int last_value = 0;
+
+  SafeSignal<int> test_signal{SignalMode::Latest};
+
+  std::thread producer;
+
+  // timeout the test in 500ms
+  setTimeout(500);
+
+  test_signal.connect([&](int val) {
+    REQUIRE(val > last_value);
+    last_value = val;
+    ++count;
+    if (val == NUM_EVENTS) {
+      this->quit();
+    }
+  });
+
+  run([&]() {
+    producer = std::thread([&]() {
+      for (auto i = 1; i <= NUM_EVENTS; ++i) {
+        test_signal.emit(i);
+      }
+    });
+  });
+  producer.join();
+  REQUIRE(last_value == NUM_EVENTS);
+  REQUIRE(count <= NUM_EVENTS);
+}
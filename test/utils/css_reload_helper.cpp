@@ -98,3 +98,33 @@ TEST_CASE_METHOD(CssReloadHelperTest, "parse_imports", "[util][css_reload_helper
     REQUIRE(files.empty());
   }
 }
+
+TEST_CASE_METHOD(CssReloadHelperTest, "contents_changed", "[util][css_reload_helper]") {
+  setFileContents("/tmp/waybar_test.css", "@import 'test.css';");
+  setFileContents("test.css", "body { color: red; }");
+  auto files = parseImports("/tmp/waybar_test.css");
+  REQUIRE(files.size() == 2);
+  REQUIRE(contentsChanged(files));
+
+  SECTION("same bytes written back") {
+    files = parseImports("/tmp/waybar_test.css");
+    CHECK_FALSE(contentsChanged(files));
+  }
+
+  SECTION("imported file changed") {
+    setFileContents("test.css", "body { color: blue; }");
+    files = parseImports("/tmp/waybar_test.css");
+    CHECK(contentsChanged(files));
+    CHECK_FALSE(contentsChanged(files));
+  }
+
+  SECTION("import added") {
+    setFileContents("test.css", "@import 'test2.css';");
+    setFileContents("test2.css", "body { color: blue; }");
+    files = parseImports("/tmp/waybar_test.css");
+    std::sort(files.begin(), files.end());
+    REQUIRE(files.size() == 3);
+    CHECK(files[2] == "test2.css");
+    CHECK(contentsChanged(files));
+  }
+}
@@ -0,0 +1,37 @@
+#include "util/format_fields.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+using waybar::util::FormatFields;
+
+TEST_CASE("Named placeholders", "[format_fields]") {
+  FormatFields fields("{essid} ({signalStrength}%) {icon:>3}");
+  REQUIRE(fields.uses("essid"));
+  REQUIRE(fields.uses("signalStrength"));
+  REQUIRE(fields.uses("icon"));
+  REQUIRE_FALSE(fields.uses("bandwidthDownBits"));
+  REQUIRE_FALSE(fields.uses("ess"));
+}
+
+TEST_CASE("Escaped braces aren't placeholders", "[format_fields]") {
+  FormatFields fields("{{icon}} {{{text}}}");
+  REQUIRE_FALSE(fields.uses("icon"));
+  REQUIRE(fields.uses("text"));
+}
+
+TEST_CASE("Placeholders nested in specs", "[format_fields]") {
+  FormatFields fields("{text:>{width}}");
+  REQUIRE(fields.uses("text"));
+  REQUIRE(fields.uses("width"));
+  REQUIRE_FALSE(fields.uses("icon"));
+}
+
+TEST_CASE("Positional placeholders use everything", "[format_fields]") {
+  REQUIRE(FormatFields("{}%").uses("icon"));
+  REQUIRE(FormatFields("{0} {text}").uses("icon"));
+  REQUIRE_FALSE(FormatFields("").uses("icon"));
+}
@@ -0,0 +1,78 @@
+#include "util/power_supply.hpp"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A /sys/class/power_supply of its own, removed with the fixture
+class PowerSupplies {
+ public:
+  PowerSupplies()
+      : root_(fs::temp_directory_path() / ("waybar_power_supply_" + std::to_string(getpid()))) {
+    fs::remove_all(root_);
+    fs::create_directories(root_);
+  }
+  ~PowerSupplies() { fs::remove_all(root_); }
+
+  void add(const std::string& name,
+           std::initializer_list<std::pair<const char*, const char*>> attributes) {
+    fs::create_directories(root_ / name);
+    for (const auto& [attribute, value] : attributes) {
+      std::ofstream(root_ / name / attribute) << value << '\n';
+    }
+  }
+
+  const fs::path& root() const { return root_; }
+
+ private:
+  fs::path root_;
+};
+
+}  // namespace
+
+TEST_CASE("On battery power", "[util][power_supply]") {
+  PowerSupplies supplies;
+
+  SECTION("no power supply") { CHECK_FALSE(waybar::util::onBatteryPower(supplies.root())); }
+
+  SECTION("no directory") {
+    CHECK_FALSE(waybar::util::onBatteryPower(supplies.root() / "missing"));
+  }
+
+  SECTION("desktop with a wireless mouse") {
+    supplies.add("hidpp_battery_0", {{"type", "Battery"}, {"scope", "Device"}});
+    CHECK_FALSE(waybar::util::onBatteryPower(supplies.root()));
+  }
+
+  SECTION("laptop on mains") {
+    supplies.add("BAT0", {{"type", "Battery"}});
+    supplies.add("AC", {{"type", "Mains"}, {"online", "1"}});
+    CHECK_FALSE(waybar::util::onBatteryPower(supplies.root()));
+  }
+
+  SECTION("laptop charging over USB") {
+    supplies.add("BAT0", {{"type", "Battery"}});
+    supplies.add("AC", {{"type", "Mains"}, {"online", "0"}});
+    supplies.add("ucsi-source-psy-USBC000:001", {{"type", "USB"}, {"online", "1"}});
+    CHECK_FALSE(waybar::util::onBatteryPower(supplies.root()));
+  }
+
+  SECTION("laptop unplugged") {
+    supplies.add("BAT0", {{"type", "Battery"}});
+    supplies.add("AC", {{"type", "Mains"}, {"online", "0"}});
+    CHECK(waybar::util::onBatteryPower(supplies.root()));
+  }
+}
@@ -0,0 +1,133 @@
+#include "util/regex_collection.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <algorithm>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+using waybar::util::RegexCollection;
+
+namespace {
+
+// RegexCollection::get, which takes a mutable string
+std::string get(RegexCollection& collection, std::string value) { return collection.get(value); }
+
+Json::Value rulesOf(const std::map<std::string, std::string>& rules) {
+  Json::Value map(Json::objectValue);
+  for (const auto& [key, repr] : rules) {
+    map[key] = repr;
+  }
+  return map;
+}
+
+}  // namespace
+
+TEST_CASE("Optional atoms aren't required by the prefilter", "[regex_collection]") {
+  const auto rules = rulesOf({
+      {"colou?r", "question mark"},
+      {"ab*c", "star"},
+      {"x{0,}yz", "braces"},
+      {"lazy.*?end", "lazy"},
+  });
+  RegexCollection collection(rules, "none");
+  REQUIRE(get(collection, "color") == "question mark");
+  REQUIRE(get(collection, "colour") == "question mark");
+  REQUIRE(get(collection, "ac") == "star");
+  REQUIRE(get(collection, "abbbc") == "star");
+  REQUIRE(get(collection, "yz") == "braces");
+  REQUIRE(get(collection, "xxyz") == "braces");
+  REQUIRE(get(collection, "lazyend") == "lazy");
+  REQUIRE(get(collection, "colr") == "none");
+}
+
+TEST_CASE("Groups and alternation", "[regex_collection]") {
+  const auto rules = rulesOf({
+      {"fire(fox)?", "group"},
+      {"(web)?kit(ty)*", "groups"},
+      {"chrom(e|ium)", "nested alternation"},
+      {"^vim$|^nvim$", "alternation"},
+  });
+  RegexCollection collection(rules, "none");
+  REQUIRE(get(collection, "fire") == "group");
+  REQUIRE(get(collection, "Firefox") == "group");
+  REQUIRE(get(collection, "kit") == "groups");
+  REQUIRE(get(collection, "webkittyty") == "groups");
+  REQUIRE(get(collection, "chromium") == "nested alternation");
+  REQUIRE(get(collection, "CHROME") == "nested alternation");
+  REQUIRE(get(collection, "vim") == "alternation");
+  REQUIRE(get(collection, "nvim") == "alternation");
+  REQUIRE(get(collection, "chrom") == "none");
+}
+
+TEST_CASE("Escapes", "[regex_collection]") {
+  const auto rules = rulesOf({
+      {"\\.desktop$", "punctuation"},
+      {"\\d+ files", "class"},
+      {"a\\.?b", "optional escape"},
+      {"\\(1\\)", "parentheses"},
+      {"[xy]\\]z", "in class"},
+  });
+  RegexCollection collection(rules, "none");
+  REQUIRE(get(collection, "org.app.desktop") == "punctuation");
+  REQUIRE(get(collection, "orgdesktop") == "none");
+  REQUIRE(get(collection, "12 files") == "class");
+  REQUIRE(get(collection, "ab") == "optional escape");
+  REQUIRE(get(collection, "a.b") == "optional escape");
+  REQUIRE(get(collection, "copy (1)") == "parentheses");
+  REQUIRE(get(collection, "x]z") == "in class");
+}
+
+TEST_CASE("The prefilter picks the rule the regexes alone would", "[regex_collection]") {
+  const std::map<std::string, std::string> rules = {
+      {"term", "$0"},         {"terminal", "full"},  {"(kitty|alacritty)", "gpu"},
+      {"fire(fox)?", "ff"},   {"fo+t", "foot"},      {"^foot$", "exact"},
+      {"\\[(\\d+)\\]", "$1"}, {"n?vim", "vi"},       {"code|codium", "vscode"},
+      {"x{0,}term", "xterm"}, {"web(kit)?", "web"},  {".*", "any"},
+  };
+  // Distinct priorities in an order of their own, so that most strings match several rules
+  std::map<std::string, int> priorities;
+  int next = 0;
+  for (const auto& key : {"^foot$", "terminal", "x{0,}term", "term", "fo+t", "web(kit)?",
+                          "fire(fox)?", "(kitty|alacritty)", "n?vim", "code|codium",
+                          "\\[(\\d+)\\]", ".*"}) {
+    priorities[key] = 100 - next++;
+  }
+  RegexCollection collection(rulesOf(rules), "default",
+                             [&priorities](std::string& key) { return priorities.at(key); });
+
+  // Every rule in priority order, none skipped
+  std::vector<std::pair<std::regex, std::string>> reference;
+  std::vector<std::string> keys;
+  for (const auto& [key, repr] : rules) {
+    keys.push_back(key);
+  }
+  std::ranges::sort(keys, [&priorities](const auto& a, const auto& b) {
+    return priorities.at(a) > priorities.at(b);
+  });
+  for (const auto& key : keys) {
+    reference.emplace_back(std::regex(key, std::regex_constants::icase), rules.at(key));
+  }
+
+  for (const std::string value :
+       {"foot", "Foot", "fooot", "xterm", "XTerm", "gnome-terminal", "term", "firefox", "fire",
+        "kitty", "Alacritty", "vim", "nvim", "vi", "code", "VSCodium", "[42]", "webkit", "web",
+        "", "unrelated", "foot [3]"}) {
+    std::string expected = "default";
+    for (const auto& [regex, repr] : reference) {
+      std::smatch match;
+      if (std::regex_search(value, match, regex)) {
+        expected = match.format(repr);
+        break;
+      }
+    }
+    INFO(value);
+    REQUIRE(get(collection, value) == expected);
+  }
+}
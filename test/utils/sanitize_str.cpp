@@ -0,0 +1,28 @@
+#include "util/sanitize_str.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+using waybar::util::sanitize_string;
+
+TEST_CASE("sanitize_string leaves plain text as it is", "[sanitize_string]") {
+  REQUIRE(sanitize_string("").empty());
+  REQUIRE(sanitize_string("a") == "a");
+  REQUIRE(sanitize_string("Firefox - Mozilla Firefox") == "Firefox - Mozilla Firefox");
+  REQUIRE(sanitize_string("Ünïcödé ✓ títle") == "Ünïcödé ✓ títle");
+}
+
+TEST_CASE("sanitize_string escapes the markup characters", "[sanitize_string]") {
+  REQUIRE(sanitize_string("&") == "&amp;");
+  REQUIRE(sanitize_string("<b>'x' & \"y\"</b>") ==
+          "&lt;b&gt;&apos;x&apos; &amp; &quot;y&quot;&lt;/b&gt;");
+  // Entities are escaped again, not kept
+  REQUIRE(sanitize_string("&amp;") == "&amp;amp;");
+  // In the word scanned part, the tail, and across both
+  REQUIRE(sanitize_string("0123456&89abcdef<") == "0123456&amp;89abcdef&lt;");
+  REQUIRE(sanitize_string("https://example.com/?a=1&b=2&c=3") ==
+          "https://example.com/?a=1&amp;b=2&amp;c=3");
+}
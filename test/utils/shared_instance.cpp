@@ -0,0 +1,43 @@
+#include "util/shared_instance.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <string>
+
+using waybar::util::SharedInstance;
+using waybar::util::SharedInstances;
+
+TEST_CASE("One instance while it is held", "[shared_instance]") {
+  SharedInstance<int> shared;
+  int made = 0;
+  auto make = [&made] { return std::make_shared<int>(++made); };
+
+  auto first = shared.get(make);
+  auto second = shared.get(make);
+  REQUIRE(first == second);
+  REQUIRE(made == 1);
+
+  first.reset();
+  second.reset();
+  REQUIRE(*shared.get(make) == 2);
+}
+
+TEST_CASE("Keys of the instances gone are dropped", "[shared_instance]") {
+  SharedInstances<std::string, int> shared;
+  auto kept = shared.get("kept", [] { return std::make_shared<int>(1); });
+  for (int i = 0; i < 100; ++i) {
+    // e.g. a config reload after another
+    shared.get("reload " + std::to_string(i), [i] { return std::make_shared<int>(i); });
+  }
+  REQUIRE(shared.size() <= 2);
+  REQUIRE(shared.get("kept", [] { return std::make_shared<int>(2); }) == kept);
+
+  int alive = 0;
+  shared.forEach([&alive](const auto& value) { alive += *value; });
+  REQUIRE(alive == 1);
+  REQUIRE(shared.size() == 1);
+}
@@ -0,0 +1,119 @@
+#include "util/state_protocol.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <json/reader.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using waybar::util::StateProtocol;
+
+namespace {
+
+Json::Value stateOf(const std::string& module, const std::string& output,
+                    const std::string& text) {
+  Json::Value state(Json::objectValue);
+  state["module"] = module;
+  state["output"] = output;
+  state["text"] = text;
+  return state;
+}
+
+// The JSON objects of the lines of text, failing on anything else
+std::vector<Json::Value> parseLines(const std::string& text) {
+  std::vector<Json::Value> values;
+  std::istringstream lines(text);
+  Json::CharReaderBuilder reader;
+  for (std::string line; std::getline(lines, line);) {
+    Json::Value value;
+    std::string errors;
+    std::istringstream in(line);
+    REQUIRE(Json::parseFromStream(reader, in, &value, &errors));
+    values.push_back(value);
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST_CASE("Requests", "[state_protocol]") {
+  REQUIRE(StateProtocol::parseRequest("get") == StateProtocol::Request::GET);
+  REQUIRE(StateProtocol::parseRequest("subscribe") == StateProtocol::Request::SUBSCRIBE);
+  REQUIRE_FALSE(StateProtocol::parseRequest(""));
+  REQUIRE_FALSE(StateProtocol::parseRequest("GET"));
+  REQUIRE_FALSE(StateProtocol::parseRequest(" get"));
+  REQUIRE_FALSE(StateProtocol::parseRequest("subscribed"));
+}
+
+TEST_CASE("Lines are taken once complete", "[state_protocol]") {
+  std::string in = "ge";
+  REQUIRE_FALSE(StateProtocol::nextLine(in));
+  REQUIRE(in == "ge");
+
+  in += "t\nsubscribe\nsu";
+  REQUIRE(StateProtocol::nextLine(in) == "get");
+  REQUIRE(StateProtocol::nextLine(in) == "subscribe");
+  REQUIRE_FALSE(StateProtocol::nextLine(in));
+  REQUIRE(in == "su");
+
+  in = "\n";
+  REQUIRE(StateProtocol::nextLine(in) == "");
+  REQUIRE(in.empty());
+}
+
+TEST_CASE("Answers", "[state_protocol]") {
+  StateProtocol protocol;
+  REQUIRE(protocol.answer(StateProtocol::Request::GET).empty());
+
+  protocol.update("DP-1/clock", stateOf("clock", "DP-1", "12:00"));
+  protocol.update("HDMI-A-1/clock", stateOf("clock", "HDMI-A-1", "12:00"));
+
+  for (auto request : {StateProtocol::Request::GET, StateProtocol::Request::SUBSCRIBE}) {
+    auto states = parseLines(protocol.answer(request));
+    REQUIRE(states.size() == 2);
+    REQUIRE(states[0] == stateOf("clock", "DP-1", "12:00"));
+    REQUIRE(states[1] == stateOf("clock", "HDMI-A-1", "12:00"));
+  }
+
+  auto error = parseLines(protocol.answer(std::nullopt));
+  REQUIRE(error.size() == 1);
+  REQUIRE(error[0].isMember("error"));
+}
+
+TEST_CASE("Only changes are sent", "[state_protocol]") {
+  StateProtocol protocol;
+  const auto* sent = protocol.update("DP-1/clock", stateOf("clock", "DP-1", "12:00"));
+  REQUIRE(sent != nullptr);
+  REQUIRE(parseLines(protocol.line(*sent)) ==
+          std::vector<Json::Value>{stateOf("clock", "DP-1", "12:00")});
+
+  REQUIRE(protocol.update("DP-1/clock", stateOf("clock", "DP-1", "12:00")) == nullptr);
+  REQUIRE(protocol.update("DP-1/clock", stateOf("clock", "DP-1", "12:01")) != nullptr);
+  REQUIRE(protocol.size() == 1);
+}
+
+TEST_CASE("Modules that are gone are forgotten", "[state_protocol]") {
+  StateProtocol protocol;
+  REQUIRE_FALSE(protocol.forget("DP-1/clock"));
+
+  protocol.update("DP-1/clock", stateOf("clock", "DP-1", "12:00"));
+  protocol.update("DP-1/battery", stateOf("battery", "DP-1", "80%"));
+  auto removed = protocol.forget("DP-1/clock");
+  REQUIRE(removed);
+  REQUIRE((*removed)["module"] == "clock");
+  REQUIRE((*removed)["output"] == "DP-1");
+  REQUIRE((*removed)["removed"] == true);
+  REQUIRE_FALSE(removed->isMember("text"));
+
+  REQUIRE(protocol.size() == 1);
+  auto states = parseLines(protocol.answer(StateProtocol::Request::GET));
+  REQUIRE(states.size() == 1);
+  REQUIRE(states[0]["module"] == "battery");
+  REQUIRE_FALSE(protocol.forget("DP-1/clock"));
+}
@@ -0,0 +1,74 @@
+#include "util/text_width.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+using waybar::util::columnCount;
+using waybar::util::isAscii;
+using waybar::util::measureText;
+using waybar::util::textWidth;
+
+constexpr auto npos = std::string::npos;
+
+TEST_CASE("ASCII detection", "[text_width]") {
+  REQUIRE(isAscii(""));
+  REQUIRE(isAscii("a long enough line of plain text"));
+  REQUIRE_FALSE(isAscii("a long enough line of plain text…"));
+  REQUIRE_FALSE(isAscii("été"));
+}
+
+TEST_CASE("Width of text", "[text_width]") {
+  REQUIRE(textWidth("") == 0);
+  REQUIRE(textWidth("Artist") == 6);
+  REQUIRE(textWidth("…") == 1);
+  REQUIRE(textWidth("日本") == 4);             // wide characters
+  REQUIRE(textWidth("e\u0301t\u00ad") == 2);  // combining accent and soft hyphen
+  REQUIRE(textWidth("bad\xff") == 4);          // invalid UTF-8 counts bytes
+  // the second time from the cache
+  REQUIRE(textWidth("日本") == 4);
+  REQUIRE(textWidth("日本語") == 6);
+}
+
+TEST_CASE("Columns of text", "[text_width]") {
+  REQUIRE(columnCount("") == 0);
+  REQUIRE(columnCount("Mo") == 2);
+  REQUIRE(columnCount("日本") == 4);
+  REQUIRE(columnCount("e\u0301t") == 3);  // every character that isn't wide takes one
+  REQUIRE(columnCount("bad\xff") == 4);
+  REQUIRE(columnCount("日本") == 4);
+}
+
+TEST_CASE("Cut points", "[text_width]") {
+  SECTION("fits") {
+    auto measure = measureText("title", 10, 8);
+    CHECK(measure.width == 5);
+    CHECK(measure.cut == 5);
+    CHECK(measure.cut_short == 5);
+  }
+  SECTION("too long, trailing blanks are not kept") {
+    auto measure = measureText("some title", 5, 3);
+    CHECK(measure.width == 10);
+    CHECK(measure.cut == 4);
+    CHECK(measure.cut_short == 3);
+  }
+  SECTION("wide characters") {
+    auto measure = measureText("日本語", 5, 2);
+    CHECK(measure.width == 6);
+    CHECK(measure.cut == 6);  // two characters, three bytes each
+    CHECK(measure.cut_short == 3);
+  }
+  SECTION("nothing fits") {
+    auto measure = measureText("日", 1);
+    CHECK(measure.cut == npos);
+    CHECK(measure.cut_short == npos);
+  }
+  SECTION("invalid UTF-8 is cut at a byte count") {
+    auto measure = measureText("bad\xff text", 4, 2);
+    CHECK(measure.width == 9);
+    CHECK(measure.cut == 4);
+    CHECK(measure.cut_short == 2);
+  }
+}
@@ -0,0 +1,27 @@
+#include "util/time_format.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+using namespace std::chrono_literals;
+using waybar::util::clockPeriod;
+using waybar::util::showsSeconds;
+
+TEST_CASE("Formats that show seconds", "[time_format]") {
+  REQUIRE(showsSeconds("{:%H:%M:%S}"));
+  REQUIRE(showsSeconds("{:%T}"));
+  REQUIRE(showsSeconds("{:L%c}"));
+  REQUIRE(showsSeconds("{:%OS}"));
+  REQUIRE_FALSE(showsSeconds("{:%H:%M}"));
+  REQUIRE_FALSE(showsSeconds("{:%A, %B %d, %Y (%R)}"));
+  REQUIRE_FALSE(showsSeconds("Seconds: %"));
+}
+
+TEST_CASE("Clock periods", "[time_format]") {
+  REQUIRE(clockPeriod(1s, {"{:%H:%M}", ""}) == 1min);
+  REQUIRE(clockPeriod(1s, {"{:%H:%M}", "{:%H:%M:%S}"}) == 1s);
+  REQUIRE(clockPeriod(5min, {"{:%H:%M}"}) == 5min);
+}
@@ -0,0 +1,55 @@
+#include "util/triple_buffer.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include <thread>
+
+using waybar::util::TripleBuffer;
+
+TEST_CASE("Nothing to pick up before a publish", "[triple_buffer]") {
+  TripleBuffer<int> buffer(7);
+  REQUIRE_FALSE(buffer.update());
+  REQUIRE(buffer.front() == 7);
+}
+
+TEST_CASE("Only the latest value is picked up", "[triple_buffer]") {
+  TripleBuffer<int> buffer;
+  for (int i = 1; i <= 3; ++i) {
+    buffer.back() = i;
+    buffer.publish();
+  }
+  REQUIRE(buffer.update());
+  REQUIRE(buffer.front() == 3);
+  REQUIRE_FALSE(buffer.update());
+  REQUIRE(buffer.front() == 3);
+
+  buffer.back() = 4;
+  buffer.publish();
+  REQUIRE(buffer.update());
+  REQUIRE(buffer.front() == 4);
+}
+
+TEST_CASE("Values only move forward across threads", "[triple_buffer]") {
+  TripleBuffer<int> buffer(0);
+  constexpr int LAST = 100000;
+  std::thread producer([&] {
+    for (int i = 1; i <= LAST; ++i) {
+      buffer.back() = i;
+      buffer.publish();
+    }
+  });
+  int seen = 0;
+  bool ordered = true;
+  while (seen != LAST) {
+    if (buffer.update()) {
+      ordered = ordered && buffer.front() > seen;
+      seen = buffer.front();
+    }
+  }
+  producer.join();
+  REQUIRE(ordered);
+}
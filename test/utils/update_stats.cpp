@@ -0,0 +1,44 @@
+#include "util/update_stats.hpp"
+
+#if __has_include(<catch2/catch_test_macros.hpp>)
+#include <catch2/catch_test_macros.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+using waybar::util::UpdateStats;
+using std::chrono::microseconds;
+
+TEST_CASE("No updates, nothing to tell", "[update_stats]") {
+  UpdateStats stats;
+  REQUIRE(stats.count() == 0);
+  REQUIRE(stats.percentile(0.5) == microseconds(0));
+  REQUIRE(stats.max() == microseconds(0));
+}
+
+TEST_CASE("Percentiles are within a factor of two", "[update_stats]") {
+  UpdateStats stats;
+  for (int i = 1; i <= 100; ++i) {
+    stats.record(microseconds(i * 10));
+  }
+  REQUIRE(stats.count() == 100);
+  REQUIRE(stats.total() == microseconds(50500));
+  REQUIRE(stats.max() == microseconds(1000));
+  REQUIRE(stats.percentile(0.5) >= microseconds(500));
+  REQUIRE(stats.percentile(0.5) < microseconds(1000));
+  // Capped by the worst one rather than its bucket's bound
+  REQUIRE(stats.percentile(0.99) == microseconds(1000));
+}
+
+TEST_CASE("Rare slow updates show in the tail only", "[update_stats]") {
+  UpdateStats stats;
+  for (int i = 0; i < 990; ++i) {
+    stats.record(microseconds(100));
+  }
+  for (int i = 0; i < 10; ++i) {
+    stats.record(microseconds(50000));
+  }
+  REQUIRE(stats.percentile(0.5) < microseconds(200));
+  REQUIRE(stats.percentile(0.99) < microseconds(200));
+  REQUIRE(stats.percentile(1) == microseconds(50000));
+}